@@ -1,5 +1,62 @@
 set MaxEvents 100
 
+# reuse the candidates of the previous events instead of the per-class pools
+# set CandidateArena true
+
+# run the independent modules of each event on several threads
+# set ModuleThreads 4
+
+# parse the next events of a HepMC input on a second thread while the
+# current one is simulated
+# set ReadAheadEvents 2
+
+# generate the events of DelphesPythia8 with several Pythia instances on
+# threads of their own, seeded one after the other
+# set NumberOfGenerators 4
+
+# compress the baskets of the output tree on several threads of ROOT's
+# implicit multi-threading
+# set OutputCompressionThreads 4
+
+# draw the random numbers of every module from its own stream, reseeded for
+# each event from RandomSeed, the module name and the event number
+# set RandomStreams true
+
+# draw the gaussian smearing of the modules from blocks of deviates instead
+# of one TRandom::Gaus call each, this changes the numbers drawn
+# set GaussianBuffers true
+
+# print the time spent in every module, and in its Init, and its peak memory
+# at the end of the run and write the values of all events to a CSV file
+# set ModuleTiming true
+# set ModuleTimingFile timing.csv
+
+# write the start and the duration of every module in every event, with the
+# sizes of its input arrays, to a trace that Perfetto or chrome://tracing open
+# set ModuleTraceFile trace.json
+
+# stop with an error when the resident memory goes above this many MB
+# set MemoryBudget 4000
+
+# release the candidates, arrays and buffers kept for the next events after
+# an event that needed more than this many MB of them
+# set PoolBudget 500
+
+# write the events processed, the events per second over the last
+# MetricsWindow seconds, the output bytes and the share of every module
+# every MetricsInterval seconds, as JSON lines or as a Prometheus text file
+# set MetricsFile metrics.json
+# set MetricsFormat json
+# set MetricsInterval 10
+# set MetricsWindow 60
+
+# log the number and input offset of every event, with the state of gRandom
+# every ReplayLogInterval events when RandomStreams is off, so that a slow
+# event can be run again alone with DelphesSTDHEP --replay-event N and the
+# timing or trace options above
+# set ReplayLogFile replay.log
+# set ReplayLogInterval 100
+
 #######################################
 # Order of execution of various modules
 #######################################
@@ -468,6 +525,8 @@ module RunPUPPI RunPUPPI {
   set PVInputArray      PileUpMerger/vertices
   set MinPuppiWeight    0.05
   set UseExp            false
+  ## compute the metric and the weights of the particles on this many threads
+  # set NThreads          1
  
   ## define puppi algorithm parameters (more than one for the same eta region is possible)                                                                                      
   add EtaMinBin           0.    2.5    2.5    3.0   3.0
@@ -590,6 +649,10 @@ module FastJetFinder RecoJetFinder {
   set JetAlgorithm  6
   set ParameterR    0.4
   set JetPTMin      10.0
+  # write the clustering inputs for examples/JetClusteringBenchmark
+  # set InputDumpFile RecoJetFinder_inputs.dat
+  # time the clustering strategies on the first events and keep the fastest
+  # set StrategyCalibrationEvents 20
 }
 
 
@@ -1860,6 +1923,7 @@ module TauTagging TauTagging {
 module Merger GenMissingET {
   add InputArray NeutrinoFilter/filteredParticles
   set MomentumOutputArray momentum
+  set OutputArray {}
 }
 
 module Merger RecoMissingET {
@@ -2083,6 +2147,33 @@ module StatusPidFilter StatusPidFilter {
 ##################
 
 module TreeWriter TreeWriter {
+
+  # output tree settings, LZ4 writes fastest and ZSTD or LZMA are smallest
+  # set Compression LZ4
+  # set CompressionLevel 4
+  # set BasketSize 64000
+  # add BasketSizes Particle 256000
+  # set SplitLevel 99
+  # set AutoFlush -30000000
+  # set AutoSave 10000000
+
+  # roll over to out_1.root, out_2.root, ... once a file holds that many
+  # events or bytes, zero writes one file, DelphesSTDHEP --resume goes on
+  # after the last complete file of a failed job
+  # set MaxEventsPerFile 100000
+  # set MaxBytesPerFile 2000000000
+
+  # fields of a branch that are left empty and not computed: Constituents,
+  # Particles, Subjets, Tracks, FlavorTagging and Substructure of the jets,
+  # Particles of the towers and photons, Covariance of the tracks
+  # add SkipFields PuppiJetPileUpID Constituents
+  # add SkipFields PuppiJetPileUpID Substructure
+
+  # trkCov of the tracks as the Plain covariance, its Cholesky factor or
+  # the sigmas and the Correlation coefficients, see DelphesCovariance,
+  # keeping that many of the 23 mantissa bits of every value
+  # set CovarianceForm Cholesky
+  # set CovarianceMantissaBits 12
   
   ## branch notation : <particle collection> <branch name> <type of object in classes/DelphesClass.h<
 
@@ -2131,3 +2222,16 @@ module TreeWriter TreeWriter {
   add Branch MuonIsolation/muons Muon Muon
 
 }
+
+#######################################################
+# Flat tree writer, add FlatTreeWriter to the
+# ExecutionPath to write the branches as plain vectors
+#######################################################
+
+# module FlatTreeWriter FlatTreeWriter {
+#   add Branch StatusPidFilter/filteredParticles FlatParticle GenParticle
+#   add Branch PuppiJetPileUpID/jets FlatPuppiJet Jet
+#   add Branch PuppiMissingET/momentum FlatPuppiMissingET MissingET
+#   add Branch ElectronIsolation/electrons FlatElectron Electron
+#   add Branch MuonIsolation/muons FlatMuon Muon
+# }
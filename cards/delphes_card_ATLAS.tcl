@@ -401,6 +401,7 @@ module Merger MissingET {
 # add InputArray InputArray
   add InputArray EFlowMerger/eflow
   set MomentumOutputArray momentum
+  set OutputArray {}
 }
 
 ##################
@@ -414,6 +415,7 @@ module Merger ScalarHT {
   add InputArray UniqueObjectFinder/photons
   add InputArray UniqueObjectFinder/muons
   set EnergyOutputArray energy
+  set OutputArray {}
 }
 
 
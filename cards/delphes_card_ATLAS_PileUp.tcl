@@ -587,6 +587,7 @@ module Merger MissingET {
 # add InputArray InputArray
   add InputArray EFlowMergerAllTracks/eflow
   set MomentumOutputArray momentum
+  set OutputArray {}
 }
 
 
@@ -601,6 +602,7 @@ module Merger ScalarHT {
   add InputArray UniqueObjectFinder/photons
   add InputArray UniqueObjectFinder/muons
   set EnergyOutputArray energy
+  set OutputArray {}
 }
 
 ########################
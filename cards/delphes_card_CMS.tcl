@@ -76,6 +76,7 @@ module Efficiency ChargedHadronTrackingEfficiency {
   set OutputArray chargedHadrons
 
   # add EfficiencyFormula {efficiency formula as a function of eta and pt}
+  # set EfficiencyTable {binned table used instead of the formula, see classes/DelphesFormula.h}
 
   # tracking efficiency formula for charged hadrons
   set EfficiencyFormula {                                                    (pt <= 0.1)   * (0.00) +
@@ -411,6 +412,7 @@ module Merger MissingET {
 # add InputArray InputArray
   add InputArray EFlowMerger/eflow
   set MomentumOutputArray momentum
+  set OutputArray {}
 }
 
 ##################
@@ -424,6 +426,7 @@ module Merger ScalarHT {
   add InputArray UniqueObjectFinder/photons
   add InputArray UniqueObjectFinder/muons
   set EnergyOutputArray energy
+  set OutputArray {}
 }
 
 
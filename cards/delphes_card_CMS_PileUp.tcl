@@ -71,6 +71,24 @@ module PileUpMerger PileUpMerger {
   # average expected pile up
   set MeanPileUp 50
 
+  # pile-up particles outside all the detector acceptances can be dropped here
+  # set ParticlePTMin 0.1
+  # set ParticleEtaMax 5.0
+
+  # number of decoded pile-up events kept in memory, -1 keeps the whole file
+  # set CacheSize 10000
+
+  # decoded copy of the pile-up file made once per node and mapped by all
+  # the Delphes processes running there
+  # set SharedPileUpFile /dev/shm/MinBias.pileup
+
+  # library of minimum bias events written by PremixedPileUpWriter after the
+  # propagation and the tracking, its particles and tracks then have to be
+  # merged with the ones the calorimeter takes as input
+  # set PremixedPileUpFile MinBias.premixed.root
+  # add PremixedArray particles premixedParticles
+  # add PremixedArray tracks premixedTracks
+
   # maximum spread in the beam direction in m
   set ZVertexSpread 0.10
 
@@ -344,6 +362,8 @@ module TrackPileUpSubtractor TrackPileUpSubtractor {
   # assume perfect pile-up subtraction for tracks with |z| > fZVertexResolution
   # Z vertex resolution in m
   set ZVertexResolution 0.0001
+  # remove tracks by the z of their pile-up vertex
+  # set UseVertexIndex true
 }
 
 ####################
@@ -626,6 +646,7 @@ module Merger MissingET {
 # add InputArray InputArray
   add InputArray EFlowMergerAllTracks/eflow
   set MomentumOutputArray momentum
+  set OutputArray {}
 }
 
 
@@ -641,6 +662,7 @@ module Merger ScalarHT {
   add InputArray UniqueObjectFinder/photons
   add InputArray UniqueObjectFinder/muons
   set EnergyOutputArray energy
+  set OutputArray {}
 }
 
 ########################
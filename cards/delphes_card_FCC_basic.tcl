@@ -379,6 +379,7 @@ module Merger MissingET {
 # add InputArray InputArray
   add InputArray EFlowMerger/eflow
   set MomentumOutputArray momentum
+  set OutputArray {}
 }
 
 
@@ -390,6 +391,7 @@ module Merger ScalarHT {
 # add InputArray InputArray
   add InputArray EFlowMerger/eflow
   set EnergyOutputArray energy
+  set OutputArray {}
 }
 
 #####################
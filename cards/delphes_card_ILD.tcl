@@ -364,6 +364,7 @@ module Merger MissingET {
 # add InputArray InputArray
   add InputArray EFlowMerger/eflow
   set MomentumOutputArray momentum
+  set OutputArray {}
 }
 
 
@@ -375,6 +376,7 @@ module Merger ScalarHT {
 # add InputArray InputArray
   add InputArray EFlowMerger/eflow
   set EnergyOutputArray energy
+  set OutputArray {}
 }
 
 #####################
@@ -55,6 +55,11 @@ module PhotonConversions PhotonConversions {
   # unit: m-1
   
   set Step 0.05
+
+  # tabulate the conversion probabilities of the photons from the origin
+  # in bins of eta (and phi), one random number per photon instead of one per step
+  # set TableEtaBins 300
+  # set TablePhiBins 1
   
   set ConversionMap {          (abs(z) > 0.0 && abs(z) < 12.0 ) * (0.07) +
                                (abs(z) > 0.0) * (0.00) +
@@ -425,6 +425,7 @@ module Merger MissingET {
 # add InputArray InputArray
   add InputArray EFlowMerger/eflow
   set MomentumOutputArray momentum
+  set OutputArray {}
 }
 
 ##################
@@ -438,6 +439,7 @@ module Merger ScalarHT {
   add InputArray UniqueObjectFinder/photons
   add InputArray UniqueObjectFinder/muons
   set EnergyOutputArray energy
+  set OutputArray {}
 }
 
 
@@ -498,6 +500,8 @@ module FastJetFinder TrackJetFinder {
 module FastJetFinder FatJetFinder {
   set InputArray Calorimeter/towers
   set GhostAssociatedInputArray TrackJetFinder/jets
+  # attach the ghosts after the anti-kt clustering rather than clustering them
+  # set GhostAssociationGrid true
 
   set OutputArray jets
 
@@ -552,6 +556,10 @@ module JetTrackDumper JetTrackDumper {
   set DeltaR 1.2;
   set TrackIPMax 8;
 
+  # also write the tracks of every jet to HDF5, next to the root file
+  # set OutputExtension .tracks.h5
+  # set AsyncWrite true
+
 }
 
 #####################################################
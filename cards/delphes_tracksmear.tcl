@@ -9,6 +9,15 @@ set MaxEvents 10
 set TrackSmear 1.0
 set CovScale 1.0
 
+# run the modules from SweepStart on once per variant, each with its own
+# output file (out_loose.root next to out.root) and parameter overrides,
+# the modules before SweepStart run once per event for all of them
+# set SweepStart TrackParSmearing
+# set SweepVariants {
+#   {loose TrackParSmearing::SmearingMultiple 2.0 PrimaryVertexFinder::CovarianceScaling 2.0}
+#   {tight TrackParSmearing::SmearingMultiple 0.5 PrimaryVertexFinder::CovarianceScaling 0.5}
+# }
+
 set ExecutionPath {
   ParticlePropagator
 
@@ -42,6 +51,7 @@ set ExecutionPath {
   JetFlavorAssociation
   TrackBasedBTagging
   SecondaryVertexAssociator
+  PrimaryVertexFinder
   SecondaryVertexTagging
 
   UniqueObjectFinder
@@ -435,6 +445,7 @@ module Merger MissingET {
 # add InputArray InputArray
   add InputArray EFlowMerger/eflow
   set MomentumOutputArray momentum
+  set OutputArray {}
 }
 
 ##################
@@ -448,6 +459,7 @@ module Merger ScalarHT {
   add InputArray UniqueObjectFinder/photons
   add InputArray UniqueObjectFinder/muons
   set EnergyOutputArray energy
+  set OutputArray {}
 }
 
 
@@ -501,6 +513,9 @@ module FastJetFinder FastJetFinder {
   set JetAlgorithm 6
   set ParameterR 0.4
 
+  # extra {algorithm R output array} definitions clustered from the same inputs
+  # add ExtraJetDefinitions 5 1.0 fatJets
+
   set JetPTMin 20.0
 }
 
@@ -540,9 +555,20 @@ module JetFlavorAssociation JetFlavorAssociation {
 # set TaggingTracks Calorimeter/eflowTracks
 set TaggingTracks TrackParSmearing/tracks
 
+# Attaches the tracks within DeltaR to each jet in one pass. To use
+# it, add it to the ExecutionPath before the taggers and set
+# UseJetTracks in each of them. The jet then holds every track in the
+# cone, not only the ones TrackBasedBTagging selects.
+module JetTrackAssociator JetTrackAssociator {
+  set TrackInputArray $TaggingTracks
+  set JetInputArray JetEnergyScale/jets
+  set DeltaR 0.4
+}
+
 module TrackBasedBTagging TrackBasedBTagging {
   set TrackInputArray $TaggingTracks
   set JetInputArray JetEnergyScale/jets
+  set UseJetTracks false
 
   set TrackMinPt 0.5
   set DeltaR 0.4;		# was 0.4
@@ -554,13 +580,27 @@ module TrackBasedBTagging TrackBasedBTagging {
 # Secondary vertex finding
 #####################################################
 
+module PrimaryVertexFinder PrimaryVertexFinder {
+  set TrackInputArray $TaggingTracks
+  set OutputArray vertices
+
+  set TrackPtMin 0.5
+  set TrackD0Max 1
+  set Bz 2.0
+  set Beamspot {0.015 0.015 46.0}
+
+  set CovarianceScaling $CovScale
+}
+
 module SecondaryVertexTagging SecondaryVertexTagging {
   set TrackInputArray $TaggingTracks
   set JetInputArray JetEnergyScale/jets
   set OutputArray secondaryVertices
+  set UseJetTracks false
 
-  set PrimaryVertexPtMin 0.5
-  set PrimaryVertexD0Max 1
+  # if this is empty we fit the primary vertex here, using
+  # PrimaryVertexPtMin and PrimaryVertexD0Max to select tracks
+  set PrimaryVertexInputArray PrimaryVertexFinder/vertices
   set PrimaryVertexCompatibility 0.9
 
   set TrackPtMin 0.5
@@ -570,6 +610,24 @@ module SecondaryVertexTagging SecondaryVertexTagging {
   set Beamspot {0.015 0.015 46.0}
   set HLSecVxCompatibility 3.0
   set MidLevelSecVxCompatibility 1.0
+  # only fit tracks with sqrt(d0sig^2 + z0sig^2) above this, and at
+  # most MaxFitTracks of them (the most significant, 0 for no limit)
+  set FitTrackIPSigMin 0
+  set MaxFitTracks 0
+  # time budgets for the vertex fits in seconds (0 for none), counting
+  # only the time spent in the fits. Jets over budget (or all remaining
+  # jets once the event is) use FallbackMethod.
+  set JetTimeBudget 0
+  set EventTimeBudget 0
+  set FallbackMethod kalman
+  # seed the vertex fits with a ghost track along the jet axis
+  set JetAxisSeed false
+  # only fit the jets passing these cuts (0 for none), the others get
+  # no vertices. The tree stores the vertices of every jet unless the
+  # TreeWriter skips FlavorTagging, then these can be the PTMin and
+  # AbsEtaMax of the HDF5Writer
+  set JetPTMin 0
+  set JetAbsEtaMax 0
 
   set CovarianceScaling $CovScale
 }
@@ -628,8 +686,83 @@ module TreeWriter TreeWriter {
 
 module HDF5Writer HDF5Writer {
   set JetInputArray UniqueObjectFinder/jets
+  # if OutputFile is empty the name comes from the ROOT output file,
+  # with OutputExtension replacing its extension
+  set OutputFile ""
   set OutputExtension .ntuple.h5
   set TextFileExtension .ntuple.txt
+  # write one in every N jets to the text file
+  set TextFileSampling 1
+  set PTMin 20
+  set AbsEtaMax 2.5
+  # write full buffers from a background thread
+  set AsyncWrite false
+  # with an HDF5 built with MPI, all the ranks of an MPI job write into
+  # the one OutputFile, needs MaxTracks or the columnar layout
+  set Parallel false
+  # single-writer/multiple-reader output that can be read while the job
+  # runs, flushed every SWMRFlushEvents events, needs MaxTracks or the
+  # columnar layout
+  set SWMR false
+  set SWMRFlushEvents 100
+  # dataset chunking and compression (none, deflate-N, szip, lzf),
+  # the chunk size in rows must be positive, 1000 is the buffer size
+  set ChunkSize 1000
+  set Compression deflate-7
+  set Shuffle false
+  # compound (one `jets` dataset), columnar (one dataset per
+  # high-level variable under `high_level_jets`), or both
+  set OutputLayout compound
+  # if > 0, write the leading tracks as NaN-padded [n_jets, MaxTracks]
+  # arrays rather than variable-length members of `jets`, the
+  # n_*_vertex_tracks datasets count all tracks of the jet, not with
+  # the columnar layout
+  set MaxTracks 0
+  # event-level inputs for the `events` dataset, leave empty to skip
+  set MissingETInputArray MissingET/momentum
+  set RhoInputArray ""
+  set VertexInputArray ""
+  # output of a Weighter, its weight sets go to `event_weights` with one
+  # row per event, can't be used with Parallel
+  set WeightInputArray ""
+  # new numbered files follow those of the ROOT output, these limits
+  # roll over the HDF5 output on its own, zero turns them off
+  set MaxEventsPerFile 0
+  set MaxBytesPerFile 0
+}
+
+##################
+# Jet image writer
+##################
+
+# add JetImageWriter to the ExecutionPath to write jet images and
+# constituent arrays for the taggers
+
+module JetImageWriter JetImageWriter {
+  set JetInputArray UniqueObjectFinder/jets
+  # if OutputFile is empty the name comes from the ROOT output file,
+  # with OutputExtension replacing its extension
+  set OutputFile ""
+  set OutputExtension .images.h5
   set PTMin 20
   set AbsEtaMax 2.5
+  # EtaBins x PhiBins pixels covering EtaWidth x PhiWidth around the
+  # jet axis
+  set EtaBins 33
+  set PhiBins 33
+  set EtaWidth 1.6
+  set PhiWidth 1.6
+  # turn the principal axis of the constituents along eta, and scale
+  # the pixels of each image to a sum of one
+  set Rotate false
+  set Normalize false
+  # leading constituents in the NaN-padded `constituents` array, zero
+  # skips it
+  set MaxConstituents 50
+  # jets per flush, chunking and compression as in HDF5Writer
+  set BufferSize 1000
+  set ChunkSize 1000
+  set Compression deflate-7
+  set Shuffle false
+  set AsyncWrite false
 }
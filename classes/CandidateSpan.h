@@ -0,0 +1,108 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CandidateSpan_h
+#define CandidateSpan_h
+
+/** \class CandidateSpan
+ *
+ *  Typed view of the candidates in a TObjArray returned by
+ *  DelphesModule::ImportArray or ExportArray.
+ *
+ *  The view walks the storage of the array directly, without the virtual
+ *  TIterator::Next call per element:
+ *
+ *    for(Candidate *candidate : CandidateSpan(fInputArray)) { ... }
+ *
+ *  The array must not be modified while the view is in use, and the view
+ *  has to be built again after entries are added. The arrays filled by
+ *  the modules never contain empty slots.
+ *
+ */
+
+#if !defined(__CINT__) && !defined(__CLING__)
+
+#include "TObjArray.h"
+
+#include "classes/DelphesClasses.h"
+
+#include <iterator>
+#include <cstddef>
+
+class CandidateSpan
+{
+public:
+
+  class iterator
+  {
+  public:
+
+    typedef std::random_access_iterator_tag iterator_category;
+    typedef Candidate *value_type;
+    typedef ptrdiff_t difference_type;
+    typedef Candidate *const *pointer;
+    typedef Candidate *reference;
+
+    iterator(TObject *const *object = 0) : fPointer(object) {}
+
+    Candidate *operator*() const { return static_cast< Candidate * >(*fPointer); }
+    Candidate *operator[](ptrdiff_t n) const { return static_cast< Candidate * >(fPointer[n]); }
+
+    iterator &operator++() { ++fPointer; return *this; }
+    iterator operator++(int) { iterator it(*this); ++fPointer; return it; }
+    iterator &operator--() { --fPointer; return *this; }
+    iterator operator--(int) { iterator it(*this); --fPointer; return it; }
+    iterator &operator+=(ptrdiff_t n) { fPointer += n; return *this; }
+    iterator &operator-=(ptrdiff_t n) { fPointer -= n; return *this; }
+
+    iterator operator+(ptrdiff_t n) const { return iterator(fPointer + n); }
+    iterator operator-(ptrdiff_t n) const { return iterator(fPointer - n); }
+    ptrdiff_t operator-(const iterator &it) const { return fPointer - it.fPointer; }
+
+    bool operator==(const iterator &it) const { return fPointer == it.fPointer; }
+    bool operator!=(const iterator &it) const { return fPointer != it.fPointer; }
+    bool operator<(const iterator &it) const { return fPointer < it.fPointer; }
+
+  private:
+
+    TObject *const *fPointer;
+  };
+
+  CandidateSpan(const TObjArray *array) :
+    fBegin(array ? array->GetObjectRef() : 0),
+    fSize(array ? array->GetEntriesFast() : 0)
+  {
+  }
+
+  iterator begin() const { return iterator(fBegin); }
+  iterator end() const { return iterator(fBegin + fSize); }
+
+  Int_t size() const { return fSize; }
+  bool empty() const { return fSize == 0; }
+
+  Candidate *operator[](Int_t i) const { return static_cast< Candidate * >(fBegin[i]); }
+
+private:
+
+  TObject *const *fBegin;
+  Int_t fSize;
+};
+
+#endif
+
+#endif /* CandidateSpan_h */
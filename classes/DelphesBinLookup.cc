@@ -0,0 +1,81 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/** \class DelphesBinLookup
+ *
+ *  Same result as std::lower_bound over sorted bin edges, found from a
+ *  uniform table over the range of the edges.
+ *
+ */
+
+#include "classes/DelphesBinLookup.h"
+
+#include "TMath.h"
+
+#include <algorithm>
+
+using namespace std;
+
+// table cells per bin, and the largest table
+static const Int_t kCellsPerBin = 4;
+static const Int_t kMaxCells = 1 << 16;
+
+//------------------------------------------------------------------------------
+
+DelphesBinLookup::DelphesBinLookup() :
+  fFirst(0.0), fLast(0.0), fScale(0.0)
+{
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesBinLookup::Init(const vector<Double_t> &edges)
+{
+  Int_t i, numberOfCells;
+  Double_t width;
+
+  fEdges = edges;
+  fTable.clear();
+
+  // a couple of comparisons are as fast as the table
+  if(fEdges.size() < 4) return;
+
+  fFirst = fEdges.front();
+  fLast = fEdges.back();
+  if(TMath::IsNaN(fLast - fFirst) || !(fLast - fFirst < TMath::Infinity())) return;
+
+  numberOfCells = TMath::Min(kCellsPerBin*Int_t(fEdges.size() - 1), kMaxCells);
+  width = (fLast - fFirst)/numberOfCells;
+  fScale = 1.0/width;
+
+  fTable.resize(numberOfCells);
+  for(i = 0; i < numberOfCells; ++i)
+  {
+    fTable[i] = FindBinary(fFirst + i*width);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+Int_t DelphesBinLookup::FindBinary(Double_t value) const
+{
+  return lower_bound(fEdges.begin(), fEdges.end(), value) - fEdges.begin();
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,74 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DelphesBinLookup_h
+#define DelphesBinLookup_h
+
+/** \class DelphesBinLookup
+ *
+ *  Same result as std::lower_bound over sorted bin edges, found from a
+ *  uniform table over the range of the edges and a few neighbouring
+ *  comparisons, so the cost does not grow with the number of bins.
+ *
+ */
+
+#include "Rtypes.h"
+
+#include <vector>
+
+class DelphesBinLookup
+{
+public:
+
+  DelphesBinLookup();
+
+  // edges must be sorted and unique
+  void Init(const std::vector<Double_t> &edges);
+
+  // index of the first edge that is not less than value,
+  // the number of edges if there is none
+  Int_t Find(Double_t value) const
+  {
+    Int_t cell, i;
+
+    if(fTable.empty()) return FindBinary(value);
+
+    // NaN also goes to the first edge, as with std::lower_bound
+    if(!(value > fFirst)) return 0;
+    if(value > fLast) return fEdges.size();
+
+    cell = Int_t((value - fFirst)*fScale);
+    if(cell >= Int_t(fTable.size())) cell = fTable.size() - 1;
+
+    // the table only gives a starting point, the edges decide
+    i = fTable[cell];
+    while(i > 0 && fEdges[i - 1] >= value) --i;
+    while(fEdges[i] < value) ++i;
+    return i;
+  }
+
+private:
+
+  Int_t FindBinary(Double_t value) const;
+
+  std::vector<Double_t> fEdges;
+  std::vector<Int_t> fTable;
+  Double_t fFirst, fLast, fScale;
+};
+
+#endif /* DelphesBinLookup_h */
@@ -0,0 +1,163 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/** \class DelphesCheckpoint
+ *
+ *  Checkpoints of a job writing its output to several files.
+ *
+ */
+
+#include "classes/DelphesCheckpoint.h"
+
+#include "ExRootAnalysis/ExRootTreeWriter.h"
+
+#include "TRandom.h"
+#include "TDirectory.h"
+
+#include <stdio.h>
+
+#include <stdexcept>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+
+DelphesCheckpoint::DelphesCheckpoint(const char *outputFileName) :
+  fFileName(TString(outputFileName) + ".checkpoint"), fTreeWriter(0), fPending(kFALSE),
+  fInputFile(0), fFiles(0), fWrittenFiles(0), fEvents(0), fProcessed(0)
+{
+}
+
+//------------------------------------------------------------------------------
+
+Bool_t DelphesCheckpoint::Read()
+{
+  stringstream message;
+  string key;
+
+  ifstream file(fFileName.Data());
+  if(!file) return kFALSE;
+
+  while(file >> key)
+  {
+    if(key == "InputFile") file >> fInputFile;
+    else if(key == "Events") file >> fEvents;
+    else if(key == "Processed") file >> fProcessed;
+    else if(key == "Files") file >> fFiles;
+    else
+    {
+      message << "unknown key '" << key << "' in checkpoint " << fFileName;
+      throw runtime_error(message.str());
+    }
+  }
+
+  if(!file.eof())
+  {
+    message << "can't read checkpoint " << fFileName;
+    throw runtime_error(message.str());
+  }
+
+  fWrittenFiles = fFiles;
+  return kTRUE;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesCheckpoint::RestoreRandom() const
+{
+  TDirectory *dir = gDirectory;
+  gRandom->ReadRandom(GetRandomFileName(fFiles));
+  dir->cd();
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesCheckpoint::Update(Int_t inputFile, Long64_t events, Long64_t processed)
+{
+  TDirectory *dir;
+  Int_t closedFiles;
+
+  closedFiles = fTreeWriter->GetFileNumber() - (fTreeWriter->IsRolloverPending() ? 1 : 0);
+
+  if(fPending && closedFiles >= fFiles)
+  {
+    Write();
+    if(fWrittenFiles > 0 && fWrittenFiles != fFiles) remove(GetRandomFileName(fWrittenFiles));
+    fWrittenFiles = fFiles;
+    fPending = kFALSE;
+  }
+
+  if(!fPending && fTreeWriter->IsRolloverPending())
+  {
+    fInputFile = inputFile;
+    fEvents = events;
+    fProcessed = processed;
+    fFiles = fTreeWriter->GetFileNumber();
+
+    dir = gDirectory;
+    gRandom->WriteRandom(GetRandomFileName(fFiles));
+    dir->cd();
+
+    fPending = kTRUE;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesCheckpoint::Remove() const
+{
+  remove(fFileName);
+  if(fWrittenFiles > 0) remove(GetRandomFileName(fWrittenFiles));
+  if(fPending) remove(GetRandomFileName(fFiles));
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesCheckpoint::Write() const
+{
+  stringstream message;
+  TString tmpFileName = fFileName + ".tmp";
+
+  // the checkpoint is replaced at once, a job killed while it is written
+  // finds the previous one
+  ofstream file(tmpFileName.Data());
+  file << "InputFile " << fInputFile << endl;
+  file << "Events " << fEvents << endl;
+  file << "Processed " << fProcessed << endl;
+  file << "Files " << fFiles << endl;
+  file.close();
+
+  if(!file || rename(tmpFileName, fFileName) != 0)
+  {
+    message << "can't write checkpoint " << fFileName;
+    throw runtime_error(message.str());
+  }
+}
+
+//------------------------------------------------------------------------------
+
+TString DelphesCheckpoint::GetRandomFileName(Int_t files) const
+{
+  return fFileName + TString::Format("_%d.random.root", files);
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,96 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef DelphesCheckpoint_h
+#define DelphesCheckpoint_h
+
+/** \class DelphesCheckpoint
+ *
+ *  Checkpoints of a job writing its output to several files, see
+ *  ExRootTreeWriter::SetMaxEventsPerFile.
+ *
+ *  Once an event fills up an output file, the position of the reader, the
+ *  number of events processed and the state of gRandom are kept, and they
+ *  are written to the checkpoint once the next event has closed the file,
+ *  so that the checkpoint always describes files that are complete.
+ *
+ *  The checkpoint is kept next to the output file, with ".checkpoint"
+ *  appended to its name, as lines of a key and a value: the position of
+ *  the input file among the arguments, the number of events read from
+ *  it, the number of events processed and the number of complete output
+ *  files. The state of gRandom is in a ROOT file named after the
+ *  checkpoint and the number of files, out.root.checkpoint_3.random.root
+ *  after three complete files, so that the checkpoint is only replaced
+ *  once everything it refers to is written. A job resuming after the
+ *  checkpoint writes to the first incomplete file and skips the events
+ *  read before.
+ *
+ */
+
+#include "Rtypes.h"
+#include "TString.h"
+
+class ExRootTreeWriter;
+
+class DelphesCheckpoint
+{
+public:
+
+  DelphesCheckpoint(const char *outputFileName);
+
+  // reads the checkpoint of the output, false if there is none
+  Bool_t Read();
+
+  // writer of the output files, needed by Update
+  void SetTreeWriter(ExRootTreeWriter *treeWriter) { fTreeWriter = treeWriter; }
+
+  Int_t GetInputFile() const { return fInputFile; }
+  Long64_t GetEvents() const { return fEvents; }
+  Long64_t GetProcessed() const { return fProcessed; }
+  Int_t GetFiles() const { return fFiles; }
+
+  // sets gRandom to its state at the checkpoint
+  void RestoreRandom() const;
+
+  // called after every ExRootTreeWriter::Fill with the position of the
+  // input file, the number of events read from it and the number of
+  // events processed in the job
+  void Update(Int_t inputFile, Long64_t events, Long64_t processed);
+
+  // removes the checkpoint once the job is done
+  void Remove() const;
+
+private:
+
+  void Write() const;
+
+  TString GetRandomFileName(Int_t files) const;
+
+  TString fFileName;
+  ExRootTreeWriter *fTreeWriter;
+
+  // the state kept once an event has filled up a file, written with
+  // the next event
+  Bool_t fPending;
+
+  Int_t fInputFile, fFiles, fWrittenFiles;
+  Long64_t fEvents, fProcessed;
+};
+
+#endif // DelphesCheckpoint_h
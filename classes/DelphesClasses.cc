@@ -32,6 +32,8 @@
 #include "classes/DelphesFactory.h"
 #include "classes/SortableObject.h"
 
+#include <algorithm>
+
 CompBase *GenParticle::fgCompare = 0;
 CompBase *Photon::fgCompare = CompPT<Photon>::Instance();
 CompBase *Electron::fgCompare = CompPT<Electron>::Instance();
@@ -42,6 +44,70 @@ CompBase *Tower::fgCompare = CompE<Tower>::Instance();
 CompBase *HectorHit::fgCompare = CompE<HectorHit>::Instance();
 CompBase *Candidate::fgCompare = CompMomentumPt<Candidate>::Instance();
 
+//------------------------------------------------------------------------------
+
+// the last candidate that lets go of a block keeps it as its spare
+
+template< typename T >
+static void ReleaseBlock(T *&block, T *&spare)
+{
+  if(!block) return;
+
+  if(--block->references == 0)
+  {
+    if(spare) delete block;
+    else spare = block;
+  }
+  block = 0;
+}
+
+//------------------------------------------------------------------------------
+
+template< typename T >
+static void ShareBlock(T *&block, T *&spare, T *shared)
+{
+  if(block == shared) return;
+
+  if(shared) ++shared->references;
+  ReleaseBlock(block, spare);
+  block = shared;
+}
+
+//------------------------------------------------------------------------------
+
+// a shared block is copied before it is changed, the candidates that still
+// share it keep the values they had
+
+template< typename T >
+static T *OwnBlock(T *&block, T *&spare)
+{
+  T *shared = block;
+
+  if(shared && shared->references == 1) return shared;
+
+  if(spare)
+  {
+    block = spare;
+    spare = 0;
+  }
+  else
+  {
+    block = new T;
+  }
+  block->references = 1;
+
+  if(shared)
+  {
+    *block = *shared;
+    ReleaseBlock(shared, spare);
+  }
+  else
+  {
+    block->Reset();
+  }
+  return block;
+}
+
 
 //------------------------------------------------------------------------------
 
@@ -121,7 +187,7 @@ TLorentzVector Tower::P4() const
 Candidate::Candidate() :
   PID(0), Status(0), M1(-1), M2(-1), D1(-1), D2(-1),
   Charge(0), Mass(0.0),
-  IsPU(0), IsRecoPU(0), IsConstituent(0), IsFromConversion(0),
+  IsPU(0), IsRecoPU(0), VertexIndex(0), IsConstituent(0), IsFromConversion(0),
   Flavor(0), FlavorAlgo(0), FlavorPhys(0),
   BTag(0), BTagAlgo(0), BTagPhys(0),
   TauTag(0), Eem(0.0), Ehad(0.0),
@@ -130,12 +196,6 @@ Candidate::Candidate() :
   Position(0.0, 0.0, 0.0, 0.0),
   Area(0.0, 0.0, 0.0, 0.0),
   Dxy(0), SDxy(0), Xd(0), Yd(0), Zd(0),
-  NCharged(0),
-  NNeutrals(0),
-  Beta(0),
-  BetaStar(0),
-  MeanSqDeltaR(0),
-  PTD(0),
   NTimeHits(-1),
   IsolationVar(-999),
   IsolationVarRhoCorr(-999),
@@ -143,50 +203,171 @@ Candidate::Candidate() :
   SumPtNeutral(-999),
   SumPtChargedPU(-999),
   SumPt(-999),
-  NSubJetsTrimmed(0),
-  NSubJetsPruned(0),
-  NSubJetsSoftDropped(0),
   fFactory(0),
   fArray(0),
+  fIndexedArray(0),
+  fIndices(0),
+  fNIndices(0),
+  fECalEnergyTimePairs(0),
+  fNECalEnergyTimePairs(0),
   fSubjetArray(0),
-  fTrackArray(0)
+  fTrackArray(0),
+  fSubstructure(0),
+  fPileUpJetID(0),
+  fFlavorTagging(0),
+  fSpareSubstructure(0),
+  fSparePileUpJetID(0),
+  fSpareFlavorTagging(0)
 {
-  int i;
   Edges[0] = 0.0;
   Edges[1] = 0.0;
   Edges[2] = 0.0;
   Edges[3] = 0.0;
-  FracPt[0] = 0.0;
-  FracPt[1] = 0.0;
-  FracPt[2] = 0.0;
-  FracPt[3] = 0.0;
-  FracPt[4] = 0.0;
-  Tau[0] = 0.0;
-  Tau[1] = 0.0;
-  Tau[2] = 0.0;
-  Tau[3] = 0.0;
-  Tau[4] = 0.0;
 
   for(int i=0;i<5;i++)
    trkPar[i]=0;
   for(int i=0;i<15;i++)
    trkCov[i]=0;
+}
+
+//------------------------------------------------------------------------------
+
+Candidate::~Candidate()
+{
+  ReleaseBlocks();
+  if(fSpareSubstructure) delete fSpareSubstructure;
+  if(fSparePileUpJetID) delete fSparePileUpJetID;
+  if(fSpareFlavorTagging) delete fSpareFlavorTagging;
+}
+
+//------------------------------------------------------------------------------
+
+CandidateBlock::CandidateBlock() :
+  references(0)
+{
+}
+
+//------------------------------------------------------------------------------
+
+CandidateBlock::CandidateBlock(const CandidateBlock &) :
+  references(0)
+{
+}
+
+//------------------------------------------------------------------------------
+
+CandidateSubstructure::CandidateSubstructure()
+{
+  Reset();
+}
+
+//------------------------------------------------------------------------------
+
+void CandidateSubstructure::Reset()
+{
+  int i;
 
   for(i = 0; i < 5; ++i)
   {
     TrimmedP4[i].SetXYZT(0.0, 0.0, 0.0, 0.0);
     PrunedP4[i].SetXYZT(0.0, 0.0, 0.0, 0.0);
     SoftDroppedP4[i].SetXYZT(0.0, 0.0, 0.0, 0.0);
+    Tau[i] = 0.0;
   }
 
+  NSubJetsTrimmed = 0;
+  NSubJetsPruned = 0;
+  NSubJetsSoftDropped = 0;
+
+  SoftDroppedPointsP4.clear();
+  NSubJetsSoftDroppedPoints.clear();
+}
+
+//------------------------------------------------------------------------------
+
+CandidatePileUpJetID::CandidatePileUpJetID()
+{
+  Reset();
+}
+
+//------------------------------------------------------------------------------
+
+void CandidatePileUpJetID::Reset()
+{
+  int i;
+
+  NCharged = 0;
+  NNeutrals = 0;
+  Beta = 0;
+  BetaStar = 0;
+  MeanSqDeltaR = 0;
+  PTD = 0;
+
+  for(i = 0; i < 5; ++i)
+  {
+    FracPt[i] = 0.0;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+CandidateFlavorTagging::CandidateFlavorTagging() :
+  svFitFallback(0)
+{
+}
+
+//------------------------------------------------------------------------------
+
+void CandidateFlavorTagging::Reset()
+{
+  primaryVertexTracks.clear();
+  secondaryVertices.clear();
+  secondaryVertexTracks.clear();
+  hlSecVxTracks.clear();
+  primaryVertex.clear();
+  hlSvx = HighLevelSvx();
+  mlSvx = HighLevelSvx();
+  svFitFallback = 0;
+  hlTrk = HighLevelTracking();
+  truthVertices.clear();
+}
+
+//------------------------------------------------------------------------------
+
+CandidateSubstructure *Candidate::NewSubstructure()
+{
+  return OwnBlock(fSubstructure, fSpareSubstructure);
+}
+
+//------------------------------------------------------------------------------
+
+CandidatePileUpJetID *Candidate::NewPileUpJetID()
+{
+  return OwnBlock(fPileUpJetID, fSparePileUpJetID);
+}
+
+//------------------------------------------------------------------------------
+
+CandidateFlavorTagging *Candidate::NewFlavorTagging()
+{
+  return OwnBlock(fFlavorTagging, fSpareFlavorTagging);
+}
+
+//------------------------------------------------------------------------------
+
+void Candidate::ReleaseBlocks()
+{
+  ReleaseBlock(fSubstructure, fSpareSubstructure);
+  ReleaseBlock(fPileUpJetID, fSparePileUpJetID);
+  ReleaseBlock(fFlavorTagging, fSpareFlavorTagging);
 }
 
 //------------------------------------------------------------------------------
 
 void Candidate::AddCandidate(Candidate *object)
 {
-  if(!fArray) fArray = fFactory->NewArray();
-  fArray->Add(object);
+  MoveIndicesToArray();
+  GetCandidates()->Add(object);
 }
 void Candidate::AddSubjet(Candidate *object)
 {
@@ -203,6 +384,16 @@ void Candidate::AddTrack(Candidate *object)
 
 TObjArray *Candidate::GetCandidates()
 {
+  TObjArray *array;
+  Int_t i;
+
+  if(fNIndices > 0)
+  {
+    array = fFactory->NewArray();
+    for(i = 0; i < fNIndices; ++i) array->Add(fIndexedArray->UncheckedAt(fIndices[i]));
+    return array;
+  }
+
   if(!fArray) fArray = fFactory->NewArray();
   return fArray;
 }
@@ -219,28 +410,94 @@ TObjArray *Candidate::GetTracks()
 
 //------------------------------------------------------------------------------
 
+void Candidate::SetCandidates(const TObjArray *array, const Int_t *indices, Int_t n)
+{
+  Int_t i;
+  Int_t *buffer;
+
+  if(n <= 0) return;
+
+  // constituents added before keep the array
+  if(fArray || fNIndices > 0)
+  {
+    MoveIndicesToArray();
+    for(i = 0; i < n; ++i) GetCandidates()->Add(array->UncheckedAt(indices[i]));
+    return;
+  }
+
+  buffer = fFactory->NewIndices(n);
+  std::copy(indices, indices + n, buffer);
+
+  fIndexedArray = array;
+  fIndices = buffer;
+  fNIndices = n;
+}
+
+//------------------------------------------------------------------------------
+
+void Candidate::MoveIndicesToArray()
+{
+  Int_t i;
+
+  if(fNIndices <= 0) return;
+
+  if(!fArray) fArray = fFactory->NewArray();
+  for(i = 0; i < fNIndices; ++i) fArray->Add(fIndexedArray->UncheckedAt(fIndices[i]));
+  fIndexedArray = 0;
+  fIndices = 0;
+  fNIndices = 0;
+}
+
+//------------------------------------------------------------------------------
+
+void Candidate::SetECalEnergyTimePairs(const std::pair< Float_t, Float_t > *pairs, Int_t n)
+{
+  std::pair< Float_t, Float_t > *buffer = 0;
+
+  if(n > 0)
+  {
+    buffer = fFactory->NewEnergyTimePairs(n);
+    std::copy(pairs, pairs + n, buffer);
+  }
+
+  fECalEnergyTimePairs = buffer;
+  fNECalEnergyTimePairs = n > 0 ? n : 0;
+}
+
+//------------------------------------------------------------------------------
+
+Int_t Candidate::GetNumberOfCandidates() const
+{
+  if(fNIndices > 0) return fNIndices;
+  return fArray ? fArray->GetEntriesFast() : 0;
+}
+
+//------------------------------------------------------------------------------
+
+Candidate *Candidate::GetCandidate(Int_t i) const
+{
+  if(fNIndices > 0) return static_cast<Candidate *>(fIndexedArray->UncheckedAt(fIndices[i]));
+  return static_cast<Candidate *>(fArray->UncheckedAt(i));
+}
+
+//------------------------------------------------------------------------------
+
 Bool_t Candidate::Overlaps(const Candidate *object) const
 {
-  const Candidate *candidate;
+  Int_t i, n;
 
   if(object->GetUniqueID() == GetUniqueID()) return kTRUE;
 
-  if(fArray)
+  n = GetNumberOfCandidates();
+  for(i = 0; i < n; ++i)
   {
-    TIter it(fArray);
-    while((candidate = static_cast<Candidate *>(it.Next())))
-    {
-      if(candidate->Overlaps(object)) return kTRUE;
-    }
+    if(GetCandidate(i)->Overlaps(object)) return kTRUE;
   }
 
-  if(object->fArray)
+  n = object->GetNumberOfCandidates();
+  for(i = 0; i < n; ++i)
   {
-    TIter it(object->fArray);
-    while((candidate = static_cast<Candidate *>(it.Next())))
-    {
-      if(candidate->Overlaps(this)) return kTRUE;
-    }
+    if(object->GetCandidate(i)->Overlaps(this)) return kTRUE;
   }
 
   return kFALSE;
@@ -258,6 +515,21 @@ TObject *Candidate::Clone(const char *newname) const
 
 //------------------------------------------------------------------------------
 
+void Candidate::CollectUniqueIDs(std::vector< UInt_t > &ids) const
+{
+  Int_t i, n;
+
+  ids.push_back(GetUniqueID());
+
+  n = GetNumberOfCandidates();
+  for(i = 0; i < n; ++i)
+  {
+    GetCandidate(i)->CollectUniqueIDs(ids);
+  }
+}
+
+//------------------------------------------------------------------------------
+
 void Candidate::Copy(TObject &obj) const
 {
   Candidate &object = static_cast<Candidate &>(obj);
@@ -272,6 +544,7 @@ void Candidate::Copy(TObject &obj) const
   object.Charge = Charge;
   object.Mass = Mass;
   object.IsPU = IsPU;
+  object.VertexIndex = VertexIndex;
   object.IsConstituent = IsConstituent;
   object.IsFromConversion = IsFromConversion;
   object.Flavor = Flavor;
@@ -297,20 +570,7 @@ void Candidate::Copy(TObject &obj) const
   object.Xd = Xd;
   object.Yd = Yd;
   object.Zd = Zd;
-  object.primaryVertexTracks = primaryVertexTracks;
-  object.secondaryVertices = secondaryVertices;
-  object.hlSecVxTracks = hlSecVxTracks;
-  object.primaryVertex = primaryVertex;
-  object.hlSvx = hlSvx;
-  object.hlTrk = hlTrk;
-  object.truthVertices = truthVertices;
-
-  object.NCharged = NCharged;
-  object.NNeutrals = NNeutrals;
-  object.Beta = Beta;
-  object.BetaStar = BetaStar;
-  object.MeanSqDeltaR = MeanSqDeltaR;
-  object.PTD = PTD;
+
   object.NTimeHits = NTimeHits;
   object.IsolationVar = IsolationVar;
   object.IsolationVarRhoCorr = IsolationVarRhoCorr;
@@ -319,56 +579,53 @@ void Candidate::Copy(TObject &obj) const
   object.SumPtChargedPU = SumPtChargedPU;
   object.SumPt = SumPt;
 
-  object.FracPt[0] = FracPt[0];
-  object.FracPt[1] = FracPt[1];
-  object.FracPt[2] = FracPt[2];
-  object.FracPt[3] = FracPt[3];
-  object.FracPt[4] = FracPt[4];
-  object.Tau[0] = Tau[0];
-  object.Tau[1] = Tau[1];
-  object.Tau[2] = Tau[2];
-  object.Tau[3] = Tau[3];
-  object.Tau[4] = Tau[4];
   for(int i=0;i<5;i++)
    object.trkPar[i] = trkPar[i];
   for(int i=0;i<15;i++)
    object.trkCov[i] = trkCov[i];
 
-  object.TrimmedP4[0] = TrimmedP4[0];
-  object.TrimmedP4[1] = TrimmedP4[1];
-  object.TrimmedP4[2] = TrimmedP4[2];
-  object.TrimmedP4[3] = TrimmedP4[3];
-  object.TrimmedP4[4] = TrimmedP4[4];
-  object.PrunedP4[0] = PrunedP4[0];
-  object.PrunedP4[1] = PrunedP4[1];
-  object.PrunedP4[2] = PrunedP4[2];
-  object.PrunedP4[3] = PrunedP4[3];
-  object.PrunedP4[4] = PrunedP4[4];
-  object.SoftDroppedP4[0] = SoftDroppedP4[0];
-  object.SoftDroppedP4[1] = SoftDroppedP4[1];
-  object.SoftDroppedP4[2] = SoftDroppedP4[2];
-  object.SoftDroppedP4[3] = SoftDroppedP4[3];
-  object.SoftDroppedP4[4] = SoftDroppedP4[4];
-
-  object.NSubJetsTrimmed = NSubJetsTrimmed;
-  object.NSubJetsPruned = NSubJetsPruned;
-  object.NSubJetsSoftDropped = NSubJetsSoftDropped;
-
-  object.fFactory = fFactory;
+  // the indices live as long as the candidates of the same factory, a
+  // candidate outside of it gets its own array
+  Bool_t shareIndices = fNIndices > 0 && object.fFactory == fFactory;
+
+  // a candidate read from a file has no factory, the one it is copied to
+  // keeps its own
+  if(!object.fFactory) object.fFactory = fFactory;
   object.fArray = 0;
+  object.fIndexedArray = 0;
+  object.fIndices = 0;
+  object.fNIndices = 0;
   object.fSubjetArray = 0;
   object.fTrackArray = 0;
 
-  // copy cluster timing info
-  copy(ECalEnergyTimePairs.begin(), ECalEnergyTimePairs.end(), back_inserter(object.ECalEnergyTimePairs));
+  // the blocks are only copied when one of the two candidates changes them
+  ShareBlock(object.fSubstructure, object.fSpareSubstructure, fSubstructure);
+  ShareBlock(object.fPileUpJetID, object.fSparePileUpJetID, fPileUpJetID);
+  ShareBlock(object.fFlavorTagging, object.fSpareFlavorTagging, fFlavorTagging);
 
-  if(fArray && fArray->GetEntriesFast() > 0)
+  // copy cluster timing info, shared like the indices
+  if(fNECalEnergyTimePairs > 0 && object.fFactory == fFactory)
+  {
+    object.fECalEnergyTimePairs = fECalEnergyTimePairs;
+    object.fNECalEnergyTimePairs = fNECalEnergyTimePairs;
+  }
+  else
+  {
+    object.SetECalEnergyTimePairs(fECalEnergyTimePairs, fNECalEnergyTimePairs);
+  }
+
+  if(shareIndices)
+  {
+    object.fIndexedArray = fIndexedArray;
+    object.fIndices = fIndices;
+    object.fNIndices = fNIndices;
+  }
+  else if(GetNumberOfCandidates() > 0)
   {
-    TIter itArray(fArray);
     TObjArray *array = object.GetCandidates();
-    while((candidate = static_cast<Candidate *>(itArray.Next())))
+    for(Int_t i = 0; i < GetNumberOfCandidates(); ++i)
     {
-      array->Add(candidate);
+      array->Add(GetCandidate(i));
     }
   }
   if(fSubjetArray && fSubjetArray->GetEntriesFast() > 0)
@@ -395,7 +652,6 @@ void Candidate::Copy(TObject &obj) const
 
 void Candidate::Clear(Option_t* option)
 {
-  int i;
   SetUniqueID(0);
   ResetBit(kIsReferenced);
   PID = 0;
@@ -404,6 +660,7 @@ void Candidate::Clear(Option_t* option)
   Charge = 0;
   Mass = 0.0;
   IsPU = 0;
+  VertexIndex = 0;
   IsConstituent = 0;
   IsFromConversion = 0;
   Flavor = 0;
@@ -429,15 +686,8 @@ void Candidate::Clear(Option_t* option)
   Xd = 0.0;
   Yd = 0.0;
   Zd = 0.0;
-  NCharged = 0;
-  NNeutrals = 0;
-  Beta = 0.0;
-  BetaStar = 0.0;
-  MeanSqDeltaR = 0.0;
-  PTD = 0.0;
 
   NTimeHits = 0;
-  ECalEnergyTimePairs.clear();
 
   IsolationVar = -999;
   IsolationVarRhoCorr = -999;
@@ -446,40 +696,19 @@ void Candidate::Clear(Option_t* option)
   SumPtChargedPU = -999;
   SumPt = -999;
 
-  FracPt[0] = 0.0;
-  FracPt[1] = 0.0;
-  FracPt[2] = 0.0;
-  FracPt[3] = 0.0;
-  FracPt[4] = 0.0;
-  Tau[0] = 0.0;
-  Tau[1] = 0.0;
-  Tau[2] = 0.0;
-  Tau[3] = 0.0;
-  Tau[4] = 0.0;
   for(int i=0;i<5;i++)
    trkPar[i] = 0;
   for(int i=0;i<15;i++)
    trkCov[i] = 0;
-  primaryVertexTracks.clear();
-  secondaryVertices.clear();
-  primaryVertex.clear();
-  hlSecVxTracks.clear();
-  truthVertices.clear();
-  hlSvx = HighLevelSvx();
-  hlTrk = HighLevelTracking();
-
-  for(i = 0; i < 5; ++i)
-  {
-    TrimmedP4[i].SetXYZT(0.0, 0.0, 0.0, 0.0);
-    PrunedP4[i].SetXYZT(0.0, 0.0, 0.0, 0.0);
-    SoftDroppedP4[i].SetXYZT(0.0, 0.0, 0.0, 0.0);
-  }
 
-  NSubJetsTrimmed = 0;
-  NSubJetsPruned = 0;
-  NSubJetsSoftDropped = 0;
+  ReleaseBlocks();
 
   fArray = 0;
+  fIndexedArray = 0;
+  fIndices = 0;
+  fNIndices = 0;
+  fECalEnergyTimePairs = 0;
+  fNECalEnergyTimePairs = 0;
   fSubjetArray = 0;
   fTrackArray = 0;
 }
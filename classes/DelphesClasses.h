@@ -47,6 +47,10 @@
 #include <utility>
 #include <memory>
 
+#if !defined(__CINT__) && !defined(__CLING__)
+#include <atomic>
+#endif
+
 class DelphesFactory;
 struct HighLevelSvx;
 
@@ -462,6 +466,9 @@ public:
   Int_t NSubJetsPruned; // number of subjets pruned
   Int_t NSubJetsSoftDropped; // number of subjets soft-dropped
 
+  std::vector<TLorentzVector> SoftDroppedPointsP4; // SoftDropped Jet 4-momenta, one entry per (BetaSoftDrop, SymmetryCutSoftDrop) working point
+  std::vector<Int_t> NSubJetsSoftDroppedPoints; // number of subjets soft-dropped, one entry per working point
+
   TRefArray Constituents; // references to constituents
   TRefArray Particles; // references to generated particles
   TRefArray Subjets; // references to associated subjets
@@ -473,7 +480,7 @@ public:
   TLorentzVector P4() const;
   TLorentzVector Area;
 
-  ClassDef(Jet, 4)
+  ClassDef(Jet, 5)
 };
 
 //---------------------------------------------------------------------------
@@ -584,7 +591,98 @@ namespace TrackParam{
 
 }
 
+//---------------------------------------------------------------------------
+
+// number of candidates sharing a block, a clone shares the blocks of its
+// original until one of the two changes them, the count is not assigned
+// with the values of the block
+
+struct CandidateBlock
+{
+  CandidateBlock();
+  CandidateBlock(const CandidateBlock &);
+  CandidateBlock &operator=(const CandidateBlock &) { return *this; }
+
+#if !defined(__CINT__) && !defined(__CLING__)
+  std::atomic< Int_t > references;
+#endif
+};
+
+//---------------------------------------------------------------------------
+
+// jet substructure results, only allocated for the candidates that compute them
+
+struct CandidateSubstructure: public CandidateBlock
+{
+  CandidateSubstructure();
+
+  // back to the values of a new block, keeping the vector capacities
+  void Reset();
+
+  TLorentzVector TrimmedP4[5]; // first entry (i = 0) is the total Trimmed Jet 4-momenta and from i = 1 to 4 are the trimmed subjets 4-momenta
+  TLorentzVector PrunedP4[5]; // first entry (i = 0) is the total Pruned Jet 4-momenta and from i = 1 to 4 are the pruned subjets 4-momenta
+  TLorentzVector SoftDroppedP4[5]; // first entry (i = 0) is the total SoftDropped Jet 4-momenta and from i = 1 to 4 are the pruned subjets 4-momenta
+
+  Int_t NSubJetsTrimmed; // number of subjets trimmed
+  Int_t NSubJetsPruned; // number of subjets pruned
+  Int_t NSubJetsSoftDropped; // number of subjets soft-dropped
+
+  std::vector<TLorentzVector> SoftDroppedPointsP4; // SoftDropped Jet 4-momenta, one entry per (BetaSoftDrop, SymmetryCutSoftDrop) working point
+  std::vector<Int_t> NSubJetsSoftDroppedPoints; // number of subjets soft-dropped, one entry per working point
+
+  Float_t Tau[5]; // N-subjettiness with N = 1, ..., 5
+};
+
+//---------------------------------------------------------------------------
+
+// PileUpJetID variables, only allocated for the jets that PileUpJetID processes
+
+struct CandidatePileUpJetID: public CandidateBlock
+{
+  CandidatePileUpJetID();
+  void Reset();
+
+  Int_t NCharged;
+  Int_t NNeutrals;
+  Float_t Beta;
+  Float_t BetaStar;
+  Float_t MeanSqDeltaR;
+  Float_t PTD;
+  Float_t FracPt[5];
+};
+
+//---------------------------------------------------------------------------
 
+// flavour-tagging inputs and results, only allocated for the candidates that
+// the vertexing and tagging modules fill
+
+struct CandidateFlavorTagging: public CandidateBlock
+{
+  CandidateFlavorTagging();
+  void Reset();
+
+  // secondary vertex parameters
+  std::vector<SecondaryVertexTrack> primaryVertexTracks;
+  std::vector<SecondaryVertex> secondaryVertices;
+  // tracks along the jet of the secondary vertices, each vertex holds
+  // its range
+  std::vector<SecondaryVertexTrack> secondaryVertexTracks;
+  // tracks of the high level vertex, and its track table
+  std::vector<SecondaryVertexTrack> hlSecVxTracks;
+  // sloppy reuse of the secondary vertex structure for some primary
+  // vertex info
+  SecondaryVertex primaryVertex;
+  HighLevelSvx hlSvx;
+  HighLevelSvx mlSvx;
+  // 1 if the vertex fits ran out of time and used the fallback method
+  UInt_t svFitFallback;
+  // track-based b-tagging
+  HighLevelTracking hlTrk;
+  // truth vertices
+  std::vector<TruthVertex> truthVertices;
+};
+
+//---------------------------------------------------------------------------
 
 class Candidate: public SortableObject
 {
@@ -593,6 +691,7 @@ class Candidate: public SortableObject
 public:
 
   Candidate();
+  ~Candidate();
 
   Int_t PID;
 
@@ -606,6 +705,10 @@ public:
   Int_t IsPU;
   Int_t IsRecoPU;
 
+  // index of the vertex in the VertexOutputArray of PileUpMerger, zero for
+  // the hard scattering
+  Int_t VertexIndex;
+
   Int_t IsConstituent;
 
   Int_t IsFromConversion;
@@ -639,34 +742,9 @@ public:
   float trkPar[5];
   float trkCov[15];
 
-  // secondary vertex parameters
-  std::vector<SecondaryVertexTrack> primaryVertexTracks;
-  std::vector<SecondaryVertex> secondaryVertices;
-  std::vector<SecondaryVertexTrack> hlSecVxTracks;
-  // sloppy reuse of the secondary vertex structure for some primary
-  // vertex info
-  SecondaryVertex primaryVertex;
-  HighLevelSvx hlSvx;
-  HighLevelSvx mlSvx;
-  // track-based b-tagging
-  HighLevelTracking hlTrk;
-  // truth vertices
-  std::vector<TruthVertex> truthVertices;
-
-  // PileUpJetID variables
-
-  Int_t NCharged;
-  Int_t NNeutrals;
-  Float_t Beta;
-  Float_t BetaStar;
-  Float_t MeanSqDeltaR;
-  Float_t PTD;
-  Float_t FracPt[5];
-
   // Timing information
 
   Int_t NTimeHits;
-  std::vector< std::pair< Float_t, Float_t > > ECalEnergyTimePairs;
 
   // Isolation variables
 
@@ -677,35 +755,55 @@ public:
   Float_t SumPtChargedPU;
   Float_t SumPt;
 
-  // N-subjettiness variables
-
-  Float_t Tau[5];
-
-  // Other Substructure variables
-
-  TLorentzVector TrimmedP4[5]; // first entry (i = 0) is the total Trimmed Jet 4-momenta and from i = 1 to 4 are the trimmed subjets 4-momenta
-  TLorentzVector PrunedP4[5]; // first entry (i = 0) is the total Pruned Jet 4-momenta and from i = 1 to 4 are the pruned subjets 4-momenta
-  TLorentzVector SoftDroppedP4[5]; // first entry (i = 0) is the total SoftDropped Jet 4-momenta and from i = 1 to 4 are the pruned subjets 4-momenta
-
-  Int_t NSubJetsTrimmed; // number of subjets trimmed
-  Int_t NSubJetsPruned; // number of subjets pruned
-  Int_t NSubJetsSoftDropped; // number of subjets soft-dropped
-
-
   static CompBase *fgCompare; //!
   const CompBase *GetCompare() const { return fgCompare; }
 
   void AddCandidate(Candidate *object);
+
+  // for a candidate holding indices, see SetCandidates, a new array of the
+  // factory filled from them on every call, the candidate is left as it is
   TObjArray *GetCandidates();
 
+  // constituents given as entries of an input array: the indices are kept
+  // in a per-event buffer of the factory and are never changed by the
+  // readers, so that modules running at once can read the same jet
+  void SetCandidates(const TObjArray *array, const Int_t *indices, Int_t n);
+
+  // access to the constituents of either kind without an array
+  Int_t GetNumberOfCandidates() const;
+  Candidate *GetCandidate(Int_t i) const;
+
+  // energy and time of the ECAL hits of a tower, kept in a per-event buffer
+  // of the factory like the constituent indices
+  void SetECalEnergyTimePairs(const std::pair< Float_t, Float_t > *pairs, Int_t n);
+  Int_t GetNumberOfECalEnergyTimePairs() const { return fNECalEnergyTimePairs; }
+  const std::pair< Float_t, Float_t > &GetECalEnergyTimePair(Int_t i) const { return fECalEnergyTimePairs[i]; }
+
   void AddSubjet(Candidate *subjet);
   TObjArray *GetSubjets();
 
   void AddTrack(Candidate* track);
   TObjArray* GetTracks();
 
+  // other substructure variables, zero unless NewSubstructure was called,
+  // the New methods give a block of its own to a candidate sharing it
+  CandidateSubstructure *NewSubstructure();
+  const CandidateSubstructure *GetSubstructure() const { return fSubstructure; }
+
+  // PileUpJetID variables, zero unless NewPileUpJetID was called
+  CandidatePileUpJetID *NewPileUpJetID();
+  const CandidatePileUpJetID *GetPileUpJetID() const { return fPileUpJetID; }
+
+  // flavour-tagging payload, empty unless NewFlavorTagging was called
+  CandidateFlavorTagging *NewFlavorTagging();
+  const CandidateFlavorTagging *GetFlavorTagging() const { return fFlavorTagging; }
+
   Bool_t Overlaps(const Candidate *object) const;
 
+  // appends the unique IDs of the candidate and of all its constituents,
+  // two candidates overlap when these lists have an ID in common
+  void CollectUniqueIDs(std::vector< UInt_t > &ids) const;
+
   virtual void Copy(TObject &object) const;
   virtual TObject *Clone(const char *newname = "") const;
   virtual void Clear(Option_t* option = "");
@@ -713,12 +811,32 @@ public:
 private:
   DelphesFactory *fFactory; //!
   TObjArray *fArray; //!
+  const TObjArray *fIndexedArray; //!
+  const Int_t *fIndices; //!
+  Int_t fNIndices; //!
+  const std::pair< Float_t, Float_t > *fECalEnergyTimePairs; //!
+  Int_t fNECalEnergyTimePairs; //!
   TObjArray *fSubjetArray; //!
   TObjArray *fTrackArray; //!
+  CandidateSubstructure *fSubstructure; //!
+  CandidatePileUpJetID *fPileUpJetID; //!
+  CandidateFlavorTagging *fFlavorTagging; //!
+
+  // blocks released by Clear that no other candidate shares, handed out
+  // again by the New methods
+  CandidateSubstructure *fSpareSubstructure; //!
+  CandidatePileUpJetID *fSparePileUpJetID; //!
+  CandidateFlavorTagging *fSpareFlavorTagging; //!
 
   void SetFactory(DelphesFactory *factory) { fFactory = factory; }
 
-  ClassDef(Candidate, 3)
+  void ReleaseBlocks();
+
+  // moves the constituents held as indices into fArray, only done by
+  // AddCandidate and SetCandidates of the module that owns the candidate
+  void MoveIndicesToArray();
+
+  ClassDef(Candidate, 8)
 };
 
 #endif // DelphesClasses_h
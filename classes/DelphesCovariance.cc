@@ -0,0 +1,178 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/** \class DelphesCovariance
+ *
+ *  Compact forms of the 5x5 track covariance.
+ *
+ */
+
+#include "classes/DelphesCovariance.h"
+
+#include "TString.h"
+
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <sstream>
+
+using namespace std;
+
+namespace
+{
+
+const Int_t kSize = 5;
+
+// position of element (i, j), i >= j, in the lower triangle
+inline Int_t Index(Int_t i, Int_t j)
+{
+  return i*(i + 1)/2 + j;
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+
+Int_t DelphesCovariance::GetForm(const char *name)
+{
+  TString form(name);
+  stringstream message;
+
+  form.ToLower();
+  if(form == "plain") return kPlain;
+  if(form == "cholesky") return kCholesky;
+  if(form == "correlation") return kCorrelation;
+
+  message << "unknown covariance form '" << name << "', it must be Plain, Cholesky or Correlation";
+  throw runtime_error(message.str());
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesCovariance::Encode(const float *covariance, float *output, Int_t form, Int_t mantissaBits)
+{
+  Double_t values[15], sigma[kSize], sum;
+  Int_t i, j, k;
+
+  switch(form)
+  {
+    case kCholesky:
+      for(i = 0; i < kSize; ++i)
+      {
+        for(j = 0; j <= i; ++j)
+        {
+          sum = covariance[Index(i, j)];
+          for(k = 0; k < j; ++k) sum -= values[Index(i, k)]*values[Index(j, k)];
+          if(i == j)
+          {
+            values[Index(i, i)] = sum > 0.0 ? sqrt(sum) : 0.0;
+          }
+          else
+          {
+            values[Index(i, j)] = values[Index(j, j)] > 0.0 ? sum/values[Index(j, j)] : 0.0;
+          }
+        }
+      }
+      break;
+    case kCorrelation:
+      for(i = 0; i < kSize; ++i)
+      {
+        sum = covariance[Index(i, i)];
+        sigma[i] = sum > 0.0 ? sqrt(sum) : 0.0;
+      }
+      for(i = 0; i < kSize; ++i)
+      {
+        for(j = 0; j < i; ++j)
+        {
+          sum = sigma[i]*sigma[j];
+          values[Index(i, j)] = sum > 0.0 ? covariance[Index(i, j)]/sum : 0.0;
+        }
+        values[Index(i, i)] = sigma[i];
+      }
+      break;
+    default:
+      for(i = 0; i < 15; ++i) values[i] = covariance[i];
+      break;
+  }
+
+  for(i = 0; i < 15; ++i) output[i] = Truncate(values[i], mantissaBits);
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesCovariance::Decode(const float *input, float *covariance, Int_t form)
+{
+  Double_t values[15], sum;
+  Int_t i, j, k;
+
+  switch(form)
+  {
+    case kCholesky:
+      for(i = 0; i < kSize; ++i)
+      {
+        for(j = 0; j <= i; ++j)
+        {
+          sum = 0.0;
+          for(k = 0; k <= j; ++k) sum += Double_t(input[Index(i, k)])*input[Index(j, k)];
+          values[Index(i, j)] = sum;
+        }
+      }
+      break;
+    case kCorrelation:
+      for(i = 0; i < kSize; ++i)
+      {
+        for(j = 0; j < i; ++j)
+        {
+          values[Index(i, j)] = Double_t(input[Index(i, j)])*input[Index(i, i)]*input[Index(j, j)];
+        }
+        values[Index(i, i)] = Double_t(input[Index(i, i)])*input[Index(i, i)];
+      }
+      break;
+    default:
+      for(i = 0; i < 15; ++i) values[i] = input[i];
+      break;
+  }
+
+  for(i = 0; i < 15; ++i) covariance[i] = values[i];
+}
+
+//------------------------------------------------------------------------------
+
+float DelphesCovariance::Truncate(float value, Int_t mantissaBits)
+{
+  UInt_t bits, drop;
+
+  if(mantissaBits < 0 || mantissaBits >= 23) return value;
+
+  memcpy(&bits, &value, sizeof(bits));
+
+  // infinities and NaN
+  if(((bits >> 23) & 0xff) == 0xff) return value;
+
+  // round half away from zero, a carry into the exponent gives the next
+  // power of two, which is the nearest value
+  drop = 23 - mantissaBits;
+  bits += 1u << (drop - 1);
+  bits &= ~((1u << drop) - 1);
+
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,70 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DelphesCovariance_h
+#define DelphesCovariance_h
+
+/** \class DelphesCovariance
+ *
+ *  Compact forms of the 5x5 track covariance, stored as its lower
+ *  triangle in the order of Candidate::trkCov:
+ *
+ *    Plain       - the covariance itself
+ *    Cholesky    - the lower triangular L with L L^T the covariance,
+ *                  zero in the columns of non-positive pivots
+ *    Correlation - the standard deviations on the diagonal and the
+ *                  correlation coefficients elsewhere
+ *
+ *  With mantissaBits kept out of the 23 of a float every stored value
+ *  is rounded to the nearest, with a relative error below
+ *  2^-(mantissaBits + 1), and the zeroed low bits compress away. The
+ *  decoded elements are then off by less than about 2^-mantissaBits
+ *  times sigma_i sigma_j. Unlike the rounded covariance, a rounded
+ *  Cholesky factor always decodes to a positive semi-definite matrix.
+ *
+ */
+
+#include "Rtypes.h"
+
+class DelphesCovariance
+{
+public:
+
+  enum Form
+  {
+    kPlain = 0,
+    kCholesky,
+    kCorrelation
+  };
+
+  // form from its name in a configuration, throws for unknown names
+  static Int_t GetForm(const char *name);
+
+  // the 15 values of a covariance in the given form, rounded to
+  // mantissaBits, output may be the covariance itself
+  static void Encode(const float *covariance, float *output, Int_t form, Int_t mantissaBits = 23);
+
+  // the covariance from the output of Encode
+  static void Decode(const float *input, float *covariance, Int_t form);
+
+  // the nearest float with only the leading mantissaBits of its mantissa,
+  // infinities and NaN are left alone
+  static float Truncate(float value, Int_t mantissaBits);
+};
+
+#endif /* DelphesCovariance_h */
@@ -0,0 +1,176 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/** \class DelphesEtaPhiGrid
+ *
+ *  Per-event eta-phi binned index over an array of candidates.
+ *
+ */
+
+#include "classes/DelphesEtaPhiGrid.h"
+
+#include "classes/DelphesClasses.h"
+
+#include "TMath.h"
+#include "TVector2.h"
+#include "TObjArray.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+
+DelphesEtaPhiGrid::DelphesEtaPhiGrid(Double_t cellSize, Double_t etaMax) :
+  fEtaMax(etaMax)
+{
+  if(cellSize <= 0.0 || etaMax <= 0.0)
+  {
+    throw invalid_argument("eta-phi grid needs a positive cell size and eta range");
+  }
+  fNEta = max(1, Int_t(2.0*etaMax/cellSize));
+  fEtaWidth = 2.0*etaMax/fNEta;
+  fNPhi = max(1, Int_t(TMath::TwoPi()/cellSize));
+  fPhiWidth = TMath::TwoPi()/fNPhi;
+  fCells.resize(fNEta*fNPhi);
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesEtaPhiGrid::Clear()
+{
+  vector< vector<Int_t> >::iterator itCell;
+
+  fEntries.clear();
+  for(itCell = fCells.begin(); itCell != fCells.end(); ++itCell)
+  {
+    itCell->clear();
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesEtaPhiGrid::Fill(const TObjArray *array)
+{
+  Int_t i, n;
+  Entry entry;
+
+  Clear();
+
+  n = array->GetEntriesFast();
+  fEntries.reserve(n);
+  for(i = 0; i < n; ++i)
+  {
+    entry.candidate = static_cast<Candidate *>(array->At(i));
+    const TLorentzVector &momentum = entry.candidate->Momentum;
+    entry.pt = momentum.Pt();
+    entry.eta = momentum.Eta();
+    entry.phi = momentum.Phi();
+    entry.index = i;
+    fCells[EtaBin(entry.eta)*fNPhi + PhiBin(entry.phi)].push_back(fEntries.size());
+    fEntries.push_back(entry);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesEtaPhiGrid::Find(Double_t eta, Double_t phi, Double_t deltaR,
+  vector<const Entry *> &result) const
+{
+  Int_t etaFirst, etaLast, phiFirst, phiLast, etaBin, phiBin, nPhiBins;
+  vector<Int_t>::const_iterator itIndex;
+
+  result.clear();
+
+  etaFirst = EtaBin(eta - deltaR);
+  etaLast = EtaBin(eta + deltaR);
+
+  // number of cells on either side, capped so we never visit a cell twice
+  nPhiBins = Int_t(TMath::Ceil(deltaR/fPhiWidth));
+  if(2*nPhiBins + 1 >= fNPhi)
+  {
+    phiFirst = 0;
+    phiLast = fNPhi - 1;
+  }
+  else
+  {
+    phiFirst = PhiBin(phi) - nPhiBins;
+    phiLast = PhiBin(phi) + nPhiBins;
+  }
+
+  for(etaBin = etaFirst; etaBin <= etaLast; ++etaBin)
+  {
+    for(phiBin = phiFirst; phiBin <= phiLast; ++phiBin)
+    {
+      const vector<Int_t> &cell = fCells[etaBin*fNPhi + (phiBin + fNPhi) % fNPhi];
+      for(itIndex = cell.begin(); itIndex != cell.end(); ++itIndex)
+      {
+        const Entry &entry = fEntries[*itIndex];
+        if(DeltaR(eta, phi, entry.eta, entry.phi) <= deltaR) result.push_back(&entry);
+      }
+    }
+  }
+
+  // keep the input order, so results don't depend on the binning,
+  // the entries are stored in that order
+  sort(result.begin(), result.end());
+}
+
+//------------------------------------------------------------------------------
+
+Double_t DelphesEtaPhiGrid::DeltaR(Double_t eta1, Double_t phi1, Double_t eta2, Double_t phi2)
+{
+  // same as TLorentzVector::DeltaR
+  Double_t deta = eta1 - eta2;
+  Double_t dphi = TVector2::Phi_mpi_pi(phi1 - phi2);
+  return TMath::Sqrt(deta*deta + dphi*dphi);
+}
+
+//------------------------------------------------------------------------------
+
+Double_t DelphesEtaPhiGrid::DeltaR2(Double_t eta1, Double_t phi1, Double_t eta2, Double_t phi2)
+{
+  Double_t deta = eta1 - eta2;
+  Double_t dphi = TVector2::Phi_mpi_pi(phi1 - phi2);
+  return deta*deta + dphi*dphi;
+}
+
+//------------------------------------------------------------------------------
+
+Int_t DelphesEtaPhiGrid::EtaBin(Double_t eta) const
+{
+  // written so that NaN also goes to the first bin
+  if(!(eta > -fEtaMax)) return 0;
+  if(eta >= fEtaMax) return fNEta - 1;
+  Int_t bin = Int_t(TMath::Floor((eta + fEtaMax)/fEtaWidth));
+  return max(0, min(fNEta - 1, bin));
+}
+
+//------------------------------------------------------------------------------
+
+Int_t DelphesEtaPhiGrid::PhiBin(Double_t phi) const
+{
+  if(!(TMath::Abs(phi) <= TMath::Pi())) phi = TVector2::Phi_mpi_pi(phi);
+  if(!(TMath::Abs(phi) <= TMath::Pi())) return 0;
+  Int_t bin = Int_t(TMath::Floor((phi + TMath::Pi())/fPhiWidth));
+  return ((bin % fNPhi) + fNPhi) % fNPhi;
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,80 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DelphesEtaPhiGrid_h
+#define DelphesEtaPhiGrid_h
+
+/** \class DelphesEtaPhiGrid
+ *
+ *  Per-event eta-phi binned index over an array of candidates.
+ *  Pt, eta and phi are computed once when the grid is filled, and cone
+ *  searches only visit the cells that overlap the cone.
+ *
+ */
+
+#include "Rtypes.h"
+
+#include <vector>
+
+class TObjArray;
+class Candidate;
+
+class DelphesEtaPhiGrid
+{
+public:
+
+  struct Entry
+  {
+    Candidate *candidate;
+    Double_t pt;
+    Double_t eta;
+    Double_t phi;
+    Int_t index; // position in the input array
+  };
+
+  // cells are (at least) cellSize wide in eta and phi, candidates
+  // beyond etaMax go into the edge cells
+  DelphesEtaPhiGrid(Double_t cellSize = 0.4, Double_t etaMax = 5.0);
+
+  void Clear();
+  void Fill(const TObjArray *array);
+
+  // Entries with DeltaR <= deltaR from (eta, phi), in input array order.
+  // The result is written to `result`, which is cleared first.
+  void Find(Double_t eta, Double_t phi, Double_t deltaR,
+    std::vector<const Entry *> &result) const;
+
+  const std::vector<Entry> &GetEntries() const { return fEntries; }
+
+  static Double_t DeltaR(Double_t eta1, Double_t phi1, Double_t eta2, Double_t phi2);
+  static Double_t DeltaR2(Double_t eta1, Double_t phi1, Double_t eta2, Double_t phi2);
+
+private:
+
+  Int_t EtaBin(Double_t eta) const;
+  Int_t PhiBin(Double_t phi) const;
+
+  Double_t fEtaMax, fEtaWidth, fPhiWidth;
+  Int_t fNEta, fNPhi;
+
+  std::vector<Entry> fEntries;
+  // entry indices for each cell, cell = etaBin*fNPhi + phiBin
+  std::vector< std::vector<Int_t> > fCells;
+};
+
+#endif /* DelphesEtaPhiGrid_h */
@@ -0,0 +1,131 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/** \class DelphesEventIndex
+ *
+ *  Byte offsets of the events of a HepMC or STDHEP file.
+ *
+ */
+
+#include "classes/DelphesEventIndex.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <stdexcept>
+#include <sstream>
+
+using namespace std;
+
+static const char kIndexMagic[8] = {'D', 'I', 'N', 'D', 'E', 'X', '0', '1'};
+
+static const long long kIndexHeaderSize = 24;
+
+//------------------------------------------------------------------------------
+
+static void EncodeInteger(unsigned char *buffer, unsigned long long value)
+{
+  int i;
+  for(i = 0; i < 8; ++i) buffer[i] = (value >> (8*i)) & 0xFF;
+}
+
+//------------------------------------------------------------------------------
+
+static unsigned long long DecodeInteger(const unsigned char *buffer)
+{
+  unsigned long long value = 0;
+  int i;
+  for(i = 0; i < 8; ++i) value |= (unsigned long long)(buffer[i]) << (8*i);
+  return value;
+}
+
+//------------------------------------------------------------------------------
+
+string DelphesEventIndex::GetIndexFileName(const char *inputFileName)
+{
+  return string(inputFileName) + ".index";
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesEventIndex::Write(const char *fileName, long long inputLength) const
+{
+  stringstream message;
+  vector< long long >::const_iterator itOffsets;
+  unsigned char buffer[8];
+  FILE *file;
+  bool ok;
+
+  file = fopen(fileName, "wb");
+  if(!file)
+  {
+    message << "can't create index file " << fileName;
+    throw runtime_error(message.str());
+  }
+
+  ok = fwrite(kIndexMagic, 1, 8, file) == 8;
+
+  EncodeInteger(buffer, inputLength);
+  ok = ok && fwrite(buffer, 1, 8, file) == 8;
+
+  EncodeInteger(buffer, fOffsets.size());
+  ok = ok && fwrite(buffer, 1, 8, file) == 8;
+
+  for(itOffsets = fOffsets.begin(); itOffsets != fOffsets.end() && ok; ++itOffsets)
+  {
+    EncodeInteger(buffer, *itOffsets);
+    ok = fwrite(buffer, 1, 8, file) == 8;
+  }
+
+  if(fclose(file) != 0) ok = false;
+
+  if(!ok)
+  {
+    message << "can't write index file " << fileName;
+    throw runtime_error(message.str());
+  }
+}
+
+//------------------------------------------------------------------------------
+
+bool DelphesEventIndex::FindOffset(const char *inputFileName, long long inputLength,
+  long long event, long long &offset)
+{
+  string fileName = GetIndexFileName(inputFileName);
+  unsigned char header[kIndexHeaderSize], buffer[8];
+  FILE *file;
+  bool ok;
+
+  file = fopen(fileName.c_str(), "rb");
+  if(!file) return false;
+
+  ok = fread(header, 1, kIndexHeaderSize, file) == size_t(kIndexHeaderSize)
+    && memcmp(header, kIndexMagic, 8) == 0
+    && (long long)(DecodeInteger(header + 8)) == inputLength
+    && event >= 0 && (unsigned long long)(event) < DecodeInteger(header + 16)
+    && fseeko(file, kIndexHeaderSize + 8*event, SEEK_SET) == 0
+    && fread(buffer, 1, 8, file) == 8;
+
+  fclose(file);
+
+  if(ok) offset = DecodeInteger(buffer);
+  return ok;
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,62 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DelphesEventIndex_h
+#define DelphesEventIndex_h
+
+/** \class DelphesEventIndex
+ *
+ *  Byte offsets of the events of a HepMC or STDHEP file.
+ *
+ *  The index is kept next to the input file, with ".index" appended to its
+ *  name. It starts with the string "DINDEX01", the size of the input file
+ *  and the number of events, followed by the offset of every event, all
+ *  as 64-bit little-endian integers. The offset of an event is where the
+ *  reader stands once the previous event is complete, so the readers can
+ *  start at any event after seeking there.
+ *
+ */
+
+#include <string>
+#include <vector>
+
+class DelphesEventIndex
+{
+public:
+
+  static std::string GetIndexFileName(const char *inputFileName);
+
+  void Clear() { fOffsets.clear(); }
+
+  void AddEvent(long long offset) { fOffsets.push_back(offset); }
+
+  // input length is the size of the indexed file
+  void Write(const char *fileName, long long inputLength) const;
+
+  // offset of an event from the index of an input file, false if there is
+  // no index, if it has been made for a file of a different size or if
+  // the input has fewer events
+  static bool FindOffset(const char *inputFileName, long long inputLength,
+    long long event, long long &offset);
+
+private:
+
+  std::vector< long long > fOffsets;
+};
+
+#endif // DelphesEventIndex_h
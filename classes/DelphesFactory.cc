@@ -34,12 +34,41 @@
 #include "TClass.h"
 #include "TObjArray.h"
 
+#include <algorithm>
+#include <cmath>
+
 using namespace std;
 
+static const UInt_t kArenaBlockSize = 1024;
+
+static const Int_t kIndexBlockSize = 16384;
+
+static const Int_t kEnergyTimeBlockSize = 4096;
+
+// weight of an event in the running averages of the pool sizes, and the
+// room reserved above them
+static const Double_t kAverageWeight = 0.125;
+static const Double_t kReserveMargin = 1.25;
+
+static thread_local ULong64_t threadAllocations = 0;
+
+//------------------------------------------------------------------------------
+
+static Int_t ReserveSize(Double_t average)
+{
+  return Int_t(ceil(average*kReserveMargin));
+}
+
 //------------------------------------------------------------------------------
 
 DelphesFactory::DelphesFactory(const char *name) :
-  TNamed(name, ""), fObjArrays(0)
+  TNamed(name, ""), fObjArrays(0),
+  fCandidateBranch(0), fLastClass(0), fLastBranch(0),
+  fLocalObjectCount(kFALSE), fObjectCount(0),
+  fCandidateArena(kFALSE), fArenaSize(0), fArenaUsed(0),
+  fIndexBlock(0), fIndexUsed(0),
+  fEnergyTimeBlock(0), fEnergyTimeUsed(0), fKeepECalEnergyTimes(kFALSE), fPoolBudget(0),
+  fAveragedEvents(0), fArenaAverage(0.0), fThreadSafe(kFALSE), fTreeReferences(kTRUE), fEventRejected(kFALSE)
 {
   fObjArrays = new ExRootTreeBranch("PermanentObjArrays", TObjArray::Class(), 0);
 }
@@ -55,25 +84,201 @@ DelphesFactory::~DelphesFactory()
   {
     delete (itBranches->second);
   }
+
+  vector< Candidate* >::iterator itBlocks;
+  for(itBlocks = fArenaBlocks.begin(); itBlocks != fArenaBlocks.end(); ++itBlocks)
+  {
+    delete[] (*itBlocks);
+  }
+
+  vector< Int_t* >::iterator itIndexBlocks;
+  for(itIndexBlocks = fIndexBlocks.begin(); itIndexBlocks != fIndexBlocks.end(); ++itIndexBlocks)
+  {
+    delete[] (*itIndexBlocks);
+  }
+
+  vector< pair< Float_t, Float_t >* >::iterator itEnergyTimeBlocks;
+  for(itEnergyTimeBlocks = fEnergyTimeBlocks.begin(); itEnergyTimeBlocks != fEnergyTimeBlocks.end(); ++itEnergyTimeBlocks)
+  {
+    delete[] (*itEnergyTimeBlocks);
+  }
 }
 
 //------------------------------------------------------------------------------
 
 void DelphesFactory::Clear()
 {
-  set<TObject *>::iterator itPool;
+  // an event too large for the budget stays out of the averages
+  Bool_t release = fPoolBudget > 0 && GetPoolMemory() > fPoolBudget;
+  if(!release) UpdateAverages();
+
+  vector<TObject *>::iterator itPool;
   for(itPool = fPool.begin(); itPool != fPool.end(); ++itPool)
   {
     (*itPool)->Clear();
   }
 
-  TProcessID::SetObjectCount(0);
+  fObjectCount = 0;
+  fArenaSize = 0;
+  fIndexBlock = 0;
+  fIndexUsed = 0;
+  fEnergyTimeBlock = 0;
+  fEnergyTimeUsed = 0;
+  fKinematics.Reset();
+  fImpactParameters.Reset();
+  fEventRejected = kFALSE;
+  if(!fLocalObjectCount && fTreeReferences) TProcessID::SetObjectCount(0);
 
   map< const TClass*, ExRootTreeBranch* >::iterator itBranches;
   for(itBranches = fBranches.begin(); itBranches != fBranches.end(); ++itBranches)
   {
     itBranches->second->Clear();
   }
+
+  if(release) ReleasePools();
+  ReservePools();
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesFactory::UpdateAverages()
+{
+  // the first event sets the averages
+  Double_t weight = fAveragedEvents > 0 ? kAverageWeight : 1.0;
+  UInt_t i;
+
+  fArrayAverages.resize(fPool.size(), 0.0);
+  for(i = 0; i < fPool.size(); ++i)
+  {
+    fArrayAverages[i] += weight*(static_cast< TObjArray * >(fPool[i])->GetEntriesFast() - fArrayAverages[i]);
+  }
+
+  map< const TClass*, ExRootTreeBranch* >::iterator itBranches;
+  for(itBranches = fBranches.begin(); itBranches != fBranches.end(); ++itBranches)
+  {
+    Double_t &average = fBranchAverages[itBranches->first];
+    average += weight*(itBranches->second->GetSize() - average);
+  }
+
+  fArenaAverage += weight*(fArenaSize - fArenaAverage);
+
+  ++fAveragedEvents;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesFactory::ReservePools()
+{
+  TObjArray *array;
+  UInt_t i, blocks;
+  Int_t size;
+
+  // the arrays and pools only grow, so this does nothing once they have
+  // reached the sizes of the usual events
+  for(i = 0; i < fArrayAverages.size(); ++i)
+  {
+    array = static_cast< TObjArray * >(fPool[i]);
+    size = ReserveSize(fArrayAverages[i]);
+    if(array->GetSize() < size) array->Expand(size);
+  }
+
+  map< const TClass*, ExRootTreeBranch* >::iterator itBranches;
+  for(itBranches = fBranches.begin(); itBranches != fBranches.end(); ++itBranches)
+  {
+    itBranches->second->Reserve(ReserveSize(fBranchAverages[itBranches->first]));
+  }
+
+  if(fCandidateArena)
+  {
+    blocks = (ReserveSize(fArenaAverage) + kArenaBlockSize - 1)/kArenaBlockSize;
+    while(fArenaBlocks.size() < blocks)
+    {
+      fArenaBlocks.push_back(new Candidate[kArenaBlockSize]);
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+Long64_t DelphesFactory::GetPoolMemory() const
+{
+  Long64_t memory = 0;
+  UInt_t i;
+
+  map< const TClass*, ExRootTreeBranch* >::const_iterator itBranches;
+  for(itBranches = fBranches.begin(); itBranches != fBranches.end(); ++itBranches)
+  {
+    memory += Long64_t(itBranches->second->GetCapacity())*itBranches->first->Size();
+  }
+
+  for(i = 0; i < fPool.size(); ++i)
+  {
+    memory += Long64_t(static_cast< TObjArray * >(fPool[i])->GetSize())*sizeof(TObject *);
+  }
+
+  memory += Long64_t(fArenaBlocks.size())*kArenaBlockSize*sizeof(Candidate);
+
+  for(i = 0; i < fIndexBlockSizes.size(); ++i)
+  {
+    memory += Long64_t(fIndexBlockSizes[i])*sizeof(Int_t);
+  }
+
+  for(i = 0; i < fEnergyTimeBlockSizes.size(); ++i)
+  {
+    memory += Long64_t(fEnergyTimeBlockSizes[i])*sizeof(pair< Float_t, Float_t >);
+  }
+
+  return memory;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesFactory::ReleasePools()
+{
+  TObjArray *array;
+  UInt_t i, blocks;
+  Int_t size;
+
+  // the objects of the event are all cleared by now, the permanent arrays
+  // are empty and their own pool is kept, as the modules hold them, what
+  // the usual events need is kept
+  map< const TClass*, ExRootTreeBranch* >::iterator itBranches;
+  for(itBranches = fBranches.begin(); itBranches != fBranches.end(); ++itBranches)
+  {
+    itBranches->second->Shrink(ReserveSize(fBranchAverages[itBranches->first]));
+  }
+
+  for(i = 0; i < fPool.size(); ++i)
+  {
+    array = static_cast< TObjArray * >(fPool[i]);
+    size = i < fArrayAverages.size() ? ReserveSize(fArrayAverages[i]) : 0;
+    size = max(size, Int_t(TCollection::kInitCapacity));
+    if(array->GetSize() > size) array->Expand(size);
+  }
+
+  // at least the first arena block stays, its candidates are cleared when
+  // handed out
+  blocks = max(1u, (ReserveSize(fArenaAverage) + kArenaBlockSize - 1)/kArenaBlockSize);
+  for(i = blocks; i < fArenaBlocks.size(); ++i)
+  {
+    delete[] fArenaBlocks[i];
+  }
+  if(fArenaBlocks.size() > blocks) fArenaBlocks.resize(blocks);
+  fArenaUsed = min(fArenaUsed, blocks*kArenaBlockSize);
+
+  for(i = 0; i < fIndexBlocks.size(); ++i)
+  {
+    delete[] fIndexBlocks[i];
+  }
+  fIndexBlocks.clear();
+  fIndexBlockSizes.clear();
+
+  for(i = 0; i < fEnergyTimeBlocks.size(); ++i)
+  {
+    delete[] fEnergyTimeBlocks[i];
+  }
+  fEnergyTimeBlocks.clear();
+  fEnergyTimeBlockSizes.clear();
 }
 
 //------------------------------------------------------------------------------
@@ -81,17 +286,83 @@ void DelphesFactory::Clear()
 TObjArray *DelphesFactory::NewPermanentArray()
 {
   TObjArray *array = static_cast<TObjArray *>(fObjArrays->NewEntry());
-  fPool.insert(array);
+  fPool.push_back(array);
   return array;
 }
 
 //------------------------------------------------------------------------------
 
+Double_t *DelphesFactory::NewWeightBlock(const TObjArray *array, Int_t n)
+{
+  vector< Double_t > &block = fWeightBlocks[array];
+  block.assign(n > 0 ? n : 0, 1.0);
+  return block.data();
+}
+
+//------------------------------------------------------------------------------
+
+const Double_t *DelphesFactory::GetWeightBlock(const TObjArray *array, Int_t &n) const
+{
+  map< const TObjArray*, vector< Double_t > >::const_iterator itBlocks;
+
+  itBlocks = fWeightBlocks.find(array);
+  if(itBlocks == fWeightBlocks.end() || itBlocks->second.empty())
+  {
+    n = 0;
+    return 0;
+  }
+
+  n = itBlocks->second.size();
+  return itBlocks->second.data();
+}
+
+//------------------------------------------------------------------------------
+
 Candidate *DelphesFactory::NewCandidate()
 {
-  Candidate *object = New<Candidate>();
+  Candidate *object;
+  UInt_t block, index;
+
+  unique_lock< mutex > lock(fMutex, defer_lock);
+  if(fThreadSafe) lock.lock();
+
+  ++threadAllocations;
+
+  if(fCandidateArena)
+  {
+    block = fArenaSize / kArenaBlockSize;
+    index = fArenaSize % kArenaBlockSize;
+    if(block == fArenaBlocks.size())
+    {
+      fArenaBlocks.push_back(new Candidate[kArenaBlockSize]);
+    }
+    object = &fArenaBlocks[block][index];
+
+    // candidates above the high-water mark are still freshly constructed
+    if(fArenaSize < fArenaUsed) object->Clear();
+    else fArenaUsed = fArenaSize + 1;
+
+    ++fArenaSize;
+  }
+  else
+  {
+    if(!fCandidateBranch) fCandidateBranch = GetBranch(Candidate::Class());
+    object = static_cast<Candidate *>(fCandidateBranch->NewEntry());
+    object->Clear();
+  }
+
   object->SetFactory(this);
-  TProcessID::AssignID(object);
+  if(fLocalObjectCount || fCandidateArena || !fTreeReferences)
+  {
+    // same numbering as TProcessID::AssignID, the candidates are registered
+    // when the output entries reference them
+    object->SetUniqueID(++fObjectCount);
+    if(fTreeReferences) object->SetBit(kIsReferenced);
+  }
+  else
+  {
+    TProcessID::AssignID(object);
+  }
   return object;
 }
 
@@ -100,6 +371,27 @@ Candidate *DelphesFactory::NewCandidate()
 TObject *DelphesFactory::New(TClass *cl)
 {
   TObject *object = 0;
+
+  unique_lock< mutex > lock(fMutex, defer_lock);
+  if(fThreadSafe) lock.lock();
+
+  ++threadAllocations;
+
+  if(cl != fLastClass)
+  {
+    fLastBranch = GetBranch(cl);
+    fLastClass = cl;
+  }
+
+  object = fLastBranch->NewEntry();
+  object->Clear();
+  return object;
+}
+
+//------------------------------------------------------------------------------
+
+ExRootTreeBranch *DelphesFactory::GetBranch(TClass *cl)
+{
   ExRootTreeBranch *branch = 0;
   map<const TClass *, ExRootTreeBranch *>::iterator it = fBranches.find(cl);
 
@@ -113,10 +405,68 @@ TObject *DelphesFactory::New(TClass *cl)
     fBranches.insert(make_pair(cl, branch));
   }
 
-  object = branch->NewEntry();
-  object->Clear();
-  return object;
+  return branch;
+}
+
+//------------------------------------------------------------------------------
+
+Int_t *DelphesFactory::NewIndices(Int_t n)
+{
+  Int_t *indices;
+
+  unique_lock< mutex > lock(fMutex, defer_lock);
+  if(fThreadSafe) lock.lock();
+
+  // the indices handed out must never move, so a span that doesn't fit
+  // goes to the next block rather than growing this one
+  while(fIndexBlock < fIndexBlocks.size() && fIndexUsed + n > fIndexBlockSizes[fIndexBlock])
+  {
+    ++fIndexBlock;
+    fIndexUsed = 0;
+  }
+
+  if(fIndexBlock == fIndexBlocks.size())
+  {
+    fIndexBlocks.push_back(new Int_t[max(n, kIndexBlockSize)]);
+    fIndexBlockSizes.push_back(max(n, kIndexBlockSize));
+  }
+
+  indices = fIndexBlocks[fIndexBlock] + fIndexUsed;
+  fIndexUsed += n;
+  return indices;
 }
 
 //------------------------------------------------------------------------------
 
+pair< Float_t, Float_t > *DelphesFactory::NewEnergyTimePairs(Int_t n)
+{
+  pair< Float_t, Float_t > *pairs;
+
+  unique_lock< mutex > lock(fMutex, defer_lock);
+  if(fThreadSafe) lock.lock();
+
+  while(fEnergyTimeBlock < fEnergyTimeBlocks.size() && fEnergyTimeUsed + n > fEnergyTimeBlockSizes[fEnergyTimeBlock])
+  {
+    ++fEnergyTimeBlock;
+    fEnergyTimeUsed = 0;
+  }
+
+  if(fEnergyTimeBlock == fEnergyTimeBlocks.size())
+  {
+    fEnergyTimeBlocks.push_back(new pair< Float_t, Float_t >[max(n, kEnergyTimeBlockSize)]);
+    fEnergyTimeBlockSizes.push_back(max(n, kEnergyTimeBlockSize));
+  }
+
+  pairs = fEnergyTimeBlocks[fEnergyTimeBlock] + fEnergyTimeUsed;
+  fEnergyTimeUsed += n;
+  return pairs;
+}
+
+//------------------------------------------------------------------------------
+
+ULong64_t DelphesFactory::GetThreadAllocations()
+{
+  return threadAllocations;
+}
+
+//------------------------------------------------------------------------------
@@ -31,8 +31,16 @@
 #include "TNamed.h"
 
 #include <map>
-#include <set>
+#include <vector>
 
+#if !defined(__CINT__) && !defined(__CLING__)
+#include <mutex>
+
+#include "classes/DelphesImpactParameters.h"
+#include "classes/DelphesKinematics.h"
+#endif
+
+class TClass;
 class TObjArray;
 class Candidate;
 
@@ -45,6 +53,8 @@ public:
   DelphesFactory(const char *name = "ObjectFactory");
   ~DelphesFactory();
 
+  // clears the objects of the event and reserves room for the next one,
+  // from the average sizes of the arrays and pools over the events
   void Clear();
  
   TObjArray *NewPermanentArray();
@@ -55,18 +65,144 @@ public:
 
   TObject *New(TClass *cl);
 
+  // room for n indices, valid until Clear; the blocks holding them are kept
+  // from one event to the next
+  Int_t *NewIndices(Int_t n);
+
+  // room for the energy and time of n ECAL hits, kept in the same way
+  std::pair< Float_t, Float_t > *NewEnergyTimePairs(Int_t n);
+
+  // set by the modules that read the ECAL hits of the towers, without them
+  // the calorimeters only keep the tower time
+  void SetKeepECalEnergyTimes(Bool_t value) { fKeepECalEnergyTimes = value; }
+  Bool_t GetKeepECalEnergyTimes() const { return fKeepECalEnergyTimes; }
+
+#if !defined(__CINT__) && !defined(__CLING__)
+  // px, py, pz, E, pt, eta and phi of the candidates of an array as float
+  // arrays, built once and shared by the modules until Clear, the array
+  // growing or InvalidateKinematics, see DelphesKinematics
+  const DelphesKinematics::View &GetKinematics(const TObjArray *array) { return fKinematics.Get(array); }
+  void InvalidateKinematics(const TObjArray *array)
+  {
+    fKinematics.Invalidate(array);
+    fImpactParameters.Invalidate(array);
+  }
+
+  // eta-phi index of an array for the cone searches, shared in the same way
+  const DelphesEtaPhiGrid &GetEtaPhiGrid(const TObjArray *array) { return fKinematics.GetGrid(array); }
+
+  // signed impact parameter significances of the tracks within deltaR of
+  // the jets, from the track array or the tracks attached to the jets when
+  // it is null, shared in the same way, see DelphesImpactParameters
+  const DelphesImpactParameters::Table &GetImpactParameters(const TObjArray *jets, const TObjArray *tracks, Double_t deltaR)
+  {
+    return fImpactParameters.Get(jets, tracks, tracks ? &GetEtaPhiGrid(tracks) : 0, deltaR);
+  }
+
+  // n weights of the events next to an exported array, created by its module
+  // in Init and filled in every event, so that the writers read them without
+  // a candidate per weight, see Weighter
+  Double_t *NewWeightBlock(const TObjArray *array, Int_t n);
+
+  // block of an array and its size, null when there is none
+  const Double_t *GetWeightBlock(const TObjArray *array, Int_t &n) const;
+#endif
+
   template<typename T>
   T *New() { return static_cast<T *>(New(T::Class())); }
 
+  // number the candidates of each event in this factory instead of with the
+  // global TProcessID counter, needed when several factories run at once
+  void SetLocalObjectCount(Bool_t value) { fLocalObjectCount = value; }
+
+  // keep the candidates in blocks owned by the factory, Clear rewinds the
+  // arena and a candidate is only reset when it is handed out again
+  void SetCandidateArena(Bool_t value) { fCandidateArena = value; }
+
+  // without an output tree no TRef points to the candidates, they are then
+  // numbered by the factory and TProcessID is left alone
+  void SetTreeReferences(Bool_t value) { fTreeReferences = value; }
+
+  // after an event whose pools take more than this many bytes, Clear
+  // releases them and they grow again from their initial sizes, so that one
+  // very large event does not hold its memory for the rest of the job, zero
+  // keeps them
+  void SetPoolBudget(Long64_t bytes) { fPoolBudget = bytes; }
+
+  // estimate of the memory held by the objects, arrays and buffers of the
+  // factory, without the memory the objects allocate themselves
+  Long64_t GetPoolMemory() const;
+
+  // number of objects handed out by all factories on the calling thread
+  static ULong64_t GetThreadAllocations();
+
+  // set by a module that drops the event, the following modules are then
+  // skipped and the event is not written, Clear resets it
+  void RejectEvent() { fEventRejected = kTRUE; }
+  Bool_t IsEventRejected() const { return fEventRejected; }
+
+  // serialize the allocations when several modules of the same event run
+  // at once, see DelphesModuleScheduler
+  void SetThreadSafe(Bool_t value) { fThreadSafe = value; }
+
 private:
 
+  ExRootTreeBranch *GetBranch(TClass *cl);
+
+  void ReleasePools();
+
+  void UpdateAverages();
+  void ReservePools();
+
   ExRootTreeBranch *fObjArrays; //!
 
+  // direct branch for candidates and the branch of the last class requested
+  ExRootTreeBranch *fCandidateBranch; //!
+  const TClass *fLastClass; //!
+  ExRootTreeBranch *fLastBranch; //!
+
+  Bool_t fLocalObjectCount; //!
+  UInt_t fObjectCount; //!
+
+  Bool_t fCandidateArena; //!
+  std::vector< Candidate* > fArenaBlocks; //!
+  UInt_t fArenaSize, fArenaUsed; //!
+
+  std::vector< Int_t* > fIndexBlocks; //!
+  std::vector< Int_t > fIndexBlockSizes; //!
+  UInt_t fIndexBlock; //!
+  Int_t fIndexUsed; //!
+
+  std::vector< std::pair< Float_t, Float_t >* > fEnergyTimeBlocks; //!
+  std::vector< Int_t > fEnergyTimeBlockSizes; //!
+  UInt_t fEnergyTimeBlock; //!
+  Int_t fEnergyTimeUsed; //!
+
+  Bool_t fKeepECalEnergyTimes; //!
+
+  Long64_t fPoolBudget; //!
+
+  // running averages of the sizes reached in the events, see Clear
+  Long64_t fAveragedEvents; //!
+  std::vector< Double_t > fArrayAverages; //!
+  Double_t fArenaAverage; //!
+
+  Bool_t fThreadSafe; //!
+
+  Bool_t fTreeReferences; //!
+
+  Bool_t fEventRejected; //!
+
 #if !defined(__CINT__) && !defined(__CLING__)
   std::map< const TClass*, ExRootTreeBranch* > fBranches; //!
+  std::map< const TClass*, Double_t > fBranchAverages; //!
+  std::mutex fMutex; //!
+  DelphesKinematics fKinematics; //!
+  DelphesImpactParameters fImpactParameters; //!
+  std::map< const TObjArray*, std::vector< Double_t > > fWeightBlocks; //!
 #endif
 
-  std::set< TObject* > fPool; //!
+  std::vector< TObject* > fPool; //!
   
   ClassDef(DelphesFactory, 1)
 };
@@ -16,26 +16,1147 @@
  *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-
 #include "classes/DelphesFormula.h"
 
+#include "TMath.h"
 #include "TString.h"
 
+#include <algorithm>
+#include <map>
 #include <stdexcept>
+#include <sstream>
+#include <memory>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
 
 using namespace std;
 
 //------------------------------------------------------------------------------
 
+/** \class DelphesFormulaProgram
+ *
+ *  Expression of x, y, z and t (pt, eta, phi and energy) translated into
+ *  instructions of a small stack machine, with the constant parts folded.
+ *
+ *  A piecewise formula, a sum of terms multiplied by conditions like
+ *  (abs(eta) <= 1.5) * (pt > 1.0 && pt <= 1.0e1), also gets a table of
+ *  the terms that can be non-zero between the boundaries of the
+ *  conditions, so that Eval only computes those. A term whose condition
+ *  is false contributes zero even when its value is not finite.
+ *
+ */
+
+class DelphesFormulaProgram
+{
+public:
+
+  Bool_t Compile(const char *expression);
+
+  Double_t Eval(const Double_t *x) const;
+
+  Bool_t IsConstant() const { return fEnd - fBegin == 1 && fCode[fBegin].code == kConstant; }
+
+  // C++ expression of x[0] to x[3] with the same value, see card2cxx
+  Bool_t Translate(const char *expression, string &code);
+
+private:
+
+  enum Code
+  {
+    kConstant, kVariable,
+    kNegate, kNot, kFunction1,
+    kAdd, kSubtract, kMultiply, kDivide, kPower,
+    kLess, kLessEqual, kGreater, kGreaterEqual, kEqual, kNotEqual,
+    kAnd, kOr, kFunction2
+  };
+
+  struct Instruction
+  {
+    Code code;
+    Double_t value;
+    Int_t index;
+    Double_t (*function1)(Double_t);
+    Double_t (*function2)(Double_t, Double_t);
+  };
+
+  struct Node
+  {
+    Instruction instruction;
+    unique_ptr< Node > left, right;
+  };
+
+  // variables and their absolute values
+  static const Int_t kNumberOfAxes = 8;
+
+  struct Interval
+  {
+    Double_t lower, upper;
+    Bool_t lowerClosed, upperClosed;
+  };
+
+  struct Term
+  {
+    Int_t begin, end;
+    Interval intervals[kNumberOfAxes];
+  };
+
+  static const Int_t kMaxDepth = 64;
+  static const Int_t kMaxCells = 65536;
+
+  static Double_t Apply(const Instruction &instruction, Double_t a, Double_t b);
+
+  unique_ptr< Node > MakeNode(Code code, unique_ptr< Node > left, unique_ptr< Node > right = unique_ptr< Node >());
+
+  unique_ptr< Node > ParseOr();
+  unique_ptr< Node > ParseAnd();
+  unique_ptr< Node > ParseEquality();
+  unique_ptr< Node > ParseRelation();
+  unique_ptr< Node > ParseSum();
+  unique_ptr< Node > ParseProduct();
+  unique_ptr< Node > ParseUnary();
+  unique_ptr< Node > ParsePower();
+  unique_ptr< Node > ParsePrimary();
+  unique_ptr< Node > ParseCall(const string &name);
+
+  Bool_t Match(const char *token);
+
+  void Emit(const Node *node, Int_t &depth, Int_t &maxDepth);
+
+  static Bool_t IsCondition(const Node *node);
+  static Bool_t Write(const Node *node, ostream &out);
+
+  Bool_t GetAxis(const Node *node, Int_t &axis) const;
+  Bool_t AddCondition(const Node *node, Interval *intervals) const;
+  void BuildTable(const Node *root);
+
+  Double_t Execute(Int_t begin, Int_t end, const Double_t *x) const;
+
+  const char *fPosition;
+
+  vector< Instruction > fCode;
+  Int_t fBegin, fEnd;
+
+  vector< Term > fTerms;
+  vector< Int_t > fAxes;
+  vector< vector< Double_t > > fBreaks;
+  vector< Int_t > fCells, fCellTerms;
+};
+
+//------------------------------------------------------------------------------
+
+// abs is named so that BuildTable can recognise conditions on abs(eta)
+static Double_t Abs(Double_t x)
+{
+  return TMath::Abs(x);
+}
+
+// the last column is the C++ call written by Translate
+static const struct
+{
+  const char *name;
+  Double_t (*function)(Double_t);
+  const char *code;
+} kFunctions1[] =
+{
+  {"abs", Abs, "TMath::Abs"}, {"fabs", Abs, "TMath::Abs"}, {"TMath::Abs", Abs, "TMath::Abs"},
+  {"sqrt", [](Double_t x) { return TMath::Sqrt(x); }, "TMath::Sqrt"},
+  {"TMath::Sqrt", [](Double_t x) { return TMath::Sqrt(x); }, "TMath::Sqrt"},
+  {"exp", [](Double_t x) { return TMath::Exp(x); }, "TMath::Exp"},
+  {"TMath::Exp", [](Double_t x) { return TMath::Exp(x); }, "TMath::Exp"},
+  {"log", [](Double_t x) { return TMath::Log(x); }, "TMath::Log"},
+  {"TMath::Log", [](Double_t x) { return TMath::Log(x); }, "TMath::Log"},
+  {"log10", [](Double_t x) { return TMath::Log10(x); }, "TMath::Log10"},
+  {"TMath::Log10", [](Double_t x) { return TMath::Log10(x); }, "TMath::Log10"},
+  {"sin", [](Double_t x) { return TMath::Sin(x); }, "TMath::Sin"},
+  {"cos", [](Double_t x) { return TMath::Cos(x); }, "TMath::Cos"},
+  {"tan", [](Double_t x) { return TMath::Tan(x); }, "TMath::Tan"},
+  {"asin", [](Double_t x) { return TMath::ASin(x); }, "TMath::ASin"},
+  {"acos", [](Double_t x) { return TMath::ACos(x); }, "TMath::ACos"},
+  {"atan", [](Double_t x) { return TMath::ATan(x); }, "TMath::ATan"},
+  {"sinh", [](Double_t x) { return TMath::SinH(x); }, "TMath::SinH"},
+  {"cosh", [](Double_t x) { return TMath::CosH(x); }, "TMath::CosH"},
+  {"tanh", [](Double_t x) { return TMath::TanH(x); }, "TMath::TanH"},
+  {"TMath::TanH", [](Double_t x) { return TMath::TanH(x); }, "TMath::TanH"}
+};
+
+static const struct
+{
+  const char *name;
+  Double_t (*function)(Double_t, Double_t);
+  const char *code;
+} kFunctions2[] =
+{
+  {"pow", [](Double_t x, Double_t y) { return TMath::Power(x, y); }, "TMath::Power"},
+  {"TMath::Power", [](Double_t x, Double_t y) { return TMath::Power(x, y); }, "TMath::Power"},
+  {"atan2", [](Double_t x, Double_t y) { return TMath::ATan2(x, y); }, "TMath::ATan2"},
+  {"TMath::ATan2", [](Double_t x, Double_t y) { return TMath::ATan2(x, y); }, "TMath::ATan2"},
+  {"min", [](Double_t x, Double_t y) { return TMath::Min(x, y); }, "TMath::Min"},
+  {"TMath::Min", [](Double_t x, Double_t y) { return TMath::Min(x, y); }, "TMath::Min"},
+  {"max", [](Double_t x, Double_t y) { return TMath::Max(x, y); }, "TMath::Max"},
+  {"TMath::Max", [](Double_t x, Double_t y) { return TMath::Max(x, y); }, "TMath::Max"}
+};
+
+//------------------------------------------------------------------------------
+
+Bool_t DelphesFormulaProgram::Compile(const char *expression)
+{
+  unique_ptr< Node > root;
+  Int_t depth = 0, maxDepth = 0;
+
+  fPosition = expression;
+
+  try
+  {
+    root = ParseOr();
+    if(*fPosition != '\0') throw runtime_error("unexpected character");
+  }
+  catch(runtime_error &e)
+  {
+    return kFALSE;
+  }
+
+  Emit(root.get(), depth, maxDepth);
+  fBegin = 0;
+  fEnd = fCode.size();
+
+  BuildTable(root.get());
+
+  return maxDepth <= kMaxDepth;
+}
+
+//------------------------------------------------------------------------------
+
+Bool_t DelphesFormulaProgram::Translate(const char *expression, string &code)
+{
+  unique_ptr< Node > root;
+  stringstream out;
+
+  fPosition = expression;
+
+  try
+  {
+    root = ParseOr();
+    if(*fPosition != '\0') throw runtime_error("unexpected character");
+  }
+  catch(runtime_error &e)
+  {
+    return kFALSE;
+  }
+
+  out.precision(17);
+  if(!Write(root.get(), out)) return kFALSE;
+
+  code = out.str();
+  return kTRUE;
+}
+
+//------------------------------------------------------------------------------
+
+Double_t DelphesFormulaProgram::Eval(const Double_t *x) const
+{
+  vector< Double_t >::const_iterator itBreaks;
+  Int_t axis, cell, segment, i;
+  Double_t value, result;
+
+  if(fCells.empty()) return Execute(fBegin, fEnd, x);
+
+  cell = 0;
+  for(axis = 0; axis < Int_t(fAxes.size()); ++axis)
+  {
+    value = x[fAxes[axis] / 2];
+    if(fAxes[axis] % 2) value = TMath::Abs(value);
+    if(TMath::IsNaN(value)) return Execute(fBegin, fEnd, x);
+
+    // segments alternate between the open intervals and the boundaries
+    const vector< Double_t > &breaks = fBreaks[axis];
+    itBreaks = lower_bound(breaks.begin(), breaks.end(), value);
+    segment = 2 * (itBreaks - breaks.begin());
+    if(itBreaks != breaks.end() && *itBreaks == value) ++segment;
+
+    cell = cell * (2 * breaks.size() + 1) + segment;
+  }
+
+  result = 0.0;
+  for(i = fCells[cell]; i < fCells[cell + 1]; ++i)
+  {
+    const Term &term = fTerms[fCellTerms[i]];
+    result += Execute(term.begin, term.end, x);
+  }
+
+  return result;
+}
+
+//------------------------------------------------------------------------------
+
+Double_t DelphesFormulaProgram::Apply(const Instruction &instruction, Double_t a, Double_t b)
+{
+  switch(instruction.code)
+  {
+    case kNegate: return -a;
+    case kNot: return !a;
+    case kFunction1: return instruction.function1(a);
+    case kAdd: return a + b;
+    case kSubtract: return a - b;
+    case kMultiply: return a * b;
+    case kDivide: return a / b;
+    case kPower: return TMath::Power(a, b);
+    case kLess: return a < b;
+    case kLessEqual: return a <= b;
+    case kGreater: return a > b;
+    case kGreaterEqual: return a >= b;
+    case kEqual: return a == b;
+    case kNotEqual: return a != b;
+    case kAnd: return a && b;
+    case kOr: return a || b;
+    case kFunction2: return instruction.function2(a, b);
+    default: return instruction.value;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+Double_t DelphesFormulaProgram::Execute(Int_t begin, Int_t end, const Double_t *x) const
+{
+  Double_t stack[kMaxDepth];
+  Int_t top = -1, i;
+
+  for(i = begin; i < end; ++i)
+  {
+    const Instruction &instruction = fCode[i];
+    switch(instruction.code)
+    {
+      case kConstant:
+        stack[++top] = instruction.value;
+        break;
+      case kVariable:
+        stack[++top] = x[instruction.index];
+        break;
+      case kNegate:
+      case kNot:
+      case kFunction1:
+        stack[top] = Apply(instruction, stack[top], 0.0);
+        break;
+      default:
+        --top;
+        stack[top] = Apply(instruction, stack[top], stack[top + 1]);
+    }
+  }
+
+  return stack[0];
+}
+
+//------------------------------------------------------------------------------
+
+unique_ptr< DelphesFormulaProgram::Node > DelphesFormulaProgram::MakeNode(Code code, unique_ptr< Node > left, unique_ptr< Node > right)
+{
+  unique_ptr< Node > node(new Node);
+
+  node->instruction.code = code;
+  node->instruction.value = 0.0;
+  node->instruction.index = 0;
+  node->instruction.function1 = 0;
+  node->instruction.function2 = 0;
+
+  if(!left) return node;
+
+  // fold the operations on constants
+  if(left->instruction.code == kConstant && (!right || right->instruction.code == kConstant))
+  {
+    node->instruction.value = Apply(node->instruction, left->instruction.value, right ? right->instruction.value : 0.0);
+    node->instruction.code = kConstant;
+    return node;
+  }
+
+  node->left = move(left);
+  node->right = move(right);
+  return node;
+}
+
+//------------------------------------------------------------------------------
+
+Bool_t DelphesFormulaProgram::Match(const char *token)
+{
+  size_t length = strlen(token);
+  if(strncmp(fPosition, token, length) != 0) return kFALSE;
+  fPosition += length;
+  return kTRUE;
+}
+
+//------------------------------------------------------------------------------
+
+unique_ptr< DelphesFormulaProgram::Node > DelphesFormulaProgram::ParseOr()
+{
+  unique_ptr< Node > node = ParseAnd();
+  while(Match("||")) node = MakeNode(kOr, move(node), ParseAnd());
+  return node;
+}
+
+//------------------------------------------------------------------------------
+
+unique_ptr< DelphesFormulaProgram::Node > DelphesFormulaProgram::ParseAnd()
+{
+  unique_ptr< Node > node = ParseEquality();
+  while(Match("&&")) node = MakeNode(kAnd, move(node), ParseEquality());
+  return node;
+}
+
+//------------------------------------------------------------------------------
+
+unique_ptr< DelphesFormulaProgram::Node > DelphesFormulaProgram::ParseEquality()
+{
+  unique_ptr< Node > node = ParseRelation();
+  while(true)
+  {
+    if(Match("==")) node = MakeNode(kEqual, move(node), ParseRelation());
+    else if(Match("!=")) node = MakeNode(kNotEqual, move(node), ParseRelation());
+    else return node;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+unique_ptr< DelphesFormulaProgram::Node > DelphesFormulaProgram::ParseRelation()
+{
+  unique_ptr< Node > node = ParseSum();
+  while(true)
+  {
+    if(Match("<=")) node = MakeNode(kLessEqual, move(node), ParseSum());
+    else if(Match(">=")) node = MakeNode(kGreaterEqual, move(node), ParseSum());
+    else if(Match("<")) node = MakeNode(kLess, move(node), ParseSum());
+    else if(Match(">")) node = MakeNode(kGreater, move(node), ParseSum());
+    else return node;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+unique_ptr< DelphesFormulaProgram::Node > DelphesFormulaProgram::ParseSum()
+{
+  unique_ptr< Node > node = ParseProduct();
+  while(true)
+  {
+    if(Match("+")) node = MakeNode(kAdd, move(node), ParseProduct());
+    else if(Match("-")) node = MakeNode(kSubtract, move(node), ParseProduct());
+    else return node;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+unique_ptr< DelphesFormulaProgram::Node > DelphesFormulaProgram::ParseProduct()
+{
+  unique_ptr< Node > node = ParseUnary();
+  while(true)
+  {
+    if(Match("*")) node = MakeNode(kMultiply, move(node), ParseUnary());
+    else if(Match("/")) node = MakeNode(kDivide, move(node), ParseUnary());
+    else return node;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+unique_ptr< DelphesFormulaProgram::Node > DelphesFormulaProgram::ParseUnary()
+{
+  if(Match("-")) return MakeNode(kNegate, ParseUnary());
+  if(Match("+")) return ParseUnary();
+  if(Match("!")) return MakeNode(kNot, ParseUnary());
+  return ParsePower();
+}
+
+//------------------------------------------------------------------------------
+
+unique_ptr< DelphesFormulaProgram::Node > DelphesFormulaProgram::ParsePower()
+{
+  // as in TFormula, -x^2 is -(x^2) and the exponent can have a sign
+  unique_ptr< Node > node = ParsePrimary();
+  if(Match("^") || Match("**")) node = MakeNode(kPower, move(node), ParseUnary());
+  return node;
+}
+
+//------------------------------------------------------------------------------
+
+unique_ptr< DelphesFormulaProgram::Node > DelphesFormulaProgram::ParsePrimary()
+{
+  unique_ptr< Node > node;
+  const char *start = fPosition;
+  char *end;
+  string name;
+
+  if(Match("("))
+  {
+    node = ParseOr();
+    if(!Match(")")) throw runtime_error("missing parenthesis");
+    return node;
+  }
+
+  if(isdigit(*fPosition) || *fPosition == '.')
+  {
+    node = MakeNode(kConstant, unique_ptr< Node >());
+    node->instruction.value = strtod(fPosition, &end);
+    if(end == fPosition) throw runtime_error("invalid number");
+    fPosition = end;
+    return node;
+  }
+
+  while(isalnum(*fPosition) || *fPosition == '_' || (fPosition[0] == ':' && fPosition[1] == ':'))
+  {
+    fPosition += (*fPosition == ':') ? 2 : 1;
+  }
+  name.assign(start, fPosition);
+  if(name.empty() || isdigit(name[0])) throw runtime_error("unexpected character");
+
+  if(Match("(")) return ParseCall(name);
+
+  if(name.size() == 1 && strchr("xyzt", name[0]))
+  {
+    node = MakeNode(kVariable, unique_ptr< Node >());
+    node->instruction.index = strchr("xyzt", name[0]) - "xyzt";
+    return node;
+  }
+
+  if(name == "pi")
+  {
+    node = MakeNode(kConstant, unique_ptr< Node >());
+    node->instruction.value = TMath::Pi();
+    return node;
+  }
+
+  throw runtime_error("unknown name");
+}
+
+//------------------------------------------------------------------------------
+
+unique_ptr< DelphesFormulaProgram::Node > DelphesFormulaProgram::ParseCall(const string &name)
+{
+  unique_ptr< Node > node, first, second;
+  size_t i;
+
+  if(name == "TMath::Pi" && Match(")"))
+  {
+    node = MakeNode(kConstant, unique_ptr< Node >());
+    node->instruction.value = TMath::Pi();
+    return node;
+  }
+
+  first = ParseOr();
+  if(Match(",")) second = ParseOr();
+  if(!Match(")")) throw runtime_error("missing parenthesis");
+
+  if(!second)
+  {
+    for(i = 0; i < sizeof(kFunctions1) / sizeof(kFunctions1[0]); ++i)
+    {
+      if(name != kFunctions1[i].name) continue;
+      node = MakeNode(kFunction1, unique_ptr< Node >());
+      node->instruction.function1 = kFunctions1[i].function;
+      if(first->instruction.code == kConstant)
+      {
+        node->instruction.value = node->instruction.function1(first->instruction.value);
+        node->instruction.code = kConstant;
+      }
+      else
+      {
+        node->left = move(first);
+      }
+      return node;
+    }
+  }
+  else
+  {
+    for(i = 0; i < sizeof(kFunctions2) / sizeof(kFunctions2[0]); ++i)
+    {
+      if(name != kFunctions2[i].name) continue;
+      node = MakeNode(kFunction2, unique_ptr< Node >());
+      node->instruction.function2 = kFunctions2[i].function;
+      if(first->instruction.code == kConstant && second->instruction.code == kConstant)
+      {
+        node->instruction.value = node->instruction.function2(first->instruction.value, second->instruction.value);
+        node->instruction.code = kConstant;
+      }
+      else
+      {
+        node->left = move(first);
+        node->right = move(second);
+      }
+      return node;
+    }
+  }
+
+  throw runtime_error("unknown function");
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesFormulaProgram::Emit(const Node *node, Int_t &depth, Int_t &maxDepth)
+{
+  if(node->left) Emit(node->left.get(), depth, maxDepth);
+  if(node->right) Emit(node->right.get(), depth, maxDepth);
+
+  if(!node->left) ++depth;
+  else if(node->right) --depth;
+  if(depth > maxDepth) maxDepth = depth;
+
+  fCode.push_back(node->instruction);
+}
+
+//------------------------------------------------------------------------------
+
+Bool_t DelphesFormulaProgram::IsCondition(const Node *node)
+{
+  switch(node->instruction.code)
+  {
+    case kNot:
+    case kLess: case kLessEqual: case kGreater: case kGreaterEqual:
+    case kEqual: case kNotEqual: case kAnd: case kOr:
+      return kTRUE;
+    case kMultiply:
+      return IsCondition(node->left.get()) && IsCondition(node->right.get());
+    default:
+      return kFALSE;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+Bool_t DelphesFormulaProgram::Write(const Node *node, ostream &out)
+{
+  static const char *operators[] =
+  {
+    0, 0, 0, 0, 0,
+    " + ", " - ", " * ", " / ", 0,
+    " < ", " <= ", " > ", " >= ", " == ", " != ",
+    " && ", " || ", 0
+  };
+
+  const Instruction &instruction = node->instruction;
+  const Node *condition, *term;
+  stringstream number;
+  size_t i;
+
+  switch(instruction.code)
+  {
+    case kConstant:
+      if(!TMath::Finite(instruction.value)) return kFALSE;
+      number.precision(17);
+      number << instruction.value;
+      // a double literal, TMath::Power(x, 2) would take the integer power
+      if(number.str().find_first_of(".e") == string::npos) number << ".0";
+      out << '(' << number.str() << ')';
+      return kTRUE;
+
+    case kVariable:
+      out << "x[" << instruction.index << ']';
+      return kTRUE;
+
+    case kNegate:
+      out << "(-";
+      if(!Write(node->left.get(), out)) return kFALSE;
+      out << ')';
+      return kTRUE;
+
+    case kNot:
+      out << "Double_t(!";
+      if(!Write(node->left.get(), out)) return kFALSE;
+      out << ')';
+      return kTRUE;
+
+    case kFunction1:
+      for(i = 0; i < sizeof(kFunctions1) / sizeof(kFunctions1[0]); ++i)
+      {
+        if(kFunctions1[i].function == instruction.function1) break;
+      }
+      if(i == sizeof(kFunctions1) / sizeof(kFunctions1[0])) return kFALSE;
+      out << kFunctions1[i].code << '(';
+      if(!Write(node->left.get(), out)) return kFALSE;
+      out << ')';
+      return kTRUE;
+
+    case kFunction2:
+    case kPower:
+      if(instruction.code == kPower)
+      {
+        out << "TMath::Power(";
+      }
+      else
+      {
+        for(i = 0; i < sizeof(kFunctions2) / sizeof(kFunctions2[0]); ++i)
+        {
+          if(kFunctions2[i].function == instruction.function2) break;
+        }
+        if(i == sizeof(kFunctions2) / sizeof(kFunctions2[0])) return kFALSE;
+        out << kFunctions2[i].code << '(';
+      }
+      if(!Write(node->left.get(), out)) return kFALSE;
+      out << ", ";
+      if(!Write(node->right.get(), out)) return kFALSE;
+      out << ')';
+      return kTRUE;
+
+    case kMultiply:
+      // as in Eval, a term whose condition is false is zero even when its
+      // value is not finite, and the value is then not computed
+      condition = IsCondition(node->left.get()) ? node->left.get() : IsCondition(node->right.get()) ? node->right.get() : 0;
+      if(condition)
+      {
+        term = (condition == node->left.get()) ? node->right.get() : node->left.get();
+        out << '(';
+        if(!Write(condition, out)) return kFALSE;
+        out << " != 0.0 ? ";
+        if(!Write(term, out)) return kFALSE;
+        out << " : 0.0)";
+        return kTRUE;
+      }
+      break;
+
+    default:
+      break;
+  }
+
+  if(!operators[instruction.code]) return kFALSE;
+
+  // comparisons and logical operations give 0 or 1 as in Apply
+  out << (instruction.code >= kLess ? "Double_t(" : "(");
+  if(!Write(node->left.get(), out)) return kFALSE;
+  out << operators[instruction.code];
+  if(!Write(node->right.get(), out)) return kFALSE;
+  out << ')';
+  return kTRUE;
+}
+
+//------------------------------------------------------------------------------
+
+Bool_t DelphesFormulaProgram::GetAxis(const Node *node, Int_t &axis) const
+{
+  if(node->instruction.code == kVariable)
+  {
+    axis = 2 * node->instruction.index;
+    return kTRUE;
+  }
+
+  if(node->instruction.code == kFunction1 && node->instruction.function1 == Abs
+     && node->left->instruction.code == kVariable)
+  {
+    axis = 2 * node->left->instruction.index + 1;
+    return kTRUE;
+  }
+
+  return kFALSE;
+}
+
+//------------------------------------------------------------------------------
+
+Bool_t DelphesFormulaProgram::AddCondition(const Node *node, Interval *intervals) const
+{
+  Code code = node->instruction.code;
+  Double_t value;
+  Int_t axis;
+
+  if(code == kAnd)
+  {
+    return AddCondition(node->left.get(), intervals) && AddCondition(node->right.get(), intervals);
+  }
+
+  if(code < kLess || code > kEqual) return kFALSE;
+
+  if(GetAxis(node->left.get(), axis) && node->right->instruction.code == kConstant)
+  {
+    value = node->right->instruction.value;
+  }
+  else if(GetAxis(node->right.get(), axis) && node->left->instruction.code == kConstant)
+  {
+    value = node->left->instruction.value;
+    // 1.5 < x is x > 1.5
+    if(code == kLess) code = kGreater;
+    else if(code == kLessEqual) code = kGreaterEqual;
+    else if(code == kGreater) code = kLess;
+    else if(code == kGreaterEqual) code = kLessEqual;
+  }
+  else
+  {
+    return kFALSE;
+  }
+
+  if(TMath::IsNaN(value)) return kFALSE;
+
+  Interval &interval = intervals[axis];
+  if(code == kLess || code == kLessEqual || code == kEqual)
+  {
+    if(value < interval.upper || (value == interval.upper && code == kLess))
+    {
+      interval.upper = value;
+      interval.upperClosed = (code != kLess);
+    }
+  }
+  if(code == kGreater || code == kGreaterEqual || code == kEqual)
+  {
+    if(value > interval.lower || (value == interval.lower && code == kGreater))
+    {
+      interval.lower = value;
+      interval.lowerClosed = (code != kGreater);
+    }
+  }
+
+  return kTRUE;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesFormulaProgram::BuildTable(const Node *root)
+{
+  vector< const Node * > summands, factors, values, stack;
+  vector< const Node * >::iterator itNodes;
+  vector< vector< Int_t > > cellTerms;
+  vector< Int_t > first, last, segment;
+  vector< Double_t >::iterator itBreaks;
+  Interval intervals[kNumberOfAxes], conditions[kNumberOfAxes];
+  Bool_t used[kNumberOfAxes] = {kFALSE};
+  Bool_t piecewise = kFALSE;
+  const Node *node;
+  Int_t axis, i, j, cell, depth, maxDepth, numberOfCells;
+  Term term;
+
+  // the terms of the sum at the top of the expression
+  stack.push_back(root);
+  while(!stack.empty())
+  {
+    node = stack.back();
+    stack.pop_back();
+    if(node->instruction.code == kAdd)
+    {
+      stack.push_back(node->right.get());
+      stack.push_back(node->left.get());
+    }
+    else
+    {
+      summands.push_back(node);
+    }
+  }
+
+  if(summands.size() < 2) return;
+
+  for(itNodes = summands.begin(); itNodes != summands.end(); ++itNodes)
+  {
+    // the factors of the term, split into conditions and value
+    factors.clear();
+    values.clear();
+    stack.push_back(*itNodes);
+    while(!stack.empty())
+    {
+      node = stack.back();
+      stack.pop_back();
+      if(node->instruction.code == kMultiply)
+      {
+        stack.push_back(node->right.get());
+        stack.push_back(node->left.get());
+      }
+      else
+      {
+        factors.push_back(node);
+      }
+    }
+
+    for(axis = 0; axis < kNumberOfAxes; ++axis)
+    {
+      intervals[axis].lower = -TMath::Infinity();
+      intervals[axis].upper = TMath::Infinity();
+      intervals[axis].lowerClosed = kFALSE;
+      intervals[axis].upperClosed = kFALSE;
+    }
+
+    for(i = 0; i < Int_t(factors.size()); ++i)
+    {
+      copy(intervals, intervals + kNumberOfAxes, conditions);
+      if(AddCondition(factors[i], conditions))
+      {
+        copy(conditions, conditions + kNumberOfAxes, intervals);
+        piecewise = kTRUE;
+      }
+      else
+      {
+        values.push_back(factors[i]);
+      }
+    }
+
+    // terms multiplied by zero never contribute
+    if(values.size() == 1 && values[0]->instruction.code == kConstant && values[0]->instruction.value == 0.0) continue;
+
+    term.begin = fCode.size();
+    depth = maxDepth = 0;
+    if(values.empty())
+    {
+      fCode.push_back(MakeNode(kConstant, unique_ptr< Node >())->instruction);
+      fCode.back().value = 1.0;
+    }
+    for(i = 0; i < Int_t(values.size()); ++i)
+    {
+      Emit(values[i], depth, maxDepth);
+      if(i == 0) continue;
+      fCode.push_back(MakeNode(kMultiply, unique_ptr< Node >())->instruction);
+      --depth;
+    }
+    term.end = fCode.size();
+    if(maxDepth > kMaxDepth) return;
+
+    copy(intervals, intervals + kNumberOfAxes, term.intervals);
+    fTerms.push_back(term);
+
+    for(axis = 0; axis < kNumberOfAxes; ++axis)
+    {
+      if(intervals[axis].lower == -TMath::Infinity() && intervals[axis].upper == TMath::Infinity()) continue;
+      used[axis] = kTRUE;
+    }
+  }
+
+  if(!piecewise) return;
+
+  // boundaries of the conditions on every axis
+  numberOfCells = 1;
+  for(axis = 0; axis < kNumberOfAxes; ++axis)
+  {
+    if(!used[axis]) continue;
+
+    fAxes.push_back(axis);
+    fBreaks.push_back(vector< Double_t >());
+    vector< Double_t > &breaks = fBreaks.back();
+    for(i = 0; i < Int_t(fTerms.size()); ++i)
+    {
+      const Interval &interval = fTerms[i].intervals[axis];
+      if(interval.lower != -TMath::Infinity()) breaks.push_back(interval.lower);
+      if(interval.upper != TMath::Infinity()) breaks.push_back(interval.upper);
+    }
+    sort(breaks.begin(), breaks.end());
+    breaks.erase(unique(breaks.begin(), breaks.end()), breaks.end());
+
+    numberOfCells *= 2 * breaks.size() + 1;
+    if(numberOfCells > kMaxCells)
+    {
+      fAxes.clear();
+      fBreaks.clear();
+      return;
+    }
+  }
+
+  cellTerms.resize(numberOfCells);
+  first.resize(fAxes.size());
+  last.resize(fAxes.size());
+  segment.resize(fAxes.size());
+
+  for(i = 0; i < Int_t(fTerms.size()); ++i)
+  {
+    // range of segments of every axis selected by the term
+    for(j = 0; j < Int_t(fAxes.size()); ++j)
+    {
+      const Interval &interval = fTerms[i].intervals[fAxes[j]];
+      vector< Double_t > &breaks = fBreaks[j];
+
+      if(interval.lower == -TMath::Infinity())
+      {
+        first[j] = 0;
+      }
+      else
+      {
+        itBreaks = lower_bound(breaks.begin(), breaks.end(), interval.lower);
+        first[j] = 2 * (itBreaks - breaks.begin()) + (interval.lowerClosed ? 1 : 2);
+      }
+
+      if(interval.upper == TMath::Infinity())
+      {
+        last[j] = 2 * breaks.size();
+      }
+      else
+      {
+        itBreaks = lower_bound(breaks.begin(), breaks.end(), interval.upper);
+        last[j] = 2 * (itBreaks - breaks.begin()) + (interval.upperClosed ? 1 : 0);
+      }
+
+      if(first[j] > last[j]) break;
+    }
+    if(j < Int_t(fAxes.size())) continue;
+
+    // every cell of the box
+    copy(first.begin(), first.end(), segment.begin());
+    while(true)
+    {
+      cell = 0;
+      for(j = 0; j < Int_t(fAxes.size()); ++j)
+      {
+        cell = cell * (2 * fBreaks[j].size() + 1) + segment[j];
+      }
+      cellTerms[cell].push_back(i);
+
+      for(j = fAxes.size() - 1; j >= 0; --j)
+      {
+        if(segment[j] < last[j])
+        {
+          ++segment[j];
+          break;
+        }
+        segment[j] = first[j];
+      }
+      if(j < 0) break;
+    }
+  }
+
+  for(cell = 0; cell < numberOfCells; ++cell)
+  {
+    fCells.push_back(fCellTerms.size());
+    fCellTerms.insert(fCellTerms.end(), cellTerms[cell].begin(), cellTerms[cell].end());
+  }
+  fCells.push_back(fCellTerms.size());
+}
+
+//------------------------------------------------------------------------------
+
+/** \class DelphesFormulaTable
+ *
+ *  Values in bins of one or two variables, see DelphesFormula::SetTable.
+ *
+ */
+
+class DelphesFormulaTable
+{
+public:
+
+  void Init(ExRootConfParam table);
+
+  Double_t Eval(const Double_t *x) const;
+
+private:
+
+  static Int_t FindBin(const vector< Double_t > &edges, Double_t value);
+
+  Int_t fDimension;
+  Int_t fVariables[2];
+  Bool_t fAbs[2];
+  vector< Double_t > fEdges[2];
+  vector< Double_t > fValues;
+};
+
+//------------------------------------------------------------------------------
+
+void DelphesFormulaTable::Init(ExRootConfParam table)
+{
+  static const char *names[] = {"pt", "eta", "phi", "energy"};
+
+  stringstream message;
+  ExRootConfParam param;
+  string name;
+  Int_t i, j, size;
+
+  param = table[0];
+  fDimension = param.GetSize();
+  if(fDimension < 1 || fDimension > 2 || table.GetSize() != fDimension + 2)
+  {
+    throw runtime_error("table needs one or two variables, their bin edges and the values");
+  }
+
+  size = 1;
+  for(i = 0; i < fDimension; ++i)
+  {
+    name = param[i].GetString();
+    fAbs[i] = (name.compare(0, 3, "abs") == 0);
+    if(fAbs[i]) name.erase(0, 3);
+
+    fVariables[i] = -1;
+    for(j = 0; j < 4; ++j)
+    {
+      if(name == names[j]) fVariables[i] = j;
+    }
+    if(fVariables[i] < 0)
+    {
+      message << "unknown table variable '" << param[i].GetString() << "'";
+      throw runtime_error(message.str());
+    }
+
+    ExRootConfParam edges = table[i + 1];
+    for(j = 0; j < edges.GetSize(); ++j)
+    {
+      fEdges[i].push_back(edges[j].GetDouble());
+      if(j > 0 && !(fEdges[i][j] > fEdges[i][j - 1]))
+      {
+        message << "bin edges of '" << param[i].GetString() << "' are not increasing";
+        throw runtime_error(message.str());
+      }
+    }
+    if(fEdges[i].size() < 2)
+    {
+      message << "table variable '" << param[i].GetString() << "' needs at least two bin edges";
+      throw runtime_error(message.str());
+    }
+
+    size *= fEdges[i].size() - 1;
+  }
+
+  param = table[fDimension + 1];
+  if(param.GetSize() != size)
+  {
+    message << "table has " << param.GetSize() << " values instead of " << size;
+    throw runtime_error(message.str());
+  }
+  for(j = 0; j < size; ++j)
+  {
+    fValues.push_back(param[j].GetDouble());
+  }
+}
+
+//------------------------------------------------------------------------------
+
+Int_t DelphesFormulaTable::FindBin(const vector< Double_t > &edges, Double_t value)
+{
+  Int_t i, n = edges.size(), bin = 0;
+
+  // also false for NaN
+  if(!(value >= edges[0] && value <= edges[n - 1])) return -1;
+
+  // number of inner edges below the value, without branches
+  for(i = 1; i < n - 1; ++i) bin += (value > edges[i]);
+
+  return bin;
+}
+
+//------------------------------------------------------------------------------
+
+Double_t DelphesFormulaTable::Eval(const Double_t *x) const
+{
+  Double_t value;
+  Int_t i, bin, index = 0;
+
+  for(i = 0; i < fDimension; ++i)
+  {
+    value = x[fVariables[i]];
+    if(fAbs[i]) value = TMath::Abs(value);
+
+    bin = FindBin(fEdges[i], value);
+    if(bin < 0) return 0.0;
+
+    index = index * (fEdges[i].size() - 1) + bin;
+  }
+
+  return fValues[index];
+}
+
+//------------------------------------------------------------------------------
+
+// functions of the normalized expressions, built before main by AddNative
+static map< string, DelphesFormula::Function > &NativeFunctions()
+{
+  static map< string, DelphesFormula::Function > functions;
+  return functions;
+}
+
+//------------------------------------------------------------------------------
+
 DelphesFormula::DelphesFormula() :
-  TFormula()
+  TFormula(), fProgram(0), fTable(0), fFunction(0)
 {
 }
 
 //------------------------------------------------------------------------------
 
 DelphesFormula::DelphesFormula(const char *name, const char *expression) :
-  TFormula()
+  TFormula(), fProgram(0), fTable(0), fFunction(0)
 {
 }
 
@@ -43,11 +1164,40 @@ DelphesFormula::DelphesFormula(const char *name, const char *expression) :
 
 DelphesFormula::~DelphesFormula()
 {
+  if(fProgram) delete fProgram;
+  if(fTable) delete fTable;
 }
 
 //------------------------------------------------------------------------------
 
 Int_t DelphesFormula::Compile(const char *expression)
+{
+  map< string, Function >::const_iterator itFunctions;
+  TString buffer = Normalize(expression);
+
+  if(TFormula::Compile(buffer) != 0)
+  {
+    throw runtime_error("Invalid formula.");
+  }
+
+  itFunctions = NativeFunctions().find(buffer.Data());
+  fFunction = (itFunctions != NativeFunctions().end()) ? itFunctions->second : 0;
+
+  // expressions the program does not understand stay with TFormula
+  if(fProgram) delete fProgram;
+  fProgram = new DelphesFormulaProgram;
+  if(!fProgram->Compile(buffer.Data()))
+  {
+    delete fProgram;
+    fProgram = 0;
+  }
+
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+
+TString DelphesFormula::Normalize(const char *expression)
 {
   TString buffer;
   const char *it;
@@ -60,11 +1210,42 @@ Int_t DelphesFormula::Compile(const char *expression)
   buffer.ReplaceAll("eta", "y");
   buffer.ReplaceAll("phi", "z");
   buffer.ReplaceAll("energy", "t");
-  if(TFormula::Compile(buffer) != 0)
+  return buffer;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesFormula::AddNative(const char *expression, Function function)
+{
+  NativeFunctions()[Normalize(expression).Data()] = function;
+}
+
+//------------------------------------------------------------------------------
+
+Bool_t DelphesFormula::Translate(const char *expression, string &code)
+{
+  DelphesFormulaProgram program;
+  return program.Translate(Normalize(expression).Data(), code);
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesFormula::SetTable(ExRootConfParam table)
+{
+  DelphesFormulaTable *newTable = new DelphesFormulaTable;
+
+  try
   {
-    throw runtime_error("Invalid formula.");
+    newTable->Init(table);
   }
-  return 0;
+  catch(...)
+  {
+    delete newTable;
+    throw;
+  }
+
+  if(fTable) delete fTable;
+  fTable = newTable;
 }
 
 //------------------------------------------------------------------------------
@@ -72,7 +1253,72 @@ Int_t DelphesFormula::Compile(const char *expression)
 Double_t DelphesFormula::Eval(Double_t pt, Double_t eta, Double_t phi, Double_t energy)
 {
    Double_t x[4] = {pt, eta, phi, energy};
+   if(fTable) return fTable->Eval(x);
+   if(fFunction) return fFunction(x);
+   if(fProgram) return fProgram->Eval(x);
    return EvalPar(x);
 }
 
 //------------------------------------------------------------------------------
+
+void DelphesFormula::Eval(DelphesFormulaBatch &batch)
+{
+  Double_t x[4] = {0.0, 0.0, 0.0, 0.0};
+  Int_t i, n = batch.pt.size();
+
+  if(fTable)
+  {
+    batch.result.resize(n);
+    for(i = 0; i < n; ++i)
+    {
+      x[0] = batch.pt[i];
+      x[1] = batch.eta[i];
+      x[2] = batch.phi[i];
+      x[3] = batch.energy[i];
+      batch.result[i] = fTable->Eval(x);
+    }
+    return;
+  }
+
+  if(fFunction)
+  {
+    batch.result.resize(n);
+    for(i = 0; i < n; ++i)
+    {
+      x[0] = batch.pt[i];
+      x[1] = batch.eta[i];
+      x[2] = batch.phi[i];
+      x[3] = batch.energy[i];
+      batch.result[i] = fFunction(x);
+    }
+    return;
+  }
+
+  if(fProgram ? fProgram->IsConstant() : GetNdim() == 0)
+  {
+    batch.result.assign(n, fProgram ? fProgram->Eval(x) : EvalPar(x));
+    return;
+  }
+
+  batch.result.resize(n);
+  for(i = 0; i < n; ++i)
+  {
+    x[0] = batch.pt[i];
+    x[1] = batch.eta[i];
+    x[2] = batch.phi[i];
+    x[3] = batch.energy[i];
+    batch.result[i] = fProgram ? fProgram->Eval(x) : EvalPar(x);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesFormulaBatch::Resize(Int_t n)
+{
+  pt.resize(n);
+  eta.resize(n);
+  phi.resize(n);
+  energy.resize(n);
+}
+
+//------------------------------------------------------------------------------
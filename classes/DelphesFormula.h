@@ -21,6 +21,53 @@
 
 #include "TFormula.h"
 
+#include "ExRootAnalysis/ExRootConfReader.h"
+
+#include <string>
+#include <vector>
+
+// variables and results of one DelphesFormula for many candidates
+struct DelphesFormulaBatch
+{
+  std::vector< Double_t > pt, eta, phi, energy, result;
+
+  void Resize(Int_t n);
+};
+
+class DelphesFormulaProgram;
+class DelphesFormulaTable;
+
+/** \class DelphesFormula
+ *
+ *  TFormula of pt, eta, phi and energy.
+ *
+ *  Compile also translates the expression into the native program of
+ *  DelphesFormulaProgram when it only uses arithmetic, comparisons and
+ *  the usual mathematical functions, Eval then bypasses TFormula. The
+ *  other expressions are left to TFormula.
+ *
+ *  SetTable replaces the expression with values in bins of one or two
+ *  of pt, eta, abseta, phi and energy:
+ *
+ *    set EfficiencyTable {
+ *      {abseta pt}
+ *      {0.0 1.5 2.5}
+ *      {0.1 1.0 1.0e1 1.0e5}
+ *      {0.70 0.95 0.99
+ *       0.60 0.90 0.95}
+ *    }
+ *
+ *  The values are listed with the last variable changing fastest. The
+ *  first bin of every variable includes both of its edges and the other
+ *  bins their upper edge, like (pt > 1.0 && pt <= 1.0e1) in a formula.
+ *  Outside the edges the table is zero.
+ *
+ *  Compile uses instead a C++ function registered with AddNative for the
+ *  same expression, the translation units written by card2cxx register
+ *  one for every formula of a card.
+ *
+ */
+
 class DelphesFormula: public TFormula
 {
 public:
@@ -34,6 +81,36 @@ public:
   Int_t Compile(const char *expression);
 
   Double_t Eval(Double_t pt, Double_t eta = 0, Double_t phi = 0, Double_t energy = 0);
+
+  // fills batch.result for all the entries of batch.pt, a formula that
+  // does not use any variable is only evaluated once
+  void Eval(DelphesFormulaBatch &batch);
+
+  // throws if the table is malformed
+  void SetTable(ExRootConfParam table);
+
+  Bool_t IsNative() const { return fProgram != 0 || fTable != 0 || fFunction != 0; }
+
+  // function of x = {pt, eta, phi, energy}
+  typedef Double_t (*Function)(const Double_t *x);
+
+  // to be called before the formulas are compiled, from static objects
+  static void AddNative(const char *expression, Function function);
+
+  // C++ expression of x[0] to x[3] that has the value of the expression,
+  // false when the expression is left to TFormula
+  static Bool_t Translate(const char *expression, std::string &code);
+
+private:
+
+  static TString Normalize(const char *expression);
+
+  DelphesFormula(const DelphesFormula &);
+  DelphesFormula &operator=(const DelphesFormula &);
+
+  DelphesFormulaProgram *fProgram; //!
+  DelphesFormulaTable *fTable; //!
+  Function fFunction; //!
 };
 
 #endif /* DelphesFormula_h */
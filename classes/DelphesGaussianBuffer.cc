@@ -0,0 +1,68 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/** \class DelphesGaussianBuffer
+ *
+ *  Standard normal deviates made in blocks.
+ *
+ */
+
+#include "classes/DelphesGaussianBuffer.h"
+
+#include "TMath.h"
+#include "TRandom.h"
+
+#include <cmath>
+#include <limits>
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+
+DelphesGaussianBuffer::DelphesGaussianBuffer(Int_t size) :
+  fUniforms(2*((TMath::Max(size, 2) + 1)/2)), fValues(fUniforms.size()), fNext(fValues.size())
+{
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesGaussianBuffer::Fill(TRandom *random)
+{
+  size_t i, n = fValues.size()/2;
+  Double_t r, angle;
+  const Double_t *u1 = &fUniforms[0], *u2 = &fUniforms[n];
+  Double_t *values = &fValues[0];
+
+  const Double_t tiny = numeric_limits< Double_t >::min();
+
+  random->RndmArray(fUniforms.size(), &fUniforms[0]);
+
+  for(i = 0; i < n; ++i)
+  {
+    // finite even for a generator that can return 0
+    r = sqrt(-2.0*log(max(u1[i], tiny)));
+    angle = TMath::TwoPi()*u2[i];
+    values[2*i] = r*cos(angle);
+    values[2*i + 1] = r*sin(angle);
+  }
+
+  fNext = 0;
+}
+
+//------------------------------------------------------------------------------
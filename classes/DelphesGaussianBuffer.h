@@ -0,0 +1,60 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DelphesGaussianBuffer_h
+#define DelphesGaussianBuffer_h
+
+/** \class DelphesGaussianBuffer
+ *
+ *  Standard normal deviates made in blocks: the uniform numbers of a block
+ *  are taken from the random generator in one call and turned into pairs
+ *  of deviates by the Box-Muller transformation in a loop without branches.
+ *
+ */
+
+#include "Rtypes.h"
+
+#include <vector>
+
+class TRandom;
+
+class DelphesGaussianBuffer
+{
+public:
+
+  // size is rounded up to an even number
+  DelphesGaussianBuffer(Int_t size = 256);
+
+  // drops the deviates left, the next one comes from a new block
+  void Clear() { fNext = fValues.size(); }
+
+  Double_t Next(TRandom *random)
+  {
+    if(fNext == fValues.size()) Fill(random);
+    return fValues[fNext++];
+  }
+
+private:
+
+  void Fill(TRandom *random);
+
+  std::vector< Double_t > fUniforms, fValues;
+  size_t fNext;
+};
+
+#endif /* DelphesGaussianBuffer_h */
@@ -0,0 +1,306 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+/** \class DelphesHDF5Reader
+ *
+ *  Reads generator-level particles from a columnar HDF5 file.
+ *
+ */
+
+#include "classes/DelphesHDF5Reader.h"
+
+#include <stdexcept>
+#include <iostream>
+#include <sstream>
+
+#include "TObjArray.h"
+#include "TStopwatch.h"
+#include "TLorentzVector.h"
+
+#include "classes/DelphesClasses.h"
+#include "classes/DelphesFactory.h"
+#include "classes/DelphesPDGTable.h"
+
+#include "ExRootAnalysis/ExRootTreeBranch.h"
+
+#include "external/h5/ColumnReader.hh"
+
+#include "H5Cpp.h"
+
+using namespace std;
+
+static const char *kIntNames[] = {"pid", "status", "m1", "m2", "d1", "d2"};
+static const char *kDoubleNames[] = {"px", "py", "pz", "e", "mass", "x", "y", "z", "t"};
+
+// the columns from x on can be left out
+static const int kRequiredDoubleColumns = 5;
+
+//---------------------------------------------------------------------------
+
+static bool HasColumn(const H5::Group &group, const char *name)
+{
+  return H5Lexists(group.getId(), name, H5P_DEFAULT) > 0;
+}
+
+//---------------------------------------------------------------------------
+
+DelphesHDF5Reader::DelphesHDF5Reader() :
+  fFile(0), fNumberColumn(0), fProcessIDColumn(0), fWeightColumn(0), fPDG(0),
+  fAllParticles(true), fStableParticles(true), fPartons(true), fEntry(-1)
+{
+  int i;
+
+  for(i = 0; i < kIntColumns; ++i) fIntColumns[i] = 0;
+  for(i = 0; i < kDoubleColumns; ++i) fDoubleColumns[i] = 0;
+
+  fPDG = DelphesPDGTable::Instance();
+}
+
+//---------------------------------------------------------------------------
+
+DelphesHDF5Reader::~DelphesHDF5Reader()
+{
+  Close();
+}
+
+//---------------------------------------------------------------------------
+
+void DelphesHDF5Reader::Open(const char *fileName)
+{
+  stringstream message;
+  const int *counts;
+  long long entry, entries;
+  int i;
+
+  Close();
+
+  try
+  {
+    fFile = new H5::H5File(fileName, H5F_ACC_RDONLY);
+
+    H5::Group particles = fFile->openGroup("particles");
+    H5::Group events = fFile->openGroup("events");
+
+    for(i = 0; i < kIntColumns; ++i)
+    {
+      fIntColumns[i] = new ColumnReader< int >(particles, kIntNames[i]);
+    }
+
+    for(i = 0; i < kDoubleColumns; ++i)
+    {
+      if(i >= kRequiredDoubleColumns && !HasColumn(particles, kDoubleNames[i])) continue;
+      fDoubleColumns[i] = new ColumnReader< double >(particles, kDoubleNames[i]);
+    }
+
+    if(HasColumn(events, "number")) fNumberColumn = new ColumnReader< int >(events, "number");
+    if(HasColumn(events, "process_id")) fProcessIDColumn = new ColumnReader< int >(events, "process_id");
+    if(HasColumn(events, "weight")) fWeightColumn = new ColumnReader< double >(events, "weight");
+
+    // the offsets of all the events, so that any event can be read first
+    ColumnReader< int > numbers(events, "n_particles");
+    entries = numbers.size();
+    counts = numbers.get(0, entries);
+    fOffsets.assign(1, 0);
+    for(entry = 0; entry < entries; ++entry)
+    {
+      fOffsets.push_back(fOffsets.back() + counts[entry]);
+    }
+  }
+  catch(H5::Exception &e)
+  {
+    Close();
+    message << "can't read HDF5 file " << fileName << ": " << e.getDetailMsg();
+    throw runtime_error(message.str());
+  }
+  catch(exception &e)
+  {
+    Close();
+    message << "can't read HDF5 file " << fileName << ": " << e.what();
+    throw runtime_error(message.str());
+  }
+
+  for(i = 0; i < kIntColumns; ++i)
+  {
+    if(fIntColumns[i]->size() == (hsize_t)fOffsets.back()) continue;
+    Close();
+    message << "the particle columns of " << fileName << " don't match n_particles";
+    throw runtime_error(message.str());
+  }
+}
+
+//---------------------------------------------------------------------------
+
+void DelphesHDF5Reader::Close()
+{
+  int i;
+
+  for(i = 0; i < kIntColumns; ++i)
+  {
+    delete fIntColumns[i];
+    fIntColumns[i] = 0;
+  }
+
+  for(i = 0; i < kDoubleColumns; ++i)
+  {
+    delete fDoubleColumns[i];
+    fDoubleColumns[i] = 0;
+  }
+
+  delete fNumberColumn;
+  delete fProcessIDColumn;
+  delete fWeightColumn;
+  fNumberColumn = 0;
+  fProcessIDColumn = 0;
+  fWeightColumn = 0;
+
+  delete fFile;
+  fFile = 0;
+
+  fOffsets.clear();
+  fEntry = -1;
+}
+
+//---------------------------------------------------------------------------
+
+long long DelphesHDF5Reader::GetEntries() const
+{
+  return fOffsets.empty() ? 0 : fOffsets.size() - 1;
+}
+
+//---------------------------------------------------------------------------
+
+void DelphesHDF5Reader::SetUsedArrays(bool allParticles, bool stableParticles, bool partons)
+{
+  fAllParticles = allParticles;
+  fStableParticles = stableParticles;
+  fPartons = partons;
+}
+
+//---------------------------------------------------------------------------
+
+bool DelphesHDF5Reader::ReadEvent(long long entry, DelphesFactory *factory,
+  TObjArray *allParticleOutputArray,
+  TObjArray *stableParticleOutputArray,
+  TObjArray *partonOutputArray)
+{
+  Candidate *candidate;
+  const DelphesPDGTable::Entry *pdgParticle;
+  const int *ints[kIntColumns];
+  const double *doubles[kDoubleColumns];
+  long long first, count, number;
+  int i, pid, status, pdgCode;
+  bool stable, parton;
+
+  if(entry < 0 || entry >= GetEntries()) return false;
+
+  fEntry = entry;
+  first = fOffsets[entry];
+  count = fOffsets[entry + 1] - first;
+
+  try
+  {
+    for(i = 0; i < kIntColumns; ++i)
+    {
+      ints[i] = fIntColumns[i]->get(first, count);
+    }
+    for(i = 0; i < kDoubleColumns; ++i)
+    {
+      doubles[i] = fDoubleColumns[i] ? fDoubleColumns[i]->get(first, count) : 0;
+    }
+  }
+  catch(H5::Exception &e)
+  {
+    throw runtime_error(e.getDetailMsg());
+  }
+
+  for(number = 0; number < count; ++number)
+  {
+    pid = ints[kPID][number];
+    status = ints[kStatus][number];
+
+    pdgParticle = fPDG->Find(pid);
+    pdgCode = TMath::Abs(pid);
+
+    stable = pdgParticle && status == 1 && pdgParticle->stable;
+    parton = pdgParticle && !stable && (pdgCode <= 5 || pdgCode == 21 || pdgCode == 15);
+
+    if(!fAllParticles && !(stable && fStableParticles) && !(parton && fPartons)) continue;
+
+    candidate = factory->NewCandidate();
+
+    candidate->PID = pid;
+
+    candidate->Status = status;
+
+    candidate->M1 = ints[kM1][number];
+    candidate->M2 = ints[kM2][number];
+
+    candidate->D1 = ints[kD1][number];
+    candidate->D2 = ints[kD2][number];
+
+    candidate->Charge = pdgParticle ? pdgParticle->charge : -999;
+    candidate->Mass = doubles[kMass][number];
+
+    candidate->Momentum.SetPxPyPzE(doubles[kPx][number], doubles[kPy][number],
+      doubles[kPz][number], doubles[kE][number]);
+
+    candidate->Position.SetXYZT(doubles[kX] ? doubles[kX][number] : 0.0,
+      doubles[kY] ? doubles[kY][number] : 0.0,
+      doubles[kZ] ? doubles[kZ][number] : 0.0,
+      doubles[kT] ? doubles[kT][number] : 0.0);
+
+    allParticleOutputArray->Add(candidate);
+
+    if(stable && fStableParticles)
+    {
+      stableParticleOutputArray->Add(candidate);
+    }
+    else if(parton && fPartons)
+    {
+      partonOutputArray->Add(candidate);
+    }
+  }
+
+  return true;
+}
+
+//---------------------------------------------------------------------------
+
+void DelphesHDF5Reader::AnalyzeEvent(ExRootTreeBranch *branch, long long eventNumber,
+  TStopwatch *readStopWatch, TStopwatch *procStopWatch)
+{
+  LHEFEvent *element;
+
+  element = static_cast<LHEFEvent *>(branch->NewEntry());
+
+  element->Number = fNumberColumn ? *fNumberColumn->get(fEntry, 1) : eventNumber;
+
+  element->ProcessID = fProcessIDColumn ? *fProcessIDColumn->get(fEntry, 1) : 0;
+
+  element->Weight = fWeightColumn ? *fWeightColumn->get(fEntry, 1) : 1.0;
+  element->ScalePDF = 0.0;
+  element->AlphaQED = 0.0;
+  element->AlphaQCD = 0.0;
+
+  element->ReadTime = readStopWatch->RealTime();
+  element->ProcTime = procStopWatch->RealTime();
+}
+
+//---------------------------------------------------------------------------
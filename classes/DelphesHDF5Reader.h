@@ -0,0 +1,108 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef DelphesHDF5Reader_h
+#define DelphesHDF5Reader_h
+
+/** \class DelphesHDF5Reader
+ *
+ *  Reads generator-level particles from a columnar HDF5 file.
+ *
+ *  The group "particles" has one 1-D dataset per column: pid, status,
+ *  m1, m2, d1, d2, px, py, pz, e, mass and, optionally, x, y, z and t.
+ *  The mothers and daughters are indices within the event, -1 for none.
+ *  The group "events" has the column n_particles and, optionally, the
+ *  columns number, process_id and weight. The particles of the events
+ *  follow each other in the order of the events.
+ *
+ *  The columns are read in blocks of one chunk, see ColumnReader.
+ *
+ */
+
+#include <vector>
+
+class TObjArray;
+class TStopwatch;
+class DelphesPDGTable;
+class ExRootTreeBranch;
+class DelphesFactory;
+
+namespace H5
+{
+  class H5File;
+}
+
+template < typename T >
+class ColumnReader;
+
+class DelphesHDF5Reader
+{
+public:
+
+  DelphesHDF5Reader();
+  ~DelphesHDF5Reader();
+
+  // throws runtime_error if a column is missing
+  void Open(const char *fileName);
+  void Close();
+
+  long long GetEntries() const;
+
+  // same as the other readers, see DelphesSTDHEPReader::SetUsedArrays
+  void SetUsedArrays(bool allParticles, bool stableParticles, bool partons);
+
+  bool ReadEvent(long long entry, DelphesFactory *factory,
+    TObjArray *allParticleOutputArray,
+    TObjArray *stableParticleOutputArray,
+    TObjArray *partonOutputArray);
+
+  void AnalyzeEvent(ExRootTreeBranch *branch, long long eventNumber,
+    TStopwatch *readStopWatch, TStopwatch *procStopWatch);
+
+private:
+
+  enum
+  {
+    kPID, kStatus, kM1, kM2, kD1, kD2, kIntColumns
+  };
+
+  enum
+  {
+    kPx, kPy, kPz, kE, kMass, kX, kY, kZ, kT, kDoubleColumns
+  };
+
+  H5::H5File *fFile;
+
+  ColumnReader< int > *fIntColumns[kIntColumns];
+  ColumnReader< double > *fDoubleColumns[kDoubleColumns];
+
+  ColumnReader< int > *fNumberColumn, *fProcessIDColumn;
+  ColumnReader< double > *fWeightColumn;
+
+  // first particle of every event and of the end of the file
+  std::vector< long long > fOffsets;
+
+  const DelphesPDGTable *fPDG;
+
+  bool fAllParticles, fStableParticles, fPartons;
+
+  long long fEntry;
+};
+
+#endif // DelphesHDF5Reader_h
@@ -38,44 +38,59 @@
 
 #include "TObjArray.h"
 #include "TStopwatch.h"
-#include "TDatabasePDG.h"
-#include "TParticlePDG.h"
 #include "TLorentzVector.h"
 
 #include "classes/DelphesClasses.h"
 #include "classes/DelphesFactory.h"
 #include "classes/DelphesStream.h"
+#include "classes/DelphesLineReader.h"
+#include "classes/DelphesPDGTable.h"
 
 #include "ExRootAnalysis/ExRootTreeBranch.h"
 
 using namespace std;
 
-static const int kBufferSize  = 1024;
-
 //---------------------------------------------------------------------------
 
 DelphesHepMCReader::DelphesHepMCReader() :
-  fInputFile(0), fBuffer(0), fPDG(0),
+  fOwnLineReader(0), fLineReader(0), fBuffer(0), fPDG(0),
+  fAllParticles(true), fStableParticles(true), fPartons(true),
   fVertexCounter(-1), fInCounter(-1), fOutCounter(-1),
   fParticleCounter(0)
 {
-  fBuffer = new char[kBufferSize];
-
-  fPDG = TDatabasePDG::Instance();
+  fPDG = DelphesPDGTable::Instance();
 }
 
 //---------------------------------------------------------------------------
 
 DelphesHepMCReader::~DelphesHepMCReader()
 {
-  if(fBuffer) delete[] fBuffer;
+  if(fOwnLineReader) delete fOwnLineReader;
 }
 
 //---------------------------------------------------------------------------
 
 void DelphesHepMCReader::SetInputFile(FILE *inputFile)
 {
-  fInputFile = inputFile;
+  if(!fOwnLineReader) fOwnLineReader = new DelphesLineReader;
+  fOwnLineReader->SetInputFile(inputFile);
+  fLineReader = fOwnLineReader;
+}
+
+//---------------------------------------------------------------------------
+
+void DelphesHepMCReader::SetLineReader(DelphesLineReader *lineReader)
+{
+  fLineReader = lineReader;
+}
+
+//---------------------------------------------------------------------------
+
+void DelphesHepMCReader::SetUsedArrays(bool allParticles, bool stableParticles, bool partons)
+{
+  fAllParticles = allParticles;
+  fStableParticles = stableParticles;
+  fPartons = partons;
 }
 
 //---------------------------------------------------------------------------
@@ -105,6 +120,13 @@ bool DelphesHepMCReader::EventReady()
 
 //---------------------------------------------------------------------------
 
+long long DelphesHepMCReader::GetPosition() const
+{
+  return fLineReader ? fLineReader->GetPosition() : 0;
+}
+
+//---------------------------------------------------------------------------
+
 bool DelphesHepMCReader::ReadBlock(DelphesFactory *factory,
   TObjArray *allParticleOutputArray,
   TObjArray *stableParticleOutputArray,
@@ -116,7 +138,8 @@ bool DelphesHepMCReader::ReadBlock(DelphesFactory *factory,
   int i, rc, state;
   double weight;
 
-  if(!fgets(fBuffer, kBufferSize, fInputFile)) return kFALSE;
+  fBuffer = fLineReader->ReadLine();
+  if(!fBuffer) return kFALSE;
 
   DelphesStream bufferStream(fBuffer + 1);
 
@@ -303,6 +326,29 @@ bool DelphesHepMCReader::ReadBlock(DelphesFactory *factory,
 
 //---------------------------------------------------------------------------
 
+bool DelphesHepMCReader::SkipEvent()
+{
+  char *line;
+  bool found = false;
+
+  while((line = fLineReader->ReadLine()))
+  {
+    if(line[0] != 'E') continue;
+
+    // the E line of the following event is read again by ReadBlock
+    if(found)
+    {
+      fLineReader->UnreadLine();
+      return kTRUE;
+    }
+    found = true;
+  }
+
+  return found;
+}
+
+//---------------------------------------------------------------------------
+
 void DelphesHepMCReader::AnalyzeEvent(ExRootTreeBranch *branch, long long eventNumber,
   TStopwatch *readStopWatch, TStopwatch *procStopWatch)
 {
@@ -338,18 +384,25 @@ void DelphesHepMCReader::AnalyzeParticle(DelphesFactory *factory,
   TObjArray *partonOutputArray)
 {
   Candidate *candidate;
-  TParticlePDG *pdgParticle;
+  const DelphesPDGTable::Entry *pdgParticle;
   int pdgCode;
+  bool stable, parton;
+
+  pdgParticle = fPDG->Find(fPID);
+  pdgCode = TMath::Abs(fPID);
+
+  stable = pdgParticle && fStatus == 1 && pdgParticle->stable;
+  parton = pdgParticle && !stable && (pdgCode <= 5 || pdgCode == 21 || pdgCode == 15);
+
+  if(!fAllParticles && !(stable && fStableParticles) && !(parton && fPartons)) return;
 
   candidate = factory->NewCandidate();
 
   candidate->PID = fPID;
-  pdgCode = TMath::Abs(candidate->PID);
 
   candidate->Status = fStatus;
 
-  pdgParticle = fPDG->GetParticle(fPID);
-  candidate->Charge = pdgParticle ? int(pdgParticle->Charge()/3.0) : -999;
+  candidate->Charge = pdgParticle ? pdgParticle->charge : -999;
   candidate->Mass = fMass;
 
   candidate->Momentum.SetPxPyPzE(fPx, fPy, fPz, fE);
@@ -385,13 +438,11 @@ void DelphesHepMCReader::AnalyzeParticle(DelphesFactory *factory,
 
   allParticleOutputArray->Add(candidate);
 
-  if(!pdgParticle) return;
-
-  if(fStatus == 1 && pdgParticle->Stable())
+  if(stable && fStableParticles)
   {
     stableParticleOutputArray->Add(candidate);
   }
-  else if(pdgCode <= 5 || pdgCode == 21 || pdgCode == 15)
+  else if(parton && fPartons)
   {
     partonOutputArray->Add(candidate);
   }
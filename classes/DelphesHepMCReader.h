@@ -34,9 +34,10 @@
 
 class TObjArray;
 class TStopwatch;
-class TDatabasePDG;
+class DelphesPDGTable;
 class ExRootTreeBranch;
 class DelphesFactory;
+class DelphesLineReader;
 
 class DelphesHepMCReader
 {
@@ -47,14 +48,29 @@ public:
 
   void SetInputFile(FILE *inputFile);
 
+  // reads the lines from lineReader, which can be shared with other readers
+  void SetLineReader(DelphesLineReader *lineReader);
+
+  // arrays that no module imports are left empty, and without allParticles
+  // only the candidates of the other two arrays are created, these are still
+  // added to allParticles with the indices of the full record in M1 and D1
+  void SetUsedArrays(bool allParticles, bool stableParticles, bool partons);
+
   void Clear();
   bool EventReady();
 
+  // offset in the input file of the next line to be read
+  long long GetPosition() const;
+
   bool ReadBlock(DelphesFactory *factory,
     TObjArray *allParticleOutputArray,
     TObjArray *stableParticleOutputArray,
     TObjArray *partonOutputArray);
 
+  // passes over the next event, only looking for the E lines, false at
+  // the end of the input
+  bool SkipEvent();
+
   void AnalyzeEvent(ExRootTreeBranch *branch, long long eventNumber,
     TStopwatch *readStopWatch, TStopwatch *procStopWatch);
 
@@ -67,11 +83,13 @@ private:
 
   void FinalizeParticles(TObjArray *allParticleOutputArray);
 
-  FILE *fInputFile;
+  DelphesLineReader *fOwnLineReader, *fLineReader;
 
   char *fBuffer;
 
-  TDatabasePDG *fPDG;
+  const DelphesPDGTable *fPDG;
+
+  bool fAllParticles, fStableParticles, fPartons;
 
   int fEventNumber, fMPI, fProcessID, fSignalCode, fVertexCounter, fBeamCode[2];
   double fScale, fAlphaQCD, fAlphaQED;
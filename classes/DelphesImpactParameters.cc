@@ -0,0 +1,186 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+/** \class DelphesImpactParameters
+ *
+ *  Signed impact parameter significances of the tracks around the jets of
+ *  an array, shared by the modules of an event.
+ *
+ */
+
+#include "classes/DelphesImpactParameters.h"
+
+#include "classes/DelphesClasses.h"
+#include "classes/flavortag/enums_track.hh"
+#include "classes/flavortag/hl_vars.hh"
+
+#include "TMath.h"
+#include "TObjArray.h"
+
+#include <cmath>
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+
+bool DelphesImpactParameters::Key::operator<(const Key &other) const
+{
+  if(jets != other.jets) return jets < other.jets;
+  if(tracks != other.tracks) return tracks < other.tracks;
+  return deltaR < other.deltaR;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesImpactParameters::Reset()
+{
+  map< Key, Entry >::iterator itEntries;
+
+  // the vectors keep their memory for the next event
+  for(itEntries = fEntries.begin(); itEntries != fEntries.end(); ++itEntries)
+  {
+    itEntries->second.valid = kFALSE;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesImpactParameters::Invalidate(const TObjArray *array)
+{
+  lock_guard< mutex > lock(fMutex);
+  map< Key, Entry >::iterator itEntries;
+
+  for(itEntries = fEntries.begin(); itEntries != fEntries.end(); ++itEntries)
+  {
+    if(itEntries->first.jets == array || itEntries->first.tracks == array)
+    {
+      itEntries->second.valid = kFALSE;
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+const DelphesImpactParameters::Table &DelphesImpactParameters::Get(const TObjArray *jets,
+  const TObjArray *tracks, const DelphesEtaPhiGrid *grid, Double_t deltaR)
+{
+  Key key = {jets, tracks, deltaR};
+
+  // the modules of an event may ask at the same time, the entries of
+  // the map never move once inserted
+  lock_guard< mutex > lock(fMutex);
+  Entry &entry = fEntries[key];
+
+  if(!entry.valid || entry.jetsSize != jets->GetEntriesFast()
+    || (tracks && entry.tracksSize != tracks->GetEntriesFast()))
+  {
+    Fill(entry, jets, tracks ? grid : 0, deltaR);
+    entry.jetsSize = jets->GetEntriesFast();
+    entry.tracksSize = tracks ? tracks->GetEntriesFast() : 0;
+    entry.valid = kTRUE;
+  }
+
+  return entry;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesImpactParameters::Fill(Entry &entry, const TObjArray *jets,
+  const DelphesEtaPhiGrid *grid, Double_t deltaR)
+{
+  Candidate *jet, *track;
+  TObject *object;
+  Double_t jetEta, jetPhi, dr;
+  Int_t i, size;
+  size_t j;
+
+  entry.first.clear();
+  entry.tracks.clear();
+  entry.pt.clear();
+  entry.deltaR.clear();
+  entry.dxy.clear();
+  entry.dxySig.clear();
+  entry.d0.clear();
+  entry.d0Sig.clear();
+  entry.z0Sig.clear();
+
+  size = jets->GetEntriesFast();
+  for(i = 0; i < size; ++i)
+  {
+    jet = static_cast< Candidate * >(jets->UncheckedAt(i));
+    const TLorentzVector &jetMomentum = jet->Momentum;
+    jetEta = jetMomentum.Eta();
+    jetPhi = jetMomentum.Phi();
+
+    entry.first.push_back(entry.tracks.size());
+
+    if(grid)
+    {
+      grid->Find(jetEta, jetPhi, deltaR, fNearby);
+      for(j = 0; j < fNearby.size(); ++j)
+      {
+        dr = DelphesEtaPhiGrid::DeltaR(jetEta, jetPhi, fNearby[j]->eta, fNearby[j]->phi);
+        Add(entry, fNearby[j]->candidate, dr, jetMomentum.Px(), jetMomentum.Py(), jetPhi);
+      }
+    }
+    else
+    {
+      TIter itJetTracks(jet->GetTracks());
+      while((object = itJetTracks.Next()))
+      {
+        track = static_cast< Candidate * >(object);
+        const TLorentzVector &trackMomentum = track->Momentum;
+        dr = DelphesEtaPhiGrid::DeltaR(jetEta, jetPhi, trackMomentum.Eta(), trackMomentum.Phi());
+        if(dr > deltaR) continue;
+        Add(entry, track, dr, jetMomentum.Px(), jetMomentum.Py(), jetPhi);
+      }
+    }
+  }
+
+  entry.first.push_back(entry.tracks.size());
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesImpactParameters::Add(Entry &entry, Candidate *track, Double_t deltaR,
+  Double_t jetPx, Double_t jetPy, Float_t jetPhi)
+{
+  Double_t dxy;
+  Float_t d0, d0Error, z0Error;
+  Int_t sign;
+
+  dxy = TMath::Abs(track->Dxy);
+  sign = (jetPx*track->Xd + jetPy*track->Yd > 0.0) ? 1 : -1;
+
+  d0 = signed_ip(track->trkPar[trk::D0], track->trkPar[trk::PHI], jetPhi);
+  d0Error = sqrt(track->trkCov[trk::D0D0]);
+  z0Error = sqrt(track->trkCov[trk::Z0Z0]);
+
+  entry.tracks.push_back(track);
+  entry.pt.push_back(track->Momentum.Pt());
+  entry.deltaR.push_back(deltaR);
+  entry.dxy.push_back(dxy);
+  entry.dxySig.push_back(Float_t(sign*dxy)/Float_t(TMath::Abs(track->SDxy)));
+  entry.d0.push_back(d0);
+  entry.d0Sig.push_back(d0/d0Error);
+  entry.z0Sig.push_back(abs(track->trkPar[trk::Z0]/z0Error));
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,109 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DelphesImpactParameters_h
+#define DelphesImpactParameters_h
+
+/** \class DelphesImpactParameters
+ *
+ *  Signed impact parameter significances of the tracks around the jets of
+ *  an array, computed once per event and shared by the track based
+ *  b-tagging modules and the high level tracking variables.
+ *
+ *  A table holds, for every jet in the order of the array, the tracks
+ *  within DeltaR of its axis, either from a track array or from the tracks
+ *  attached to the jet, in the order of the input. Each track comes with
+ *  its significances with respect to that jet:
+ *
+ *    dxySig  Dxy/SDxy, signed by the direction of the point of closest
+ *            approach (Xd, Yd) with respect to the jet, as in
+ *            TrackCountingBTagging
+ *    d0      d0 of trkPar, signed by the phi of the track with respect to
+ *            the jet, as in HighLevelTracking
+ *    d0Sig   d0 over the error from trkCov
+ *    z0Sig   |z0| over the error from trkCov
+ *
+ *  The factory keeps one table per jet array, track array and DeltaR, built
+ *  by the first module of the event that asks for it, until one of the
+ *  arrays grows, a module updating one of them in place has run or the
+ *  event ends. Cuts on the track pt and Dxy are left to the modules.
+ *
+ */
+
+#include "classes/DelphesEtaPhiGrid.h"
+
+#include "Rtypes.h"
+
+#include <map>
+#include <mutex>
+#include <vector>
+
+class TObjArray;
+
+class Candidate;
+
+class DelphesImpactParameters
+{
+public:
+
+  struct Table
+  {
+    // tracks of jet i are the entries first[i] to first[i + 1] - 1
+    std::vector< Int_t > first;
+    std::vector< Candidate * > tracks;
+    std::vector< Float_t > pt, deltaR, dxy, dxySig, d0, d0Sig, z0Sig;
+  };
+
+  // forgets all the tables, at the start of every event
+  void Reset();
+
+  // forgets the tables of a jet or track array whose candidates have changed
+  void Invalidate(const TObjArray *array);
+
+  // tracks of the grid of the track array around the jets, or the tracks
+  // attached to the jets when the track array is null
+  const Table &Get(const TObjArray *jets, const TObjArray *tracks,
+    const DelphesEtaPhiGrid *grid, Double_t deltaR);
+
+private:
+
+  struct Key
+  {
+    const TObjArray *jets, *tracks;
+    Double_t deltaR;
+    bool operator<(const Key &other) const;
+  };
+
+  struct Entry : Table
+  {
+    Entry() : valid(kFALSE), jetsSize(0), tracksSize(0) {}
+    Bool_t valid;
+    Int_t jetsSize, tracksSize;
+  };
+
+  void Fill(Entry &entry, const TObjArray *jets, const DelphesEtaPhiGrid *grid, Double_t deltaR);
+
+  static void Add(Entry &entry, Candidate *track, Double_t deltaR,
+    Double_t jetPx, Double_t jetPy, Float_t jetPhi);
+
+  std::map< Key, Entry > fEntries;
+  std::vector< const DelphesEtaPhiGrid::Entry * > fNearby;
+  std::mutex fMutex;
+};
+
+#endif /* DelphesImpactParameters_h */
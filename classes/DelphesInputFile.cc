@@ -0,0 +1,507 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/** \class DelphesInputFile
+ *
+ *  Opens an input file of the readers and decompresses it on the fly.
+ *
+ */
+
+#include "classes/DelphesInputFile.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <iostream>
+#include <sstream>
+
+#ifdef HAS_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef HAS_ZSTD
+#include <zstd.h>
+#endif
+
+#ifdef HAS_LZMA
+#include <lzma.h>
+#endif
+
+using namespace std;
+
+static const size_t kNumberOfChunks = 4;
+static const size_t kChunkSize = 1 << 20;
+static const size_t kInputSize = 1 << 18;
+
+//------------------------------------------------------------------------------
+
+#if defined(__APPLE__) || defined(__FreeBSD__)
+
+static int ReadFunction(void *cookie, char *buffer, int size)
+{
+  return int(DelphesInputFile::ReadCookie(cookie, buffer, size));
+}
+
+#else
+
+static int SeekFunction(void *cookie, off64_t *offset, int whence)
+{
+  // the readers fall back to reading when they can't skip data
+  errno = ESPIPE;
+  return -1;
+}
+
+#endif
+
+//------------------------------------------------------------------------------
+
+DelphesInputFile::DelphesInputFile(const char *fileName) :
+  fFormat(kPlain), fInputFile(0), fFile(0), fLength(-1),
+  fFirst(0), fCount(0), fOffset(0), fFinished(false), fStop(false),
+  fPosition(0)
+{
+  stringstream message;
+  unsigned char magic[6];
+  const char *library = 0;
+  size_t i;
+
+  if(!fileName || strcmp(fileName, "-") == 0)
+  {
+    fInputFile = fFile = stdin;
+    return;
+  }
+
+  fInputFile = fopen(fileName, "r");
+  if(!fInputFile)
+  {
+    message << "can't open " << fileName;
+    throw runtime_error(message.str());
+  }
+
+  fseek(fInputFile, 0L, SEEK_END);
+  fLength = ftello(fInputFile);
+  fseek(fInputFile, 0L, SEEK_SET);
+
+  if(fread(magic, 1, sizeof(magic), fInputFile) == sizeof(magic))
+  {
+    if(magic[0] == 0x1F && magic[1] == 0x8B)
+    {
+      fFormat = kGzip;
+#ifndef HAS_ZLIB
+      library = "zlib";
+#endif
+    }
+    else if(magic[0] == 0x28 && magic[1] == 0xB5 && magic[2] == 0x2F && magic[3] == 0xFD)
+    {
+      fFormat = kZstd;
+#ifndef HAS_ZSTD
+      library = "zstd";
+#endif
+    }
+    else if(memcmp(magic, "\xFD" "7zXZ\0", 6) == 0)
+    {
+      fFormat = kXz;
+#ifndef HAS_LZMA
+      library = "liblzma";
+#endif
+    }
+  }
+  fseek(fInputFile, 0L, SEEK_SET);
+
+  if(library)
+  {
+    fclose(fInputFile);
+    message << "can't decompress " << fileName << ", Delphes was built without " << library;
+    throw runtime_error(message.str());
+  }
+
+  if(fFormat == kPlain)
+  {
+    fFile = fInputFile;
+    return;
+  }
+
+  fChunks.resize(kNumberOfChunks);
+  for(i = 0; i < kNumberOfChunks; ++i)
+  {
+    fChunks[i].data.resize(kChunkSize);
+    fChunks[i].size = 0;
+    fChunks[i].position = 0;
+  }
+
+#if defined(__APPLE__) || defined(__FreeBSD__)
+  fFile = funopen(this, ReadFunction, 0, 0, 0);
+#else
+  cookie_io_functions_t functions;
+  functions.read = ReadCookie;
+  functions.write = 0;
+  functions.seek = SeekFunction;
+  functions.close = 0;
+  fFile = fopencookie(this, "r", functions);
+#endif
+
+  if(!fFile)
+  {
+    fclose(fInputFile);
+    message << "can't open " << fileName;
+    throw runtime_error(message.str());
+  }
+
+  fThread = thread(&DelphesInputFile::Decompress, this);
+}
+
+//------------------------------------------------------------------------------
+
+DelphesInputFile::~DelphesInputFile()
+{
+  if(fFormat != kPlain)
+  {
+    {
+      lock_guard< mutex > lock(fMutex);
+      fStop = true;
+    }
+    fCondition.notify_all();
+    if(fThread.joinable()) fThread.join();
+
+    if(fFile) fclose(fFile);
+  }
+
+  if(fInputFile && fInputFile != stdin) fclose(fInputFile);
+}
+
+//------------------------------------------------------------------------------
+
+long long DelphesInputFile::GetPosition() const
+{
+  if(fFormat == kPlain) return ftello(fFile);
+  return fPosition.load();
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesInputFile::Decompress()
+{
+  try
+  {
+    if(fFormat == kGzip) DecompressGzip();
+    else if(fFormat == kZstd) DecompressZstd();
+    else if(fFormat == kXz) DecompressXz();
+  }
+  catch(runtime_error &e)
+  {
+    lock_guard< mutex > lock(fMutex);
+    fError = e.what();
+  }
+
+  {
+    lock_guard< mutex > lock(fMutex);
+    fFinished = true;
+  }
+  fCondition.notify_all();
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesInputFile::DecompressGzip()
+{
+#ifdef HAS_ZLIB
+  vector< char > input(kInputSize);
+  Chunk *chunk;
+  z_stream stream;
+  long long total = 0;
+  size_t count;
+  bool end = true, eof = false;
+  int rc;
+
+  memset(&stream, 0, sizeof(stream));
+  if(inflateInit2(&stream, 15 + 32) != Z_OK)
+  {
+    throw runtime_error("can't initialize zlib");
+  }
+
+  chunk = AcquireChunk();
+  while(chunk)
+  {
+    if(stream.avail_in == 0 && !eof)
+    {
+      count = fread(&input[0], 1, input.size(), fInputFile);
+      total += count;
+      eof = (count == 0);
+      stream.next_in = reinterpret_cast< Bytef * >(&input[0]);
+      stream.avail_in = count;
+    }
+
+    stream.next_out = reinterpret_cast< Bytef * >(&chunk->data[chunk->size]);
+    stream.avail_out = chunk->data.size() - chunk->size;
+
+    rc = inflate(&stream, Z_NO_FLUSH);
+    chunk->size = chunk->data.size() - stream.avail_out;
+
+    if(rc == Z_STREAM_END)
+    {
+      // the next member of a concatenated file can follow
+      end = true;
+      inflateReset(&stream);
+    }
+    else if(rc == Z_OK)
+    {
+      end = false;
+    }
+    else if(rc != Z_BUF_ERROR)
+    {
+      break;
+    }
+
+    chunk->position = total - stream.avail_in;
+
+    if(chunk->size == chunk->data.size())
+    {
+      SubmitChunk();
+      chunk = AcquireChunk();
+    }
+    else if(eof && stream.avail_in == 0)
+    {
+      break;
+    }
+  }
+
+  inflateEnd(&stream);
+
+  if(chunk && chunk->size > 0) SubmitChunk();
+
+  if(chunk && !(end && eof))
+  {
+    throw runtime_error("invalid or truncated gzip input");
+  }
+#endif
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesInputFile::DecompressZstd()
+{
+#ifdef HAS_ZSTD
+  vector< char > input(kInputSize);
+  ZSTD_DStream *stream;
+  ZSTD_inBuffer in;
+  ZSTD_outBuffer out;
+  Chunk *chunk;
+  long long total = 0;
+  bool end = false, eof = false, failed = false;
+  size_t rc, consumed, produced;
+
+  stream = ZSTD_createDStream();
+  if(!stream || ZSTD_isError(ZSTD_initDStream(stream)))
+  {
+    if(stream) ZSTD_freeDStream(stream);
+    throw runtime_error("can't initialize zstd");
+  }
+
+  in.src = &input[0];
+  in.size = 0;
+  in.pos = 0;
+
+  chunk = AcquireChunk();
+  while(chunk)
+  {
+    if(in.pos == in.size && !eof)
+    {
+      in.size = fread(&input[0], 1, input.size(), fInputFile);
+      in.pos = 0;
+      total += in.size;
+      eof = (in.size == 0);
+    }
+
+    out.dst = &chunk->data[0];
+    out.size = chunk->data.size();
+    out.pos = chunk->size;
+
+    consumed = in.pos;
+    produced = out.pos;
+
+    rc = ZSTD_decompressStream(stream, &out, &in);
+    if(ZSTD_isError(rc))
+    {
+      failed = true;
+      break;
+    }
+
+    // zero once a frame is complete, the last call at the end does nothing
+    if(in.pos != consumed || out.pos != produced) end = (rc == 0);
+    chunk->size = out.pos;
+    chunk->position = total - (in.size - in.pos);
+
+    if(chunk->size == chunk->data.size())
+    {
+      SubmitChunk();
+      chunk = AcquireChunk();
+    }
+    else if(eof && in.pos == in.size)
+    {
+      break;
+    }
+  }
+
+  ZSTD_freeDStream(stream);
+
+  if(chunk && chunk->size > 0) SubmitChunk();
+
+  if(chunk && (failed || !end))
+  {
+    throw runtime_error("invalid or truncated zstd input");
+  }
+#endif
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesInputFile::DecompressXz()
+{
+#ifdef HAS_LZMA
+  vector< char > input(kInputSize);
+  lzma_stream stream = LZMA_STREAM_INIT;
+  lzma_action action = LZMA_RUN;
+  lzma_ret rc = LZMA_OK;
+  Chunk *chunk;
+  long long total = 0;
+  size_t count;
+
+  if(lzma_stream_decoder(&stream, UINT64_MAX, LZMA_CONCATENATED) != LZMA_OK)
+  {
+    throw runtime_error("can't initialize liblzma");
+  }
+
+  chunk = AcquireChunk();
+  while(chunk)
+  {
+    if(stream.avail_in == 0 && action == LZMA_RUN)
+    {
+      count = fread(&input[0], 1, input.size(), fInputFile);
+      total += count;
+      if(count == 0) action = LZMA_FINISH;
+      stream.next_in = reinterpret_cast< uint8_t * >(&input[0]);
+      stream.avail_in = count;
+    }
+
+    stream.next_out = reinterpret_cast< uint8_t * >(&chunk->data[chunk->size]);
+    stream.avail_out = chunk->data.size() - chunk->size;
+
+    rc = lzma_code(&stream, action);
+    chunk->size = chunk->data.size() - stream.avail_out;
+    chunk->position = total - stream.avail_in;
+
+    if(rc != LZMA_OK) break;
+
+    if(chunk->size == chunk->data.size())
+    {
+      SubmitChunk();
+      chunk = AcquireChunk();
+    }
+  }
+
+  lzma_end(&stream);
+
+  if(chunk && chunk->size > 0) SubmitChunk();
+
+  if(chunk && rc != LZMA_STREAM_END)
+  {
+    throw runtime_error("invalid or truncated xz input");
+  }
+#endif
+}
+
+//------------------------------------------------------------------------------
+
+DelphesInputFile::Chunk *DelphesInputFile::AcquireChunk()
+{
+  Chunk *chunk;
+
+  unique_lock< mutex > lock(fMutex);
+  fCondition.wait(lock, [this] { return fStop || fCount < fChunks.size(); });
+  if(fStop) return 0;
+
+  chunk = &fChunks[(fFirst + fCount) % fChunks.size()];
+  chunk->size = 0;
+  return chunk;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesInputFile::SubmitChunk()
+{
+  {
+    lock_guard< mutex > lock(fMutex);
+    ++fCount;
+  }
+  fCondition.notify_all();
+}
+
+//------------------------------------------------------------------------------
+
+size_t DelphesInputFile::Read(char *buffer, size_t size)
+{
+  size_t count;
+
+  unique_lock< mutex > lock(fMutex);
+  fCondition.wait(lock, [this] { return fCount > 0 || fFinished; });
+
+  if(fCount == 0)
+  {
+    if(!fError.empty())
+    {
+      cerr << "** ERROR: " << fError << endl;
+      fError.clear();
+    }
+    return 0;
+  }
+
+  // the decompression thread does not touch the submitted chunks
+  Chunk &chunk = fChunks[fFirst];
+  lock.unlock();
+
+  count = min(size, chunk.size - fOffset);
+  memcpy(buffer, &chunk.data[fOffset], count);
+  fOffset += count;
+
+  if(fOffset == chunk.size)
+  {
+    fPosition = chunk.position;
+    fOffset = 0;
+
+    lock.lock();
+    fFirst = (fFirst + 1) % fChunks.size();
+    --fCount;
+    lock.unlock();
+    fCondition.notify_all();
+  }
+
+  return count;
+}
+
+//------------------------------------------------------------------------------
+
+ssize_t DelphesInputFile::ReadCookie(void *cookie, char *buffer, size_t size)
+{
+  return static_cast< DelphesInputFile * >(cookie)->Read(buffer, size);
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,108 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DelphesInputFile_h
+#define DelphesInputFile_h
+
+/** \class DelphesInputFile
+ *
+ *  Opens an input file of the readers and decompresses it on the fly.
+ *
+ *  The gzip, zstd and xz files are recognised by their first bytes and
+ *  decompressed by a background thread into a ring buffer, which is read
+ *  through the FILE of GetFile. GetPosition is the number of bytes of the
+ *  compressed file consumed so far, so that the progress can be shown as
+ *  for the uncompressed files. The standard input is read as it is.
+ *
+ */
+
+#include <stdio.h>
+#include <sys/types.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class DelphesInputFile
+{
+public:
+
+  // reads the standard input with a null fileName or "-"
+  DelphesInputFile(const char *fileName);
+  ~DelphesInputFile();
+
+  FILE *GetFile() const { return fFile; }
+
+  // size of the file on disk, -1 for the standard input
+  long long GetLength() const { return fLength; }
+
+  long long GetPosition() const;
+
+  bool IsCompressed() const { return fFormat != kPlain; }
+
+  // read function of the FILE of the compressed files
+  static ssize_t ReadCookie(void *cookie, char *buffer, size_t size);
+
+private:
+
+  enum Format
+  {
+    kPlain,
+    kGzip,
+    kZstd,
+    kXz
+  };
+
+  struct Chunk
+  {
+    std::vector< char > data;
+    size_t size;
+    long long position;
+  };
+
+  void Decompress();
+  void DecompressGzip();
+  void DecompressZstd();
+  void DecompressXz();
+
+  // called by the decompression thread, false once it has to stop
+  Chunk *AcquireChunk();
+  void SubmitChunk();
+
+  size_t Read(char *buffer, size_t size);
+
+  Format fFormat;
+  FILE *fInputFile, *fFile;
+  long long fLength;
+
+  std::vector< Chunk > fChunks;
+  size_t fFirst, fCount, fOffset;
+  bool fFinished, fStop;
+  std::string fError;
+
+  std::atomic< long long > fPosition;
+
+  std::mutex fMutex;
+  std::condition_variable fCondition;
+  std::thread fThread;
+};
+
+#endif // DelphesInputFile_h
@@ -0,0 +1,141 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/** \class DelphesKinematics
+ *
+ *  Kinematics of the candidates of an array as one float array per
+ *  quantity, shared by the modules of an event.
+ *
+ */
+
+#include "classes/DelphesKinematics.h"
+
+#include "classes/DelphesClasses.h"
+
+#include "TObjArray.h"
+
+#include <cmath>
+
+using namespace std;
+
+const Double_t DelphesKinematics::kGridCellSize = 0.4;
+const Double_t DelphesKinematics::kGridEtaMax = 5.0;
+
+//------------------------------------------------------------------------------
+
+void DelphesKinematics::Reset()
+{
+  map< const TObjArray *, Entry >::iterator itEntries;
+
+  // the vectors keep their memory for the next event
+  for(itEntries = fEntries.begin(); itEntries != fEntries.end(); ++itEntries)
+  {
+    itEntries->second.valid = kFALSE;
+    itEntries->second.gridValid = kFALSE;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesKinematics::Invalidate(const TObjArray *array)
+{
+  lock_guard< mutex > lock(fMutex);
+  map< const TObjArray *, Entry >::iterator itEntries = fEntries.find(array);
+
+  if(itEntries != fEntries.end())
+  {
+    itEntries->second.valid = kFALSE;
+    itEntries->second.gridValid = kFALSE;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+const DelphesKinematics::View &DelphesKinematics::Get(const TObjArray *array)
+{
+  // the modules of an event may ask at the same time, the entries of
+  // the map never move once inserted
+  lock_guard< mutex > lock(fMutex);
+  Entry &entry = fEntries[array];
+
+  if(!entry.valid || entry.size != array->GetEntriesFast()) Fill(entry, array);
+
+  return entry;
+}
+
+//------------------------------------------------------------------------------
+
+const DelphesEtaPhiGrid &DelphesKinematics::GetGrid(const TObjArray *array)
+{
+  lock_guard< mutex > lock(fMutex);
+  Entry &entry = fEntries[array];
+
+  if(!entry.gridValid || entry.gridSize != array->GetEntriesFast())
+  {
+    entry.grid.Fill(array);
+    entry.gridSize = array->GetEntriesFast();
+    entry.gridValid = kTRUE;
+  }
+
+  return entry.grid;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesKinematics::Fill(Entry &entry, const TObjArray *array)
+{
+  Candidate *candidate;
+  Double_t px, py, pz, pt;
+  Int_t i;
+
+  entry.size = array->GetEntriesFast();
+
+  entry.px.resize(entry.size);
+  entry.py.resize(entry.size);
+  entry.pz.resize(entry.size);
+  entry.e.resize(entry.size);
+  entry.pt.resize(entry.size);
+  entry.eta.resize(entry.size);
+  entry.phi.resize(entry.size);
+  entry.candidates.resize(entry.size);
+
+  for(i = 0; i < entry.size; ++i)
+  {
+    candidate = static_cast< Candidate * >(array->UncheckedAt(i));
+    const TLorentzVector &momentum = candidate->Momentum;
+
+    px = momentum.Px();
+    py = momentum.Py();
+    pz = momentum.Pz();
+    pt = sqrt(px*px + py*py);
+
+    entry.px[i] = px;
+    entry.py[i] = py;
+    entry.pz[i] = pz;
+    entry.e[i] = momentum.E();
+    entry.pt[i] = pt;
+    entry.eta[i] = pt > 0.0 ? asinh(pz/pt) : (pz >= 0.0 ? 10.0E10 : -10.0E10);
+    entry.phi[i] = (px == 0.0 && py == 0.0) ? 0.0 : atan2(py, px);
+    entry.candidates[i] = candidate;
+  }
+
+  entry.valid = kTRUE;
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,94 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DelphesKinematics_h
+#define DelphesKinematics_h
+
+/** \class DelphesKinematics
+ *
+ *  Kinematics of the candidates of an array as one float array per
+ *  quantity, px, py, pz, E, pt, eta and phi of Candidate::Momentum, next
+ *  to the candidates in the order of the array, for the Delta R and cone
+ *  loops that the compiler can then vectorize.
+ *
+ *  The factory keeps one set per event: the arrays of an input are built
+ *  by the first module that asks for them and shared by all the others,
+ *  until the input grows, a module updating it in place has run or the
+ *  event ends. The eta of a candidate along the beam is +-10e10, as with
+ *  TLorentzVector::Eta, and its phi is zero.
+ *
+ *  The eta-phi index of an array, for the cone searches, is shared in the
+ *  same way, built by the first module of the event that asks for it.
+ *
+ */
+
+#include "classes/DelphesEtaPhiGrid.h"
+
+#include "Rtypes.h"
+
+#include <map>
+#include <mutex>
+#include <vector>
+
+class TObjArray;
+
+class Candidate;
+
+class DelphesKinematics
+{
+public:
+
+  struct View
+  {
+    Int_t size;
+    std::vector< Float_t > px, py, pz, e, pt, eta, phi;
+    std::vector< Candidate * > candidates;
+  };
+
+  // forgets all the arrays, at the start of every event
+  void Reset();
+
+  // forgets the arrays of an input whose candidates have changed
+  void Invalidate(const TObjArray *array);
+
+  const View &Get(const TObjArray *array);
+
+  // index of the candidates of the array with cells of kGridCellSize,
+  // cone searches of any size find the same candidates in it
+  const DelphesEtaPhiGrid &GetGrid(const TObjArray *array);
+
+  static const Double_t kGridCellSize;
+  static const Double_t kGridEtaMax;
+
+private:
+
+  struct Entry : View
+  {
+    Entry() : valid(kFALSE), gridValid(kFALSE), gridSize(0), grid(kGridCellSize, kGridEtaMax) {}
+    Bool_t valid, gridValid;
+    Int_t gridSize;
+    DelphesEtaPhiGrid grid;
+  };
+
+  static void Fill(Entry &entry, const TObjArray *array);
+
+  std::map< const TObjArray *, Entry > fEntries;
+  std::mutex fMutex;
+};
+
+#endif /* DelphesKinematics_h */
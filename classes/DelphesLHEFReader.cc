@@ -32,46 +32,45 @@
 #include <sstream>
 
 #include <stdio.h>
+#include <string.h>
 
 #include "TObjArray.h"
 #include "TStopwatch.h"
-#include "TDatabasePDG.h"
-#include "TParticlePDG.h"
 #include "TLorentzVector.h"
 
 #include "classes/DelphesClasses.h"
 #include "classes/DelphesFactory.h"
 #include "classes/DelphesStream.h"
+#include "classes/DelphesPDGTable.h"
+#include "classes/DelphesLineReader.h"
 
 #include "ExRootAnalysis/ExRootTreeBranch.h"
 
 using namespace std;
 
-static const int kBufferSize  = 1024;
-
 //---------------------------------------------------------------------------
 
 DelphesLHEFReader::DelphesLHEFReader() :
-  fInputFile(0), fBuffer(0), fPDG(0),
+  fLineReader(0), fPDG(0),
   fEventReady(kFALSE), fEventCounter(-1), fParticleCounter(-1)
 {
-  fBuffer = new char[kBufferSize];
+  fLineReader = new DelphesLineReader;
 
-  fPDG = TDatabasePDG::Instance();
+  fPDG = DelphesPDGTable::Instance();
 }
 
 //---------------------------------------------------------------------------
 
 DelphesLHEFReader::~DelphesLHEFReader()
 {
-  if(fBuffer) delete[] fBuffer;
+  if(fLineReader) delete fLineReader;
 }
 
 //---------------------------------------------------------------------------
 
 void DelphesLHEFReader::SetInputFile(FILE *inputFile)
 {
-  fInputFile = inputFile;
+  fLineReader->SetInputFile(inputFile);
 }
 
 //---------------------------------------------------------------------------
@@ -81,6 +80,7 @@ void DelphesLHEFReader::Clear()
   fEventReady = kFALSE;
   fEventCounter = -1;
   fParticleCounter = -1;
+  fWeightBlock.clear();
   fWeightList.clear();
 }
 
@@ -98,20 +98,23 @@ bool DelphesLHEFReader::ReadBlock(DelphesFactory *factory,
   TObjArray *stableParticleOutputArray,
   TObjArray *partonOutputArray)
 {
-  int rc, id;
-  char *pch;
-  double weight;
+  int rc;
+  char *line, *tag;
+
+  line = fLineReader->ReadLine();
+  if(!line) return kFALSE;
 
-  if(!fgets(fBuffer, kBufferSize, fInputFile)) return kFALSE;
+  // only the lines with a tag are compared with the tag names
+  tag = strchr(line, '<');
 
-  if(strstr(fBuffer, "<event>"))
+  if(tag && strstr(tag, "<event>"))
   {
     Clear();
     fEventCounter = 1;
   }
   else if(fEventCounter > 0)
   {
-    DelphesStream bufferStream(fBuffer);
+    DelphesStream bufferStream(line);
 
     rc = bufferStream.ReadInt(fParticleCounter)
       && bufferStream.ReadInt(fProcessID)
@@ -130,7 +133,7 @@ bool DelphesLHEFReader::ReadBlock(DelphesFactory *factory,
   }
   else if(fParticleCounter > 0)
   {
-    DelphesStream bufferStream(fBuffer);
+    DelphesStream bufferStream(line);
 
     rc = bufferStream.ReadInt(fPID)
       && bufferStream.ReadInt(fStatus)
@@ -155,26 +158,53 @@ bool DelphesLHEFReader::ReadBlock(DelphesFactory *factory,
 
     --fParticleCounter;
   }
-  else if(strstr(fBuffer, "<wgt"))
+  else if(tag && strstr(tag, "<wgt"))
+  {
+    // samples with hundreds of variations would spend more time on the
+    // weights than on the particles, so they are parsed only when needed
+    fWeightBlock.append(tag);
+    fWeightBlock.push_back('\n');
+  }
+  else if(tag && strstr(tag, "</event>"))
+  {
+    fEventReady = kTRUE;
+  }
+
+  return kTRUE;
+}
+
+//---------------------------------------------------------------------------
+
+bool DelphesLHEFReader::ParseWeights()
+{
+  int rc, id;
+  const char *line, *end, *pch;
+  double weight;
+
+  fWeightList.clear();
+
+  for(line = fWeightBlock.c_str(); *line; line = end + 1)
   {
-    pch = strpbrk(fBuffer, "\"'");
-    if(!pch)
+    end = strchr(line, '\n');
+
+    pch = strpbrk(line, "\"'");
+    if(!pch || pch > end)
     {
       cerr << "** ERROR: " << "invalid weight format" << endl;
       return kFALSE;
     }
 
-    DelphesStream idStream(pch + 1);
+    DelphesStream idStream(const_cast<char *>(pch + 1));
     rc = idStream.ReadInt(id);
 
-    pch = strchr(fBuffer, '>');
-    if(!pch)
+    pch = strchr(line, '>');
+    if(!pch || pch > end)
     {
       cerr << "** ERROR: " << "invalid weight format" << endl;
       return kFALSE;
     }
 
-    DelphesStream weightStream(pch + 1);
+    DelphesStream weightStream(const_cast<char *>(pch + 1));
     rc = weightStream.ReadDbl(weight);
 
     if(!rc)
@@ -185,10 +215,6 @@ bool DelphesLHEFReader::ReadBlock(DelphesFactory *factory,
 
     fWeightList.push_back(make_pair(id, weight));
   }
-  else if(strstr(fBuffer, "</event>"))
-  {
-    fEventReady = kTRUE;
-  }
 
   return kTRUE;
 }
@@ -220,6 +246,8 @@ void DelphesLHEFReader::AnalyzeWeight(ExRootTreeBranch *branch)
   LHEFWeight *element;
   vector< pair< int, double > >::const_iterator itWeightList;
 
+  if(!ParseWeights()) return;
+
   for(itWeightList = fWeightList.begin(); itWeightList != fWeightList.end(); ++itWeightList)
   {
     element = static_cast<LHEFWeight *>(branch->NewEntry());
@@ -237,7 +265,7 @@ void DelphesLHEFReader::AnalyzeParticle(DelphesFactory *factory,
   TObjArray *partonOutputArray)
 {
   Candidate *candidate;
-  TParticlePDG *pdgParticle;
+  const DelphesPDGTable::Entry *pdgParticle;
   int pdgCode;
 
   candidate = factory->NewCandidate();
@@ -247,8 +275,8 @@ void DelphesLHEFReader::AnalyzeParticle(DelphesFactory *factory,
 
   candidate->Status = fStatus;
 
-  pdgParticle = fPDG->GetParticle(fPID);
-  candidate->Charge = pdgParticle ? int(pdgParticle->Charge()/3.0) : -999;
+  pdgParticle = fPDG->Find(fPID);
+  candidate->Charge = pdgParticle ? pdgParticle->charge : -999;
   candidate->Mass = fMass;
 
   candidate->Momentum.SetPxPyPzE(fPx, fPy, fPz, fE);
@@ -264,7 +292,7 @@ void DelphesLHEFReader::AnalyzeParticle(DelphesFactory *factory,
 
   if(!pdgParticle) return;
 
-  if(fStatus == 1 && pdgParticle->Stable())
+  if(fStatus == 1 && pdgParticle->stable)
   {
     stableParticleOutputArray->Add(candidate);
   }
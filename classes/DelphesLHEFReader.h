@@ -29,14 +29,16 @@
 
 #include <stdio.h>
 
+#include <string>
 #include <vector>
 #include <utility>
 
 class TObjArray;
 class TStopwatch;
-class TDatabasePDG;
+class DelphesPDGTable;
 class ExRootTreeBranch;
 class DelphesFactory;
+class DelphesLineReader;
 
 class DelphesLHEFReader
 {
@@ -67,11 +69,11 @@ private:
     TObjArray *stableParticleOutputArray,
     TObjArray *partonOutputArray);
 
-  FILE *fInputFile;
+  bool ParseWeights();
 
-  char *fBuffer;
+  DelphesLineReader *fLineReader;
 
-  TDatabasePDG *fPDG;
+  const DelphesPDGTable *fPDG;
 
   bool fEventReady;
 
@@ -83,6 +85,9 @@ private:
   int fPID, fStatus, fM1, fM2, fC1, fC2;
   double fPx, fPy, fPz, fE, fMass;
   
+  // the <wgt> lines of the event as they are, only parsed into
+  // fWeightList when AnalyzeWeight is called
+  std::string fWeightBlock;
   std::vector< std::pair< int, double > > fWeightList;
 };
 
@@ -0,0 +1,165 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/** \class DelphesLineReader
+ *
+ *  Reads a text file in large blocks and returns it line by line.
+ *
+ */
+
+#include "classes/DelphesLineReader.h"
+
+#include <string.h>
+
+using namespace std;
+
+static const size_t kBufferSize = 1 << 20;
+
+//------------------------------------------------------------------------------
+
+DelphesLineReader::DelphesLineReader() :
+  fInputFile(0), fBuffer(0), fBufferSize(kBufferSize), fBegin(0), fEnd(0), fPosition(0), fLine(0), fUnread(false)
+{
+  fBuffer = new char[fBufferSize];
+  fBegin = fEnd = fBuffer;
+}
+
+//------------------------------------------------------------------------------
+
+DelphesLineReader::~DelphesLineReader()
+{
+  if(fBuffer) delete[] fBuffer;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesLineReader::SetInputFile(FILE *inputFile)
+{
+  fInputFile = inputFile;
+  fBegin = fEnd = fBuffer;
+  fPosition = inputFile ? ftello(inputFile) : 0;
+  if(fPosition < 0) fPosition = 0;
+  fLine = 0;
+  fUnread = false;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesLineReader::SetInputText(const char *text, size_t size)
+{
+  if(size + 1 > fBufferSize)
+  {
+    delete[] fBuffer;
+    while(size + 1 > fBufferSize) fBufferSize *= 2;
+    fBuffer = new char[fBufferSize];
+  }
+  memcpy(fBuffer, text, size);
+
+  fInputFile = 0;
+  fBegin = fBuffer;
+  fEnd = fBuffer + size;
+  fPosition = size;
+  fLine = 0;
+  fUnread = false;
+}
+
+//------------------------------------------------------------------------------
+
+char *DelphesLineReader::ReadLine()
+{
+  char *newline, *buffer;
+  size_t size, count;
+
+  if(fUnread)
+  {
+    fUnread = false;
+    return fLine;
+  }
+
+  while(true)
+  {
+    newline = static_cast<char *>(memchr(fBegin, '\n', fEnd - fBegin));
+    if(newline)
+    {
+      *newline = '\0';
+      fLine = fBegin;
+      fBegin = newline + 1;
+      return fLine;
+    }
+
+    // last line of a text without end of line character
+    if(!fInputFile)
+    {
+      if(fBegin == fEnd) return 0;
+      *fEnd = '\0';
+      fLine = fBegin;
+      fBegin = fEnd;
+      return fLine;
+    }
+
+    // move the incomplete line to the front and grow the buffer if it
+    // does not leave room for more, one byte is kept for the terminator
+    size = fEnd - fBegin;
+    if(size + 1 >= fBufferSize)
+    {
+      buffer = new char[2*fBufferSize];
+      memcpy(buffer, fBegin, size);
+      delete[] fBuffer;
+      fBuffer = buffer;
+      fBufferSize *= 2;
+    }
+    else if(fBegin != fBuffer)
+    {
+      memmove(fBuffer, fBegin, size);
+    }
+    fBegin = fBuffer;
+    fEnd = fBuffer + size;
+
+    count = fread(fEnd, 1, fBufferSize - size - 1, fInputFile);
+    if(count > 0)
+    {
+      fEnd += count;
+      fPosition += count;
+      continue;
+    }
+
+    // last line without end of line character
+    if(size == 0) return 0;
+    *fEnd = '\0';
+    fLine = fBegin;
+    fBegin = fEnd;
+    return fLine;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesLineReader::UnreadLine()
+{
+  if(fLine) fUnread = true;
+}
+
+//------------------------------------------------------------------------------
+
+long long DelphesLineReader::GetPosition() const
+{
+  return fPosition - (fEnd - (fUnread ? fLine : fBegin));
+}
+
+//------------------------------------------------------------------------------
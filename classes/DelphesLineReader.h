@@ -0,0 +1,72 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DelphesLineReader_h
+#define DelphesLineReader_h
+
+/** \class DelphesLineReader
+ *
+ *  Reads a text file in large blocks and returns it line by line.
+ *
+ *  The lines are returned without the end of line character and stay
+ *  valid until the next call of ReadLine. Several readers of the same
+ *  file have to share one DelphesLineReader, since it reads ahead.
+ *
+ */
+
+#include <stdio.h>
+
+class DelphesLineReader
+{
+public:
+
+  DelphesLineReader();
+  ~DelphesLineReader();
+
+  void SetInputFile(FILE *inputFile);
+
+  // reads the lines of text instead of a file, the text is copied
+  void SetInputText(const char *text, size_t size);
+
+  // returns the next line or null at the end of the file
+  char *ReadLine();
+
+  // the next call of ReadLine returns the last line again
+  void UnreadLine();
+
+  // offset in the file of the first line not returned yet
+  long long GetPosition() const;
+
+private:
+
+  FILE *fInputFile;
+
+  char *fBuffer;
+  size_t fBufferSize;
+
+  // unread part of the buffer
+  char *fBegin, *fEnd;
+
+  // offset in the file of fEnd
+  long long fPosition;
+
+  char *fLine;
+  bool fUnread;
+};
+
+#endif // DelphesLineReader_h
@@ -37,7 +37,9 @@
 #include "TROOT.h"
 #include "TClass.h"
 #include "TFolder.h"
+#include "TString.h"
 #include "TObjArray.h"
+#include "TRandom3.h"
 
 #include <iostream>
 #include <stdexcept>
@@ -45,9 +47,24 @@
 
 using namespace std;
 
+//------------------------------------------------------------------------------
+
+// splitmix64 finalizer, spreads nearby seeds and event numbers apart
+
+static ULong64_t MixBits(ULong64_t x)
+{
+  x += 0x9E3779B97F4A7C15ULL;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+  return x ^ (x >> 31);
+}
+
+//------------------------------------------------------------------------------
+
 DelphesModule::DelphesModule() :
   fTreeWriter(0), fFactory(0), fPlots(0),
-  fPlotFolder(0), fExportFolder(0)
+  fPlotFolder(0), fExportFolder(0), fRandom(0), fRandomKey(0), fGaussians(0),
+  fAnnotate(kFALSE)
 {
 }
 
@@ -55,6 +72,8 @@ DelphesModule::DelphesModule() :
 
 DelphesModule::~DelphesModule()
 {
+  if(fRandom) delete fRandom;
+  if(fGaussians) delete fGaussians;
 }
 
 //------------------------------------------------------------------------------
@@ -90,6 +109,19 @@ TObjArray *DelphesModule::ImportArray(const char *name)
     throw runtime_error(message.str());
   }
 
+  fImportedArrays.push_back(object);
+
+  return object;
+}
+
+//------------------------------------------------------------------------------
+
+TObjArray *DelphesModule::UpdateArray(const char *name)
+{
+  TObjArray *object = ImportArray(name);
+
+  fUpdatedArrays.push_back(object);
+
   return object;
 }
 
@@ -108,6 +140,46 @@ TObjArray *DelphesModule::ExportArray(const char *name)
   array->SetName(name);
   fExportFolder->Add(array);
 
+  fExportedArrays.push_back(array);
+
+  return array;
+}
+
+//------------------------------------------------------------------------------
+
+TObjArray *DelphesModule::ExportArray(const char *name, const char *moduleName)
+{
+  stringstream message;
+  TFolder *folder;
+  TObjArray *array;
+
+  folder = static_cast<TFolder *>(GetObject(Form("Export/%s", moduleName), TFolder::Class()));
+  if(!folder)
+  {
+    folder = static_cast<TFolder *>(GetObject("Export", TFolder::Class()));
+    if(!folder) folder = GetFolder()->AddFolder("Export", "");
+    if(folder) folder = folder->AddFolder(moduleName, "");
+  }
+  if(!folder)
+  {
+    message << "can't create folder 'Export/" << moduleName << "'";
+    throw runtime_error(message.str());
+  }
+
+  if(folder->FindObject(name))
+  {
+    message << "array '" << moduleName << "/" << name;
+    message << "' exported by module '" << GetName() << "' already exists";
+    throw runtime_error(message.str());
+  }
+
+  array = GetFactory()->NewPermanentArray();
+
+  array->SetName(name);
+  folder->Add(array);
+
+  fExportedArrays.push_back(array);
+
   return array;
 }
 
@@ -157,4 +229,53 @@ DelphesFactory *DelphesModule::GetFactory()
   return fFactory;
 }
 
+//------------------------------------------------------------------------------
+
+TRandom *DelphesModule::GetRandom()
+{
+  return fRandom ? fRandom : gRandom;
+}
+
+//------------------------------------------------------------------------------
+
+ULong64_t DelphesModule::RandomStreamKey(UInt_t seed, const char *name)
+{
+  return MixBits((ULong64_t(seed) << 32) | TString(name).Hash());
+}
+
+//------------------------------------------------------------------------------
+
+UInt_t DelphesModule::RandomStreamSeed(ULong64_t key, Long64_t event)
+{
+  UInt_t seed = UInt_t(MixBits(key ^ MixBits(event)));
+
+  // TRandom3 takes 0 as a request for a seed from the clock
+  return seed ? seed : 1;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesModule::SetRandomStream(UInt_t seed)
+{
+  fRandomKey = RandomStreamKey(seed, GetName());
+  if(!fRandom) fRandom = new TRandom3;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesModule::ResetRandomStream(Long64_t event)
+{
+  if(!fRandom) return;
+
+  fRandom->SetSeed(RandomStreamSeed(fRandomKey, event));
+
+  if(fGaussians) fGaussians->Clear();
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesModule::UseGaussianBuffer()
+{
+  if(!fGaussians) fGaussians = new DelphesGaussianBuffer;
+}
 
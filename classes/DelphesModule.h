@@ -29,10 +29,22 @@
 
 #include "ExRootAnalysis/ExRootTask.h"
 
+#if !defined(__CINT__) && !defined(__CLING__)
+#include "classes/DelphesGaussianBuffer.h"
+
+#include "TRandom.h"
+#endif
+
+#include <vector>
+#include <utility>
+
 class TClass;
 class TObject;
 class TFolder;
 class TClonesArray;
+class TRandom;
+
+class DelphesGaussianBuffer;
 
 class ExRootResult;
 class ExRootTreeBranch;
@@ -54,13 +66,68 @@ public:
   TObjArray *ImportArray(const char *name);
   TObjArray *ExportArray(const char *name);
 
+  // exports the array as if the module moduleName had made it, for modules
+  // that stand in for the ones dropped from a truncated card, see
+  // SnapshotReader
+  TObjArray *ExportArray(const char *name, const char *moduleName);
+
+  // same as ImportArray for modules that modify the candidates of the input
+  // array in place, so that they are not scheduled next to its other users
+  TObjArray *UpdateArray(const char *name);
+
   ExRootTreeBranch *NewBranch(const char *name, TClass *cl);
 
   ExRootResult *GetPlots();
   DelphesFactory *GetFactory();
 
+  // modules that can process events in several Delphes instances at the
+  // same time, or next to the other modules of the same event, return true,
+  // see DelphesWorkerPool and DelphesModuleScheduler
+  virtual Bool_t IsThreadSafe() const { return kFALSE; }
+
+  // modules that may call DelphesFactory::RejectEvent return true, the
+  // modules after them in ExecutionPath then never start before they end
+  virtual Bool_t CanRejectEvent() const { return kFALSE; }
+
+  // true once the module has created branches in the output tree
+  Bool_t WritesTree() const { return fTreeWriter != 0; }
+
+  // random numbers come from gRandom unless the module has its own stream,
+  // which ResetRandomStream reseeds from the seed, the module name and the
+  // event number, so that an event gets the same numbers on any thread
+  TRandom *GetRandom();
+  virtual void SetRandomStream(UInt_t seed);
+  virtual void ResetRandomStream(Long64_t event);
+  Bool_t HasRandomStream() const { return fRandom != 0; }
+
+  // same as GetRandom()->Gaus(mean, sigma), or drawn from blocks of
+  // deviates once UseGaussianBuffer has been called, see
+  // DelphesGaussianBuffer, the blocks are dropped with each reseeding
+  Double_t Gaus(Double_t mean, Double_t sigma);
+  virtual void UseGaussianBuffer();
+
+  // records a value of the current event, such as the number of pile-up
+  // interactions, for the trace file of DelphesProfiler, the name must
+  // outlive the event, nothing is recorded unless tracing is enabled
+  void Annotate(const char *name, Long64_t value);
+  void SetAnnotations(Bool_t enable) { fAnnotate = enable; }
+
+#if !defined(__CINT__) && !defined(__CLING__)
+  const std::vector< std::pair< const char *, Long64_t > > &GetAnnotations() const { return fAnnotations; }
+  void ClearAnnotations() { fAnnotations.clear(); }
+
+  const std::vector< const TObjArray * > &GetImportedArrays() const { return fImportedArrays; }
+  const std::vector< const TObjArray * > &GetUpdatedArrays() const { return fUpdatedArrays; }
+  const std::vector< const TObjArray * > &GetExportedArrays() const { return fExportedArrays; }
+#endif
+
 protected:
 
+  // key of the stream called name and its seed for an event, for modules
+  // that draw from more streams than their own, see TrackingPipeline
+  static ULong64_t RandomStreamKey(UInt_t seed, const char *name);
+  static UInt_t RandomStreamSeed(ULong64_t key, Long64_t event);
+
   ExRootTreeWriter *fTreeWriter;
   DelphesFactory *fFactory;
 
@@ -70,8 +137,37 @@ private:
 
   TFolder *fPlotFolder, *fExportFolder;
 
+  TRandom *fRandom; //!
+  ULong64_t fRandomKey; //!
+  DelphesGaussianBuffer *fGaussians; //!
+
+  Bool_t fAnnotate; //!
+
+#if !defined(__CINT__) && !defined(__CLING__)
+  std::vector< std::pair< const char *, Long64_t > > fAnnotations; //!
+
+  std::vector< const TObjArray * > fImportedArrays; //!
+  std::vector< const TObjArray * > fUpdatedArrays; //!
+  std::vector< const TObjArray * > fExportedArrays; //!
+#endif
+
   ClassDef(DelphesModule, 1)
 };
 
+//------------------------------------------------------------------------------
+
+#if !defined(__CINT__) && !defined(__CLING__)
+inline Double_t DelphesModule::Gaus(Double_t mean, Double_t sigma)
+{
+  if(!fGaussians) return GetRandom()->Gaus(mean, sigma);
+  return mean + sigma*fGaussians->Next(GetRandom());
+}
+
+inline void DelphesModule::Annotate(const char *name, Long64_t value)
+{
+  if(fAnnotate) fAnnotations.push_back(std::make_pair(name, value));
+}
+#endif
+
 #endif /* DelphesModule_h */
 
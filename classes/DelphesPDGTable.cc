@@ -0,0 +1,94 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/** \class DelphesPDGTable
+ *
+ *  Charge, mass and stability of the particles of TDatabasePDG, copied
+ *  once into an array indexed by the PID.
+ *
+ */
+
+#include "classes/DelphesPDGTable.h"
+
+#include "TDatabasePDG.h"
+#include "TParticlePDG.h"
+#include "TList.h"
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+
+const DelphesPDGTable *DelphesPDGTable::Instance()
+{
+  // built by the first thread that gets here, the others wait for it
+  static const DelphesPDGTable table;
+  return &table;
+}
+
+//------------------------------------------------------------------------------
+
+DelphesPDGTable::DelphesPDGTable()
+{
+  TDatabasePDG *pdg = TDatabasePDG::Instance();
+  TParticlePDG *pdgParticle;
+  TObject *object;
+  Entry entry;
+  Int_t pid;
+
+  entry.mass = 0.0;
+  entry.charge = 0;
+  entry.stable = kFALSE;
+  entry.known = kFALSE;
+
+  fDense.assign(2*kRange, entry);
+
+  // the database is read on first use
+  if(!pdg->ParticleList()) pdg->ReadPDGTable();
+  if(!pdg->ParticleList()) return;
+
+  TIter itParticles(pdg->ParticleList());
+  while((object = itParticles.Next()))
+  {
+    pdgParticle = static_cast<TParticlePDG *>(object);
+    pid = pdgParticle->PdgCode();
+
+    // same particle as TDatabasePDG::GetParticle returns for this code
+    if(pdg->GetParticle(pid) != pdgParticle) continue;
+
+    entry.mass = pdgParticle->Mass();
+    entry.charge = Int_t(pdgParticle->Charge()/3.0);
+    entry.stable = pdgParticle->Stable();
+    entry.known = kTRUE;
+
+    if(pid > -kRange && pid < kRange) fDense[pid + kRange] = entry;
+    else fSparse[pid] = entry;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+const DelphesPDGTable::Entry *DelphesPDGTable::FindSparse(Int_t pid) const
+{
+  map<Int_t, Entry>::const_iterator itSparse;
+
+  itSparse = fSparse.find(pid);
+  return itSparse != fSparse.end() ? &itSparse->second : 0;
+}
+
+//------------------------------------------------------------------------------
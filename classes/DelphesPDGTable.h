@@ -0,0 +1,74 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DelphesPDGTable_h
+#define DelphesPDGTable_h
+
+/** \class DelphesPDGTable
+ *
+ *  Charge, mass and stability of the particles of TDatabasePDG, copied
+ *  once into an array indexed by the PID for the usual particles and
+ *  into a map for the others. The table reflects the database as it is
+ *  at the first call of Instance and is then only read, so the readers
+ *  and the modules of all the threads can share it.
+ *
+ */
+
+#include "Rtypes.h"
+
+#include <map>
+#include <vector>
+
+class DelphesPDGTable
+{
+public:
+
+  struct Entry
+  {
+    Double_t mass;
+    Int_t charge; // in units of e, Int_t(TParticlePDG::Charge()/3.0)
+    Bool_t stable;
+    Bool_t known;
+  };
+
+  static const DelphesPDGTable *Instance();
+
+  // null for the particles unknown to TDatabasePDG
+  const Entry *Find(Int_t pid) const
+  {
+    if(pid > -kRange && pid < kRange)
+    {
+      const Entry &entry = fDense[pid + kRange];
+      return entry.known ? &entry : 0;
+    }
+    return FindSparse(pid);
+  }
+
+private:
+
+  static const Int_t kRange = 4096;
+
+  DelphesPDGTable();
+
+  const Entry *FindSparse(Int_t pid) const;
+
+  std::vector<Entry> fDense;
+  std::map<Int_t, Entry> fSparse;
+};
+
+#endif /* DelphesPDGTable_h */
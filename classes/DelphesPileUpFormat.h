@@ -0,0 +1,84 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DelphesPileUpFormat_h
+#define DelphesPileUpFormat_h
+
+/** \file DelphesPileUpFormat.h
+ *
+ *  Layouts of the pile-up binary files.
+ *
+ *  Version 1 is written with XDR: for every event the number of particles
+ *  and then the PID and the eight floats of every particle, all big-endian,
+ *  followed by the offsets of the events and the number of events.
+ *
+ *  Version 2 is little-endian and starts with a 32 byte header: the magic
+ *  string "DPILEUP2", the version, the flags, the number of events and the
+ *  offset of the index. Every event is the number of particles, the number
+ *  of bytes stored and the columns of the event one after the other: PID,
+ *  X, Y, Z, T, Px, Py, Pz, E and, with kPileUpChargeMass, the charge and
+ *  the mass. With kPileUpLZ4 the columns of an event are compressed as one
+ *  LZ4 block, unless that does not make them smaller. The events are
+ *  padded to four bytes and the index holds the 64-bit offsets of the
+ *  events.
+ *
+ */
+
+enum
+{
+  kPileUpVersionXDR = 1,
+  kPileUpVersionColumns = 2
+};
+
+enum
+{
+  kPileUpChargeMass = 1 << 0,
+  kPileUpLZ4 = 1 << 1
+};
+
+static const char kPileUpMagic[8] = {'D', 'P', 'I', 'L', 'E', 'U', 'P', '2'};
+
+static const int kPileUpHeaderSize = 32;
+
+// columns of an event with and without the charge and the mass
+static const int kPileUpColumns = 9;
+static const int kPileUpColumnsChargeMass = 11;
+
+//------------------------------------------------------------------------------
+
+static inline unsigned int PileUpLittleEndian(unsigned int value)
+{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  return __builtin_bswap32(value);
+#else
+  return value;
+#endif
+}
+
+//------------------------------------------------------------------------------
+
+static inline unsigned long long PileUpLittleEndian64(unsigned long long value)
+{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  return __builtin_bswap64(value);
+#else
+  return value;
+#endif
+}
+
+#endif // DelphesPileUpFormat_h
@@ -32,8 +32,17 @@
 #include <sstream>
 
 #include <stdio.h>
+#include <string.h>
 #include <rpc/types.h>
-#include <rpc/xdr.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifdef HAS_LZ4
+#include <lz4.h>
+#endif
 
 using namespace std;
 
@@ -43,20 +52,79 @@ static const int kRecordSize = 9;
 
 //------------------------------------------------------------------------------
 
+// the file is written with XDR, all the values are big-endian
+
+static inline unsigned int DecodeInt(const unsigned char *data)
+{
+  return (unsigned int)(data[0]) << 24 | (unsigned int)(data[1]) << 16 |
+    (unsigned int)(data[2]) << 8 | (unsigned int)(data[3]);
+}
+
+//------------------------------------------------------------------------------
+
+static inline quad_t DecodeHyper(const unsigned char *data)
+{
+  return quad_t((unsigned long long)(DecodeInt(data)) << 32 | DecodeInt(data + 4));
+}
+
+//------------------------------------------------------------------------------
+
 DelphesPileUpReader::DelphesPileUpReader(const char *fileName) :
-  fEntries(0), fEntrySize(0), fCounter(0),
-  fPileUpFile(0), fIndex(0), fBuffer(0),
-  fInputXDR(0), fIndexXDR(0), fBufferXDR(0)
+  fVersion(kPileUpVersionXDR), fFlags(0), fColumns(kRecordSize),
+  fEntries(0), fIndexOffset(0), fEntrySize(0), fCounter(0),
+  fPileUpFile(0), fMap(0), fMapSize(0),
+  fIndex(0), fBuffer(0), fRecords(0), fBlock(0)
 {
   stringstream message;
+  unsigned char data[kPileUpHeaderSize];
+  struct stat status;
+  void *map;
+  int descriptor;
+
+  fRecords = new unsigned int[kBufferSize*kPileUpColumnsChargeMass];
+
+  descriptor = open(fileName, O_RDONLY);
+  if(descriptor >= 0 && fstat(descriptor, &status) == 0 && S_ISREG(status.st_mode) && status.st_size >= 8)
+  {
+    map = mmap(0, status.st_size, PROT_READ, MAP_SHARED, descriptor, 0);
+    if(map != MAP_FAILED)
+    {
+      fMap = static_cast<const unsigned char *>(map);
+      fMapSize = status.st_size;
+
+      // the events are read in a random order
+      madvise(map, fMapSize, MADV_RANDOM);
+    }
+  }
+  if(descriptor >= 0) close(descriptor);
+
+  if(fMap)
+  {
+    if(fMapSize >= size_t(kPileUpHeaderSize) && memcmp(fMap, kPileUpMagic, 8) == 0)
+    {
+      ReadHeader(fMap, fileName);
+
+      if(fIndexOffset < kPileUpHeaderSize || size_t(fEntries) > (fMapSize - fIndexOffset)/8)
+      {
+        message << "corrupted pile-up file " << fileName;
+        throw runtime_error(message.str());
+      }
+      return;
+    }
+
+    // read number of events
+    fEntries = DecodeHyper(fMap + fMapSize - 8);
+
+    if(fEntries < 0 || size_t(fEntries) > (fMapSize - 8)/8)
+    {
+      message << "corrupted pile-up file " << fileName;
+      throw runtime_error(message.str());
+    }
+    return;
+  }
 
-  fIndex = new char[kIndexSize*8];
-  fBuffer = new char[kBufferSize*kRecordSize*4];
-  fInputXDR = new XDR;
-  fIndexXDR = new XDR;
-  fBufferXDR = new XDR;
-  xdrmem_create(fIndexXDR, fIndex, kIndexSize*8, XDR_DECODE);
-  xdrmem_create(fBufferXDR, fBuffer, kBufferSize*kRecordSize*4, XDR_DECODE);
+  fIndex = new unsigned char[kIndexSize*8];
+  fBuffer = new unsigned char[kBufferSize*kPileUpColumnsChargeMass*4];
 
   fPileUpFile = fopen(fileName, "r");
 
@@ -66,11 +134,24 @@ DelphesPileUpReader::DelphesPileUpReader(const char *fileName) :
     throw runtime_error(message.str());
   }
 
-  xdrstdio_create(fInputXDR, fPileUpFile, XDR_DECODE);
-
-  // read number of events
-  fseeko(fPileUpFile, -8, SEEK_END);
-  xdr_hyper(fInputXDR, &fEntries);
+  if(fread(data, 1, kPileUpHeaderSize, fPileUpFile) == size_t(kPileUpHeaderSize) &&
+    memcmp(data, kPileUpMagic, 8) == 0)
+  {
+    ReadHeader(data, fileName);
+    fseeko(fPileUpFile, fIndexOffset, SEEK_SET);
+  }
+  else
+  {
+    // read number of events
+    fseeko(fPileUpFile, -8, SEEK_END);
+    if(fread(data, 1, 8, fPileUpFile) != 8)
+    {
+      message << "can't read pile-up file " << fileName;
+      throw runtime_error(message.str());
+    }
+    fEntries = DecodeHyper(data);
+    fseeko(fPileUpFile, -8 - 8*fEntries, SEEK_END);
+  }
 
   if(fEntries >= kIndexSize)
   {
@@ -79,42 +160,132 @@ DelphesPileUpReader::DelphesPileUpReader(const char *fileName) :
   }
 
   // read index of events
-  fseeko(fPileUpFile, -8 - 8*fEntries, SEEK_END);
-  xdr_opaque(fInputXDR, fIndex, fEntries*8);
+  if(fread(fIndex, 1, fEntries*8, fPileUpFile) != size_t(fEntries*8))
+  {
+    message << "can't read pile-up file " << fileName;
+    throw runtime_error(message.str());
+  }
 }
 
 //------------------------------------------------------------------------------
 
 DelphesPileUpReader::~DelphesPileUpReader()
 {
-  xdr_destroy(fInputXDR);
+  if(fMap) munmap(const_cast<unsigned char *>(fMap), fMapSize);
   if(fPileUpFile) fclose(fPileUpFile);
-  xdr_destroy(fBufferXDR);
-  xdr_destroy(fIndexXDR);
-  if(fBufferXDR) delete fBufferXDR;
-  if(fIndexXDR) delete fIndexXDR;
-  if(fInputXDR) delete fInputXDR;
+  if(fRecords) delete[] fRecords;
   if(fBuffer) delete[] fBuffer;
   if(fIndex) delete[] fIndex;
 }
 
 //------------------------------------------------------------------------------
 
+void DelphesPileUpReader::ReadHeader(const unsigned char *header, const char *fileName)
+{
+  stringstream message;
+  unsigned int words[2];
+  unsigned long long values[2];
+
+  memcpy(words, header + 8, 8);
+  memcpy(values, header + 16, 16);
+
+  fVersion = int(PileUpLittleEndian(words[0]));
+  fFlags = PileUpLittleEndian(words[1]);
+  fEntries = quad_t(PileUpLittleEndian64(values[0]));
+  fIndexOffset = quad_t(PileUpLittleEndian64(values[1]));
+
+  if(fVersion != kPileUpVersionColumns)
+  {
+    message << "unknown version " << fVersion << " of pile-up file " << fileName;
+    throw runtime_error(message.str());
+  }
+
+#ifndef HAS_LZ4
+  if(fFlags & kPileUpLZ4)
+  {
+    message << "Delphes was built without LZ4, can't read pile-up file " << fileName;
+    throw runtime_error(message.str());
+  }
+#endif
+
+  if(fEntries < 0)
+  {
+    message << "corrupted pile-up file " << fileName;
+    throw runtime_error(message.str());
+  }
+
+  fColumns = (fFlags & kPileUpChargeMass) ? kPileUpColumnsChargeMass : kPileUpColumns;
+}
+
+//------------------------------------------------------------------------------
+
 bool DelphesPileUpReader::ReadParticle(int &pid,
   float &x, float &y, float &z, float &t,
   float &px, float &py, float &pz, float &e)
 {
+  int charge;
+  float mass;
+
+  return ReadParticle(pid, x, y, z, t, px, py, pz, e, charge, mass);
+}
+
+//------------------------------------------------------------------------------
+
+bool DelphesPileUpReader::ReadParticle(int &pid,
+  float &x, float &y, float &z, float &t,
+  float &px, float &py, float &pz, float &e,
+  int &charge, float &mass)
+{
+  const unsigned int *record;
+  int n;
+
   if(fCounter >= fEntrySize) return false;
 
-  xdr_int(fBufferXDR, &pid);
-  xdr_float(fBufferXDR, &x);
-  xdr_float(fBufferXDR, &y);
-  xdr_float(fBufferXDR, &z);
-  xdr_float(fBufferXDR, &t);
-  xdr_float(fBufferXDR, &px);
-  xdr_float(fBufferXDR, &py);
-  xdr_float(fBufferXDR, &pz);
-  xdr_float(fBufferXDR, &e);
+  if(fVersion == kPileUpVersionColumns)
+  {
+    n = fEntrySize;
+    record = fBlock + fCounter;
+
+    pid = int(record[0]);
+    memcpy(&x, record + n, 4);
+    memcpy(&y, record + 2*n, 4);
+    memcpy(&z, record + 3*n, 4);
+    memcpy(&t, record + 4*n, 4);
+    memcpy(&px, record + 5*n, 4);
+    memcpy(&py, record + 6*n, 4);
+    memcpy(&pz, record + 7*n, 4);
+    memcpy(&e, record + 8*n, 4);
+
+    if(fColumns == kPileUpColumnsChargeMass)
+    {
+      charge = int(record[9*n]);
+      memcpy(&mass, record + 10*n, 4);
+    }
+    else
+    {
+      charge = -999;
+      mass = -999.9;
+    }
+
+    ++fCounter;
+
+    return true;
+  }
+
+  record = fRecords + fCounter*kRecordSize;
+
+  pid = int(record[0]);
+  memcpy(&x, record + 1, 4);
+  memcpy(&y, record + 2, 4);
+  memcpy(&z, record + 3, 4);
+  memcpy(&t, record + 4, 4);
+  memcpy(&px, record + 5, 4);
+  memcpy(&py, record + 6, 4);
+  memcpy(&pz, record + 7, 4);
+  memcpy(&e, record + 8, 4);
+
+  charge = -999;
+  mass = -999.9;
 
   ++fCounter;
 
@@ -123,27 +294,181 @@ bool DelphesPileUpReader::ReadParticle(int &pid,
 
 //------------------------------------------------------------------------------
 
+quad_t DelphesPileUpReader::ReadOffset(quad_t entry) const
+{
+  unsigned long long offset;
+
+  if(fVersion == kPileUpVersionColumns)
+  {
+    memcpy(&offset, fMap ? fMap + fIndexOffset + 8*entry : fIndex + 8*entry, 8);
+    return quad_t(PileUpLittleEndian64(offset));
+  }
+
+  // the index is just before the number of events
+  if(fMap) return DecodeHyper(fMap + fMapSize - 8 - 8*(fEntries - entry));
+  return DecodeHyper(fIndex + 8*entry);
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesPileUpReader::ReadColumns(quad_t offset)
+{
+  const unsigned char *data;
+  unsigned int words[2], word;
+  size_t size, stored;
+  int i, n;
+
+  if(fMap)
+  {
+    if(offset < 0 || size_t(offset) + 8 > fMapSize)
+    {
+      throw runtime_error("corrupted pile-up file");
+    }
+    memcpy(words, fMap + offset, 8);
+    data = fMap + offset + 8;
+  }
+  else
+  {
+    fseeko(fPileUpFile, offset, SEEK_SET);
+    if(fread(words, 4, 2, fPileUpFile) != 2)
+    {
+      throw runtime_error("can't read pile-up event");
+    }
+    data = fBuffer;
+  }
+
+  fEntrySize = int(PileUpLittleEndian(words[0]));
+  stored = PileUpLittleEndian(words[1]);
+
+  if(fEntrySize < 0 || fEntrySize >= kBufferSize)
+  {
+    throw runtime_error("too many particles in pile-up event");
+  }
+
+  n = fEntrySize*fColumns;
+  size = 4*size_t(n);
+
+  if(stored > size)
+  {
+    throw runtime_error("corrupted pile-up file");
+  }
+
+  if(fMap)
+  {
+    if(size_t(offset) + 8 + stored > fMapSize)
+    {
+      throw runtime_error("corrupted pile-up file");
+    }
+  }
+  else
+  {
+    if(fread(fBuffer, 1, stored, fPileUpFile) != stored)
+    {
+      throw runtime_error("can't read pile-up event");
+    }
+  }
+
+  // the events that LZ4 could not make smaller are stored as they are
+  if(stored < size)
+  {
+#ifdef HAS_LZ4
+    if(LZ4_decompress_safe(reinterpret_cast<const char *>(data),
+      reinterpret_cast<char *>(fRecords), int(stored), int(size)) != int(size))
+    {
+      throw runtime_error("corrupted pile-up file");
+    }
+    data = reinterpret_cast<const unsigned char *>(fRecords);
+#else
+    throw runtime_error("Delphes was built without LZ4, can't read pile-up event");
+#endif
+  }
+
+  if(PileUpLittleEndian(1u) == 1u && (size_t(data) & 3) == 0)
+  {
+    fBlock = reinterpret_cast<const unsigned int *>(data);
+  }
+  else
+  {
+    for(i = 0; i < n; ++i)
+    {
+      memcpy(&word, data + 4*i, 4);
+      fRecords[i] = PileUpLittleEndian(word);
+    }
+    fBlock = fRecords;
+  }
+}
+
+//------------------------------------------------------------------------------
+
 bool DelphesPileUpReader::ReadEntry(quad_t entry)
 {
+  const unsigned char *records;
+  unsigned char data[4];
   quad_t offset;
+  int i, n;
 
   if(entry >= fEntries) return false;
 
   // read event position
-  xdr_setpos(fIndexXDR, 8*entry);
-  xdr_hyper(fIndexXDR, &offset);
+  offset = ReadOffset(entry);
+
+  if(fVersion == kPileUpVersionColumns)
+  {
+    ReadColumns(offset);
+    fCounter = 0;
+    return true;
+  }
 
   // read event
-  fseeko(fPileUpFile, offset, SEEK_SET);
-  xdr_int(fInputXDR, &fEntrySize);
+  if(fMap)
+  {
+    if(offset < 0 || size_t(offset) + 4 > fMapSize)
+    {
+      throw runtime_error("corrupted pile-up file");
+    }
+    fEntrySize = int(DecodeInt(fMap + offset));
+    records = fMap + offset + 4;
+  }
+  else
+  {
+    fseeko(fPileUpFile, offset, SEEK_SET);
+    if(fread(data, 1, 4, fPileUpFile) != 4)
+    {
+      throw runtime_error("can't read pile-up event");
+    }
+    fEntrySize = int(DecodeInt(data));
+    records = fBuffer;
+  }
 
-  if(fEntrySize >= kBufferSize)
+  if(fEntrySize < 0 || fEntrySize >= kBufferSize)
   {
     throw runtime_error("too many particles in pile-up event");
   }
 
-  xdr_opaque(fInputXDR, fBuffer, fEntrySize*kRecordSize*4);
-  xdr_setpos(fBufferXDR, 0);
+  n = fEntrySize*kRecordSize;
+
+  if(fMap)
+  {
+    if(size_t(offset) + 4 + 4*size_t(n) > fMapSize)
+    {
+      throw runtime_error("corrupted pile-up file");
+    }
+  }
+  else
+  {
+    if(fread(fBuffer, 4, n, fPileUpFile) != size_t(n))
+    {
+      throw runtime_error("can't read pile-up event");
+    }
+  }
+
+  // byte swaps without dependencies between the words, which the
+  // compilers turn into vector instructions
+  for(i = 0; i < n; ++i)
+  {
+    fRecords[i] = DecodeInt(records + 4*i);
+  }
+
   fCounter = 0;
 
   return true;
@@ -23,13 +23,25 @@
  *
  *  Reads pile-up binary file
  *
+ *  The file is mapped into memory when possible, ReadEntry then takes the
+ *  records of an event straight from the mapping, which the processes
+ *  reading the same file share through the page cache, and decodes them
+ *  from big-endian in one loop. Otherwise the records are read with stdio.
+ *
+ *  The files of version 2, see DelphesPileUpFormat.h, are read as they are
+ *  on little-endian machines, only the events compressed with LZ4 are
+ *  copied. When they have the charge and the mass of the particles,
+ *  HasChargeMass returns true.
+ *
  *  \author P. Demin - UCL, Louvain-la-Neuve
  *
  */
 
 #include <stdio.h>
+#include <stddef.h>
 #include <rpc/types.h>
-#include <rpc/xdr.h>
+
+#include "classes/DelphesPileUpFormat.h"
 
 class DelphesPileUpReader
 {
@@ -43,26 +55,56 @@ public:
     float &x, float &y, float &z, float &t,
     float &px, float &py, float &pz, float &e);
 
+  // the charge and the mass are only meaningful when HasChargeMass is true
+  bool ReadParticle(int &pid,
+    float &x, float &y, float &z, float &t,
+    float &px, float &py, float &pz, float &e,
+    int &charge, float &mass);
+
   bool ReadEntry(quad_t entry);
 
   quad_t GetEntries() const { return fEntries; }
 
+  int GetVersion() const { return fVersion; }
+
+  bool HasChargeMass() const { return fFlags & kPileUpChargeMass; }
+
+  // number of particles of the entry read last
+  int GetEntrySize() const { return fEntrySize; }
+
 private:
 
+  quad_t ReadOffset(quad_t entry) const;
+
+  void ReadHeader(const unsigned char *header, const char *fileName);
+
+  void ReadColumns(quad_t offset);
+
+  int fVersion;
+  unsigned int fFlags;
+  int fColumns;
+
   quad_t fEntries;
+  quad_t fIndexOffset;
 
   int fEntrySize;
   int fCounter;
 
   FILE *fPileUpFile;
-  char *fIndex;
-  char *fBuffer;
 
-  XDR *fInputXDR;
-  XDR *fIndexXDR;
-  XDR *fBufferXDR;
-};
+  // whole file when it is mapped, null otherwise
+  const unsigned char *fMap;
+  size_t fMapSize;
 
-#endif // DelphesPileUpReader_h
+  unsigned char *fIndex;
+  unsigned char *fBuffer;
+
+  // records of the entry read last in host byte order, the PID and then
+  // the eight floats of every particle, or its columns for version 2
+  unsigned int *fRecords;
 
+  // columns of the entry read last, in fRecords or in the mapping
+  const unsigned int *fBlock;
+};
 
+#endif // DelphesPileUpReader_h
@@ -32,9 +32,14 @@
 #include <sstream>
 
 #include <stdio.h>
+#include <string.h>
 #include <rpc/types.h>
 #include <rpc/xdr.h>
 
+#ifdef HAS_LZ4
+#include <lz4.h>
+#endif
+
 using namespace std;
 
 static const int kIndexSize = 10000000;
@@ -43,20 +48,35 @@ static const int kRecordSize = 9;
 
 //------------------------------------------------------------------------------
 
-DelphesPileUpWriter::DelphesPileUpWriter(const char *fileName) :
+DelphesPileUpWriter::DelphesPileUpWriter(const char *fileName, int version, unsigned int flags) :
+  fVersion(version), fFlags(flags), fColumns(kPileUpColumns),
   fEntries(0), fEntrySize(0), fOffset(0),
   fPileUpFile(0), fIndex(0), fBuffer(0),
-  fOutputXDR(0), fIndexXDR(0), fBufferXDR(0)
+  fOutputXDR(0), fIndexXDR(0), fBufferXDR(0),
+  fRecords(0), fBlock(0), fCompressed(0)
 {
   stringstream message;
+  char header[kPileUpHeaderSize];
+
+  if(fVersion != kPileUpVersionXDR && fVersion != kPileUpVersionColumns)
+  {
+    message << "unknown pile-up file version " << fVersion;
+    throw runtime_error(message.str());
+  }
+
+  if(fVersion == kPileUpVersionXDR && fFlags != 0)
+  {
+    throw runtime_error("pile-up file flags need version 2");
+  }
+
+#ifndef HAS_LZ4
+  if(fFlags & kPileUpLZ4)
+  {
+    throw runtime_error("Delphes was built without LZ4, can't compress pile-up file");
+  }
+#endif
 
   fIndex = new char[kIndexSize*8];
-  fBuffer = new char[kBufferSize*kRecordSize*4];
-  fOutputXDR = new XDR;
-  fIndexXDR = new XDR;
-  fBufferXDR = new XDR;
-  xdrmem_create(fIndexXDR, fIndex, kIndexSize*8, XDR_ENCODE);
-  xdrmem_create(fBufferXDR, fBuffer, kBufferSize*kRecordSize*4, XDR_ENCODE);
 
   fPileUpFile = fopen(fileName, "w+");
 
@@ -66,6 +86,35 @@ DelphesPileUpWriter::DelphesPileUpWriter(const char *fileName) :
     throw runtime_error(message.str());
   }
 
+  if(fVersion == kPileUpVersionColumns)
+  {
+    if(fFlags & kPileUpChargeMass) fColumns = kPileUpColumnsChargeMass;
+
+    fRecords = new unsigned int[kBufferSize*fColumns];
+    fBlock = new unsigned int[kBufferSize*fColumns];
+#ifdef HAS_LZ4
+    if(fFlags & kPileUpLZ4) fCompressed = new char[LZ4_compressBound(kBufferSize*fColumns*4)];
+#endif
+
+    // the number of events and the offset of the index are filled in by
+    // WriteIndex
+    memset(header, 0, kPileUpHeaderSize);
+    if(fwrite(header, 1, kPileUpHeaderSize, fPileUpFile) != size_t(kPileUpHeaderSize))
+    {
+      message << "can't write pile-up file " << fileName;
+      throw runtime_error(message.str());
+    }
+    fOffset = kPileUpHeaderSize;
+    return;
+  }
+
+  fBuffer = new char[kBufferSize*kRecordSize*4];
+  fOutputXDR = new XDR;
+  fIndexXDR = new XDR;
+  fBufferXDR = new XDR;
+  xdrmem_create(fIndexXDR, fIndex, kIndexSize*8, XDR_ENCODE);
+  xdrmem_create(fBufferXDR, fBuffer, kBufferSize*kRecordSize*4, XDR_ENCODE);
+
   xdrstdio_create(fOutputXDR, fPileUpFile, XDR_ENCODE);
 }
 
@@ -73,13 +122,16 @@ DelphesPileUpWriter::DelphesPileUpWriter(const char *fileName) :
 
 DelphesPileUpWriter::~DelphesPileUpWriter()
 {
-  xdr_destroy(fOutputXDR);
+  if(fOutputXDR) xdr_destroy(fOutputXDR);
   if(fPileUpFile) fclose(fPileUpFile);
-  xdr_destroy(fBufferXDR);
-  xdr_destroy(fIndexXDR);
+  if(fBufferXDR) xdr_destroy(fBufferXDR);
+  if(fIndexXDR) xdr_destroy(fIndexXDR);
   if(fBufferXDR) delete fBufferXDR;
   if(fIndexXDR) delete fIndexXDR;
   if(fOutputXDR) delete fOutputXDR;
+  if(fCompressed) delete[] fCompressed;
+  if(fBlock) delete[] fBlock;
+  if(fRecords) delete[] fRecords;
   if(fBuffer) delete[] fBuffer;
   if(fIndex) delete[] fIndex;
 }
@@ -90,11 +142,46 @@ void DelphesPileUpWriter::WriteParticle(int pid,
   float x, float y, float z, float t,
   float px, float py, float pz, float e)
 {
+  // same values as the ones PileUpMerger gives to unknown particles
+  WriteParticle(pid, x, y, z, t, px, py, pz, e, -999, -999.9);
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesPileUpWriter::WriteParticle(int pid,
+  float x, float y, float z, float t,
+  float px, float py, float pz, float e,
+  int charge, float mass)
+{
+  unsigned int *record;
+
   if(fEntrySize >= kBufferSize)
   {
     throw runtime_error("too many particles in pile-up event");
   }
 
+  if(fVersion == kPileUpVersionColumns)
+  {
+    record = fRecords + fEntrySize*fColumns;
+    record[0] = (unsigned int)(pid);
+    memcpy(record + 1, &x, 4);
+    memcpy(record + 2, &y, 4);
+    memcpy(record + 3, &z, 4);
+    memcpy(record + 4, &t, 4);
+    memcpy(record + 5, &px, 4);
+    memcpy(record + 6, &py, 4);
+    memcpy(record + 7, &pz, 4);
+    memcpy(record + 8, &e, 4);
+    if(fColumns == kPileUpColumnsChargeMass)
+    {
+      record[9] = (unsigned int)(charge);
+      memcpy(record + 10, &mass, 4);
+    }
+
+    ++fEntrySize;
+    return;
+  }
+
   xdr_int(fBufferXDR, &pid);
   xdr_float(fBufferXDR, &x);
   xdr_float(fBufferXDR, &y);
@@ -110,6 +197,56 @@ void DelphesPileUpWriter::WriteParticle(int pid,
 
 //------------------------------------------------------------------------------
 
+void DelphesPileUpWriter::WriteColumns()
+{
+  static const char padding[4] = {0, 0, 0, 0};
+  unsigned int words[2];
+  unsigned long long offset;
+  const char *data;
+  int i, j, size, stored;
+
+  for(j = 0; j < fColumns; ++j)
+  {
+    for(i = 0; i < fEntrySize; ++i)
+    {
+      fBlock[j*fEntrySize + i] = PileUpLittleEndian(fRecords[i*fColumns + j]);
+    }
+  }
+
+  size = fEntrySize*fColumns*4;
+  data = reinterpret_cast<const char *>(fBlock);
+  stored = size;
+
+#ifdef HAS_LZ4
+  int compressed;
+  if(fFlags & kPileUpLZ4)
+  {
+    compressed = LZ4_compress_default(data, fCompressed, size, LZ4_compressBound(size));
+    if(compressed > 0 && compressed < size)
+    {
+      data = fCompressed;
+      stored = compressed;
+    }
+  }
+#endif
+
+  words[0] = PileUpLittleEndian(fEntrySize);
+  words[1] = PileUpLittleEndian(stored);
+
+  if(fwrite(words, 4, 2, fPileUpFile) != 2 ||
+    fwrite(data, 1, stored, fPileUpFile) != size_t(stored) ||
+    fwrite(padding, 1, (4 - stored%4)%4, fPileUpFile) != size_t((4 - stored%4)%4))
+  {
+    throw runtime_error("can't write pile-up event");
+  }
+
+  offset = PileUpLittleEndian64(fOffset);
+  memcpy(fIndex + 8*fEntries, &offset, 8);
+  fOffset += 8 + stored + (4 - stored%4)%4;
+}
+
+//------------------------------------------------------------------------------
+
 void DelphesPileUpWriter::WriteEntry()
 {
   if(fEntries >= kIndexSize)
@@ -117,6 +254,14 @@ void DelphesPileUpWriter::WriteEntry()
     throw runtime_error("too many pile-up events");
   }
 
+  if(fVersion == kPileUpVersionColumns)
+  {
+    WriteColumns();
+    fEntrySize = 0;
+    ++fEntries;
+    return;
+  }
+
   xdr_int(fOutputXDR, &fEntrySize);
   xdr_opaque(fOutputXDR, fBuffer, fEntrySize*kRecordSize*4);
 
@@ -133,6 +278,35 @@ void DelphesPileUpWriter::WriteEntry()
 
 void DelphesPileUpWriter::WriteIndex()
 {
+  unsigned char header[kPileUpHeaderSize];
+  unsigned int words[2];
+  unsigned long long values[2];
+
+  if(fVersion == kPileUpVersionColumns)
+  {
+    if(fwrite(fIndex, 8, fEntries, fPileUpFile) != size_t(fEntries))
+    {
+      throw runtime_error("can't write pile-up index");
+    }
+
+    words[0] = PileUpLittleEndian(fVersion);
+    words[1] = PileUpLittleEndian(fFlags);
+    values[0] = PileUpLittleEndian64(fEntries);
+    values[1] = PileUpLittleEndian64(fOffset);
+
+    memcpy(header, kPileUpMagic, 8);
+    memcpy(header + 8, words, 8);
+    memcpy(header + 16, values, 16);
+
+    fseeko(fPileUpFile, 0, SEEK_SET);
+    if(fwrite(header, 1, kPileUpHeaderSize, fPileUpFile) != size_t(kPileUpHeaderSize))
+    {
+      throw runtime_error("can't write pile-up index");
+    }
+    fseeko(fPileUpFile, 0, SEEK_END);
+    return;
+  }
+
   xdr_opaque(fOutputXDR, fIndex, fEntries*8);
   xdr_hyper(fOutputXDR, &fEntries);
 }
@@ -23,6 +23,10 @@
  *
  *  Writes pile-up binary file
  *
+ *  The files are written in the XDR format unless kPileUpVersionColumns is
+ *  given, see DelphesPileUpFormat.h. The kPileUpLZ4 flag needs Delphes to
+ *  be built with LZ4.
+ *
  *  \author P. Demin - UCL, Louvain-la-Neuve
  *
  */
@@ -31,11 +35,14 @@
 #include <rpc/types.h>
 #include <rpc/xdr.h>
 
+#include "classes/DelphesPileUpFormat.h"
+
 class DelphesPileUpWriter
 {
 public:
 
-  DelphesPileUpWriter(const char *fileName);
+  DelphesPileUpWriter(const char *fileName,
+    int version = kPileUpVersionXDR, unsigned int flags = 0);
 
   ~DelphesPileUpWriter();
 
@@ -43,12 +50,24 @@ public:
     float x, float y, float z, float t,
     float px, float py, float pz, float e);
 
+  // the charge and the mass are only stored with kPileUpChargeMass
+  void WriteParticle(int pid,
+    float x, float y, float z, float t,
+    float px, float py, float pz, float e,
+    int charge, float mass);
+
   void WriteEntry();
 
   void WriteIndex();
 
 private:
 
+  void WriteColumns();
+
+  int fVersion;
+  unsigned int fFlags;
+  int fColumns;
+
   quad_t fEntries;
   int fEntrySize;
   quad_t fOffset;
@@ -60,6 +79,12 @@ private:
   XDR *fOutputXDR;
   XDR *fIndexXDR;
   XDR *fBufferXDR;
+
+  // version 2, the particles of the event, their columns and the
+  // compressed columns
+  unsigned int *fRecords;
+  unsigned int *fBlock;
+  char *fCompressed;
 };
 
 #endif // DelphesPileUpWriter_h
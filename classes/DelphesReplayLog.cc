@@ -0,0 +1,315 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+/** \class DelphesReplayLog
+ *
+ *  Log of the events of a job, to run one of them again on its own.
+ *
+ */
+
+#include "classes/DelphesReplayLog.h"
+
+#include "TBufferFile.h"
+#include "TRandom.h"
+
+#include <string.h>
+
+#include <stdexcept>
+#include <sstream>
+
+using namespace std;
+
+static const char kLogMagic[8] = {'D', 'R', 'L', 'O', 'G', '0', '0', '1'};
+
+//------------------------------------------------------------------------------
+
+static void AppendInteger(string &buffer, unsigned long long value)
+{
+  int i;
+  for(i = 0; i < 8; ++i) buffer += char((value >> (8*i)) & 0xFF);
+}
+
+//------------------------------------------------------------------------------
+
+static void AppendVarint(string &buffer, unsigned long long value)
+{
+  while(value >= 0x80)
+  {
+    buffer += char((value & 0x7F) | 0x80);
+    value >>= 7;
+  }
+  buffer += char(value);
+}
+
+//------------------------------------------------------------------------------
+
+// zigzag, small differences of either sign take few bytes
+static void AppendDifference(string &buffer, long long value)
+{
+  AppendVarint(buffer, ((unsigned long long)(value) << 1) ^ (unsigned long long)(value >> 63));
+}
+
+//------------------------------------------------------------------------------
+
+static void AppendString(string &buffer, const char *data, size_t size)
+{
+  AppendVarint(buffer, size);
+  buffer.append(data, size);
+}
+
+//------------------------------------------------------------------------------
+
+static bool ReadVarint(FILE *file, unsigned long long &value)
+{
+  int c, shift = 0;
+
+  value = 0;
+  while(shift < 64 && (c = getc(file)) != EOF)
+  {
+    value |= (unsigned long long)(c & 0x7F) << shift;
+    if(!(c & 0x80)) return true;
+    shift += 7;
+  }
+  return false;
+}
+
+//------------------------------------------------------------------------------
+
+static bool ReadDifference(FILE *file, long long &value)
+{
+  unsigned long long code;
+  if(!ReadVarint(file, code)) return false;
+  value = (long long)(code >> 1) ^ -(long long)(code & 1);
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+static bool ReadString(FILE *file, string &value)
+{
+  unsigned long long size;
+  if(!ReadVarint(file, size)) return false;
+  value.resize(size);
+  return size == 0 || fread(&value[0], 1, size, file) == size;
+}
+
+//------------------------------------------------------------------------------
+
+DelphesReplayLog::DelphesReplayLog(const char *fileName, Bool_t randomStreams, UInt_t randomSeed,
+  Int_t interval, Bool_t append) :
+  fFileName(fileName), fFile(0), fRandomStreams(randomStreams), fInterval(interval),
+  fSinceState(interval), fPreviousEvent(0), fPreviousOffset(0)
+{
+  stringstream message;
+
+  if(interval < 1)
+  {
+    throw runtime_error("ReplayLogInterval must be positive");
+  }
+
+  fFile = fopen(fileName, append ? "ab" : "wb");
+  if(!fFile)
+  {
+    message << "can't create replay log " << fileName;
+    throw runtime_error(message.str());
+  }
+
+  fBuffer.assign(kLogMagic, 8);
+  fBuffer += char(randomStreams ? 1 : 0);
+  AppendInteger(fBuffer, randomSeed);
+  Flush();
+}
+
+//------------------------------------------------------------------------------
+
+DelphesReplayLog::~DelphesReplayLog()
+{
+  if(fFile) fclose(fFile);
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesReplayLog::SetInputFile(const char *inputFileName)
+{
+  fBuffer += 'F';
+  AppendString(fBuffer, inputFileName, strlen(inputFileName));
+
+  // the replay starts in the input file of the event
+  fPreviousEvent = 0;
+  fPreviousOffset = 0;
+  fSinceState = fInterval;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesReplayLog::AddEvent(Long64_t event, Long64_t offset)
+{
+  if(!fRandomStreams && fSinceState >= fInterval)
+  {
+    WriteRandom();
+    fSinceState = 0;
+  }
+  ++fSinceState;
+
+  fBuffer += 'E';
+  AppendDifference(fBuffer, event - fPreviousEvent);
+  AppendDifference(fBuffer, offset - fPreviousOffset);
+  fPreviousEvent = event;
+  fPreviousOffset = offset;
+
+  Flush();
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesReplayLog::WriteRandom()
+{
+  const char *className = gRandom->ClassName();
+  TBufferFile state(TBuffer::kWrite);
+
+  gRandom->Streamer(state);
+
+  fBuffer += 'S';
+  AppendString(fBuffer, className, strlen(className));
+  AppendString(fBuffer, state.Buffer(), state.Length());
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesReplayLog::Flush()
+{
+  stringstream message;
+
+  if(fwrite(fBuffer.data(), 1, fBuffer.size(), fFile) != fBuffer.size() || fflush(fFile) != 0)
+  {
+    message << "can't write replay log " << fFileName;
+    throw runtime_error(message.str());
+  }
+  fBuffer.clear();
+}
+
+//------------------------------------------------------------------------------
+
+Bool_t DelphesReplayLog::Find(const char *fileName, const char *inputFileName, Long64_t event,
+  Bool_t randomStreams, UInt_t randomSeed, Replay &replay)
+{
+  stringstream message;
+  unsigned char header[16];
+  string name, stateClass, state, pendingClass, pendingState;
+  Bool_t found, matching, pending, hasState, ok;
+  Long64_t previousEvent, previousOffset, eventDifference, offsetDifference;
+  Long64_t stateEvent, stateOffset, seed;
+  FILE *file;
+  int tag, i;
+
+  file = fopen(fileName, "rb");
+  if(!file)
+  {
+    message << "can't open replay log " << fileName;
+    throw runtime_error(message.str());
+  }
+
+  found = matching = pending = hasState = kFALSE;
+  previousEvent = previousOffset = stateEvent = stateOffset = 0;
+
+  // a job that crashed may have left an incomplete record at the end
+  ok = kTRUE;
+  while(ok && (tag = getc(file)) != EOF)
+  {
+    switch(tag)
+    {
+      case 'D':
+        ok = fread(header, 1, 16, file) == 16;
+        if(!ok) break;
+        for(seed = 0, i = 0; i < 8; ++i) seed |= Long64_t(header[8 + i]) << (8*i);
+        if(memcmp(header, kLogMagic + 1, 7) != 0 || Bool_t(header[7]) != randomStreams
+          || (randomStreams && seed != randomSeed))
+        {
+          fclose(file);
+          message << "replay log " << fileName << " has been written with other RandomStreams or RandomSeed settings";
+          throw runtime_error(message.str());
+        }
+        matching = pending = hasState = kFALSE;
+        previousEvent = previousOffset = 0;
+        break;
+      case 'F':
+        ok = ReadString(file, name);
+        matching = name == inputFileName;
+        pending = hasState = kFALSE;
+        previousEvent = previousOffset = 0;
+        break;
+      case 'S':
+        ok = ReadString(file, pendingClass) && ReadString(file, pendingState);
+        pending = kTRUE;
+        break;
+      case 'E':
+        ok = ReadDifference(file, eventDifference) && ReadDifference(file, offsetDifference);
+        if(!ok) break;
+        previousEvent += eventDifference;
+        previousOffset += offsetDifference;
+        if(pending)
+        {
+          stateEvent = previousEvent;
+          stateOffset = previousOffset;
+          stateClass.swap(pendingClass);
+          state.swap(pendingState);
+          hasState = kTRUE;
+          pending = kFALSE;
+        }
+        if(matching && previousEvent == event && (randomStreams || hasState))
+        {
+          found = kTRUE;
+          replay.firstEvent = randomStreams ? previousEvent : stateEvent;
+          replay.firstOffset = randomStreams ? previousOffset : stateOffset;
+          replay.randomClass = randomStreams ? string() : stateClass;
+          replay.randomState = randomStreams ? string() : state;
+        }
+        break;
+      default:
+        fclose(file);
+        message << "can't read replay log " << fileName;
+        throw runtime_error(message.str());
+    }
+  }
+
+  fclose(file);
+  return found;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesReplayLog::RestoreRandom(const Replay &replay)
+{
+  stringstream message;
+
+  if(replay.randomState.empty()) return;
+
+  if(replay.randomClass != gRandom->ClassName())
+  {
+    message << "replay log has a state of " << replay.randomClass << " but gRandom is a " << gRandom->ClassName();
+    throw runtime_error(message.str());
+  }
+
+  TBufferFile state(TBuffer::kRead, replay.randomState.size(),
+    const_cast< char * >(replay.randomState.data()), kFALSE);
+  gRandom->Streamer(state);
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,118 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DelphesReplayLog_h
+#define DelphesReplayLog_h
+
+/** \class DelphesReplayLog
+ *
+ *  Log of the events of a job, to run one of them again on its own with
+ *  the same random numbers, see ReplayLogFile and --replay-event of
+ *  DelphesSTDHEP.
+ *
+ *  For every event, before it is processed, the log keeps its number and
+ *  the offset where it starts in its input file. With RandomStreams the
+ *  random numbers of an event only depend on RandomSeed and its number,
+ *  and the replay starts at the event itself. With gRandom, its state is
+ *  also kept at the first event of every input file and every interval
+ *  events after that, and the replay restores the last one before the
+ *  event and runs the events in between again, without writing them.
+ *
+ *  A job writes a header, the string "DRLOG001", whose first byte is also
+ *  its tag, one byte set to 1 with
+ *  RandomStreams and RandomSeed as a 64-bit little-endian integer,
+ *  followed by records of one tag byte:
+ *
+ *    'F'  name of the input file the next events come from
+ *    'S'  class and state of gRandom, streamed by ROOT, before the next
+ *         event
+ *    'E'  event number and offset, as differences with the previous
+ *         event of the same input file
+ *
+ *  Lengths and differences are variable length integers, seven bits per
+ *  byte, the differences zigzag encoded, so that an event usually takes
+ *  four or five bytes. A resumed job appends its own header and records,
+ *  and the last record of an event wins. The log is flushed after every
+ *  event, so that it also covers the event a job got stuck in or crashed.
+ *
+ */
+
+#include "Rtypes.h"
+
+#include <stdio.h>
+
+#include <string>
+
+class DelphesReplayLog
+{
+public:
+
+  struct Replay
+  {
+    // where the replay starts, the event itself with RandomStreams or
+    // the last event before it with a state of gRandom
+    Long64_t firstEvent, firstOffset;
+
+    // class and state of gRandom at the first event, empty with
+    // RandomStreams
+    std::string randomClass, randomState;
+  };
+
+  // opens the log of a job, appends to it when resuming
+  DelphesReplayLog(const char *fileName, Bool_t randomStreams, UInt_t randomSeed,
+    Int_t interval, Bool_t append = kFALSE);
+  ~DelphesReplayLog();
+
+  // the events that follow come from this input file
+  void SetInputFile(const char *inputFileName);
+
+  // called before an event is processed, with its number and its offset
+  // in the input file
+  void AddEvent(Long64_t event, Long64_t offset);
+
+  // finds where to start the replay of an event of an input file, false
+  // if the log does not have it, throws if the log has been written with
+  // other random settings
+  static Bool_t Find(const char *fileName, const char *inputFileName, Long64_t event,
+    Bool_t randomStreams, UInt_t randomSeed, Replay &replay);
+
+  // sets gRandom to its state at the first event of the replay
+  static void RestoreRandom(const Replay &replay);
+
+private:
+
+  DelphesReplayLog(const DelphesReplayLog &);
+  DelphesReplayLog &operator=(const DelphesReplayLog &);
+
+  void WriteRandom();
+
+  void Flush();
+
+  std::string fFileName;
+  FILE *fFile;
+
+  Bool_t fRandomStreams;
+  Int_t fInterval, fSinceState;
+
+  Long64_t fPreviousEvent, fPreviousOffset;
+
+  // records of an event, written at once
+  std::string fBuffer;
+};
+
+#endif // DelphesReplayLog_h
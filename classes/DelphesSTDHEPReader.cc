@@ -32,18 +32,18 @@
 #include <sstream>
 
 #include <stdio.h>
+#include <string.h>
 #include <errno.h>
 #include <rpc/types.h>
 #include <rpc/xdr.h>
 
 #include "TObjArray.h"
 #include "TStopwatch.h"
-#include "TDatabasePDG.h"
-#include "TParticlePDG.h"
 #include "TLorentzVector.h"
 
 #include "classes/DelphesClasses.h"
 #include "classes/DelphesFactory.h"
+#include "classes/DelphesPDGTable.h"
 
 #include "ExRootAnalysis/ExRootTreeBranch.h"
 
@@ -53,13 +53,70 @@ static const int kBufferSize  = 1000000;
 
 //---------------------------------------------------------------------------
 
+// XDR stores the numbers big-endian, the arrays are converted in place
+// and memcpy is used for the loads because the doubles are only aligned
+// to four bytes
+
+static void SwapInts(char *data, int count)
+{
+#if !defined(__BYTE_ORDER__) || __BYTE_ORDER__ != __ORDER_BIG_ENDIAN__
+  unsigned int value;
+  int i;
+
+  for(i = 0; i < count; ++i)
+  {
+    memcpy(&value, data + 4*i, 4);
+    value = __builtin_bswap32(value);
+    memcpy(data + 4*i, &value, 4);
+  }
+#endif
+}
+
+//---------------------------------------------------------------------------
+
+static void SwapDoubles(char *data, int count)
+{
+#if !defined(__BYTE_ORDER__) || __BYTE_ORDER__ != __ORDER_BIG_ENDIAN__
+  unsigned long long value;
+  int i;
+
+  for(i = 0; i < count; ++i)
+  {
+    memcpy(&value, data + 8*i, 8);
+    value = __builtin_bswap64(value);
+    memcpy(data + 8*i, &value, 8);
+  }
+#endif
+}
+
+//---------------------------------------------------------------------------
+
+static inline int LoadInt(const char *data, int index)
+{
+  int value;
+  memcpy(&value, data + 4*index, 4);
+  return value;
+}
+
+//---------------------------------------------------------------------------
+
+static inline double LoadDouble(const char *data, int index)
+{
+  double value;
+  memcpy(&value, data + 8*index, 8);
+  return value;
+}
+
+//---------------------------------------------------------------------------
+
 DelphesSTDHEPReader::DelphesSTDHEPReader() :
-  fInputFile(0), fInputXDR(0), fBuffer(0), fPDG(0), fBlockType(-1)
+  fInputFile(0), fInputXDR(0), fBuffer(0), fPDG(0),
+  fAllParticles(true), fStableParticles(true), fPartons(true), fBlockType(-1)
 {
   fInputXDR = new XDR;
   fBuffer = new char[kBufferSize*96 + 24];
 
-  fPDG = TDatabasePDG::Instance();
+  fPDG = DelphesPDGTable::Instance();
 }
 
 //---------------------------------------------------------------------------
@@ -80,6 +137,15 @@ void DelphesSTDHEPReader::SetInputFile(FILE *inputFile)
 
 //---------------------------------------------------------------------------
 
+void DelphesSTDHEPReader::SetUsedArrays(bool allParticles, bool stableParticles, bool partons)
+{
+  fAllParticles = allParticles;
+  fStableParticles = stableParticles;
+  fPartons = partons;
+}
+
+//---------------------------------------------------------------------------
+
 void DelphesSTDHEPReader::Clear()
 {
   fBlockType = -1;
@@ -94,6 +160,13 @@ bool DelphesSTDHEPReader::EventReady()
 
 //---------------------------------------------------------------------------
 
+long long DelphesSTDHEPReader::GetPosition() const
+{
+  return ftello(fInputFile);
+}
+
+//---------------------------------------------------------------------------
+
 bool DelphesSTDHEPReader::ReadBlock(DelphesFactory *factory,
   TObjArray *allParticleOutputArray,
   TObjArray *stableParticleOutputArray,
@@ -145,6 +218,53 @@ bool DelphesSTDHEPReader::ReadBlock(DelphesFactory *factory,
 
 //---------------------------------------------------------------------------
 
+bool DelphesSTDHEPReader::SkipEvent()
+{
+  while(!feof(fInputFile))
+  {
+    if(!xdr_int(fInputXDR, &fBlockType)) return kFALSE;
+
+    SkipBytes(4);
+
+    if(fBlockType == FILEHEADER)
+    {
+      ReadFileHeader();
+    }
+    else if(fBlockType == EVENTTABLE)
+    {
+      ReadEventTable();
+    }
+    else if(fBlockType == EVENTHEADER)
+    {
+      ReadEventHeader();
+    }
+    else if(fBlockType == MCFIO_STDHEPBEG ||
+            fBlockType == MCFIO_STDHEPEND)
+    {
+      ReadSTDCM1();
+    }
+    else if(fBlockType == MCFIO_STDHEP)
+    {
+      SkipSTDHEP();
+      return kTRUE;
+    }
+    else if(fBlockType == MCFIO_STDHEP4)
+    {
+      SkipSTDHEP();
+      ReadSTDHEP4();
+      return kTRUE;
+    }
+    else
+    {
+      throw runtime_error("Unsupported block type.");
+    }
+  }
+
+  return kFALSE;
+}
+
+//---------------------------------------------------------------------------
+
 void DelphesSTDHEPReader::SkipBytes(u_int size)
 {
   int rc;
@@ -380,6 +500,11 @@ void DelphesSTDHEPReader::ReadSTDHEP()
     throw runtime_error("Inconsistent size of arrays. File is probably corrupted.");
   }
 
+  // the four integer arrays with the sizes and then the two double arrays
+  SwapInts(fBuffer, 5 + 6*fEventSize);
+  SwapDoubles(fBuffer + 4*5 + 4*6*fEventSize, 5*fEventSize);
+  SwapDoubles(fBuffer + 4*6 + 4*16*fEventSize, 4*fEventSize);
+
   fWeight = 1.0;
   fAlphaQED = 0.0;
   fAlphaQCD = 0.0;
@@ -389,6 +514,25 @@ void DelphesSTDHEPReader::ReadSTDHEP()
 
 //---------------------------------------------------------------------------
 
+void DelphesSTDHEPReader::SkipSTDHEP()
+{
+  // version
+  xdr_string(fInputXDR, &fBuffer, 100);
+
+  xdr_int(fInputXDR, &fEventNumber);
+  xdr_int(fInputXDR, &fEventSize);
+
+  if(fEventSize < 0 || fEventSize >= kBufferSize)
+  {
+    throw runtime_error("Inconsistent size of arrays. File is probably corrupted.");
+  }
+
+  // the six arrays and their sizes, see ReadSTDHEP
+  SkipBytes(96*fEventSize + 24);
+}
+
+//---------------------------------------------------------------------------
+
 void DelphesSTDHEPReader::ReadSTDHEP4()
 {
   u_int number;
@@ -445,46 +589,54 @@ void DelphesSTDHEPReader::AnalyzeParticles(DelphesFactory *factory,
   TObjArray *partonOutputArray)
 {
   Candidate *candidate;
-  TParticlePDG *pdgParticle;
+  const DelphesPDGTable::Entry *pdgParticle;
   int pdgCode;
 
   int number;
   int pid, status, m1, m2, d1, d2;
   double px, py, pz, e, mass;
   double x, y, z, t;
+  bool stable, parton;
 
-  XDR bufferXDR[6];
-  xdrmem_create(&bufferXDR[0], fBuffer + 4*1, 4*fEventSize, XDR_DECODE);
-  xdrmem_create(&bufferXDR[1], fBuffer + 4*2 + 4*1*fEventSize, 4*fEventSize, XDR_DECODE);
-  xdrmem_create(&bufferXDR[2], fBuffer + 4*3 + 4*2*fEventSize, 8*fEventSize, XDR_DECODE);
-  xdrmem_create(&bufferXDR[3], fBuffer + 4*4 + 4*4*fEventSize, 8*fEventSize, XDR_DECODE);
-  xdrmem_create(&bufferXDR[4], fBuffer + 4*5 + 4*6*fEventSize, 40*fEventSize, XDR_DECODE);
-  xdrmem_create(&bufferXDR[5], fBuffer + 4*6 + 4*16*fEventSize, 32*fEventSize, XDR_DECODE);
+  // arrays decoded by ReadSTDHEP
+  const char *isthep = fBuffer + 4*1;
+  const char *idhep = fBuffer + 4*2 + 4*1*fEventSize;
+  const char *jmohep = fBuffer + 4*3 + 4*2*fEventSize;
+  const char *jdahep = fBuffer + 4*4 + 4*4*fEventSize;
+  const char *phep = fBuffer + 4*5 + 4*6*fEventSize;
+  const char *vhep = fBuffer + 4*6 + 4*16*fEventSize;
 
   for(number = 0; number < fEventSize; ++number)
   {
-    xdr_int(&bufferXDR[0], &status);
-    xdr_int(&bufferXDR[1], &pid);
-    xdr_int(&bufferXDR[2], &m1);
-    xdr_int(&bufferXDR[2], &m2);
-    xdr_int(&bufferXDR[3], &d1);
-    xdr_int(&bufferXDR[3], &d2);
-
-    xdr_double(&bufferXDR[4], &px);
-    xdr_double(&bufferXDR[4], &py);
-    xdr_double(&bufferXDR[4], &pz);
-    xdr_double(&bufferXDR[4], &e);
-    xdr_double(&bufferXDR[4], &mass);
-
-    xdr_double(&bufferXDR[5], &x);
-    xdr_double(&bufferXDR[5], &y);
-    xdr_double(&bufferXDR[5], &z);
-    xdr_double(&bufferXDR[5], &t);
+    status = LoadInt(isthep, number);
+    pid = LoadInt(idhep, number);
+    m1 = LoadInt(jmohep, 2*number);
+    m2 = LoadInt(jmohep, 2*number + 1);
+    d1 = LoadInt(jdahep, 2*number);
+    d2 = LoadInt(jdahep, 2*number + 1);
+
+    px = LoadDouble(phep, 5*number);
+    py = LoadDouble(phep, 5*number + 1);
+    pz = LoadDouble(phep, 5*number + 2);
+    e = LoadDouble(phep, 5*number + 3);
+    mass = LoadDouble(phep, 5*number + 4);
+
+    x = LoadDouble(vhep, 4*number);
+    y = LoadDouble(vhep, 4*number + 1);
+    z = LoadDouble(vhep, 4*number + 2);
+    t = LoadDouble(vhep, 4*number + 3);
+
+    pdgParticle = fPDG->Find(pid);
+    pdgCode = TMath::Abs(pid);
+
+    stable = pdgParticle && status == 1 && pdgParticle->stable;
+    parton = pdgParticle && !stable && (pdgCode <= 5 || pdgCode == 21 || pdgCode == 15);
+
+    if(!fAllParticles && !(stable && fStableParticles) && !(parton && fPartons)) continue;
 
     candidate = factory->NewCandidate();
 
     candidate->PID = pid;
-    pdgCode = TMath::Abs(candidate->PID);
 
     candidate->Status = status;
 
@@ -494,8 +646,7 @@ void DelphesSTDHEPReader::AnalyzeParticles(DelphesFactory *factory,
     candidate->D1 = d1 - 1;
     candidate->D2 = d2 - 1;
 
-    pdgParticle = fPDG->GetParticle(pid);
-    candidate->Charge = pdgParticle ? int(pdgParticle->Charge()/3.0) : -999;
+    candidate->Charge = pdgParticle ? pdgParticle->charge : -999;
     candidate->Mass = mass;
 
     candidate->Momentum.SetPxPyPzE(px, py, pz, e);
@@ -504,13 +655,11 @@ void DelphesSTDHEPReader::AnalyzeParticles(DelphesFactory *factory,
 
     allParticleOutputArray->Add(candidate);
 
-    if(!pdgParticle) continue;
-
-    if(status == 1 && pdgParticle->Stable())
+    if(stable && fStableParticles)
     {
       stableParticleOutputArray->Add(candidate);
     }
-    else if(pdgCode <= 5 || pdgCode == 21 || pdgCode == 15)
+    else if(parton && fPartons)
     {
       partonOutputArray->Add(candidate);
     }
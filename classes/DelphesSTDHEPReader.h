@@ -33,7 +33,7 @@
 
 class TObjArray;
 class TStopwatch;
-class TDatabasePDG;
+class DelphesPDGTable;
 class ExRootTreeBranch;
 class DelphesFactory;
 
@@ -57,14 +57,26 @@ public:
 
   void SetInputFile(FILE *inputFile);
 
+  // arrays that no module imports are left empty, and without allParticles
+  // only the candidates of the other two arrays are created, these are still
+  // added to allParticles with the indices of the full record in M1 and D1
+  void SetUsedArrays(bool allParticles, bool stableParticles, bool partons);
+
   void Clear();
   bool EventReady();
 
+  // offset in the input file of the next block to be read
+  long long GetPosition() const;
+
   bool ReadBlock(DelphesFactory *factory,
     TObjArray *allParticleOutputArray,
     TObjArray *stableParticleOutputArray,
     TObjArray *partonOutputArray);
 
+  // passes over the next event without decoding the particles, false at
+  // the end of the input
+  bool SkipEvent();
+
   void AnalyzeEvent(ExRootTreeBranch *branch, long long eventNumber,
     TStopwatch *readStopWatch, TStopwatch *procStopWatch);
 
@@ -83,6 +95,7 @@ private:
   void ReadEventHeader();
   void ReadSTDCM1();
   void ReadSTDHEP();
+  void SkipSTDHEP();
   void ReadSTDHEP4();
 
   FILE *fInputFile;
@@ -91,7 +104,9 @@ private:
 
   char *fBuffer;
 
-  TDatabasePDG *fPDG;
+  const DelphesPDGTable *fPDG;
+
+  bool fAllParticles, fStableParticles, fPartons;
 
   u_int fEntries;
   int fBlockType, fEventNumber, fEventSize;
@@ -0,0 +1,121 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/** \class DelphesSortedArrays
+ *
+ *  Candidates of an array by decreasing Momentum.Pt(), the order of
+ *  TObjArray::Sort with Candidate::fgCompare, without changing the array.
+ *
+ */
+
+#include "classes/DelphesSortedArrays.h"
+
+#include "classes/DelphesClasses.h"
+
+#include "TObjArray.h"
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+
+void DelphesSortedArrays::Reset()
+{
+  map<const TObjArray *, Entry>::iterator itEntries;
+
+  // the vectors keep their memory for the next event
+  for(itEntries = fEntries.begin(); itEntries != fEntries.end(); ++itEntries)
+  {
+    itEntries->second.valid = kFALSE;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+const vector<Candidate *> &DelphesSortedArrays::Get(const TObjArray *array)
+{
+  Entry &entry = fEntries[array];
+  Candidate *candidate;
+  Int_t i, size;
+
+  if(entry.valid) return entry.candidates;
+
+  size = array->GetEntriesFast();
+  entry.keys.resize(size);
+  for(i = 0; i < size; ++i)
+  {
+    candidate = static_cast<Candidate *>(array->At(i));
+    entry.keys[i] = make_pair(candidate->Momentum.Pt(), candidate);
+  }
+
+  Sort(entry.keys.data(), 0, size);
+
+  entry.candidates.resize(size);
+  for(i = 0; i < size; ++i)
+  {
+    entry.candidates[i] = entry.keys[i].second;
+  }
+
+  entry.valid = kTRUE;
+  return entry.candidates;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesSortedArrays::Sort(pair<Double_t, Candidate *> *keys, Int_t first, Int_t last)
+{
+  pair<Double_t, Candidate *> swap;
+  Int_t i, j;
+
+  // the partitioning of TSeqCollection::QSort, so that the candidates with
+  // the same transverse momentum come out in the same order
+  while(last - first > 1)
+  {
+    i = first;
+    j = last;
+    while(true)
+    {
+      while(++i < last && keys[i].first > keys[first].first);
+      while(--j > first && keys[j].first < keys[first].first);
+      if(i >= j) break;
+      swap = keys[i];
+      keys[i] = keys[j];
+      keys[j] = swap;
+    }
+    if(j == first)
+    {
+      ++first;
+      continue;
+    }
+    swap = keys[first];
+    keys[first] = keys[j];
+    keys[j] = swap;
+    if(j - first < last - (j + 1))
+    {
+      Sort(keys, first, j);
+      first = j + 1;
+    }
+    else
+    {
+      Sort(keys, j + 1, last);
+      last = j;
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,67 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef DelphesSortedArrays_h
+#define DelphesSortedArrays_h
+
+/** \class DelphesSortedArrays
+ *
+ *  Candidates of an array by decreasing Momentum.Pt(), the order of
+ *  TObjArray::Sort with Candidate::fgCompare, without changing the array.
+ *
+ *  The transverse momenta are computed once per candidate and each array
+ *  is sorted once until the next Reset, however many branches read it.
+ *
+ */
+
+#include "Rtypes.h"
+
+#include <map>
+#include <vector>
+#include <utility>
+
+class TObjArray;
+
+class Candidate;
+
+class DelphesSortedArrays
+{
+public:
+
+  // forgets the sorted arrays, at the start of every event
+  void Reset();
+
+  const std::vector<Candidate *> &Get(const TObjArray *array);
+
+private:
+
+  struct Entry
+  {
+    Entry() : valid(kFALSE) {}
+    Bool_t valid;
+    std::vector< std::pair<Double_t, Candidate *> > keys;
+    std::vector<Candidate *> candidates;
+  };
+
+  static void Sort(std::pair<Double_t, Candidate *> *keys, Int_t first, Int_t last);
+
+  std::map<const TObjArray *, Entry> fEntries;
+};
+
+#endif /* DelphesSortedArrays_h */
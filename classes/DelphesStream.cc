@@ -33,6 +33,7 @@
 #include <stdio.h>
 #include <errno.h>
 #include <math.h>
+#include <float.h>
 
 #include <iostream>
 
@@ -48,6 +49,166 @@ bool DelphesStream::fFirstZero = true;
 
 //------------------------------------------------------------------------------
 
+// fast paths for the plain decimal numbers, anything else is left to
+// strtod and strtol
+
+static inline char *SkipSpace(char *pointer)
+{
+  while(*pointer == ' ' || (*pointer >= '\t' && *pointer <= '\r')) ++pointer;
+  return pointer;
+}
+
+//------------------------------------------------------------------------------
+
+#if LDBL_MANT_DIG == 64
+
+static const long double kPowersOfTen[] =
+{
+  1.0E0L, 1.0E1L, 1.0E2L, 1.0E3L, 1.0E4L, 1.0E5L, 1.0E6L, 1.0E7L,
+  1.0E8L, 1.0E9L, 1.0E10L, 1.0E11L, 1.0E12L, 1.0E13L, 1.0E14L, 1.0E15L,
+  1.0E16L, 1.0E17L, 1.0E18L, 1.0E19L, 1.0E20L, 1.0E21L, 1.0E22L, 1.0E23L,
+  1.0E24L, 1.0E25L, 1.0E26L, 1.0E27L
+};
+
+static const int kMaxPowerOfTen = 27;
+
+// The powers of ten up to 1E27 and the mantissas of up to 19 digits are
+// exact in the 64-bit significand of long double, so the product or the
+// quotient is rounded once. Rounding it again to double gives the same
+// result as strtod unless it is exactly half-way between two doubles.
+
+static bool FastReadDbl(char *&buffer, double &value)
+{
+  char *pointer = SkipSpace(buffer);
+  unsigned long long mantissa = 0, significand;
+  int digits = 0, exponent = 0, power = 0, powerDigits = 0;
+  bool negative = false, powerNegative = false, found = false;
+  long double result;
+
+  if(*pointer == '-')
+  {
+    negative = true;
+    ++pointer;
+  }
+  else if(*pointer == '+')
+  {
+    ++pointer;
+  }
+
+  if(pointer[0] == '0' && (pointer[1] == 'x' || pointer[1] == 'X')) return false;
+
+  for(; *pointer >= '0' && *pointer <= '9'; ++pointer)
+  {
+    if(digits == 19) return false;
+    mantissa = mantissa*10 + (*pointer - '0');
+    if(mantissa > 0) ++digits;
+    found = true;
+  }
+
+  if(*pointer == '.')
+  {
+    for(++pointer; *pointer >= '0' && *pointer <= '9'; ++pointer)
+    {
+      if(digits == 19) return false;
+      mantissa = mantissa*10 + (*pointer - '0');
+      if(mantissa > 0) ++digits;
+      --exponent;
+      found = true;
+    }
+  }
+
+  if(!found) return false;
+
+  if(*pointer == 'e' || *pointer == 'E')
+  {
+    char *next = pointer + 1;
+    if(*next == '-')
+    {
+      powerNegative = true;
+      ++next;
+    }
+    else if(*next == '+')
+    {
+      ++next;
+    }
+    for(; *next >= '0' && *next <= '9'; ++next)
+    {
+      if(++powerDigits > 4) return false;
+      power = power*10 + (*next - '0');
+    }
+    if(powerDigits > 0)
+    {
+      exponent += powerNegative ? -power : power;
+      pointer = next;
+    }
+  }
+
+  if(mantissa == 0)
+  {
+    value = negative ? -0.0 : 0.0;
+    buffer = pointer;
+    return true;
+  }
+
+  if(exponent < -kMaxPowerOfTen || exponent > kMaxPowerOfTen) return false;
+
+  result = mantissa;
+  if(exponent >= 0) result *= kPowersOfTen[exponent];
+  else result /= kPowersOfTen[-exponent];
+
+  // the lowest 11 bits of the significand are dropped by the conversion
+  memcpy(&significand, &result, sizeof(significand));
+  if((significand & 0x7FF) == 0x400) return false;
+
+  value = negative ? -double(result) : double(result);
+  buffer = pointer;
+  return true;
+}
+
+#else
+
+static bool FastReadDbl(char *&buffer, double &value)
+{
+  return false;
+}
+
+#endif
+
+//------------------------------------------------------------------------------
+
+static bool FastReadInt(char *&buffer, int &value)
+{
+  char *pointer = SkipSpace(buffer);
+  long long result = 0;
+  int digits = 0;
+  bool negative = false;
+
+  if(*pointer == '-')
+  {
+    negative = true;
+    ++pointer;
+  }
+  else if(*pointer == '+')
+  {
+    ++pointer;
+  }
+
+  for(; *pointer >= '0' && *pointer <= '9'; ++pointer)
+  {
+    if(++digits > 18) return false;
+    result = result*10 + (*pointer - '0');
+  }
+
+  if(digits == 0) return false;
+
+  // same conversion as the assignment of the result of strtol
+  value = long(negative ? -result : result);
+  buffer = pointer;
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
 DelphesStream::DelphesStream(char *buffer) :
   fBuffer(buffer)
 {
@@ -58,6 +219,7 @@ DelphesStream::DelphesStream(char *buffer) :
 bool DelphesStream::ReadDbl(double &value)
 {
   char *start = fBuffer;
+  if(FastReadDbl(fBuffer, value)) return true;
   errno = 0;
   value = strtod(start, &fBuffer);
   if(errno == ERANGE)
@@ -87,6 +249,7 @@ bool DelphesStream::ReadDbl(double &value)
 bool DelphesStream::ReadInt(int &value)
 {
   char *start = fBuffer;
+  if(FastReadInt(fBuffer, value)) return true;
   errno = 0;
   value = strtol(start, &fBuffer, 10);
   if(errno == ERANGE)
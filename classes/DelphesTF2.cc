@@ -20,6 +20,7 @@
 
 #include "RVersion.h"
 #include "TString.h"
+#include "TRandom.h"
 
 #include <stdexcept>
 
@@ -28,14 +29,16 @@ using namespace std;
 //------------------------------------------------------------------------------
 
 DelphesTF2::DelphesTF2() :
-  TF2()
+  TF2(), fCellXmin(0.0), fCellXmax(0.0), fCellYmin(0.0), fCellYmax(0.0),
+  fCellNpx(0), fCellNpy(0)
 {
 }
 
 //------------------------------------------------------------------------------
 
 DelphesTF2::DelphesTF2(const char *name, const char *expression) :
-  TF2(name, expression)
+  TF2(name, expression), fCellXmin(0.0), fCellXmax(0.0), fCellYmin(0.0), fCellYmax(0.0),
+  fCellNpx(0), fCellNpy(0)
 {
 }
 
@@ -66,7 +69,81 @@ Int_t DelphesTF2::Compile(const char *expression)
   {
     throw runtime_error("Invalid formula.");
   }
+  fCells.clear();
   return 0;
 }
 
 //------------------------------------------------------------------------------
+
+void DelphesTF2::ComputeCells()
+{
+  Double_t dx, dy, sum, integral;
+  Int_t i, j, size, cell;
+
+  fCellXmin = fXmin;
+  fCellXmax = fXmax;
+  fCellYmin = fYmin;
+  fCellYmax = fYmax;
+  fCellNpx = fNpx;
+  fCellNpy = fNpy;
+
+  dx = (fXmax - fXmin)/fNpx;
+  dy = (fYmax - fYmin)/fNpy;
+
+  fCells.resize(fNpx*fNpy);
+  sum = 0.0;
+  for(j = 0; j < fNpy; ++j)
+  {
+    for(i = 0; i < fNpx; ++i)
+    {
+      integral = Integral(fXmin + i*dx, fXmin + (i + 1)*dx, fYmin + j*dy, fYmin + (j + 1)*dy);
+      if(integral > 0.0) sum += integral;
+      fCells[j*fNpx + i] = sum;
+    }
+  }
+
+  if(sum <= 0.0)
+  {
+    fCells.clear();
+    throw runtime_error("Integral of the formula is not positive.");
+  }
+
+  for(i = 0; i < fNpx*fNpy; ++i) fCells[i] /= sum;
+
+  size = fNpx*fNpy;
+  fGuide.resize(size);
+  cell = 0;
+  for(i = 0; i < size; ++i)
+  {
+    while(cell < size - 1 && fCells[cell] < Double_t(i)/size) ++cell;
+    fGuide[i] = cell;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesTF2::GetRandom2(Double_t &x, Double_t &y, TRandom *random)
+{
+  Double_t random1;
+  Int_t size, cell;
+
+  if(fCells.empty() || fCellXmin != fXmin || fCellXmax != fXmax || fCellYmin != fYmin || fCellYmax != fYmax
+    || fCellNpx != fNpx || fCellNpy != fNpy)
+  {
+    ComputeCells();
+  }
+
+  // the first cell reaching the random number, found from the guide in
+  // a step or two instead of a binary search over all the cells
+  size = fNpx*fNpy;
+  random1 = random->Rndm();
+  cell = Int_t(random1*size);
+  cell = fGuide[cell < size ? cell : size - 1];
+  while(cell > 0 && fCells[cell - 1] >= random1) --cell;
+  while(cell < size - 1 && fCells[cell] < random1) ++cell;
+
+  x = fXmin + (fXmax - fXmin)/fNpx*(cell%fNpx + random->Rndm());
+  y = fYmin + (fYmax - fYmin)/fNpy*(cell/fNpx + random->Rndm());
+}
+
+//------------------------------------------------------------------------------
@@ -21,6 +21,10 @@
 
 #include "TF2.h"
 
+#include <vector>
+
+class TRandom;
+
 class DelphesTF2: public TF2
 {
 public:
@@ -32,6 +36,27 @@ public:
   ~DelphesTF2();
 
   Int_t Compile(const char *expression);
+
+  using TF2::GetRandom2;
+
+  // same as TF2::GetRandom2 with the numbers taken from random instead
+  // of gRandom, the integrals of the cells are computed at the first
+  // call and again when the range or the number of points change
+  void GetRandom2(Double_t &x, Double_t &y, TRandom *random);
+
+  // computes the integrals of the cells now, instead of at the first
+  // call of GetRandom2
+  void ComputeCells();
+
+private:
+
+  // cumulative integrals of the fNpx*fNpy cells, normalized to one, and
+  // the first cell reaching k/(fNpx*fNpy) for every k, where the search
+  // for a random number starts
+  std::vector< Double_t > fCells;
+  std::vector< Int_t > fGuide;
+  Double_t fCellXmin, fCellXmax, fCellYmin, fCellYmax;
+  Int_t fCellNpx, fCellNpy;
 };
 
 #endif /* DelphesTF2_h */
@@ -0,0 +1,208 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/** \class DelphesTopology
+ *
+ *  CPUs and NUMA nodes of the machine.
+ *
+ */
+
+#include "classes/DelphesTopology.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace std;
+
+namespace
+{
+
+struct Topology
+{
+  // node of every CPU by number, and the CPUs the process may use
+  vector< Int_t > nodes;
+  vector< Int_t > cpus;
+  Int_t numberOfNodes;
+
+  Topology();
+};
+
+//------------------------------------------------------------------------------
+
+// CPU list of the form 0-15,32-47
+void ReadCPUList(const string &fileName, vector< Int_t > &cpus)
+{
+  ifstream file(fileName.c_str());
+  string range;
+  Int_t first, last, cpu;
+  char dash;
+
+  while(getline(file, range, ','))
+  {
+    istringstream input(range);
+    if(!(input >> first)) continue;
+    last = first;
+    if(input >> dash >> last && dash != '-') last = first;
+    for(cpu = first; cpu <= last; ++cpu) cpus.push_back(cpu);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+Topology::Topology() :
+  numberOfNodes(1)
+{
+  vector< Int_t > cpuList;
+  vector< Int_t >::const_iterator itCPUs;
+  stringstream fileName;
+  Int_t node, cpu, misses;
+
+  // the node numbers can have gaps, stop after a few missing ones
+  node = 0;
+  misses = 0;
+  while(misses < 8)
+  {
+    cpuList.clear();
+    fileName.str("");
+    fileName << "/sys/devices/system/node/node" << node << "/cpulist";
+    ReadCPUList(fileName.str(), cpuList);
+    if(cpuList.empty())
+    {
+      ++misses;
+    }
+    else
+    {
+      misses = 0;
+      numberOfNodes = node + 1;
+      for(itCPUs = cpuList.begin(); itCPUs != cpuList.end(); ++itCPUs)
+      {
+        if(*itCPUs >= Int_t(nodes.size())) nodes.resize(*itCPUs + 1, 0);
+        nodes[*itCPUs] = node;
+      }
+    }
+    ++node;
+  }
+
+#if defined(__linux__)
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if(sched_getaffinity(0, sizeof(set), &set) == 0)
+  {
+    for(cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+    {
+      if(CPU_ISSET(cpu, &set)) cpus.push_back(cpu);
+    }
+  }
+#endif
+
+  if(cpus.empty()) cpus.push_back(0);
+
+  // filled one node after the other, so that few threads stay on one node
+  stable_sort(cpus.begin(), cpus.end(), [this](Int_t a, Int_t b)
+  {
+    return (a < Int_t(nodes.size()) ? nodes[a] : 0) < (b < Int_t(nodes.size()) ? nodes[b] : 0);
+  });
+}
+
+//------------------------------------------------------------------------------
+
+const Topology &GetTopology()
+{
+  static const Topology topology;
+  return topology;
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+
+const vector< Int_t > &DelphesTopology::GetCPUs()
+{
+  return GetTopology().cpus;
+}
+
+//------------------------------------------------------------------------------
+
+Int_t DelphesTopology::GetNode(Int_t cpu)
+{
+  const vector< Int_t > &nodes = GetTopology().nodes;
+  return cpu >= 0 && cpu < Int_t(nodes.size()) ? nodes[cpu] : 0;
+}
+
+//------------------------------------------------------------------------------
+
+Int_t DelphesTopology::GetNumberOfNodes()
+{
+  return GetTopology().numberOfNodes;
+}
+
+//------------------------------------------------------------------------------
+
+Bool_t DelphesTopology::PinThread(Int_t cpu)
+{
+#if defined(__linux__)
+  cpu_set_t set;
+  if(cpu < 0 || cpu >= CPU_SETSIZE) return kFALSE;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+  return kFALSE;
+#endif
+}
+
+//------------------------------------------------------------------------------
+
+Int_t DelphesTopology::GetThreadNode()
+{
+  static thread_local Int_t node = -2;
+
+  if(node != -2) return node;
+
+  node = 0;
+#if defined(__linux__)
+  cpu_set_t set;
+  Int_t cpu;
+  Bool_t first = kTRUE;
+
+  CPU_ZERO(&set);
+  if(pthread_getaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+  {
+    node = -1;
+    return node;
+  }
+  for(cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+  {
+    if(!CPU_ISSET(cpu, &set)) continue;
+    if(first) node = GetNode(cpu);
+    else if(GetNode(cpu) != node) node = -1;
+    first = kFALSE;
+  }
+#endif
+  return node;
+}
+
+//------------------------------------------------------------------------------
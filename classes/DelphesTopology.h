@@ -0,0 +1,57 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DelphesTopology_h
+#define DelphesTopology_h
+
+/** \class DelphesTopology
+ *
+ *  CPUs and NUMA nodes of the machine, read from /sys on Linux, and the
+ *  placement of the calling thread on them.
+ *
+ *  Elsewhere, or without the node directories, the machine is one node
+ *  and the threads can't be pinned.
+ *
+ */
+
+#include "Rtypes.h"
+
+#include <vector>
+
+class DelphesTopology
+{
+public:
+
+  // CPUs the process may run on, those of the first node first
+  static const std::vector< Int_t > &GetCPUs();
+
+  // node of a CPU, 0 when it is unknown
+  static Int_t GetNode(Int_t cpu);
+
+  static Int_t GetNumberOfNodes();
+
+  // restricts the calling thread to one CPU, false if it can't be done
+  static Bool_t PinThread(Int_t cpu);
+
+  // node of the calling thread when all the CPUs it may run on belong to
+  // that node, -1 otherwise, found at the first call on the thread, which
+  // must come after it is pinned
+  static Int_t GetThreadNode();
+};
+
+#endif /* DelphesTopology_h */
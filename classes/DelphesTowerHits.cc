@@ -0,0 +1,166 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/** \class DelphesTowerHits
+ *
+ *  Groups the calorimeter hits of an event by tower.
+ *
+ */
+
+#include "classes/DelphesTowerHits.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+
+DelphesTowerHits::DelphesTowerHits() :
+  fOrdered(kTRUE)
+{
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesTowerHits::Init(const vector< Double_t > &etaBins, const vector< vector< Double_t > * > &phiBins)
+{
+  Int_t i, numberOfTowers;
+
+  if(etaBins.size() != phiBins.size())
+  {
+    throw invalid_argument("every eta bin needs its phi bins");
+  }
+
+  fEtaLookup.Init(etaBins);
+  fPhiLookups.assign(etaBins.size(), DelphesBinLookup());
+  fNumberOfPhiBins.assign(etaBins.size(), 0);
+  fTowerOffsets.assign(etaBins.size(), 0);
+
+  numberOfTowers = 0;
+  for(i = 0; i < Int_t(etaBins.size()); ++i)
+  {
+    fPhiLookups[i].Init(*phiBins[i]);
+    fNumberOfPhiBins[i] = phiBins[i]->size();
+    fTowerOffsets[i] = numberOfTowers;
+    numberOfTowers += phiBins[i]->size();
+  }
+
+  fFirst.assign(kNumberOfFlags*numberOfTowers, -1);
+  fLast.assign(kNumberOfFlags*numberOfTowers, -1);
+
+  Clear();
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesTowerHits::Clear()
+{
+  vector< Int_t >::const_iterator itTouched;
+  Int_t flags;
+
+  // only the towers that were hit need to be reset
+  for(itTouched = fTouched.begin(); itTouched != fTouched.end(); ++itTouched)
+  {
+    for(flags = 0; flags < kNumberOfFlags; ++flags)
+    {
+      fFirst[kNumberOfFlags*(*itTouched) + flags] = -1;
+    }
+  }
+
+  fAdded.clear();
+  fNext.clear();
+  fTouched.clear();
+  fHits.clear();
+  fOrdered = kTRUE;
+}
+
+//------------------------------------------------------------------------------
+
+Bool_t DelphesTowerHits::Add(Double_t eta, Double_t phi, Int_t flags, Int_t number)
+{
+  Int_t etaBin, phiBin, tower, key, hit, other;
+
+  // find eta bin [1, etaBins.size - 1]
+  etaBin = fEtaLookup.Find(eta);
+  if(etaBin == 0 || etaBin == Int_t(fTowerOffsets.size())) return kFALSE;
+
+  // find phi bin [1, phiBins.size - 1]
+  phiBin = fPhiLookups[etaBin].Find(phi);
+  if(phiBin == 0 || phiBin == fNumberOfPhiBins[etaBin]) return kFALSE;
+
+  tower = fTowerOffsets[etaBin] + phiBin;
+  key = kNumberOfFlags*tower + flags;
+  hit = fAdded.size();
+
+  if(fFirst[key] < 0)
+  {
+    // first hit of the tower with any flags
+    for(other = 0; other < kNumberOfFlags; ++other)
+    {
+      if(fFirst[kNumberOfFlags*tower + other] >= 0) break;
+    }
+    if(other == kNumberOfFlags) fTouched.push_back(tower);
+
+    fFirst[key] = hit;
+  }
+  else
+  {
+    fNext[fLast[key]] = hit;
+  }
+  fLast[key] = hit;
+
+  fAdded.push_back((Long64_t(etaBin) << 48) | (Long64_t(phiBin) << 32) | (Long64_t(flags) << 24) | Long64_t(number));
+  fNext.push_back(-1);
+  fOrdered = kFALSE;
+
+  return kTRUE;
+}
+
+//------------------------------------------------------------------------------
+
+const vector< Long64_t > &DelphesTowerHits::GetHits()
+{
+  vector< Int_t >::const_iterator itTouched;
+  Int_t flags, hit;
+
+  if(fOrdered) return fHits;
+
+  // towers are numbered in eta and phi order, and only the ones
+  // that were hit are sorted
+  sort(fTouched.begin(), fTouched.end());
+
+  fHits.clear();
+  fHits.reserve(fAdded.size());
+  for(itTouched = fTouched.begin(); itTouched != fTouched.end(); ++itTouched)
+  {
+    for(flags = 0; flags < kNumberOfFlags; ++flags)
+    {
+      for(hit = fFirst[kNumberOfFlags*(*itTouched) + flags]; hit >= 0; hit = fNext[hit])
+      {
+        fHits.push_back(fAdded[hit]);
+      }
+    }
+  }
+
+  fOrdered = kTRUE;
+  return fHits;
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,81 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DelphesTowerHits_h
+#define DelphesTowerHits_h
+
+/** \class DelphesTowerHits
+ *
+ *  Groups the calorimeter hits of an event by tower. The towers are given
+ *  by the eta edges and the phi edges of every eta bin, and the hits are
+ *  chained per tower as they are added, so that no sort over all the hits
+ *  is needed. The hits are packed as {16 bits for the eta bin, 16 bits for
+ *  the phi bin, 8 bits for the flags, 24 bits for the number}.
+ *
+ */
+
+#include "classes/DelphesBinLookup.h"
+
+#include "Rtypes.h"
+
+#include <vector>
+
+class DelphesTowerHits
+{
+public:
+
+  // number of different flags a hit can have
+  static const Int_t kNumberOfFlags = 3;
+
+  DelphesTowerHits();
+
+  // phiBins[i] are the phi edges of the eta bin ending at etaBins[i]
+  void Init(const std::vector< Double_t > &etaBins, const std::vector< std::vector< Double_t > * > &phiBins);
+
+  void Clear();
+
+  // returns false if the position is outside all the towers
+  Bool_t Add(Double_t eta, Double_t phi, Int_t flags, Int_t number);
+
+  // hits ordered by eta bin, phi bin, flags and then in the order they
+  // were added, valid until the next Clear
+  const std::vector< Long64_t > &GetHits();
+
+private:
+
+  DelphesBinLookup fEtaLookup;
+  std::vector< DelphesBinLookup > fPhiLookups;
+  std::vector< Int_t > fNumberOfPhiBins;
+
+  // first tower of every eta bin
+  std::vector< Int_t > fTowerOffsets;
+
+  // first and last hit of every tower and flags, -1 for none
+  std::vector< Int_t > fFirst, fLast;
+
+  // hits in the order they were added, and the next hit of the same
+  // tower and flags
+  std::vector< Long64_t > fAdded;
+  std::vector< Int_t > fNext;
+
+  std::vector< Int_t > fTouched;
+  std::vector< Long64_t > fHits;
+  Bool_t fOrdered;
+};
+
+#endif /* DelphesTowerHits_h */
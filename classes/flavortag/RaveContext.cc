@@ -0,0 +1,38 @@
+#ifndef NO_RAVE 		// check for NO_RAVE flag
+
+#include "RaveContext.hh"
+
+#include "rave/VertexFactory.h"
+#include "rave/ConstantMagneticField.h"
+#include "rave/VacuumPropagator.h"
+
+// ________________________________________________________________________
+// context
+
+RaveContext::RaveContext(double Bz, const rave::Ellipsoid3D& beamspot):
+  _field(new rave::ConstantMagneticField(0, 0, Bz)),
+  _beamspot(beamspot)
+{
+  std::lock_guard<std::mutex> lock(rave_mutex());
+  _vertex_factory.reset(new rave::VertexFactory(
+                          *_field, rave::VacuumPropagator(), _beamspot,
+                          "default", 0));
+}
+
+// defined here, where the factory types are complete
+RaveContext::~RaveContext()
+{
+  std::lock_guard<std::mutex> lock(rave_mutex());
+  _vertex_factory.reset();
+}
+
+rave::VertexFactory& RaveContext::vertexFactory() {
+  return *_vertex_factory;
+}
+
+std::mutex& rave_mutex() {
+  static std::mutex mutex;
+  return mutex;
+}
+
+#endif // NO_RAVE
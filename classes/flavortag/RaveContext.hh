@@ -0,0 +1,39 @@
+#ifndef RAVE_CONTEXT_HH
+#define RAVE_CONTEXT_HH
+
+// A `RaveContext` bundles a rave factory with the field and beamspot
+// it refers to, so each module instance owns one. The factories also
+// register process-global singletons, so every call into rave,
+// including building and destroying a context, holds `rave_mutex()`.
+
+#include "rave/Ellipsoid3D.h"
+
+#include <memory>
+#include <mutex>
+
+namespace rave {
+  class ConstantMagneticField;
+  class VertexFactory;
+}
+
+class RaveContext
+{
+public:
+  // Bz in Tesla, beamspot in rave units (cm)
+  RaveContext(double Bz, const rave::Ellipsoid3D& beamspot);
+  ~RaveContext();
+  RaveContext(const RaveContext&) = delete;
+  RaveContext& operator=(const RaveContext&) = delete;
+  rave::VertexFactory& vertexFactory();
+private:
+  // the factory keeps references to these, so they live here too
+  std::unique_ptr<rave::ConstantMagneticField> _field;
+  rave::Ellipsoid3D _beamspot;
+  std::unique_ptr<rave::VertexFactory> _vertex_factory;
+};
+
+// Held around every call into rave, which may keep process-global
+// state, so that fits from several threads don't run at the same time.
+std::mutex& rave_mutex();
+
+#endif
@@ -16,14 +16,14 @@ RaveConverter::RaveConverter(double Bz, double cov_scaling):
 {
 }
 
-rave::Vector6D RaveConverter::getState(const Candidate* cand) {
+rave::Vector6D RaveConverter::getState(const float* par, int charge) {
   using namespace TrackParam;
-  double a_d0 = cand->trkPar[D0];
-  double a_z0 = cand->trkPar[Z0];
-  double a_phi = cand->trkPar[PHI];
-  double a_qoverp = cand->trkPar[QOVERP];
-  double a_theta = cand->trkPar[THETA];
-  double a_q = cand->Charge;
+  double a_d0 = par[D0];
+  double a_z0 = par[Z0];
+  double a_phi = par[PHI];
+  double a_qoverp = par[QOVERP];
+  double a_theta = par[THETA];
+  double a_q = charge;
 
   // -- translate these to Rave coordinates
   // rave base units are cm and GeV, Delphes takes mm and GeV
@@ -58,16 +58,15 @@ rave::Point3D RaveConverter::getSeed(const std::vector<Candidate*>& trks) {
   return max;
 }
 
-rave::PerigeeCovariance5D RaveConverter::getPerigeeCov(const Candidate* cand) {
+rave::PerigeeCovariance5D RaveConverter::getPerigeeCov(const float* par,
+                                                       const float* cov0) {
   using namespace TrackParam;
   // -- translate to Rave coordinates
   // rave base units are cm and GeV, Delphes takes mm and GeV
   // need to calculate some things for the jacobian
-  const float* par = cand->trkPar;
   double drdq = getDrhoDqoverp(par[THETA]);
   double drdt = getDrhoDtheta(par[QOVERP], par[THETA]);
 
-  const float* cov0 = cand->trkCov;
   float cov[15];
   for (size_t iii = 0; iii < 15; iii++) {
     cov[iii] = cov0[iii] * _cov_scaling;
@@ -136,15 +135,34 @@ double RaveConverter::getDrhoDtheta(double qoverp, double theta) {
 std::vector<rave::Track> RaveConverter::getRaveTracks(
   const std::vector<Candidate*>& in) {
   std::vector<rave::Track> tracks;
+  tracks.reserve(in.size());
   for (const auto& deltrack: in) {
-    rave::Vector6D state = getState(deltrack);
-    rave::PerigeeCovariance5D cov5d = getPerigeeCov(deltrack);
-    int charge = deltrack->Charge;
-    rave::Covariance6D cov6d = _to_rave.convert(cov5d, state, charge);
-    rave::Track track(state, cov6d, charge, 0.0, 0.0, deltrack);
-    tracks.push_back(track);
+    tracks.push_back(getRaveTrack(deltrack));
   }
   return tracks;
 }
 
+const rave::Track& RaveConverter::getRaveTrack(const Candidate* deltrack) {
+  unsigned uid = deltrack->GetUniqueID();
+  auto cached = _cache.find(uid);
+  if (cached != _cache.end()) return cached->second;
+  auto track = convert(deltrack->trkPar, deltrack->trkCov,
+                       deltrack->Charge, deltrack);
+  return _cache.emplace(uid, track).first->second;
+}
+
+void RaveConverter::clearCache() {
+  _cache.clear();
+}
+
+rave::Track RaveConverter::convert(const float* par, const float* cov,
+                                   int charge, const Candidate* original) {
+  rave::Vector6D state = getState(par, charge);
+  rave::PerigeeCovariance5D cov5d = getPerigeeCov(par, cov);
+  rave::Covariance6D cov6d = _to_rave.convert(cov5d, state, charge);
+  // rave wants a non-const pointer, but never modifies the original
+  void* orig = const_cast<Candidate*>(original);
+  return rave::Track(state, cov6d, charge, 0.0, 0.0, orig);
+}
+
 #endif // NO_RAVE
@@ -8,6 +8,7 @@
 #include "RaveBase/Converters/interface/RaveToPerigeeObjects.h"
 
 #include <vector>
+#include <unordered_map>
 
 class Candidate;
 
@@ -16,11 +17,20 @@ class RaveConverter
 {
 public:
   RaveConverter(double Bz, double cov_scaling = 1);
+  // Converted tracks are cached by unique ID, so the same track can
+  // be asked for many times (primary vertex, each jet) but is only
+  // converted once. Call clearCache() at the start of each event.
   std::vector<rave::Track> getRaveTracks(const std::vector<Candidate*>& in);
+  const rave::Track& getRaveTrack(const Candidate*);
+  void clearCache();
   rave::Point3D getSeed(const std::vector<Candidate*>& in);
 private:
-  rave::Vector6D getState(const Candidate*);
-  rave::PerigeeCovariance5D getPerigeeCov(const Candidate*);
+  // these work on the flat trkPar / trkCov arrays
+  rave::Track convert(const float* par, const float* cov, int charge,
+                      const Candidate* original);
+  rave::Vector6D getState(const float* par, int charge);
+  rave::PerigeeCovariance5D getPerigeeCov(const float* par,
+                                          const float* cov);
   double getRho(double pt_in_gev, int charge); // return in cm^-1
   double getRhoAlt(double qoverp, double theta);
   double getQOverP(double rho, double theta);
@@ -30,6 +40,7 @@ private:
   double _cov_scaling;
   rave::PerigeeToRaveObjects _to_rave;
   rave::RaveToPerigeeObjects _to_perigee;
+  std::unordered_map<unsigned, rave::Track> _cache;
 };
 
 #endif
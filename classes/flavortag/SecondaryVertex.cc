@@ -18,6 +18,23 @@ void SecondaryVertex::clear() {
   nTracks = -1;
   eFrac = -1;
   mass = -1;
-  config = "null";
-  tracks_along_jet.clear();
+  config = SecondaryVertexConfig::null;
+  first_track = 0;
+  n_tracks_along_jet = 0;
+}
+SecondaryVertexTrackRange SecondaryVertex::tracks_along_jet(
+  const std::vector<SecondaryVertexTrack>& table) const {
+  SecondaryVertexTrackRange range;
+  range.first = table.data() + first_track;
+  range.last = range.first + n_tracks_along_jet;
+  return range;
+}
+
+const char* config_name(SecondaryVertexConfig config) {
+  switch (config) {
+  case SecondaryVertexConfig::high_level: return "high-level";
+  case SecondaryVertexConfig::med_level: return "med-level";
+  case SecondaryVertexConfig::zork: return "zork";
+  default: return "null";
+  }
 }
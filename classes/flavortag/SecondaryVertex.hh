@@ -3,6 +3,9 @@
 
 #include "TVector3.h"
 
+#include <cstddef>
+#include <vector>
+
 class Candidate;
 
 struct SecondaryVertexTrack
@@ -19,6 +22,20 @@ struct SecondaryVertexTrack
   Candidate* delphes_track;
 };
 
+// tracks of one vertex, a slice of the track table of its jet
+struct SecondaryVertexTrackRange
+{
+  const SecondaryVertexTrack* first;
+  const SecondaryVertexTrack* last;
+  const SecondaryVertexTrack* begin() const { return first; }
+  const SecondaryVertexTrack* end() const { return last; }
+  size_t size() const { return last - first; }
+};
+
+// fit a vertex comes from, written out as a string by TreeWriter
+enum class SecondaryVertexConfig { null, high_level, med_level, zork };
+const char* config_name(SecondaryVertexConfig);
+
 class SecondaryVertex: public TVector3
 {
 public:
@@ -30,11 +47,16 @@ public:
   int nTracks;
   double eFrac;
   double mass;
-  std::string config;
+  SecondaryVertexConfig config;
   double deta;
   double dphi;
-  // std::vector<std::pair<double, Candidate*> > tracks;
-  std::vector<SecondaryVertexTrack> tracks_along_jet;
+  // the tracks along the jet are kept in a table shared by the vertices
+  // of the jet, see CandidateFlavorTagging, so that the vertex itself
+  // owns no memory
+  size_t first_track;
+  size_t n_tracks_along_jet;
+  SecondaryVertexTrackRange tracks_along_jet(
+    const std::vector<SecondaryVertexTrack>& table) const;
   void clear();
 };
 
@@ -3,7 +3,6 @@
 // #include "classes/DelphesClasses.h"
 #include "constants_jetprob.hh"
 #include "enums_track.hh"
-#include "math.hh"
 
 #include <vector>
 #include <utility>
@@ -17,24 +16,24 @@
 struct TrackParameters;
 
 namespace {
-  typedef std::vector<TrackParameters> Tracks;
-
   const double pi = std::atan2(0, -1);
   static_assert(std::numeric_limits<double>::has_infinity, "need inf");
   const double inf = std::numeric_limits<double>::infinity();
   static_assert(std::numeric_limits<double>::has_quiet_NaN, "need NaN");
   const double NaN = std::numeric_limits<double>::quiet_NaN();
-  template<typename T>
-  bool by_descending_first(std::pair<double, T> v1, std::pair<double, T> v2) {
-    return v1.first > v2.first;
-  }
-  double get_jet_prob(const std::vector<TrackParameters>&);
+  // indices of the (up to) three largest values, largest first
+  std::vector<size_t> highest_three(const std::vector<float>&);
+  // d0 signed by the jet direction
+  void signed_ip(const TrackParameterBlock&, float jet_phi,
+		 std::vector<float>& out);
+  double get_jet_prob(const std::vector<float>& d0sig);
 
   // see hardcoded parameters in constants_jetprob.hh
   double get_track_prob(double d0sig);
 
   typedef std::pair<double, double> JetWidth;
-  JetWidth jet_width2_eta_phi(const TVector3& jet, const Tracks& tracks);
+  JetWidth jet_width2_eta_phi(const TVector3& jet,
+			      const TrackParameterBlock& tracks);
 
 }
 
@@ -125,6 +124,83 @@ std::ostream& operator<<(std::ostream& os, const TrackParameters& hl) {
   return os;
 }
 
+TrackParameterBlock::TrackParameterBlock()
+{
+}
+
+TrackParameterBlock::TrackParameterBlock(
+  const std::vector<TrackParameters>& pars)
+{
+  reserve(pars.size());
+  for (const auto& par: pars) push_back(par);
+}
+
+void TrackParameterBlock::push_back(const float trkPar[5],
+				    const float trkCov[15]) {
+  d0.push_back(trkPar[trk::D0]);
+  z0.push_back(trkPar[trk::Z0]);
+  phi.push_back(trkPar[trk::PHI]);
+  theta.push_back(trkPar[trk::THETA]);
+  qoverp.push_back(trkPar[trk::QOVERP]);
+  d0err.push_back(std::sqrt(trkCov[trk::D0D0]));
+  z0err.push_back(std::sqrt(trkCov[trk::Z0Z0]));
+}
+
+void TrackParameterBlock::push_back(const TrackParameters& par) {
+  d0.push_back(par.d0);
+  z0.push_back(par.z0);
+  phi.push_back(par.phi);
+  theta.push_back(par.theta);
+  qoverp.push_back(par.qoverp);
+  d0err.push_back(par.d0err);
+  z0err.push_back(par.z0err);
+}
+
+void TrackParameterBlock::reserve(size_t n) {
+  for (auto* vec: {&d0, &z0, &phi, &theta, &qoverp, &d0err, &z0err}) {
+    vec->reserve(n);
+  }
+}
+
+void TrackParameterBlock::clear() {
+  for (auto* vec: {&d0, &z0, &phi, &theta, &qoverp, &d0err, &z0err}) {
+    vec->clear();
+  }
+}
+
+size_t TrackParameterBlock::size() const {
+  return d0.size();
+}
+
+void significance(const std::vector<float>& value,
+		  const std::vector<float>& error,
+		  std::vector<float>& out) {
+  assert(value.size() == error.size());
+  const size_t n = value.size();
+  out.resize(n);
+  const float* val = value.data();
+  const float* err = error.data();
+  float* sig = out.data();
+  for (size_t iii = 0; iii < n; iii++) {
+    sig[iii] = val[iii] / err[iii];
+  }
+}
+
+int count_over(const std::vector<float>& values, float threshold) {
+  int n_over = 0;
+  for (float val: values) {
+    n_over += (val > threshold) ? 1 : 0;
+  }
+  return n_over;
+}
+
+float signed_ip(float d0, float track_phi, float jet_phi) {
+  const float quarter = pi/4;
+  float diff = std::abs(jet_phi - track_phi);
+  float sign = (diff > 3*quarter || diff < 2*quarter) ? 1 : -1;
+  return sign * std::abs(d0);
+}
+
 HighLevelTracking::HighLevelTracking():
   track2d0sig(NaN), track3d0sig(NaN),
   track2z0sig(NaN), track3z0sig(NaN),
@@ -136,10 +212,28 @@ HighLevelTracking::HighLevelTracking():
 void HighLevelTracking::fill(const TVector3& jet,
 			     const std::vector<TrackParameters>& pars,
 			     double ip_threshold) {
-  // size_t n_tracks = pars.size();
+  fill(jet, TrackParameterBlock(pars), ip_threshold);
+}
+
+void HighLevelTracking::fill(const TVector3& jet,
+			     const TrackParameterBlock& pars,
+			     double ip_threshold) {
   double jet_phi = jet.Phi();
   assert(std::abs(jet_phi) <= pi);
-  std::vector<std::pair<double, TrackParameters> > tracks_by_ip;
+
+  std::vector<float> ip;
+  signed_ip(pars, jet_phi, ip);
+  std::vector<float> ip_sig;
+  significance(ip, pars.d0err, ip_sig);
+  fill(jet, pars, ip, ip_sig, ip_threshold);
+}
+
+void HighLevelTracking::fill(const TVector3& jet,
+			     const TrackParameterBlock& pars,
+			     const std::vector<float>& ip,
+			     const std::vector<float>& ip_sig,
+			     double ip_threshold) {
+  assert(ip.size() == pars.size() && ip_sig.size() == pars.size());
 
   // zero some things
   track2d0sig = -inf;
@@ -158,33 +252,25 @@ void HighLevelTracking::fill(const TVector3& jet,
   }
 
   if (pars.size() == 0) return;
-  jetProb = get_jet_prob(pars);
+  jetProb = get_jet_prob(ip_sig);
 
   // what follows uses numbered tracks (track counting)
   if (pars.size() < 2) return;
 
-  for (const auto& par: pars) {
-    double diff = std::abs(jet_phi - par.phi);
-    int sign = (diff > 3*pi/4 || diff < pi/2) ? 1 : -1;
-    double ip = std::copysign(par.d0, sign);
-    tracks_by_ip.emplace_back(ip, par);
-    if ((ip / par.d0err) > ip_threshold) tracksOverIpThreshold++;
-  }
+  tracksOverIpThreshold = count_over(ip_sig, ip_threshold);
 
-  std::sort(tracks_by_ip.begin(), tracks_by_ip.end(),
-	    by_descending_first<TrackParameters>);
+  // we only need the second and third tracks, no need for a full sort
+  std::vector<size_t> by_ip = highest_three(ip);
   {
-    const auto& trk2 = tracks_by_ip.at(1);
-    const auto& p2 = trk2.second;
-    track2d0sig = std::copysign(p2.d0 / p2.d0err, trk2.first);
-    track2z0sig = std::abs(p2.z0 / p2.z0err);
+    size_t trk2 = by_ip.at(1);
+    track2d0sig = ip_sig.at(trk2);
+    track2z0sig = std::abs(pars.z0.at(trk2) / pars.z0err.at(trk2));
   }
-  if (tracks_by_ip.size() < 3) return;
+  if (by_ip.size() < 3) return;
   {
-    const auto& trk3 = tracks_by_ip.at(2);
-    const auto& p3 = trk3.second;
-    track3d0sig = std::copysign(p3.d0 / p3.d0err, trk3.first);
-    track3z0sig = std::abs(p3.z0 / p3.z0err);
+    size_t trk3 = by_ip.at(2);
+    track3d0sig = ip_sig.at(trk3);
+    track3z0sig = std::abs(pars.z0.at(trk3) / pars.z0err.at(trk3));
   }
 }
 
@@ -217,33 +303,39 @@ namespace {
       exp_prob(sig, P4, P5) + exp_prob(sig, P6, P7);
     return prob;
   }
-  double get_jet_prob(const std::vector<TrackParameters>& pars) {
+  double get_jet_prob(const std::vector<float>& sig) {
+    // the sign of the significance doesn't matter here
     double p0 = 1.0;
-    for (const auto& par: pars) {
-      double sig = par.d0 / par.d0err;
-      double prob = get_track_prob(std::abs(sig));
-      p0 *= prob;
+    for (float d0sig: sig) {
+      p0 *= get_track_prob(std::abs(d0sig));
     }
-    int n_trk = pars.size();
+    int n_trk = sig.size();
     double corrections = 0;
     for (int k = 0; k < n_trk; k++) {
       corrections += std::pow( -std::log(p0), k) / std::tgamma(k + 1);
     }
     return p0 * corrections;
   }
-  JetWidth jet_width2_eta_phi(const TVector3& jet, const Tracks& tracks) {
-    if (tracks.size() < 1) return {-1, -1};
-
-    const double jet_eta = jet.Eta();
-    const double jet_phi = jet.Phi();
+  JetWidth jet_width2_eta_phi(const TVector3& jet,
+			      const TrackParameterBlock& tracks) {
+    const size_t n = tracks.size();
+    if (n < 1) return {-1, -1};
+
+    const float jet_eta = jet.Eta();
+    const float jet_phi = jet.Phi();
+    const float fpi = pi;
+    const float* theta = tracks.theta.data();
+    const float* phi = tracks.phi.data();
+    const float* qoverp = tracks.qoverp.data();
     double sum_pt_times_eta2 = 0;
     double sum_pt_times_phi2 = 0;
     double sum_pt = 0;
-    for (const auto& trk: tracks) {
-      double eta = -std::log(std::tan(trk.theta/2));
-      double deta = eta - jet_eta;
-      double dphi = phi_mpi_pi(trk.phi, jet_phi);
-      double track_pt = std::abs(1 / (trk.qoverp * std::cosh(eta)));
+    for (size_t iii = 0; iii < n; iii++) {
+      float eta = -std::log(std::tan(theta[iii]/2));
+      float deta = eta - jet_eta;
+      float dphi = phi[iii] - jet_phi;
+      if (std::abs(dphi) > fpi) dphi -= std::copysign(2*fpi, dphi);
+      float track_pt = std::abs(1 / (qoverp[iii] * std::cosh(eta)));
       sum_pt += track_pt;
       sum_pt_times_eta2 += track_pt * deta*deta;
       sum_pt_times_phi2 += track_pt * dphi*dphi;
@@ -251,4 +343,25 @@ namespace {
     assert(sum_pt > 0);
     return {sum_pt_times_eta2 / sum_pt, sum_pt_times_phi2 / sum_pt};
   }
+  void signed_ip(const TrackParameterBlock& pars, float jet_phi,
+		 std::vector<float>& out) {
+    const size_t n = pars.size();
+    out.resize(n);
+    const float* d0 = pars.d0.data();
+    const float* phi = pars.phi.data();
+    float* ip = out.data();
+    for (size_t iii = 0; iii < n; iii++) {
+      ip[iii] = ::signed_ip(d0[iii], phi[iii], jet_phi);
+    }
+  }
+  std::vector<size_t> highest_three(const std::vector<float>& values) {
+    std::vector<size_t> top;
+    for (size_t iii = 0; iii < values.size(); iii++) {
+      auto pos = top.begin();
+      while (pos != top.end() && values.at(*pos) >= values.at(iii)) pos++;
+      if (pos - top.begin() < 3) top.insert(pos, iii);
+      if (top.size() > 3) top.pop_back();
+    }
+    return top;
+  }
 }
@@ -66,11 +66,46 @@ struct TrackParameters
 };
 std::ostream& operator<<(std::ostream& os, const TrackParameters&);
 
+// Struct-of-arrays version of the above. The loops over these are
+// simple enough that the compiler can vectorize them.
+struct TrackParameterBlock
+{
+  TrackParameterBlock();
+  explicit TrackParameterBlock(const std::vector<TrackParameters>&);
+  void push_back(const float trkPar[5], const float trkCov[15]);
+  void push_back(const TrackParameters&);
+  void reserve(size_t);
+  void clear();
+  size_t size() const;
+  std::vector<float> d0;
+  std::vector<float> z0;
+  std::vector<float> phi;
+  std::vector<float> theta;
+  std::vector<float> qoverp;
+  std::vector<float> d0err;
+  std::vector<float> z0err;
+};
+
+// Kernels shared by the track-based taggers. `out` is resized to fit.
+void significance(const std::vector<float>& value,
+		  const std::vector<float>& error,
+		  std::vector<float>& out);
+int count_over(const std::vector<float>& values, float threshold);
+// d0 of a track signed by its phi with respect to the jet
+float signed_ip(float d0, float track_phi, float jet_phi);
+
 struct HighLevelTracking
 {
   HighLevelTracking();
   void fill(const TVector3& jet, const std::vector<TrackParameters>&,
 	    double ip_threshold = 1.8);
+  void fill(const TVector3& jet, const TrackParameterBlock&,
+	    double ip_threshold = 1.8);
+  // with the signed d0 of the tracks and its significance already
+  // computed, as in DelphesImpactParameters
+  void fill(const TVector3& jet, const TrackParameterBlock&,
+	    const std::vector<float>& ip, const std::vector<float>& ip_sig,
+	    double ip_threshold = 1.8);
   double track2d0sig;
   double track3d0sig;
   double track2z0sig;
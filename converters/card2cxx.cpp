@@ -0,0 +1,214 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdexcept>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <set>
+#include <vector>
+
+#include <stdio.h>
+
+#include "classes/DelphesFormula.h"
+
+#include "ExRootAnalysis/ExRootConfReader.h"
+
+using namespace std;
+
+//---------------------------------------------------------------------------
+
+static void WriteString(ostream &out, const string &text)
+{
+  string::const_iterator it;
+  char buffer[8];
+
+  out << '"';
+  for(it = text.begin(); it != text.end(); ++it)
+  {
+    switch(*it)
+    {
+      case '"': out << "\\\""; break;
+      case '\\': out << "\\\\"; break;
+      case '?': out << "\\?"; break;
+      case '\t': out << "\\t"; break;
+      case '\n':
+        // one line of the literal per line of the card
+        out << "\\n\"";
+        if(it + 1 != text.end()) out << "\n  \"";
+        else out << "\"";
+        break;
+      default:
+        if(static_cast<unsigned char>(*it) < 0x20 || *it == 0x7f)
+        {
+          snprintf(buffer, sizeof(buffer), "\\%03o", static_cast<unsigned char>(*it));
+          out << buffer;
+        }
+        else
+        {
+          out << *it;
+        }
+    }
+  }
+  out << '"';
+}
+
+//---------------------------------------------------------------------------
+
+static void CollectFormulas(ExRootConfParam param, set<string> &formulas, vector< pair< string, string > > &functions)
+{
+  string expression, code;
+  Int_t i, size;
+
+  expression = param.GetString();
+
+  if(expression.find("pt") != string::npos || expression.find("eta") != string::npos ||
+     expression.find("phi") != string::npos || expression.find("energy") != string::npos)
+  {
+    if(DelphesFormula::Translate(expression.c_str(), code))
+    {
+      if(formulas.insert(expression).second) functions.push_back(make_pair(expression, code));
+      return;
+    }
+  }
+
+  // the formulas are also found in the lists of the card
+  try
+  {
+    size = param.GetSize();
+  }
+  catch(runtime_error &e)
+  {
+    return;
+  }
+  if(size < 2) return;
+
+  for(i = 0; i < size; ++i)
+  {
+    CollectFormulas(param[i], formulas, functions);
+  }
+}
+
+//---------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+  char appName[] = "card2cxx";
+  ExRootConfReader *confReader = 0;
+  stringstream compiled;
+  string keyword, name, value, cardName;
+  size_t nameLength, valueLength, i;
+  set<string> formulas;
+  vector< pair< string, string > > functions;
+
+  if(argc < 3 || argc > 4)
+  {
+    cout << " Usage: " << appName << " config_file" << " output_file" << " [card_name]" << endl;
+    cout << " config_file - configuration file in Tcl format," << endl;
+    cout << " output_file - C++ file with the compiled card and its formulas," << endl;
+    cout << " card_name - name the card is given as to the Delphes executables, config_file by default." << endl;
+    cout << endl;
+    cout << " The output file is compiled and linked with the object file of a Delphes" << endl;
+    cout << " executable and with libDelphes, the executable then reads the card from" << endl;
+    cout << " itself and evaluates its formulas as compiled C++ functions." << endl;
+    return 1;
+  }
+
+  cardName = (argc == 4) ? argv[3] : argv[1];
+
+  try
+  {
+    confReader = new ExRootConfReader;
+    confReader->ReadFile(argv[1]);
+    confReader->WriteCompiled(compiled);
+
+    // the names of the variables are those of the compiled card
+    getline(compiled, keyword);
+    while(compiled >> keyword)
+    {
+      if(keyword == "module")
+      {
+        compiled >> name >> name;
+        continue;
+      }
+      if(keyword != "variable" || !(compiled >> nameLength >> valueLength) || compiled.get() != '\n')
+      {
+        throw runtime_error("can't read the compiled configuration");
+      }
+      name.resize(nameLength);
+      value.resize(valueLength);
+      compiled.read(&name[0], nameLength);
+      compiled.read(&value[0], valueLength);
+
+      CollectFormulas(confReader->GetParam(name.c_str()), formulas, functions);
+    }
+
+    ofstream out(argv[2]);
+    if(!out)
+    {
+      throw runtime_error(string("can't open output file ") + argv[2]);
+    }
+
+    out << "// written by card2cxx from " << argv[1] << "\n\n";
+    out << "#include \"TMath.h\"\n\n";
+    out << "#include \"classes/DelphesFormula.h\"\n\n";
+    out << "#include \"ExRootAnalysis/ExRootConfReader.h\"\n\n";
+    out << "namespace\n{\n\n";
+
+    for(i = 0; i < functions.size(); ++i)
+    {
+      out << "Double_t Formula" << i << "(const Double_t *x)\n{\n";
+      out << "  return " << functions[i].second << ";\n}\n\n";
+    }
+
+    out << "const char kCard[] =\n  ";
+    WriteString(out, compiled.str());
+    out << ";\n\n";
+
+    out << "struct Registration\n{\n  Registration()\n  {\n";
+    out << "    ExRootConfReader::AddBuiltinCard(";
+    WriteString(out, cardName);
+    out << ", kCard);\n";
+    for(i = 0; i < functions.size(); ++i)
+    {
+      out << "    DelphesFormula::AddNative(";
+      WriteString(out, functions[i].first);
+      out << ", Formula" << i << ");\n";
+    }
+    out << "  }\n} registration;\n\n}\n";
+
+    out.close();
+    if(!out)
+    {
+      throw runtime_error(string("can't write output file ") + argv[2]);
+    }
+
+    cout << "** " << functions.size() << " formulas compiled" << endl;
+    cout << "** Exiting..." << endl;
+
+    delete confReader;
+    return 0;
+  }
+  catch(runtime_error &e)
+  {
+    if(confReader) delete confReader;
+    cerr << "** ERROR: " << e.what() << endl;
+    return 1;
+  }
+}
@@ -0,0 +1,399 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Concatenate datasets from several HDF5Writer output files.
+//
+// Full chunks are copied with direct chunk I/O, so the compressed data
+// is never decompressed or recompressed. This needs HDF5 >= 1.10.2 and
+// only works for fixed-size types: variable-length data (the default
+// `jets` layout) points into the global heap of its own file, so it is
+// read and rewritten one chunk at a time instead.
+//
+// Raw copies need the output to stay chunk-aligned, so the partially
+// filled last chunk of each input is moved to the end of the output.
+//
+// With `-s` the chunks are shuffled (with the given seed). The order of
+// the rows is worked out once for all the datasets with the same number
+// of rows in every input, from the chunk size of the first of them, and
+// applied to each of them, whatever their type. So `jets`,
+// `jet_event_index` and e.g. `n_primary_vertex_tracks` stay aligned. A
+// dataset with another chunk size is then copied row by row. The values
+// of indices into other datasets (`jet_event_index`) are not updated.
+
+#include <stdexcept>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "hdf5.h"
+#include "hdf5_hl.h"
+
+using namespace std;
+
+namespace {
+
+  // close HDF5 handles when they go out of scope
+  class Handle
+  {
+  public:
+    Handle(hid_t id, herr_t (*closer)(hid_t), const string& what):
+      fId(id), fCloser(closer)
+    {
+      if(fId < 0) throw runtime_error("failed to " + what);
+    }
+    ~Handle() { fCloser(fId); }
+    Handle(const Handle&) = delete;
+    Handle& operator=(const Handle&) = delete;
+    operator hid_t() const { return fId; }
+  private:
+    hid_t fId;
+    herr_t (*fCloser)(hid_t);
+  };
+
+  void check(herr_t status, const string& what)
+  {
+    if(status < 0) throw runtime_error("failed to " + what);
+  }
+
+  // a range of rows of one input
+  struct Block
+  {
+    size_t file;
+    hsize_t first;
+    hsize_t n_rows;
+  };
+
+  // order of the rows of the datasets with these numbers of rows in the
+  // inputs
+  struct Plan
+  {
+    vector<hsize_t> rows;
+    vector<Block> blocks;
+  };
+
+  // full chunks of all the inputs first, then the left over rows
+  Plan make_plan(const vector<hsize_t>& rows, hsize_t chunk_rows,
+    bool shuffle, unsigned int seed)
+  {
+    Plan plan;
+    plan.rows = rows;
+    vector<Block> partial;
+    for(size_t i = 0; i < rows.size(); ++i)
+    {
+      hsize_t n_full = rows[i] / chunk_rows;
+      for(hsize_t c = 0; c < n_full; ++c)
+      {
+        plan.blocks.push_back(Block{i, c*chunk_rows, chunk_rows});
+      }
+      hsize_t n_left = rows[i] % chunk_rows;
+      if(n_left > 0) partial.push_back(Block{i, n_full*chunk_rows, n_left});
+    }
+
+    if(shuffle)
+    {
+      mt19937 generator(seed);
+      std::shuffle(plan.blocks.begin(), plan.blocks.end(), generator);
+      std::shuffle(partial.begin(), partial.end(), generator);
+    }
+    plan.blocks.insert(plan.blocks.end(), partial.begin(), partial.end());
+    return plan;
+  }
+
+  bool same_filters(hid_t plist1, hid_t plist2)
+  {
+    int n_filters = H5Pget_nfilters(plist1);
+    if(n_filters != H5Pget_nfilters(plist2)) return false;
+    for(int i = 0; i < n_filters; ++i)
+    {
+      unsigned int flags, cd_values[2][20];
+      size_t n_values[2] = {20, 20};
+      H5Z_filter_t filter1 = H5Pget_filter2(
+        plist1, i, &flags, &n_values[0], cd_values[0], 0, 0, 0);
+      H5Z_filter_t filter2 = H5Pget_filter2(
+        plist2, i, &flags, &n_values[1], cd_values[1], 0, 0, 0);
+      if(filter1 != filter2 || n_values[0] != n_values[1]) return false;
+      if(!equal(cd_values[0], cd_values[0] + n_values[0], cd_values[1]))
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  vector<hsize_t> get_dims(hid_t dataset)
+  {
+    Handle space(H5Dget_space(dataset), H5Sclose, "get dataspace");
+    vector<hsize_t> dims(H5Sget_simple_extent_ndims(space));
+    H5Sget_simple_extent_dims(space, dims.data(), 0);
+    return dims;
+  }
+
+  // copy one compressed chunk, returns false if direct chunk I/O isn't
+  // available in this HDF5 version
+  bool copy_chunk(hid_t input, hid_t output, const vector<hsize_t>& in_offset,
+    const vector<hsize_t>& out_offset, vector<char>& buffer)
+  {
+#if H5_VERSION_GE(1, 10, 2)
+    hsize_t n_bytes = 0;
+    check(H5Dget_chunk_storage_size(input, in_offset.data(), &n_bytes),
+      "get chunk size");
+    buffer.resize(n_bytes);
+    uint32_t filters = 0;
+    check(H5DOread_chunk(input, H5P_DEFAULT, in_offset.data(), &filters,
+      buffer.data()), "read chunk");
+    check(H5DOwrite_chunk(output, H5P_DEFAULT, filters, out_offset.data(),
+      n_bytes, buffer.data()), "write chunk");
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  // read rows through the filter pipeline and write them again
+  void copy_rows(hid_t input, hid_t output, hid_t mem_type,
+    const vector<hsize_t>& in_offset, const vector<hsize_t>& out_offset,
+    const vector<hsize_t>& count, vector<char>& buffer)
+  {
+    size_t n_elements = 1;
+    for(size_t i = 0; i < count.size(); ++i) n_elements *= count[i];
+    buffer.resize(n_elements * H5Tget_size(mem_type));
+
+    Handle mem_space(H5Screate_simple(count.size(), count.data(), 0),
+      H5Sclose, "create memory space");
+    Handle in_space(H5Dget_space(input), H5Sclose, "get input space");
+    check(H5Sselect_hyperslab(in_space, H5S_SELECT_SET, in_offset.data(),
+      0, count.data(), 0), "select input rows");
+    check(H5Dread(input, mem_type, mem_space, in_space, H5P_DEFAULT,
+      buffer.data()), "read rows");
+
+    Handle out_space(H5Dget_space(output), H5Sclose, "get output space");
+    check(H5Sselect_hyperslab(out_space, H5S_SELECT_SET, out_offset.data(),
+      0, count.data(), 0), "select output rows");
+    herr_t status = H5Dwrite(output, mem_type, mem_space, out_space,
+      H5P_DEFAULT, buffer.data());
+
+    // variable-length data is allocated by the library on read
+    if(H5Tdetect_class(mem_type, H5T_VLEN) > 0)
+    {
+      H5Dvlen_reclaim(mem_type, mem_space, H5P_DEFAULT, buffer.data());
+    }
+    check(status, "write rows");
+  }
+
+  void merge_dataset(hid_t output, const vector<hid_t>& inputs,
+    const string& name, vector<Plan>& plans, bool shuffle, unsigned int seed)
+  {
+    // the first input defines the type, chunking, and compression
+    Handle first(H5Dopen2(inputs.at(0), name.c_str(), H5P_DEFAULT),
+      H5Dclose, "open " + name);
+    Handle type(H5Dget_type(first), H5Tclose, "get type of " + name);
+    Handle plist(H5Dget_create_plist(first), H5Pclose, "get properties");
+    if(H5Pget_layout(plist) != H5D_CHUNKED)
+    {
+      throw runtime_error(name + " isn't chunked");
+    }
+    vector<hsize_t> dims = get_dims(first);
+    vector<hsize_t> chunk(dims.size());
+    H5Pget_chunk(plist, chunk.size(), chunk.data());
+    const hsize_t chunk_rows = chunk.at(0);
+
+    // heap references can't be copied from one file to another
+    bool fixed_size = H5Tdetect_class(type, H5T_VLEN) <= 0 &&
+      H5Tdetect_class(type, H5T_REFERENCE) <= 0;
+
+    Handle mem_type(H5Tget_native_type(type, H5T_DIR_ASCEND), H5Tclose,
+      "get native type");
+
+    // build the output dataset, creating parent groups as needed
+    vector<hsize_t> max_dims = dims;
+    max_dims.at(0) = H5S_UNLIMITED;
+    dims.at(0) = 0;
+    Handle space(H5Screate_simple(dims.size(), dims.data(), max_dims.data()),
+      H5Sclose, "create dataspace");
+    Handle link_plist(H5Pcreate(H5P_LINK_CREATE), H5Pclose,
+      "create link properties");
+    H5Pset_create_intermediate_group(link_plist, 1);
+    Handle merged(H5Dcreate2(output, name.c_str(), type, space, link_plist,
+      plist, H5P_DEFAULT), H5Dclose, "create " + name);
+
+    // rows of every input, and whether its chunks can be copied raw
+    vector<hsize_t> rows;
+    vector<bool> raw;
+    for(size_t i = 0; i < inputs.size(); ++i)
+    {
+      Handle dataset(H5Dopen2(inputs[i], name.c_str(), H5P_DEFAULT),
+        H5Dclose, "open " + name);
+      Handle input_type(H5Dget_type(dataset), H5Tclose, "get type");
+      Handle input_plist(H5Dget_create_plist(dataset), H5Pclose,
+        "get properties");
+      vector<hsize_t> input_dims = get_dims(dataset);
+      if(H5Tequal(type, input_type) <= 0 || input_dims.size() != dims.size() ||
+        !equal(input_dims.begin() + 1, input_dims.end(), dims.begin() + 1))
+      {
+        throw runtime_error("inconsistent " + name + " in input " +
+          to_string(i + 1));
+      }
+      vector<hsize_t> input_chunk(chunk.size());
+      raw.push_back(fixed_size &&
+        H5Pget_layout(input_plist) == H5D_CHUNKED &&
+        H5Pget_chunk(input_plist, input_chunk.size(), input_chunk.data()) >= 0 &&
+        input_chunk == chunk && same_filters(plist, input_plist));
+      rows.push_back(input_dims[0]);
+    }
+
+    // the datasets with the same rows share their order
+    const Plan* plan = 0;
+    for(size_t p = 0; p < plans.size() && !plan; ++p)
+    {
+      if(plans[p].rows == rows) plan = &plans[p];
+    }
+    if(!plan)
+    {
+      plans.push_back(make_plan(rows, chunk_rows, shuffle, seed));
+      plan = &plans.back();
+    }
+    const vector<Block>& blocks = plan->blocks;
+
+    // copy everything over
+    hsize_t offset = 0, n_raw = 0;
+    vector<char> buffer;
+    for(size_t b = 0; b < blocks.size(); ++b)
+    {
+      const Block& block = blocks[b];
+      Handle dataset(H5Dopen2(inputs[block.file], name.c_str(), H5P_DEFAULT),
+        H5Dclose, "open " + name);
+
+      vector<hsize_t> total = max_dims;
+      total[0] = offset + block.n_rows;
+      check(H5Dset_extent(merged, total.data()), "extend " + name);
+
+      vector<hsize_t> in_offset(dims.size(), 0), out_offset(dims.size(), 0);
+      in_offset[0] = block.first;
+      out_offset[0] = offset;
+      // a whole chunk of this dataset that lands on a chunk of the output
+      bool aligned = offset % chunk_rows == 0 &&
+        block.first % chunk_rows == 0 && block.n_rows == chunk_rows;
+      if(raw[block.file] && aligned &&
+        copy_chunk(dataset, merged, in_offset, out_offset, buffer))
+      {
+        ++n_raw;
+      }
+      else
+      {
+        vector<hsize_t> count = total;
+        count[0] = block.n_rows;
+        copy_rows(dataset, merged, mem_type, in_offset, out_offset, count,
+          buffer);
+      }
+      offset += block.n_rows;
+    }
+
+    cout << "** " << name << ": " << offset << " rows, " << n_raw << " of ";
+    cout << blocks.size() << " blocks copied as raw chunks" << endl;
+  }
+}
+
+//---------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+  char appName[] = "h5merge";
+  vector<string> datasets;
+  bool shuffle = false;
+  unsigned int seed = 0;
+  int i = 1;
+
+  while(i < argc && argv[i][0] == '-' && argv[i][1] != '\0')
+  {
+    if(strcmp(argv[i], "-d") == 0 && i + 1 < argc)
+    {
+      datasets.push_back(argv[i + 1]);
+      i += 2;
+    }
+    else if(strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+    {
+      shuffle = true;
+      seed = strtoul(argv[i + 1], 0, 10);
+      i += 2;
+    }
+    else
+    {
+      break;
+    }
+  }
+
+  if(argc - i < 2 || (i < argc && argv[i][0] == '-'))
+  {
+    cout << " Usage: " << appName << " [-d dataset]... [-s seed]" << " output_file" << " input_file(s)" << endl;
+    cout << " -d dataset - dataset to merge, can be repeated (default: jets)," << endl;
+    cout << " -s seed - shuffle the chunks using this random seed," << endl;
+    cout << " output_file - output file in HDF5 format," << endl;
+    cout << " input_file(s) - HDF5Writer output file(s)." << endl;
+    return 1;
+  }
+
+  if(datasets.empty()) datasets.push_back("jets");
+
+  try
+  {
+    Handle outputFile(H5Fcreate(argv[i], H5F_ACC_EXCL, H5P_DEFAULT,
+      H5P_DEFAULT), H5Fclose, string("create output file ") + argv[i]);
+
+    vector<hid_t> inputs;
+    for(int j = i + 1; j < argc; ++j)
+    {
+      hid_t input = H5Fopen(argv[j], H5F_ACC_RDONLY, H5P_DEFAULT);
+      if(input < 0)
+      {
+        for(size_t k = 0; k < inputs.size(); ++k) H5Fclose(inputs[k]);
+        throw runtime_error(string("can't open ") + argv[j]);
+      }
+      inputs.push_back(input);
+    }
+
+    try
+    {
+      vector<Plan> plans;
+      for(size_t d = 0; d < datasets.size(); ++d)
+      {
+        merge_dataset(outputFile, inputs, datasets[d], plans, shuffle, seed);
+      }
+    }
+    catch(runtime_error &e)
+    {
+      for(size_t k = 0; k < inputs.size(); ++k) H5Fclose(inputs[k]);
+      throw;
+    }
+    for(size_t k = 0; k < inputs.size(); ++k) H5Fclose(inputs[k]);
+
+    cout << "** Exiting..." << endl;
+
+    return 0;
+  }
+  catch(runtime_error &e)
+  {
+    cerr << "** ERROR: " << e.what() << endl;
+    return 1;
+  }
+}
@@ -19,7 +19,13 @@
 #include <stdexcept>
 #include <iostream>
 #include <sstream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
 
+#include <stdlib.h>
+#include <string.h>
 #include <signal.h>
 
 #include "TROOT.h"
@@ -32,9 +38,12 @@
 #include "TParticlePDG.h"
 #include "TLorentzVector.h"
 
+#include "modules/DelphesReaderThread.h"
+
 #include "classes/DelphesClasses.h"
 #include "classes/DelphesFactory.h"
 #include "classes/DelphesHepMCReader.h"
+#include "classes/DelphesLineReader.h"
 #include "classes/DelphesPileUpWriter.h"
 
 #include "ExRootAnalysis/ExRootTreeWriter.h"
@@ -45,6 +54,104 @@ using namespace std;
 
 //---------------------------------------------------------------------------
 
+void ProcessEvent(TObjArray *stableParticleOutputArray, DelphesPileUpWriter *writer)
+{
+  TIter itParticle(stableParticleOutputArray);
+  Candidate *candidate;
+
+  while((candidate = static_cast<Candidate*>(itParticle.Next())))
+  {
+    const TLorentzVector &position = candidate->Position;
+    const TLorentzVector &momentum = candidate->Momentum;
+    writer->WriteParticle(candidate->PID,
+      position.X(), position.Y(), position.Z(), position.T(),
+      momentum.Px(), momentum.Py(), momentum.Pz(), momentum.E());
+  }
+
+  writer->WriteEntry();
+}
+
+//---------------------------------------------------------------------------
+
+// Splits the input into the lines of single events for the parsing
+// threads, which take them in turn: the thread i gets the events i, i+N,
+// i+2N... in the order DelphesReaderThread hands them back.
+
+class EventSplitter
+{
+public:
+
+  EventSplitter(Int_t nThreads) : fQueues(nThreads), fNext(0) {}
+
+  void SetInputFile(FILE *inputFile)
+  {
+    fLineReader.SetInputFile(inputFile);
+    fQueues.assign(fQueues.size(), deque< string >());
+    fNext = 0;
+  }
+
+  // false at the end of the input
+  Bool_t NextEvent(Int_t thread, string &text)
+  {
+    lock_guard< mutex > lock(fMutex);
+    string event;
+
+    while(fQueues[thread].empty())
+    {
+      if(!ReadEvent(event)) return kFALSE;
+      fQueues[fNext % fQueues.size()].push_back(event);
+      ++fNext;
+    }
+
+    text.swap(fQueues[thread].front());
+    fQueues[thread].pop_front();
+    return kTRUE;
+  }
+
+  Long64_t GetPosition()
+  {
+    lock_guard< mutex > lock(fMutex);
+    return fLineReader.GetPosition();
+  }
+
+private:
+
+  // lines from an E line to the next one, the lines before the first
+  // event are dropped
+  Bool_t ReadEvent(string &text)
+  {
+    char *line;
+    Bool_t found = kFALSE;
+
+    text.clear();
+    while((line = fLineReader.ReadLine()))
+    {
+      if(line[0] == 'E')
+      {
+        if(found)
+        {
+          fLineReader.UnreadLine();
+          return kTRUE;
+        }
+        found = kTRUE;
+      }
+      if(found)
+      {
+        text.append(line);
+        text.push_back('\n');
+      }
+    }
+    return found;
+  }
+
+  DelphesLineReader fLineReader;
+  vector< deque< string > > fQueues;
+  Long64_t fNext;
+  mutex fMutex;
+};
+
+//---------------------------------------------------------------------------
+
 static bool interrupted = false;
 
 void SignalHandler(int sig)
@@ -61,16 +168,34 @@ int main(int argc, char *argv[])
   FILE *inputFile = 0;
   DelphesFactory *factory = 0;
   TObjArray *stableParticleOutputArray = 0, *allParticleOutputArray = 0, *partonOutputArray = 0;
-  TIterator *itParticle = 0;
-  Candidate *candidate = 0;
   DelphesPileUpWriter *writer = 0;
   DelphesHepMCReader *reader = 0;
-  Int_t i;
+  DelphesReaderThread *readerThread = 0;
+  DelphesReaderSlot *slot;
+  EventSplitter *splitter = 0;
+  vector< DelphesHepMCReader * > readers;
+  vector< DelphesLineReader * > lineReaders;
+  vector< string > texts;
+  Int_t i, numberOfThreads = 0;
   Long64_t length, eventCounter;
 
+  // --threads N parses the events on N threads, the output is the same
+  if(argc > 2 && strcmp(argv[1], "--threads") == 0)
+  {
+    numberOfThreads = atoi(argv[2]);
+    if(numberOfThreads < 1)
+    {
+      cerr << "** ERROR: the number of threads must be positive" << endl;
+      return 1;
+    }
+    argv += 2;
+    argc -= 2;
+  }
+
   if(argc < 2)
   {
-    cout << " Usage: " << appName << " output_file" << " [input_file(s)]" << endl;
+    cout << " Usage: " << appName << " [--threads N]" << " output_file" << " [input_file(s)]" << endl;
+    cout << " --threads N - parse the events on N threads," << endl;
     cout << " output_file - output binary pile-up file," << endl;
     cout << " input_file(s) - input file(s) in HepMC format," << endl;
     cout << " with no input_file, or when input_file is -, read standard input." << endl;
@@ -94,10 +219,22 @@ int main(int argc, char *argv[])
     stableParticleOutputArray = factory->NewPermanentArray();
     partonOutputArray = factory->NewPermanentArray();
 
-    itParticle = stableParticleOutputArray->MakeIterator();
-
     reader = new DelphesHepMCReader;
 
+    if(numberOfThreads > 0)
+    {
+      // every thread parses its events with a reader of its own
+      readerThread = new DelphesReaderThread(4*numberOfThreads, numberOfThreads);
+      splitter = new EventSplitter(numberOfThreads);
+      texts.resize(numberOfThreads);
+      for(i = 0; i < numberOfThreads; ++i)
+      {
+        readers.push_back(new DelphesHepMCReader);
+        lineReaders.push_back(new DelphesLineReader);
+        readers.back()->SetLineReader(lineReaders.back());
+      }
+    }
+
     i = 2;
     do
     {
@@ -132,37 +269,59 @@ int main(int argc, char *argv[])
         }
       }
 
-      reader->SetInputFile(inputFile);
-
       ExRootProgressBar progressBar(length);
 
       // Loop over all objects
       eventCounter = 0;
-      factory->Clear();
-      reader->Clear();
-      while(reader->ReadBlock(factory, allParticleOutputArray,
-        stableParticleOutputArray, partonOutputArray) && !interrupted)
+      if(readerThread)
       {
-        if(reader->EventReady())
+        splitter->SetInputFile(inputFile);
+        readerThread->Start([&splitter, &readers, &lineReaders, &texts](DelphesReaderSlot &slot) -> Bool_t
         {
-          ++eventCounter;
+          DelphesHepMCReader *slotReader = readers[slot.worker];
+          string &text = texts[slot.worker];
+
+          if(!splitter->NextEvent(slot.worker, text)) return kFALSE;
+          lineReaders[slot.worker]->SetInputText(text.data(), text.size());
 
-          itParticle->Reset();
-          while((candidate = static_cast<Candidate*>(itParticle->Next())))
+          slotReader->Clear();
+          while(slotReader->ReadBlock(slot.factory, slot.allParticleOutputArray,
+            slot.stableParticleOutputArray, slot.partonOutputArray))
           {
-            const TLorentzVector &position = candidate->Position;
-            const TLorentzVector &momentum = candidate->Momentum;
-            writer->WriteParticle(candidate->PID,
-              position.X(), position.Y(), position.Z(), position.T(),
-              momentum.Px(), momentum.Py(), momentum.Pz(), momentum.E());
+            if(slotReader->EventReady()) return kTRUE;
           }
+          return kFALSE;
+        });
 
-          writer->WriteEntry();
+        // the events come back in input order and are written here
+        while(!interrupted && (slot = readerThread->NextSlot()))
+        {
+          ++eventCounter;
+          ProcessEvent(slot->stableParticleOutputArray, writer);
+          readerThread->ReleaseSlot(slot);
+          progressBar.Update(splitter->GetPosition(), eventCounter);
+        }
+        readerThread->Stop();
+      }
+      else
+      {
+        reader->SetInputFile(inputFile);
+        factory->Clear();
+        reader->Clear();
+        while(reader->ReadBlock(factory, allParticleOutputArray,
+          stableParticleOutputArray, partonOutputArray) && !interrupted)
+        {
+          if(reader->EventReady())
+          {
+            ++eventCounter;
 
-          factory->Clear();
-          reader->Clear();
+            ProcessEvent(stableParticleOutputArray, writer);
+
+            factory->Clear();
+            reader->Clear();
+          }
+          progressBar.Update(reader->GetPosition(), eventCounter);
         }
-        progressBar.Update(ftello(inputFile), eventCounter);
       }
 
       fseek(inputFile, 0L, SEEK_END);
@@ -179,6 +338,13 @@ int main(int argc, char *argv[])
 
     cout << "** Exiting..." << endl;
 
+    if(readerThread) delete readerThread;
+    for(i = 0; i < Int_t(readers.size()); ++i)
+    {
+      delete readers[i];
+      delete lineReaders[i];
+    }
+    if(splitter) delete splitter;
     delete reader;
     delete factory;
     delete writer;
@@ -0,0 +1,157 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdexcept>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include <string.h>
+#include <signal.h>
+
+#include "TROOT.h"
+#include "TApplication.h"
+
+
+#include "classes/DelphesPileUpReader.h"
+#include "classes/DelphesPileUpWriter.h"
+#include "classes/DelphesPDGTable.h"
+
+#include "ExRootAnalysis/ExRootProgressBar.h"
+
+using namespace std;
+
+//---------------------------------------------------------------------------
+
+void ProcessEvent(DelphesPileUpReader *reader, DelphesPileUpWriter *writer)
+{
+  Int_t pid, charge;
+  Float_t x, y, z, t;
+  Float_t px, py, pz, e, mass;
+  const DelphesPDGTable *pdg = DelphesPDGTable::Instance();
+  const DelphesPDGTable::Entry *pdgParticle;
+
+  while(reader->ReadParticle(pid, x, y, z, t, px, py, pz, e, charge, mass))
+  {
+    // same values as the ones PileUpMerger takes from DelphesPDGTable
+    if(!reader->HasChargeMass())
+    {
+      pdgParticle = pdg->Find(pid);
+      charge = pdgParticle ? pdgParticle->charge : -999;
+      mass = pdgParticle ? pdgParticle->mass : -999.9;
+    }
+
+    writer->WriteParticle(pid, x, y, z, t, px, py, pz, e, charge, mass);
+  }
+
+  writer->WriteEntry();
+}
+
+//---------------------------------------------------------------------------
+
+static bool interrupted = false;
+
+void SignalHandler(int sig)
+{
+  interrupted = true;
+}
+
+//---------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+  char appName[] = "pileup2pileup";
+  stringstream message;
+  DelphesPileUpReader *reader = 0;
+  DelphesPileUpWriter *writer = 0;
+  Long64_t entry, allEntries;
+  unsigned int flags = kPileUpChargeMass;
+  Int_t i;
+
+  for(i = 1; i < argc && argv[i][0] == '-'; ++i)
+  {
+    if(strcmp(argv[i], "--lz4") == 0) flags |= kPileUpLZ4;
+    else if(strcmp(argv[i], "--no-charge-mass") == 0) flags &= ~kPileUpChargeMass;
+    else break;
+  }
+
+  if(argc - i != 2)
+  {
+    cout << " Usage: " << appName << " [--lz4] [--no-charge-mass]" << " output_file" << " input_file" << endl;
+    cout << " --lz4 - compress the events with LZ4," << endl;
+    cout << " --no-charge-mass - do not store the charge and the mass of the particles," << endl;
+    cout << " output_file - output binary pile-up file of version 2," << endl;
+    cout << " input_file - input binary pile-up file." << endl;
+    return 1;
+  }
+
+  signal(SIGINT, SignalHandler);
+
+  gROOT->SetBatch();
+
+  int appargc = 1;
+  char *appargv[] = {appName};
+  TApplication app(appName, &appargc, appargv);
+
+  try
+  {
+    cout << "** Reading " << argv[i + 1] << endl;
+
+    reader = new DelphesPileUpReader(argv[i + 1]);
+    allEntries = reader->GetEntries();
+
+    cout << "** Input file contains " << allEntries << " events" << endl;
+
+    writer = new DelphesPileUpWriter(argv[i], kPileUpVersionColumns, flags);
+
+    if(allEntries > 0)
+    {
+      ExRootProgressBar progressBar(allEntries - 1);
+      // Loop over all events
+      for(entry = 0; entry < allEntries && !interrupted; ++entry)
+      {
+        if(!reader->ReadEntry(entry))
+        {
+          cerr << "** ERROR: cannot read event " << entry << endl;
+          break;
+        }
+
+        ProcessEvent(reader, writer);
+
+        progressBar.Update(entry);
+      }
+      progressBar.Finish();
+    }
+
+    writer->WriteIndex();
+
+    delete writer;
+    delete reader;
+
+    cout << "** Exiting..." << endl;
+
+    return 0;
+  }
+  catch(runtime_error &e)
+  {
+    if(writer) delete writer;
+    if(reader) delete reader;
+    cerr << "** ERROR: " << e.what() << endl;
+    return 1;
+  }
+}
@@ -0,0 +1,329 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+// Write the HDF5Writer `jets`, `events` and `jet_event_index` datasets
+// from the Jet branch of a Delphes ROOT file, without simulating again.
+//
+// `jets` has the default compound layout of HDF5Writer, with the jets
+// over PTMin and within AbsEtaMax. The tracks and vertices come from the
+// flavour-tagging members of the Jet class. The directions of the
+// secondary vertices relative to the jet are recomputed from the stored
+// vertex positions and jet axes, so they match the simulation to float
+// precision. The secondary tracks shared by several vertices are told
+// apart by their parameters instead of the Delphes track.
+//
+// The branches in use are read through a prefetched TTreeCache, and the
+// datasets are compressed and written on background threads while the
+// next events are converted.
+
+#include <stdexcept>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <limits>
+#include <tuple>
+#include <set>
+#include <algorithm>
+
+#include <stdlib.h>
+#include <signal.h>
+#include <string.h>
+
+#include "TROOT.h"
+#include "TApplication.h"
+#include "TMath.h"
+#include "TVector2.h"
+#include "TVector3.h"
+
+#include "TFile.h"
+#include "TChain.h"
+#include "TClonesArray.h"
+
+#include "classes/DelphesClasses.h"
+#include "modules/HDF5Writer.h"
+
+#include "ExRootAnalysis/ExRootTreeReader.h"
+#include "ExRootAnalysis/ExRootProgressBar.h"
+
+using namespace std;
+
+//---------------------------------------------------------------------------
+
+static out::VertexTrack ConvertTrack(const TSecondaryVertexTrack &track)
+{
+  out::VertexTrack result;
+
+  result.d0 = track.d0;
+  result.z0 = track.z0;
+  result.d0_uncertainty = track.d0err;
+  result.z0_uncertainty = track.z0err;
+  result.pt = track.pt;
+  result.delta_eta_jet = track.deta;
+  result.delta_phi_jet = track.dphi;
+  result.weight = track.weight;
+
+  return result;
+}
+
+//---------------------------------------------------------------------------
+
+static out::SecondaryVertex ConvertVertex(const TSecondaryVertex &vertex, const Jet &jet)
+{
+  TVector3 position(vertex.x, vertex.y, vertex.z);
+  out::SecondaryVertex result;
+
+  result.mass = vertex.mass;
+  result.displacement = position.Mag();
+  result.delta_eta_jet = position.Eta() - jet.Eta;
+  result.delta_phi_jet = TVector2::Phi_mpi_pi(TMath::ATan2(vertex.y, vertex.x) - jet.Phi);
+  result.displacement_significance = vertex.Lsig;
+
+  return result;
+}
+
+//---------------------------------------------------------------------------
+
+static out::VLSuperJet ConvertJet(const Jet &jet)
+{
+  vector<TSecondaryVertex>::const_reverse_iterator itVertices;
+  vector<TSecondaryVertexTrack>::const_iterator itTracks;
+  set< tuple<double, double, double> > used;
+  vector<out::VertexTrack> primaryTracks;
+  vector<out::CombinedSecondaryTrack> secondaryTracks;
+  out::CombinedSecondaryTrack combined;
+  out::VLSuperJet result;
+
+  result.jet_parameters.pt = jet.PT;
+  result.jet_parameters.eta = jet.Eta;
+  result.jet_parameters.flavor = out::simple_flavor(jet.Flavor);
+
+  result.tracking.track_2_d0_significance = jet.track2d0sig;
+  result.tracking.track_3_d0_significance = jet.track3d0sig;
+  result.tracking.track_2_z0_significance = jet.track2z0sig;
+  result.tracking.track_3_z0_significance = jet.track3z0sig;
+  result.tracking.n_tracks_over_d0_threshold = jet.tracksOverIpThreshold;
+  result.tracking.jet_prob = jet.jetProb;
+  result.tracking.jet_width_eta = jet.jetWidthEta;
+  result.tracking.jet_width_phi = jet.jetWidthPhi;
+
+  result.vertex.vertex_significance = jet.HLSecondaryVertex.svLsig;
+  result.vertex.n_secondary_vertices = jet.HLSecondaryVertex.svNVertex;
+  result.vertex.n_secondary_vertex_tracks = jet.HLSecondaryVertex.svNTracks;
+  result.vertex.delta_r_vertex = jet.HLSecondaryVertex.svDrJet;
+  result.vertex.vertex_mass = jet.HLSecondaryVertex.svMass;
+  result.vertex.vertex_energy_fraction = jet.HLSecondaryVertex.svEnergyFraction;
+
+  for(itTracks = jet.PrimaryVertexTracks.begin(); itTracks != jet.PrimaryVertexTracks.end(); ++itTracks)
+  {
+    primaryTracks.push_back(ConvertTrack(*itTracks));
+  }
+  sort(primaryTracks.begin(), primaryTracks.end());
+  result.primary_vertex_tracks = primaryTracks;
+
+  // as in HDF5Writer, the tracks reassigned to a later vertex are only
+  // kept with the last one
+  for(itVertices = jet.SecondaryVertices.rbegin(); itVertices != jet.SecondaryVertices.rend(); ++itVertices)
+  {
+    combined.vertex = ConvertVertex(*itVertices, jet);
+    for(itTracks = itVertices->tracks.begin(); itTracks != itVertices->tracks.end(); ++itTracks)
+    {
+      if(!used.insert(make_tuple(itTracks->d0, itTracks->z0, itTracks->pt)).second) continue;
+      combined.track = ConvertTrack(*itTracks);
+      secondaryTracks.push_back(combined);
+    }
+  }
+  sort(secondaryTracks.begin(), secondaryTracks.end());
+  result.secondary_vertex_tracks = secondaryTracks;
+
+  return result;
+}
+
+//---------------------------------------------------------------------------
+
+static bool interrupted = false;
+
+void SignalHandler(int sig)
+{
+  interrupted = true;
+}
+
+//---------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+  char appName[] = "root2h5";
+  stringstream message;
+  const float nan = numeric_limits<float>::quiet_NaN();
+  string jetName = "Jet", missingETName = "MissingET", rhoName = "", vertexName = "";
+  double ptMin = 20.0, absEtaMax = 2.5;
+  TChain *inputChain = 0;
+  ExRootTreeReader *treeReader = 0;
+  TClonesArray *branchJet = 0, *branchMissingET = 0, *branchRho = 0, *branchVertex = 0;
+  OneDimBuffer<out::VLSuperJet> *jetBuffer = 0;
+  OneDimBuffer<out::Event> *eventBuffer = 0;
+  OneDimBuffer<int> *jetEventIndexBuffer = 0;
+  H5::H5File *outputFile = 0;
+  h5::DatasetOptions options;
+  out::Event event;
+  Jet *jet;
+  MissingET *missingET;
+  Long64_t entry, allEntries;
+  int i = 1, j, jetsWritten = 0;
+
+  while(i < argc && argv[i][0] == '-' && argv[i][1] != '\0')
+  {
+    if(i + 1 >= argc) break;
+    if(strcmp(argv[i], "-j") == 0) jetName = argv[i + 1];
+    else if(strcmp(argv[i], "-m") == 0) missingETName = argv[i + 1];
+    else if(strcmp(argv[i], "-r") == 0) rhoName = argv[i + 1];
+    else if(strcmp(argv[i], "-v") == 0) vertexName = argv[i + 1];
+    else if(strcmp(argv[i], "-p") == 0) ptMin = strtod(argv[i + 1], 0);
+    else if(strcmp(argv[i], "-e") == 0) absEtaMax = strtod(argv[i + 1], 0);
+    else break;
+    i += 2;
+  }
+
+  if(argc - i != 2 || argv[i][0] == '-')
+  {
+    cerr << " Usage: " << appName << " [-j jets] [-m met] [-r rho] [-v vertices] [-p pt_min] [-e abs_eta_max]" << " input_file" << " output_file" << endl;
+    cerr << " -j jets - jet branch (default: Jet)," << endl;
+    cerr << " -m met - missing ET branch, empty to skip it (default: MissingET)," << endl;
+    cerr << " -r rho, -v vertices - Rho and Vertex branches (default: none)," << endl;
+    cerr << " -p pt_min, -e abs_eta_max - jet selection (default: 20 and 2.5)," << endl;
+    cerr << " input_file - input file in ROOT format," << endl;
+    cerr << " output_file - output file in HDF5 format." << endl;
+    return 1;
+  }
+
+  signal(SIGINT, SignalHandler);
+
+  gROOT->SetBatch();
+
+  int appargc = 1;
+  char *appargv[] = {appName};
+  TApplication app(appName, &appargc, appargv);
+
+  try
+  {
+    cerr << "** Reading " << argv[i] << endl;
+    inputChain = new TChain("Delphes");
+    inputChain->Add(argv[i]);
+
+    treeReader = new ExRootTreeReader(inputChain);
+
+    branchJet = treeReader->UseBranch(jetName.c_str());
+    if(!branchJet)
+    {
+      message << "ROOT file doesn't contain the " << jetName << " branch";
+      throw runtime_error(message.str());
+    }
+    if(!missingETName.empty()) branchMissingET = treeReader->UseBranch(missingETName.c_str());
+    if(!rhoName.empty()) branchRho = treeReader->UseBranch(rhoName.c_str());
+    if(!vertexName.empty()) branchVertex = treeReader->UseBranch(vertexName.c_str());
+
+    treeReader->SetCacheSize(100000000, kTRUE);
+
+    // the defaults of HDF5Writer
+    options.compression = "deflate-7";
+
+    outputFile = new H5::H5File(argv[i + 1], H5F_ACC_TRUNC);
+    jetBuffer = new OneDimBuffer<out::VLSuperJet>(*outputFile, "jets", out::type(out::VLSuperJet()), 1000, options);
+    eventBuffer = new OneDimBuffer<out::Event>(*outputFile, "events", out::type(out::Event()), 1000, options);
+    jetEventIndexBuffer = new OneDimBuffer<int>(*outputFile, "jet_event_index", h5::type(int()), 1000, options);
+    jetBuffer->set_async();
+    eventBuffer->set_async();
+    jetEventIndexBuffer->set_async();
+
+    allEntries = treeReader->GetEntries();
+    cerr << "** Input file contains " << allEntries << " events" << endl;
+
+    if(allEntries > 0)
+    {
+      ExRootProgressBar progressBar(allEntries - 1);
+      // Loop over all events
+      for(entry = 0; entry < allEntries && !interrupted; ++entry)
+      {
+        if(!treeReader->ReadEntry(entry))
+        {
+          cerr << "** ERROR: cannot read event " << entry << endl;
+          break;
+        }
+
+        event.event_number = entry;
+        event.first_jet = jetsWritten;
+        event.n_vertices = branchVertex ? branchVertex->GetEntriesFast() : -1;
+        event.rho = (branchRho && branchRho->GetEntriesFast() > 0) ? static_cast<Rho*>(branchRho->At(0))->Rho : nan;
+        missingET = (branchMissingET && branchMissingET->GetEntriesFast() > 0) ? static_cast<MissingET*>(branchMissingET->At(0)) : 0;
+        event.met = missingET ? missingET->MET : nan;
+        event.met_phi = missingET ? missingET->Phi : nan;
+
+        for(j = 0; j < branchJet->GetEntriesFast(); ++j)
+        {
+          jet = static_cast<Jet*>(branchJet->At(j));
+          if(jet->PT < ptMin || TMath::Abs(jet->Eta) > absEtaMax) continue;
+
+          jetEventIndexBuffer->push_back(entry);
+          jetBuffer->push_back(ConvertJet(*jet));
+          ++jetsWritten;
+        }
+
+        event.n_jets = jetsWritten - event.first_jet;
+        eventBuffer->push_back(event);
+
+        progressBar.Update(entry);
+      }
+      progressBar.Finish();
+    }
+
+    jetBuffer->flush();
+    jetBuffer->close();
+    eventBuffer->close();
+    jetEventIndexBuffer->close();
+
+    cerr << "** Exiting..." << endl;
+
+    delete jetBuffer;
+    delete eventBuffer;
+    delete jetEventIndexBuffer;
+    delete outputFile;
+    delete treeReader;
+    delete inputChain;
+    return 0;
+  }
+  catch(runtime_error &e)
+  {
+    message.str("");
+    message << e.what();
+  }
+  catch(H5::Exception &e)
+  {
+    message.str("");
+    message << e.getDetailMsg();
+  }
+
+  if(jetBuffer) delete jetBuffer;
+  if(eventBuffer) delete eventBuffer;
+  if(jetEventIndexBuffer) delete jetEventIndexBuffer;
+  if(outputFile) delete outputFile;
+  if(treeReader) delete treeReader;
+  if(inputChain) delete inputChain;
+  cerr << "** ERROR: " << message.str() << endl;
+  return 1;
+}
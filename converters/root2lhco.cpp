@@ -21,6 +21,12 @@
 #include <fstream>
 #include <sstream>
 #include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cmath>
 
 #include <stdlib.h>
 #include <signal.h>
@@ -28,6 +34,7 @@
 
 #include "TROOT.h"
 #include "TApplication.h"
+#include "RVersion.h"
 
 #include "TFile.h"
 #include "TClonesArray.h"
@@ -39,6 +46,85 @@
 
 using namespace std;
 
+static const Long64_t kBlockEvents = 1000;
+
+// blocks converted ahead by every thread
+static const size_t kBlocksAhead = 4;
+
+//---------------------------------------------------------------------------
+
+static void AppendInteger(string &output, Long64_t value, Int_t width)
+{
+  char buffer[32];
+  char *end, *begin;
+  ULong64_t digits;
+  Int_t i;
+
+  digits = value < 0 ? -ULong64_t(value) : ULong64_t(value);
+
+  end = buffer + sizeof(buffer);
+  begin = end;
+  do
+  {
+    *--begin = '0' + digits % 10;
+    digits /= 10;
+  }
+  while(digits > 0);
+  if(value < 0) *--begin = '-';
+
+  for(i = end - begin; i < width; ++i) output += ' ';
+  output.append(begin, end);
+}
+
+//---------------------------------------------------------------------------
+
+// same as snprintf with "%*.*f" for a precision up to three digits
+static void AppendFixed(string &output, Double_t value, Int_t width, Int_t precision)
+{
+  static const Double_t kScale[4] = {1.0, 1.0E1, 1.0E2, 1.0E3};
+  char buffer[64];
+  char *end, *begin;
+  Double_t scaled, fraction;
+  ULong64_t digits;
+  Int_t i;
+
+  scaled = fabs(value) * kScale[precision];
+  fraction = scaled - floor(scaled);
+
+  // the rounding of the scaled value can only differ from the one of
+  // snprintf close to halfway, those values and the large ones are left
+  // to snprintf, as are infinities and NaNs
+  if(!(scaled < 1.0E9) || fabs(fraction - 0.5) < 1.0E-6)
+  {
+    snprintf(buffer, sizeof(buffer), "%*.*f", width, precision, value);
+    output += buffer;
+    return;
+  }
+
+  digits = ULong64_t(scaled + 0.5);
+
+  end = buffer + sizeof(buffer);
+  begin = end;
+  for(i = 0; i < precision; ++i)
+  {
+    *--begin = '0' + digits % 10;
+    digits /= 10;
+  }
+  if(precision > 0) *--begin = '.';
+  do
+  {
+    *--begin = '0' + digits % 10;
+    digits /= 10;
+  }
+  while(digits > 0);
+  if(signbit(value)) *--begin = '-';
+
+  for(i = end - begin; i < width; ++i) output += ' ';
+  output.append(begin, end);
+}
+
+//---------------------------------------------------------------------------
+
 /*
 LHC Olympics format discription from http://www.jthaler.net/olympicswiki/doku.php?id=lhc_olympics:data_file_format
 
@@ -55,7 +141,7 @@ LHC Olympics format discription from http://www.jthaler.net/olympicswiki/doku.ph
 class LHCOWriter
 {
 public:
-  LHCOWriter(ExRootTreeReader *treeReader, FILE *outputFile);
+  LHCOWriter(ExRootTreeReader *treeReader, string *output);
   ~LHCOWriter();
 
   void ProcessEvent();
@@ -82,7 +168,7 @@ private:
   Long64_t fTriggerWord, fEventNumber;
 
   ExRootTreeReader *fTreeReader;
-  FILE *fOutputFile;
+  string *fOutput;
 
   TClonesArray *fBranchEvent;
 
@@ -106,13 +192,13 @@ private:
 
 //------------------------------------------------------------------------------
 
-LHCOWriter::LHCOWriter(ExRootTreeReader *treeReader, FILE *outputFile) :
-  fTriggerWord(0), fEventNumber(1), fTreeReader(0), fOutputFile(0),
+LHCOWriter::LHCOWriter(ExRootTreeReader *treeReader, string *output) :
+  fTriggerWord(0), fEventNumber(1), fTreeReader(0), fOutput(0),
   fBranchEvent(0), fBranchTrack(0), fBranchTower(0), fBranchPhoton(0),
   fBranchElectron(0), fBranchMuon(0), fBranchJet(0), fBranchMissingET(0)
 {
   fTreeReader = treeReader;
-  fOutputFile = outputFile;
+  fOutput = output;
 
   // information about reconstructed event
   fBranchEvent = fTreeReader->UseBranch("Event");
@@ -188,9 +274,22 @@ void LHCOWriter::Reset()
 
 void LHCOWriter::Write()
 {
-  fprintf(fOutputFile, "%4d %4d %8.3f %8.3f %7.2f %7.2f %6.1f %6.1f %7.2f %6.1f %6.1f\n",
-    fIntParam[0], fIntParam[1], fDblParam[0], fDblParam[1], fDblParam[2],
-    fDblParam[3], fDblParam[4], fDblParam[5], fDblParam[6], fDblParam[7], fDblParam[8]);
+  // same as "%4d %4d %8.3f %8.3f %7.2f %7.2f %6.1f %6.1f %7.2f %6.1f %6.1f\n"
+  static const Int_t kWidth[kDblParamSize] = {8, 8, 7, 7, 6, 6, 7, 6, 6};
+  static const Int_t kPrecision[kDblParamSize] = {3, 3, 2, 2, 1, 1, 2, 1, 1};
+  int i;
+
+  AppendInteger(*fOutput, fIntParam[0], 4);
+  *fOutput += ' ';
+  AppendInteger(*fOutput, fIntParam[1], 4);
+
+  for(i = 0; i < kDblParamSize; ++i)
+  {
+    *fOutput += ' ';
+    AppendFixed(*fOutput, fDblParam[i], kWidth[i], kPrecision[i]);
+  }
+
+  *fOutput += '\n';
 
   ++fIntParam[0];
 }
@@ -203,7 +302,12 @@ void LHCOWriter::AnalyseEvent()
 
   element = static_cast<Event*>(fBranchEvent->At(0));
 
-  fprintf(fOutputFile, "%4d %13lld %8d\n", 0, element->Number, 0);
+  AppendInteger(*fOutput, 0, 4);
+  *fOutput += ' ';
+  AppendInteger(*fOutput, element->Number, 13);
+  *fOutput += ' ';
+  AppendInteger(*fOutput, 0, 8);
+  *fOutput += '\n';
 
   ++fIntParam[0];
 }
@@ -424,6 +528,173 @@ void LHCOWriter::AnalyseMissingET()
 
 //---------------------------------------------------------------------------
 
+// converts the blocks of kBlockEvents events on several threads, every
+// thread with its own chain, the blocks are handed out in entry order
+
+class LHCOThreads
+{
+public:
+  LHCOThreads(const char *inputName, Long64_t allEntries, Int_t nThreads);
+  ~LHCOThreads();
+
+  // output of the next block and the entry after it, false after the last block
+  bool Next(string &output, Long64_t &entry);
+
+private:
+
+  struct Worker
+  {
+    thread runner;
+    deque< string > blocks;
+    string error;
+    bool finished;
+  };
+
+  void Work(Int_t index);
+
+  string fInputName;
+  Long64_t fAllEntries, fNextBlock;
+
+  vector< Worker > fWorkers;
+
+  mutex fMutex;
+  condition_variable fCondition;
+  bool fStop;
+  string fError;
+};
+
+//---------------------------------------------------------------------------
+
+LHCOThreads::LHCOThreads(const char *inputName, Long64_t allEntries, Int_t nThreads) :
+  fInputName(inputName), fAllEntries(allEntries), fNextBlock(0), fWorkers(nThreads), fStop(false)
+{
+  Int_t i;
+
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,6,0)
+  ROOT::EnableThreadSafety();
+#endif
+
+  for(i = 0; i < nThreads; ++i)
+  {
+    fWorkers[i].finished = false;
+  }
+
+  for(i = 0; i < nThreads; ++i)
+  {
+    fWorkers[i].runner = thread(&LHCOThreads::Work, this, i);
+  }
+}
+
+//---------------------------------------------------------------------------
+
+LHCOThreads::~LHCOThreads()
+{
+  vector< Worker >::iterator itWorkers;
+
+  {
+    lock_guard< mutex > lock(fMutex);
+    fStop = true;
+  }
+  fCondition.notify_all();
+
+  for(itWorkers = fWorkers.begin(); itWorkers != fWorkers.end(); ++itWorkers)
+  {
+    if(itWorkers->runner.joinable()) itWorkers->runner.join();
+  }
+}
+
+//---------------------------------------------------------------------------
+
+bool LHCOThreads::Next(string &output, Long64_t &entry)
+{
+  unique_lock< mutex > lock(fMutex);
+  Worker &worker = fWorkers[fNextBlock % fWorkers.size()];
+
+  if(!fError.empty()) throw runtime_error(fError);
+  if(fNextBlock * kBlockEvents >= fAllEntries) return false;
+
+  fCondition.wait(lock, [&worker] { return !worker.blocks.empty() || worker.finished; });
+
+  if(worker.blocks.empty())
+  {
+    if(!worker.error.empty()) throw runtime_error(worker.error);
+    return false;
+  }
+
+  output.swap(worker.blocks.front());
+  worker.blocks.pop_front();
+  ++fNextBlock;
+
+  // the block read up to the failed event is the last one
+  if(worker.blocks.empty() && !worker.error.empty()) fError = worker.error;
+
+  fCondition.notify_all();
+
+  entry = TMath::Min(fNextBlock * kBlockEvents, fAllEntries);
+  return true;
+}
+
+//---------------------------------------------------------------------------
+
+void LHCOThreads::Work(Int_t index)
+{
+  Worker &worker = fWorkers[index];
+  stringstream message;
+  string output;
+  Long64_t block, entry, last;
+  bool failed = false;
+
+  try
+  {
+    TChain chain("Delphes");
+    chain.Add(fInputName.c_str());
+
+    ExRootTreeReader treeReader(&chain);
+    LHCOWriter writer(&treeReader, &output);
+
+    for(block = index; block * kBlockEvents < fAllEntries && !failed; block += fWorkers.size())
+    {
+      {
+        unique_lock< mutex > lock(fMutex);
+        fCondition.wait(lock, [this, &worker] { return fStop || worker.blocks.size() < kBlocksAhead; });
+        if(fStop) break;
+      }
+
+      output.clear();
+      last = TMath::Min((block + 1) * kBlockEvents, fAllEntries);
+      for(entry = block * kBlockEvents; entry < last; ++entry)
+      {
+        if(!treeReader.ReadEntry(entry))
+        {
+          // the events before are still written
+          message << "cannot read event " << entry;
+          failed = true;
+          break;
+        }
+
+        writer.ProcessEvent();
+      }
+
+      lock_guard< mutex > lock(fMutex);
+      worker.blocks.push_back(string());
+      worker.blocks.back().swap(output);
+      if(failed) worker.error = message.str();
+      fCondition.notify_all();
+    }
+  }
+  catch(runtime_error &e)
+  {
+    lock_guard< mutex > lock(fMutex);
+    worker.error = e.what();
+  }
+
+  lock_guard< mutex > lock(fMutex);
+  worker.finished = true;
+  fCondition.notify_all();
+}
+
+//---------------------------------------------------------------------------
+
 static bool interrupted = false;
 
 void SignalHandler(int sig)
@@ -437,15 +708,25 @@ int main(int argc, char *argv[])
 {
   char appName[] = "root2lhco";
   stringstream message;
+  string output;
   FILE *outputFile = 0;
   TChain *inputChain = 0;
   LHCOWriter *writer = 0;
+  LHCOThreads *threads = 0;
   ExRootTreeReader *treeReader = 0;
   Long64_t entry, allEntries;
+  Int_t i = 1, nThreads = 1;
 
-  if(argc < 2 || argc > 3)
+  while(i + 1 < argc && strcmp(argv[i], "-t") == 0)
   {
-    cerr << " Usage: " << appName << " input_file" << " [output_file]" << endl;
+    nThreads = atoi(argv[i + 1]);
+    i += 2;
+  }
+
+  if(argc - i < 1 || argc - i > 2 || nThreads < 1)
+  {
+    cerr << " Usage: " << appName << " [-t threads] input_file" << " [output_file]" << endl;
+    cerr << " threads - number of threads converting the events, 1 by default," << endl;
     cerr << " input_file - input file in ROOT format," << endl;
     cerr << " output_file - output file in LHCO format," << endl;
     cerr << " with no output_file, or when output_file is -, write to standard output." << endl;
@@ -462,23 +743,23 @@ int main(int argc, char *argv[])
 
   try
   {
-    cerr << "** Reading " << argv[1] << endl;
+    cerr << "** Reading " << argv[i] << endl;
     inputChain = new TChain("Delphes");
-    inputChain->Add(argv[1]);
+    inputChain->Add(argv[i]);
 
-    ExRootTreeReader *treeReader = new ExRootTreeReader(inputChain);
+    treeReader = new ExRootTreeReader(inputChain);
 
-    if(argc == 2 || strcmp(argv[2], "-") == 0)
+    if(argc - i == 1 || strcmp(argv[i + 1], "-") == 0)
     {
       outputFile = stdout;
     }
     else
     {
-      outputFile = fopen(argv[2], "w");
+      outputFile = fopen(argv[i + 1], "w");
 
       if(outputFile == NULL)
       {
-        message << "can't open " << argv[2];
+        message << "can't open " << argv[i + 1];
         throw runtime_error(message.str());
       }
     }
@@ -488,10 +769,10 @@ int main(int argc, char *argv[])
     allEntries = treeReader->GetEntries();
     cerr << "** Input file contains " << allEntries << " events" << endl;
 
-    if(allEntries > 0)
+    if(allEntries > 0 && nThreads == 1)
     {
       // Create LHC Olympics converter:
-      writer = new LHCOWriter(treeReader, outputFile);
+      writer = new LHCOWriter(treeReader, &output);
 
       ExRootProgressBar progressBar(allEntries - 1);
       // Loop over all events
@@ -505,12 +786,35 @@ int main(int argc, char *argv[])
 
         writer->ProcessEvent();
 
+        if((entry + 1) % kBlockEvents == 0)
+        {
+          fwrite(output.data(), 1, output.size(), outputFile);
+          output.clear();
+        }
+
         progressBar.Update(entry);
       }
       progressBar.Finish();
 
+      fwrite(output.data(), 1, output.size(), outputFile);
+
       delete writer;
     }
+    else if(allEntries > 0)
+    {
+      threads = new LHCOThreads(argv[i], allEntries, nThreads);
+
+      ExRootProgressBar progressBar(allEntries - 1);
+      // Write the blocks in the order of the events
+      while(!interrupted && threads->Next(output, entry))
+      {
+        fwrite(output.data(), 1, output.size(), outputFile);
+        progressBar.Update(entry - 1);
+      }
+      progressBar.Finish();
+
+      delete threads;
+    }
 
     cerr << "** Exiting..." << endl;
 
@@ -521,12 +825,12 @@ int main(int argc, char *argv[])
   }
   catch(runtime_error &e)
   {
+    if(outputFile && outputFile != stdout) fclose(outputFile);
     if(writer) delete writer;
+    if(threads) delete threads;
     if(treeReader) delete treeReader;
     if(inputChain) delete inputChain;
     cerr << "** ERROR: " << e.what() << endl;
     return 1;
   }
 }
-
-
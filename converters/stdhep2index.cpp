@@ -0,0 +1,152 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdexcept>
+#include <iostream>
+#include <sstream>
+
+#include <signal.h>
+
+#include "TROOT.h"
+#include "TApplication.h"
+
+#include "TObjArray.h"
+
+#include "classes/DelphesClasses.h"
+#include "classes/DelphesFactory.h"
+#include "classes/DelphesEventIndex.h"
+#include "classes/DelphesSTDHEPReader.h"
+
+#include "ExRootAnalysis/ExRootProgressBar.h"
+
+using namespace std;
+
+//---------------------------------------------------------------------------
+
+static bool interrupted = false;
+
+void SignalHandler(int sig)
+{
+  interrupted = true;
+}
+
+//---------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+  char appName[] = "stdhep2index";
+  stringstream message;
+  FILE *inputFile = 0;
+  DelphesFactory *factory = 0;
+  TObjArray *stableParticleOutputArray = 0, *allParticleOutputArray = 0, *partonOutputArray = 0;
+  DelphesSTDHEPReader *reader = 0;
+  DelphesEventIndex index;
+  Int_t i;
+  Long64_t length, eventCounter, start;
+
+  if(argc < 2)
+  {
+    cout << " Usage: " << appName << " input_file(s)" << endl;
+    cout << " input_file(s) - uncompressed input file(s) in STDHEP format," << endl;
+    cout << " the index of every file is written next to it, with .index appended to its name." << endl;
+    return 1;
+  }
+
+  signal(SIGINT, SignalHandler);
+
+  gROOT->SetBatch();
+
+  int appargc = 1;
+  char *appargv[] = {appName};
+  TApplication app(appName, &appargc, appargv);
+
+  try
+  {
+    factory = new DelphesFactory("ObjectFactory");
+    allParticleOutputArray = factory->NewPermanentArray();
+    stableParticleOutputArray = factory->NewPermanentArray();
+    partonOutputArray = factory->NewPermanentArray();
+
+    reader = new DelphesSTDHEPReader;
+
+    for(i = 1; i < argc && !interrupted; ++i)
+    {
+      cout << "** Reading " << argv[i] << endl;
+      inputFile = fopen(argv[i], "r");
+
+      if(inputFile == NULL)
+      {
+        message << "can't open " << argv[i];
+        throw runtime_error(message.str());
+      }
+
+      fseek(inputFile, 0L, SEEK_END);
+      length = ftello(inputFile);
+      fseek(inputFile, 0L, SEEK_SET);
+
+      reader->SetInputFile(inputFile);
+
+      ExRootProgressBar progressBar(length);
+
+      // an event starts where the previous one ends
+      index.Clear();
+      start = 0;
+
+      // Loop over all objects
+      eventCounter = 0;
+      factory->Clear();
+      reader->Clear();
+      while(reader->ReadBlock(factory, allParticleOutputArray,
+        stableParticleOutputArray, partonOutputArray) && !interrupted)
+      {
+        if(reader->EventReady())
+        {
+          ++eventCounter;
+
+          index.AddEvent(start);
+          start = reader->GetPosition();
+
+          factory->Clear();
+          reader->Clear();
+        }
+        progressBar.Update(reader->GetPosition(), eventCounter);
+      }
+
+      progressBar.Update(length, eventCounter, kTRUE);
+      progressBar.Finish();
+
+      fclose(inputFile);
+
+      if(interrupted) break;
+
+      index.Write(DelphesEventIndex::GetIndexFileName(argv[i]).c_str(), length);
+    }
+
+    cout << "** Exiting..." << endl;
+
+    delete reader;
+    delete factory;
+
+    return 0;
+  }
+  catch(runtime_error &e)
+  {
+    cerr << "** ERROR: " << e.what() << endl;
+    return 1;
+  }
+}
@@ -0,0 +1,60 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdexcept>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "ExRootAnalysis/ExRootConfReader.h"
+
+using namespace std;
+
+//---------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+  char appName[] = "tcl2conf";
+  ExRootConfReader *confReader = 0;
+
+  if(argc != 3)
+  {
+    cout << " Usage: " << appName << " config_file" << " output_file" << endl;
+    cout << " config_file - configuration file in Tcl format," << endl;
+    cout << " output_file - compiled configuration file, read by all the Delphes executables." << endl;
+    return 1;
+  }
+
+  try
+  {
+    confReader = new ExRootConfReader;
+    confReader->ReadFile(argv[1]);
+    confReader->WriteCompiledFile(argv[2]);
+
+    cout << "** Exiting..." << endl;
+
+    delete confReader;
+    return 0;
+  }
+  catch(runtime_error &e)
+  {
+    if(confReader) delete confReader;
+    cerr << "** ERROR: " << e.what() << endl;
+    return 1;
+  }
+}
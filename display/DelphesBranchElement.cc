@@ -39,6 +39,7 @@ template<> void DelphesBranchElement<DelphesCaloData>::ReadBranch() {
     TIter itTower(branch_);
     Tower *tower;
     while((tower = (Tower *) itTower.Next())) {
+      if(tower->ET < minPt_) continue;
       data_->AddTower(tower->Edges[0], tower->Edges[1], tower->Edges[2], tower->Edges[3]);
       data_->FillSlice(0, tower->Eem);
       data_->FillSlice(1, tower->Ehad);
@@ -47,17 +48,7 @@ template<> void DelphesBranchElement<DelphesCaloData>::ReadBranch() {
   }
 }
 template<> std::vector<TLorentzVector> DelphesBranchElement<DelphesCaloData>::GetVectors() {
-  std::vector<TLorentzVector> output;
-  if(TString(GetType())=="Tower") {
-    TIter itTower(branch_);
-    Tower *tower;
-    while((tower = (Tower *) itTower.Next())) {
-      TLorentzVector v;
-      v.SetPtEtaPhiM(tower->Eem+tower->Ehad,(tower->Edges[0]+tower->Edges[1])/2.,(tower->Edges[2]+tower->Edges[3])/2.,0.);
-      output.push_back(v);
-    }
-  }
-  return output;
+  return DelphesBranchVectors(branch_);
 }
 
 // special case for element lists
@@ -104,27 +95,7 @@ template<> void DelphesBranchElement<TEveElementList>::ReadBranch() {
   }
 }
 template<> std::vector<TLorentzVector> DelphesBranchElement<TEveElementList>::GetVectors() {
-  std::vector<TLorentzVector> output;
-  if(TString(GetType())=="Jet") {
-    TIter itJet(branch_);
-    Jet *jet;
-    // Loop over all jets
-    while((jet = (Jet *) itJet.Next())) {
-      TLorentzVector v;
-      v.SetPtEtaPhiM(jet->PT, jet->Eta, jet->Phi, jet->Mass);
-      output.push_back(v);
-    }
-  } else if(TString(GetType())=="MissingET") {
-    TIter itMet(branch_);
-    MissingET *MET;
-    // Missing Et
-    while((MET = (MissingET*) itMet.Next())) {
-      TLorentzVector v;
-      v.SetPtEtaPhiM(MET->MET,MET->Eta,MET->Phi,0.);
-      output.push_back(v);
-    }
-  }
-  return output;
+  return DelphesBranchVectors(branch_);
 }
 
 // special case for track lists
@@ -158,6 +129,7 @@ template<> void DelphesBranchElement<TEveTrackList>::ReadBranch() {
   if(type=="Track") { // CASE 1: TRACKS
     Track *track;
     while((track = (Track *) itTrack.Next())) {
+      if(track->PT < minPt_) continue;
       TParticle pb(track->PID, 1, 0, 0, 0, 0,
                    track->P4().Px(), track->P4().Py(),
                    track->P4().Pz(), track->P4().E(),
@@ -173,11 +145,13 @@ template<> void DelphesBranchElement<TEveTrackList>::ReadBranch() {
   } else if(type=="Electron") { // CASE 2: ELECTRONS
     Electron *electron;
     while((electron = (Electron *) itTrack.Next())) {
+      // the particle is only there when its branch has been read
       particle = (GenParticle*) electron->Particle.GetObject();
       TParticle pb(electron->Charge<0?11:-11, 1, 0, 0, 0, 0,
                    electron->P4().Px(), electron->P4().Py(),
                    electron->P4().Pz(), electron->P4().E(),
-                   particle->X/10.0, particle->Y/10.0, particle->Z/10.0, particle->T/10.0);
+                   particle ? particle->X/10.0 : 0.0, particle ? particle->Y/10.0 : 0.0,
+                   particle ? particle->Z/10.0 : 0.0, particle ? particle->T/10.0 : 0.0);
       eveTrack = new TEveTrack(&pb, counter, trkProp);
       eveTrack->SetName(Form("%s [%d]", pb.GetName(), counter++));
       eveTrack->SetStdTitle();
@@ -193,7 +167,8 @@ template<> void DelphesBranchElement<TEveTrackList>::ReadBranch() {
       TParticle pb(muon->Charge<0?13:-13, 1, 0, 0, 0, 0,
                    muon->P4().Px(), muon->P4().Py(),
                    muon->P4().Pz(), muon->P4().E(),
-                   particle->X/10.0, particle->Y/10.0, particle->Z/10.0, particle->T/10.0);
+                   particle ? particle->X/10.0 : 0.0, particle ? particle->Y/10.0 : 0.0,
+                   particle ? particle->Z/10.0 : 0.0, particle ? particle->T/10.0 : 0.0);
       eveTrack = new TEveTrack(&pb, counter, trkProp);
       eveTrack->SetName(Form("%s [%d]", pb.GetName(), counter++));
       eveTrack->SetStdTitle();
@@ -222,6 +197,7 @@ template<> void DelphesBranchElement<TEveTrackList>::ReadBranch() {
     GenParticle *particle;
     while((particle = (GenParticle *) itTrack.Next())) {
       if(particle->Status != 1) continue;
+      if(particle->PT < minPt_) continue;
       TParticle pb(particle->PID, particle->Status, particle->M1, particle->M2, particle->D1, particle->D2,
                    particle->P4().Px(), particle->P4().Py(),
                    particle->P4().Pz(), particle->P4().E(),
@@ -238,34 +214,60 @@ template<> void DelphesBranchElement<TEveTrackList>::ReadBranch() {
   }
 }
 template<> std::vector<TLorentzVector> DelphesBranchElement<TEveTrackList>::GetVectors() {
+  return DelphesBranchVectors(branch_);
+}
+
+std::vector<TLorentzVector> DelphesBranchVectors(TClonesArray* branch) {
   std::vector<TLorentzVector> output;
-  TString type = GetType();
-  TIter itTrack(branch_);
-  if(type=="Track") { // CASE 1: TRACKS
+  if(!branch) return output;
+  TString type = branch->GetClass()->GetName();
+  TIter itObject(branch);
+  if(type=="Tower") {
+    Tower *tower;
+    while((tower = (Tower *) itObject.Next())) {
+      TLorentzVector v;
+      v.SetPtEtaPhiM(tower->Eem+tower->Ehad,(tower->Edges[0]+tower->Edges[1])/2.,(tower->Edges[2]+tower->Edges[3])/2.,0.);
+      output.push_back(v);
+    }
+  } else if(type=="Jet") {
+    Jet *jet;
+    while((jet = (Jet *) itObject.Next())) {
+      TLorentzVector v;
+      v.SetPtEtaPhiM(jet->PT, jet->Eta, jet->Phi, jet->Mass);
+      output.push_back(v);
+    }
+  } else if(type=="MissingET") {
+    MissingET *MET;
+    while((MET = (MissingET*) itObject.Next())) {
+      TLorentzVector v;
+      v.SetPtEtaPhiM(MET->MET,MET->Eta,MET->Phi,0.);
+      output.push_back(v);
+    }
+  } else if(type=="Track") {
     Track *track;
-    while((track = (Track *) itTrack.Next())) {
+    while((track = (Track *) itObject.Next())) {
       output.push_back(track->P4());
     }
-  } else if(type=="Electron") { // CASE 2: ELECTRONS
+  } else if(type=="Electron") {
     Electron *electron;
-    while((electron = (Electron *) itTrack.Next())) {
+    while((electron = (Electron *) itObject.Next())) {
       output.push_back(electron->P4());
     }
-  } else if(type=="Muon") { // CASE 3: MUONS
+  } else if(type=="Muon") {
     Muon *muon;
-    while((muon = (Muon *) itTrack.Next())) {
+    while((muon = (Muon *) itObject.Next())) {
       output.push_back(muon->P4());
     }
-  } else if(type=="Photon") { // CASE 4: PHOTONS
+  } else if(type=="Photon") {
     Photon *photon;
-    while((photon = (Photon *) itTrack.Next())) {
+    while((photon = (Photon *) itObject.Next())) {
       output.push_back(photon->P4());
     }
-  } else if(type=="GenParticle") { // CASE 5: GENPARTICLES
+  } else if(type=="GenParticle") {
     GenParticle *particle;
-    while((particle = (GenParticle *) itTrack.Next())) {
+    while((particle = (GenParticle *) itObject.Next())) {
       if(particle->Status != 1) continue;
-        output.push_back(particle->P4());
+      output.push_back(particle->P4());
     }
   }
   return output;
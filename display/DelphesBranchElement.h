@@ -29,24 +29,34 @@
 #include "TEveElement.h"
 #include "TEveTrack.h"
 
+// four-vectors of the objects of a branch, as shown in the summary plots;
+// it needs no Eve container and can run on any thread
+std::vector<TLorentzVector> DelphesBranchVectors(TClonesArray* branch);
+
 // virtual class to represent objects from a Delphes-tree branch
 class DelphesBranchBase
 {
   public:
-    DelphesBranchBase(const char* name="", TClonesArray* branch=NULL, const enum EColor color=kBlack, Float_t maxPt=50.):name_(name),branch_(branch),color_(color) {}
+    DelphesBranchBase(const char* name="", TClonesArray* branch=NULL, const enum EColor color=kBlack, Float_t maxPt=50.):name_(name),maxPt_(maxPt),minPt_(0.),branch_(branch),color_(color) {}
     virtual ~DelphesBranchBase() {}
     const char* GetName() const { return (const char*)name_; }
     const char* GetType() const { return branch_ ? branch_->GetClass()->GetName() : "None"; }
+    TClonesArray* GetArray() const { return branch_; }
     virtual const char* GetClassName() = 0;
     enum EColor GetColor() const { return color_; }
     virtual void Reset() = 0;
     virtual void SetTrackingVolume(Float_t r, Float_t l, Float_t Bz=0.) { tkRadius_ = r; tkHalfLength_ = l; tk_Bz_ = Bz; }
     virtual void ReadBranch() = 0;
     virtual std::vector<TLorentzVector> GetVectors() = 0;
+    // true when the collection is drawn, hidden ones need not be read
+    virtual Bool_t IsVisible() = 0;
+    // level of detail: tracks and towers below minPt are not drawn
+    void SetMinPt(Float_t minPt) { minPt_ = minPt; }
 
   protected:
     TString name_;
     Float_t maxPt_;
+    Float_t minPt_;
     TClonesArray* branch_;
     const enum EColor color_;
     Float_t tkRadius_,tkHalfLength_, tk_Bz_;
@@ -82,6 +92,9 @@ template<typename EveContainer> class DelphesBranchElement: public DelphesBranch
     // return the vector for all elements
     virtual std::vector<TLorentzVector> GetVectors() { std::vector<TLorentzVector> v; return v; }
 
+    // drawn if the container or its elements are
+    virtual Bool_t IsVisible() { return data_->GetRnrSelf() || data_->GetRnrChildren(); }
+
   private:
     EveContainer* data_;
 };
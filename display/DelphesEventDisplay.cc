@@ -50,6 +50,7 @@
 #include "TChain.h"
 #include "TGHtml.h"
 #include "TGStatusBar.h"
+#include "TGLabel.h"
 
 #include "display/DelphesCaloData.h"
 #include "display/DelphesBranchElement.h"
@@ -77,6 +78,9 @@ DelphesEventDisplay::DelphesEventDisplay()
    delphesDisplay_ = 0;
    etaAxis_ = 0;
    phiAxis_ = 0;
+   minPtEntry_ = 0;
+   readHidden_ = kFALSE;
+   summaryThreads_ = 0;
 }
 
 DelphesEventDisplay::~DelphesEventDisplay()
@@ -94,7 +98,7 @@ void DelphesEventDisplay::EventChanged(Int_t e)
 }
 
 
-DelphesEventDisplay::DelphesEventDisplay(const char *configFile, const char *inputFile, Delphes3DGeometry& det3D)
+DelphesEventDisplay::DelphesEventDisplay(const char *configFile, const char *inputFile, Delphes3DGeometry& det3D, Int_t summaryThreads)
 {
    event_id_ = 0;
    tkRadius_ = 1.29;
@@ -104,6 +108,10 @@ DelphesEventDisplay::DelphesEventDisplay(const char *configFile, const char *inp
    chain_ = new TChain("Delphes");
    treeReader_ = 0;
    delphesDisplay_ = 0;
+   minPtEntry_ = 0;
+   readHidden_ = kFALSE;
+   inputFile_ = inputFile;
+   summaryThreads_ = summaryThreads;
 
    // initialize the application
    TEveManager::Create(kTRUE, "IV");
@@ -141,6 +149,10 @@ DelphesEventDisplay::DelphesEventDisplay(const char *configFile, const char *inp
 
    // prepare data collections
    readConfig(configFile, elements_);
+
+   // the baskets of the next events are read in the background while one
+   // is displayed, so that stepping through a pile-up file stays fast
+   treeReader_->SetCacheSize(30000000, kTRUE);
    for(std::vector<DelphesBranchBase *>::iterator element = elements_.begin(); element<elements_.end(); ++element) {
      DelphesBranchElement<TEveTrackList> *item_v1 = dynamic_cast<DelphesBranchElement<TEveTrackList>*>(*element);
      DelphesBranchElement<TEveElementList> *item_v2 = dynamic_cast<DelphesBranchElement<TEveElementList>*>(*element);
@@ -178,6 +190,9 @@ DelphesEventDisplay::DelphesEventDisplay(const char *configFile, const char *inp
    // the GUI: control panel, summary tab
    make_gui();
 
+   // the summary plots, load_event draws them with the first event
+   if(summaryThreads_ > 0) plotSummary_->FillSampleParallel(inputFile_, summaryThreads_);
+
    //ready...
    fStatusBar_->SetText("Ready.", 1);
    gSystem->ProcessEvents();
@@ -276,10 +291,15 @@ void DelphesEventDisplay::load_event()
      (*data)->Reset();
    }
 
-   // Load selected branches with data from specified event
-   treeReader_->ReadEntry(event_id_);
+   // Load the branches of the visible collections, the hidden ones are
+   // left empty until they are shown and the event is reloaded
    for(std::vector<DelphesBranchBase*>::iterator data=elements_.begin();data<elements_.end();++data) {
-     (*data)->ReadBranch();
+     if(readHidden_ || (*data)->IsVisible()) {
+       treeReader_->ReadBranch((*data)->GetName(), event_id_);
+       (*data)->ReadBranch();
+     } else {
+       (*data)->GetArray()->Clear();
+     }
    }
 
    // update display
@@ -419,6 +439,28 @@ void DelphesEventDisplay::make_gui()
         b->Connect("Clicked()", "DelphesEventDisplay", this, "InitSummaryPlots()");
    }
    frmMain->AddFrame(vf, new TGLayoutHints(kLHintsExpandX , 5, 5, 5, 5));
+   vf = new TGGroupFrame(frmMain,"Level of detail",kVerticalFrame | kFitWidth );
+   {
+     TGHorizontalFrame *hf = new TGHorizontalFrame(vf);
+     {
+        hf->AddFrame(new TGLabel(hf, "Min track/tower pT [GeV]"), new TGLayoutHints(kLHintsLeft | kLHintsCenterY, 10, 2, 5, 5));
+        minPtEntry_ = new TGNumberEntry(hf, 0., 6, -1, TGNumberFormat::kNESRealOne, TGNumberFormat::kNEANonNegative);
+        hf->AddFrame(minPtEntry_, new TGLayoutHints(kLHintsRight | kLHintsCenterY, 2, 10, 5, 5));
+        minPtEntry_->Connect("ValueSet(Long_t)", "DelphesEventDisplay", this, "ApplyMinPt()");
+        minPtEntry_->GetNumberEntry()->Connect("ReturnPressed()", "DelphesEventDisplay", this, "ApplyMinPt()");
+     }
+     vf->AddFrame(hf, new TGLayoutHints(kLHintsExpandX , 2, 2, 2, 2));
+
+     TGCheckButton *c = new TGCheckButton(vf, "Read hidden collections");
+     c->SetState(readHidden_ ? kButtonDown : kButtonUp);
+     vf->AddFrame(c, new TGLayoutHints(kLHintsLeft, 10, 10, 5, 5));
+     c->Connect("Toggled(Bool_t)", "DelphesEventDisplay", this, "ReadHidden(Bool_t)");
+
+     TGTextButton *b = new TGTextButton(vf, "Reload event");
+     vf->AddFrame(b, new TGLayoutHints(kLHintsCenterX | kLHintsCenterY | kLHintsExpandX, 10, 10, 5, 5));
+     b->Connect("Clicked()", "DelphesEventDisplay", this, "Reload()");
+   }
+   frmMain->AddFrame(vf, new TGLayoutHints(kLHintsExpandX , 5, 5, 5, 5));
 
    frmMain->MapSubwindows();
    frmMain->Resize();
@@ -474,11 +516,32 @@ void DelphesEventDisplay::GoTo() {
 }
 
 void DelphesEventDisplay::InitSummaryPlots() {
-  plotSummary_->FillSample(treeReader_, event_id_);
+  if(summaryThreads_ > 0) {
+    plotSummary_->FillSampleParallel(inputFile_, summaryThreads_);
+  } else {
+    plotSummary_->FillSample(treeReader_, event_id_);
+  }
   plotSummary_->FillEvent();
   plotSummary_->Draw();
 }
 
+void DelphesEventDisplay::Reload() {
+  load_event();
+}
+
+void DelphesEventDisplay::ApplyMinPt() {
+  Float_t minPt = minPtEntry_->GetNumber();
+  for(std::vector<DelphesBranchBase*>::iterator data=elements_.begin();data<elements_.end();++data) {
+    (*data)->SetMinPt(minPt);
+  }
+  load_event();
+}
+
+void DelphesEventDisplay::ReadHidden(Bool_t on) {
+  readHidden_ = on;
+  load_event();
+}
+
 void DelphesEventDisplay::DisplayProgress(Int_t p) { 
   fStatusBar_->SetText(Form("Processing... %d %%",p), 1);
   gSystem->ProcessEvents();
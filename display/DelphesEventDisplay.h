@@ -22,12 +22,14 @@
 #include <vector>
 
 #include "Rtypes.h"
+#include "TString.h"
 #include "RQ_OBJECT.h"
 
 class TAxis;
 class TChain;
 class TGHtml;
 class TGStatusBar;
+class TGNumberEntry;
 class DelphesDisplay;
 class Delphes3DGeometry;
 class DelphesBranchBase;
@@ -47,7 +49,9 @@ class DelphesEventDisplay
     RQ_OBJECT("DelphesEventDisplay")
   public:
     DelphesEventDisplay();
-    DelphesEventDisplay(const char *configFile, const char *inputFile, Delphes3DGeometry& det3D);
+    // with summaryThreads > 0 the summary plots are filled on that many
+    // threads while the display opens, and cached beside the input file
+    DelphesEventDisplay(const char *configFile, const char *inputFile, Delphes3DGeometry& det3D, Int_t summaryThreads = 0);
     ~DelphesEventDisplay();
     void EventChanged(Int_t); // *SIGNAL*
 
@@ -64,12 +68,16 @@ class DelphesEventDisplay
     Double_t tkRadius_, totRadius_, tkHalfLength_, muHalfLength_, bz_;
     TAxis *etaAxis_, *phiAxis_;
     TChain *chain_;
+    TString inputFile_;
+    Int_t summaryThreads_;
     std::vector<DelphesBranchBase *> elements_;
     DelphesDisplay *delphesDisplay_;
     DelphesHtmlSummary *htmlSummary_;
     TGHtml *gHtml_;
     DelphesPlotSummary *plotSummary_;
     TGStatusBar *fStatusBar_;
+    TGNumberEntry *minPtEntry_;
+    Bool_t readHidden_;
     
     // gui controls
   public:
@@ -83,6 +91,13 @@ class DelphesEventDisplay
 
     void InitSummaryPlots();
 
+    // reads the current event again, e.g. after showing a hidden collection
+    void Reload();
+
+    void ApplyMinPt();
+
+    void ReadHidden(Bool_t on);
+
     void DisplayProgress(Int_t p);
 };
 
@@ -18,10 +18,58 @@
 
 #include "display/DelphesPlotSummary.h"
 #include "TRootEmbeddedCanvas.h"
+#include "TChain.h"
+#include "TFile.h"
+#include "TList.h"
+#include "TROOT.h"
+#include "TSystem.h"
 #include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <thread>
 
 bool vecsorter (TLorentzVector i,TLorentzVector j) { return (i.Pt()>j.Pt()); }
 
+static void FillHistograms(std::vector<TLorentzVector>& vectors, std::vector<TH1F*>& histograms) {
+  std::sort(vectors.begin(), vectors.end(), vecsorter); 
+  for(std::vector<TLorentzVector>::iterator it=vectors.begin(); it<vectors.end();++it) {
+    histograms[0]->Fill(it->Pt());
+    histograms[1]->Fill(it->Eta());
+    histograms[2]->Fill(it->Phi());
+    if(it==vectors.begin()) {
+      histograms[3]->Fill(it->Pt());
+      histograms[4]->Fill(it->Eta());
+      histograms[5]->Fill(it->Phi());
+    }
+    if(it==vectors.begin()+1) {
+      histograms[6]->Fill(it->Pt());
+      histograms[7]->Fill(it->Eta());
+      histograms[8]->Fill(it->Phi());
+    }
+  }
+}
+
+// one worker of FillSampleParallel: its own chain, reader and histograms
+static void FillRange(TString inputFile, Long64_t first, Long64_t last,
+                      std::map< TString, std::vector<TH1F*> >* histograms,
+                      std::atomic<Long64_t>* done) {
+  TChain chain("Delphes");
+  chain.Add(inputFile);
+  ExRootTreeReader treeReader(&chain);
+  std::map< TString, TClonesArray* > branches;
+  for(std::map< TString, std::vector<TH1F*> >::iterator it=histograms->begin(); it!=histograms->end(); ++it) {
+    branches[it->first] = treeReader.UseBranch(it->first);
+  }
+  for(Long64_t i=first;i<last;++i) {
+    treeReader.ReadEntry(i);
+    for(std::map< TString, std::vector<TH1F*> >::iterator it=histograms->begin(); it!=histograms->end(); ++it) {
+      std::vector<TLorentzVector> vectors = DelphesBranchVectors(branches[it->first]);
+      FillHistograms(vectors, it->second);
+    }
+    ++(*done);
+  }
+}
+
 DelphesPlotSummary::DelphesPlotSummary(TEveWindowTab* tab):tab_(tab) {}
 
 DelphesPlotSummary::~DelphesPlotSummary() {}
@@ -100,23 +148,7 @@ void DelphesPlotSummary::FillSample(ExRootTreeReader* treeReader, Int_t event_id
     treeReader->ReadEntry(i);
     for(std::vector<DelphesBranchBase*>::iterator element = elements_->begin();element<elements_->end();++element) {
       std::vector<TLorentzVector> vectors = (*element)->GetVectors();
-      std::sort(vectors.begin(), vectors.end(), vecsorter); 
-      std::vector<TH1F*> histograms = histograms_[(*element)->GetName()];
-      for(std::vector<TLorentzVector>::iterator it=vectors.begin(); it<vectors.end();++it) {
-        histograms[0]->Fill(it->Pt());
-        histograms[1]->Fill(it->Eta());
-        histograms[2]->Fill(it->Phi());
-        if(it==vectors.begin()) {
-          histograms[3]->Fill(it->Pt());
-          histograms[4]->Fill(it->Eta());
-          histograms[5]->Fill(it->Phi());
-        }
-        if(it==vectors.begin()+1) {
-          histograms[6]->Fill(it->Pt());
-          histograms[7]->Fill(it->Eta());
-          histograms[8]->Fill(it->Phi());
-        }
-      }
+      FillHistograms(vectors, histograms_[(*element)->GetName()]);
     }
     Progress(int(100*i/entries));
   }
@@ -124,6 +156,111 @@ void DelphesPlotSummary::FillSample(ExRootTreeReader* treeReader, Int_t event_id
   Progress(100);
 }
 
+void DelphesPlotSummary::FillSampleParallel(const char* inputFile, Int_t nThreads) {
+  // only a single file gets a cache, not a wildcard or a list
+  TString cacheFile;
+  FileStat_t inputStat, cacheStat;
+  if(gSystem->GetPathInfo(inputFile, inputStat) == 0) {
+    cacheFile = Form("%s.summary.root", inputFile);
+    if(gSystem->GetPathInfo(cacheFile, cacheStat) == 0 && cacheStat.fMtime >= inputStat.fMtime && ReadCache(cacheFile)) {
+      Progress(100);
+      return;
+    }
+  }
+
+  TChain chain("Delphes");
+  chain.Add(inputFile);
+  Long64_t entries = chain.GetEntries();
+  if(nThreads > entries) nThreads = entries;
+  if(nThreads < 1) nThreads = 1;
+
+  // the histograms fill themselves with automatic binning, the copies of
+  // the workers are merged with TH1::Merge, which unites their ranges
+  std::vector< std::map< TString, std::vector<TH1F*> > > workerHistograms(nThreads);
+  for(Int_t t=0;t<nThreads;++t) {
+    for(std::map< TString, std::vector<TH1F*> >::iterator it=histograms_.begin(); it!=histograms_.end(); ++it) {
+      std::vector<TH1F*>& histograms = workerHistograms[t][it->first];
+      for(std::vector<TH1F*>::iterator h=it->second.begin(); h<it->second.end(); ++h) {
+        TH1F* copy = (TH1F*)(*h)->Clone();
+        copy->Reset();
+        copy->SetDirectory(0);
+        histograms.push_back(copy);
+      }
+    }
+  }
+
+  ROOT::EnableThreadSafety();
+  std::atomic<Long64_t> done(0);
+  std::vector<std::thread> workers;
+  for(Int_t t=0;t<nThreads;++t) {
+    workers.push_back(std::thread(FillRange, TString(inputFile), entries*t/nThreads, entries*(t+1)/nThreads, &workerHistograms[t], &done));
+  }
+  while(done < entries) {
+    Progress(int(100*done/entries));
+    gSystem->Sleep(100);
+  }
+  for(std::vector<std::thread>::iterator worker=workers.begin(); worker<workers.end(); ++worker) worker->join();
+
+  for(std::map< TString, std::vector<TH1F*> >::iterator it=histograms_.begin(); it!=histograms_.end(); ++it) {
+    for(size_t k=0;k<it->second.size();++k) {
+      TList list;
+      for(Int_t t=0;t<nThreads;++t) list.Add(workerHistograms[t][it->first][k]);
+      it->second[k]->Reset();
+      it->second[k]->Merge(&list);
+      list.Delete();
+    }
+  }
+
+  if(cacheFile.Length() > 0) WriteCache(cacheFile);
+  Progress(100);
+}
+
+Bool_t DelphesPlotSummary::ReadCache(const char* cacheFile) {
+  TDirectory::TContext context;
+  TFile* file = TFile::Open(cacheFile);
+  if(!file || file->IsZombie()) {
+    delete file;
+    return kFALSE;
+  }
+  // a cache written with another configuration misses some plots
+  Bool_t complete = kTRUE;
+  std::map< TString, std::vector<TH1F*> > cached;
+  for(std::map< TString, std::vector<TH1F*> >::iterator it=histograms_.begin(); it!=histograms_.end(); ++it) {
+    std::vector<TH1F*>& histograms = cached[it->first];
+    for(std::vector<TH1F*>::iterator h=it->second.begin(); h<it->second.end(); ++h) {
+      TH1F* copy = 0;
+      file->GetObject((*h)->GetName(), copy);
+      if(!copy) {
+        complete = kFALSE;
+        continue;
+      }
+      copy->SetDirectory(0);
+      histograms.push_back(copy);
+    }
+  }
+  delete file;
+  for(std::map< TString, std::vector<TH1F*> >::iterator it=cached.begin(); it!=cached.end(); ++it) {
+    std::vector<TH1F*>& replaced = complete ? histograms_[it->first] : it->second;
+    for(std::vector<TH1F*>::iterator h=replaced.begin(); h<replaced.end(); ++h) delete *h;
+    if(complete) replaced = it->second;
+  }
+  return complete;
+}
+
+void DelphesPlotSummary::WriteCache(const char* cacheFile) {
+  TDirectory::TContext context;
+  TFile* file = TFile::Open(cacheFile, "RECREATE");
+  if(!file || file->IsZombie()) {
+    std::cerr << "** WARNING: cannot write the summary plots to " << cacheFile << std::endl;
+    delete file;
+    return;
+  }
+  for(std::map< TString, std::vector<TH1F*> >::iterator it=histograms_.begin(); it!=histograms_.end(); ++it) {
+    for(std::vector<TH1F*>::iterator h=it->second.begin(); h<it->second.end(); ++h) file->WriteTObject(*h);
+  }
+  delete file;
+}
+
 void DelphesPlotSummary::Draw() {
   for(std::map< TString, TCanvas* >::iterator it=canvases_.begin(); it!=canvases_.end(); ++it) {
     TCanvas* c = it->second;
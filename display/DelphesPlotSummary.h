@@ -38,11 +38,20 @@ class DelphesPlotSummary
     virtual ~DelphesPlotSummary();
     void Init(std::vector<DelphesBranchBase*>& elements);
     void FillSample(ExRootTreeReader* treeReader, Int_t event_id);
+    // fills the same plots from all the entries of inputFile on nThreads
+    // threads, each with its own reader and histograms that are merged at
+    // the end, without moving the display reader. The plots of a single
+    // file are cached in <inputFile>.summary.root and read back from there
+    // as long as the cache is newer than the file.
+    void FillSampleParallel(const char* inputFile, Int_t nThreads);
     void FillEvent();
     void Draw();
     void Progress(Int_t); // *SIGNAL*
 
   private:
+    Bool_t ReadCache(const char* cacheFile);
+    void WriteCache(const char* cacheFile);
+
     TEveWindowTab* tab_;
     std::map< TString, TCanvas* >           canvases_;
     std::map< TString, std::vector<TH1F*> > histograms_;
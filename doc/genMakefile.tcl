@@ -102,7 +102,7 @@ proc sourceDeps {srcPrefix args} {
 
     if {$fileName == "modules/PileUpMergerPythia8.cc"} {
       lappend srcObjFilesPythia8 $srcObjName$objSuf
-    } elseif {([string match {modules/FastJet*.cc} $fileName] || [string match {modules/RunPUPPI.cc} $fileName]) && $srcPrefix != {FASTJET}} {
+    } elseif {([string match {modules/FastJet*.cc} $fileName] || [string match {modules/RunPUPPI.cc} $fileName] || [string match {modules/SoftKiller.cc} $fileName]) && $srcPrefix != {FASTJET}} {
       continue
     } else {
       lappend srcObjFiles $srcObjName$objSuf
@@ -224,9 +224,36 @@ else
   CXXFLAGS += -DNO_RAVE
 endif
 
+# optional LZ4 compression of the pile-up files
+LZ4_LIBS := $(shell pkg-config liblz4 --libs 2> /dev/null)
+ifdef LZ4_LIBS
+  CXXFLAGS += $(shell pkg-config liblz4 --cflags) -DHAS_LZ4
+  DELPHES_LIBS += $(LZ4_LIBS)
+endif
+
+# optional decompression of the gzip, zstd and xz inputs of the readers
+ZLIB_LIBS := $(shell pkg-config zlib --libs 2> /dev/null)
+ifdef ZLIB_LIBS
+  CXXFLAGS += $(shell pkg-config zlib --cflags) -DHAS_ZLIB
+  DELPHES_LIBS += $(ZLIB_LIBS)
+endif
+ZSTD_LIBS := $(shell pkg-config libzstd --libs 2> /dev/null)
+ifdef ZSTD_LIBS
+  CXXFLAGS += $(shell pkg-config libzstd --cflags) -DHAS_ZSTD
+  DELPHES_LIBS += $(ZSTD_LIBS)
+endif
+LZMA_LIBS := $(shell pkg-config liblzma --libs 2> /dev/null)
+ifdef LZMA_LIBS
+  CXXFLAGS += $(shell pkg-config liblzma --cflags) -DHAS_LZMA
+  DELPHES_LIBS += $(LZMA_LIBS)
+endif
+
 # HDF writer
 CXXFLAGS    += $(shell pkg-config hdf5 --cflags)
-DELPHES_LIBS += $(shell pkg-config hdf5 --libs) -lhdf5_cpp
+DELPHES_LIBS += $(shell pkg-config hdf5 --libs) -lhdf5_cpp -lhdf5_hl
+# the HDF writer can flush buffers in a background thread
+CXXFLAGS    += -pthread
+DELPHES_LIBS += -pthread
 
 ifneq ($(CMSSW_FWLITE_INCLUDE_PATH),)
 HAS_CMSSW = true
@@ -278,7 +305,7 @@ all:
 
 executableDeps {converters/*.cpp} {examples/*.cpp}
 
-executableDeps {readers/DelphesHepMC.cpp} {readers/DelphesLHEF.cpp} {readers/DelphesSTDHEP.cpp}
+executableDeps {readers/DelphesHepMC.cpp} {readers/DelphesLHEF.cpp} {readers/DelphesSTDHEP.cpp} {readers/DelphesHDF5.cpp}
 
 puts {ifeq ($(HAS_CMSSW),true)}
 executableDeps {readers/DelphesCMSFWLite.cpp}
@@ -304,7 +331,7 @@ dictDeps {DISPLAY_DICT} {display/DisplayLinkDef.h}
 
 sourceDeps {DELPHES} {classes/*.cc} {classes/flavortag/*.cc} {modules/*.cc} {external/ExRootAnalysis/*.cc} {external/Hector/*.cc} {external/h5/*.cc}
 
-sourceDeps {FASTJET} {modules/FastJet*.cc} {modules/RunPUPPI.cc} {external/PUPPI/*.cc} {external/fastjet/*.cc} {external/fastjet/tools/*.cc} {external/fastjet/plugins/*/*.cc} {external/fastjet/contribs/*/*.cc} 
+sourceDeps {FASTJET} {modules/FastJet*.cc} {modules/RunPUPPI.cc} {modules/SoftKiller.cc} {external/PUPPI/*.cc} {external/fastjet/*.cc} {external/fastjet/tools/*.cc} {external/fastjet/plugins/*/*.cc} {external/fastjet/contribs/*/*.cc} 
 
 sourceDeps {DISPLAY} {display/*.cc}
 
@@ -324,6 +351,8 @@ all: $(NOFASTJET) $(DELPHES) $(EXECUTABLE)
 display: $(DISPLAY)
 endif
 
+benchmarks: DelphesBenchmark$(ExeSuf) JetClusteringBenchmark$(ExeSuf) KernelBenchmark$(ExeSuf)
+
 $(NOFASTJET): $(DELPHES_DICT_OBJ) $(DELPHES_OBJ) $(TCL_OBJ)
 	@mkdir -p $(@D)
 	@echo ">> Building $@"
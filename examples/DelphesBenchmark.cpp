@@ -0,0 +1,643 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ *  Times whole cards on a fixed HepMC sample at several pile-up levels.
+ *
+ *    DelphesBenchmark [-n events] [-p 0,50,140] [-o results.json]
+ *      [-b baseline.json] [-t tolerance] [-w directory] [-r directory]
+ *      input.hepmc card.tcl [card.tcl ...]
+ *
+ *  The first events of the input (100 by default) are run through every
+ *  card once for each MeanPileUp value given with -p. The value is set on
+ *  every PileUpMerger module of the card, and a card without PileUpMerger
+ *  is run only once. The TreeWriter modules are removed from the
+ *  ExecutionPath so that no ROOT file is written, and ModuleTiming is
+ *  switched on.
+ *
+ *  For every run the events per second of the module processing, the
+ *  peak resident memory and the times of every module are written to the
+ *  JSON output (benchmark.json by default), one run per line. With -b the
+ *  events per second are compared with the ones of a previous output, and
+ *  the program returns 2 when a run is slower than the baseline by more
+ *  than the tolerance (0.1 by default).
+ *
+ *  The peak memory is reset before every run through /proc/self/clear_refs,
+ *  where this is not available it is the peak of the whole process.
+ *
+ *  Every HDF5Writer of a card writes to <card>_<pileup>_<module>.h5 in
+ *  the directory given with -w, the current one by default. With -r the
+ *  jets dataset of every such file is compared value by value with the
+ *  file of the same name in the reference directory, and the program also
+ *  returns 2 when they differ. A run of
+ *
+ *    DelphesBenchmark -n 50 -w reference input.hepmc cards/delphes_tracksmear.tcl
+ *
+ *  makes the reference for the vertexing and the HDF5 output.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/resource.h>
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <stdexcept>
+#include <chrono>
+
+#include "H5Cpp.h"
+
+#include "TROOT.h"
+#include "TApplication.h"
+
+#include "TObjArray.h"
+
+#include "modules/Delphes.h"
+#include "modules/DelphesProfiler.h"
+#include "classes/DelphesFactory.h"
+#include "classes/DelphesInputFile.h"
+#include "classes/DelphesHepMCReader.h"
+
+#include "ExRootAnalysis/ExRootConfReader.h"
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+
+struct BenchmarkResult
+{
+  string card;
+  int pileUp; // -1 for the cards without PileUpMerger
+  Long64_t events;
+  double seconds, peakMemory;
+  string modules;
+  vector< string > outputs; // HDF5Writer files
+  int jetsMatch; // -1 not compared, 0 different, 1 same
+};
+
+//------------------------------------------------------------------------------
+
+// resets the peak resident memory of the process, false if not supported
+
+bool ResetPeakMemory()
+{
+  FILE *file = fopen("/proc/self/clear_refs", "w");
+  bool result;
+
+  if(!file) return false;
+  result = fputs("5", file) >= 0;
+  return fclose(file) == 0 && result;
+}
+
+//------------------------------------------------------------------------------
+
+// peak resident memory in MB
+
+double PeakMemory()
+{
+  ifstream status("/proc/self/status");
+  string line;
+  rusage usage;
+
+  while(getline(status, line))
+  {
+    if(line.compare(0, 6, "VmHWM:") == 0) return atof(line.c_str() + 6)/1024.0;
+  }
+
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss/1024.0;
+}
+
+//------------------------------------------------------------------------------
+
+vector< int > ParsePileUp(const char *text)
+{
+  vector< int > result;
+  stringstream stream(text);
+  string item;
+  stringstream message;
+
+  while(getline(stream, item, ','))
+  {
+    if(item.empty() || item.find_first_not_of("0123456789") != string::npos)
+    {
+      message << "bad pile-up value '" << item << "'";
+      throw runtime_error(message.str());
+    }
+    result.push_back(atoi(item.c_str()));
+  }
+
+  return result;
+}
+
+//------------------------------------------------------------------------------
+
+// names of the modules of the given class
+
+vector< string > FindModules(const ExRootConfReader *confReader, const char *className)
+{
+  const ExRootConfReader::ExRootTaskMap *modules = confReader->GetModules();
+  ExRootConfReader::ExRootTaskMap::const_iterator itModules;
+  vector< string > result;
+
+  for(itModules = modules->begin(); itModules != modules->end(); ++itModules)
+  {
+    if(itModules->second == className) result.push_back(itModules->first.Data());
+  }
+
+  return result;
+}
+
+//------------------------------------------------------------------------------
+
+// file name without the directory and the extension
+
+string BaseName(const string &fileName)
+{
+  size_t slash = fileName.rfind('/');
+  string result = slash == string::npos ? fileName : fileName.substr(slash + 1);
+  size_t dot = result.rfind('.');
+
+  return dot == string::npos ? result : result.substr(0, dot);
+}
+
+//------------------------------------------------------------------------------
+
+// values of a dataset read with the native types, the variable length
+// members are freed with the object
+
+struct DataSetValues
+{
+  DataSetValues(const string &fileName, const char *name);
+  ~DataSetValues();
+
+  hid_t type, space;
+  hssize_t size;
+  vector< char > buffer;
+};
+
+DataSetValues::DataSetValues(const string &fileName, const char *name) :
+  type(-1), space(-1), size(0)
+{
+  stringstream message;
+  hid_t file, dataSet, fileType;
+  herr_t status = -1;
+
+  file = H5Fopen(fileName.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+  dataSet = file < 0 ? -1 : H5Dopen2(file, name, H5P_DEFAULT);
+  if(dataSet >= 0)
+  {
+    fileType = H5Dget_type(dataSet);
+    type = H5Tget_native_type(fileType, H5T_DIR_ASCEND);
+    H5Tclose(fileType);
+    space = H5Dget_space(dataSet);
+    size = H5Sget_simple_extent_npoints(space);
+    buffer.resize(size*H5Tget_size(type) + 1);
+    status = H5Dread(dataSet, type, H5S_ALL, H5S_ALL, H5P_DEFAULT, buffer.data());
+    H5Dclose(dataSet);
+  }
+  if(file >= 0) H5Fclose(file);
+
+  if(status < 0)
+  {
+    if(space >= 0) H5Sclose(space);
+    if(type >= 0) H5Tclose(type);
+    message << "can't read dataset " << name << " of file " << fileName;
+    throw runtime_error(message.str());
+  }
+}
+
+DataSetValues::~DataSetValues()
+{
+  H5Dvlen_reclaim(type, space, H5P_DEFAULT, buffer.data());
+  H5Sclose(space);
+  H5Tclose(type);
+}
+
+//------------------------------------------------------------------------------
+
+// true when two values of the given native type are equal, NaN included,
+// the variable length members are compared element by element
+
+bool SameValues(hid_t type, const char *first, const char *second)
+{
+  hid_t member;
+  size_t offset, size;
+  int i, n;
+  bool result = true;
+
+  switch(H5Tget_class(type))
+  {
+    case H5T_COMPOUND:
+      n = H5Tget_nmembers(type);
+      for(i = 0; i < n && result; ++i)
+      {
+        member = H5Tget_member_type(type, i);
+        offset = H5Tget_member_offset(type, i);
+        result = SameValues(member, first + offset, second + offset);
+        H5Tclose(member);
+      }
+      return result;
+    case H5T_VLEN:
+    {
+      const hvl_t *firstList = reinterpret_cast< const hvl_t * >(first);
+      const hvl_t *secondList = reinterpret_cast< const hvl_t * >(second);
+      if(firstList->len != secondList->len) return false;
+      member = H5Tget_super(type);
+      size = H5Tget_size(member);
+      for(i = 0; i < int(firstList->len) && result; ++i)
+      {
+        result = SameValues(member,
+          static_cast< const char * >(firstList->p) + i*size,
+          static_cast< const char * >(secondList->p) + i*size);
+      }
+      H5Tclose(member);
+      return result;
+    }
+    case H5T_ARRAY:
+      member = H5Tget_super(type);
+      size = H5Tget_size(member);
+      n = H5Tget_size(type)/size;
+      for(i = 0; i < n && result; ++i)
+      {
+        result = SameValues(member, first + i*size, second + i*size);
+      }
+      H5Tclose(member);
+      return result;
+    case H5T_STRING:
+      if(H5Tis_variable_str(type) > 0)
+      {
+        const char *firstString = *reinterpret_cast< char *const * >(first);
+        const char *secondString = *reinterpret_cast< char *const * >(second);
+        return strcmp(firstString ? firstString : "", secondString ? secondString : "") == 0;
+      }
+      return memcmp(first, second, H5Tget_size(type)) == 0;
+    default:
+      return memcmp(first, second, H5Tget_size(type)) == 0;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+// compares the jets written by a run with the reference file
+
+bool SameJets(const string &fileName, const string &referenceName)
+{
+  DataSetValues values(fileName, "jets"), reference(referenceName, "jets");
+  size_t size = H5Tget_size(values.type);
+  hssize_t i;
+
+  if(values.size != reference.size || H5Tequal(values.type, reference.type) <= 0) return false;
+
+  for(i = 0; i < values.size; ++i)
+  {
+    if(!SameValues(values.type, &values.buffer[i*size], &reference.buffer[i*size])) return false;
+  }
+
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+void RunCard(const char *inputName, const char *cardName, int pileUp, Long64_t maxEvents,
+  const string &outputDirectory, BenchmarkResult &result)
+{
+  stringstream message, path, modules;
+  ExRootConfReader *confReader;
+  Delphes *modularDelphes;
+  DelphesFactory *factory;
+  DelphesInputFile *input;
+  DelphesHepMCReader *reader;
+  TObjArray *allParticleOutputArray, *stableParticleOutputArray, *partonOutputArray;
+  vector< string > names, writers, outputs;
+  vector< string >::const_iterator itNames;
+  chrono::steady_clock::time_point start;
+  Long64_t eventCounter = 0;
+  double seconds = 0.0;
+  int i;
+
+  input = new DelphesInputFile(inputName);
+  if(input->GetLength() <= 0)
+  {
+    delete input;
+    message << "can't read input file " << inputName;
+    throw runtime_error(message.str());
+  }
+
+  confReader = new ExRootConfReader;
+  confReader->ReadFile(cardName);
+
+  // same pile-up on every merger, and no ROOT output
+  names = FindModules(confReader, "PileUpMerger");
+  for(itNames = names.begin(); itNames != names.end() && pileUp >= 0; ++itNames)
+  {
+    confReader->SetParam((*itNames + "::MeanPileUp").c_str(), to_string(pileUp).c_str());
+  }
+
+  // the HDF5Writer files go where they can be compared
+  writers = FindModules(confReader, "HDF5Writer");
+  for(itNames = writers.begin(); itNames != writers.end(); ++itNames)
+  {
+    outputs.push_back(outputDirectory + "/" + BaseName(cardName) + "_" + to_string(names.empty() ? 0 : pileUp) + "_" + *itNames + ".h5");
+    confReader->SetParam((*itNames + "::OutputFile").c_str(), outputs.back().c_str());
+  }
+
+  writers = FindModules(confReader, "TreeWriter");
+  ExRootConfParam param = confReader->GetParam("::ExecutionPath");
+  for(i = 0; i < param.GetSize(); ++i)
+  {
+    string name = param[i].GetString();
+    if(find(writers.begin(), writers.end(), name) != writers.end()) continue;
+    path << name << ' ';
+  }
+  confReader->SetParam("::ExecutionPath", path.str().c_str());
+  confReader->SetParam("::ModuleTiming", "true");
+  confReader->SetParam("::ModuleTimingFile", "");
+
+  modularDelphes = new Delphes("Delphes");
+  modularDelphes->SetConfReader(confReader);
+
+  factory = modularDelphes->GetFactory();
+  allParticleOutputArray = modularDelphes->ExportArray("allParticles");
+  stableParticleOutputArray = modularDelphes->ExportArray("stableParticles");
+  partonOutputArray = modularDelphes->ExportArray("partons");
+
+  modularDelphes->InitTask();
+
+  reader = new DelphesHepMCReader;
+  reader->SetUsedArrays(modularDelphes->IsArrayImported(allParticleOutputArray),
+    modularDelphes->IsArrayImported(stableParticleOutputArray),
+    modularDelphes->IsArrayImported(partonOutputArray));
+  reader->SetInputFile(input->GetFile());
+
+  ResetPeakMemory();
+
+  // only the module processing is timed, not the reading
+  modularDelphes->Clear();
+  reader->Clear();
+  while(eventCounter < maxEvents &&
+    reader->ReadBlock(factory, allParticleOutputArray, stableParticleOutputArray, partonOutputArray))
+  {
+    if(!reader->EventReady()) continue;
+
+    start = chrono::steady_clock::now();
+    modularDelphes->ProcessTask();
+    seconds += chrono::duration< double >(chrono::steady_clock::now() - start).count();
+    ++eventCounter;
+
+    modularDelphes->Clear();
+    reader->Clear();
+  }
+
+  modularDelphes->FinishTask();
+
+  if(modularDelphes->GetProfiler()) modularDelphes->GetProfiler()->PrintJSON(modules);
+
+  result.card = cardName;
+  result.pileUp = names.empty() ? -1 : pileUp;
+  result.events = eventCounter;
+  result.seconds = seconds;
+  result.peakMemory = PeakMemory();
+  result.modules = modules.str();
+  result.outputs = outputs;
+  result.jetsMatch = -1;
+
+  delete reader;
+  delete input;
+  delete modularDelphes;
+  delete confReader;
+}
+
+//------------------------------------------------------------------------------
+
+void WriteResult(ostream &out, const BenchmarkResult &result)
+{
+  out << "{\"card\":\"" << result.card << "\",\"pileup\":";
+  if(result.pileUp < 0) out << "null";
+  else out << result.pileUp;
+  out << ",\"events\":" << result.events;
+  out << ",\"seconds\":" << result.seconds;
+  out << ",\"events_per_second\":" << (result.seconds > 0.0 ? result.events/result.seconds : 0.0);
+  out << ",\"peak_rss_mb\":" << result.peakMemory;
+  out << ",\"jets_match\":" << (result.jetsMatch < 0 ? "null" : (result.jetsMatch ? "true" : "false"));
+  out << ",\"modules\":" << result.modules << "}";
+}
+
+//------------------------------------------------------------------------------
+
+// value of a number field in a line written by WriteResult
+
+bool FindNumber(const string &line, const char *key, double &value)
+{
+  string pattern = string("\"") + key + "\":";
+  size_t position = line.find(pattern);
+
+  if(position == string::npos) return false;
+  position += pattern.size();
+  if(line.compare(position, 4, "null") == 0)
+  {
+    value = -1.0;
+    return true;
+  }
+  value = atof(line.c_str() + position);
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+// events per second of every card and pile-up in a previous output
+
+map< pair< string, int >, double > ReadBaseline(const char *fileName)
+{
+  map< pair< string, int >, double > result;
+  ifstream file(fileName);
+  stringstream message;
+  string line, card;
+  size_t position, end;
+  double pileUp, rate;
+
+  if(!file.is_open())
+  {
+    message << "can't open baseline file " << fileName;
+    throw runtime_error(message.str());
+  }
+
+  while(getline(file, line))
+  {
+    position = line.find("\"card\":\"");
+    if(position == string::npos) continue;
+    position += 8;
+    end = line.find('"', position);
+    if(end == string::npos) continue;
+    card = line.substr(position, end - position);
+
+    if(!FindNumber(line, "pileup", pileUp) || !FindNumber(line, "events_per_second", rate)) continue;
+    result[make_pair(card, int(pileUp))] = rate;
+  }
+
+  return result;
+}
+
+//------------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+  char appName[] = "DelphesBenchmark";
+  const char *outputName = "benchmark.json";
+  const char *baselineName = 0;
+  string outputDirectory = ".", referenceDirectory;
+  vector< int > pileUps(1, 0);
+  vector< int >::const_iterator itPileUps;
+  vector< BenchmarkResult > results;
+  vector< BenchmarkResult >::iterator itResults;
+  vector< string >::const_iterator itOutputs;
+  map< pair< string, int >, double > baseline;
+  map< pair< string, int >, double >::const_iterator itBaseline;
+  BenchmarkResult result;
+  Long64_t maxEvents = 100;
+  double tolerance = 0.1, rate, ratio;
+  int i, status = 0;
+  bool slower;
+
+  for(i = 1; i + 1 < argc && argv[i][0] == '-'; i += 2)
+  {
+    if(strcmp(argv[i], "-n") == 0) maxEvents = atoll(argv[i + 1]);
+    else if(strcmp(argv[i], "-p") == 0) pileUps = ParsePileUp(argv[i + 1]);
+    else if(strcmp(argv[i], "-o") == 0) outputName = argv[i + 1];
+    else if(strcmp(argv[i], "-b") == 0) baselineName = argv[i + 1];
+    else if(strcmp(argv[i], "-t") == 0) tolerance = atof(argv[i + 1]);
+    else if(strcmp(argv[i], "-w") == 0) outputDirectory = argv[i + 1];
+    else if(strcmp(argv[i], "-r") == 0) referenceDirectory = argv[i + 1];
+    else break;
+  }
+
+  if(argc - i < 2 || maxEvents <= 0 || pileUps.empty())
+  {
+    cout << " Usage: " << appName << " [-n events] [-p pileup,...] [-o output_file]" << endl;
+    cout << "        [-b baseline_file] [-t tolerance] [-w output_directory]" << endl;
+    cout << "        [-r reference_directory] input_file config_file(s)" << endl;
+    cout << " -n events - number of events of the input to process, 100 by default," << endl;
+    cout << " -p pileup,... - MeanPileUp values of the PileUpMerger modules, 0 by default," << endl;
+    cout << " -o output_file - results in JSON format, benchmark.json by default," << endl;
+    cout << " -b baseline_file - results of a previous run to compare with," << endl;
+    cout << " -t tolerance - largest relative slowdown accepted, 0.1 by default," << endl;
+    cout << " -w output_directory - where the HDF5Writer files go, . by default," << endl;
+    cout << " -r reference_directory - HDF5Writer files to compare the jets with," << endl;
+    cout << " input_file - input file in HepMC format," << endl;
+    cout << " config_file(s) - configuration files in Tcl format." << endl;
+    return 1;
+  }
+
+  gROOT->SetBatch();
+
+  int appargc = 1;
+  char *appargv[] = {appName};
+  TApplication app(appName, &appargc, appargv);
+
+  try
+  {
+    if(baselineName) baseline = ReadBaseline(baselineName);
+
+    for(int card = i + 1; card < argc; ++card)
+    {
+      for(itPileUps = pileUps.begin(); itPileUps != pileUps.end(); ++itPileUps)
+      {
+        cout << "** Running " << argv[card] << " with MeanPileUp " << *itPileUps << endl;
+        RunCard(argv[i], argv[card], *itPileUps, maxEvents, outputDirectory, result);
+
+        if(!referenceDirectory.empty() && !result.outputs.empty())
+        {
+          result.jetsMatch = 1;
+          for(itOutputs = result.outputs.begin(); itOutputs != result.outputs.end(); ++itOutputs)
+          {
+            if(!SameJets(*itOutputs, referenceDirectory + "/" + BaseName(*itOutputs) + ".h5")) result.jetsMatch = 0;
+          }
+        }
+
+        results.push_back(result);
+
+        // the card has no PileUpMerger
+        if(result.pileUp < 0) break;
+      }
+    }
+
+    ofstream output(outputName);
+    if(!output.is_open())
+    {
+      stringstream message;
+      message << "can't create output file " << outputName;
+      throw runtime_error(message.str());
+    }
+
+    output << "{\"results\":[\n";
+    for(itResults = results.begin(); itResults != results.end(); ++itResults)
+    {
+      if(itResults != results.begin()) output << ",\n";
+      WriteResult(output, *itResults);
+    }
+    output << "\n]}\n";
+
+    cout << "** " << left << setw(40) << "card" << right << setw(8) << "pileup";
+    cout << setw(12) << "events/s" << setw(12) << "rss MB" << setw(12) << "baseline" << setw(10) << "jets" << endl;
+    cout << fixed << setprecision(2);
+    for(itResults = results.begin(); itResults != results.end(); ++itResults)
+    {
+      rate = itResults->seconds > 0.0 ? itResults->events/itResults->seconds : 0.0;
+      cout << "** " << left << setw(40) << itResults->card << right << setw(8) << itResults->pileUp;
+      cout << setw(12) << rate << setw(12) << itResults->peakMemory;
+
+      slower = false;
+      itBaseline = baseline.find(make_pair(itResults->card, itResults->pileUp));
+      if(itBaseline != baseline.end() && itBaseline->second > 0.0)
+      {
+        ratio = rate/itBaseline->second;
+        slower = ratio < 1.0 - tolerance;
+        cout << setw(11) << 100.0*(ratio - 1.0) << '%';
+      }
+      else
+      {
+        cout << setw(12) << "-";
+      }
+
+      if(itResults->jetsMatch < 0) cout << setw(10) << "-";
+      else cout << setw(10) << (itResults->jetsMatch ? "same" : "differ");
+
+      if(slower) cout << "  slower";
+      if(slower || itResults->jetsMatch == 0) status = 2;
+      cout << endl;
+    }
+
+    cout << "** Results written to " << outputName << endl;
+    cout << "** Exiting..." << endl;
+
+    return status;
+  }
+  catch(runtime_error &e)
+  {
+    cerr << "** ERROR: " << e.what() << endl;
+    return 1;
+  }
+}
@@ -0,0 +1,400 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ *  Times the FastJetFinder clustering on recorded inputs.
+ *
+ *  The inputs are written by FastJetFinder when InputDumpFile is set in the
+ *  card, for instance with one run of cards/CMS_PhaseII_140PU_conf4.tcl per
+ *  MeanPileUp value:
+ *
+ *    module FastJetFinder RecoJetFinder {
+ *      ...
+ *      set InputDumpFile inputs_140.dat
+ *    }
+ *
+ *  Every JetAlgorithm (1-8, 14) is timed without area, then every
+ *  AreaAlgorithm (1-5) and every substructure flag with antikt, using the
+ *  FastJetFinder defaults for the other parameters:
+ *
+ *    JetClusteringBenchmark [-r repeat] [-c name] 0:inputs_0.dat 50:inputs_50.dat ...
+ *
+ *  With -c only the configurations whose name contains the given text are
+ *  run, AreaAlgorithm 2 alone takes seconds per event at high pile-up.
+ *
+ *  For each pile-up label and configuration the mean and the 50%, 90% and
+ *  99% percentiles of the time per event are printed in milliseconds.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <chrono>
+
+#include "fastjet/PseudoJet.hh"
+#include "fastjet/JetDefinition.hh"
+#include "fastjet/ClusterSequence.hh"
+#include "fastjet/Selector.hh"
+#include "fastjet/ClusterSequenceArea.hh"
+
+#include "fastjet/plugins/SISCone/fastjet/SISConePlugin.hh"
+#include "fastjet/plugins/CDFCones/fastjet/CDFMidPointPlugin.hh"
+#include "fastjet/plugins/CDFCones/fastjet/CDFJetCluPlugin.hh"
+#include "fastjet/plugins/TrackJet/fastjet/TrackJetPlugin.hh"
+
+#include "fastjet/contribs/Nsubjettiness/Nsubjettiness.hh"
+#include "fastjet/contribs/Nsubjettiness/Njettiness.hh"
+#include "fastjet/contribs/Nsubjettiness/NjettinessPlugin.hh"
+#include "fastjet/contribs/Nsubjettiness/WinnerTakeAllRecombiner.hh"
+
+#include "fastjet/tools/Filter.hh"
+#include "fastjet/tools/Pruner.hh"
+#include "fastjet/contribs/RecursiveTools/SoftDrop.hh"
+
+using namespace std;
+using namespace fastjet;
+using namespace fastjet::contrib;
+
+//------------------------------------------------------------------------------
+
+struct BenchmarkInput
+{
+  string pileUp;
+  vector< vector< PseudoJet > > events;
+};
+
+struct BenchmarkConfiguration
+{
+  string name;
+  int jetAlgorithm;
+  int areaAlgorithm;
+  int substructure; // 0 none, 1 trimming, 2 pruning, 3 soft drop, 4 n-subjettiness
+};
+
+// FastJetFinder defaults
+static const double kParameterR = 0.5;
+static const double kConeRadius = 0.5;
+static const double kJetPTMin = 10.0;
+
+//------------------------------------------------------------------------------
+
+void ReadInputs(const char *fileName, BenchmarkInput &input)
+{
+  FILE *file;
+  int i, number;
+  double record[4];
+  vector< PseudoJet > inputList;
+  stringstream message;
+
+  file = fopen(fileName, "rb");
+  if(file == NULL)
+  {
+    message << "can't open input dump file " << fileName;
+    throw runtime_error(message.str());
+  }
+
+  while(fread(&number, sizeof(int), 1, file) == 1)
+  {
+    inputList.clear();
+    for(i = 0; i < number; ++i)
+    {
+      if(fread(record, sizeof(double), 4, file) != 4)
+      {
+        fclose(file);
+        message << "truncated input dump file " << fileName;
+        throw runtime_error(message.str());
+      }
+      inputList.push_back(PseudoJet(record[0], record[1], record[2], record[3]));
+      inputList.back().set_user_index(i);
+    }
+    input.events.push_back(inputList);
+  }
+
+  fclose(file);
+}
+
+//------------------------------------------------------------------------------
+
+JetDefinition *NewDefinition(int jetAlgorithm, JetDefinition::Plugin **plugin, JetDefinition::Recombiner **recomb)
+{
+  *plugin = 0;
+  *recomb = 0;
+
+  switch(jetAlgorithm)
+  {
+    case 1:
+      *plugin = new CDFJetCluPlugin(1.0, kConeRadius, 2, 100, 1, 0.75);
+      break;
+    case 2:
+      *plugin = new CDFMidPointPlugin(1.0, kConeRadius, 1.0, 2, 100, 0.75);
+      break;
+    case 3:
+      *plugin = new SISConePlugin(kConeRadius, 0.75, 100, kJetPTMin);
+      break;
+    case 4:
+      return new JetDefinition(kt_algorithm, kParameterR);
+    case 5:
+      return new JetDefinition(cambridge_algorithm, kParameterR);
+    case 6:
+      return new JetDefinition(antikt_algorithm, kParameterR);
+    case 7:
+      *recomb = new WinnerTakeAllRecombiner();
+      return new JetDefinition(antikt_algorithm, kParameterR, *recomb, Best);
+    case 8:
+      *plugin = new NjettinessPlugin(2, Njettiness::wta_kt_axes, Njettiness::unnormalized_cutoff_measure, 1.0, 0.8);
+      break;
+    case 14:
+      *plugin = new TrackJetPlugin(kParameterR);
+      break;
+  }
+
+  return new JetDefinition(*plugin);
+}
+
+//------------------------------------------------------------------------------
+
+AreaDefinition *NewAreaDefinition(int areaAlgorithm)
+{
+  GhostedAreaSpec ghostSpec(5.0, 1, 0.01, 1.0, 0.1, 1.0E-100);
+
+  switch(areaAlgorithm)
+  {
+    case 1:
+      return new AreaDefinition(active_area_explicit_ghosts, ghostSpec);
+    case 2:
+      return new AreaDefinition(one_ghost_passive_area, ghostSpec);
+    case 3:
+      return new AreaDefinition(passive_area, ghostSpec);
+    case 4:
+      return new AreaDefinition(VoronoiAreaSpec(1.0));
+    case 5:
+      return new AreaDefinition(active_area, ghostSpec);
+  }
+
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+
+double Percentile(const vector< double > &sorted, double fraction)
+{
+  size_t i;
+
+  if(sorted.empty()) return 0.0;
+  i = min(size_t(fraction*sorted.size()), sorted.size() - 1);
+  return sorted[i];
+}
+
+//------------------------------------------------------------------------------
+
+void RunConfiguration(const BenchmarkConfiguration &configuration, const BenchmarkInput &input, int repeat)
+{
+  JetDefinition::Plugin *plugin;
+  JetDefinition::Recombiner *recomb;
+  JetDefinition *definition;
+  AreaDefinition *areaDefinition;
+  ClusterSequence *sequence;
+  vector< vector< PseudoJet > >::const_iterator itEvents;
+  vector< PseudoJet > outputList;
+  vector< PseudoJet >::const_iterator itOutputList;
+  vector< double > times;
+  PseudoJet result;
+  double sum, value;
+  int i;
+
+  chrono::steady_clock::time_point start;
+
+  Filter trimmer(JetDefinition(kt_algorithm, 0.2), SelectorPtFractionMin(0.05));
+  Pruner pruner(JetDefinition(cambridge_algorithm, 0.8), 0.1, 0.5);
+  SoftDrop softDrop(0.0, 0.1, 0.8);
+  NsubjettinessSet nSubjettiness(5, Njettiness::wta_kt_axes, Njettiness::unnormalized_measure, 1.0);
+
+  definition = NewDefinition(configuration.jetAlgorithm, &plugin, &recomb);
+  areaDefinition = NewAreaDefinition(configuration.areaAlgorithm);
+
+  sum = 0.0;
+  for(i = 0; i < repeat; ++i)
+  {
+    for(itEvents = input.events.begin(); itEvents != input.events.end(); ++itEvents)
+    {
+      start = chrono::steady_clock::now();
+
+      if(areaDefinition)
+      {
+        sequence = new ClusterSequenceArea(*itEvents, *definition, *areaDefinition);
+      }
+      else
+      {
+        sequence = new ClusterSequence(*itEvents, *definition);
+      }
+
+      outputList = sorted_by_pt(sequence->inclusive_jets(kJetPTMin));
+
+      for(itOutputList = outputList.begin(); itOutputList != outputList.end(); ++itOutputList)
+      {
+        switch(configuration.substructure)
+        {
+          case 1:
+            result = trimmer(*itOutputList);
+            break;
+          case 2:
+            result = pruner(*itOutputList);
+            break;
+          case 3:
+            result = softDrop(*itOutputList);
+            break;
+          case 4:
+            nSubjettiness.result(*itOutputList);
+            break;
+        }
+      }
+
+      delete sequence;
+
+      value = chrono::duration< double, milli >(chrono::steady_clock::now() - start).count();
+      times.push_back(value);
+      sum += value;
+    }
+  }
+
+  sort(times.begin(), times.end());
+
+  cout << right << setw(6) << input.pileUp << "  " << left << setw(28) << configuration.name << right;
+  cout << setw(8) << input.events.size();
+  cout << fixed << setprecision(3);
+  cout << setw(12) << (times.empty() ? 0.0 : sum/times.size());
+  cout << setw(12) << Percentile(times, 0.50);
+  cout << setw(12) << Percentile(times, 0.90);
+  cout << setw(12) << Percentile(times, 0.99) << endl;
+
+  delete areaDefinition;
+  delete definition;
+  delete plugin;
+  delete recomb;
+}
+
+//------------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+  const char *appName = "JetClusteringBenchmark";
+  const char *separator;
+  int i, repeat = 1;
+  string selection;
+  vector< BenchmarkInput > inputs;
+  vector< BenchmarkInput >::const_iterator itInputs;
+  vector< BenchmarkConfiguration > configurations;
+  vector< BenchmarkConfiguration >::const_iterator itConfigurations;
+  BenchmarkConfiguration configuration;
+  stringstream name;
+
+  static const int jetAlgorithms[] = {1, 2, 3, 4, 5, 6, 7, 8, 14};
+  static const char *substructureNames[] = {"", "Trimming", "Pruning", "SoftDrop", "Nsubjettiness"};
+
+  for(i = 1; i < argc && argv[i][0] == '-'; ++i)
+  {
+    if(strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+    {
+      repeat = max(atoi(argv[++i]), 1);
+    }
+    else if(strcmp(argv[i], "-c") == 0 && i + 1 < argc)
+    {
+      selection = argv[++i];
+    }
+  }
+
+  if(i >= argc)
+  {
+    cout << " Usage: " << appName << " [-r repeat] [-c name] pileup:input_file [pileup:input_file ...]" << endl;
+    cout << " pileup - label of the sample, e.g. the MeanPileUp of the card run," << endl;
+    cout << " input_file - inputs written by FastJetFinder with InputDumpFile," << endl;
+    cout << " repeat - number of passes over the events, 1 by default," << endl;
+    cout << " name - run only the configurations containing this text." << endl;
+    return 1;
+  }
+
+  try
+  {
+    for(; i < argc; ++i)
+    {
+      inputs.push_back(BenchmarkInput());
+      separator = strchr(argv[i], ':');
+      inputs.back().pileUp = separator ? string(argv[i], separator - argv[i]) : string("-");
+      ReadInputs(separator ? separator + 1 : argv[i], inputs.back());
+    }
+
+    // every algorithm alone, then areas and substructure on top of antikt
+
+    for(i = 0; i < int(sizeof(jetAlgorithms)/sizeof(jetAlgorithms[0])); ++i)
+    {
+      name.str("");
+      name << "JetAlgorithm " << jetAlgorithms[i];
+      configuration.name = name.str();
+      configuration.jetAlgorithm = jetAlgorithms[i];
+      configuration.areaAlgorithm = 0;
+      configuration.substructure = 0;
+      configurations.push_back(configuration);
+    }
+    for(i = 1; i <= 5; ++i)
+    {
+      name.str("");
+      name << "JetAlgorithm 6 AreaAlgorithm " << i;
+      configuration.name = name.str();
+      configuration.jetAlgorithm = 6;
+      configuration.areaAlgorithm = i;
+      configuration.substructure = 0;
+      configurations.push_back(configuration);
+    }
+    for(i = 1; i <= 4; ++i)
+    {
+      configuration.name = string("JetAlgorithm 6 ") + substructureNames[i];
+      configuration.jetAlgorithm = 6;
+      configuration.areaAlgorithm = 0;
+      configuration.substructure = i;
+      configurations.push_back(configuration);
+    }
+
+    cout << setw(6) << "pileup" << "  " << left << setw(28) << "configuration" << right;
+    cout << setw(8) << "events" << setw(12) << "mean [ms]";
+    cout << setw(12) << "50% [ms]" << setw(12) << "90% [ms]" << setw(12) << "99% [ms]" << endl;
+
+    for(itInputs = inputs.begin(); itInputs != inputs.end(); ++itInputs)
+    {
+      for(itConfigurations = configurations.begin(); itConfigurations != configurations.end(); ++itConfigurations)
+      {
+        if(itConfigurations->name.find(selection) == string::npos) continue;
+        RunConfiguration(*itConfigurations, *itInputs, repeat);
+      }
+    }
+  }
+  catch(runtime_error &e)
+  {
+    cerr << "** ERROR: " << e.what() << endl;
+    return 1;
+  }
+
+  return 0;
+}
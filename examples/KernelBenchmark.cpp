@@ -0,0 +1,451 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ *  Times the inner kernels of the modules on synthetic inputs.
+ *
+ *  Every kernel is run on inputs of each multiplicity, with particles
+ *  drawn with a fixed seed, flat in eta and phi and falling in pt:
+ *
+ *    KernelBenchmark [-r repeat] [-m 100,1000,10000] [-k name]
+ *
+ *  With -k only the kernels whose name contains the given text are run.
+ *
+ *  For each kernel and multiplicity the mean and the 50% and 99%
+ *  percentiles of the time per call are printed in microseconds, a call
+ *  covering the whole input, e.g. all the candidates of one event.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <chrono>
+#include <functional>
+
+#include "TObjArray.h"
+#include "TRandom3.h"
+#include "TMath.h"
+#include "TVector3.h"
+#include "TLorentzVector.h"
+
+#include "classes/CandidateSpan.h"
+#include "classes/DelphesClasses.h"
+#include "classes/DelphesFactory.h"
+#include "classes/DelphesFormula.h"
+#include "classes/DelphesTowerHits.h"
+#include "classes/DelphesEtaPhiGrid.h"
+
+#include "classes/flavortag/hl_vars.hh"
+
+#ifndef NO_RAVE
+#include "classes/flavortag/RaveConverter.hh"
+#endif
+
+#include "external/h5/OneDimBuffer.hh"
+#include "external/h5/h5container.hh"
+
+#include "H5Cpp.h"
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+
+struct KernelInput
+{
+  KernelInput(Int_t multiplicity);
+  ~KernelInput();
+
+  DelphesFactory *factory;
+  TObjArray *particles;
+  TObjArray *jets;
+  vector< Candidate * > tracks;
+};
+
+static const Double_t kEtaMax = 4.0;
+static const Double_t kDeltaR = 0.5;
+static const Int_t kConstituents = 20;
+static const Int_t kJets = 10;
+
+// CMS like efficiency formula, all of it native
+static const char *kEfficiency =
+  "(pt <= 0.1) * (0.00) + "
+  "(abs(eta) <= 1.5) * (pt > 0.1 && pt <= 1.0) * (0.70) + "
+  "(abs(eta) <= 1.5) * (pt > 1.0) * (0.95) + "
+  "(abs(eta) > 1.5 && abs(eta) <= 2.5) * (pt > 0.1 && pt <= 1.0) * (0.60) + "
+  "(abs(eta) > 1.5 && abs(eta) <= 2.5) * (pt > 1.0) * (0.85) + "
+  "(abs(eta) > 2.5) * (0.00)";
+
+static const char *kResolution =
+  "(abs(eta) <= 3.0) * sqrt(energy^2*0.007^2 + energy*0.07^2 + 0.35^2) + "
+  "(abs(eta) > 3.0 && abs(eta) <= 5.0) * sqrt(energy^2*0.107^2 + energy*2.08^2)";
+
+//------------------------------------------------------------------------------
+
+KernelInput::KernelInput(Int_t multiplicity)
+{
+  TRandom3 random(12345);
+  Candidate *candidate, *track, *jet;
+  Double_t pt, eta, phi, theta;
+  Int_t i, j;
+
+  factory = new DelphesFactory("KernelFactory");
+  particles = factory->NewPermanentArray();
+  jets = factory->NewPermanentArray();
+
+  for(i = 0; i < multiplicity; ++i)
+  {
+    pt = 0.5 + random.Exp(5.0);
+    eta = random.Uniform(-kEtaMax, kEtaMax);
+    phi = random.Uniform(-TMath::Pi(), TMath::Pi());
+
+    candidate = factory->NewCandidate();
+    candidate->Momentum.SetPtEtaPhiM(pt, eta, phi, 0.13957);
+    candidate->Position.SetPtEtaPhiE(1.0, eta, phi, 0.0);
+    candidate->PID = (i % 3 == 0) ? 22 : 211;
+    candidate->Charge = (i % 3 == 0) ? 0 : (i % 2 ? 1 : -1);
+    candidate->IsRecoPU = (i % 5 == 0);
+    particles->Add(candidate);
+  }
+
+  // tracks made from the charged particles, with their perigee parameters
+  for(i = 0; i < multiplicity; ++i)
+  {
+    candidate = static_cast<Candidate *>(particles->At(i));
+    if(candidate->Charge == 0) continue;
+
+    theta = candidate->Momentum.Theta();
+
+    track = factory->NewCandidate();
+    track->Momentum = candidate->Momentum;
+    track->Position = candidate->Position;
+    track->Charge = candidate->Charge;
+    track->AddCandidate(candidate);
+
+    memset(track->trkPar, 0, sizeof(track->trkPar));
+    memset(track->trkCov, 0, sizeof(track->trkCov));
+    track->trkPar[TrackParam::D0] = random.Gaus(0.0, 0.05);
+    track->trkPar[TrackParam::Z0] = random.Gaus(0.0, 0.1);
+    track->trkPar[TrackParam::PHI] = candidate->Momentum.Phi();
+    track->trkPar[TrackParam::THETA] = theta;
+    track->trkPar[TrackParam::QOVERP] = candidate->Charge/candidate->Momentum.P();
+    track->trkCov[TrackParam::D0D0] = 0.01*0.01;
+    track->trkCov[TrackParam::Z0Z0] = 0.02*0.02;
+    track->trkCov[TrackParam::PHIPHI] = 1.0E-6;
+    track->trkCov[TrackParam::THETATHETA] = 1.0E-6;
+    track->trkCov[TrackParam::QOVERPQOVERP] = 1.0E-4*track->trkPar[TrackParam::QOVERP]*track->trkPar[TrackParam::QOVERP];
+    tracks.push_back(track);
+  }
+
+  // jets sharing their constituents with the tracks
+  for(i = 0; i < kJets; ++i)
+  {
+    jet = factory->NewCandidate();
+    for(j = 0; j < kConstituents && !tracks.empty(); ++j)
+    {
+      candidate = tracks[random.Integer(tracks.size())];
+      jet->AddCandidate(candidate);
+      jet->Momentum += candidate->Momentum;
+    }
+    jets->Add(jet);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+KernelInput::~KernelInput()
+{
+  delete factory;
+}
+
+//------------------------------------------------------------------------------
+
+double Percentile(const vector< double > &sorted, double fraction)
+{
+  size_t i;
+
+  if(sorted.empty()) return 0.0;
+  i = min(size_t(fraction*sorted.size()), sorted.size() - 1);
+  return sorted[i];
+}
+
+//------------------------------------------------------------------------------
+
+void RunKernel(const string &name, Int_t multiplicity, Int_t repeat, const function< void() > &kernel)
+{
+  vector< double > times;
+  double sum, value;
+  Int_t i;
+
+  chrono::steady_clock::time_point start;
+
+  // one call to warm up the caches and the lazy initialisations
+  kernel();
+
+  sum = 0.0;
+  for(i = 0; i < repeat; ++i)
+  {
+    start = chrono::steady_clock::now();
+    kernel();
+    value = chrono::duration< double, micro >(chrono::steady_clock::now() - start).count();
+    times.push_back(value);
+    sum += value;
+  }
+
+  sort(times.begin(), times.end());
+
+  cout << left << setw(34) << name << right << setw(8) << multiplicity;
+  cout << fixed << setprecision(3);
+  cout << setw(14) << (times.empty() ? 0.0 : sum/times.size());
+  cout << setw(14) << Percentile(times, 0.50);
+  cout << setw(14) << Percentile(times, 0.99) << endl;
+}
+
+//------------------------------------------------------------------------------
+
+void RunKernels(Int_t multiplicity, Int_t repeat, const string &selection)
+{
+  KernelInput input(multiplicity);
+  DelphesFactory factory("BenchmarkFactory"), arenaFactory("BenchmarkArenaFactory");
+  DelphesFormula efficiency("Efficiency", kEfficiency), resolution("Resolution", kResolution);
+  DelphesFormulaBatch batch;
+  DelphesTowerHits towerHits;
+  DelphesEtaPhiGrid grid(kDeltaR);
+  vector< const DelphesEtaPhiGrid::Entry * > objects;
+  vector< Double_t > etaBins;
+  vector< vector< Double_t > * > phiBins;
+  vector< TrackParameters > trackParameters;
+  TrackParameterBlock trackBlock;
+  HighLevelTracking highLevelTracking;
+  TVector3 jetAxis;
+  vector< float > values;
+  Candidate *candidate;
+  Double_t result, sumPt;
+  Int_t i, j;
+
+  const Int_t n = input.particles->GetEntriesFast();
+
+  arenaFactory.SetCandidateArena(kTRUE);
+
+  // 0.087 x 2pi/72 towers up to |eta| = 5
+  for(i = -57; i <= 57; ++i)
+  {
+    etaBins.push_back(i*5.0/57);
+    phiBins.push_back(new vector< Double_t >());
+    for(j = -36; j <= 36; ++j) phiBins.back()->push_back(j*TMath::Pi()/36);
+  }
+  towerHits.Init(etaBins, phiBins);
+
+  batch.Resize(n);
+  CandidateSpan particles(input.particles);
+  for(i = 0; i < n; ++i)
+  {
+    const TLorentzVector &momentum = particles[i]->Momentum;
+    batch.pt[i] = momentum.Pt();
+    batch.eta[i] = momentum.Eta();
+    batch.phi[i] = momentum.Phi();
+    batch.energy[i] = momentum.E();
+  }
+
+  for(Candidate *track : input.tracks)
+  {
+    trackParameters.push_back(TrackParameters(track->trkPar, track->trkCov));
+  }
+  trackBlock = TrackParameterBlock(trackParameters);
+  jetAxis = static_cast<Candidate *>(input.jets->At(0))->Momentum.Vect();
+
+  values.resize(n);
+  for(i = 0; i < n; ++i) values[i] = batch.pt[i];
+
+  vector< pair< string, function< void() > > > kernels;
+
+  kernels.push_back(make_pair(string("DelphesFactory::NewCandidate"), [&]() {
+    for(i = 0; i < n; ++i) factory.NewCandidate();
+    factory.Clear();
+  }));
+
+  kernels.push_back(make_pair(string("DelphesFactory::NewCandidate arena"), [&]() {
+    for(i = 0; i < n; ++i) arenaFactory.NewCandidate();
+    arenaFactory.Clear();
+  }));
+
+  kernels.push_back(make_pair(string("Candidate::Overlaps"), [&]() {
+    for(Candidate *jet : CandidateSpan(input.jets))
+    {
+      for(Candidate *track : input.tracks) jet->Overlaps(track);
+    }
+  }));
+
+  kernels.push_back(make_pair(string("DelphesFormula::Eval"), [&]() {
+    result = 0.0;
+    for(i = 0; i < n; ++i)
+    {
+      result += efficiency.Eval(batch.pt[i], batch.eta[i], batch.phi[i], batch.energy[i]);
+      result += resolution.Eval(batch.pt[i], batch.eta[i], batch.phi[i], batch.energy[i]);
+    }
+  }));
+
+  kernels.push_back(make_pair(string("DelphesFormula::Eval batch"), [&]() {
+    efficiency.Eval(batch);
+    resolution.Eval(batch);
+  }));
+
+  kernels.push_back(make_pair(string("Calorimeter tower binning"), [&]() {
+    towerHits.Clear();
+    for(i = 0; i < n; ++i)
+    {
+      const TLorentzVector &position = particles[i]->Position;
+      towerHits.Add(position.Eta(), position.Phi(), i % 3, i);
+    }
+    towerHits.GetHits();
+  }));
+
+  kernels.push_back(make_pair(string("Isolation cone sums"), [&]() {
+    grid.Fill(input.particles);
+    for(i = 0; i < n; i += 10)
+    {
+      candidate = particles[i];
+      grid.Find(candidate->Momentum.Eta(), candidate->Momentum.Phi(), kDeltaR, objects);
+      sumPt = 0.0;
+      for(const DelphesEtaPhiGrid::Entry *entry : objects) sumPt += entry->pt;
+    }
+  }));
+
+#ifndef NO_RAVE
+  RaveConverter converter(3.8);
+  kernels.push_back(make_pair(string("RaveConverter::getRaveTracks"), [&]() {
+    converter.clearCache();
+    converter.getRaveTracks(input.tracks);
+  }));
+#endif
+
+  kernels.push_back(make_pair(string("HighLevelTracking::fill"), [&]() {
+    highLevelTracking.fill(jetAxis, trackParameters);
+  }));
+
+  kernels.push_back(make_pair(string("HighLevelTracking::fill block"), [&]() {
+    highLevelTracking.fill(jetAxis, trackBlock);
+  }));
+
+  // the file lives in memory, only the buffering and HDF5 are timed
+  H5::FileAccPropList access;
+  access.setCore(1 << 20, false);
+  H5::H5File file("KernelBenchmark.h5", H5F_ACC_TRUNC, H5::FileCreatPropList::DEFAULT, access);
+  OneDimBuffer< double > buffer(file, "values", H5::PredType::NATIVE_DOUBLE, 1000);
+
+  kernels.push_back(make_pair(string("OneDimBuffer::push_back/flush"), [&]() {
+    for(i = 0; i < n; ++i) buffer.push_back(batch.pt[i]);
+    buffer.flush();
+  }));
+
+  kernels.push_back(make_pair(string("h5::vector construction"), [&]() {
+    h5::vector< float > flat(values);
+  }));
+
+  kernels.push_back(make_pair(string("h5::vector nested push_back"), [&]() {
+    h5::vector< h5::vector< float > > nested;
+    for(i = 0; i < n; i += kConstituents)
+    {
+      nested.push_back(h5::vector< float >(vector< float >(values.begin() + i, values.begin() + min(i + kConstituents, n))));
+    }
+  }));
+
+  for(auto &kernel : kernels)
+  {
+    if(kernel.first.find(selection) == string::npos) continue;
+    RunKernel(kernel.first, multiplicity, repeat, kernel.second);
+  }
+
+  buffer.close();
+
+  for(vector< Double_t > *bins : phiBins) delete bins;
+}
+
+//------------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+  const char *appName = "KernelBenchmark";
+  int i, repeat = 100;
+  string selection;
+  stringstream list;
+  string value;
+  vector< Int_t > multiplicities;
+  vector< Int_t >::const_iterator itMultiplicities;
+
+  for(i = 1; i < argc && argv[i][0] == '-'; ++i)
+  {
+    if(strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+    {
+      repeat = max(atoi(argv[++i]), 1);
+    }
+    else if(strcmp(argv[i], "-m") == 0 && i + 1 < argc)
+    {
+      list.str(argv[++i]);
+      while(getline(list, value, ',')) multiplicities.push_back(max(atoi(value.c_str()), 1));
+    }
+    else if(strcmp(argv[i], "-k") == 0 && i + 1 < argc)
+    {
+      selection = argv[++i];
+    }
+    else
+    {
+      cout << " Usage: " << appName << " [-r repeat] [-m multiplicity,...] [-k name]" << endl;
+      cout << " repeat - number of timed calls per kernel, 100 by default," << endl;
+      cout << " multiplicity - numbers of input particles, 100,1000,10000 by default," << endl;
+      cout << " name - run only the kernels containing this text." << endl;
+      return 1;
+    }
+  }
+
+  if(multiplicities.empty())
+  {
+    multiplicities.push_back(100);
+    multiplicities.push_back(1000);
+    multiplicities.push_back(10000);
+  }
+
+  try
+  {
+    cout << left << setw(34) << "kernel" << right << setw(8) << "inputs";
+    cout << setw(14) << "mean [us]" << setw(14) << "50% [us]" << setw(14) << "99% [us]" << endl;
+
+    for(itMultiplicities = multiplicities.begin(); itMultiplicities != multiplicities.end(); ++itMultiplicities)
+    {
+      RunKernels(*itMultiplicities, repeat, selection);
+    }
+  }
+  catch(runtime_error &e)
+  {
+    cerr << "** ERROR: " << e.what() << endl;
+    return 1;
+  }
+  catch(H5::Exception &e)
+  {
+    cerr << "** ERROR: " << e.getDetailMsg() << endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -17,11 +17,62 @@
 #include <string>
 #include <stdexcept>
 #include <sstream>
+#include <set>
+#include <vector>
+
+#include <string.h>
 
 using namespace std;
 
 static Tcl_ObjCmdProc ModuleObjCmdProc;
 
+// first line of the cards written by WriteCompiledFile
+static const char kCompiledHeader[] = "# ExRootConfReader compiled card 1\n";
+
+// names of all the scalar variables of all the namespaces
+static const char kListVariables[] =
+  "proc ExRootConfReaderVariables {namespace} {\n"
+  "  set result {}\n"
+  "  if {$namespace == \"::\"} {set pattern ::*} else {set pattern ${namespace}::*}\n"
+  "  foreach name [info vars $pattern] {\n"
+  "    if {![array exists $name]} {lappend result $name}\n"
+  "  }\n"
+  "  foreach child [namespace children $namespace] {\n"
+  "    set result [concat $result [ExRootConfReaderVariables $child]]\n"
+  "  }\n"
+  "  return $result\n"
+  "}\n";
+
+static void ListVariables(Tcl_Interp *interp, vector<string> &names)
+{
+  stringstream message;
+  Tcl_Obj *result, **elements;
+  int i, size;
+
+  names.clear();
+
+  if(Tcl_GlobalEval(interp, const_cast<char *>(kListVariables)) != TCL_OK ||
+     Tcl_GlobalEval(interp, const_cast<char *>("ExRootConfReaderVariables ::")) != TCL_OK)
+  {
+    message << "can't list the configuration variables" << endl;
+    message << Tcl_GetStringResult(interp);
+    throw runtime_error(message.str());
+  }
+
+  result = Tcl_GetObjResult(interp);
+  if(Tcl_ListObjGetElements(interp, result, &size, &elements) != TCL_OK)
+  {
+    throw runtime_error("can't list the configuration variables");
+  }
+
+  for(i = 0; i < size; ++i)
+  {
+    names.push_back(Tcl_GetStringFromObj(elements[i], 0));
+  }
+
+  Tcl_GlobalEval(interp, const_cast<char *>("rename ExRootConfReaderVariables {}"));
+}
+
 //------------------------------------------------------------------------------
 
 ExRootConfReader::ExRootConfReader(std::streambuf* buf) :
@@ -45,6 +96,14 @@ ExRootConfReader::~ExRootConfReader()
 
 //------------------------------------------------------------------------------
 
+static map<string, string> &BuiltinCards()
+{
+  static map<string, string> cards;
+  return cards;
+}
+
+//------------------------------------------------------------------------------
+
 void ExRootConfReader::ReadFile(const char *fileName)
 {
 /*
@@ -57,6 +116,21 @@ void ExRootConfReader::ReadFile(const char *fileName)
 */
   stringstream message;
 
+  map<string, string>::const_iterator itBuiltin = BuiltinCards().find(fileName);
+  if(itBuiltin != BuiltinCards().end())
+  {
+    istringstream builtinStream(itBuiltin->second);
+    string builtinHeader(sizeof(kCompiledHeader) - 1, '\0');
+    builtinStream.read(&builtinHeader[0], builtinHeader.size());
+    if(!builtinStream || builtinHeader != kCompiledHeader)
+    {
+      message << "built-in configuration " << fileName << " is not a compiled card";
+      throw runtime_error(message.str());
+    }
+    ReadCompiledFile(builtinStream, fileName);
+    return;
+  }
+
   ifstream inputFileStream(fileName, ios::in | ios::ate);
   if(!inputFileStream.is_open())
   {
@@ -67,6 +141,16 @@ void ExRootConfReader::ReadFile(const char *fileName)
   int file_length = inputFileStream.tellg();
   inputFileStream.seekg(0, ios::beg);
   inputFileStream.clear();
+
+  string header(sizeof(kCompiledHeader) - 1, '\0');
+  inputFileStream.read(&header[0], header.size());
+  if(inputFileStream && header == kCompiledHeader)
+  {
+    ReadCompiledFile(inputFileStream, fileName);
+    return;
+  }
+  inputFileStream.seekg(0, ios::beg);
+  inputFileStream.clear();
   char *cmdBuffer = new char[file_length];
   inputFileStream.read(cmdBuffer, file_length);
 
@@ -93,6 +177,133 @@ void ExRootConfReader::ReadFile(const char *fileName)
 
 //------------------------------------------------------------------------------
 
+void ExRootConfReader::AddBuiltinCard(const char *fileName, const char *text)
+{
+  BuiltinCards()[fileName] = text;
+}
+
+//------------------------------------------------------------------------------
+
+void ExRootConfReader::ReadCompiledFile(istream &in, const char *fileName)
+{
+  stringstream message;
+  string keyword, className, moduleName, name, value, script;
+  set<string> namespaces;
+  size_t nameLength, valueLength, end;
+
+  while(in >> keyword)
+  {
+    if(keyword == "module" && in >> className >> moduleName)
+    {
+      AddModule(className.c_str(), moduleName.c_str());
+      continue;
+    }
+
+    if(keyword != "variable" || !(in >> nameLength >> valueLength) || in.get() != '\n') break;
+
+    name.resize(nameLength);
+    value.resize(valueLength);
+    if(!in.read(&name[0], nameLength) || !in.read(&value[0], valueLength)) break;
+
+    // the namespace has to exist before a variable can be set in it
+    end = name.rfind("::");
+    if(end != string::npos && end > 0 && namespaces.insert(name.substr(0, end)).second)
+    {
+      script = "namespace eval " + name.substr(0, end) + " {}";
+      if(Tcl_GlobalEval(fTclInterp, const_cast<char *>(script.c_str())) != TCL_OK) break;
+    }
+
+    if(!Tcl_SetVar(fTclInterp, const_cast<char *>(name.c_str()), const_cast<char *>(value.c_str()), TCL_GLOBAL_ONLY | TCL_LEAVE_ERR_MSG)) break;
+  }
+
+  if(!in.eof())
+  {
+    message << "can't read compiled configuration file " << fileName;
+    throw runtime_error(message.str());
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void ExRootConfReader::WriteCompiledFile(const char *fileName)
+{
+  stringstream message;
+
+  ofstream file(fileName, ios::out | ios::binary);
+  if(!file.is_open())
+  {
+    message << "can't open compiled configuration file " << fileName;
+    throw runtime_error(message.str());
+  }
+
+  WriteCompiled(file);
+
+  file.close();
+  if(!file)
+  {
+    message << "can't write compiled configuration file " << fileName;
+    throw runtime_error(message.str());
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void ExRootConfReader::CopyFrom(ExRootConfReader *reader)
+{
+  stringstream buffer;
+  string header(sizeof(kCompiledHeader) - 1, '\0');
+
+  reader->WriteCompiled(buffer);
+  buffer.read(&header[0], header.size());
+  ReadCompiledFile(buffer, reader->GetName());
+}
+
+//------------------------------------------------------------------------------
+
+void ExRootConfReader::WriteCompiled(ostream &out)
+{
+  Tcl_Interp *interp;
+  vector<string> names, builtin;
+  vector<string>::const_iterator itNames;
+  set<string> skip;
+  ExRootTaskMap::const_iterator itModules;
+  const char *value;
+
+  // the variables of a new interpreter are left out, e.g. tcl_version
+  interp = Tcl_CreateInterp();
+  try
+  {
+    ListVariables(interp, builtin);
+  }
+  catch(runtime_error &e)
+  {
+    Tcl_DeleteInterp(interp);
+    throw;
+  }
+  Tcl_DeleteInterp(interp);
+  skip.insert(builtin.begin(), builtin.end());
+
+  ListVariables(fTclInterp, names);
+
+  out << kCompiledHeader;
+
+  for(itModules = fModules.begin(); itModules != fModules.end(); ++itModules)
+  {
+    out << "module " << itModules->second << ' ' << itModules->first << '\n';
+  }
+
+  for(itNames = names.begin(); itNames != names.end(); ++itNames)
+  {
+    if(skip.count(*itNames)) continue;
+    value = Tcl_GetVar(fTclInterp, const_cast<char *>(itNames->c_str()), TCL_GLOBAL_ONLY);
+    if(!value) continue;
+    out << "variable " << itNames->size() << ' ' << strlen(value) << '\n';
+    out << *itNames << value;
+  }
+}
+
+//------------------------------------------------------------------------------
+
 ExRootConfParam ExRootConfReader::GetParam(const char *name)
 {
   Tcl_Obj *object;
@@ -103,6 +314,20 @@ ExRootConfParam ExRootConfReader::GetParam(const char *name)
 
 //------------------------------------------------------------------------------
 
+void ExRootConfReader::SetParam(const char *name, const char *value)
+{
+  stringstream message;
+
+  if(!Tcl_SetVar(fTclInterp, const_cast<char *>(name), const_cast<char *>(value), TCL_GLOBAL_ONLY | TCL_LEAVE_ERR_MSG))
+  {
+    message << "can't set parameter '" << name << "'" << endl;
+    message << Tcl_GetStringResult(fTclInterp);
+    throw runtime_error(message.str());
+  }
+}
+
+//------------------------------------------------------------------------------
+
 int ExRootConfReader::GetInt(const char *name, int defaultValue, int index)
 {
   ExRootConfParam object = GetParam(name);
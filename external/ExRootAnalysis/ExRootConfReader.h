@@ -13,6 +13,7 @@
 
 #include <map>
 #include <utility>
+#include <istream>
 #include <ostream>
 
 struct Tcl_Obj;
@@ -50,8 +51,24 @@ public:
   ExRootConfReader(std::streambuf* = 0);
   ~ExRootConfReader();
 
+  // reads a Tcl card, or a card written by WriteCompiledFile, or the
+  // compiled card added under that name with AddBuiltinCard
   void ReadFile(const char *fileName);
 
+  // compiled card built into the executable, see card2cxx, to be called
+  // from static objects
+  static void AddBuiltinCard(const char *fileName, const char *text);
+
+  // writes the modules and the values of all the variables set so far,
+  // ReadFile then loads them without evaluating any Tcl
+  void WriteCompiledFile(const char *fileName);
+
+  void WriteCompiled(std::ostream &out);
+
+  // takes the modules and the variables of another reader, which can then
+  // be overridden with SetParam without changing the other reader
+  void CopyFrom(ExRootConfReader *reader);
+
   int GetInt(const char *name, int defaultValue, int index = -1);
   long GetLong(const char *name, long defaultValue, int index = -1);
   double GetDouble(const char *name, double defaultValue, int index = -1);
@@ -59,6 +76,10 @@ public:
   const char *GetString(const char *name, const char *defaultValue, int index = -1);
   ExRootConfParam GetParam(const char *name);
 
+  // overrides a parameter read from the configuration file, the name is
+  // given as to GetParam, for instance "PileUpMerger::MeanPileUp"
+  void SetParam(const char *name, const char *value);
+
   const ExRootTaskMap *GetModules() const { return &fModules; }
 
   void AddModule(const char *className, const char *moduleName);
@@ -67,6 +88,8 @@ public:
 
 private:
 
+  void ReadCompiledFile(std::istream &in, const char *fileName);
+
   Tcl_Interp *fTclInterp; //!
 
   ExRootTaskMap fModules; //!
@@ -15,6 +15,7 @@
 #include "TFolder.h"
 #include "TString.h"
 
+#include <chrono>
 #include <iostream>
 #include <iomanip>
 #include <stdexcept>
@@ -27,7 +28,7 @@ static const char *const kFINISH = "2";
 using namespace std;
 
 ExRootTask::ExRootTask() :
-  TTask("", ""), fFolder(0), fConfReader(0)
+  TTask("", ""), fFolder(0), fConfReader(0), fInitTime(0.0)
 {
 }
 
@@ -65,7 +66,9 @@ void ExRootTask::Exec(Option_t *option)
     sout << left;
     sout << setw(30) << "** INFO: initializing module";
     sout << setw(25) << GetName() << endl;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
     Init();
+    fInitTime = chrono::duration< Double_t >(chrono::steady_clock::now() - start).count();
   }
   else if(option == kPROCESS)
   {
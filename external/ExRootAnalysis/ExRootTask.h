@@ -50,6 +50,9 @@ public:
   ExRootConfParam GetParam(const char *name);
   const ExRootConfReader::ExRootTaskMap *GetModules();
 
+  // wall time of Init in seconds
+  Double_t GetInitTime() const { return fInitTime; }
+
   void SetFolder(TFolder *folder) { fFolder = folder; }
   void SetConfReader(ExRootConfReader *conf) { fConfReader = conf; }
 
@@ -66,6 +69,8 @@ private:
   TFolder *fFolder; //!
   ExRootConfReader *fConfReader; //!
 
+  Double_t fInitTime; //!
+
   ClassDef(ExRootTask, 1)
 };
 
@@ -23,8 +23,8 @@ using namespace std;
 
 //------------------------------------------------------------------------------
 
-ExRootTreeBranch::ExRootTreeBranch(const char *name, TClass *cl, TTree *tree) :
-  fSize(0), fCapacity(1), fData(0)
+ExRootTreeBranch::ExRootTreeBranch(const char *name, TClass *cl, TTree *tree, Int_t splitLevel) :
+  fSize(0), fCapacity(1), fTree(tree), fData(0)
 {
   stringstream message;
 //  cl->IgnoreTObjectStreamer();
@@ -38,7 +38,7 @@ ExRootTreeBranch::ExRootTreeBranch(const char *name, TClass *cl, TTree *tree) :
     fData->Clear();
     if(tree)
     {
-      tree->Branch(name, &fData, 64000);
+      tree->Branch(name, &fData, 64000, splitLevel);
       tree->Branch(TString(name) + "_size", &fSize, TString(name) + "_size/I");
     }
   }
@@ -81,6 +81,20 @@ TObject *ExRootTreeBranch::NewEntry()
 
 //------------------------------------------------------------------------------
 
+void ExRootTreeBranch::Reserve(Int_t capacity)
+{
+  if(!fData || fCapacity >= capacity) return;
+
+  fCapacity = capacity;
+
+  fData->ExpandCreateFast(fCapacity);
+
+  fData->Clear();
+  fData->ExpandCreateFast(fSize);
+}
+
+//------------------------------------------------------------------------------
+
 void ExRootTreeBranch::Clear()
 {
   fSize = 0;
@@ -89,3 +103,25 @@ void ExRootTreeBranch::Clear()
 
 //------------------------------------------------------------------------------
 
+void ExRootTreeBranch::Shrink(Int_t capacity)
+{
+  TClonesArray *data;
+
+  if(!fData || fTree || fSize > 0) return;
+
+  if(capacity < 1) capacity = 1;
+  if(fCapacity <= capacity) return;
+
+  // deleting the old array runs the destructors of all its entries
+  data = new TClonesArray(fData->GetClass(), capacity);
+  data->SetName(fData->GetName());
+  data->ExpandCreateFast(capacity);
+  data->Clear();
+
+  delete fData;
+  fData = data;
+  fCapacity = capacity;
+}
+
+//------------------------------------------------------------------------------
+
@@ -19,15 +19,26 @@ class ExRootTreeBranch
 {
 public:
 
-  ExRootTreeBranch(const char *name, TClass *cl, TTree *tree = 0);
+  ExRootTreeBranch(const char *name, TClass *cl, TTree *tree = 0, Int_t splitLevel = 99);
   ~ExRootTreeBranch();
 
   TObject *NewEntry();
   void Clear();
 
+  Int_t GetSize() const { return fSize; }
+  Int_t GetCapacity() const { return fCapacity; }
+
+  // grows the array to the given capacity at once, as NewEntry would
+  void Reserve(Int_t capacity);
+
+  // replaces the entries of a cleared branch by a new array of the given
+  // capacity, not for the branches of a tree that holds the array address
+  void Shrink(Int_t capacity);
+
 private:
 
   Int_t fSize, fCapacity; //!
+  TTree *fTree; //!
   TClonesArray *fData; //!
 };
 
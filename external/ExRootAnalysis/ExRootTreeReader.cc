@@ -12,9 +12,12 @@
 #include "TH2.h"
 #include "TStyle.h"
 #include "TCanvas.h"
+#include "TEnv.h"
+#include "TLeaf.h"
 #include "TClonesArray.h"
 #include "TBranchElement.h"
 
+#include <algorithm>
 #include <iostream>
 
 using namespace std;
@@ -22,7 +25,7 @@ using namespace std;
 //------------------------------------------------------------------------------
 
 ExRootTreeReader::ExRootTreeReader(TTree *tree) :
-  fChain(tree), fCurrentTree(-1)
+  fChain(tree), fCurrentTree(-1), fCacheSize(0)
 {
 }
 
@@ -40,13 +43,10 @@ ExRootTreeReader::~ExRootTreeReader()
 
 //------------------------------------------------------------------------------
 
-Bool_t ExRootTreeReader::ReadEntry(Long64_t entry)
+Long64_t ExRootTreeReader::LoadTree(Long64_t entry)
 {
-  // Read contents of entry.
-  if(!fChain) return kFALSE;
-
-  Int_t treeEntry = fChain->LoadTree(entry);
-  if(treeEntry < 0) return kFALSE;
+  Long64_t treeEntry = fChain->LoadTree(entry);
+  if(treeEntry < 0) return treeEntry;
 
   if(fChain->IsA() == TChain::Class())
   {
@@ -58,6 +58,19 @@ Bool_t ExRootTreeReader::ReadEntry(Long64_t entry)
     }
   }
 
+  return treeEntry;
+}
+
+//------------------------------------------------------------------------------
+
+Bool_t ExRootTreeReader::ReadEntry(Long64_t entry)
+{
+  // Read contents of entry.
+  if(!fChain) return kFALSE;
+
+  Long64_t treeEntry = LoadTree(entry);
+  if(treeEntry < 0) return kFALSE;
+
   TBranchMap::iterator itBranchMap;
   TBranch *branch;
 
@@ -75,6 +88,24 @@ Bool_t ExRootTreeReader::ReadEntry(Long64_t entry)
 
 //------------------------------------------------------------------------------
 
+Bool_t ExRootTreeReader::ReadBranch(const char *branchName, Long64_t entry)
+{
+  if(!fChain) return kFALSE;
+
+  TBranchMap::iterator itBranchMap = fBranchMap.find(branchName);
+  if(itBranchMap == fBranchMap.end() || !itBranchMap->second.first) return kFALSE;
+
+  Long64_t treeEntry = LoadTree(entry);
+  if(treeEntry < 0) return kFALSE;
+
+  // LoadTree updates the branch pointer when the chain moves to a new file
+  itBranchMap->second.first->GetEntry(treeEntry);
+
+  return kTRUE;
+}
+
+//------------------------------------------------------------------------------
+
 TClonesArray *ExRootTreeReader::UseBranch(const char *branchName)
 {
   TClonesArray *array = 0;
@@ -103,6 +134,7 @@ TClonesArray *ExRootTreeReader::UseBranch(const char *branchName)
           array->SetName(branchName);
           fBranchMap.insert(make_pair(branchName, make_pair(branch, array)));
           branch->SetAddress(&array);
+          AddBranchToCache(branchName);
         }
       }
     }
@@ -140,8 +172,119 @@ Bool_t ExRootTreeReader::Notify()
       cout << "** WARNING: cannot get branch '" << itBranchMap->first << "'" << endl;
     }
   }
+
+  map<TString, TBranch*>::iterator itLeafMap;
+  for(itLeafMap = fLeafMap.begin(); itLeafMap != fLeafMap.end(); ++itLeafMap)
+  {
+    itLeafMap->second = fChain->GetBranch(itLeafMap->first);
+  }
+
   return kTRUE;
 }
 
 //------------------------------------------------------------------------------
 
+void ExRootTreeReader::SetCacheSize(Long64_t size, Bool_t prefetch)
+{
+  TBranchMap::iterator itBranchMap;
+
+  fCacheSize = size;
+  if(!fChain) return;
+
+  // read by TTreeCache when it is created
+  if(prefetch) gEnv->SetValue("TFile.AsyncPrefetching", 1);
+
+  fChain->SetCacheSize(size);
+  for(itBranchMap = fBranchMap.begin(); itBranchMap != fBranchMap.end(); ++itBranchMap)
+  {
+    AddBranchToCache(itBranchMap->first);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void ExRootTreeReader::AddBranchToCache(const char *branchName)
+{
+  if(!fChain || fCacheSize <= 0) return;
+
+  // the cache holds the branches in use from the first entry instead of
+  // learning them from the entries read
+  fChain->AddBranchToCache(branchName, kTRUE);
+  fChain->StopCacheLearningPhase();
+}
+
+//------------------------------------------------------------------------------
+
+Long64_t ExRootTreeReader::ReadLeaf(const char *leafName, Long64_t first, Long64_t last,
+  vector<Double_t> &values, vector<Long64_t> &offsets)
+{
+  map<TString, TBranch*>::iterator itLeafMap;
+  Long64_t entry, treeEntry;
+  TBranch *branch;
+  TLeaf *leaf;
+  TString branchName;
+  Int_t i, size;
+
+  values.clear();
+  offsets.clear();
+
+  if(!fChain) return 0;
+
+  itLeafMap = fLeafMap.find(leafName);
+  if(itLeafMap == fLeafMap.end())
+  {
+    // the leaf is read into the objects of its branch
+    branchName = leafName;
+    if(branchName.Index(".") != kNPOS) branchName.Resize(branchName.Index("."));
+    if(fBranchMap.find(branchName) == fBranchMap.end() && !UseBranch(branchName)) return 0;
+
+    branch = fChain->GetBranch(leafName);
+    if(!branch)
+    {
+      cout << "** WARNING: cannot access leaf '" << leafName << "'" << endl;
+      return 0;
+    }
+    itLeafMap = fLeafMap.insert(make_pair(TString(leafName), branch)).first;
+    AddBranchToCache(leafName);
+  }
+
+  for(entry = first; entry < last; ++entry)
+  {
+    treeEntry = LoadTree(entry);
+    if(treeEntry < 0) break;
+
+    branch = itLeafMap->second;
+    if(!branch) break;
+
+    branch->GetEntry(treeEntry);
+    leaf = static_cast<TLeaf*>(branch->GetListOfLeaves()->At(0));
+
+    offsets.push_back(values.size());
+    size = leaf->GetLen();
+    for(i = 0; i < size; ++i)
+    {
+      values.push_back(leaf->GetValue(i));
+    }
+  }
+
+  offsets.push_back(values.size());
+
+  return entry - first;
+}
+
+//------------------------------------------------------------------------------
+
+void ExRootTreeReader::CopyValues(const vector<Double_t> &values, Double_t *buffer)
+{
+  copy(values.begin(), values.end(), buffer);
+}
+
+//------------------------------------------------------------------------------
+
+void ExRootTreeReader::CopyOffsets(const vector<Long64_t> &offsets, Long_t *buffer)
+{
+  copy(offsets.begin(), offsets.end(), buffer);
+}
+
+//------------------------------------------------------------------------------
+
@@ -15,6 +15,7 @@
 #include "TFile.h"
 
 #include <map>
+#include <vector>
 
 class ExRootTreeReader : public TNamed
 {
@@ -28,12 +29,35 @@ public :
   Long64_t GetEntries() const { return fChain ? static_cast<Long64_t>(fChain->GetEntries()) : 0; }
   Bool_t ReadEntry(Long64_t entry);
 
+  // reads the entry for one branch in use, the arrays of the other
+  // branches keep their contents
+  Bool_t ReadBranch(const char *branchName, Long64_t entry);
+
   TClonesArray *UseBranch(const char *branchName);
 
+  // reads the branches in use through a TTreeCache of size bytes, filled
+  // in the background with prefetch, zero turns the cache off
+  void SetCacheSize(Long64_t size, Bool_t prefetch = kFALSE);
+
+  // values of one leaf, e.g. "Jet.PT", for the entries from first to last
+  // excluded, without reading the other leaves of its branch, offsets gets
+  // the index of the first value of every entry and the number of values,
+  // returns the number of entries read
+  Long64_t ReadLeaf(const char *leafName, Long64_t first, Long64_t last,
+    std::vector<Double_t> &values, std::vector<Long64_t> &offsets);
+
+  // copy the result of ReadLeaf to arrays of the caller large enough to
+  // hold it, such as numpy arrays in python
+  static void CopyValues(const std::vector<Double_t> &values, Double_t *buffer);
+  static void CopyOffsets(const std::vector<Long64_t> &offsets, Long_t *buffer);
+
 private:
 
   Bool_t Notify();
 
+  Long64_t LoadTree(Long64_t entry);
+  void AddBranchToCache(const char *branchName);
+
   TTree *fChain; //! pointer to the analyzed TTree or TChain
   Int_t fCurrentTree; //! current Tree number in a TChain
 
@@ -41,6 +65,10 @@ private:
 
   TBranchMap fBranchMap; //!
 
+  std::map<TString, TBranch*> fLeafMap; //!
+
+  Long64_t fCacheSize; //!
+
   ClassDef(ExRootTreeReader, 1)
 };
 
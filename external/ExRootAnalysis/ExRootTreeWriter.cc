@@ -11,18 +11,48 @@
 #include "ExRootAnalysis/ExRootTreeBranch.h"
 
 #include "TROOT.h"
+#include "RVersion.h"
 #include "TFile.h"
 #include "TTree.h"
+#include "TBranch.h"
 #include "TClonesArray.h"
 
 #include <iostream>
 #include <stdexcept>
 #include <sstream>
 
+#include <string.h>
+
 using namespace std;
 
+//------------------------------------------------------------------------------
+
+template<typename T>
+static vector<T> *FindVector(map<string, vector<T>*> &vectors, const char *name)
+{
+  typename map<string, vector<T>*>::iterator itVectors = vectors.find(name);
+  return itVectors != vectors.end() ? itVectors->second : 0;
+}
+
+//------------------------------------------------------------------------------
+
+template<typename T>
+static void ClearVectors(map<string, vector<T>*> &vectors, bool release)
+{
+  typename map<string, vector<T>*>::iterator itVectors;
+  for(itVectors = vectors.begin(); itVectors != vectors.end(); ++itVectors)
+  {
+    if(release) delete itVectors->second;
+    else itVectors->second->clear();
+  }
+}
+
+//------------------------------------------------------------------------------
+
 ExRootTreeWriter::ExRootTreeWriter(TFile *file, const char *treeName) :
-  fFile(file), fTree(0), fTreeName(treeName)
+  fFile(file), fTree(0), fRolloverFile(0), fTreeName(treeName), fSharedBranches(false), fCompressionThreads(0),
+  fSplitLevel(99), fCompressionSettings(-1), fAutoFlush(-30000000), fAutoSave(10000000),
+  fMaxEvents(0), fMaxBytes(0), fFileEvents(0), fClosedBytes(0), fFileNumber(0), fRollover(false)
 {
 }
 
@@ -37,31 +67,207 @@ ExRootTreeWriter::~ExRootTreeWriter()
   }
 
   if(fTree) delete fTree;
+
+  // the branches of the deleted tree pointed to the vectors
+  ClearVectors(fFloatBranches, true);
+  ClearVectors(fIntBranches, true);
+
+  if(fRolloverFile)
+  {
+    fRolloverFile->Close();
+    delete fRolloverFile;
+  }
 }
 
 //------------------------------------------------------------------------------
 
 ExRootTreeBranch *ExRootTreeWriter::NewBranch(const char *name, TClass *cl)
 {
+  map<string, ExRootTreeBranch*>::iterator itBranchNames;
+  if(fSharedBranches)
+  {
+    itBranchNames = fBranchNames.find(name);
+    if(itBranchNames != fBranchNames.end()) return itBranchNames->second;
+  }
   if(!fTree) fTree = NewTree();
-  ExRootTreeBranch *branch = new ExRootTreeBranch(name, cl, fTree);
+  ExRootTreeBranch *branch = new ExRootTreeBranch(name, cl, fTree, fSplitLevel);
+  if(fTree && fCompressionSettings >= 0)
+  {
+    SetBranchCompression(fTree->GetBranch(name));
+    SetBranchCompression(fTree->GetBranch(TString(name) + "_size"));
+  }
   fBranches.insert(branch);
+  fBranchNames[name] = branch;
   return branch;
 }
 
 //------------------------------------------------------------------------------
 
+vector<float> *ExRootTreeWriter::NewFloatBranch(const char *name)
+{
+  vector<float> *data = FindVector(fFloatBranches, name);
+  if(data) return data;
+  if(!fTree) fTree = NewTree();
+  data = new vector<float>;
+  if(fTree)
+  {
+    fTree->Branch(name, data, 64000, fSplitLevel);
+    if(fCompressionSettings >= 0) SetBranchCompression(fTree->GetBranch(name));
+  }
+  fFloatBranches[name] = data;
+  return data;
+}
+
+//------------------------------------------------------------------------------
+
+vector<int> *ExRootTreeWriter::NewIntBranch(const char *name)
+{
+  vector<int> *data = FindVector(fIntBranches, name);
+  if(data) return data;
+  if(!fTree) fTree = NewTree();
+  data = new vector<int>;
+  if(fTree)
+  {
+    fTree->Branch(name, data, 64000, fSplitLevel);
+    if(fCompressionSettings >= 0) SetBranchCompression(fTree->GetBranch(name));
+  }
+  fIntBranches[name] = data;
+  return data;
+}
+
+//------------------------------------------------------------------------------
+
+void ExRootTreeWriter::SetCompressionThreads(int nThreads)
+{
+  fCompressionThreads = nThreads;
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,10,0) && defined(R__USE_IMT)
+  if(nThreads > 0 && !ROOT::IsImplicitMTEnabled()) ROOT::EnableImplicitMT(nThreads);
+  if(fTree) fTree->SetImplicitMT(nThreads > 0);
+#else
+  if(nThreads > 0)
+  {
+    cerr << "** WARNING: ROOT is built without implicit multi-threading, the output is compressed on one thread" << endl;
+    fCompressionThreads = 0;
+  }
+#endif
+}
+
+//------------------------------------------------------------------------------
+
+void ExRootTreeWriter::SetBasketSize(const char *branchName, int size)
+{
+  if(!fTree) return;
+  fTree->SetBasketSize(branchName, size);
+  if(strcmp(branchName, "*") != 0) fTree->SetBasketSize(TString(branchName) + ".*", size);
+}
+
+//------------------------------------------------------------------------------
+
+void ExRootTreeWriter::SetCompressionSettings(int settings)
+{
+  TBranch *branch;
+
+  fCompressionSettings = settings;
+  if(fFile) fFile->SetCompressionSettings(settings);
+  if(!fTree) return;
+
+  TIter itBranches(fTree->GetListOfBranches());
+  while((branch = static_cast<TBranch *>(itBranches.Next())))
+  {
+    SetBranchCompression(branch);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void ExRootTreeWriter::SetBranchCompression(TBranch *branch)
+{
+  // TBranch::SetCompressionSettings also sets the sub-branches
+  if(branch) branch->SetCompressionSettings(fCompressionSettings);
+}
+
+//------------------------------------------------------------------------------
+
+void ExRootTreeWriter::SetAutoFlush(Long64_t autoFlush)
+{
+  fAutoFlush = autoFlush;
+  if(fTree) fTree->SetAutoFlush(autoFlush);
+}
+
+//------------------------------------------------------------------------------
+
+void ExRootTreeWriter::SetAutoSave(Long64_t autoSave)
+{
+  fAutoSave = autoSave;
+  if(fTree) fTree->SetAutoSave(autoSave);
+}
+
+//------------------------------------------------------------------------------
+
 void ExRootTreeWriter::Fill()
 {
-  if(fTree) fTree->Fill();
+  TFile *file;
+
+  if(!fTree) return;
+
+  // the rollover waits for the next event, so that no empty file is left
+  // behind when the last event fills up a file
+  if(fRollover) ChangeFile();
+
+  fTree->Fill();
+  ++fFileEvents;
+
+  file = fTree->GetCurrentFile();
+  if(fMaxEvents > 0 && fFileEvents >= fMaxEvents) fRollover = true;
+  if(fMaxBytes > 0 && file && file->GetEND() >= fMaxBytes) fRollover = true;
 }
 
 //------------------------------------------------------------------------------
 
 void ExRootTreeWriter::Write()
 {
-  fFile = fTree ? fTree->GetCurrentFile() : 0;
-  if(fFile) fFile->Write();
+  TFile *file = fTree ? fTree->GetCurrentFile() : 0;
+  if(file) file->Write();
+}
+
+//------------------------------------------------------------------------------
+
+void ExRootTreeWriter::ChangeFile()
+{
+  TFile *file = fTree->GetCurrentFile();
+  TDirectory *dir = gDirectory;
+  TFile *newFile;
+  TString name;
+  stringstream message;
+
+  // same as TTree::ChangeFile, but the file of the caller is kept and the
+  // new files are named after the first one
+  name = GetFileName(GetFirstFileName(), fFileNumber + 1);
+
+  file->cd();
+  file->Write();
+  fTree->Reset();
+
+  newFile = TFile::Open(name, "RECREATE", "", fCompressionSettings >= 0 ? fCompressionSettings : file->GetCompressionSettings());
+  dir->cd();
+
+  if(!newFile || newFile->IsZombie())
+  {
+    message << "can't open " << name;
+    throw runtime_error(message.str());
+  }
+
+  // moves the baskets of all the branches to the new file
+  fTree->SetDirectory(newFile);
+
+  file->Close();
+  fClosedBytes += file->GetBytesWritten();
+  if(file == fRolloverFile) delete file;
+
+  fRolloverFile = newFile;
+  fFileEvents = 0;
+  ++fFileNumber;
+  fRollover = false;
 }
 
 //------------------------------------------------------------------------------
@@ -73,6 +279,9 @@ void ExRootTreeWriter::Clear()
   {
     (*itBranches)->Clear();
   }
+
+  ClearVectors(fFloatBranches, false);
+  ClearVectors(fIntBranches, false);
 }
 
 //------------------------------------------------------------------------------
@@ -94,11 +303,55 @@ TTree *ExRootTreeWriter::NewTree()
   }
 
   tree->SetDirectory(fFile);
-  tree->SetAutoSave(10000000);  // autosave when 10 MB written
+  tree->SetAutoSave(fAutoSave);  // autosave when 10 MB written by default
+  tree->SetAutoFlush(fAutoFlush);
+
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,10,0) && defined(R__USE_IMT)
+  tree->SetImplicitMT(fCompressionThreads > 0);
+#endif
 
   return tree;
 }
 
+void ExRootTreeWriter::SetFileNumber(int number, const char *firstFileName)
+{
+  fFileNumber = number;
+  fFirstFileName = firstFileName;
+}
+
+//------------------------------------------------------------------------------
+
+TString ExRootTreeWriter::GetFileName(const char *firstFileName, int number)
+{
+  TString name = firstFileName;
+  Ssiz_t dot;
+
+  if(number == 0) return name;
+
+  dot = name.Last('.');
+  if(dot == kNPOS) dot = name.Length();
+  name.Insert(dot, TString::Format("_%d", number));
+  return name;
+}
+
+//------------------------------------------------------------------------------
+
+const char* ExRootTreeWriter::GetFirstFileName() const
+{
+  if(fFirstFileName.Length() > 0) return fFirstFileName;
+  return GetOutputFileName();
+}
+
+//------------------------------------------------------------------------------
+
+Long64_t ExRootTreeWriter::GetBytesWritten() const
+{
+  TFile *file = fTree ? fTree->GetCurrentFile() : fFile;
+  return fClosedBytes + (file ? file->GetBytesWritten() : 0);
+}
+
+//------------------------------------------------------------------------------
+
 const char* ExRootTreeWriter::GetOutputFileName() const
 {
   if (!fFile) return 0;
@@ -12,9 +12,13 @@
 #include "TNamed.h"
 
 #include <set>
+#include <map>
+#include <string>
+#include <vector>
 
 class TFile;
 class TTree;
+class TBranch;
 class TClass;
 class ExRootTreeBranch;
 
@@ -30,6 +34,60 @@ public:
 
   ExRootTreeBranch *NewBranch(const char *name, TClass *cl);
 
+  // with shared branches, NewBranch returns the existing branch of that
+  // name, so that several Delphes instances can fill the same tree
+  void SetSharedBranches(bool value) { fSharedBranches = value; }
+
+  // branch holding a vector of plain numbers per event, filled by the caller
+  // and emptied by Clear, the same name always returns the same vector
+  std::vector<float> *NewFloatBranch(const char *name);
+  std::vector<int> *NewIntBranch(const char *name);
+
+  // compresses the baskets of the branches on nThreads threads of ROOT's
+  // implicit multi-threading when the tree is filled, zero leaves it off
+  void SetCompressionThreads(int nThreads);
+
+  // split level of the branches created afterwards, see TTree::Branch
+  void SetSplitLevel(int splitLevel) { fSplitLevel = splitLevel; }
+
+  // basket size of the branch and of its sub-branches, or of all the
+  // branches created so far with "*"
+  void SetBasketSize(const char *branchName, int size);
+
+  // algorithm*100 + level, see ROOT::CompressionSettings, applied to the
+  // file and to all the branches, including those created later
+  void SetCompressionSettings(int settings);
+
+  // see TTree::SetAutoFlush and TTree::SetAutoSave
+  void SetAutoFlush(Long64_t autoFlush);
+  void SetAutoSave(Long64_t autoSave);
+
+  // once a file holds maxEvents events, or maxBytes bytes have been
+  // written to it, the next events go to a new file numbered from one,
+  // out.root is followed by out_1.root, out_2.root, ..., zero turns the
+  // limit off, every file but the last one is complete once it is closed
+  void SetMaxEventsPerFile(Long64_t maxEvents) { fMaxEvents = maxEvents; }
+  void SetMaxBytesPerFile(Long64_t maxBytes) { fMaxBytes = maxBytes; }
+
+  // number of the file the next event is written to, the other outputs
+  // can roll over with it to keep the same events in every file
+  int GetFileNumber() const { return fFileNumber + (fRollover ? 1 : 0); }
+
+  // true from the event filling up a file to the next one, which closes it
+  bool IsRolloverPending() const { return fRollover; }
+
+  // the file of the writer is the one numbered number among the files
+  // named after firstFileName, when a job resumes after a checkpoint
+  void SetFileNumber(int number, const char *firstFileName);
+
+  // out.root for number zero, out_1.root for one, ...
+  static TString GetFileName(const char *firstFileName, int number);
+
+  const char* GetFirstFileName() const;
+
+  // bytes written to all the files so far
+  Long64_t GetBytesWritten() const;
+
   void Clear();
   void Fill();
   void Write();
@@ -40,13 +98,34 @@ private:
 
   TTree *NewTree();
 
+  void SetBranchCompression(TBranch *branch);
+
+  void ChangeFile();
+
   TFile *fFile; //!
   TTree *fTree; //!
 
+  // file opened by the writer for the events after a rollover
+  TFile *fRolloverFile; //!
+
   TString fTreeName; //!
+  TString fFirstFileName; //!
 
   std::set<ExRootTreeBranch*> fBranches; //!
 
+  bool fSharedBranches; //!
+  int fCompressionThreads; //!
+  int fSplitLevel, fCompressionSettings; //!
+  Long64_t fAutoFlush, fAutoSave; //!
+  Long64_t fMaxEvents, fMaxBytes, fFileEvents; //!
+  Long64_t fClosedBytes; //!
+  int fFileNumber; //!
+  bool fRollover; //!
+  std::map<std::string, ExRootTreeBranch*> fBranchNames; //!
+
+  std::map<std::string, std::vector<float>*> fFloatBranches; //!
+  std::map<std::string, std::vector<int>*> fIntBranches; //!
+
   ClassDef(ExRootTreeWriter, 1)
 };
 
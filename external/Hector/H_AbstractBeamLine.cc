@@ -306,6 +306,22 @@ void H_AbstractBeamLine::calcMatrix() {
 	return;
 }
 
+void H_AbstractBeamLine::setElements(const vector<H_OpticalElement*> & newElements) {
+	/// @param newElements replace the elements of the beamline, in this order
+	///
+	/// Unlike add(), the elements are neither reordered nor completed with drifts.
+	vector<H_OpticalElement*>::iterator element_i;
+	for (element_i = elements.begin(); element_i<elements.end(); element_i++) {
+		delete (*element_i);
+	}
+	elements = newElements;
+	for (element_i = elements.begin(); element_i<elements.end(); element_i++) {
+		float a = (*element_i)->getS()+(*element_i)->getLength();
+		if (a > beam_length) beam_length = a;
+	}
+	calcMatrix();
+}
+
 float qh(float k) {
         float beta = (log((float)10.0))/0.05;
 		// put (std::log((float)10.0)) instead of log(10) to avoid compilation errors
@@ -52,6 +52,8 @@ class H_AbstractBeamLine {
 		void add(H_OpticalElement *);
 		void add(H_OpticalElement &);
 		//@}
+		///     Replaces the element list by an ordered one, including drifts, and computes the transport matrix
+		void setElements(const vector<H_OpticalElement*> &);
 		///     Returns the (float) length of the beamline
   		inline float getLength() const { return beam_length;};
 		///     Returns the (int) number of optics element of the beamline, including drifts
@@ -56,6 +56,13 @@ class H_Aperture {
 		inline int getType() const {return type;};
 		/// Returns the (string) type of the aperture
 		inline const string getTypeString() const { return aptypestring; }
+		/// Returns the geometrical sizes
+		//@{
+		inline float getX1() const {return x1;};
+		inline float getX2() const {return x2;};
+		inline float getX3() const {return x3;};
+		inline float getX4() const {return x4;};
+		//@}
 		
 	
 	protected:
@@ -5,6 +5,7 @@
 #include "fastjet/Selector.hh"
 
 #include <algorithm>
+#include <thread>
 
 #include "TMath.h"
 #include "Math/QuantFuncMathCore.h"
@@ -13,11 +14,15 @@
 
 using namespace std;
 
+// fewest particles worth a thread of their own in the metric and weight loops
+static const size_t kMinParticlesPerThread = 256;
+
 // ------------- Constructor
 puppiCleanContainer::puppiCleanContainer(std::vector<RecoObj> inParticles, 
                                          std::vector<puppiAlgoBin> puppiAlgo,
                                          float minPuppiWeight,
-                                         bool  fUseExp){
+                                         bool  fUseExp,
+                                         int   nThreads){
 
     // take the input particles
     fRecoParticles_.clear();
@@ -41,6 +46,10 @@ puppiCleanContainer::puppiCleanContainer(std::vector<RecoObj> inParticles,
     fPVFrac_ = 0.;
     fUseExp_ = fUseExp;
 
+    // one neighbour list for each thread
+    fNThreads_ = nThreads < 1 ? 1 : nThreads;
+    fNearParticles_.resize(fNThreads_);
+
     //Link to the RecoObjects --> loop on the input particles
     for (unsigned int i = 0; i < fRecoParticles_.size(); i++){
         fastjet::PseudoJet curPseudoJet;
@@ -69,18 +78,53 @@ std::vector<fastjet::PseudoJet> puppiCleanContainer::puppiEvent(){
     std::vector<fastjet::PseudoJet> particles;
     particles.clear();
 
-    std::vector<int> pPupId ; 
-    std::vector<puppiParticle> partTmp ; // temp puppi particle vector; make a clone of the same particle for all the algo in which it is contained
-  
-    // calculate puppi metric, RMS and mean value for all the algorithms
+    size_t nParticles = fPFParticles_.size();
+
+    // calculate puppi metric for all the algorithms, the particles of each algo are independent
+    fMetric_.assign(puppiAlgo_.size()*nParticles,0.);
     for(size_t iPuppiAlgo = 0; iPuppiAlgo < puppiAlgo_.size(); iPuppiAlgo++){
       getRMSAvg(iPuppiAlgo,fPFParticles_,fChargedPV_); // give all the particles in the event and the charged one
     }
-  
-    int npart = 0;  
+
+    // RMS and median value of every eta region
+    forEachChunk(puppiAlgo_.size(),1,[this](const size_t & begin, const size_t & end, const int &){
+      for(size_t iPuppiAlgo = begin; iPuppiAlgo < end; iPuppiAlgo++) computeMedRMS(iPuppiAlgo);
+    });
+
+    // the weights only depend on the particle once median and RMS are known
+    fPuppiWeights_.assign(nParticles,1.);
+    fOutputIndex_.assign(nParticles,-1);
+    fBadWeight_.assign(nParticles,0);
+    forEachChunk(nParticles,kMinParticlesPerThread,[this](const size_t & begin, const size_t & end, const int &){
+      computeWeights(begin,end);
+    });
+
+    // Loop on all the incoming particles, in order
+    for(size_t iPart = 0; iPart < nParticles; iPart++) {
+
+      if(fBadWeight_[iPart])
+	std::cerr << "====> Weight is nan : pt " << fPFParticles_[iPart].pt() << " -- eta : " << fPFParticles_[iPart].eta() << " -- id : " << fPFParticles_[iPart].user_index() << std::endl;
+
+      if(fOutputIndex_[iPart] < 0) continue; // if zero don't fill the particle in the output
+
+      float pWeight = fPuppiWeights_[iPart];
+      fastjet::PseudoJet curjet( pWeight*fPFParticles_[iPart].px(), pWeight*fPFParticles_[iPart].py(), pWeight*fPFParticles_[iPart].pz(), pWeight*fPFParticles_[iPart].e());
+      curjet.set_user_index(fOutputIndex_[iPart]);
+      particles.push_back(curjet);
+    }
+
+    return particles;
+      
+}
+
+// puppi weight of the particles in [begin,end), stored with the index the particle takes in the output (-1 if not kept)
+void puppiCleanContainer::computeWeights(const size_t & begin, const size_t & end){
+
+    size_t nParticles = fPFParticles_.size();
+    std::vector<int> pPupId ; 
 
     // Loop on all the incoming particles
-    for(size_t iPart = 0; iPart < fPFParticles_.size(); iPart++) {
+    for(size_t iPart = begin; iPart < end; iPart++) {
 
       float pWeight = 1; // default weight
       pPupId.clear();
@@ -91,10 +135,8 @@ std::vector<fastjet::PseudoJet> puppiCleanContainer::puppiEvent(){
       //////////////////////////////////////////      
 
       if(pPupId.empty()) { // out acceptance... no algorithm found
-        fPuppiWeights_.push_back(pWeight); // take the particle as it is
-        fastjet::PseudoJet curjet(pWeight*fPFParticles_[iPart].px(),pWeight*fPFParticles_[iPart].py(),pWeight*fPFParticles_[iPart].pz(),pWeight*fPFParticles_[iPart].e());    
-        curjet.set_user_index(fPFParticles_[iPart].user_index());                                                                                                      
-        particles.push_back(curjet); // fill the output collection                                                                                                            
+        fPuppiWeights_[iPart] = pWeight; // take the particle as it is
+        fOutputIndex_[iPart]  = fPFParticles_[iPart].user_index();
 	continue; //go to the next particle
       }
       
@@ -109,7 +151,7 @@ std::vector<fastjet::PseudoJet> puppiCleanContainer::puppiEvent(){
       }
 
       if(pWeight == 0){ 
-        fPuppiWeights_.push_back(0); // puppi weight is zero
+        fPuppiWeights_[iPart] = 0; // puppi weight is zero
         continue;
       }
  
@@ -125,86 +167,31 @@ std::vector<fastjet::PseudoJet> puppiCleanContainer::puppiEvent(){
         if(fRecoParticles_[iPart].pfType > 3) pChi2 = 0; // not use this info for neutrals
        }
       }
-      
 
       /////////////////////////////////////      
-      // found  the particle in all the algorithm
-      /////////////////////////////////////      
-      partTmp.clear();
-      for(size_t iAlgo = 0; iAlgo < pPupId.size(); iAlgo++){ // loop on all the algo found
-
-       int found = 0;  //  found index
-       if(fabs(fPFParticles_[iPart].user_index()) <= 1 and puppiAlgo_.at(pPupId.at(iAlgo)).fUseCharged_){ // charged or neutral from PV
-	 for(size_t puppiIt = 0 ; puppiIt < puppiAlgo_.at(pPupId.at(iAlgo)).fPuppiParticlesPV_.size(); puppiIt++){ // Loop on PV particles
-	   if(puppiAlgo_.at(pPupId.at(iAlgo)).fPuppiParticlesPV_.at(puppiIt).fPosition_ == int(iPart)){
-	    partTmp.push_back(puppiAlgo_.at(pPupId.at(iAlgo)).fPuppiParticlesPV_.at(puppiIt));  // take the puppi particle
-            found = 1 ;
-            break;
-	  }
-	}
-       }
-       else if ((fabs(fPFParticles_[iPart].user_index()) <= 1 and !puppiAlgo_.at(pPupId.at(iAlgo)).fUseCharged_) or fabs(fPFParticles_[iPart].user_index()) >= 2){
-	for(size_t puppiIt = 0; puppiIt < puppiAlgo_.at(pPupId.at(iAlgo)).fPuppiParticlesPU_.size(); puppiIt++){
-          if(puppiAlgo_.at(pPupId.at(iAlgo)).fPuppiParticlesPU_.at(puppiIt).fPosition_ == int(iPart)){
-            partTmp.push_back(puppiAlgo_.at(pPupId.at(iAlgo)).fPuppiParticlesPU_.at(puppiIt));
-            found = 1;
-            break;
-	  }
-	}
-       }
-      
-      /////////////////////////////////////      
-       // means that is inside the NULL vector for some reasons
-      /////////////////////////////////////      
-
-       if(found == 0){
-	for(size_t puppiIt = 0; puppiIt < puppiAlgo_.at(pPupId.at(iAlgo)).fPuppiParticlesNULL_.size(); puppiIt++){
-          if(puppiAlgo_.at(pPupId.at(iAlgo)).fPuppiParticlesNULL_.at(puppiIt).fPosition_ == int(iPart)){
-            partTmp.push_back(puppiAlgo_.at(pPupId.at(iAlgo)).fPuppiParticlesNULL_.at(puppiIt));
-            found = 1 ;
-            break;
-	  }
-	}
-       }
-      }
-
-      if(partTmp.size() != pPupId.size()){ // not found the particle in one of the algorithms 
-        pWeight = 1 ;
-	fPuppiWeights_.push_back(pWeight);
-        fastjet::PseudoJet curjet( pWeight*fPFParticles_[iPart].px(), pWeight*fPFParticles_[iPart].py(), pWeight*fPFParticles_[iPart].pz(), pWeight*fPFParticles_[iPart].e());    
-        curjet.set_user_index(fPFParticles_[iPart].user_index());                                                                                                      
-        particles.push_back(curjet); // by default is one, so 4V is not chaged                                                                                                
-        continue;
-      }
-      
-      /////////////////////////////////////      
-      //Check the Pval  
+      // the particle should have a metric in all the algorithm, -999 is the default PVal
       /////////////////////////////////////      
 
+      bool missing = false ;
       bool badPVal = false ;
-      for(size_t iPuppi = 0; iPuppi < partTmp.size() ; iPuppi++){
-	if(partTmp.at(iPuppi).fPval_ == -999){ // if the default is found as PVal, leave the particle as it is in the output
-	 pWeight = 1 ;
-         badPVal = true ;
-	}
+      for(size_t iAlgo = 0; iAlgo < pPupId.size(); iAlgo++){
+        float pVal = fMetric_[pPupId.at(iAlgo)*nParticles + iPart];
+        if(std::isnan(pVal)) missing = true;
+        if(pVal == -999) badPVal = true;
       }
 
-      if(badPVal){
- 	 fPuppiWeights_.push_back(pWeight);
-         fastjet::PseudoJet curjet( pWeight*fPFParticles_[iPart].px(), pWeight*fPFParticles_[iPart].py(), pWeight*fPFParticles_[iPart].pz(), pWeight*fPFParticles_[iPart].e());    
-         curjet.set_user_index(fPFParticles_[iPart].user_index());                                                                                                      
-         particles.push_back(curjet);                                                                                                                                                
-         continue;
-	
+      if(missing || badPVal){ // not found the particle in one of the algorithms, leave the particle as it is in the output
+        fPuppiWeights_[iPart] = 1;
+        fOutputIndex_[iPart]  = fPFParticles_[iPart].user_index();
+        continue;
       }
-
       
       // compute combining the weight for all the algorithm
-      pWeight = compute(pChi2,partTmp,puppiAlgo_,pPupId);      
+      pWeight = compute(pChi2,iPart,puppiAlgo_,pPupId);      
       
       //Basic Weight Checks
       if( std::isinf(pWeight) || std::isnan(pWeight)){
-	std::cerr << "====> Weight is nan : pt " << fPFParticles_[iPart].pt() << " -- eta : " << fPFParticles_[iPart].eta() << " -- id : " << fPFParticles_[iPart].user_index() << std::endl;
+	fBadWeight_[iPart] = 1;
 	pWeight = 1; // set the default to avoid problems
       }
 
@@ -219,54 +206,70 @@ std::vector<fastjet::PseudoJet> puppiCleanContainer::puppiEvent(){
        pWeight = 0; 
       }
 
-      fPuppiWeights_.push_back(pWeight); // push back the weight
+      fPuppiWeights_[iPart] = pWeight; // push back the weight
 
       //Now get rid of the thrown out weights for the particle collection
-      if(pWeight == 0) continue; // if zero don't fill the particle in the output
-      npart++;
-
-      //Produce
-      fastjet::PseudoJet curjet( pWeight*fPFParticles_[iPart].px(), pWeight*fPFParticles_[iPart].py(), pWeight*fPFParticles_[iPart].pz(), pWeight*fPFParticles_[iPart].e());           
-      curjet.set_user_index(iPart);                                                                                                                            
-      particles.push_back(curjet);
-      
+      if(pWeight != 0) fOutputIndex_[iPart] = iPart;
     }
-    
-    return particles;
-      
 }
 
-// compute puppi metric, RMS and median for PU particle for each algo
+// split [0,n) in contiguous chunks run on up to fNThreads_ threads, the calling thread takes the first chunk
+void puppiCleanContainer::forEachChunk(const size_t & n, const size_t & minPerThread, const std::function<void (const size_t &, const size_t &, const int &)> & work){
+
+  size_t nWorkers = std::min(size_t(fNThreads_),std::max(n/minPerThread,size_t(1)));
+  if(nWorkers <= 1){
+    work(0,n,0);
+    return;
+  }
+
+  size_t chunk = (n + nWorkers - 1)/nWorkers;
+  std::vector<std::thread> workers;
+  for(size_t iWorker = 1; iWorker < nWorkers; iWorker++){
+    workers.push_back(std::thread(work,std::min(iWorker*chunk,n),std::min((iWorker + 1)*chunk,n),int(iWorker)));
+  }
+  work(0,std::min(chunk,n),0);
+  for(size_t iWorker = 0; iWorker < workers.size(); iWorker++) workers[iWorker].join();
+}
+
+// compute puppi metric for each algo, the particles without a metric are marked with NaN in fMetric_
 void puppiCleanContainer::getRMSAvg(const int & iPuppiAlgo, std::vector<fastjet::PseudoJet> & particlesAll, std::vector<fastjet::PseudoJet> &chargedPV) { 
 
   std::vector<puppiParticle> puppiParticles; // puppi particles to be set for a specific algo
   puppiParticles.clear();
 
+  // the cone sums only visit the particles around each particle ; CHS uses only LV hadrons
+  const std::vector<fastjet::PseudoJet> & coneParticles = puppiAlgo_.at(iPuppiAlgo).fUseCharged_ ? chargedPV : particlesAll;
+  puppiNeighbourGrid grid(coneParticles,puppiAlgo_.at(iPuppiAlgo).fConeSize_);
+
+  float *metric = fMetric_.data() + iPuppiAlgo*particlesAll.size();
+
+  // metric of all the particles of the event, each thread with its own neighbour list
+  forEachChunk(particlesAll.size(),kMinParticlesPerThread,[&](const size_t & begin, const size_t & end, const int & worker){
+    for(size_t iPart = begin; iPart < end; iPart++ ) { 
+      bool  pPupId  = isGoodPuppiId(particlesAll[iPart].pt(),particlesAll[iPart].eta(),puppiAlgo_.at(iPuppiAlgo)); // get the puppi id algo asaf of eta and phi of the particle
+      // does not exsist and algorithm for this particle
+      if(pPupId == false){ metric[iPart] = NAN; continue; }
+      // apply CHS in puppi metric computation -> use only LV hadrons to compute the metric for each particle
+      metric[iPart] = goodVar(particlesAll[iPart], grid, puppiAlgo_.at(iPuppiAlgo).fMetricId_, fNearParticles_[worker]);
+    }
+  });
+
   // Loop on all the particles of the event  
     
   for(size_t iPart = 0; iPart < particlesAll.size(); iPart++ ) { 
 
-    float pVal    = -999;
-    bool  pPupId  = isGoodPuppiId(particlesAll[iPart].pt(),particlesAll[iPart].eta(),puppiAlgo_.at(iPuppiAlgo)); // get the puppi id algo asaf of eta and phi of the particle
-    // does not exsist and algorithm for this particle, store -999 as pVal
-    if(pPupId == false) continue;
-    // apply CHS in puppi metric computation -> use only LV hadrons to compute the metric for each particle
-    if(puppiAlgo_.at(iPuppiAlgo).fUseCharged_)  
-       pVal = goodVar(particlesAll[iPart], chargedPV,    puppiAlgo_.at(iPuppiAlgo).fMetricId_,puppiAlgo_.at(iPuppiAlgo).fConeSize_);
-    else if(!puppiAlgo_.at(iPuppiAlgo).fUseCharged_) 
-       pVal = goodVar(particlesAll[iPart], particlesAll, puppiAlgo_.at(iPuppiAlgo).fMetricId_,puppiAlgo_.at(iPuppiAlgo).fConeSize_);
+    float pVal = metric[iPart];
+    if(!isGoodPuppiId(particlesAll[iPart].pt(),particlesAll[iPart].eta(),puppiAlgo_.at(iPuppiAlgo))) continue;
 
     // fill the value
     if(std::isnan(pVal) || std::isinf(pVal)) std::cout << "====>  Value is Nan " << pVal << " == " << particlesAll[iPart].pt() << " -- " << particlesAll[iPart].eta() << std::endl;
-    if(std::isnan(pVal) || std::isinf(pVal)) continue;
+    if(std::isnan(pVal) || std::isinf(pVal)){ metric[iPart] = NAN; continue; }
     
     puppiParticles.push_back(puppiParticle(particlesAll.at(iPart).pt(),particlesAll.at(iPart).eta(),pVal,particlesAll.at(iPart).user_index(),iPart));
   }
   
   // set the puppi particles for the algorithm
   puppiAlgo_.at(iPuppiAlgo).setPuppiParticles(puppiParticles);
-  // compute RMS, median and mean value  
-  computeMedRMS(iPuppiAlgo);
   
 }
 
@@ -277,6 +280,10 @@ float puppiCleanContainer::goodVar(const fastjet::PseudoJet & particle, const st
   return lPup;
 }
 
+float puppiCleanContainer::goodVar(const fastjet::PseudoJet & particle, const puppiNeighbourGrid & grid, const int & pPupId, std::vector<int> & nearParticles) {
+  return var_within_R(pPupId,grid,particle,nearParticles);
+}
+
 float puppiCleanContainer::var_within_R(const int & pPupId, const vector<fastjet::PseudoJet> & particles, const fastjet::PseudoJet& centre, const float & R){
 
   if(pPupId == -1) return 1;
@@ -311,6 +318,41 @@ float puppiCleanContainer::var_within_R(const int & pPupId, const vector<fastjet
 }
 
 
+float puppiCleanContainer::var_within_R(const int & pPupId, const puppiNeighbourGrid & grid, const fastjet::PseudoJet& centre, std::vector<int> & nearParticles){
+
+  if(pPupId == -1) return 1;
+  grid.neighbours(centre,nearParticles);
+  float var = 0;
+
+  const double centreEta = centre.eta();
+  const double centrePhi = centre.phi();
+
+  for(size_t iNear = 0; iNear < nearParticles.size(); iNear++){
+
+    int iPart = nearParticles[iNear];
+    double pDEta = grid.eta(iPart)-centreEta;
+    double pDPhi = fabs(grid.phi(iPart)-centrePhi);
+    if(pDPhi > 2.*3.14159265-pDPhi) pDPhi = 2.*3.14159265-pDPhi;
+    double pDR = sqrt(pDEta*pDEta+pDPhi*pDPhi);
+
+    if(pDR < 0.0001) continue;
+    if(pDR == 0)    continue;
+
+    if(pPupId == 0) var += (grid.pt(iPart)/(pDR*pDR));
+    if(pPupId == 1) var += grid.pt(iPart);
+    if(pPupId == 2) var += (1./pDR)*(1./pDR);
+    if(pPupId == 3) var += (1./pDR)*(1./pDR);
+    if(pPupId == 4) var += grid.pt(iPart);
+    if(pPupId == 5) var += (grid.pt(iPart)/pDR)*(grid.pt(iPart)/pDR);
+  }
+
+  if(pPupId == 0 && var != 0) var = log(var);
+  if(pPupId == 3 && var != 0) var = log(var);
+  if(pPupId == 5 && var != 0) var = log(var);
+  return var;
+
+}
+
 float puppiCleanContainer::pt_within_R(const std::vector<fastjet::PseudoJet> & particles, const fastjet::PseudoJet & centre, const float & R){
 
   fastjet::Selector sel = fastjet::SelectorCircle(R);
@@ -418,9 +460,7 @@ bool puppiCleanContainer::isGoodPuppiId(const float & pt, const float & eta, con
 
 
 // ----------------------
-float puppiCleanContainer::compute(const float & chi2, const std::vector<puppiParticle> & particles, const std::vector<puppiAlgoBin> & puppiAlgos, const std::vector<int> & pPupId) {
-
-  if(particles.size() != pPupId.size() ) return 0; // default check
+float puppiCleanContainer::compute(const float & chi2, const size_t & iPart, const std::vector<puppiAlgoBin> & puppiAlgos, const std::vector<int> & pPupId) {
 
   float lVal  = 0.;
   float lPVal = 1.;
@@ -439,7 +479,7 @@ float puppiCleanContainer::compute(const float & chi2, const std::vector<puppiPa
 
     if(puppiAlgos.at(pPupId.at(iAlgo)).fMetricId_ == -1) continue;
 
-    float pVal = particles.at(iAlgo).fPval_ ;
+    float pVal = fMetric_[pPupId.at(iAlgo)*fPFParticles_.size() + iPart] ;
 
     if(puppiAlgos.at(pPupId.at(iAlgo)).fMetricId_ == 0 && pVal == 0) pVal = puppiAlgos.at(pPupId.at(iAlgo)).fMedian_;
     if(puppiAlgos.at(pPupId.at(iAlgo)).fMetricId_ == 3 && pVal == 0) pVal = puppiAlgos.at(pPupId.at(iAlgo)).fMedian_;
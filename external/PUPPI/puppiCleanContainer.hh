@@ -5,10 +5,12 @@
 #include "PUPPI/RecoObj.hh"
 #include "PUPPI/puppiParticle.hh"
 #include "PUPPI/puppiAlgoBin.hh"
+#include "PUPPI/puppiNeighbourGrid.hh"
 
 #include "fastjet/internal/base.hh"
 #include "fastjet/PseudoJet.hh"
 #include <algorithm>
+#include <functional>
 
 using namespace std;
 
@@ -22,7 +24,8 @@ class puppiCleanContainer{
   puppiCleanContainer(std::vector<RecoObj> inParticles,    // incoming particles of the event
                       std::vector<puppiAlgoBin> puppiAlgo, // vector with the definition of the puppi algorithm in different eta region (one for each eta) 
                       float minPuppiWeight  = 0.01,        // min puppi weight cut
-                      bool  useExp = false                 // useDz vertex probability
+                      bool  useExp = false,                // useDz vertex probability
+                      int   nThreads = 1                   // threads computing the metric and the weights
   ); 
 
   ~puppiCleanContainer(); 
@@ -47,8 +50,11 @@ class puppiCleanContainer{
 
    void    getRMSAvg(const int &, std::vector<fastjet::PseudoJet> &, std::vector<fastjet::PseudoJet> &);        
    float   goodVar  (const fastjet::PseudoJet &, const std::vector<fastjet::PseudoJet> &, const int &, const float &);    
+   float   goodVar  (const fastjet::PseudoJet &, const puppiNeighbourGrid &, const int &, std::vector<int> &);    
    void    computeMedRMS(const int &);  
-   float   compute(const float &, const std::vector<puppiParticle> &, const std::vector<puppiAlgoBin> &, const std::vector<int> &);
+   void    computeWeights(const size_t &, const size_t &);
+   float   compute(const float &, const size_t &, const std::vector<puppiAlgoBin> &, const std::vector<int> &);
+   void    forEachChunk(const size_t &, const size_t &, const std::function<void (const size_t &, const size_t &, const int &)> &);
 
    // some get functions
    float getNeutralPtCut(const float&, const float&, const int&);
@@ -57,6 +63,8 @@ class puppiCleanContainer{
    float getChi2FromdZ(float);
    // other functions
    float  var_within_R(const int &, const vector<fastjet::PseudoJet> &, const fastjet::PseudoJet &, const float &);
+   // same sum over the particles of the grid, visiting only those in the cells around the centre
+   float  var_within_R(const int &, const puppiNeighbourGrid &, const fastjet::PseudoJet &, std::vector<int> &);
    float  pt_within_R(const std::vector<fastjet::PseudoJet> &, const fastjet::PseudoJet &, const float &);
    fastjet::PseudoJet flow_within_R(const vector<fastjet::PseudoJet> &, const fastjet::PseudoJet &, const float &);
    
@@ -72,11 +80,17 @@ class puppiCleanContainer{
   std::vector<puppiAlgoBin> puppiAlgo_;
   std::vector<float> fPuppiWeights_;
 
+  std::vector<float> fMetric_;      // metric of every particle for each algo, one column of particles per algo, NaN when the algo has none
+  std::vector<int>   fOutputIndex_; // user index of the particle in the output, -1 when not kept
+  std::vector<char>  fBadWeight_;   // the weight was nan or inf
+  std::vector<std::vector<int> > fNearParticles_; // neighbours in var_within_R, one list per thread
+
   float  fMinPuppiWeight_;
   float  fPVFrac_;
 
   int    fNPV_;  
   bool   fUseExp_ ;
+  int    fNThreads_;
     
 };
 
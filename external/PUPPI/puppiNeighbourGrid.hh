@@ -0,0 +1,122 @@
+#ifndef PUPPINEIGHBOURGRID_HH
+#define PUPPINEIGHBOURGRID_HH
+
+#include "fastjet/PseudoJet.hh"
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+//............ rapidity-phi grid of a particle collection with cells wider than the cone size, the particles within the cone of any point are then in its 3x3 cells
+class puppiNeighbourGrid {
+
+ public:
+
+  puppiNeighbourGrid(const std::vector<fastjet::PseudoJet> & particles, const float & coneSize):
+    fParticles_(&particles),
+    fR2_(double(coneSize)*double(coneSize)),
+    fRapMin_(0.),
+    fRapWidth_(1.),
+    fPhiWidth_(2.*M_PI),
+    fNRap_(1),
+    fNPhi_(1)
+  {
+    // a bit wider than the cone, so that the rounding can't put two particles within the cone further than one cell apart
+    const double width = 1.0001*coneSize;
+    double rapMax = 0.;
+
+    fPt_.resize(particles.size());
+    fEta_.resize(particles.size());
+    fPhi_.resize(particles.size());
+    for(size_t iPart = 0; iPart < particles.size(); iPart++){
+      fPt_[iPart]  = particles[iPart].pt();
+      fEta_[iPart] = particles[iPart].eta();
+      fPhi_[iPart] = particles[iPart].phi();
+      if(iPart == 0 || particles[iPart].rap() < fRapMin_) fRapMin_ = particles[iPart].rap();
+      if(iPart == 0 || particles[iPart].rap() > rapMax) rapMax = particles[iPart].rap();
+    }
+
+    if(width > 0){
+      fRapWidth_ = width;
+      // the particles far out in rapidity are stacked in the last cells, which keeps the neighbours within one cell
+      fNRap_ = int(std::min((rapMax - fRapMin_)/width, double(kMaxRapCells - 1))) + 1;
+      fNPhi_ = int(2.*M_PI/width);
+      if(fNPhi_ < 3) fNPhi_ = 1;
+      fPhiWidth_ = 2.*M_PI/fNPhi_;
+    }
+
+    // particles of each cell in increasing order
+    std::vector<int> cells(particles.size());
+    fCellStart_.assign(fNRap_*fNPhi_ + 1, 0);
+    for(size_t iPart = 0; iPart < particles.size(); iPart++){
+      cells[iPart] = rapCell(particles[iPart].rap())*fNPhi_ + phiCell(fPhi_[iPart]);
+      fCellStart_[cells[iPart] + 1]++;
+    }
+    for(size_t iCell = 1; iCell < fCellStart_.size(); iCell++) fCellStart_[iCell] += fCellStart_[iCell - 1];
+
+    std::vector<int> next(fCellStart_.begin(), fCellStart_.end() - 1);
+    fCellParticles_.resize(particles.size());
+    for(size_t iPart = 0; iPart < particles.size(); iPart++) fCellParticles_[next[cells[iPart]]++] = iPart;
+  };
+
+  // indices of the particles within the cone around centre, as selected by fastjet::SelectorCircle, in increasing order
+  void neighbours(const fastjet::PseudoJet & centre, std::vector<int> & indices) const {
+
+    indices.clear();
+    int rap = rapCell(centre.rap());
+    int phi = phiCell(centre.phi());
+
+    for(int iRap = std::max(rap - 1, 0); iRap <= std::min(rap + 1, fNRap_ - 1); iRap++){
+      for(int iPhi = 0; iPhi < std::min(fNPhi_, 3); iPhi++){
+        int cell = iRap*fNPhi_ + (fNPhi_ == 1 ? 0 : (phi + iPhi - 1 + fNPhi_) % fNPhi_);
+        for(int iPos = fCellStart_[cell]; iPos < fCellStart_[cell + 1]; iPos++){
+          int iPart = fCellParticles_[iPos];
+          if((*fParticles_)[iPart].squared_distance(centre) <= fR2_) indices.push_back(iPart);
+        }
+      }
+    }
+
+    std::sort(indices.begin(), indices.end());
+  };
+
+  // pt, eta and phi of the particles, computed once
+  double pt(const int & iPart) const { return fPt_[iPart]; }
+  double eta(const int & iPart) const { return fEta_[iPart]; }
+  double phi(const int & iPart) const { return fPhi_[iPart]; }
+
+ private:
+
+  static const int kMaxRapCells = 4096;
+
+  int rapCell(const double & rap) const {
+    double cell = (rap - fRapMin_)/fRapWidth_;
+    if(cell < 0) return 0;
+    if(cell >= fNRap_) return fNRap_ - 1;
+    return int(cell);
+  }
+
+  int phiCell(const double & phi) const {
+    int cell = int(phi/fPhiWidth_);
+    if(cell < 0) return 0;
+    if(cell >= fNPhi_) return fNPhi_ - 1;
+    return cell;
+  }
+
+  const std::vector<fastjet::PseudoJet> * fParticles_;
+
+  double fR2_;
+  double fRapMin_;
+  double fRapWidth_;
+  double fPhiWidth_;
+  int    fNRap_;
+  int    fNPhi_;
+
+  std::vector<int> fCellStart_;
+  std::vector<int> fCellParticles_;
+
+  std::vector<double> fPt_;
+  std::vector<double> fEta_;
+  std::vector<double> fPhi_;
+};
+
+#endif
@@ -35,6 +35,7 @@
 #include "fastjet/version.hh" // stores the current version number
 #include "fastjet/internal/LazyTiling9Alt.hh"
 #include "fastjet/internal/LazyTiling9.hh"
+#include "fastjet/internal/LazyTiling9SoA.hh"
 #include "fastjet/internal/LazyTiling25.hh"
 #ifndef __FJCORE__
 #include "fastjet/internal/LazyTiling9SeparateGhosts.hh"
@@ -173,6 +174,27 @@ ClusterSequence::~ClusterSequence () {
   }
 }
 
+//----------------------------------------------------------------------
+// get ready to recluster: outstanding jets keep the old structure
+// (now pointing nowhere, as after deletion) and we start a new one
+void ClusterSequence::_clear_for_reset () {
+  if (_deletes_self_when_unused) {
+    throw Error("reset may not be called on a ClusterSequence that deletes itself when unused");
+  }
+
+  if (_structure_shared_ptr()){
+    ClusterSequenceStructure* csi = dynamic_cast<ClusterSequenceStructure*>(_structure_shared_ptr()); 
+    assert(csi != NULL);
+    csi->set_associated_cs(NULL);
+  }
+
+  // clear() keeps the capacity of both vectors
+  _jets.clear();
+  _history.clear();
+  _extras.reset();
+  _structure_shared_ptr.reset(new ClusterSequenceStructure(this));
+}
+
 //-----------
 void ClusterSequence::signal_imminent_self_deletion() const {
   // normally if the destructor is called when
@@ -371,6 +393,14 @@ void ClusterSequence::_initialise_and_run_no_decant () {
     tiling.run();
     _plugin_activated = false;
 
+  } else if (_strategy == N2MHTLazy9SoA) {
+    // attempt to use an external tiling routine -- it manipulates
+    // the CS history via the plugin mechanism
+    _plugin_activated = true;
+    LazyTiling9SoA tiling(*this);
+    tiling.run();
+    _plugin_activated = false;
+
   } else if (_strategy == N2MHTLazy9AntiKtSeparateGhosts) {
 #ifndef __FJCORE__
     // attempt to use an external tiling routine -- it manipulates
@@ -495,6 +525,10 @@ void ClusterSequence::_fill_initial_history () {
 
   _Qtot = 0;
 
+  // a new clustering, the sorted jets of the previous one are stale
+  _inclusive_jets_by_pt.clear();
+  _have_inclusive_jets_by_pt = false;
+
   for (int i = 0; i < static_cast<int>(_jets.size()) ; i++) {
     history_element element;
     element.parent1 = InexistentParent;
@@ -541,6 +575,8 @@ string ClusterSequence::strategy_string (Strategy strategy_in)  const {
     strategy = "N2PoorTiled"; break;
   case N2MHTLazy9:
     strategy = "N2MHTLazy9"; break;
+  case N2MHTLazy9SoA:
+    strategy = "N2MHTLazy9SoA"; break;
   case N2MHTLazy9Alt:
     strategy = "N2MHTLazy9Alt"; break;
   case N2MHTLazy25:
@@ -809,6 +845,8 @@ void ClusterSequence::transfer_from_sequence(const ClusterSequence & from_seq,
   else
     _jets     = from_seq._jets;
   _history  = from_seq._history;
+  _inclusive_jets_by_pt.clear();
+  _have_inclusive_jets_by_pt = false;
   // the following shares ownership of the extras with the from_seq;
   // no transformations will be applied to the extras
   _extras   = from_seq._extras;
@@ -909,6 +947,25 @@ vector<PseudoJet> ClusterSequence::inclusive_jets (const double ptmin) const{
   return jets_local;
 }
 
+//----------------------------------------------------------------------
+// return all inclusive jets with pt > ptmin, sorted by decreasing pt
+vector<PseudoJet> ClusterSequence::inclusive_jets_sorted_by_pt (const double ptmin) const{
+  // jets kept here would count as outside users of a sequence that
+  // deletes itself, so that one gets no cache
+  if (_deletes_self_when_unused) return sorted_by_pt(inclusive_jets(ptmin));
+
+  if (!_have_inclusive_jets_by_pt) {
+    _inclusive_jets_by_pt = sorted_by_pt(inclusive_jets());
+    _have_inclusive_jets_by_pt = true;
+  }
+
+  // the jets above ptmin are the front of the sorted list
+  double ptmin2 = ptmin*ptmin;
+  vector<PseudoJet>::iterator end = _inclusive_jets_by_pt.begin();
+  while (end != _inclusive_jets_by_pt.end() && end->perp2() >= ptmin2) end++;
+  return vector<PseudoJet>(_inclusive_jets_by_pt.begin(), end);
+}
+
 
 //----------------------------------------------------------------------
 // return the number of exclusive jets that would have been obtained
@@ -916,13 +973,15 @@ vector<PseudoJet> ClusterSequence::inclusive_jets (const double ptmin) const{
 int ClusterSequence::n_exclusive_jets (const double dcut) const {
 
   // first locate the point where clustering would have stopped (i.e. the
-  // first time max_dij_so_far > dcut)
-  int i = _history.size() - 1; // last jet
-  while (i >= 0) {
-    if (_history[i].max_dij_so_far <= dcut) {break;}
-    i--;
+  // first time max_dij_so_far > dcut); max_dij_so_far never decreases
+  // along the history, so bisect rather than scan
+  int lo = 0, hi = _history.size();
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    if (_history[mid].max_dij_so_far <= dcut) {lo = mid + 1;}
+    else {hi = mid;}
   }
-  int stop_point = i + 1;
+  int stop_point = lo;
   // relation between stop_point, njets assumes one extra jet disappears
   // at each clustering.
   int njets = 2*_initial_n - stop_point;
@@ -1719,6 +1778,10 @@ void ClusterSequence::delete_self_when_unused() {
   // objects left associated the CS and the structure's destructor will then
   // look after deleting the cluster sequence
   
+  // the cached sorted jets are not outside users, drop them
+  _inclusive_jets_by_pt.clear();
+  _have_inclusive_jets_by_pt = false;
+
   // first make sure that there is at least one other object
   // associated with the CS
   int new_count = _structure_shared_ptr.use_count() - _structure_use_count_after_construction;
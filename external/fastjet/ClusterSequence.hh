@@ -64,7 +64,7 @@ class ClusterSequence {
  public: 
 
   /// default constructor
-  ClusterSequence () : _deletes_self_when_unused(false) {}
+  ClusterSequence () : _deletes_self_when_unused(false), _have_inclusive_jets_by_pt(false) {}
 
   /// create a ClusterSequence, starting from the supplied set
   /// of PseudoJets and clustering them with jet definition specified
@@ -75,10 +75,20 @@ class ClusterSequence {
 				  const bool & writeout_combinations = false);
   
   /// copy constructor for a ClusterSequence
-  ClusterSequence (const ClusterSequence & cs) : _deletes_self_when_unused(false) {
+  ClusterSequence (const ClusterSequence & cs) : _deletes_self_when_unused(false), _have_inclusive_jets_by_pt(false) {
     transfer_from_sequence(cs);
   }
 
+  /// re-run the clustering on a new set of PseudoJets, replacing the
+  /// current history. The storage of the internal jets, history and
+  /// tiles is kept, so a sequence reused event after event does not
+  /// reallocate it. Jets from the previous clustering lose their
+  /// association with the sequence, as if it had been deleted.
+  template<class L> void reset (
+			          const std::vector<L> & pseudojets,
+				  const JetDefinition & jet_def,
+				  const bool & writeout_combinations = false);
+
   // virtual ClusterSequence destructor, in case any derived class
   // thinks of needing a destructor at some point
   virtual ~ClusterSequence (); //{}
@@ -92,6 +102,12 @@ class ClusterSequence {
   /// of the number of jets returned.
   std::vector<PseudoJet> inclusive_jets (const double ptmin = 0.0) const;
 
+  /// return the same jets as sorted_by_pt(inclusive_jets(ptmin)). The
+  /// full pt-sorted list is built on the first call and kept until the
+  /// next clustering, so that further calls, with any ptmin, only copy
+  /// the jets they return.
+  std::vector<PseudoJet> inclusive_jets_sorted_by_pt (const double ptmin = 0.0) const;
+
   /// return the number of jets (in the sense of the exclusive
   /// algorithm) that would be obtained when running the algorithm
   /// with the given dcut.
@@ -610,6 +626,11 @@ protected:
   /// options.
   void _decant_options_partial();
 
+  /// detach the current structure from any outstanding jets and
+  /// empty the jets and history, keeping their capacity (used by
+  /// reset)
+  void _clear_for_reset();
+
   /// fill out the history (and jet cross refs) related to the initial
   /// set of jets (assumed already to have been "transferred"),
   /// without any clustering
@@ -708,6 +729,11 @@ protected:
   bool _plugin_activated;
   SharedPtr<Extras> _extras; // things the plugin might want to add
 
+  /// all inclusive jets by decreasing pt, filled on demand by
+  /// inclusive_jets_sorted_by_pt and dropped by every new clustering
+  mutable std::vector<PseudoJet> _inclusive_jets_by_pt;
+  mutable bool _have_inclusive_jets_by_pt;
+
   void _really_dumb_cluster ();
   void _delaunay_cluster ();
   //void _simple_N2_cluster ();
@@ -977,6 +1003,29 @@ template<class L> ClusterSequence::ClusterSequence (
 }
 
 
+//----------------------------------------------------------------------
+/// recluster a new set of four-momenta with the jet definition
+/// specified by jet_def, reusing the storage of this sequence
+template<class L> void ClusterSequence::reset (
+			          const std::vector<L> & pseudojets,
+				  const JetDefinition & jet_def_in,
+				  const bool & writeout_combinations) {
+
+  // drop the previous event
+  _clear_for_reset();
+  _jet_def = jet_def_in;
+  _writeout_combinations = writeout_combinations;
+
+  // transfer the initial jets (type L) into our own array
+  _transfer_input_jets(pseudojets);
+
+  // transfer the remaining options
+  _decant_options_partial();
+
+  // run the clustering
+  _initialise_and_run_no_decant();
+}
+
 inline const std::vector<PseudoJet> & ClusterSequence::jets () const {
   return _jets;
 }
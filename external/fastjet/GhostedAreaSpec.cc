@@ -55,6 +55,7 @@ GhostedAreaSpec::GhostedAreaSpec(
     _pt_scatter(pt_scatter_in), 
     _mean_ghost_pt(mean_ghost_pt_in),
     _fj2_placement(false),
+    _use_cached_lattice(false),
     _selector(selector),
     _actual_ghost_area(-1.0)
   {
@@ -107,12 +108,92 @@ void GhostedAreaSpec::_initialize() {
   // checkpoint the status of the random number generator.
   checkpoint_random();
   //_random_generator.info(cerr);
+
+  _rebuild_lattice();
+}
+
+//----------------------------------------------------------------------
+void GhostedAreaSpec::set_cached_lattice(bool val) {
+  _use_cached_lattice = val;
+  if (val) _rebuild_lattice();
+  else     _lattice.reset();
+}
+
+//----------------------------------------------------------------------
+/// generates the ghosts once, with the same placement and scatter as
+/// add_ghosts, and keeps their trigonometry
+void GhostedAreaSpec::_rebuild_lattice() {
+  if (!_use_cached_lattice) return;
+
+  double rap_offset;
+  int nrap_upper;
+  if (_fj2_placement) {
+    rap_offset  = 0.0;
+    nrap_upper  = _nrap;
+  } else {
+    rap_offset  = 0.5;
+    nrap_upper  = _nrap-1;
+  }
+
+  vector<CachedGhost> * lattice = new vector<CachedGhost>;
+  lattice->reserve(_n_ghosts);
+  for (int irap = -_nrap; irap <= nrap_upper; irap++) {
+    for (int iphi = 0; iphi < _nphi; iphi++) {
+      double phi_fj2 = (iphi+0.5) * _dphi + _dphi*(_our_rand()-0.5)*_grid_scatter;
+      CachedGhost ghost;
+      if (_fj2_placement) ghost.phi = 0.5*pi - phi_fj2;
+      else                ghost.phi = phi_fj2;
+      ghost.rap = (irap+rap_offset) * _drap + _drap*(_our_rand()-0.5)*_grid_scatter
+	                                                 + _ghost_rap_offset ;
+      ghost.pt = _mean_ghost_pt*(1+(_our_rand()-0.5)*_pt_scatter);
+      ghost.cos_phi = cos(ghost.phi);
+      ghost.sin_phi = sin(ghost.phi);
+      ghost.exprap = exp(ghost.rap);
+      lattice->push_back(ghost);
+    }
+  }
+  _lattice.reset(lattice);
+}
+
+//----------------------------------------------------------------------
+/// adds the cached lattice, shifted as a whole by a random offset
+void GhostedAreaSpec::_add_cached_ghosts(vector<PseudoJet> & event) const {
+  double drap = _drap*(_our_rand()-0.5)*_grid_scatter;
+  double dphi = _dphi*(_our_rand()-0.5)*_grid_scatter;
+  double exp_drap = exp(drap);
+  double cos_dphi = cos(dphi);
+  double sin_dphi = sin(dphi);
+
+  const vector<CachedGhost> & lattice = *_lattice;
+  event.reserve(event.size() + lattice.size());
+  for (unsigned i = 0; i < lattice.size(); i++) {
+    const CachedGhost & ghost = lattice[i];
+    double rap = ghost.rap + drap;
+    double phi = ghost.phi + dphi;
+    if (phi < 0.0)     phi += twopi;
+    if (phi >= twopi)  phi -= twopi;
+    double exprap = ghost.exprap*exp_drap;
+    double pminus = ghost.pt/exprap;
+    double pplus  = ghost.pt*exprap;
+    double px = ghost.pt*(ghost.cos_phi*cos_dphi - ghost.sin_phi*sin_dphi);
+    double py = ghost.pt*(ghost.sin_phi*cos_dphi + ghost.cos_phi*sin_dphi);
+    PseudoJet mom(px,py,0.5*(pplus-pminus),0.5*(pplus+pminus));
+    mom.set_cached_rap_phi(rap,phi);
+
+    if (_selector.worker().get() && !_selector.pass(mom)) continue;
+    event.push_back(mom);
+  }
 }
 
 //----------------------------------------------------------------------
 /// adds the ghost 4-momenta to the vector of PseudoJet's
 void GhostedAreaSpec::add_ghosts(vector<PseudoJet> & event) const {
 
+  if (_use_cached_lattice) {
+    _add_cached_ghosts(event);
+    return;
+  }
+
   double rap_offset;
   int nrap_upper;
   if (_fj2_placement) {
@@ -71,7 +71,8 @@ public:
                     _grid_scatter (gas::def_grid_scatter), 
                     _pt_scatter   (gas::def_pt_scatter), 
                     _mean_ghost_pt(gas::def_mean_ghost_pt),
-                    _fj2_placement(false) {_initialize();}
+                    _fj2_placement(false),
+    _use_cached_lattice(false) {_initialize();}
   
   /// explicit constructor
   explicit GhostedAreaSpec(double ghost_maxrap_in, 
@@ -88,7 +89,8 @@ public:
     _grid_scatter(grid_scatter_in),  
     _pt_scatter(pt_scatter_in), 
     _mean_ghost_pt(mean_ghost_pt_in),
-    _fj2_placement(false) {_initialize();}
+    _fj2_placement(false),
+    _use_cached_lattice(false) {_initialize();}
 
   /// explicit constructor
   explicit GhostedAreaSpec(double ghost_minrap_in, 
@@ -106,7 +108,8 @@ public:
     _grid_scatter(grid_scatter_in),  
     _pt_scatter(pt_scatter_in), 
     _mean_ghost_pt(mean_ghost_pt_in),
-    _fj2_placement(false) {_initialize();}
+    _fj2_placement(false),
+    _use_cached_lattice(false) {_initialize();}
 
 
   /// constructor based on a Selector
@@ -147,13 +150,13 @@ public:
   inline void set_ghost_maxrap (double val) {_ghost_maxrap = val; _initialize();}
   inline void set_ghost_etamax (double val) {_ghost_maxrap = val; _initialize();}
   inline void set_ghost_maxeta (double val) {_ghost_maxrap = val; _initialize();}
-  inline void set_grid_scatter (double val) {_grid_scatter   = val; }
-  inline void set_pt_scatter   (double val) {_pt_scatter     = val; }
-  inline void set_mean_ghost_pt(double val) {_mean_ghost_pt  = val; }
+  inline void set_grid_scatter (double val) {_grid_scatter   = val; _rebuild_lattice();}
+  inline void set_pt_scatter   (double val) {_pt_scatter     = val; _rebuild_lattice();}
+  inline void set_mean_ghost_pt(double val) {_mean_ghost_pt  = val; _rebuild_lattice();}
   inline void set_repeat       (int    val) {_repeat         = val; }
 
-  inline void set_kt_scatter   (double val) {_pt_scatter     = val; }
-  inline void set_mean_ghost_kt(double val) {_mean_ghost_pt  = val; }
+  inline void set_kt_scatter   (double val) {_pt_scatter     = val; _rebuild_lattice();}
+  inline void set_mean_ghost_kt(double val) {_mean_ghost_pt  = val; _rebuild_lattice();}
 
   /// if val is true, set ghost placement as it was in FastJet 2.X. The
   /// main differences between FJ2 and FJ3 ghost placement are
@@ -203,6 +206,16 @@ public:
   /// PseudoJets
   void add_ghosts(std::vector<PseudoJet> & ) const;
 
+  /// when set, the ghosts (with their individual scatter in position
+  /// and pt) are generated once and kept; add_ghosts then only moves
+  /// the whole lattice by a random offset of up to grid_scatter/2 of a
+  /// cell in rapidity and phi. This avoids three random numbers and an
+  /// exp, cos and sin per ghost, at the price of ghosts keeping their
+  /// relative positions from one call to the next. Copies of the spec
+  /// share the cached lattice.
+  void set_cached_lattice(bool val);
+  inline bool cached_lattice() const {return _use_cached_lattice;}
+
   /// very deprecated public access to a random number 
   /// from the internal generator
   inline double random_at_own_risk() const {return _our_rand();}
@@ -221,6 +234,7 @@ private:
   double _pt_scatter  ;
   double _mean_ghost_pt;
   bool   _fj2_placement;
+  bool   _use_cached_lattice;
 
   Selector _selector;
 
@@ -236,6 +250,16 @@ private:
   static LimitedWarning _warn_fj2_placement_deprecated;
 
   inline double _our_rand() const {return _random_generator();}
+
+  /// a ghost of the cached lattice, before the per-call offset
+  struct CachedGhost {
+    double rap, phi, cos_phi, sin_phi, exprap, pt;
+  };
+  SharedPtr<const std::vector<CachedGhost> > _lattice;
+
+  /// (re)generate the cached lattice, if it is in use
+  void _rebuild_lattice();
+  void _add_cached_ghosts(std::vector<PseudoJet> & ) const;
   
 };
 
@@ -74,6 +74,12 @@ enum Strategy {
   /// size R and a 3x3 tile grid around the particle.
   /// New in FJ3.1
   N2MHTLazy9   = -7, 
+  /// Same algorithm as N2MHTLazy9, but each tile stores its particles
+  /// as contiguous rapidity/phi arrays so that the nearest-neighbour
+  /// searches run as vectorisable loops (see LazyTiling9SoA). Faster
+  /// than N2MHTLazy9 when there are many particles per R x R tile, but
+  /// not selected by Best, since N2MHTLazy25 does better there.
+  N2MHTLazy9SoA   = -8, 
   /// Similar to N2MHTLazy9, but uses tiles of size R/2 and a 5x5 tile
   /// grid around the particle.
   /// New in FJ3.1
@@ -0,0 +1,606 @@
+//FJSTARTHEADER
+// $Id$
+//
+// Copyright (c) 2005-2014, Matteo Cacciari, Gavin P. Salam and Gregory Soyez
+//
+//----------------------------------------------------------------------
+// This file is part of FastJet.
+//
+//  FastJet is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  The algorithms that underlie FastJet have required considerable
+//  development. They are described in the original FastJet paper,
+//  hep-ph/0512210 and in the manual, arXiv:1111.6097. If you use
+//  FastJet as part of work towards a scientific publication, please
+//  quote the version you use and include a citation to the manual and
+//  optionally also to hep-ph/0512210.
+//
+//  FastJet is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with FastJet. If not, see <http://www.gnu.org/licenses/>.
+//----------------------------------------------------------------------
+//FJENDHEADER
+
+#include <iomanip>
+#include <limits>
+#include <cmath>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "fastjet/internal/LazyTiling9SoA.hh"
+#include "fastjet/internal/TilingExtent.hh"
+using namespace std;
+
+FASTJET_BEGIN_NAMESPACE      // defined in fastjet/internal/base.hh
+
+
+LazyTiling9SoA::LazyTiling9SoA(ClusterSequence & cs) :
+  _cs(cs), _jets(cs.jets())
+{
+  _Rparam = cs.jet_def().R();
+  _R2 = _Rparam * _Rparam;
+  _invR2 = 1.0 / _R2;
+  _initialise_tiles();
+}
+
+
+//----------------------------------------------------------------------
+/// Set up the tiles, exactly as in LazyTiling9::_initialise_tiles()
+/// (the tiling region is taken from TilingExtent and there are
+/// always at least two tiles in rapidity)
+void LazyTiling9SoA::_initialise_tiles() {
+
+  // first decide tile sizes (with a lower bound to avoid huge memory use with
+  // very small R)
+  double default_size = max(0.1,_Rparam);
+  _tile_size_eta = default_size;
+  // it makes no sense to go below 3 tiles in phi -- 3 tiles is
+  // sufficient to make sure all pair-wise combinations up to pi in
+  // phi are possible
+  _n_tiles_phi   = max(3,int(floor(twopi/default_size)));
+  _tile_size_phi = twopi / _n_tiles_phi; // >= _Rparam and fits in 2pi
+
+  TilingExtent tiling_analysis(_cs);
+  _tiles_eta_min = tiling_analysis.minrap();
+  _tiles_eta_max = tiling_analysis.maxrap();
+
+  if (_tiles_eta_max - _tiles_eta_min < 2*_tile_size_eta) {
+    // small rapidity coverage compared to the tile size: use exactly
+    // 3 tiles in rapidity
+    _tile_size_eta = (_tiles_eta_max - _tiles_eta_min)/2;
+    _tiles_ieta_min = 0;
+    _tiles_ieta_max = 1;
+    // the eta max value is being taken as the lower edge of the
+    // highest-y tile
+    _tiles_eta_max -= _tile_size_eta;
+  } else {
+    _tiles_ieta_min = int(floor(_tiles_eta_min/_tile_size_eta));
+    _tiles_ieta_max = int(floor( _tiles_eta_max/_tile_size_eta));
+    _tiles_eta_min = _tiles_ieta_min * _tile_size_eta;
+    _tiles_eta_max = _tiles_ieta_max * _tile_size_eta;
+  }
+
+  _tile_half_size_eta = _tile_size_eta * 0.5;
+  _tile_half_size_phi = _tile_size_phi * 0.5;
+
+  // set up information about whether we need to allow for "periodic" 
+  // wrapping tests in delta_phi calculations
+  vector<bool> use_periodic_delta_phi(_n_tiles_phi, false);
+  if (_n_tiles_phi <= 3) {
+    fill(use_periodic_delta_phi.begin(), use_periodic_delta_phi.end(), true);
+  } else {
+    use_periodic_delta_phi[0] = true;
+    use_periodic_delta_phi[_n_tiles_phi-1] = true;
+  }
+
+  // allocate the tiles
+  _tiles.resize((_tiles_ieta_max-_tiles_ieta_min+1)*_n_tiles_phi);
+
+  // now set up the cross-referencing between tiles
+  for (int ieta = _tiles_ieta_min; ieta <= _tiles_ieta_max; ieta++) {
+    for (int iphi = 0; iphi < _n_tiles_phi; iphi++) {
+      Tile9SoA * tile = & _tiles[_tile_index(ieta,iphi)];
+      // first element of tiles points to itself
+      tile->begin_tiles[0] =  tile;
+      Tile9SoA ** pptile = & (tile->begin_tiles[0]);
+      pptile++;
+      //
+      // set up L's in column to the left of X
+      tile->surrounding_tiles = pptile;
+      if (ieta > _tiles_ieta_min) {
+	for (int idphi = -1; idphi <=+1; idphi++) {
+	  *pptile = & _tiles[_tile_index(ieta-1,iphi+idphi)];
+	  pptile++;
+	}	
+      }
+      // now set up last L (below X)
+      *pptile = & _tiles[_tile_index(ieta,iphi-1)];
+      pptile++;
+      // set up first R (above X)
+      tile->RH_tiles = pptile;
+      *pptile = & _tiles[_tile_index(ieta,iphi+1)];
+      pptile++;
+      // set up remaining R's, to the right of X
+      if (ieta < _tiles_ieta_max) {
+	for (int idphi = -1; idphi <= +1; idphi++) {
+	  *pptile = & _tiles[_tile_index(ieta+1,iphi+idphi)];
+	  pptile++;
+	}	
+      }
+      // now put semaphore for end tile
+      tile->end_tiles = pptile;
+      // finally make sure tiles are untagged
+      tile->tagged = false;
+      // and store the information about periodicity in phi
+      tile->use_periodic_delta_phi = use_periodic_delta_phi[iphi];
+      // and ensure max distance is sensibly initialised
+      tile->max_NN_dist = 0;
+      // and also position of centre of tile
+      tile->eta_centre = (ieta-_tiles_ieta_min+0.5)*_tile_size_eta + _tiles_eta_min;
+      tile->phi_centre = (iphi+0.5)*_tile_size_phi;
+    }
+  }
+
+}
+
+//----------------------------------------------------------------------
+/// return the tile index corresponding to the given eta,phi point
+int LazyTiling9SoA::_tile_index(const double eta, const double phi) const {
+  int ieta, iphi;
+  if      (eta <= _tiles_eta_min) {ieta = 0;}
+  else if (eta >= _tiles_eta_max) {ieta = _tiles_ieta_max-_tiles_ieta_min;}
+  else {
+    ieta = int(((eta - _tiles_eta_min) / _tile_size_eta));
+    // following needed in case of rare but nasty rounding errors
+    if (ieta > _tiles_ieta_max-_tiles_ieta_min) {
+      ieta = _tiles_ieta_max-_tiles_ieta_min;} 
+  }
+  // allow for some extent of being beyond range in calculation of phi
+  // as well
+  iphi = int((phi+twopi)/_tile_size_phi) % _n_tiles_phi;
+  return (iphi + ieta * _n_tiles_phi);
+}
+
+
+//----------------------------------------------------------------------
+// sets up information regarding the tiling of the given jet
+inline void LazyTiling9SoA::_tj_set_jetinfo( SoATiledJet * const jet,
+					      const int _jets_index) {
+  // first call the generic setup
+  _bj_set_jetinfo<>(jet, _jets_index);
+
+  // Find out which tile it belonds to
+  jet->tile_index = _tile_index(jet->eta, jet->phi);
+
+  // and append it to the tile's arrays
+  Tile9SoA * tile = &_tiles[jet->tile_index];
+  if (tile->size == tile->capacity) _grow_tile(tile);
+  jet->tile_slot = tile->size;
+  _tile_eta [tile->begin + tile->size] = jet->eta;
+  _tile_phi [tile->begin + tile->size] = jet->phi;
+  _tile_jets[tile->begin + tile->size] = jet;
+  tile->size++;
+}
+
+
+//----------------------------------------------------------------------
+/// moves a full tile to the end of the shared arrays, with twice its
+/// previous capacity (the old space is simply abandoned)
+void LazyTiling9SoA::_grow_tile(Tile9SoA * tile) {
+  int new_begin    = _tile_eta.size();
+  int new_capacity = max(2*tile->capacity, 4);
+  _tile_eta.resize (new_begin + new_capacity);
+  _tile_phi.resize (new_begin + new_capacity);
+  _tile_jets.resize(new_begin + new_capacity);
+  for (int i = 0; i < tile->size; i++) {
+    _tile_eta [new_begin + i] = _tile_eta [tile->begin + i];
+    _tile_phi [new_begin + i] = _tile_phi [tile->begin + i];
+    _tile_jets[new_begin + i] = _tile_jets[tile->begin + i];
+  }
+  tile->begin    = new_begin;
+  tile->capacity = new_capacity;
+}
+
+
+//----------------------------------------------------------------------
+/// removes the jet from its tile by moving the tile's last jet into
+/// its slot
+void LazyTiling9SoA::_bj_remove_from_tiles(SoATiledJet * const jet) {
+  Tile9SoA * tile = & _tiles[jet->tile_index];
+  int slot = tile->begin + jet->tile_slot;
+  int last = tile->begin + tile->size - 1;
+
+  if (slot != last) {
+    _tile_eta [slot] = _tile_eta [last];
+    _tile_phi [slot] = _tile_phi [last];
+    _tile_jets[slot] = _tile_jets[last];
+    _tile_jets[slot]->tile_slot = jet->tile_slot;
+  }
+  tile->size--;
+}
+
+
+//----------------------------------------------------------------------
+/// adds tiles that are "neighbours" of a jet if a neighbouring tile's
+/// max_NN_dist is >= the distance between the jet and the nearest
+/// point on the tile. It ignores tiles that have already been tagged.
+inline void LazyTiling9SoA::_add_untagged_neighbours_to_tile_union_using_max_info(
+               const SoATiledJet * jet, 
+	       vector<int> & tile_union, int & n_near_tiles)  {
+  Tile9SoA & tile = _tiles[jet->tile_index];
+  
+  for (Tile9SoA ** near_tile = tile.begin_tiles; near_tile != tile.end_tiles; near_tile++){
+    if ((*near_tile)->tagged) continue;
+    // here we are not allowed to miss a tile due to some rounding
+    // error. We therefore allow for a margin of security
+    double dist = _distance_to_tile(jet, *near_tile) - tile_edge_security_margin;
+    if (dist > (*near_tile)->max_NN_dist) continue;
+
+    (*near_tile)->tagged = true;
+    // get the tile number
+    tile_union[n_near_tiles] = *near_tile - & _tiles[0];
+    n_near_tiles++;
+  }
+}
+
+
+//----------------------------------------------------------------------
+/// returns a particle's distance to the edge of the specified tile
+inline double LazyTiling9SoA::_distance_to_tile(const SoATiledJet * bj, const Tile9SoA * tile) const {
+  // see LazyTiling9::_distance_to_tile for why deta is measured from
+  // the tile centres
+  double deta;
+  if (_tiles[bj->tile_index].eta_centre == tile->eta_centre) deta = 0;
+  else   deta = std::abs(bj->eta - tile->eta_centre) - _tile_half_size_eta;
+
+  double dphi = std::abs(bj->phi - tile->phi_centre);
+  if (dphi > pi) dphi = twopi-dphi;
+  dphi -= _tile_half_size_phi;
+  if (dphi < 0) dphi = 0;
+
+  return dphi*dphi + deta*deta;
+}
+
+
+//----------------------------------------------------------------------
+/// The distance kernel: a branch-free loop over the contiguous
+/// rapidity and phi arrays of the tile. The periodic form of dphi is
+/// used throughout; away from the phi=0 edge it gives the same result
+/// as the non-periodic form of LazyTiling9.
+inline void LazyTiling9SoA::_distances_to_tile_jets(const SoATiledJet * jet,
+                                                    const Tile9SoA * tile,
+                                                    int n, double * dist) const {
+  if (n == 0) return;
+  const double * eta = & _tile_eta[tile->begin];
+  const double * phi = & _tile_phi[tile->begin];
+  const double jet_eta = jet->eta;
+  const double jet_phi = jet->phi;
+  int i = 0;
+#ifdef __SSE2__
+  // two distances at a time; the same operations as the scalar loop
+  // below, so the results are identical
+  const __m128d v_eta   = _mm_set1_pd(jet_eta);
+  const __m128d v_phi   = _mm_set1_pd(jet_phi);
+  const __m128d v_pi    = _mm_set1_pd(pi);
+  const __m128d v_twopi = _mm_set1_pd(twopi);
+  const __m128d v_sign  = _mm_set1_pd(-0.0);
+  for (; i + 1 < n; i += 2) {
+    __m128d dphi = _mm_andnot_pd(v_sign, _mm_sub_pd(v_phi, _mm_loadu_pd(phi+i)));
+    __m128d deta = _mm_sub_pd(v_eta, _mm_loadu_pd(eta+i));
+    __m128d wrap = _mm_cmpgt_pd(dphi, v_pi);
+    dphi = _mm_or_pd(_mm_and_pd(wrap, _mm_sub_pd(v_twopi, dphi)),
+                     _mm_andnot_pd(wrap, dphi));
+    _mm_storeu_pd(dist+i, _mm_add_pd(_mm_mul_pd(dphi, dphi),
+                                     _mm_mul_pd(deta, deta)));
+  }
+#endif
+  for (; i < n; i++) {
+    double dphi = std::abs(jet_phi - phi[i]);
+    double deta = jet_eta - eta[i];
+    dphi = (dphi > pi) ? twopi - dphi : dphi;
+    dist[i] = dphi*dphi + deta*deta;
+  }
+}
+
+
+//----------------------------------------------------------------------
+/// given the distance between jetX and jetI, updates the NN
+/// information if relevant; also pushes identity of jetI onto
+/// the vector of jets for minheap, to signal that it will have
+/// to be handled later.
+inline void LazyTiling9SoA::_update_jetX_jetI_NN(SoATiledJet * jetX, SoATiledJet * jetI, double dist,
+                                                 vector<SoATiledJet *> & jets_for_minheap) {
+  if (jetI == jetX) return;
+  if (dist < jetI->NN_dist) {
+    jetI->NN_dist = dist;
+    jetI->NN = jetX;
+    // label jetI as needing heap action...
+    if (!jetI->minheap_update_needed()) {
+      jetI->label_minheap_update_needed();
+      jets_for_minheap.push_back(jetI);
+    }
+  }
+  if (dist < jetX->NN_dist) {
+    jetX->NN_dist = dist;
+    jetX->NN      = jetI;
+  }
+}
+
+
+//----------------------------------------------------------------------
+/// recomputes the NN of jetI from scratch
+inline void LazyTiling9SoA::_set_NN(SoATiledJet * jetI, 
+                                    vector<SoATiledJet *> & jets_for_minheap) {
+  jetI->NN_dist = _R2;
+  jetI->NN      = NULL;
+  // label jetI as needing heap action...
+  if (!jetI->minheap_update_needed()) {
+    jetI->label_minheap_update_needed();
+    jets_for_minheap.push_back(jetI);}
+  // now go over tiles that are neighbours of I (include own tile)
+  Tile9SoA * tile_ptr = &_tiles[jetI->tile_index];
+  double * dist = & _set_NN_dist_buffer[0];
+  for (Tile9SoA ** near_tile  = tile_ptr->begin_tiles; 
+       near_tile != tile_ptr->end_tiles; near_tile++) {
+    if (jetI->NN_dist < _distance_to_tile(jetI, *near_tile)) continue;
+    // and then over the contents of that tile
+    int n_in_tile = (*near_tile)->size;
+    _distances_to_tile_jets(jetI, *near_tile, n_in_tile, dist);
+    SoATiledJet * const * jets = n_in_tile ? & _tile_jets[(*near_tile)->begin] : NULL;
+    double NN_dist = jetI->NN_dist;
+    int    NN_slot = -1;
+    for (int j = 0; j < n_in_tile; j++) {
+      if (dist[j] < NN_dist && jets[j] != jetI) {NN_dist = dist[j]; NN_slot = j;}
+    }
+    if (NN_slot >= 0) {jetI->NN_dist = NN_dist; jetI->NN = jets[NN_slot];}
+  }
+}
+
+
+void LazyTiling9SoA::run() {
+
+  int n = _jets.size();
+  if (n == 0) return; 
+
+  SoATiledJet * briefjets = new SoATiledJet[n];
+  SoATiledJet * jetA = briefjets, * jetB;
+  // avoid warning about uninitialised oldB below; 
+  // only valid for n>=1 (hence the test n==0 test above)
+  SoATiledJet oldB = briefjets[0]; 
+
+  // will be used quite deep inside loops, but declare it here so that
+  // memory (de)allocation gets done only once
+  vector<int> tile_union(3*n_tile_neighbours);
+
+  // no tile can ever hold more than n jets
+  _dist_buffer.resize(n);
+  _set_NN_dist_buffer.resize(n);
+  double * dist = & _dist_buffer[0];
+  
+  // initialise the basic jet info, first laying out the tile arrays
+  // with room for the jets that start in each tile (the occupancy
+  // only grows by one merged jet at a time, so add a little headroom)
+  vector<int> tile_count(_tiles.size(), 0);
+  for (int i = 0; i< n; i++) {
+    tile_count[_tile_index(_jets[i].rap(), _jets[i].phi_02pi())]++;
+  }
+  int n_slots = 0;
+  for (unsigned int itile = 0; itile < _tiles.size(); itile++) {
+    _tiles[itile].begin    = n_slots;
+    _tiles[itile].size     = 0;
+    _tiles[itile].capacity = tile_count[itile] + 2;
+    n_slots += _tiles[itile].capacity;
+  }
+  _tile_eta.resize(n_slots);
+  _tile_phi.resize(n_slots);
+  _tile_jets.resize(n_slots);
+  for (int i = 0; i< n; i++) {
+    _tj_set_jetinfo(jetA, i);
+    jetA++; // move on to next entry of briefjets
+  }
+  SoATiledJet * head = briefjets; // a nicer way of naming start
+
+  // set up the initial nearest neighbour information
+  vector<Tile9SoA>::iterator tile;
+  for (tile = _tiles.begin(); tile != _tiles.end(); tile++) {
+    // first do it on this tile, comparing each jet with the ones
+    // stored before it
+    int n_in_tile = tile->size;
+    for (int a = 1; a < n_in_tile; a++) {
+      jetA = _tile_jets[tile->begin + a];
+      _distances_to_tile_jets(jetA, &*tile, a, dist);
+      for (int b = 0; b < a; b++) {
+        jetB = _tile_jets[tile->begin + b];
+	if (dist[b] < jetA->NN_dist) {jetA->NN_dist = dist[b]; jetA->NN = jetB;}
+	if (dist[b] < jetB->NN_dist) {jetB->NN_dist = dist[b]; jetB->NN = jetA;}
+      }
+    }
+    for (int a = 0; a < n_in_tile; a++) {
+      jetA = _tile_jets[tile->begin + a];
+      if (jetA->NN_dist > tile->max_NN_dist) tile->max_NN_dist = jetA->NN_dist;
+    }
+  }
+  for (tile = _tiles.begin(); tile != _tiles.end(); tile++) {
+    // then do it for RH tiles; no need to do it for LH tiles, since
+    // they are implicitly done when we set NN for both jetA and jetB
+    // on the RH tiles.
+    int n_in_tile = tile->size;
+    for (Tile9SoA ** RTile = tile->RH_tiles; RTile != tile->end_tiles; RTile++) {
+      int n_in_RTile = (*RTile)->size;
+      if (n_in_RTile == 0) continue;
+      for (int a = 0; a < n_in_tile; a++) {
+        jetA = _tile_jets[tile->begin + a];
+        double dist_to_tile = _distance_to_tile(jetA, *RTile);
+        // it only makes sense to do a tile if jetA is close enough to the Rtile
+        // either for a jet in the Rtile to be closer to jetA than it's current NN
+        // or if jetA could be closer to something in the Rtile than the largest
+        // NN distance within the RTile.
+        bool relevant_for_jetA  = dist_to_tile <= jetA->NN_dist;
+        bool relevant_for_RTile = dist_to_tile <= (*RTile)->max_NN_dist;
+        if (relevant_for_jetA || relevant_for_RTile) {
+          _distances_to_tile_jets(jetA, *RTile, n_in_RTile, dist);
+          for (int b = 0; b < n_in_RTile; b++) {
+            jetB = _tile_jets[(*RTile)->begin + b];
+            if (dist[b] < jetA->NN_dist) {jetA->NN_dist = dist[b]; jetA->NN = jetB;}
+            if (dist[b] < jetB->NN_dist) {jetB->NN_dist = dist[b]; jetB->NN = jetA;}
+          }
+        } 
+      }
+    }
+  }
+  // Now update the max_NN_dist within each tile. Not strictly
+  // necessary, because existing max_NN_dist is an upper bound.  but
+  // costs little and may give some efficiency gain later.
+  for (tile = _tiles.begin(); tile != _tiles.end(); tile++) {
+    tile->max_NN_dist = 0;
+    for (int a = 0; a < tile->size; a++) {
+      jetA = _tile_jets[tile->begin + a];
+      if (jetA->NN_dist > tile->max_NN_dist) tile->max_NN_dist = jetA->NN_dist;
+    }
+  }
+
+  vector<double> diJs(n);
+  for (int i = 0; i < n; i++) {
+    diJs[i] = _bj_diJ(&briefjets[i]);
+    briefjets[i].label_minheap_update_done();
+  }
+  MinHeap minheap(diJs);
+  // have a stack telling us which jets we'll have to update on the heap
+  vector<SoATiledJet *> jets_for_minheap;
+  jets_for_minheap.reserve(n); 
+
+  // now run the recombination loop
+  int history_location = n-1;
+  while (n > 0) {
+
+    double diJ_min = minheap.minval() *_invR2;
+    jetA = head + minheap.minloc();
+
+    // do the recombination between A and B
+    history_location++;
+    jetB = jetA->NN;
+
+    if (jetB != NULL) {
+      // jet-jet recombination
+      // If necessary relabel A & B to ensure jetB < jetA, that way if
+      // the larger of them == newtail then that ends up being jetA and 
+      // the new jet that is added as jetB is inserted in a position that
+      // has a future!
+      if (jetA < jetB) {std::swap(jetA,jetB);}
+
+      int nn; // new jet index
+      _cs.plugin_record_ij_recombination(jetA->_jets_index, jetB->_jets_index, diJ_min, nn);
+      
+      // what was jetB will now become the new jet
+      _bj_remove_from_tiles(jetA);
+      oldB = * jetB;  // take a copy because we will need it...
+      _bj_remove_from_tiles(jetB);
+      _tj_set_jetinfo(jetB, nn); // cause jetB to become _jets[nn]
+                                 // (also registers the jet in the tiling)
+    } else {
+      // jet-beam recombination
+      // get the hist_index
+      _cs.plugin_record_iB_recombination(jetA->_jets_index, diJ_min);
+      _bj_remove_from_tiles(jetA);
+    }
+
+    // remove the minheap entry for jetA
+    minheap.remove(jetA-head);
+
+    int n_near_tiles = 0;
+
+    // Initialise jetB's NN distance as well as updating it for other
+    // particles. While doing so, examine whether jetA or old jetB was
+    // some other particle's NN.
+    if (jetB != NULL) {
+      Tile9SoA & jetB_tile = _tiles[jetB->tile_index];
+      for (Tile9SoA ** near_tile  = jetB_tile.begin_tiles; 
+	           near_tile != jetB_tile.end_tiles; near_tile++) {
+
+    	double dist_to_tile = _distance_to_tile(jetB, *near_tile);
+        // use <= in next line so that on first tile, relevant_for_jetB is 
+        // set to true
+    	bool relevant_for_jetB  = dist_to_tile <= jetB->NN_dist;
+    	bool relevant_for_near_tile = dist_to_tile <= (*near_tile)->max_NN_dist;
+        bool relevant = relevant_for_jetB || relevant_for_near_tile;
+        if (! relevant) continue;
+        // now label this tile as having been considered (so that we 
+        // don't go over it again later)
+        tile_union[n_near_tiles] = *near_tile - & _tiles[0];
+        (*near_tile)->tagged = true;
+        n_near_tiles++;
+        
+        // if going over the neighbouring tile's jets, check anyway
+        // whether A or B were nearest neighbours, since it comes at a
+        // modest cost relative to the distance computation (and we would
+        // in most cases have to do it again later anyway).
+        int n_in_tile = (*near_tile)->size;
+        _distances_to_tile_jets(jetB, *near_tile, n_in_tile, dist);
+        for (int i = 0; i < n_in_tile; i++) {
+          SoATiledJet * jetI = _tile_jets[(*near_tile)->begin + i];
+          if (jetI->NN == jetA || jetI->NN == jetB) _set_NN(jetI, jets_for_minheap);
+          _update_jetX_jetI_NN(jetB, jetI, dist[i], jets_for_minheap);
+        }
+      }
+    }
+
+    // first establish the set of tiles over which we are going to
+    // have to run searches for updated and new nearest-neighbours --
+    // basically a combination of vicinity of the tiles of the two old
+    // and one new jet.
+    int n_done_tiles = n_near_tiles;
+    _add_untagged_neighbours_to_tile_union_using_max_info(jetA, 
+       					   tile_union, n_near_tiles);
+    if (jetB != NULL) {
+	_add_untagged_neighbours_to_tile_union_using_max_info(&oldB,
+							      tile_union,n_near_tiles);
+      jetB->label_minheap_update_needed();
+      jets_for_minheap.push_back(jetB);
+    }
+
+
+    // first untag the tiles we have already dealt with
+    for (int itile = 0; itile < n_done_tiles; itile++) {
+      _tiles[tile_union[itile]].tagged = false;
+    }
+    // now run over the tiles that were tagged earlier and that we haven't yet
+    // had a change to visit.
+    for (int itile = n_done_tiles; itile < n_near_tiles; itile++) {
+      Tile9SoA * tile_ptr = &_tiles[tile_union[itile]];
+      tile_ptr->tagged = false;
+      // run over all jets in the current tile
+      for (int i = 0; i < tile_ptr->size; i++) {
+        SoATiledJet * jetI = _tile_jets[tile_ptr->begin + i];
+        // see if jetI had jetA or jetB as a NN -- if so recalculate the NN
+        if (jetI->NN == jetA || (jetI->NN == jetB && jetB != NULL)) {
+          _set_NN(jetI, jets_for_minheap);
+        }
+      }
+    }
+
+    // deal with jets whose minheap entry needs updating
+    while (jets_for_minheap.size() > 0) {
+      SoATiledJet * jetI = jets_for_minheap.back(); 
+      jets_for_minheap.pop_back();
+      minheap.update(jetI-head, _bj_diJ(jetI));
+      jetI->label_minheap_update_done();
+      // handle max_NN_dist update for all jets that might have
+      // seen a change (increase) of distance
+      Tile9SoA & tile_I = _tiles[jetI->tile_index];
+      if (tile_I.max_NN_dist < jetI->NN_dist) tile_I.max_NN_dist = jetI->NN_dist;
+    }
+    n--;
+  }
+
+  // final cleaning up;
+  delete[] briefjets;
+}
+
+FASTJET_END_NAMESPACE
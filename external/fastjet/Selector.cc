@@ -44,29 +44,75 @@ FASTJET_BEGIN_NAMESPACE      // defined in fastjet/internal/base.hh
 // implementations of some of the more complex bits of Selector
 //----------------------------------------------------------------------
 
-// implementation of the operator() acting on a vector of jets
-std::vector<PseudoJet> Selector::operator()(const std::vector<PseudoJet> & jets) const {
-  std::vector<PseudoJet> result;
-  const SelectorWorker * worker_local = validated_worker();
-  if (worker_local->applies_jet_by_jet()) {
-    //if (false) {
-    // for workers that apply jet by jet, this is more efficient
-    for (std::vector<PseudoJet>::const_iterator jet = jets.begin(); 
-         jet != jets.end(); jet++) {
-      if (worker_local->pass(*jet)) result.push_back(*jet);
+// the values of a quantity for all the jets, computed at the first call
+const double * SelectorKinematics::values(Quantity quantity) const {
+  std::vector<double> & values_local = _values[quantity];
+  if (!_computed[quantity]) {
+    _computed[quantity] = true;
+    values_local.resize(_jets.size());
+    switch (quantity) {
+    case pt2:
+      for (unsigned i = 0; i < _jets.size(); i++) values_local[i] = _jets[i].perp2();
+      break;
+    case rap:
+      for (unsigned i = 0; i < _jets.size(); i++) values_local[i] = _jets[i].rap();
+      break;
+    case abs_rap:
+      for (unsigned i = 0; i < _jets.size(); i++) values_local[i] = abs(_jets[i].rap());
+      break;
+    case eta:
+      for (unsigned i = 0; i < _jets.size(); i++) values_local[i] = _jets[i].eta();
+      break;
+    case abs_eta:
+      for (unsigned i = 0; i < _jets.size(); i++) values_local[i] = abs(_jets[i].eta());
+      break;
+    case phi:
+      for (unsigned i = 0; i < _jets.size(); i++) values_local[i] = _jets[i].phi();
+      break;
+    default:
+      throw Error("SelectorKinematics: unknown quantity");
+    }
+  }
+  return values_local.empty() ? 0 : &values_local[0];
+}
+
+//----------------------------------------------------------------------
+// marks the jets that pass the worker: all at once for the simple
+// kinematic selectors, otherwise jet by jet or, for workers that can
+// only be applied to entire vectors, through the terminator
+static void select_jets(const SelectorWorker * worker,
+                        const std::vector<PseudoJet> & jets,
+                        std::vector<char> & passes) {
+  if (worker->applies_jet_by_jet()) {
+    SelectorKinematics kinematics(jets);
+    if (worker->pass_batch(kinematics, passes)) return;
+
+    passes.resize(jets.size());
+    for (unsigned i = 0; i < jets.size(); i++) {
+      passes[i] = worker->pass(jets[i]);
     }
   } else {
-    // for workers that can only be applied to entire vectors,
-    // go through the following
     std::vector<const PseudoJet *> jetptrs(jets.size());
     for (unsigned i = 0; i < jets.size(); i++) {
       jetptrs[i] = & jets[i];
     }
-    worker_local->terminator(jetptrs);
+    worker->terminator(jetptrs);
+    passes.resize(jets.size());
     for (unsigned i = 0; i < jetptrs.size(); i++) {
-      if (jetptrs[i]) result.push_back(jets[i]);
+      passes[i] = (jetptrs[i] != NULL);
     }
   }
+}
+
+//----------------------------------------------------------------------
+// implementation of the operator() acting on a vector of jets
+std::vector<PseudoJet> Selector::operator()(const std::vector<PseudoJet> & jets) const {
+  std::vector<PseudoJet> result;
+  std::vector<char> passes;
+  select_jets(validated_worker(), jets, passes);
+  for (unsigned i = 0; i < jets.size(); i++) {
+    if (passes[i]) result.push_back(jets[i]);
+  }
   return result;
 }
 
@@ -75,22 +121,10 @@ std::vector<PseudoJet> Selector::operator()(const std::vector<PseudoJet> & jets)
 // count the number of jets that pass the cuts
 unsigned int Selector::count(const std::vector<PseudoJet> & jets) const {
   unsigned n = 0;
-  const SelectorWorker * worker_local = validated_worker();
-  
-  // separate strategies according to whether the worker applies jet by jet
-  if (worker_local->applies_jet_by_jet()) {
-    for (unsigned i = 0; i < jets.size(); i++) {
-      if (worker_local->pass(jets[i])) n++;
-    }
-  } else {
-    std::vector<const PseudoJet *> jetptrs(jets.size());
-    for (unsigned i = 0; i < jets.size(); i++) {
-      jetptrs[i] = & jets[i];
-    }
-    worker_local->terminator(jetptrs);
-    for (unsigned i = 0; i < jetptrs.size(); i++) {
-      if (jetptrs[i]) n++;
-    }
+  std::vector<char> passes;
+  select_jets(validated_worker(), jets, passes);
+  for (unsigned i = 0; i < jets.size(); i++) {
+    if (passes[i]) n++;
   }
 
   return n;
@@ -100,22 +134,10 @@ unsigned int Selector::count(const std::vector<PseudoJet> & jets) const {
 // sum the momenta of the jets that pass the cuts
 PseudoJet Selector::sum(const std::vector<PseudoJet> & jets) const {
   PseudoJet this_sum(0,0,0,0);
-  const SelectorWorker * worker_local = validated_worker();
-  
-  // separate strategies according to whether the worker applies jet by jet
-  if (worker_local->applies_jet_by_jet()) {
-    for (unsigned i = 0; i < jets.size(); i++) {
-      if (worker_local->pass(jets[i])) this_sum += jets[i];
-    }
-  } else {
-    std::vector<const PseudoJet *> jetptrs(jets.size());
-    for (unsigned i = 0; i < jets.size(); i++) {
-      jetptrs[i] = & jets[i];
-    }
-    worker_local->terminator(jetptrs);
-    for (unsigned i = 0; i < jetptrs.size(); i++) {
-      if (jetptrs[i]) this_sum += jets[i];
-    }
+  std::vector<char> passes;
+  select_jets(validated_worker(), jets, passes);
+  for (unsigned i = 0; i < jets.size(); i++) {
+    if (passes[i]) this_sum += jets[i];
   }
 
   return this_sum;
@@ -125,22 +147,10 @@ PseudoJet Selector::sum(const std::vector<PseudoJet> & jets) const {
 // sum the (scalar) pt of the jets that pass the cuts
 double Selector::scalar_pt_sum(const std::vector<PseudoJet> & jets) const {
   double this_sum = 0.0;
-  const SelectorWorker * worker_local = validated_worker();
-  
-  // separate strategies according to whether the worker applies jet by jet
-  if (worker_local->applies_jet_by_jet()) {
-    for (unsigned i = 0; i < jets.size(); i++) {
-      if (worker_local->pass(jets[i])) this_sum += jets[i].pt();
-    }
-  } else {
-    std::vector<const PseudoJet *> jetptrs(jets.size());
-    for (unsigned i = 0; i < jets.size(); i++) {
-      jetptrs[i] = & jets[i];
-    }
-    worker_local->terminator(jetptrs);
-    for (unsigned i = 0; i < jetptrs.size(); i++) {
-      if (jetptrs[i]) this_sum += jets[i].pt();
-    }
+  std::vector<char> passes;
+  select_jets(validated_worker(), jets, passes);
+  for (unsigned i = 0; i < jets.size(); i++) {
+    if (passes[i]) this_sum += jets[i].pt();
   }
 
   return this_sum;
@@ -154,32 +164,17 @@ void Selector::sift(const std::vector<PseudoJet> & jets,
 		    std::vector<PseudoJet> & jets_that_pass,
 		    std::vector<PseudoJet> & jets_that_fail
 		    ) const {
-  const SelectorWorker * worker_local = validated_worker();
-  
+  std::vector<char> passes;
+  select_jets(validated_worker(), jets, passes);
+
   jets_that_pass.clear();
   jets_that_fail.clear();
-  
-  // separate strategies according to whether the worker applies jet by jet
-  if (worker_local->applies_jet_by_jet()) {
-    for (unsigned i = 0; i < jets.size(); i++) {
-      if (worker_local->pass(jets[i])) {
-	jets_that_pass.push_back(jets[i]);
-      } else {
-	jets_that_fail.push_back(jets[i]);
-      }
-    }
-  } else {
-    std::vector<const PseudoJet *> jetptrs(jets.size());
-    for (unsigned i = 0; i < jets.size(); i++) {
-      jetptrs[i] = & jets[i];
-    }
-    worker_local->terminator(jetptrs);
-    for (unsigned i = 0; i < jetptrs.size(); i++) {
-      if (jetptrs[i]) {
-	jets_that_pass.push_back(jets[i]);
-      } else {
-	jets_that_fail.push_back(jets[i]);
-      }
+
+  for (unsigned i = 0; i < jets.size(); i++) {
+    if (passes[i]) {
+      jets_that_pass.push_back(jets[i]);
+    } else {
+      jets_that_fail.push_back(jets[i]);
     }
   }
 }
@@ -246,6 +241,12 @@ public:
     // everything passes, hence nothing to nullify
     return;
   }
+
+  /// all the jets pass
+  virtual bool pass_batch(const SelectorKinematics & kinematics, vector<char> & passes) const {
+    passes.assign(kinematics.size(), 1);
+    return true;
+  }
   
   /// returns a description of the worker
   virtual string description() const { return "Identity";}
@@ -285,6 +286,13 @@ public:
     return ! _s.pass(jet);
   } 
 
+  /// the jets that fail the base selector, when it can be applied at once
+  virtual bool pass_batch(const SelectorKinematics & kinematics, vector<char> & passes) const {
+    if (! _s.worker()->pass_batch(kinematics, passes)) return false;
+    for (unsigned int i=0; i<passes.size(); i++) passes[i] = ! passes[i];
+    return true;
+  }
+
   /// returns true if this can be applied jet by jet
   virtual bool applies_jet_by_jet() const {return _s.applies_jet_by_jet();}
 
@@ -399,6 +407,15 @@ public:
     return _s1.pass(jet) && _s2.pass(jet);
   }
 
+  /// the jets that pass both selectors, when both can be applied at once
+  virtual bool pass_batch(const SelectorKinematics & kinematics, vector<char> & passes) const {
+    vector<char> s2_passes;
+    if (! _s1.worker()->pass_batch(kinematics, passes)) return false;
+    if (! _s2.worker()->pass_batch(kinematics, s2_passes)) return false;
+    for (unsigned int i=0; i<passes.size(); i++) passes[i] = passes[i] & s2_passes[i];
+    return true;
+  }
+
   /// select the jets in the list that pass both selectors
   virtual void terminator(vector<const PseudoJet *> & jets) const {
     // if we can apply the selector jet-by-jet, call the base selector
@@ -466,6 +483,15 @@ public:
     return _s1.pass(jet) || _s2.pass(jet);
   }
 
+  /// the jets that pass either selector, when both can be applied at once
+  virtual bool pass_batch(const SelectorKinematics & kinematics, vector<char> & passes) const {
+    vector<char> s2_passes;
+    if (! _s1.worker()->pass_batch(kinematics, passes)) return false;
+    if (! _s2.worker()->pass_batch(kinematics, s2_passes)) return false;
+    for (unsigned int i=0; i<passes.size(); i++) passes[i] = passes[i] | s2_passes[i];
+    return true;
+  }
+
   /// returns true if this can be applied jet by jet
   virtual bool applies_jet_by_jet() const {
     // watch out, even though it's the "OR" selector, to be applied jet
@@ -577,6 +603,8 @@ public:
   virtual double operator()(const PseudoJet & jet ) const =0;
   virtual string description() const =0;
   virtual bool is_geometric() const { return false;}
+  // the quantity in SelectorKinematics, false if it has none
+  virtual bool batch_quantity(SelectorKinematics::Quantity &) const { return false;}
   virtual double comparison_value() const {return _q;}
   virtual double description_value() const {return comparison_value();}
 protected:
@@ -602,6 +630,17 @@ public:
   /// returns true is the given object passes the selection pt cut
   virtual bool pass(const PseudoJet & jet) const {return _qmin(jet) >= _qmin.comparison_value();}
 
+  /// the same cut on all the jets at once
+  virtual bool pass_batch(const SelectorKinematics & kinematics, vector<char> & passes) const {
+    SelectorKinematics::Quantity quantity;
+    if (! _qmin.batch_quantity(quantity)) return false;
+    const double * q = kinematics.values(quantity);
+    const double qmin = _qmin.comparison_value();
+    passes.resize(kinematics.size());
+    for (unsigned int i=0; i<passes.size(); i++) passes[i] = (q[i] >= qmin);
+    return true;
+  }
+
   /// returns a description of the worker
   virtual string description() const {
     ostringstream ostr;
@@ -626,6 +665,17 @@ public:
   /// returns true is the given object passes the selection pt cut
   virtual bool pass(const PseudoJet & jet) const {return _qmax(jet) <= _qmax.comparison_value();}
 
+  /// the same cut on all the jets at once
+  virtual bool pass_batch(const SelectorKinematics & kinematics, vector<char> & passes) const {
+    SelectorKinematics::Quantity quantity;
+    if (! _qmax.batch_quantity(quantity)) return false;
+    const double * q = kinematics.values(quantity);
+    const double qmax = _qmax.comparison_value();
+    passes.resize(kinematics.size());
+    for (unsigned int i=0; i<passes.size(); i++) passes[i] = (q[i] <= qmax);
+    return true;
+  }
+
   /// returns a description of the worker
   virtual string description() const {
     ostringstream ostr;
@@ -653,6 +703,18 @@ public:
     return (q >= _qmin.comparison_value()) && (q <= _qmax.comparison_value());
   }
 
+  /// the same cut on all the jets at once
+  virtual bool pass_batch(const SelectorKinematics & kinematics, vector<char> & passes) const {
+    SelectorKinematics::Quantity quantity;
+    if (! _qmin.batch_quantity(quantity)) return false;
+    const double * q = kinematics.values(quantity);
+    const double qmin = _qmin.comparison_value();
+    const double qmax = _qmax.comparison_value();
+    passes.resize(kinematics.size());
+    for (unsigned int i=0; i<passes.size(); i++) passes[i] = (q[i] >= qmin) & (q[i] <= qmax);
+    return true;
+  }
+
   /// returns a description of the worker
   virtual string description() const {
     ostringstream ostr;
@@ -675,6 +737,7 @@ public:
   QuantityPt2(double pt) : QuantitySquareBase(pt){}
   virtual double operator()(const PseudoJet & jet ) const { return jet.perp2();}
   virtual string description() const {return "pt";}
+  virtual bool batch_quantity(SelectorKinematics::Quantity & quantity) const { quantity = SelectorKinematics::pt2; return true;}
 };  
 
 // returns a selector for a minimum pt
@@ -776,6 +839,7 @@ public:
   QuantityRap(double rap) : QuantityBase(rap){}
   virtual double operator()(const PseudoJet & jet ) const { return jet.rap();}
   virtual string description() const {return "rap";}
+  virtual bool batch_quantity(SelectorKinematics::Quantity & quantity) const { quantity = SelectorKinematics::rap; return true;}
   virtual bool is_geometric() const { return true;}
 };  
 
@@ -839,6 +903,7 @@ public:
   QuantityAbsRap(double absrap) : QuantityBase(absrap){}
   virtual double operator()(const PseudoJet & jet ) const { return abs(jet.rap());}
   virtual string description() const {return "|rap|";}
+  virtual bool batch_quantity(SelectorKinematics::Quantity & quantity) const { quantity = SelectorKinematics::abs_rap; return true;}
   virtual bool is_geometric() const { return true;}
 };  
 
@@ -894,6 +959,7 @@ public:
   QuantityEta(double eta) : QuantityBase(eta){}
   virtual double operator()(const PseudoJet & jet ) const { return jet.eta();}
   virtual string description() const {return "eta";}
+  virtual bool batch_quantity(SelectorKinematics::Quantity & quantity) const { quantity = SelectorKinematics::eta; return true;}
   // virtual bool is_geometric() const { return true;} // not strictly only y and phi-dependent
 };  
 
@@ -920,6 +986,7 @@ public:
   QuantityAbsEta(double abseta) : QuantityBase(abseta){}
   virtual double operator()(const PseudoJet & jet ) const { return abs(jet.eta());}
   virtual string description() const {return "|eta|";}
+  virtual bool batch_quantity(SelectorKinematics::Quantity & quantity) const { quantity = SelectorKinematics::abs_eta; return true;}
   virtual bool is_geometric() const { return true;}
 };  
 
@@ -964,6 +1031,19 @@ public:
     return (dphi <= _phispan);
   }
 
+  /// the same cut on all the jets at once
+  virtual bool pass_batch(const SelectorKinematics & kinematics, vector<char> & passes) const {
+    const double * phi = kinematics.values(SelectorKinematics::phi);
+    passes.resize(kinematics.size());
+    for (unsigned int i=0; i<passes.size(); i++) {
+      double dphi=phi[i]-_phimin;
+      if (dphi >= twopi) dphi -= twopi;
+      if (dphi < 0)      dphi += twopi;
+      passes[i] = (dphi <= _phispan);
+    }
+    return true;
+  }
+
   /// returns a description of the worker
   virtual string description() const {
     ostringstream ostr;
@@ -1347,6 +1427,16 @@ public:
     // otherwise, just call that method on the jet
     return (jet.perp2() >= _fraction2*_reference.perp2());
   }
+
+  /// the same cut on all the jets at once, once the reference is set
+  virtual bool pass_batch(const SelectorKinematics & kinematics, vector<char> & passes) const {
+    if (! _is_initialised) return false;
+    const double * pt2 = kinematics.values(SelectorKinematics::pt2);
+    const double pt2min = _fraction2*_reference.perp2();
+    passes.resize(kinematics.size());
+    for (unsigned int i=0; i<passes.size(); i++) passes[i] = (pt2[i] >= pt2min);
+    return true;
+  }
   
   /// returns a description of the worker
   virtual string description() const {
@@ -47,6 +47,37 @@ FASTJET_BEGIN_NAMESPACE      // defined in fastjet/internal/base.hh
 /// criteria that can be applied to PseudoJet(s).
 ///
 class Selector;
+
+//----------------------------------------------------------------------
+/// @ingroup selectors
+/// \class SelectorKinematics
+/// the kinematic quantities of a list of jets, each one computed for
+/// all the jets the first time a selector asks for it, so that the
+/// simple kinematic selectors can be applied to the whole list at once
+/// (see SelectorWorker::pass_batch)
+class SelectorKinematics {
+public:
+  /// the quantities that can be provided
+  enum Quantity {pt2, rap, abs_rap, eta, abs_eta, phi, n_quantities};
+
+  /// ctor, the jets must outlive the object
+  SelectorKinematics(const std::vector<PseudoJet> & jets) : _jets(jets) {
+    for (unsigned i = 0; i < n_quantities; i++) _computed[i] = false;
+  }
+
+  /// the number of jets
+  unsigned int size() const {return _jets.size();}
+
+  /// the values of a quantity for all the jets, in the order of the
+  /// jets, as given by the corresponding PseudoJet member
+  const double * values(Quantity quantity) const;
+
+private:
+  const std::vector<PseudoJet> & _jets;
+  mutable std::vector<double> _values[n_quantities];
+  mutable bool _computed[n_quantities];
+};
+
 //----------------------------------------------------------------------
 
 /// @ingroup selectors
@@ -87,6 +118,15 @@ public:
     }
   }
 
+  /// For the simple kinematic selectors (cuts on pt, rapidity,
+  /// pseudo-rapidity and phi, and their logical combinations), sets
+  /// passes[i] to whether the i-th jet passes, working on the
+  /// quantities of all the jets at once, and returns true. Returns
+  /// false, with passes left in an unspecified state, for the other
+  /// selectors, which are then applied jet by jet.
+  virtual bool pass_batch(const SelectorKinematics & /*kinematics*/,
+                          std::vector<char> & /*passes*/) const {return false;}
+
   /// returns true if this can be applied jet by jet
   virtual bool applies_jet_by_jet() const {return true;}
 
@@ -28,6 +28,15 @@ FASTJET_BEGIN_NAMESPACE      // defined in fastjet/internal/base.hh
 
 namespace contrib{
 
+// default: find the axes for each n separately
+std::vector<std::vector<fastjet::PseudoJet> > AxesFinder::getAxesUpTo(int n_max,
+                                                                     const std::vector<fastjet::PseudoJet>& inputs,
+                                                                     const std::vector<std::vector<fastjet::PseudoJet> >& seedAxes) const {
+   std::vector<std::vector<fastjet::PseudoJet> > axes;
+   for (int n = 1; n <= n_max; n++) axes.push_back(getAxes(n, inputs, seedAxes[n-1]));
+   return axes;
+}
+
 ///////
 //
 // Functions for minimization.
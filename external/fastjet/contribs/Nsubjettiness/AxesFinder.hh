@@ -59,6 +59,14 @@ public:
    virtual std::vector<fastjet::PseudoJet> getAxes(int n_jets,
                                                    const std::vector<fastjet::PseudoJet>& inputs,
                                                    const std::vector<fastjet::PseudoJet>& seedAxes) const = 0;
+
+   // Axes for every n from 1 to n_max, element n-1 holds the n axes (seedAxes
+   // is indexed the same way).  By default this calls getAxes for each n,
+   // finders that can share work between the different n overload it.
+   virtual std::vector<std::vector<fastjet::PseudoJet> > getAxesUpTo(int n_max,
+                                                                    const std::vector<fastjet::PseudoJet>& inputs,
+                                                                    const std::vector<std::vector<fastjet::PseudoJet> >& seedAxes) const;
+
    // convenient shorthand for squaring
    static inline double sq(double x) {return x*x;}
 
@@ -84,6 +92,16 @@ public:
       fastjet::ClusterSequence jet_clust_seq(inputs, _def);
       return jet_clust_seq.exclusive_jets(n_jets);
    }
+
+   // one clustering history gives the exclusive jets for every n
+   virtual std::vector<std::vector<fastjet::PseudoJet> > getAxesUpTo(int n_max,
+                                                                    const std::vector <fastjet::PseudoJet> & inputs,
+                                                                    const std::vector<std::vector<fastjet::PseudoJet> >& /*seedAxes*/) const {
+      fastjet::ClusterSequence jet_clust_seq(inputs, _def);
+      std::vector<std::vector<fastjet::PseudoJet> > axes;
+      for (int n = 1; n <= n_max; n++) axes.push_back(jet_clust_seq.exclusive_jets(n));
+      return axes;
+   }
    
 private:
    fastjet::JetDefinition _def;
@@ -165,9 +165,60 @@ TauComponents MeasureFunction::result_from_partition(const std::vector<fastjet::
    return TauComponents(jetPieces, beamPiece, tauDen, _has_denominator, _has_beam);
 }
 
-   
-   
-   
+
+// Partition and sum for every set of axes in one pass over the particles
+std::vector<TauComponents> MeasureFunction::result_up_to(const std::vector<fastjet::PseudoJet>& particles,
+                                                        const std::vector<std::vector<fastjet::PseudoJet> >& axes) const {
+
+   std::vector<std::vector<double> > jetPieces(axes.size());
+   std::vector<double> beamPieces(axes.size(), 0.0);
+   for (unsigned n = 0; n < axes.size(); n++) jetPieces[n].resize(axes[n].size(), 0.0);
+
+   double tauDen = 0.0;
+   if (!_has_denominator) tauDen = 1.0;  // if no denominator, then 1.0 for no normalization factor
+
+   for (unsigned i = 0; i < particles.size(); i++) {
+
+      // beam distance (or a large value) is the reference for every set of axes
+      double beamRsq;
+      if (_has_beam) beamRsq = beam_distance_squared(particles[i]);
+      else beamRsq = std::numeric_limits<double>::max();
+
+      bool have_beam_numerator = false;
+      double beamNumerator = 0.0;
+
+      if (_has_denominator) tauDen += denominator(particles[i]);
+
+      for (unsigned n = 0; n < axes.size(); n++) {
+         int j_min = -1;
+         double minRsq = beamRsq;
+         for (unsigned j = 0; j < axes[n].size(); j++) {
+            double tempRsq = jet_distance_squared(particles[i],axes[n][j]);
+            if (tempRsq < minRsq) {
+               minRsq = tempRsq;
+               j_min = j;
+            }
+         }
+
+         if (j_min == -1) {
+            assert(_has_beam);  // this should never happen.
+            if (!have_beam_numerator) {
+               beamNumerator = beam_numerator(particles[i]);
+               have_beam_numerator = true;
+            }
+            beamPieces[n] += beamNumerator;
+         } else {
+            jetPieces[n][j_min] += jet_numerator(particles[i],axes[n][j_min]);
+         }
+      }
+   }
+
+   std::vector<TauComponents> results;
+   for (unsigned n = 0; n < axes.size(); n++) {
+      results.push_back(TauComponents(jetPieces[n], beamPieces[n], tauDen, _has_denominator, _has_beam));
+   }
+   return results;
+}
    
 } //namespace contrib
 
@@ -168,6 +168,11 @@ public:
    // calculates the tau result using an existing partition
    TauComponents result_from_partition(const std::vector<fastjet::PseudoJet>& jet_partitioning, const std::vector<fastjet::PseudoJet>& axes, PseudoJet * beamPartitionStorage = NULL) const;
 
+   // Same as result, for several sets of axes at once (one set for each N).
+   // The particles are looped over only once, and the beam numerator and
+   // denominator are computed once per particle.
+   std::vector<TauComponents> result_up_to(const std::vector<fastjet::PseudoJet>& particles, const std::vector<std::vector<fastjet::PseudoJet> >& axes) const;
+
    // shorthand for squaring
    static inline double sq(double x) {return x*x;}
 
@@ -203,6 +203,28 @@ TauComponents Njettiness::getTauComponents(unsigned n_jets, const std::vector<fa
    return _current_tau_components;
 }
    
+
+// Calculates the TauComponents for N = 1..n_max from a shared axes search.
+std::vector<TauComponents> Njettiness::getTauComponentsUpTo(unsigned n_max, const std::vector<fastjet::PseudoJet> & inputJets) const {
+   if (_axes_def->supportsManualAxes()) {
+      throw Error("getTauComponentsUpTo can't be used with manual AxesDefinitions");
+   }
+
+   // as in getTauComponents, tau is zero when there aren't more particles than axes
+   std::vector<TauComponents> results(n_max);
+   unsigned n_found = inputJets.size() > n_max ? n_max : (inputJets.empty() ? 0 : inputJets.size() - 1);
+   if (n_found == 0) return results;
+
+   std::vector<std::vector<fastjet::PseudoJet> > noSeeds(n_found);
+   std::vector<std::vector<fastjet::PseudoJet> > axes = _startingAxesFinder->getAxesUpTo(n_found,inputJets,noSeeds);
+   if (_finishingAxesFinder) {
+      axes = _finishingAxesFinder->getAxesUpTo(n_found,inputJets,axes);
+   }
+
+   std::vector<TauComponents> found = _measureFunction->result_up_to(inputJets,axes);
+   for (unsigned n = 0; n < n_found; n++) results[n] = found[n];
+   return results;
+}
    
 // Partition a list of particles according to which N-jettiness axis they are closest to.
 // Return a vector of length _currentAxes.size() (which should be N).
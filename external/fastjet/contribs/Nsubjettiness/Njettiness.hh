@@ -128,6 +128,12 @@ public:
       return getTauComponents(n_jets, inputJets).tau();
    }
 
+   // Calculates the TauComponents for every N from 1 to n_max (element N-1
+   // holds tau_N), finding the starting axes for all N in one go and looping
+   // over the particles once.  Manual axes are not supported.  The current*
+   // information below is not updated.
+   std::vector<TauComponents> getTauComponentsUpTo(unsigned n_max, const std::vector<fastjet::PseudoJet> & inputJets) const;
+
    // Return all relevant information about tau components
    TauComponents currentTauComponents() const {return _current_tau_components;}
    // Return axes found by getTauComponents.
@@ -39,6 +39,19 @@ TauComponents Nsubjettiness::component_result(const PseudoJet& jet) const {
    return _njettinessFinder.getTauComponents(_N, particles);
 }
 
+//set result returns tau_1 ... tau_Nmax from a single pass
+std::vector<double> NsubjettinessSet::result(const PseudoJet& jet) const {
+   std::vector<TauComponents> components = component_result(jet);
+   std::vector<double> taus(components.size());
+   for (unsigned n = 0; n < components.size(); n++) taus[n] = components[n].tau();
+   return taus;
+}
+
+std::vector<TauComponents> NsubjettinessSet::component_result(const PseudoJet& jet) const {
+   std::vector<fastjet::PseudoJet> particles = jet.constituents();
+   return _njettinessFinder.getTauComponentsUpTo(_N_max, particles);
+}
+
 //ratio result uses Nsubjettiness result to find the ratio tau_N/tau_M, where N and M are specified by user
 double NsubjettinessRatio::result(const PseudoJet& jet) const {
    double numerator = _nsub_numerator.result(jet);
@@ -163,6 +163,58 @@ private:
 };
 
 
+//------------------------------------------------------------------------
+/// \class NsubjettinessSet
+// NsubjettinessSet gives tau_1 ... tau_Nmax for a jet at once.  It takes the
+// same options as Nsubjettiness, but the axes for all N are found together (a
+// single reclustering for the exclusive jet axes) and the taus are summed in
+// one loop over the constituents, which is much cheaper than Nmax separate
+// Nsubjettiness objects.
+class NsubjettinessSet {
+public:
+
+   NsubjettinessSet(int N_max,
+                    const AxesDefinition& axes_def,
+                    const MeasureDefinition& measure_def)
+   : _njettinessFinder(axes_def,measure_def), _N_max(N_max) {}
+
+   NsubjettinessSet(int N_max,
+                    Njettiness::AxesMode axes_mode,
+                    Njettiness::MeasureMode measure_mode,
+                    double para1)
+   : _njettinessFinder(axes_mode, measure_mode, 1, para1), _N_max(N_max) {}
+
+   NsubjettinessSet(int N_max,
+                    Njettiness::AxesMode axes_mode,
+                    Njettiness::MeasureMode measure_mode,
+                    double para1,
+                    double para2)
+   : _njettinessFinder(axes_mode, measure_mode, 2, para1, para2), _N_max(N_max) {}
+
+   NsubjettinessSet(int N_max,
+                    Njettiness::AxesMode axes_mode,
+                    Njettiness::MeasureMode measure_mode,
+                    double para1,
+                    double para2,
+                    double para3)
+   : _njettinessFinder(axes_mode, measure_mode, 3, para1, para2, para3), _N_max(N_max) {}
+
+   /// returns tau_1 ... tau_Nmax (element N-1 is tau_N), measured on the constituents of this jet
+   std::vector<double> result(const PseudoJet& jet) const;
+
+   /// returns the components of tau_1 ... tau_Nmax
+   std::vector<TauComponents> component_result(const PseudoJet& jet) const;
+
+   int N_max() const { return _N_max; }
+
+private:
+
+   Njettiness _njettinessFinder;
+   int _N_max;
+
+};
+
+
 //------------------------------------------------------------------------
 /// \class NsubjettinessRatio
 // NsubjettinessRatio uses the results from Nsubjettiness to calculate the ratio
@@ -0,0 +1,186 @@
+#ifndef __FASTJET_LAZYTILING9SOA_HH__
+#define __FASTJET_LAZYTILING9SOA_HH__
+
+//FJSTARTHEADER
+// $Id$
+//
+// Copyright (c) 2005-2014, Matteo Cacciari, Gavin P. Salam and Gregory Soyez
+//
+//----------------------------------------------------------------------
+// This file is part of FastJet.
+//
+//  FastJet is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  The algorithms that underlie FastJet have required considerable
+//  development. They are described in the original FastJet paper,
+//  hep-ph/0512210 and in the manual, arXiv:1111.6097. If you use
+//  FastJet as part of work towards a scientific publication, please
+//  quote the version you use and include a citation to the manual and
+//  optionally also to hep-ph/0512210.
+//
+//  FastJet is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with FastJet. If not, see <http://www.gnu.org/licenses/>.
+//----------------------------------------------------------------------
+//FJENDHEADER
+
+#include "fastjet/internal/MinHeap.hh"
+#include "fastjet/ClusterSequence.hh"
+#include "fastjet/internal/LazyTiling9Alt.hh"
+#include <vector>
+
+
+
+FASTJET_BEGIN_NAMESPACE      // defined in fastjet/internal/base.hh
+
+/// structure analogous to TiledJet, but rather than being part of a
+/// linked list it records its position (slot) in the arrays of its tile
+class SoATiledJet {
+public:
+  double     eta, phi, kt2, NN_dist;
+  SoATiledJet * NN;
+  int        _jets_index, tile_index, tile_slot;
+  bool _minheap_update_needed;
+
+  // indicate whether jets need to have their minheap entries
+  // updated).
+  inline void label_minheap_update_needed() {_minheap_update_needed = true;}
+  inline void label_minheap_update_done()   {_minheap_update_needed = false;}
+  inline bool minheap_update_needed() const {return _minheap_update_needed;}
+};
+
+/// tile of the LazyTiling9SoA strategy: the jets it contains are held
+/// as a structure of arrays, so that the distances from one point to
+/// all the jets of a tile can be computed by a single loop over
+/// contiguous memory (which the compiler can vectorise)
+class Tile9SoA {
+public:
+  /// pointers to neighbouring tiles, including self
+  Tile9SoA *   begin_tiles[n_tile_neighbours]; 
+  /// neighbouring tiles, excluding self
+  Tile9SoA **  surrounding_tiles; 
+  /// half of neighbouring tiles, no self
+  Tile9SoA **  RH_tiles;  
+  /// just beyond end of tiles
+  Tile9SoA **  end_tiles; 
+  /// the jets of this tile occupy [begin, begin+size) of the shared
+  /// rapidity, phi and pointer arrays of LazyTiling9SoA; removal moves
+  /// the last jet into the freed slot
+  int begin, size, capacity;
+  /// sometimes useful to be able to tag a tile
+  bool     tagged;    
+  /// true for tiles where the delta phi calculation needs
+  /// potentially to account for periodicity in phi
+  bool     use_periodic_delta_phi;
+  /// for all particles in the tile, this stores the largest of the
+  /// (squared) nearest-neighbour distances.
+  double max_NN_dist;
+  double eta_centre, phi_centre;
+
+  /// returns the number of jets in the tile
+  int jet_count() const {return size;}
+};
+
+
+//----------------------------------------------------------------------
+/// Same algorithm as LazyTiling9 (tiles of size R, 3x3 neighbourhood,
+/// lazy evaluation of the neighbouring tiles through max_NN_dist), but
+/// with the tile contents stored contiguously rather than as linked
+/// lists of TiledJets. This trades a little bookkeeping on insertion
+/// and removal for cache-friendly, vectorisable distance loops, which
+/// pays off once tiles hold a few tens of particles.
+class LazyTiling9SoA {
+public:
+  LazyTiling9SoA(ClusterSequence & cs);
+
+  void run();
+
+protected:
+  ClusterSequence & _cs;
+  const std::vector<PseudoJet> & _jets;
+  std::vector<Tile9SoA> _tiles;
+
+  double _Rparam, _R2, _invR2;
+  double _tiles_eta_min, _tiles_eta_max;
+  double _tile_size_eta, _tile_size_phi;
+  double _tile_half_size_eta, _tile_half_size_phi;
+  int    _n_tiles_phi,_tiles_ieta_min,_tiles_ieta_max;
+
+  /// contiguous storage for the contents of all tiles
+  std::vector<double> _tile_eta, _tile_phi;
+  std::vector<SoATiledJet *> _tile_jets;
+
+  /// scratch space for the distances between one point and the
+  /// contents of a tile (two of them, since _set_NN may be called
+  /// while the distances to jetB are still in use)
+  std::vector<double> _dist_buffer, _set_NN_dist_buffer;
+
+  void _initialise_tiles();
+
+  // reasonably robust return of tile index given ieta and iphi, in particular
+  // it works even if iphi is negative
+  inline int _tile_index (int ieta, int iphi) const {
+    // note that (-1)%n = -1 so that we have to add _n_tiles_phi
+    // before performing modulo operation
+    return (ieta-_tiles_ieta_min)*_n_tiles_phi
+                  + (iphi+_n_tiles_phi) % _n_tiles_phi;
+  }
+
+  void  _bj_remove_from_tiles(SoATiledJet * const jet);
+
+  /// gives a full tile more room at the end of the shared arrays
+  void  _grow_tile(Tile9SoA * tile);
+
+  /// returns the tile index given the eta and phi values of a jet
+  int _tile_index(const double eta, const double phi) const;
+
+  // sets up information regarding the tiling of the given jet
+  void _tj_set_jetinfo(SoATiledJet * const jet, const int _jets_index);
+
+  void _add_untagged_neighbours_to_tile_union_using_max_info(const SoATiledJet * const jet, 
+		 std::vector<int> & tile_union, int & n_near_tiles);
+  double _distance_to_tile(const SoATiledJet * bj, const Tile9SoA *) const;
+
+  /// fills dist[0..n) with the (periodic) distances between jet and
+  /// the first n jets of the tile
+  void _distances_to_tile_jets(const SoATiledJet * jet, const Tile9SoA * tile,
+                               int n, double * dist) const;
+
+  void _update_jetX_jetI_NN(SoATiledJet * jetX, SoATiledJet * jetI, double dist,
+                            std::vector<SoATiledJet *> & jets_for_minheap);
+
+  void _set_NN(SoATiledJet * jetI, std::vector<SoATiledJet *> & jets_for_minheap);
+
+  // return the diJ (multiplied by _R2) for this jet assuming its NN
+  // info is correct
+  template <class J> double _bj_diJ(const J * const jet) const {
+    double kt2 = jet->kt2;
+    if (jet->NN != NULL) {if (jet->NN->kt2 < kt2) {kt2 = jet->NN->kt2;}}
+    return jet->NN_dist * kt2;
+  }
+
+  //----------------------------------------------------------------------
+  template <class J> inline void _bj_set_jetinfo(
+                            J * const jetA, const int _jets_index) const {
+    jetA->eta  = _jets[_jets_index].rap();
+    jetA->phi  = _jets[_jets_index].phi_02pi();
+    jetA->kt2  = _cs.jet_scale_for_algorithm(_jets[_jets_index]);
+    jetA->_jets_index = _jets_index;
+    // initialise NN info as well
+    jetA->NN_dist = _R2;
+    jetA->NN      = NULL;
+  }
+
+};
+
+
+FASTJET_END_NAMESPACE
+
+#endif // __FASTJET_LAZYTILING9SOA_HH__
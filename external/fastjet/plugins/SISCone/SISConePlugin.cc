@@ -9,6 +9,8 @@
 
 // other stuff
 #include<sstream>
+#include<map>
+#include<cmath>
 
 FASTJET_BEGIN_NAMESPACE      // defined in fastjet/internal/base.hh
 
@@ -129,12 +131,65 @@ string SISConePlugin::description () const {
     desc << ", and (IR unsafe) merge_indentical_protocones=true" ;
   }
 
+  // pre-clustering gives up the infrared safety below the cell size
+  if (_precluster_cell_size > 0.0) {
+    desc << ", (IR unsafe) pre-clustering into cells of " << _precluster_cell_size;
+  }
+
   desc << ", SISCone code v" << siscone_version();
 
   return desc.str();
 }
 
 
+SISConePlugin::~SISConePlugin(){}
+
+void SISConePlugin::_fill_inputs(const ClusterSequence & clust_seq,
+                                 std::vector<std::vector<int> > & members) const{
+  unsigned n = clust_seq.jets().size();
+
+  members.clear();
+  if (_precluster_cell_size <= 0.0) {
+    members.resize(n);
+    for (unsigned i = 0; i < n; i++) members[i].push_back(i);
+    return;
+  }
+
+  // cells are labelled by their rapidity and azimuth bins; they are
+  // numbered in the order they are first met, which keeps the inputs
+  // reproducible
+  int n_phi = int(ceil(twopi/_precluster_cell_size));
+  if (n_phi < 1) n_phi = 1;
+  double ghost_pt2 = ghost_separation_scale()*ghost_separation_scale();
+  std::map<std::pair<int,int>, unsigned> cells;
+  std::map<std::pair<int,int>, unsigned>::iterator cell;
+
+  for (unsigned i = 0; i < n; i++) {
+    const PseudoJet & p = clust_seq.jets()[i];
+    if (p.perp2() < ghost_pt2) {
+      members.push_back(std::vector<int>(1, i));
+      continue;
+    }
+    int iphi = int(p.phi()*n_phi/twopi);
+    if (iphi >= n_phi) iphi = n_phi - 1;
+    std::pair<int,int> label(int(floor(p.rap()/_precluster_cell_size)), iphi);
+    cell = cells.find(label);
+    if (cell == cells.end()) {
+      cell = cells.insert(std::make_pair(label, unsigned(members.size()))).first;
+      members.push_back(std::vector<int>());
+    }
+    members[cell->second].push_back(i);
+  }
+}
+
+void SISConePlugin::set_reuse_workspace(bool reuse){
+  if (reuse) {
+    if (!_workspace()) _workspace.reset(new Csiscone);
+  } else {
+    _workspace.reset();
+  }
+}
+
 // overloading the base class implementation
 void SISConePlugin::run_clustering(ClusterSequence & clust_seq) const {
 
@@ -156,6 +211,7 @@ void SISConePlugin::run_clustering(ClusterSequence & clust_seq) const {
     if (stored_siscone.get() != 0) {
       new_siscone = !(stored_plugin->cone_radius()   == cone_radius()
                       && stored_plugin->n_pass_max() == n_pass_max()  
+                      && stored_plugin->precluster_cell_size() == precluster_cell_size()
                       && stored_particles->size()    == n);
       if (!new_siscone) {
         for(unsigned i = 0; i < n; i++) {
@@ -175,6 +231,8 @@ void SISConePlugin::run_clustering(ClusterSequence & clust_seq) const {
     }
 
     siscone = stored_siscone.get();
+  } else if (_workspace()) {
+    siscone = _workspace.get();
   } else {
     siscone = &local_siscone;
   }
@@ -190,11 +248,19 @@ void SISConePlugin::run_clustering(ClusterSequence & clust_seq) const {
   // set the type of splitting we want (default=std one, true->pt-weighted split)
   siscone->set_pt_weighted_splitting(_use_pt_weighted_splitting);
 
+  // threads of the stable-cone search
+  siscone->n_threads = _n_threads;
+
+  // the particles behind every siscone input
+  std::vector<std::vector<int> > members;
+  _fill_inputs(clust_seq, members);
+
   if (new_siscone) {
-    // transfer fastjet initial particles into the siscone type
-    std::vector<Cmomentum> siscone_momenta(n);
-    for(unsigned i = 0; i < n; i++) {
-      const PseudoJet & p = clust_seq.jets()[i]; // shorthand
+    // transfer fastjet initial particles (or their cells) into the siscone type
+    std::vector<Cmomentum> siscone_momenta(members.size());
+    for(unsigned i = 0; i < members.size(); i++) {
+      PseudoJet p = clust_seq.jets()[members[i][0]];
+      for(unsigned j = 1; j < members[i].size(); j++) p += clust_seq.jets()[members[i][j]];
       siscone_momenta[i] = Cmomentum(p.px(), p.py(), p.pz(), p.E());
     }
     
@@ -233,18 +299,25 @@ void SISConePlugin::run_clustering(ClusterSequence & clust_seq) const {
   // deliberate and ensures that when a user asks for
   // inclusive_jets(), they are provided in the order in which SISCone
   // created them.
+  std::vector<int> contents;
   for (int ijet = njet-1; ijet >= 0; ijet--) {
     const Cjet & jet = siscone->jets[ijet]; // shorthand
+
+    // the particles of the jet, through their cells when pre-clustering
+    contents.clear();
+    for (unsigned icell = 0; icell < jet.contents.size(); icell++)
+      contents.insert(contents.end(), members[jet.contents[icell]].begin(),
+                      members[jet.contents[icell]].end());
     
     // Successively merge the particles that make up the cone jet
     // until we have all particles in it.  Start off with the zeroth
     // particle.
-    int jet_k = jet.contents[0];
-    for (unsigned ipart = 1; ipart < jet.contents.size(); ipart++) {
+    int jet_k = contents[0];
+    for (unsigned ipart = 1; ipart < contents.size(); ipart++) {
       // take the last result of the merge
       int jet_i = jet_k;
       // and the next element of the jet
-      int jet_j = jet.contents[ipart];
+      int jet_j = contents[ipart];
       // and merge them (with a fake dij)
       double dij = 0.0;
 
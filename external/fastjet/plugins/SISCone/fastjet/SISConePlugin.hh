@@ -110,7 +110,9 @@ public:
     _split_merge_stopping_scale = split_merge_stopping_scale_in;
     _ghost_sep_scale       = 0.0;
     _use_pt_weighted_splitting = false;
-    _user_scale = 0;}
+    _user_scale = 0;
+    _precluster_cell_size  = 0.0;
+    _n_threads             = 1;}
 
 
   /// Backwards compatible constructor for the SISCone Plugin class
@@ -128,7 +130,9 @@ public:
     _split_merge_stopping_scale = 0.0;
     _split_merge_scale     = split_merge_on_transverse_mass_in ? SM_mt : SM_pttilde;
     _ghost_sep_scale       = 0.0;
-    _user_scale = 0;}
+    _user_scale = 0;
+    _precluster_cell_size  = 0.0;
+    _n_threads             = 1;}
   
   /// backwards compatible constructor for the SISCone Plugin class
   /// (avoid using this in future).
@@ -145,7 +149,9 @@ public:
     _split_merge_stopping_scale = 0.0;
     _ghost_sep_scale       = 0.0;
     _use_pt_weighted_splitting = false;
-    _user_scale = 0;}
+    _user_scale = 0;
+    _precluster_cell_size  = 0.0;
+    _n_threads             = 1;}
 
   /// minimum pt for a protojet to be considered in the split-merge step
   /// of the algorithm
@@ -175,6 +181,35 @@ public:
   void set_split_merge_use_pt_weighted_splitting(bool val) {
     _use_pt_weighted_splitting = val;}
 
+  /// keep the siscone internals (hash of cone candidates, vicinity
+  /// and particle lists) from one run_clustering to the next, so that
+  /// their memory is recycled rather than allocated again for every
+  /// event. The plugin, and the copies of it that share the workspace,
+  /// must then not run on several threads at once. Not used when
+  /// caching, which keeps its own siscone.
+  void set_reuse_workspace(bool reuse);
+  bool reuse_workspace() const {return _workspace.get() != 0;}
+
+  /// pre-cluster the particles into cells of cell_size x cell_size in
+  /// rapidity and azimuth before the search: the stable-cone search
+  /// and the split-merge see one summed momentum per cell, and each jet
+  /// is then built from the particles of its cells. This bounds the
+  /// cost of the search on dense inputs (towers with pileup), at the
+  /// price of the resolution, and of the infrared safety, below the
+  /// cell size. 0 (the default) turns it off. Ghosts (below the ghost
+  /// separation scale) are never pre-clustered.
+  void set_precluster_cell_size(double cell_size) {_precluster_cell_size = cell_size;}
+  double precluster_cell_size() const {return _precluster_cell_size;}
+
+  /// number of threads sharing the stable-cone search (default 1);
+  /// the cones around every centre are found independently and the
+  /// stable cones come out as with a single thread
+  void set_n_threads(int n_threads_in) {_n_threads = n_threads_in;}
+  int n_threads() const {return _n_threads;}
+
+  /// destructor, out of line as siscone::Csiscone is not known here
+  virtual ~SISConePlugin();
+
   // the things that are required by base class
   virtual std::string description () const;
   virtual void run_clustering(ClusterSequence &) const ;
@@ -188,6 +223,17 @@ private:
 
   bool _use_pt_weighted_splitting;
 
+  // siscone object reused by run_clustering, see set_reuse_workspace
+  SharedPtr<siscone::Csiscone> _workspace;
+
+  double _precluster_cell_size;
+  int _n_threads;
+
+  /// the particles of clust_seq behind every siscone input: one each,
+  /// or the members of every occupied cell when pre-clustering
+  void _fill_inputs(const ClusterSequence & clust_seq,
+                    std::vector<std::vector<int> > & members) const;
+
   // part needed for the cache 
   // variables for caching the results and the input
   static std::auto_ptr<SISConePlugin          > stored_plugin;
@@ -45,12 +45,35 @@ using namespace std;
 //  - _R2  cone radius (squared)
 //-----------------------------------
 hash_cones::hash_cones(int _Np, double _R2){
+  hash_array = NULL;
+  n_cells = 0;
+  reset(_Np, _R2);
+}
+
+// destructor
+//------------
+hash_cones::~hash_cones(){
+  unsigned int i;
+
+  // the elements live in the blocks
+  for (i=0;i<element_blocks.size();i++)
+    delete[] element_blocks[i];
+
+  delete[] hash_array;
+}
+
+// empty the hash for a new search, keeping its memory
+//  - _Np  number of particles
+//  - _R2  cone radius (squared)
+//-----------------------------------------------------
+void hash_cones::reset(int _Np, double _R2){
   int i;
 
   n_cones = 0;
 #ifdef DEBUG_STABLE_CONES
   n_occupied_cells = 0;
 #endif
+  n_elements = 0;
 
   // determine hash size
   // for a ymax=5 and R=0.7, we observed an occupancy around 1/8 N^2 ~ N2 R2/4
@@ -60,8 +83,12 @@ hash_cones::hash_cones(int _Np, double _R2){
   if (nbits<1) nbits=1;
   mask = 1 << nbits;
 
-  // create hash
-  hash_array = new hash_element*[mask];
+  // create hash, unless the previous one is large enough
+  if (mask>n_cells){
+    delete[] hash_array;
+    hash_array = new hash_element*[mask];
+    n_cells = mask;
+  }
   mask--;
 
   // set the array to 0
@@ -72,24 +99,53 @@ hash_cones::hash_cones(int _Np, double _R2){
   R2 = _R2;
 }
 
-// destructor
-//------------
-hash_cones::~hash_cones(){
-  int i;
-  hash_element *elm;
+// number of elements per block of storage
+static const int ELEMENT_BLOCK_SIZE = 1024;
 
-  for (i=0;i<mask+1;i++){
-    while (hash_array[i]!=NULL){
-      elm = hash_array[i];
-      hash_array[i] = hash_array[i]->next;
-      delete elm;
-    }
-  }
+// hand out a fresh element, allocating a new block only
+// when all the blocks kept so far are in use
+//-----------------------------------------------------
+hash_element *hash_cones::new_element(){
+  unsigned int block = n_elements / ELEMENT_BLOCK_SIZE;
 
-  delete[] hash_array;
+  if (block==element_blocks.size())
+    element_blocks.push_back(new hash_element[ELEMENT_BLOCK_SIZE]);
+
+  return &(element_blocks[block][n_elements++ % ELEMENT_BLOCK_SIZE]);
 }
 
 
+// add the candidates of another hash
+//  - other  hash to take the candidates from
+//-----------------------------------------------------
+void hash_cones::merge(const hash_cones &other){
+  int i, index;
+  hash_element *from, *elm;
+
+  for (i=0;i<other.mask+1;i++){
+    for (from=other.hash_array[i];from!=NULL;from=from->next){
+      index = (from->ref.ref[0]) & mask;
+
+      elm = hash_array[index];
+      while ((elm!=NULL) && (!(elm->ref==from->ref)))
+	elm = elm->next;
+
+      if (elm==NULL){
+	elm = new_element();
+	elm->ref = from->ref;
+	elm->eta = from->eta;
+	elm->phi = from->phi;
+	elm->is_stable = from->is_stable;
+	elm->next = hash_array[index];
+	hash_array[index] = elm;
+	n_cones++;
+      } else if (!from->is_stable){
+	elm->is_stable = false;
+      }
+    }
+  }
+}
+
 /*
  * insert a new candidate into the hash.
  *  - v       4-momentum of the cone to add
@@ -115,7 +171,7 @@ int hash_cones::insert(Cmomentum *v, Cmomentum *parent, Cmomentum *child, bool p
     // if it is not present, add it
     if (elm==NULL){
       // create element
-      elm = new hash_element;
+      elm = new_element();
 
       // set its varibles
       // Note: at this level, eta and phi have already been computed
@@ -179,7 +235,7 @@ int hash_cones::insert(Cmomentum *v){
     // if it is not present, add it
     if (elm==NULL){
       // create element
-      elm = new hash_element;
+      elm = new_element();
 
       // set its varibles
       // Note: at this level, eta and phi have already been computed
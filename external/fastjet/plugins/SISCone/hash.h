@@ -28,6 +28,7 @@
 #ifndef __HASH_H__
 #define __HASH_H__
 
+#include <vector>
 #include "momentum.h"
 #include "reference.h"
 
@@ -69,6 +70,24 @@ class hash_cones{
   /// destructor
   ~hash_cones();
 
+  /**
+   * empty the hash for a new search. The cells and the elements
+   * allocated so far are kept and handed out again, so that a hash
+   * reused from pass to pass (and event to event) stops allocating
+   * once it has seen its largest search.
+   * \param _Np  number of particles
+   * \param _R2  cone radius (squared)
+   */
+  void reset(int _Np, double _R2);
+
+  /**
+   * add the candidates of another hash, filled from other parents.
+   * A cone present in both stays stable only if it is stable in
+   * both, as if all its insertions had been made in this hash.
+   * \param other  hash to take the candidates from
+   */
+  void merge(const hash_cones &other);
+
   /**
    * insert a new candidate into the hash.
    * \param v       4-momentum of te cone to add
@@ -116,6 +135,19 @@ class hash_cones{
    * \return true if inside, false if outside
    */
   inline bool is_inside(Cmomentum *centre, Cmomentum *v);
+
+ private:
+  /// hand out a fresh element from the blocks
+  hash_element *new_element();
+
+  /// storage of the elements, in blocks of ELEMENT_BLOCK_SIZE
+  std::vector<hash_element*> element_blocks;
+
+  /// number of elements handed out since the last reset
+  int n_elements;
+
+  /// allocated number of cells in hash_array
+  int n_cells;
 };
 
 }
@@ -63,6 +63,7 @@
 #include <iostream>
 #include "circulator.h"
 #include <algorithm>
+#include <thread>
 
 namespace siscone{
 
@@ -89,6 +90,7 @@ using namespace std;
 Cstable_cones::Cstable_cones(){
   nb_tot = 0;
   hc = NULL;
+  n_threads = 1;
 }
 
 // ctor with initialisation
@@ -98,12 +100,17 @@ Cstable_cones::Cstable_cones(vector<Cmomentum> &_particle_list)
 
   nb_tot = 0;
   hc = NULL;
+  n_threads = 1;
 }
 
 // default dtor
 //--------------
 Cstable_cones::~Cstable_cones(){
+  unsigned int i;
+
   if (hc!=NULL) delete hc;
+  for (i=0;i<workers.size();i++)
+    delete workers[i];
 }
 
 /*
@@ -112,10 +119,7 @@ Cstable_cones::~Cstable_cones(){
  *  - _n              number of particles
  *********************************************************************/
 void Cstable_cones::init(vector<Cmomentum> &_particle_list){
-  // check already allocated mem
-  if (hc!=NULL){
-    delete hc;
-  }
+  // the hash of cone candidates is kept for the next search
   if (protocones.size()!=0)
     protocones.clear();
 
@@ -139,8 +143,6 @@ void Cstable_cones::init(vector<Cmomentum> &_particle_list){
  * The number of stable cones found is returned
  *********************************************************************/
 int Cstable_cones::get_stable_cones(double _radius){
-  int p_idx;
-
   // check if everything is correctly initialised
   if (n_part==0){
     return 0;
@@ -149,11 +151,33 @@ int Cstable_cones::get_stable_cones(double _radius){
   R  = _radius;
   R2 = R*R;
 
-  // allow hash for cones candidates
-  hc = new hash_cones(n_part, R2);
+  // allow hash for cones candidates, reusing the memory of the
+  // previous search if there was one
+  if (hc==NULL)
+    hc = new hash_cones(n_part, R2);
+  else
+    hc->reset(n_part, R2);
+
+  if (n_threads>1 && n_part>1)
+    return get_stable_cones_in_threads();
 
   // browse all particles
-  for (p_idx=0;p_idx<n_part;p_idx++){
+  search_parents(0, 1);
+
+  return proceed_with_stability();
+}
+
+
+/*
+ * browse the parents first, first+step, ...
+ *  - first  index of the first parent
+ *  - step   distance between two parents
+ * the cones they define are inserted into the hash
+ *********************************************************************/
+void Cstable_cones::search_parents(int first, int step){
+  int p_idx;
+
+  for (p_idx=first;p_idx<n_part;p_idx+=step){
     // step 0: compute the child list CL.
     //         Note that this automatically sets the parent P
     build(&plist[p_idx], 2.0*R);
@@ -176,8 +200,79 @@ int Cstable_cones::get_stable_cones(double _radius){
       // step 3: go to the next cone child candidate C
     } while (!update_cone());
   }
+}
 
-  return proceed_with_stability();
+
+// ordering of the isolated parents by their index
+static bool index_less(const Cmomentum &p1, const Cmomentum &p2){
+  return p1.index < p2.index;
+}
+
+/*
+ * compute stable cones on n_threads threads.
+ * Each thread has its own copy of the particles (with the same
+ * references), its own vicinity and its own hash; the hashes are
+ * merged before the last stability test, which is shared again.
+ * The protocones come in the order of the serial search: the
+ * isolated parents by index, then the stable cones by hash cell.
+ * The number of stable cones found is returned
+ *********************************************************************/
+int Cstable_cones::get_stable_cones_in_threads(){
+  int i, n, n_cells;
+  vector<std::thread> threads;
+
+  n = (n_threads<n_part) ? n_threads : n_part;
+  while ((int) workers.size()<n-1)
+    workers.push_back(new Cstable_cones());
+
+  for (i=0;i<n-1;i++){
+    Cstable_cones *worker = workers[i];
+    worker->copy_particle_list(*this);
+    worker->protocones.clear();
+    worker->multiple_centre_done.clear();
+    worker->nb_tot = 0;
+    worker->R  = R;
+    worker->R2 = R2;
+    if (worker->hc==NULL)
+      worker->hc = new hash_cones(n_part, R2);
+    else
+      worker->hc->reset(n_part, R2);
+  }
+
+  // step 1: the parents, interleaved between the threads
+  for (i=1;i<n;i++)
+    threads.push_back(std::thread(&Cstable_cones::search_parents, workers[i-1], i, n));
+  search_parents(0, n);
+  for (i=0;i<n-1;i++)
+    threads[i].join();
+  threads.clear();
+
+  for (i=0;i<n-1;i++){
+    protocones.insert(protocones.end(), workers[i]->protocones.begin(), workers[i]->protocones.end());
+    workers[i]->protocones.clear();
+    hc->merge(*(workers[i]->hc));
+    nb_tot += workers[i]->nb_tot;
+  }
+  sort(protocones.begin(), protocones.end(), index_less);
+
+  // step 2: the stability tests, on contiguous ranges of cells
+  n_cells = hc->mask+1;
+  for (i=1;i<n;i++)
+    threads.push_back(std::thread(&Cstable_cones::test_stability_in_cells, workers[i-1], 
+				  hc, (i*n_cells)/n, ((i+1)*n_cells)/n));
+  test_stability_in_cells(hc, 0, n_cells/n);
+  for (i=0;i<n-1;i++)
+    threads[i].join();
+
+  for (i=0;i<n-1;i++)
+    protocones.insert(protocones.end(), workers[i]->protocones.begin(), workers[i]->protocones.end());
+
+#ifdef DEBUG_STABLE_CONES
+  nb_hash_cones = hc->n_cones;
+  nb_hash_occupied = hc->n_occupied_cells;
+#endif
+
+  return protocones.size();
 }
 
 
@@ -350,13 +445,30 @@ int Cstable_cones::update_cone(){
  * pass the last test: stability with quadtree intersection
  ************************************************************************/
 int Cstable_cones::proceed_with_stability(){
-  int i; // ,n;
+  test_stability_in_cells(hc, 0, hc->mask+1);
+
+  // the hash is not freed here any longer: its cells and elements
+  // are recycled by the next search (the next pass, or the next
+  // event when the Csiscone object is reused) and go with it
+#ifdef DEBUG_STABLE_CONES
+  nb_hash_cones = hc->n_cones;
+  nb_hash_occupied = hc->n_occupied_cells;
+#endif
+
+  return protocones.size();
+}
+
+/*
+ * last stability test for the cells [first_cell, last_cell) of a hash
+ * (the hash of this search, or the merged one of a threaded search)
+ ************************************************************************/
+void Cstable_cones::test_stability_in_cells(hash_cones *hash, int first_cell, int last_cell){
+  int i;
   hash_element *elm;
 
-  //n=0;
-  for (i=0;i<=hc->mask;i++){
+  for (i=first_cell;i<last_cell;i++){
     // test ith cell of the hash array
-    elm = hc->hash_array[i];
+    elm = hash->hash_array[i];
 
     // browse elements therein
     while (elm!=NULL){
@@ -383,19 +495,6 @@ int Cstable_cones::proceed_with_stability(){
       elm = elm->next;
     }
   }
-  
-  // free hash
-  // we do that at this level because hash eats rather a lot of memory
-  // we want to free it before running the split/merge algorithm
-#ifdef DEBUG_STABLE_CONES
-  nb_hash_cones = hc->n_cones;
-  nb_hash_occupied = hc->n_occupied_cells;
-#endif
-
-  delete hc;
-  hc=NULL;
-
-  return protocones.size();
 }
 
 
@@ -111,6 +111,10 @@ class Cstable_cones : public Cvicinity{
   /// list of candidates
   hash_cones *hc;
 
+  /// number of threads sharing the search: the parents and then the
+  /// final stability tests are split between them (default 1)
+  int n_threads;
+
   /// total number of tested cones
   int nb_tot;
 #ifdef DEBUG_STABLE_CONES
@@ -224,6 +228,32 @@ class Cstable_cones : public Cvicinity{
    */
   int proceed_with_stability();
 
+  /**
+   * look for the cones around the parents first, first+step, ...
+   * and insert them into the hash
+   * \param first  index of the first parent
+   * \param step   distance between two parents
+   */
+  void search_parents(int first, int step);
+
+  /**
+   * last stability test for the candidates of the cells
+   * [first_cell, last_cell) of a hash, appending the stable ones to
+   * the protocones
+   */
+  void test_stability_in_cells(hash_cones *hash, int first_cell, int last_cell);
+
+  /**
+   * search the parents and test the candidates on n_threads threads,
+   * giving the protocones in the same order as a serial search
+   * \return the number of stable cones
+   */
+  int get_stable_cones_in_threads();
+
+  /// searches working for this one on the other threads, kept from
+  /// one search to the next like the hash
+  std::vector<Cstable_cones*> workers;
+
   /*
    * circle intersection.
    * computes the intersection with a circle of given centre and radius.
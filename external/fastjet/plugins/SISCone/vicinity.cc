@@ -61,6 +61,7 @@ Cvicinity::Cvicinity(){
   n_part = 0;
 
   ve_list = NULL;
+  ve_list_size = 0;
 #ifdef USE_QUADTREE_FOR_STABILITY_TEST
   quadtree = NULL;
 #endif
@@ -74,6 +75,8 @@ Cvicinity::Cvicinity(){
 //---------------------------------
 Cvicinity::Cvicinity(vector<Cmomentum> &_particle_list){
   parent = NULL;
+  ve_list = NULL;
+  ve_list_size = 0;
 #ifdef USE_QUADTREE_FOR_STABILITY_TEST
   quadtree = NULL;
 #endif
@@ -105,10 +108,7 @@ void Cvicinity::set_particle_list(vector<Cmomentum> &_particle_list){
   double eta_max=0.0;
 #endif
   
-  // if the particle list is not empty, destroy it !
-  if (ve_list!=NULL){
-    delete[] ve_list;
-  }
+  // the vicinity elements of the previous list are reused below
   vicinity.clear();
 #ifdef USE_QUADTREE_FOR_STABILITY_TEST
   if (quadtree!=NULL)
@@ -147,7 +147,14 @@ void Cvicinity::set_particle_list(vector<Cmomentum> &_particle_list){
 
   // allocate quadtree and vicinity_elm list
   // note: we set phi in [-pi:pi] as it is the natural range for atan2!
-  ve_list = new Cvicinity_elm[2*n_part];
+  // ve_list is only reallocated when it is too small: every element
+  // in use is set again before being read
+  if (2*n_part>ve_list_size){
+    if (ve_list!=NULL)
+      delete[] ve_list;
+    ve_list = new Cvicinity_elm[2*n_part];
+    ve_list_size = 2*n_part;
+  }
 #ifdef USE_QUADTREE_FOR_STABILITY_TEST
   eta_max+=0.1;
   quadtree = new Cquadtree(0.0, 0.0, eta_max, M_PI);
@@ -166,6 +173,53 @@ void Cvicinity::set_particle_list(vector<Cmomentum> &_particle_list){
 
 }
 
+/*
+ * take the particle list of another vicinity
+ *  - other   vicinity whose particles are copied
+ * the references are copied rather than randomized again, so that
+ * the cones found from both lists can be compared
+ ************************************************************/ 
+void Cvicinity::copy_particle_list(const Cvicinity &other){
+  int i,j;
+#ifdef USE_QUADTREE_FOR_STABILITY_TEST
+  double eta_max=0.0;
+#endif
+
+  vicinity.clear();
+#ifdef USE_QUADTREE_FOR_STABILITY_TEST
+  if (quadtree!=NULL)
+    delete quadtree;
+#endif
+
+  n_part = other.n_part;
+  plist = other.plist;
+  pincluded.assign(n_part, Cvicinity_inclusion());
+
+  // same allocation as in set_particle_list
+  if (2*n_part>ve_list_size){
+    if (ve_list!=NULL)
+      delete[] ve_list;
+    ve_list = new Cvicinity_elm[2*n_part];
+    ve_list_size = 2*n_part;
+  }
+#ifdef USE_QUADTREE_FOR_STABILITY_TEST
+  for (i=0;i<n_part;i++)
+    if (fabs(plist[i].eta)>eta_max) eta_max=fabs(plist[i].eta);
+  eta_max+=0.1;
+  quadtree = new Cquadtree(0.0, 0.0, eta_max, M_PI);
+#endif
+
+  j = 0;
+  for (i=0;i<n_part;i++){
+#ifdef USE_QUADTREE_FOR_STABILITY_TEST
+    quadtree->add(&plist[i]);
+#endif
+    ve_list[j].v = ve_list[j+1].v = &plist[i];
+    ve_list[j].is_inside = ve_list[j+1].is_inside = &(pincluded[i]);
+    j+=2;
+  }
+}
+
 
 /*
  * build the vicinity list from a list of points.
@@ -109,6 +109,13 @@ class Cvicinity{
    */ 
   void set_particle_list(std::vector<Cmomentum> &_particle_list);
 
+  /**
+   * take the particle list of another vicinity, with the same
+   * references, so that both can share the stable-cone search
+   * \param other   vicinity whose particles are copied
+   */ 
+  void copy_particle_list(const Cvicinity &other);
+
   /**
    * build the vicinity list from the list of points.
    * \param _parent    reference particle
@@ -130,6 +137,7 @@ class Cvicinity{
   std::vector<Cmomentum> plist;               ///< the list of particles
   std::vector<Cvicinity_inclusion> pincluded; ///< the inclusion state of particles
   Cvicinity_elm *ve_list;                     ///< list of vicinity elements built from particle list (size=2*n)
+  int ve_list_size;                           ///< allocated size of ve_list, kept from one particle list to the next
 #ifdef USE_QUADTREE_FOR_STABILITY_TEST
   Cquadtree *quadtree;                        ///< quadtree used for final stability tests
 #endif
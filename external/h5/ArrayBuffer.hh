@@ -0,0 +1,272 @@
+// Buffer for fixed-shape arrays of HDF5 objects, such as images.
+//
+// Each entry is a block of `T` with the shape `row_dims`, so the
+// dataset on disk has shape [n_entries, row_dims...]. The entries are
+// built in place in the buffer, which saves the copy of a large entry
+// that `push_back` would need, and full buffers can be written by a
+// background thread as with `OneDimBuffer`.
+
+#ifndef ARRAY_BUFFER_HH
+#define ARRAY_BUFFER_HH
+
+#include "OneDimBuffer.hh"
+
+#include "H5Cpp.h"
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <stdexcept>
+
+// _________________________________________________________________________
+// public interface
+template<typename T>
+class ArrayBuffer
+{
+public:
+  // Arguments are the same as `OneDimBuffer`, with the shape of an
+  // entry after the type. Compound types are packed on disk. The chunk
+  // size from `opts` counts entries, a communicator makes `flush()`
+  // collective as for `OneDimBuffer`.
+  ArrayBuffer(H5::CommonFG& group, std::string ds_name,
+              H5::DataType type, const std::vector<hsize_t>& row_dims,
+              hsize_t buffer_size = 10,
+              const h5::DatasetOptions& = h5::DatasetOptions());
+  ArrayBuffer(H5::CommonFG& group, std::string ds_name,
+              H5::CompType type, const std::vector<hsize_t>& row_dims,
+              hsize_t buffer_size = 10,
+              const h5::DatasetOptions& = h5::DatasetOptions());
+
+  ArrayBuffer(const ArrayBuffer&) = delete;
+  ArrayBuffer& operator=(ArrayBuffer) = delete;
+
+  // Stops the writer thread (if there is one).
+  ~ArrayBuffer();
+
+  // same as `OneDimBuffer::set_async`
+  void set_async(bool async = true);
+
+  // add one entry with all its elements set to `fill`, returns its
+  // first element, valid until the next call
+  T* append(const T& fill = T());
+
+  void flush();
+  // total number of entries (buffered and written)
+  hsize_t size() const;
+  // number of `T` in one entry
+  hsize_t row_size() const;
+  void close();
+
+private:
+  ArrayBuffer(H5::CommonFG& group, std::string ds_name,
+              H5::DataType type, H5::DataType disk_type,
+              const std::vector<hsize_t>& row_dims, hsize_t buffer_size,
+              const h5::DatasetOptions&);
+
+  hsize_t write_slab(const std::vector<T>& buffer, hsize_t offset);
+
+  void writer_loop();
+  void wait_for_writer();
+  void stop_writer(bool rethrow = true);
+
+  H5::DataType _type;
+  std::vector<hsize_t> _row_dims;
+  hsize_t _row_size;
+  hsize_t _max_rows;
+  h5::DatasetOptions _opts;
+  hsize_t _offset;
+  // entries are stored contiguously, `row_size` elements each
+  std::vector<T> _buffer;
+  H5::DataSet _ds;
+
+  // background writer, see `OneDimBuffer`
+  bool _async;
+  std::vector<T> _write_buffer;
+  hsize_t _write_offset;
+  bool _pending;
+  bool _stop;
+  std::exception_ptr _writer_error;
+  std::thread _writer;
+  std::mutex _mutex;
+  std::condition_variable _cv;
+};
+
+template<typename T>
+ArrayBuffer<T>::ArrayBuffer(
+  H5::CommonFG& group, std::string ds_name, H5::DataType type,
+  const std::vector<hsize_t>& row_dims, hsize_t buffer_size,
+  const h5::DatasetOptions& opts):
+  ArrayBuffer(group, ds_name, type, type, row_dims, buffer_size, opts)
+{
+}
+template<typename T>
+ArrayBuffer<T>::ArrayBuffer(
+  H5::CommonFG& group, std::string ds_name, H5::CompType type,
+  const std::vector<hsize_t>& row_dims, hsize_t buffer_size,
+  const h5::DatasetOptions& opts):
+  ArrayBuffer(group, ds_name, type, h5::packed(type), row_dims,
+              buffer_size, opts)
+{
+}
+
+template<typename T>
+ArrayBuffer<T>::ArrayBuffer(
+  H5::CommonFG& group, std::string ds_name, H5::DataType type,
+  H5::DataType disk_type, const std::vector<hsize_t>& row_dims,
+  hsize_t buffer_size, const h5::DatasetOptions& opts):
+  _type(type),
+  _row_dims(row_dims),
+  _row_size(1),
+  _max_rows(buffer_size),
+  _opts(opts),
+  _offset(0),
+  _async(false),
+  _write_offset(0),
+  _pending(false),
+  _stop(false)
+{
+  std::vector<hsize_t> initial(1, 0);
+  std::vector<hsize_t> eventual(1, H5S_UNLIMITED);
+  std::vector<hsize_t> chunk(1, opts.chunk_size > 0 ?
+                             opts.chunk_size : buffer_size);
+  for (hsize_t dim: row_dims) {
+    initial.push_back(dim);
+    eventual.push_back(dim);
+    chunk.push_back(dim);
+    _row_size *= dim;
+  }
+  H5::DataSpace orig_space(initial.size(), initial.data(), eventual.data());
+
+  H5::DSetCreatPropList params = h5::dataset_params(opts, buffer_size);
+  params.setChunk(chunk.size(), chunk.data());
+
+  std::lock_guard<std::mutex> io_lock(h5::io_mutex());
+  _ds = group.createDataSet(ds_name, disk_type, orig_space, params);
+}
+
+template<typename T>
+ArrayBuffer<T>::~ArrayBuffer() {
+  stop_writer(false);
+}
+
+template<typename T>
+void ArrayBuffer<T>::set_async(bool async) {
+  if (async == _async) return;
+  if (async && h5::collective(_opts)) {
+    throw std::logic_error("collective writes can't be asynchronous");
+  }
+  flush();
+  if (async) {
+    _stop = false;
+    _writer = std::thread(&ArrayBuffer<T>::writer_loop, this);
+  } else {
+    stop_writer();
+  }
+  _async = async;
+}
+
+template<typename T>
+T* ArrayBuffer<T>::append(const T& fill) {
+  if (_buffer.size() == _max_rows * _row_size && !h5::collective(_opts)) {
+    flush();
+  }
+  _buffer.resize(_buffer.size() + _row_size, fill);
+  return _buffer.data() + _buffer.size() - _row_size;
+}
+
+template<typename T>
+void ArrayBuffer<T>::flush() {
+  if (_buffer.size() == 0 && !h5::collective(_opts)) return;
+
+  hsize_t n_rows = _buffer.size() / _row_size;
+  if (!_async) {
+    n_rows = write_slab(_buffer, _offset);
+  } else {
+    wait_for_writer();
+    std::lock_guard<std::mutex> lock(_mutex);
+    _write_buffer.swap(_buffer);
+    _write_offset = _offset;
+    _pending = true;
+    _cv.notify_all();
+  }
+  _offset += n_rows;
+  _buffer.clear();
+}
+
+template<typename T>
+hsize_t ArrayBuffer<T>::size() const {
+  return _offset + _buffer.size() / _row_size;
+}
+
+template<typename T>
+hsize_t ArrayBuffer<T>::row_size() const {
+  return _row_size;
+}
+
+template<typename T>
+void ArrayBuffer<T>::close() {
+  flush();
+  stop_writer();
+  std::lock_guard<std::mutex> io_lock(h5::io_mutex());
+  _ds.close();
+}
+
+template<typename T>
+hsize_t ArrayBuffer<T>::write_slab(const std::vector<T>& buffer,
+                                   hsize_t offset) {
+  std::lock_guard<std::mutex> io_lock(h5::io_mutex());
+  return h5::write_rows(_ds, buffer.data(), _type,
+                        buffer.size() / _row_size, _row_dims,
+                        offset, _opts);
+}
+
+template<typename T>
+void ArrayBuffer<T>::writer_loop() {
+  std::unique_lock<std::mutex> lock(_mutex);
+  while (true) {
+    _cv.wait(lock, [this]{ return _pending || _stop; });
+    if (!_pending) return;
+    lock.unlock();
+    try {
+      write_slab(_write_buffer, _write_offset);
+    } catch (...) {
+      _writer_error = std::current_exception();
+    }
+    _write_buffer.clear();
+    lock.lock();
+    _pending = false;
+    _cv.notify_all();
+  }
+}
+
+template<typename T>
+void ArrayBuffer<T>::wait_for_writer() {
+  std::unique_lock<std::mutex> lock(_mutex);
+  _cv.wait(lock, [this]{ return !_pending; });
+  if (_writer_error) {
+    std::exception_ptr error = _writer_error;
+    _writer_error = nullptr;
+    std::rethrow_exception(error);
+  }
+}
+
+template<typename T>
+void ArrayBuffer<T>::stop_writer(bool rethrow) {
+  if (!_writer.joinable()) return;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stop = true;
+    _cv.notify_all();
+  }
+  _writer.join();
+  _async = false;
+  if (_writer_error) {
+    std::exception_ptr error = _writer_error;
+    _writer_error = nullptr;
+    if (rethrow) std::rethrow_exception(error);
+  }
+}
+
+#endif
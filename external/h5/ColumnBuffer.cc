@@ -0,0 +1,85 @@
+#include "ColumnBuffer.hh"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+  using namespace h5;
+
+  // one scalar column, read at a fixed offset in the parent object
+  template<typename V>
+  class Column: public IColumn
+  {
+  public:
+    Column(H5::CommonFG& group, const std::string& name,
+           const H5::DataType& type, size_t offset,
+           hsize_t buffer_size, const DatasetOptions& opts):
+      _buffer(group, name, type, buffer_size, opts),
+      _offset(offset)
+    {
+    }
+    void push_back(const char* object) override {
+      V value;
+      std::memcpy(&value, object + _offset, sizeof(V));
+      _buffer.push_back(value);
+    }
+    void flush() override { _buffer.flush(); }
+    void close() override { _buffer.close(); }
+  private:
+    OneDimBuffer<V> _buffer;
+    size_t _offset;
+  };
+
+  template<typename V>
+  std::unique_ptr<IColumn> column(
+    H5::CommonFG& group, const std::string& name, H5::PredType type,
+    size_t offset, hsize_t buffer_size, const DatasetOptions& opts) {
+    return std::unique_ptr<IColumn>(
+      new Column<V>(group, name, type, offset, buffer_size, opts));
+  }
+
+  void add_columns(std::vector<std::unique_ptr<IColumn> >& columns,
+                   H5::CommonFG& group, const H5::CompType& type,
+                   const std::string& prefix, size_t base_offset,
+                   hsize_t buffer_size, const DatasetOptions& opts) {
+    for (int iii = 0; iii < type.getNmembers(); iii++) {
+      const std::string name = prefix + type.getMemberName(iii);
+      const size_t offset = base_offset + type.getMemberOffset(iii);
+      H5T_class_t member_class = type.getMemberClass(iii);
+      if (member_class == H5T_COMPOUND) {
+        add_columns(columns, group, type.getMemberCompType(iii),
+                    name + ".", offset, buffer_size, opts);
+        continue;
+      }
+      if (member_class != H5T_INTEGER && member_class != H5T_FLOAT) {
+        continue;
+      }
+      const H5::DataType member = type.getMemberDataType(iii);
+      if (member == H5::PredType::NATIVE_FLOAT) {
+        columns.push_back(column<float>(
+          group, name, H5::PredType::NATIVE_FLOAT, offset,
+          buffer_size, opts));
+      } else if (member == H5::PredType::NATIVE_DOUBLE) {
+        columns.push_back(column<double>(
+          group, name, H5::PredType::NATIVE_DOUBLE, offset,
+          buffer_size, opts));
+      } else if (member == H5::PredType::NATIVE_INT) {
+        columns.push_back(column<int>(
+          group, name, H5::PredType::NATIVE_INT, offset,
+          buffer_size, opts));
+      } else {
+        throw std::invalid_argument("no column type for " + name);
+      }
+    }
+  }
+}
+
+namespace h5 {
+  std::vector<std::unique_ptr<IColumn> > make_columns(
+    H5::CommonFG& group, const H5::CompType& type,
+    hsize_t buffer_size, const DatasetOptions& opts) {
+    std::vector<std::unique_ptr<IColumn> > columns;
+    add_columns(columns, group, type, "", 0, buffer_size, opts);
+    return columns;
+  }
+}
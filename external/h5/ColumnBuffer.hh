@@ -0,0 +1,103 @@
+// Columnar buffer for HDF5 objects.
+//
+// Instead of writing one compound dataset, every scalar member of a
+// (possibly nested) compound type gets its own 1-D dataset in a
+// group. Nested members are named with dots, e.g.
+// `jet_parameters.pt`. Reading a few columns back then only touches
+// the chunks for those columns.
+//
+// Variable-length and array members are skipped.
+
+#ifndef COLUMN_BUFFER_HH
+#define COLUMN_BUFFER_HH
+
+#include "OneDimBuffer.hh"
+
+#include "H5Cpp.h"
+#include <string>
+#include <vector>
+#include <memory>
+
+namespace h5 {
+  // Interface to one column. The column reads its value from a raw
+  // pointer to the full object.
+  class IColumn
+  {
+  public:
+    virtual ~IColumn() {}
+    virtual void push_back(const char* object) = 0;
+    virtual void flush() = 0;
+    virtual void close() = 0;
+  };
+
+  // Build a column for each scalar member of `type`. Throws
+  // `std::invalid_argument` for numeric types we don't know how to
+  // store.
+  std::vector<std::unique_ptr<IColumn> > make_columns(
+    H5::CommonFG& group, const H5::CompType& type,
+    hsize_t buffer_size, const DatasetOptions&);
+}
+
+// _________________________________________________________________________
+// public interface
+template<typename T>
+class ColumnBuffer
+{
+public:
+  // Same arguments as the `OneDimBuffer` constructor, but the first
+  // argument should be an (empty) group to hold the columns.
+  ColumnBuffer(H5::CommonFG& group, const H5::CompType& type,
+               hsize_t buffer_size = 10,
+               const h5::DatasetOptions& = h5::DatasetOptions());
+
+  ColumnBuffer(const ColumnBuffer&) = delete;
+  ColumnBuffer& operator=(ColumnBuffer) = delete;
+
+  void push_back(const T& new_entry);
+  void flush();
+  hsize_t size() const;
+  void close();
+
+private:
+  std::vector<std::unique_ptr<h5::IColumn> > _columns;
+  hsize_t _size;
+};
+
+template<typename T>
+ColumnBuffer<T>::ColumnBuffer(
+  H5::CommonFG& group, const H5::CompType& type, hsize_t buffer_size,
+  const h5::DatasetOptions& opts):
+  _columns(h5::make_columns(group, type, buffer_size, opts)),
+  _size(0)
+{
+}
+
+template<typename T>
+void ColumnBuffer<T>::push_back(const T& new_entry) {
+  const char* raw = reinterpret_cast<const char*>(&new_entry);
+  for (auto& column: _columns) {
+    column->push_back(raw);
+  }
+  _size++;
+}
+
+template<typename T>
+void ColumnBuffer<T>::flush() {
+  for (auto& column: _columns) {
+    column->flush();
+  }
+}
+
+template<typename T>
+hsize_t ColumnBuffer<T>::size() const {
+  return _size;
+}
+
+template<typename T>
+void ColumnBuffer<T>::close() {
+  for (auto& column: _columns) {
+    column->close();
+  }
+}
+
+#endif
@@ -0,0 +1,101 @@
+// Reader for one column of the columnar layout (see ColumnBuffer.hh),
+// or any other 1-D dataset of numbers.
+//
+// The rows are read in blocks of at least one chunk, converted by HDF5
+// to the type of the reader, and handed out as pointers into the block,
+// so the rows of one event cost no call into HDF5 once their block is
+// in memory. The reads go through `h5::io_mutex()`.
+
+#ifndef COLUMN_READER_HH
+#define COLUMN_READER_HH
+
+#include "OneDimBuffer.hh"
+#include "h5types.hh"
+
+#include "H5Cpp.h"
+#include <string>
+#include <vector>
+#include <mutex>
+#include <algorithm>
+#include <stdexcept>
+
+template<typename T>
+class ColumnReader
+{
+public:
+  // The block size defaults to the chunk size of the dataset, or to
+  // 1000 rows for contiguous datasets. Throws `std::invalid_argument`
+  // if the dataset isn't one-dimensional.
+  ColumnReader(const H5::CommonFG& group, const std::string& name,
+               hsize_t block_size = 0);
+
+  ColumnReader(const ColumnReader&) = delete;
+  ColumnReader& operator=(ColumnReader) = delete;
+
+  hsize_t size() const;
+
+  // Pointer to `count` consecutive rows from `first`, valid until the
+  // next call. Reading the rows in order only touches every block once.
+  const T* get(hsize_t first, hsize_t count);
+
+private:
+  H5::DataSet _ds;
+  H5::DataType _type;
+  hsize_t _size;
+  hsize_t _block_size;
+  hsize_t _first;
+  std::vector<T> _block;
+};
+
+template<typename T>
+ColumnReader<T>::ColumnReader(const H5::CommonFG& group,
+                              const std::string& name,
+                              hsize_t block_size):
+  _type(h5::type(T())), _size(0), _block_size(block_size), _first(0)
+{
+  std::lock_guard<std::mutex> lock(h5::io_mutex());
+  _ds = group.openDataSet(name);
+  H5::DataSpace space = _ds.getSpace();
+  if (space.getSimpleExtentNdims() != 1) {
+    throw std::invalid_argument(name + " isn't a one-dimensional dataset");
+  }
+  space.getSimpleExtentDims(&_size);
+  if (_block_size == 0) {
+    H5::DSetCreatPropList params = _ds.getCreatePlist();
+    _block_size = 1000;
+    if (params.getLayout() == H5D_CHUNKED) {
+      params.getChunk(1, &_block_size);
+    }
+  }
+}
+
+template<typename T>
+hsize_t ColumnReader<T>::size() const {
+  return _size;
+}
+
+template<typename T>
+const T* ColumnReader<T>::get(hsize_t first, hsize_t count) {
+  if (first + count > _size) {
+    throw std::out_of_range("rows past the end of the dataset");
+  }
+  if (first >= _first && first + count <= _first + _block.size()) {
+    return _block.data() + (first - _first);
+  }
+
+  hsize_t n_rows = std::max(count, _block_size);
+  if (first + n_rows > _size) n_rows = _size - first;
+
+  _block.resize(n_rows);
+  _first = first;
+  if (n_rows > 0) {
+    std::lock_guard<std::mutex> lock(h5::io_mutex());
+    H5::DataSpace file_space = _ds.getSpace();
+    file_space.selectHyperslab(H5S_SELECT_SET, &n_rows, &first);
+    H5::DataSpace mem_space(1, &n_rows);
+    _ds.read(_block.data(), _type, mem_space, file_space);
+  }
+  return _block.data();
+}
+
+#endif
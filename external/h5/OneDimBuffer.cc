@@ -1,5 +1,8 @@
 #include "OneDimBuffer.hh"
 
+#include <stdexcept>
+#include <cctype>
+
 // util functuinos
 namespace h5 {
   H5::CompType packed(H5::CompType in) {
@@ -9,4 +12,144 @@ namespace h5 {
     out.pack();
     return out;
   }
+
+  std::mutex& io_mutex() {
+    static std::mutex mutex;
+    return mutex;
+  }
+
+  DatasetOptions::DatasetOptions():
+    chunk_size(0),
+    compression("deflate-7"),
+    shuffle(false),
+    swmr(false)
+#ifdef H5_HAVE_PARALLEL
+    , comm(MPI_COMM_NULL)
+#endif
+  {
+  }
+
+  H5::DSetCreatPropList dataset_params(const DatasetOptions& opts,
+                                       hsize_t buffer_size) {
+    // the filter id h5py uses for LZF
+    const H5Z_filter_t lzf_filter = 32000;
+
+    H5::DSetCreatPropList params;
+    hsize_t chunk_size[1] = {opts.chunk_size > 0 ?
+                             opts.chunk_size : buffer_size};
+    params.setChunk(1, chunk_size);
+
+    // shuffle has to come before the compression filter
+    if (opts.shuffle) params.setShuffle();
+
+    const std::string& comp = opts.compression;
+    const std::string deflate = "deflate";
+    if (comp == "none" || comp.empty()) {
+      // nothing to do
+    } else if (comp == deflate) {
+      params.setDeflate(6);
+    } else if (comp.compare(0, deflate.size() + 1, deflate + "-") == 0 &&
+               comp.size() == deflate.size() + 2 &&
+               std::isdigit(comp.back())) {
+      params.setDeflate(comp.back() - '0');
+    } else if (comp == "szip") {
+      params.setSzip(H5_SZIP_NN_OPTION_MASK, 16);
+    } else if (comp == "lzf") {
+      if (H5Zfilter_avail(lzf_filter) <= 0) {
+        throw std::invalid_argument(
+          "LZF filter isn't available, is HDF5_PLUGIN_PATH set?");
+      }
+      params.setFilter(lzf_filter, H5Z_FLAG_MANDATORY);
+    } else {
+      throw std::invalid_argument("unknown compression: " + comp);
+    }
+    return params;
+  }
+
+  bool collective(const DatasetOptions& opts) {
+#ifdef H5_HAVE_PARALLEL
+    return opts.comm != MPI_COMM_NULL;
+#else
+    (void) opts;
+    return false;
+#endif
+  }
+
+#ifdef H5_HAVE_PARALLEL
+  Slab collective_slab(MPI_Comm comm, hsize_t n_rows) {
+    unsigned long long rows = n_rows;
+    unsigned long long offset = 0;
+    unsigned long long total = 0;
+    int rank = 0;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Exscan(&rows, &offset, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, comm);
+    // the exclusive scan leaves the result of the first rank undefined
+    if (rank == 0) offset = 0;
+    MPI_Allreduce(&rows, &total, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, comm);
+    Slab slab;
+    slab.offset = offset;
+    slab.total = total;
+    return slab;
+  }
+#endif
+
+  hsize_t write_rows(H5::DataSet& ds, const void* data,
+                     const H5::DataType& type, hsize_t n_rows,
+                     hsize_t n_columns, hsize_t offset,
+                     const DatasetOptions& opts) {
+    std::vector<hsize_t> row_dims;
+    if (n_columns > 0) row_dims.push_back(n_columns);
+    return write_rows(ds, data, type, n_rows, row_dims, offset, opts);
+  }
+
+  hsize_t write_rows(H5::DataSet& ds, const void* data,
+                     const H5::DataType& type, hsize_t n_rows,
+                     const std::vector<hsize_t>& row_dims,
+                     hsize_t offset, const DatasetOptions& opts) {
+    int n_dims = row_dims.size() + 1;
+    std::vector<hsize_t> slab_dims(1, n_rows);
+    std::vector<hsize_t> total_dims(1, offset + n_rows);
+    std::vector<hsize_t> offset_dims(n_dims, 0);
+    slab_dims.insert(slab_dims.end(), row_dims.begin(), row_dims.end());
+    total_dims.insert(total_dims.end(), row_dims.begin(), row_dims.end());
+    offset_dims[0] = offset;
+    hsize_t n_added = n_rows;
+    H5::DSetMemXferPropList transfer;
+
+#ifdef H5_HAVE_PARALLEL
+    if (collective(opts)) {
+      // every rank extends the dataset to the same size, and writes
+      // its rows after those of the ranks before it
+      Slab slab = collective_slab(opts.comm, n_rows);
+      total_dims[0] = offset + slab.total;
+      offset_dims[0] = offset + slab.offset;
+      n_added = slab.total;
+      // filters (compression) only work with collective transfers
+      H5Pset_dxpl_mpio(transfer.getId(), H5FD_MPIO_COLLECTIVE);
+    }
+#endif
+    // the same on all ranks, so they all skip the collective calls
+    if (n_added == 0) return 0;
+
+    ds.extend(total_dims.data());
+
+    // We'll only write to the end of the dataset, so we select the
+    // hyperslab of the new rows in the file's `DataSpace`. A rank
+    // without rows still takes part in the collective write.
+    H5::DataSpace file_space = ds.getSpace();
+    H5::DataSpace mem_space(n_dims, slab_dims.data());
+    if (n_rows > 0) {
+      file_space.selectHyperslab(H5S_SELECT_SET, slab_dims.data(),
+                                 offset_dims.data());
+    } else {
+      file_space.selectNone();
+      mem_space.selectNone();
+    }
+
+    ds.write(data, type, mem_space, file_space, transfer);
+#if H5_VERSION_GE(1,10,0)
+    if (opts.swmr) H5Dflush(ds.getId());
+#endif
+    return n_added;
+  }
 }
@@ -9,11 +9,84 @@
 #include "H5Cpp.h"
 #include <string>
 #include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <stdexcept>
+#include <utility>
 
 namespace h5 {
   // Utility function to get a ``packed'' version of the datatype.
   // This lets us buffer structures which have stuff we don't want to write.
   H5::CompType packed(H5::CompType);
+
+  // The HDF5 library isn't generally built thread-safe, so every call
+  // that touches a file from a buffer goes through this lock. It's
+  // shared by all buffers, since several datasets can live in one file.
+  std::mutex& io_mutex();
+
+  // Dataset creation settings. The compression string is one of
+  // `none`, `deflate-N` (N = 0-9, plain `deflate` is 6), `szip`, or
+  // `lzf`. LZF isn't part of HDF5: it needs the filter from h5py
+  // registered as a plugin, and HDF5 only allows szip on atomic
+  // numeric types. A chunk size of zero means "use the buffer size".
+  //
+  // With parallel HDF5, setting `comm` makes the ranks of the
+  // communicator write into one shared dataset: `flush()` is then
+  // collective, every rank has to call it in the same order (with an
+  // empty buffer if need be), and the buffers never flush by
+  // themselves. The file has to be opened with the MPI-IO driver on
+  // the same communicator.
+  //
+  // With `swmr` every write is flushed to the file with `H5Dflush`, so
+  // that readers of a file in single-writer/multiple-reader mode see
+  // the new rows.
+  struct DatasetOptions {
+    DatasetOptions();
+    hsize_t chunk_size;
+    std::string compression;
+    bool shuffle;
+    bool swmr;
+#ifdef H5_HAVE_PARALLEL
+    MPI_Comm comm;
+#endif
+  };
+
+  // Build the creation property list, throws `std::invalid_argument`
+  // if the compression string isn't understood.
+  H5::DSetCreatPropList dataset_params(const DatasetOptions&,
+                                       hsize_t buffer_size);
+
+  // true if the options have a communicator
+  bool collective(const DatasetOptions&);
+
+#ifdef H5_HAVE_PARALLEL
+  // Where the rows of this rank go when every rank of `comm` adds
+  // `n_rows`: `offset` is the sum over the ranks before it, `total`
+  // the sum over all of them.
+  struct Slab {
+    hsize_t offset;
+    hsize_t total;
+  };
+  Slab collective_slab(MPI_Comm comm, hsize_t n_rows);
+#endif
+
+  // Append `n_rows` rows (of `n_columns` entries, zero for a 1-D
+  // dataset) to `ds`, which holds `offset` rows so far. Returns the
+  // number of rows added, which is the sum over the ranks if the
+  // write is collective. The caller holds the `io_mutex()`.
+  hsize_t write_rows(H5::DataSet& ds, const void* data,
+                     const H5::DataType& type, hsize_t n_rows,
+                     hsize_t n_columns, hsize_t offset,
+                     const DatasetOptions&);
+
+  // Same for rows of any fixed shape, `row_dims` are the dimensions of
+  // the dataset after the first one.
+  hsize_t write_rows(H5::DataSet& ds, const void* data,
+                     const H5::DataType& type, hsize_t n_rows,
+                     const std::vector<hsize_t>& row_dims,
+                     hsize_t offset, const DatasetOptions&);
 }
 
 // _________________________________________________________________________
@@ -29,29 +102,48 @@ public:
   //  - The first argument should be a group or file,
   //  - the second is the name of this dataset within the file,
   //  - the third is the ``type'' as seen by HDF5.
-  //  - The final entry is the max size of the buffer. It's only limited
+  //  - The fourth entry is the max size of the buffer. It's only limited
   //    by your machine's memory.
+  //  - The last sets up chunking and compression on disk.
   OneDimBuffer(H5::CommonFG& group, std::string ds_name,
-	       H5::DataType type, hsize_t buffer_size = 10);
+	       H5::DataType type, hsize_t buffer_size = 10,
+	       const h5::DatasetOptions& = h5::DatasetOptions());
 
   // Constructor for compound types. We use this to make sure `pack`
   // is called on the on-disk datatype (so we don't save space for
   // bookkeeping info in the memory-resident objets).
   OneDimBuffer(H5::CommonFG& group, std::string ds_name,
-	       H5::CompType type, hsize_t buffer_size = 10);
+	       H5::CompType type, hsize_t buffer_size = 10,
+	       const h5::DatasetOptions& = h5::DatasetOptions());
 
   // Disable copy and assignment (for now), not sure what copying will do
   // with an open HDF5 file.
   OneDimBuffer(const OneDimBuffer&) = delete;
   OneDimBuffer& operator=(OneDimBuffer) = delete;
 
+  // Stops the writer thread (if there is one). Call `close()` first
+  // if you want to see errors from the last write.
+  ~OneDimBuffer();
+
+  // Hand full buffers to a background thread rather than writing
+  // them in `flush()`. The event loop keeps filling a second buffer
+  // while the first is compressed and written. Can be switched at any
+  // time: the entries buffered so far are flushed first, and turning it
+  // off waits for the writer thread. Throws `std::logic_error` for
+  // collective writes.
+  void set_async(bool async = true);
+
   // should be pretty self-explanatory...
   void push_back(T new_entry);
-  // empty the buffer to disk
+  // build the entry in place from `args`, skips the temporary that
+  // `push_back` needs when `T` is made from something else
+  template<typename... Args>
+  void emplace_back(Args&&... args);
+  // empty the buffer to disk (or queue it for the writer thread)
   void flush();
   // get the _total_ size (buffered and written)
   hsize_t size() const;
-  // close the dataset
+  // close the dataset, waits for any pending writes
   void close();
 
 // ____________________________________________________________________
@@ -62,7 +154,17 @@ private:
   // datatype, since (in the case of compound datatypes) we don't
   // always want the same layout.
   OneDimBuffer(H5::CommonFG& group, std::string ds_name,
-	       H5::DataType type, H5::DataType disk_type, hsize_t = 10);
+	       H5::DataType type, H5::DataType disk_type, hsize_t,
+	       const h5::DatasetOptions&);
+
+  // write `buffer` to the dataset, starting at `offset`, returns the
+  // number of rows added
+  hsize_t write_slab(const std::vector<T>& buffer, hsize_t offset);
+
+  // background writer bits
+  void writer_loop();
+  void wait_for_writer();
+  void stop_writer(bool rethrow = true);
 
   // In-memory datatype
   H5::DataType _type;
@@ -70,6 +172,9 @@ private:
   // size where `flush()` is called
   hsize_t _max_size;
 
+  // chunking, compression and communicator
+  h5::DatasetOptions _opts;
+
   // keep track of the current position in the disk dataset.
   hsize_t _offset;
 
@@ -78,21 +183,34 @@ private:
 
   // the dataset we're writing to.
   H5::DataSet _ds;
+
+  // In async mode `flush()` swaps `_buffer` with `_write_buffer` and
+  // wakes up the writer, which owns `_write_buffer` until `_pending`
+  // is cleared.
+  bool _async;
+  std::vector<T> _write_buffer;
+  hsize_t _write_offset;
+  bool _pending;
+  bool _stop;
+  std::exception_ptr _writer_error;
+  std::thread _writer;
+  std::mutex _mutex;
+  std::condition_variable _cv;
 };
 
 // Public constructors: thin wrappers on the internal constructor.
 template<typename T>
 OneDimBuffer<T>::OneDimBuffer(
   H5::CommonFG& group, std::string ds_name,
-  H5::DataType type, hsize_t size):
-  OneDimBuffer(group, ds_name, type, type, size)
+  H5::DataType type, hsize_t size, const h5::DatasetOptions& opts):
+  OneDimBuffer(group, ds_name, type, type, size, opts)
 {
 }
 template<typename T>
 OneDimBuffer<T>::OneDimBuffer(
   H5::CommonFG& group, std::string ds_name,
-  H5::CompType type, hsize_t size):
-  OneDimBuffer(group, ds_name, type, h5::packed(type), size)
+  H5::CompType type, hsize_t size, const h5::DatasetOptions& opts):
+  OneDimBuffer(group, ds_name, type, h5::packed(type), size, opts)
 {
 }
 
@@ -100,10 +218,16 @@ OneDimBuffer<T>::OneDimBuffer(
 template<typename T>
 OneDimBuffer<T>::OneDimBuffer(
   H5::CommonFG& group, std::string ds_name,
-  H5::DataType type, H5::DataType disk_type, hsize_t buffer_size):
+  H5::DataType type, H5::DataType disk_type, hsize_t buffer_size,
+  const h5::DatasetOptions& opts):
   _type(type),
   _max_size(buffer_size),
-  _offset(0)
+  _opts(opts),
+  _offset(0),
+  _async(false),
+  _write_offset(0),
+  _pending(false),
+  _stop(false)
 {
   // the dataset starts as a 1-dim array of zero length, but we can
   // expand it to infinity.
@@ -113,54 +237,73 @@ OneDimBuffer<T>::OneDimBuffer(
   // the space occupied by the original dataset
   H5::DataSpace orig_space(1, initial, eventual);
 
-  // We have to enable `chunking` in the file to save by block.  Not
-  // sure what the optimum is, just go with buffer size for now.
-  H5::DSetCreatPropList params;
-  hsize_t chunk_size[1] = {buffer_size};
-  params.setChunk(1, chunk_size);
-  params.setDeflate(7);
+  // We have to enable `chunking` in the file to save by block. By
+  // default the chunk is the buffer size.
+  H5::DSetCreatPropList params = h5::dataset_params(opts, buffer_size);
 
   // Create the actual dataset.
+  std::lock_guard<std::mutex> io_lock(h5::io_mutex());
   _ds = group.createDataSet(ds_name, disk_type, orig_space, params);
 }
 
+template<typename T>
+OneDimBuffer<T>::~OneDimBuffer() {
+  stop_writer(false);
+}
+
+template<typename T>
+void OneDimBuffer<T>::set_async(bool async) {
+  if (async == _async) return;
+  if (async && h5::collective(_opts)) {
+    throw std::logic_error("collective writes can't be asynchronous");
+  }
+  flush();
+  if (async) {
+    _stop = false;
+    _writer = std::thread(&OneDimBuffer<T>::writer_loop, this);
+  } else {
+    stop_writer();
+  }
+  _async = async;
+}
+
 // Simple push_back function. Calls `flush()` if the buffer is full.
 template<typename T>
 void OneDimBuffer<T>::push_back(T new_entry) {
-  if (_buffer.size() == _max_size) {
+  if (_buffer.size() == _max_size && !h5::collective(_opts)) {
     flush();
   }
-  _buffer.push_back(new_entry);
+  _buffer.push_back(std::move(new_entry));
+}
+template<typename T>
+template<typename... Args>
+void OneDimBuffer<T>::emplace_back(Args&&... args) {
+  if (_buffer.size() == _max_size && !h5::collective(_opts)) {
+    flush();
+  }
+  _buffer.emplace_back(std::forward<Args>(args)...);
 }
 
-// This is where a lot of magic happens. We have to:
-//  - Extend the dataset to accommodate the new entry.
-//  - Select the part of the new dataset (the hyperslab) to write to.
-//  - Write the buffer out.
-//  - Update the offset.
+// In sync mode the buffer is written right here. In async mode we
+// wait for the previous write to finish, then swap buffers and let the
+// writer thread take it from there. Collective writes add the rows of
+// all the ranks.
 template<typename T>
 void OneDimBuffer<T>::flush() {
-  if (_buffer.size() == 0) return;
-
-  // The `hyperslab' we're writing to is the size of the buffer.
-  hsize_t slab_dims[1] = {_buffer.size()};
-
-  // The total size of the dataset must be extended to accomidate the
-  // new entries.
-  hsize_t total_dims[1] = {slab_dims[0] + _offset};
-  _ds.extend(total_dims);
-
-  // We'll only write to the end of the current file, so we select
-  // the file's `DataSpace` and then pick only the entries corresponding
-  // to the new slab we'll add.
-  H5::DataSpace file_space = _ds.getSpace();
-  H5::DataSpace mem_space(1, slab_dims);
-  hsize_t offset_dims[1] = {_offset};
-  file_space.selectHyperslab(H5S_SELECT_SET, slab_dims, offset_dims);
-
-  // Write out data, update offset and clear buffer.
-  _ds.write(_buffer.data(), _type, mem_space, file_space);
-  _offset += _buffer.size();
+  if (_buffer.size() == 0 && !h5::collective(_opts)) return;
+
+  hsize_t n_entries = _buffer.size();
+  if (!_async) {
+    n_entries = write_slab(_buffer, _offset);
+  } else {
+    wait_for_writer();
+    std::lock_guard<std::mutex> lock(_mutex);
+    _write_buffer.swap(_buffer);
+    _write_offset = _offset;
+    _pending = true;
+    _cv.notify_all();
+  }
+  _offset += n_entries;
   _buffer.clear();
 }
 template<typename T>
@@ -171,7 +314,70 @@ hsize_t OneDimBuffer<T>::size() const
 
 template<typename T>
 void OneDimBuffer<T>::close() {
+  flush();
+  stop_writer();
+  std::lock_guard<std::mutex> io_lock(h5::io_mutex());
   _ds.close();
 }
 
+// The dataset is extended and the buffer goes to the new hyperslab at
+// the end, see `h5::write_rows`.
+template<typename T>
+hsize_t OneDimBuffer<T>::write_slab(const std::vector<T>& buffer,
+                                    hsize_t offset) {
+  std::lock_guard<std::mutex> io_lock(h5::io_mutex());
+  return h5::write_rows(_ds, buffer.data(), _type, buffer.size(), 0,
+                        offset, _opts);
+}
+
+// the writer thread sleeps until it gets a full buffer (or is told
+// to stop), writes it, and wakes up anyone waiting in `flush()`
+template<typename T>
+void OneDimBuffer<T>::writer_loop() {
+  std::unique_lock<std::mutex> lock(_mutex);
+  while (true) {
+    _cv.wait(lock, [this]{ return _pending || _stop; });
+    if (!_pending) return;
+    lock.unlock();
+    try {
+      write_slab(_write_buffer, _write_offset);
+    } catch (...) {
+      _writer_error = std::current_exception();
+    }
+    _write_buffer.clear();
+    lock.lock();
+    _pending = false;
+    _cv.notify_all();
+  }
+}
+
+// block until the writer is idle, rethrow anything it threw
+template<typename T>
+void OneDimBuffer<T>::wait_for_writer() {
+  std::unique_lock<std::mutex> lock(_mutex);
+  _cv.wait(lock, [this]{ return !_pending; });
+  if (_writer_error) {
+    std::exception_ptr error = _writer_error;
+    _writer_error = nullptr;
+    std::rethrow_exception(error);
+  }
+}
+
+template<typename T>
+void OneDimBuffer<T>::stop_writer(bool rethrow) {
+  if (!_writer.joinable()) return;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stop = true;
+    _cv.notify_all();
+  }
+  _writer.join();
+  _async = false;
+  if (_writer_error) {
+    std::exception_ptr error = _writer_error;
+    _writer_error = nullptr;
+    if (rethrow) std::rethrow_exception(error);
+  }
+}
+
 #endif
@@ -0,0 +1,123 @@
+// Buffer for fixed-width arrays of HDF5 objects.
+//
+// Each entry is a list of `T` which is truncated or padded to
+// `n_columns`, so the dataset on disk is a plain 2-D array with shape
+// [n_entries, n_columns]. This avoids the variable-length types used
+// by `h5::vector`, which are slow to read and compress badly.
+
+#ifndef TWO_DIM_BUFFER_HH
+#define TWO_DIM_BUFFER_HH
+
+#include "OneDimBuffer.hh"
+
+#include "H5Cpp.h"
+#include <string>
+#include <vector>
+#include <mutex>
+
+// _________________________________________________________________________
+// public interface
+template<typename T>
+class TwoDimBuffer
+{
+public:
+  // Arguments are the same as `OneDimBuffer`, with the addition of
+  // the number of columns and the object used for padding. The
+  // on-disk compound type is packed. The chunk size from `opts`
+  // counts rows, a communicator makes `flush()` collective as for
+  // `OneDimBuffer`.
+  TwoDimBuffer(H5::CommonFG& group, std::string ds_name,
+               H5::CompType type, hsize_t n_columns, const T& padding,
+               hsize_t buffer_size = 10,
+               const h5::DatasetOptions& = h5::DatasetOptions());
+
+  TwoDimBuffer(const TwoDimBuffer&) = delete;
+  TwoDimBuffer& operator=(TwoDimBuffer) = delete;
+
+  // add one row, returns the number of entries that were stored
+  // (i.e. after truncation)
+  template<typename C>
+  hsize_t push_back(const C& row);
+
+  void flush();
+  // total number of rows (buffered and written)
+  hsize_t size() const;
+  void close();
+
+private:
+  H5::DataType _type;
+  hsize_t _n_columns;
+  T _padding;
+  hsize_t _max_rows;
+  h5::DatasetOptions _opts;
+  hsize_t _offset;
+  // rows are stored contiguously, `n_columns` entries per row
+  std::vector<T> _buffer;
+  H5::DataSet _ds;
+};
+
+template<typename T>
+TwoDimBuffer<T>::TwoDimBuffer(
+  H5::CommonFG& group, std::string ds_name, H5::CompType type,
+  hsize_t n_columns, const T& padding, hsize_t buffer_size,
+  const h5::DatasetOptions& opts):
+  _type(type),
+  _n_columns(n_columns),
+  _padding(padding),
+  _max_rows(buffer_size),
+  _opts(opts),
+  _offset(0)
+{
+  hsize_t initial[2] = {0, n_columns};
+  hsize_t eventual[2] = {H5S_UNLIMITED, n_columns};
+  H5::DataSpace orig_space(2, initial, eventual);
+
+  hsize_t chunk_rows = opts.chunk_size > 0 ? opts.chunk_size : buffer_size;
+  H5::DSetCreatPropList params = h5::dataset_params(opts, buffer_size);
+  hsize_t chunk_size[2] = {chunk_rows, n_columns};
+  params.setChunk(2, chunk_size);
+
+  std::lock_guard<std::mutex> io_lock(h5::io_mutex());
+  _ds = group.createDataSet(ds_name, h5::packed(type), orig_space, params);
+}
+
+template<typename T>
+template<typename C>
+hsize_t TwoDimBuffer<T>::push_back(const C& row) {
+  if (_buffer.size() == _max_rows * _n_columns && !h5::collective(_opts)) {
+    flush();
+  }
+  hsize_t n_stored = 0;
+  for (auto itr = row.begin(); itr != row.end(); itr++) {
+    if (n_stored == _n_columns) break;
+    _buffer.push_back(*itr);
+    n_stored++;
+  }
+  _buffer.resize(_buffer.size() + _n_columns - n_stored, _padding);
+  return n_stored;
+}
+
+template<typename T>
+void TwoDimBuffer<T>::flush() {
+  if (_buffer.size() == 0 && !h5::collective(_opts)) return;
+  std::lock_guard<std::mutex> io_lock(h5::io_mutex());
+
+  _offset += h5::write_rows(_ds, _buffer.data(), _type,
+                            _buffer.size() / _n_columns, _n_columns,
+                            _offset, _opts);
+  _buffer.clear();
+}
+
+template<typename T>
+hsize_t TwoDimBuffer<T>::size() const {
+  return _offset + _buffer.size() / _n_columns;
+}
+
+template<typename T>
+void TwoDimBuffer<T>::close() {
+  flush();
+  std::lock_guard<std::mutex> io_lock(h5::io_mutex());
+  _ds.close();
+}
+
+#endif
@@ -48,4 +48,16 @@ namespace h5 {
     cont.h5.len = cont._char_vector.size();
   }
 
+  // strings keep short data inside the object, so rebuild everything
+  // if the storage moved
+  void appended(vector<string>& cont, const string* old_data) {
+    if (cont._vector.data() != old_data) {
+      reset(cont);
+      return;
+    }
+    cont._char_vector.push_back(cont._vector.back().data());
+    cont.h5.p = cont._char_vector.data();
+    cont.h5.len = cont._char_vector.size();
+  }
+
 }
@@ -1,10 +1,13 @@
 // Container classes
 // TODO:
 //  - Make sure the h5::vector constructor works on nested std::vector.
-//  - Figure out how to avoid calling `reset()` on each push_back call,
-//    we only really need this when the vector is moved after we exceed
-//    capacity.
 //  - Make a `getType` method which returns the HDF5 datatype.
+//
+// The `hvl_t` view in `h5` is kept up to date incrementally: moving
+// a std::vector doesn't move its elements, so moves and swaps just
+// take the views along, and `push_back` only appends to them. The
+// full rebuild in `reset()` runs on copies, and for strings when the
+// storage is reallocated (short strings live inside the object).
 
 #ifndef H5_CONTAINER_HH
 #define H5_CONTAINER_HH
@@ -22,10 +25,12 @@ namespace h5 {
     vector();
     vector(const vector&);
     vector(const std::vector<T>&);
-    vector(vector&&);
+    vector(vector&&) noexcept;
     vector(std::vector<T>&&);
     vector& operator=(vector);
-    void push_back(T value);
+    void push_back(const T& value);
+    void push_back(T&& value);
+    void reserve(size_t);
     size_t size() const;
     typename std::vector<T>::iterator begin() const;
     typename std::vector<T>::iterator end() const;
@@ -38,8 +43,10 @@ namespace h5 {
     // complaining about non-standard layout, but the data below
     // should be considered private. At the very least, be careful
     // modifying these members (in particular, call `reset()` if you
-    // do anything that could invalidate their pointers).
+    // do anything that could invalidate their pointers, including
+    // resizing a nested vector through `back()`).
     void reset();
+    void swap(vector&);
     std::vector<T> _vector;
     std::vector<hvl_t> _hvl_vector;
     // specialization for strings
@@ -74,8 +81,16 @@ namespace h5 {
   template<typename T>
   void reset(vector<T>& );
 
+  // update the views after one entry was added at the back, given the
+  // storage before the push
+  void appended(vector<string>&, const string* old_data);
+  template<typename T>
+  void appended(vector<vector<T>>&, const vector<T>* old_data);
+  template<typename T>
+  void appended(vector<T>&, const T* old_data);
+
   // boilerplate constructor, copy constructor, etc
-  // anything that modifies the vector must reset the pointers
+  // anything that copies the vector must reset the pointers
   template<typename T>
   vector<T>::vector(): _vector()
   {
@@ -92,10 +107,10 @@ namespace h5 {
     reset();
   }
   template<typename T>
-  vector<T>::vector(vector&& old):
-    _vector(std::move(old._vector))
+  vector<T>::vector(vector&& old) noexcept: _vector()
   {
     reset();
+    swap(old);
   }
   template<typename T>
   vector<T>::vector(std::vector<T>&& old):
@@ -106,16 +121,43 @@ namespace h5 {
   template<typename T>
   vector<T>& vector<T>::operator=(vector old)
   {
-    std::swap(this->_vector, old._vector);
-    reset();
+    swap(old);
     return *this;
   }
+  // swapping std::vectors leaves the elements in place, so the views
+  // stay valid and can be swapped along with them
+  template<typename T>
+  void vector<T>::swap(vector& other)
+  {
+    std::swap(h5, other.h5);
+    _vector.swap(other._vector);
+    _hvl_vector.swap(other._hvl_vector);
+    _char_vector.swap(other._char_vector);
+  }
 
   // several basic access functions
   template<typename T>
-  void vector<T>::push_back(T value)
+  void vector<T>::push_back(const T& value)
   {
+    const T* old_data = _vector.data();
     _vector.push_back(value);
+    h5::appended(*this, old_data);
+  }
+  template<typename T>
+  void vector<T>::push_back(T&& value)
+  {
+    const T* old_data = _vector.data();
+    _vector.push_back(std::move(value));
+    h5::appended(*this, old_data);
+  }
+  template<typename T>
+  void vector<T>::reserve(size_t n)
+  {
+    const T* old_data = _vector.data();
+    _vector.reserve(n);
+    _hvl_vector.reserve(n);
+    _char_vector.reserve(n);
+    if (_vector.data() != old_data) reset();
   }
   template<typename T>
   size_t vector<T>::size() const { return _vector.size(); }
@@ -165,5 +207,27 @@ namespace h5 {
     cont.h5.len = cont._vector.size();
   }
 
+  // nested vectors: the inner buffers shouldn't move when the outer
+  // storage does (the move constructor is noexcept), but rebuilding
+  // after a reallocation is cheap insurance
+  template<typename T>
+  void appended(vector<vector<T> >& cont, const vector<T>* old_data) {
+    if (cont._vector.data() != old_data) {
+      reset(cont);
+      return;
+    }
+    hvl_t hvl_entry;
+    hvl_entry.len = cont._vector.back().size();
+    hvl_entry.p = cont._vector.back().data();
+    cont._hvl_vector.push_back(hvl_entry);
+    cont.h5.p = cont._hvl_vector.data();
+    cont.h5.len = cont._hvl_vector.size();
+  }
+
+  template<typename T>
+  void appended(vector<T>& cont, const T*) {
+    reset(cont);
+  }
+
 }
 #endif
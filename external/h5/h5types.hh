@@ -6,10 +6,41 @@
 #include "H5Cpp.h"
 #include <vector>
 #include <string>
+#include <ostream>
+#include <cstddef>
 
 #define H5_INSERT(INTO, CLASS, MEMBER)					\
   h5::insert(INTO, #MEMBER, offsetof(CLASS, MEMBER), &CLASS::MEMBER)
 
+// Helpers for structures described by a single field list. The list
+// is a macro that applies its argument to each (type, name) pair:
+//
+//   #define MY_FIELDS(FIELD) FIELD(float, pt) FIELD(int, flavor)
+//
+//   struct My { MY_FIELDS(H5_DECLARE_FIELD) };
+//   H5_DEFINE_TYPE(My, MY_FIELDS)      // H5::CompType type(My)
+//   H5_DEFINE_OSTREAM(My, MY_FIELDS)   // prints "pt, flavor"
+//
+// so the struct, the HDF5 type, and the text dump can't drift apart.
+#define H5_DECLARE_FIELD(TYPE, NAME) TYPE NAME;
+
+#define H5_INSERT_FIELD(TYPE, NAME) H5_INSERT(out, h5_class_t, NAME);
+#define H5_DEFINE_TYPE(CLASS, FIELDS)		\
+  H5::CompType type(CLASS) {			\
+    typedef CLASS h5_class_t;			\
+    H5::CompType out(sizeof(CLASS));		\
+    FIELDS(H5_INSERT_FIELD)			\
+    return out;					\
+  }
+
+#define H5_STREAM_FIELD(TYPE, NAME) out << h5_sep << obj.NAME; h5_sep = ", ";
+#define H5_DEFINE_OSTREAM(CLASS, FIELDS)			\
+  std::ostream& operator<<(std::ostream& out, const CLASS& obj) {	\
+    const char* h5_sep = "";					\
+    FIELDS(H5_STREAM_FIELD)					\
+    return out;							\
+  }
+
 
 namespace h5 {
   H5::DataType type(int);
@@ -27,6 +58,15 @@ namespace h5 {
     into.insertMember(name, offset, type(M()));
   }
 
+  // fixed-size array members, such as the track parameters of a
+  // candidate, are stored as HDF5 arrays
+  template <typename M, size_t N, typename T>
+  void insert(H5::CompType& into, const std::string& name,
+	      size_t offset, M (T::*)[N]) {
+    const hsize_t dims[] = {N};
+    into.insertMember(name, offset, H5::ArrayType(type(M()), 1, dims));
+  }
+
 }
 
 #endif
@@ -97,7 +97,7 @@ void BTagging::Init()
 
   // import input array(s)
 
-  fJetInputArray = ImportArray(GetString("JetInputArray", "FastJetFinder/jets"));
+  fJetInputArray = UpdateArray(GetString("JetInputArray", "FastJetFinder/jets"));
   fItJetInputArray = fJetInputArray->MakeIterator();
 }
 
@@ -145,7 +145,7 @@ void BTagging::Process()
     formula = itEfficiencyMap->second;
 
     // apply an efficiency formula
-    jet->BTag |= (gRandom->Uniform() <= formula->Eval(pt, eta, phi, e)) << fBitNumber;
+    jet->BTag |= (GetRandom()->Uniform() <= formula->Eval(pt, eta, phi, e)) << fBitNumber;
 
     // find an efficiency formula for algo flavor definition
     itEfficiencyMap = fEfficiencyMap.find(jet->FlavorAlgo);
@@ -156,7 +156,7 @@ void BTagging::Process()
     formula = itEfficiencyMap->second;
 
     // apply an efficiency formula
-    jet->BTagAlgo |= (gRandom->Uniform() <= formula->Eval(pt, eta, phi, e)) << fBitNumber;
+    jet->BTagAlgo |= (GetRandom()->Uniform() <= formula->Eval(pt, eta, phi, e)) << fBitNumber;
 
     // find an efficiency formula for phys flavor definition
     itEfficiencyMap = fEfficiencyMap.find(jet->FlavorPhys);
@@ -167,7 +167,7 @@ void BTagging::Process()
     formula = itEfficiencyMap->second;
 
     // apply an efficiency formula
-    jet->BTagPhys |= (gRandom->Uniform() <= formula->Eval(pt, eta, phi, e)) << fBitNumber;
+    jet->BTagPhys |= (GetRandom()->Uniform() <= formula->Eval(pt, eta, phi, e)) << fBitNumber;
   }
 }
 
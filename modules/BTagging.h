@@ -47,6 +47,8 @@ public:
   void Process();
   void Finish();
 
+  Bool_t IsThreadSafe() const { return HasRandomStream(); }
+
 private:
 
   Int_t fBitNumber;
@@ -29,8 +29,10 @@
 #include "modules/Calorimeter.h"
 
 #include "classes/DelphesClasses.h"
+#include "classes/CandidateSpan.h"
 #include "classes/DelphesFactory.h"
 #include "classes/DelphesFormula.h"
+#include "classes/DelphesTowerHits.h"
 
 #include "ExRootAnalysis/ExRootResult.h"
 #include "ExRootAnalysis/ExRootFilter.h"
@@ -55,7 +57,6 @@ using namespace std;
 
 Calorimeter::Calorimeter() :
   fECalResolutionFormula(0), fHCalResolutionFormula(0),
-  fItParticleInputArray(0), fItTrackInputArray(0),
   fTowerTrackArray(0), fItTowerTrackArray(0)
 {
   fECalResolutionFormula = new DelphesFormula;
@@ -123,6 +124,8 @@ void Calorimeter::Init()
     }
   }
 
+  fTowerHits.Init(fEtaBins, fPhiBins);
+
   // read energy fractions for different particles
   param = GetParam("EnergyFraction");
   size = param.GetSize();
@@ -164,10 +167,8 @@ void Calorimeter::Init()
 
   // import array with output from other modules
   fParticleInputArray = ImportArray(GetString("ParticleInputArray", "ParticlePropagator/particles"));
-  fItParticleInputArray = fParticleInputArray->MakeIterator();
 
   fTrackInputArray = ImportArray(GetString("TrackInputArray", "ParticlePropagator/tracks"));
-  fItTrackInputArray = fTrackInputArray->MakeIterator();
 
   // create output arrays
   fTowerOutputArray = ExportArray(GetString("TowerOutputArray", "towers"));
@@ -183,8 +184,6 @@ void Calorimeter::Init()
 void Calorimeter::Finish()
 {
   vector< vector< Double_t >* >::iterator itPhiBin;
-  if(fItParticleInputArray) delete fItParticleInputArray;
-  if(fItTrackInputArray) delete fItTrackInputArray;
   for(itPhiBin = fPhiBins.begin(); itPhiBin != fPhiBins.end(); ++itPhiBin)
   {
     delete *itPhiBin;
@@ -196,126 +195,109 @@ void Calorimeter::Finish()
 void Calorimeter::Process()
 {
   Candidate *particle, *track;
-  TLorentzVector position, momentum;
   Short_t etaBin, phiBin, flags;
   Int_t number;
   Long64_t towerHit, towerEtaPhi, hitEtaPhi;
   Double_t ecalFraction, hcalFraction;
-  Double_t ecalEnergy, hcalEnergy;
-  Int_t pdgCode;
+  Double_t ecalEnergy, hcalEnergy, energy;
+  Int_t pdgCode, lastPdgCode;
 
   TFractionMap::iterator itFractionMap;
 
-  vector< Double_t >::iterator itEtaBin;
-  vector< Double_t >::iterator itPhiBin;
   vector< Double_t > *phiBins;
 
-  vector< Long64_t >::iterator itTowerHits;
+  vector< Long64_t >::const_iterator itTowerHits;
 
   DelphesFactory *factory = GetFactory();
-  fTowerHits.clear();
-  fTowerECalFractions.clear();
-  fTowerHCalFractions.clear();
-  fTrackECalFractions.clear();
-  fTrackHCalFractions.clear();
+  fTowerHits.Clear();
+
+  CandidateSpan particles(fParticleInputArray);
+  CandidateSpan tracks(fTrackInputArray);
+
+  fParticleECalDeposits.resize(particles.size());
+  fParticleHCalDeposits.resize(particles.size());
+  fTrackECalDeposits.resize(tracks.size());
+  fTrackHCalDeposits.resize(tracks.size());
+
+  // the particles of the same type often follow each other
+  lastPdgCode = -1;
+  ecalFraction = hcalFraction = 0.0;
 
   // loop over all particles
-  fItParticleInputArray->Reset();
-  number = -1;
-  while((particle = static_cast<Candidate*>(fItParticleInputArray->Next())))
+  for(number = 0; number < particles.size(); ++number)
   {
+    particle = particles[number];
     const TLorentzVector &particlePosition = particle->Position;
-    ++number;
 
     pdgCode = TMath::Abs(particle->PID);
 
-    itFractionMap = fFractionMap.find(pdgCode);
-    if(itFractionMap == fFractionMap.end())
+    if(pdgCode != lastPdgCode)
     {
-      itFractionMap = fFractionMap.find(0);
-    }
+      itFractionMap = fFractionMap.find(pdgCode);
+      if(itFractionMap == fFractionMap.end())
+      {
+        itFractionMap = fFractionMap.find(0);
+      }
 
-    ecalFraction = itFractionMap->second.first;
-    hcalFraction = itFractionMap->second.second;
+      ecalFraction = itFractionMap->second.first;
+      hcalFraction = itFractionMap->second.second;
+      lastPdgCode = pdgCode;
+    }
 
-    fTowerECalFractions.push_back(ecalFraction);
-    fTowerHCalFractions.push_back(hcalFraction);
+    energy = particle->Momentum.E();
+    fParticleECalDeposits[number] = energy * ecalFraction;
+    fParticleHCalDeposits[number] = energy * hcalFraction;
 
     if(ecalFraction < 1.0E-9 && hcalFraction < 1.0E-9) continue;
 
-    // find eta bin [1, fEtaBins.size - 1]
-    itEtaBin = lower_bound(fEtaBins.begin(), fEtaBins.end(), particlePosition.Eta());
-    if(itEtaBin == fEtaBins.begin() || itEtaBin == fEtaBins.end()) continue;
-    etaBin = distance(fEtaBins.begin(), itEtaBin);
-
-    // phi bins for given eta bin
-    phiBins = fPhiBins[etaBin];
-
-    // find phi bin [1, phiBins.size - 1]
-    itPhiBin = lower_bound(phiBins->begin(), phiBins->end(), particlePosition.Phi());
-    if(itPhiBin == phiBins->begin() || itPhiBin == phiBins->end()) continue;
-    phiBin = distance(phiBins->begin(), itPhiBin);
-
     flags = 0;
     flags |= (pdgCode == 11 || pdgCode == 22) << 1;
 
-    // make tower hit {16-bits for eta bin number, 16-bits for phi bin number, 8-bits for flags, 24-bits for particle number}
-    towerHit = (Long64_t(etaBin) << 48) | (Long64_t(phiBin) << 32) | (Long64_t(flags) << 24) | Long64_t(number);
-
-    fTowerHits.push_back(towerHit);
+    // add tower hit, if the particle is inside the calorimeter
+    fTowerHits.Add(particlePosition.Eta(), particlePosition.Phi(), flags, number);
   }
 
+  lastPdgCode = -1;
+
   // loop over all tracks
-  fItTrackInputArray->Reset();
-  number = -1;
-  while((track = static_cast<Candidate*>(fItTrackInputArray->Next())))
+  for(number = 0; number < tracks.size(); ++number)
   {
+    track = tracks[number];
     const TLorentzVector &trackPosition = track->Position;
-    ++number;
 
     pdgCode = TMath::Abs(track->PID);
 
-    itFractionMap = fFractionMap.find(pdgCode);
-    if(itFractionMap == fFractionMap.end())
+    if(pdgCode != lastPdgCode)
     {
-      itFractionMap = fFractionMap.find(0);
-    }
-
-    ecalFraction = itFractionMap->second.first;
-    hcalFraction = itFractionMap->second.second;
-
-    fTrackECalFractions.push_back(ecalFraction);
-    fTrackHCalFractions.push_back(hcalFraction);
-
-    // find eta bin [1, fEtaBins.size - 1]
-    itEtaBin = lower_bound(fEtaBins.begin(), fEtaBins.end(), trackPosition.Eta());
-    if(itEtaBin == fEtaBins.begin() || itEtaBin == fEtaBins.end()) continue;
-    etaBin = distance(fEtaBins.begin(), itEtaBin);
+      itFractionMap = fFractionMap.find(pdgCode);
+      if(itFractionMap == fFractionMap.end())
+      {
+        itFractionMap = fFractionMap.find(0);
+      }
 
-    // phi bins for given eta bin
-    phiBins = fPhiBins[etaBin];
+      ecalFraction = itFractionMap->second.first;
+      hcalFraction = itFractionMap->second.second;
+      lastPdgCode = pdgCode;
+    }
 
-    // find phi bin [1, phiBins.size - 1]
-    itPhiBin = lower_bound(phiBins->begin(), phiBins->end(), trackPosition.Phi());
-    if(itPhiBin == phiBins->begin() || itPhiBin == phiBins->end()) continue;
-    phiBin = distance(phiBins->begin(), itPhiBin);
+    energy = track->Momentum.E();
+    fTrackECalDeposits[number] = energy * ecalFraction;
+    fTrackHCalDeposits[number] = energy * hcalFraction;
 
     flags = 1;
 
-    // make tower hit {16-bits for eta bin number, 16-bits for phi bin number, 8-bits for flags, 24-bits for track number}
-    towerHit = (Long64_t(etaBin) << 48) | (Long64_t(phiBin) << 32) | (Long64_t(flags) << 24) | Long64_t(number);
-
-    fTowerHits.push_back(towerHit);
+    // add tower hit, if the track is inside the calorimeter
+    fTowerHits.Add(trackPosition.Eta(), trackPosition.Phi(), flags, number);
   }
 
-  // all hits are sorted first by eta bin number, then by phi bin number,
+  // all hits are ordered first by eta bin number, then by phi bin number,
   // then by flags and then by particle or track number
-  sort(fTowerHits.begin(), fTowerHits.end());
+  const vector< Long64_t > &towerHits = fTowerHits.GetHits();
 
   // loop over all hits
   towerEtaPhi = 0;
   fTower = 0;
-  for(itTowerHits = fTowerHits.begin(); itTowerHits != fTowerHits.end(); ++itTowerHits)
+  for(itTowerHits = towerHits.begin(); itTowerHits != towerHits.end(); ++itTowerHits)
   {
     towerHit = (*itTowerHits);
     flags = (towerHit >> 24) & 0x00000000000000FFLL;
@@ -358,6 +340,7 @@ void Calorimeter::Process()
       fTowerPhotonHits = 0;
 
       fTowerTrackArray->Clear();
+      fTowerECalEnergyTimes.clear();
     }
 
     // check for track hits
@@ -365,12 +348,10 @@ void Calorimeter::Process()
     {
       ++fTowerTrackHits;
 
-      track = static_cast<Candidate*>(fTrackInputArray->At(number));
-      momentum = track->Momentum;
-      position = track->Position;
+      track = tracks[number];
 
-      ecalEnergy = momentum.E() * fTrackECalFractions[number];
-      hcalEnergy = momentum.E() * fTrackHCalFractions[number];
+      ecalEnergy = fTrackECalDeposits[number];
+      hcalEnergy = fTrackHCalDeposits[number];
 
       fTrackECalEnergy += ecalEnergy;
       fTrackHCalEnergy += hcalEnergy;
@@ -379,7 +360,7 @@ void Calorimeter::Process()
       {
         if(fElectronsFromTrack)
         {
-          fTower->ECalEnergyTimePairs.push_back(make_pair<Float_t, Float_t>(ecalEnergy, track->Position.T()));
+          fTowerECalEnergyTimes.push_back(make_pair<Float_t, Float_t>(ecalEnergy, track->Position.T()));
         }
       }
 
@@ -391,13 +372,11 @@ void Calorimeter::Process()
     // check for photon and electron hits in current tower
     if(flags & 2) ++fTowerPhotonHits;
 
-    particle = static_cast<Candidate*>(fParticleInputArray->At(number));
-    momentum = particle->Momentum;
-    position = particle->Position;
+    particle = particles[number];
 
     // fill current tower
-    ecalEnergy = momentum.E() * fTowerECalFractions[number];
-    hcalEnergy = momentum.E() * fTowerHCalFractions[number];
+    ecalEnergy = fParticleECalDeposits[number];
+    hcalEnergy = fParticleHCalDeposits[number];
 
     fTowerECalEnergy += ecalEnergy;
     fTowerHCalEnergy += hcalEnergy;
@@ -406,7 +385,7 @@ void Calorimeter::Process()
     {
       if (abs(particle->PID) != 11 || !fElectronsFromTrack)
       {
-        fTower->ECalEnergyTimePairs.push_back(make_pair<Float_t, Float_t>(ecalEnergy, particle->Position.T()));
+        fTowerECalEnergyTimes.push_back(make_pair<Float_t, Float_t>(ecalEnergy, particle->Position.T()));
       }
     }
 
@@ -445,8 +424,8 @@ void Calorimeter::FinalizeTower()
 
   if(fSmearTowerCenter)
   {
-    eta = gRandom->Uniform(fTowerEdges[0], fTowerEdges[1]);
-    phi = gRandom->Uniform(fTowerEdges[2], fTowerEdges[3]);
+    eta = GetRandom()->Uniform(fTowerEdges[0], fTowerEdges[1]);
+    phi = GetRandom()->Uniform(fTowerEdges[2], fTowerEdges[3]);
   }
   else
   {
@@ -461,10 +440,10 @@ void Calorimeter::FinalizeTower()
   sumWeightedTime = 0.0;
   sumWeight = 0.0;
 
-  for(size_t i = 0; i < fTower->ECalEnergyTimePairs.size(); ++i)
+  for(size_t i = 0; i < fTowerECalEnergyTimes.size(); ++i)
   {
-    weight = TMath::Sqrt(fTower->ECalEnergyTimePairs[i].first);
-    sumWeightedTime += weight * fTower->ECalEnergyTimePairs[i].second;
+    weight = TMath::Sqrt(fTowerECalEnergyTimes[i].first);
+    sumWeightedTime += weight * fTowerECalEnergyTimes[i].second;
     sumWeight += weight;
     fTower->NTimeHits++;
   }
@@ -478,6 +457,10 @@ void Calorimeter::FinalizeTower()
     fTower->Position.SetPtEtaPhiE(1.0, eta, phi, 999999.9);
   }
 
+  if(GetFactory()->GetKeepECalEnergyTimes() && !fTowerECalEnergyTimes.empty())
+  {
+    fTower->SetECalEnergyTimePairs(&fTowerECalEnergyTimes[0], fTowerECalEnergyTimes.size());
+  }
 
   fTower->Momentum.SetPtEtaPhiE(pt, eta, phi, energy);
   fTower->Eem = ecalEnergy;
@@ -557,7 +540,7 @@ Double_t Calorimeter::LogNormal(Double_t mean, Double_t sigma)
     b = TMath::Sqrt(TMath::Log((1.0 + (sigma*sigma)/(mean*mean))));
     a = TMath::Log(mean) - 0.5*b*b;
 
-    return TMath::Exp(a + b*gRandom->Gaus(0.0, 1.0));
+    return TMath::Exp(a + b*GetRandom()->Gaus(0.0, 1.0));
   }
   else
   {
@@ -30,6 +30,10 @@
 
 #include "classes/DelphesModule.h"
 
+#if !defined(__CINT__) && !defined(__CLING__)
+#include "classes/DelphesTowerHits.h"
+#endif
+
 #include <map>
 #include <set>
 #include <vector>
@@ -49,6 +53,8 @@ public:
   void Process();
   void Finish();
 
+  Bool_t IsThreadSafe() const { return HasRandomStream(); }
+
 private:
 
   typedef std::map< Long64_t, std::pair< Double_t, Double_t > > TFractionMap; //!
@@ -78,20 +84,26 @@ private:
   std::vector < Double_t > fEtaBins;
   std::vector < std::vector < Double_t >* > fPhiBins;
 
-  std::vector < Long64_t > fTowerHits;
+#if !defined(__CINT__) && !defined(__CLING__)
+  DelphesTowerHits fTowerHits; //!
+#endif
+
+  // energies that the particles and the tracks of the event leave in the
+  // ECAL and in the HCAL, gathered with their tower hits, so that the
+  // towers are filled from these arrays
+  std::vector < Double_t > fParticleECalDeposits;
+  std::vector < Double_t > fParticleHCalDeposits;
 
-  std::vector < Double_t > fTowerECalFractions;
-  std::vector < Double_t > fTowerHCalFractions;
+  std::vector < Double_t > fTrackECalDeposits;
+  std::vector < Double_t > fTrackHCalDeposits;
 
-  std::vector < Double_t > fTrackECalFractions;
-  std::vector < Double_t > fTrackHCalFractions;
+  // energy and time of the ECAL hits of the current tower, only copied to
+  // the tower when a module reads them
+  std::vector < std::pair < Float_t, Float_t > > fTowerECalEnergyTimes;
 
   DelphesFormula *fECalResolutionFormula; //!
   DelphesFormula *fHCalResolutionFormula; //!
 
-  TIterator *fItParticleInputArray; //!
-  TIterator *fItTrackInputArray; //!
-
   const TObjArray *fParticleInputArray; //!
   const TObjArray *fTrackInputArray; //!
 
@@ -89,7 +89,7 @@ void ConstituentFilter::Init()
   size = param.GetSize();
   for(i = 0; i < size/2; ++i)
   {
-    array = ImportArray(param[i*2].GetString());
+    array = UpdateArray(param[i*2].GetString());
     iterator = array->MakeIterator();
 
     fInputMap[iterator] = ExportArray(param[i*2 + 1].GetString());
@@ -122,11 +122,17 @@ void ConstituentFilter::Finish()
 void ConstituentFilter::Process()
 {
   Candidate *jet, *constituent;
+  Int_t i, n;
   map< TIterator *, TObjArray * >::iterator itInputMap;
   vector< TIterator * >::iterator itInputList;
   TIterator *iterator;
   TObjArray *array;
 
+  // the constituents are marked by address, the unique IDs only differ
+  // within one factory and the arrays may come from several, and the
+  // candidates themselves are left untouched
+  fMarks.clear();
+
   // loop over all jet input arrays
   for(itInputList = fInputList.begin(); itInputList != fInputList.end(); ++itInputList)
   {
@@ -136,15 +142,13 @@ void ConstituentFilter::Process()
     iterator->Reset();
     while((jet = static_cast<Candidate*>(iterator->Next())))
     {
-      TIter itConstituents(jet->GetCandidates());
-
       if(jet->Momentum.Pt() <= fJetPTMin) continue;
 
       // loop over all constituents
-      while((constituent = static_cast<Candidate*>(itConstituents.Next())))
+      n = jet->GetNumberOfCandidates();
+      for(i = 0; i < n; ++i)
       {
-        // set the IsConstituent flag
-        constituent->IsConstituent = 1;
+        fMarks.insert(jet->GetCandidate(i));
       }
     }
   }
@@ -159,8 +163,7 @@ void ConstituentFilter::Process()
     iterator->Reset();
     while((constituent = static_cast<Candidate*>(iterator->Next())))
     {
-      // check the IsConstituent flag
-      if(constituent->IsConstituent)
+      if(fMarks.count(constituent) > 0)
       {
         array->Add(constituent);
       }
@@ -31,6 +31,7 @@
 
 #include <vector>
 #include <map>
+#include <unordered_set>
 
 class TIterator;
 class TObjArray;
@@ -46,6 +47,8 @@ public:
   void Process();
   void Finish();
 
+  Bool_t IsThreadSafe() const { return kTRUE; }
+
 private:
 
   Double_t fJetPTMin;
@@ -54,6 +57,9 @@ private:
 
   std::map< TIterator *, TObjArray * > fInputMap; //!
 
+  // constituents of the selected jets
+  std::unordered_set< const TObject * > fMarks; //!
+
   TObjArray *fOutputArray; //!
 
   ClassDef(ConstituentFilter, 1)
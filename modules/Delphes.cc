@@ -27,6 +27,10 @@
  */
 
 #include "modules/Delphes.h"
+#include "modules/DelphesModuleScheduler.h"
+#include "modules/DelphesProfiler.h"
+#include "modules/DelphesMetrics.h"
+#include "modules/DelphesSweep.h"
 
 #include "classes/DelphesClasses.h"
 #include "classes/DelphesFactory.h"
@@ -49,6 +53,7 @@
 #include "TLorentzVector.h"
 
 #include <algorithm> 
+#include <random>
 #include <stdexcept>
 #include <iostream>
 #include <sstream>
@@ -58,8 +63,10 @@
 
 using namespace std;
 
-Delphes::Delphes(const char *name) :
-  fFactory(0)
+Delphes::Delphes(const char *name, Bool_t isolated) :
+  fFactory(0), fIsolated(isolated), fModuleThreads(1), fRandomSeed(0),
+  fRandomStreams(kFALSE), fGaussianBuffers(kFALSE), fEventCounter(0), fEventNumber(-1), fScheduler(0),
+  fModuleTiming(kFALSE), fProfiler(0), fMemoryBudget(0.0), fMetrics(0), fSweep(0)
 {
   TFolder *folder = new TFolder(name, "");
   fFactory = new DelphesFactory("ObjectFactory");
@@ -70,13 +77,24 @@ Delphes::Delphes(const char *name) :
   folder->Add(this);
   folder->Add(fFactory);
 
-  gROOT->GetListOfBrowsables()->Add(folder);
+  if(fIsolated)
+  {
+    fFactory->SetLocalObjectCount(kTRUE);
+  }
+  else
+  {
+    gROOT->GetListOfBrowsables()->Add(folder);
+  }
 }
 
 //------------------------------------------------------------------------------
 
 Delphes::~Delphes()
 {
+  if(fSweep) delete fSweep;
+  if(fScheduler) delete fScheduler;
+  if(fMetrics) delete fMetrics;
+  if(fProfiler) delete fProfiler;
   if(fFactory) delete fFactory;
   TFolder *folder = GetFolder();
   if(folder)
@@ -95,6 +113,13 @@ void Delphes::Clear()
 
 //------------------------------------------------------------------------------
 
+Bool_t Delphes::IsEventRejected() const
+{
+  return fFactory && fFactory->IsEventRejected();
+}
+
+//------------------------------------------------------------------------------
+
 void Delphes::SetTreeWriter(ExRootTreeWriter *treeWriter)
 {
   treeWriter->SetName("TreeWriter");
@@ -110,19 +135,52 @@ void Delphes::Init()
   confReader->SetName("ConfReader");
   GetFolder()->Add(confReader);
 
-  TString name;
+  TString name, sweepStart;
   ExRootTask *task;
   const ExRootConfReader::ExRootTaskMap *modules = confReader->GetModules();
   ExRootConfReader::ExRootTaskMap::const_iterator itModules;
+  ExRootTreeWriter *treeWriter;
+  Int_t compressionThreads;
 
   ExRootConfParam param = confReader->GetParam("::ExecutionPath");
   Long_t i, size = param.GetSize();
 
-  gRandom->SetSeed(confReader->GetInt("::RandomSeed", 0));
+  fRandomSeed = confReader->GetInt("::RandomSeed", 0);
+  if(!fIsolated) gRandom->SetSeed(fRandomSeed);
+
+  fModuleThreads = confReader->GetInt("::ModuleThreads", 1);
+
+  // modules running at the same time can't share gRandom
+  fRandomStreams = confReader->GetBool("::RandomStreams", false) || fModuleThreads > 1 || fIsolated;
+
+  fGaussianBuffers = confReader->GetBool("::GaussianBuffers", false);
+
+  fModuleTiming = confReader->GetBool("::ModuleTiming", false);
+  fModuleTimingFile = confReader->GetString("::ModuleTimingFile", "");
+  fModuleTraceFile = confReader->GetString("::ModuleTraceFile", "");
+
+  // resident memory of the process in MB, 0 for no limit
+  fMemoryBudget = confReader->GetDouble("::MemoryBudget", 0.0);
+
+  fMetricsFile = confReader->GetString("::MetricsFile", "");
+
+  // the modules from SweepStart on run once for every variant
+  sweepStart = confReader->GetString("::SweepStart", "");
+
+  fFactory->SetCandidateArena(confReader->GetBool("::CandidateArena", false));
+
+  // MB of objects and buffers the factory keeps after an event, 0 for no limit
+  fFactory->SetPoolBudget(Long64_t(confReader->GetDouble("::PoolBudget", 0.0)*1048576.0));
+
+  // compress the baskets of the output tree in parallel when it is filled
+  compressionThreads = confReader->GetInt("::OutputCompressionThreads", 0);
+  treeWriter = dynamic_cast< ExRootTreeWriter * >(GetFolder()->FindObject("TreeWriter"));
+  if(treeWriter && compressionThreads > 0) treeWriter->SetCompressionThreads(compressionThreads);
 
   for(i = 0; i < size; ++i)
   {
     name = param[i].GetString();
+    if(sweepStart.Length() > 0 && name == sweepStart) break;
     itModules = modules->find(name);
     if(itModules != modules->end())
     {
@@ -140,6 +198,16 @@ void Delphes::Init()
       throw runtime_error(message.str());
     }
   }
+
+  if(sweepStart.Length() > 0)
+  {
+    if(i == size)
+    {
+      message << "SweepStart module '" << sweepStart << "' is not in ExecutionPath.";
+      throw runtime_error(message.str());
+    }
+    fSweep = new DelphesSweep(confReader, i);
+  }
 }
 
 //------------------------------------------------------------------------------
@@ -155,3 +223,199 @@ void Delphes::Finish()
 }
 
 //------------------------------------------------------------------------------
+
+void Delphes::InitTask()
+{
+  DelphesModule *module;
+  TObject *task;
+  Bool_t writesTree;
+  UInt_t seed;
+
+  DelphesModule::InitTask();
+
+  // TRef and TProcessID are only needed for the references in the tree
+  writesTree = kFALSE;
+  TIter itWriters(GetListOfTasks());
+  while((task = itWriters.Next()))
+  {
+    module = dynamic_cast< DelphesModule * >(task);
+    if(module && module->WritesTree()) writesTree = kTRUE;
+  }
+  fFactory->SetTreeReferences(writesTree);
+
+  if(fRandomStreams)
+  {
+    // with RandomSeed = 0 the streams change from run to run, as gRandom does
+    if(fRandomSeed) seed = fRandomSeed;
+    else if(fIsolated) seed = random_device()();
+    else seed = gRandom->Integer(kMaxUInt);
+
+    TIter itTasks(GetListOfTasks());
+    while((task = itTasks.Next()))
+    {
+      module = dynamic_cast< DelphesModule * >(task);
+      if(module) module->SetRandomStream(seed);
+    }
+  }
+
+  if(fGaussianBuffers)
+  {
+    TIter itTasks(GetListOfTasks());
+    while((task = itTasks.Next()))
+    {
+      module = dynamic_cast< DelphesModule * >(task);
+      if(module) module->UseGaussianBuffer();
+    }
+  }
+
+  if(fModuleTiming || fModuleTraceFile.Length() > 0 || fMetricsFile.Length() > 0)
+  {
+    fProfiler = new DelphesProfiler;
+    fProfiler->Init(GetListOfTasks(), InstanceFileName(fModuleTimingFile), InstanceFileName(fModuleTraceFile));
+  }
+
+  if(fMetricsFile.Length() > 0)
+  {
+    fMetrics = new DelphesMetrics(InstanceFileName(fMetricsFile),
+      GetConfReader()->GetString("::MetricsFormat", "json"),
+      GetConfReader()->GetDouble("::MetricsInterval", 10.0),
+      GetConfReader()->GetDouble("::MetricsWindow", 60.0));
+    fMetrics->SetProfiler(fProfiler);
+    fMetrics->SetTreeWriter(dynamic_cast< ExRootTreeWriter * >(GetFolder()->FindObject("TreeWriter")));
+  }
+
+  // the array dependencies are known once all the modules are initialized
+  if(fModuleThreads > 1)
+  {
+    fScheduler = new DelphesModuleScheduler(fModuleThreads);
+    fScheduler->Init(GetListOfTasks(), fFactory);
+    fScheduler->SetProfiler(fProfiler);
+  }
+
+  // the variants import the arrays of the modules initialized above
+  if(fSweep) fSweep->Init(GetFolder(), dynamic_cast< ExRootTreeWriter * >(GetFolder()->FindObject("TreeWriter")));
+}
+
+//------------------------------------------------------------------------------
+
+void Delphes::ProcessTask()
+{
+  DelphesModule *module;
+  TObject *task;
+  vector< const TObjArray * >::const_iterator itArrays;
+  Long64_t event = fEventCounter++;
+  Double_t memory;
+  stringstream message;
+
+  if(fRandomStreams) ResetRandomStreams(fEventNumber >= 0 ? fEventNumber : event);
+  fEventNumber = -1;
+
+  if(fScheduler)
+  {
+    fScheduler->Process();
+  }
+  else
+  {
+    // stop at the first module that rejects the event
+    TIter itTasks(GetListOfTasks());
+    while((task = itTasks.Next()) && !fFactory->IsEventRejected())
+    {
+      module = dynamic_cast< DelphesModule * >(task);
+      if(!module || !module->IsActive()) continue;
+      if(fProfiler) fProfiler->Process(module);
+      else module->Process();
+
+      // the kinematics of the arrays it changed in place are out of date
+      for(itArrays = module->GetUpdatedArrays().begin(); itArrays != module->GetUpdatedArrays().end(); ++itArrays)
+      {
+        fFactory->InvalidateKinematics(*itArrays);
+      }
+    }
+  }
+
+  if(fSweep && !fFactory->IsEventRejected()) fSweep->Process(event);
+
+  if(fProfiler) fProfiler->EndEvent(event);
+  if(fMetrics) fMetrics->Update(fEventCounter);
+
+  // stop the job with an error rather than have the batch system kill it
+  if(fMemoryBudget > 0.0)
+  {
+    memory = DelphesProfiler::GetResidentMemory()/1048576.0;
+    if(memory > fMemoryBudget)
+    {
+      message << "resident memory of " << memory << " MB exceeds the MemoryBudget of ";
+      message << fMemoryBudget << " MB after event " << event;
+      throw runtime_error(message.str());
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void Delphes::FinishTask()
+{
+  DelphesModule::FinishTask();
+
+  if(fSweep) fSweep->Finish();
+
+  if(fProfiler && fModuleTiming) fProfiler->Print(cout);
+  if(fMetrics) fMetrics->Finish();
+}
+
+//------------------------------------------------------------------------------
+
+TString Delphes::InstanceFileName(const TString &fileName) const
+{
+  TString result = fileName;
+  Ssiz_t dot;
+
+  // every Delphes instance of a DelphesWorkerPool writes its own file
+  if(result.Length() > 0 && strcmp(GetName(), "Delphes") != 0)
+  {
+    dot = result.Last('.');
+    if(dot < 0) dot = result.Length();
+    result.Insert(dot, TString("_") + GetName());
+  }
+
+  return result;
+}
+
+//------------------------------------------------------------------------------
+
+void Delphes::ResetRandomStreams(Long64_t event)
+{
+  DelphesModule *module;
+  TObject *task;
+
+  TIter itTasks(GetListOfTasks());
+  while((task = itTasks.Next()))
+  {
+    module = dynamic_cast< DelphesModule * >(task);
+    if(module) module->ResetRandomStream(event);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+Bool_t Delphes::IsArrayImported(const TObjArray *array) const
+{
+  DelphesModule *module;
+  TObject *task;
+
+  if(fSweep && fSweep->IsArrayImported(array)) return kTRUE;
+
+  TIter itTasks(GetListOfTasks());
+  while((task = itTasks.Next()))
+  {
+    module = dynamic_cast< DelphesModule * >(task);
+    if(!module) continue;
+
+    const vector< const TObjArray * > &imported = module->GetImportedArrays();
+    if(find(imported.begin(), imported.end(), array) != imported.end()) return kTRUE;
+  }
+
+  return kFALSE;
+}
+
+//------------------------------------------------------------------------------
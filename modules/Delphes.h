@@ -30,34 +30,110 @@
 
 #include "classes/DelphesModule.h"
 
+#include "TString.h"
+
 class TFolder;
 class TObjArray;
 
 class ExRootTreeWriter;
 
 class DelphesFactory;
+class DelphesModuleScheduler;
+class DelphesProfiler;
+class DelphesMetrics;
+class DelphesSweep;
 
 class Delphes: public DelphesModule
 {
 public:
 
-  Delphes(const char *name = "Delphes");
+  // an isolated instance is not added to the browsables of gROOT, leaves
+  // gRandom alone, numbers its candidates itself and gives every module its
+  // own random stream, so that several can run in one process, see
+  // DelphesSession
+  Delphes(const char *name = "Delphes", Bool_t isolated = kFALSE);
   ~Delphes();
 
   void SetTreeWriter(ExRootTreeWriter *treeWriter);
   
   DelphesFactory *GetFactory() const { return fFactory; }
 
+  Bool_t IsIsolated() const { return fIsolated; }
+
   void Clear();
 
   virtual void Init();
   virtual void Process();
   virtual void Finish();
 
+  virtual void InitTask();
+  virtual void ProcessTask();
+  virtual void FinishTask();
+
+  // true when every module has its own random stream, reseeded for every
+  // event, and when the modules use buffered gaussian deviates, call after
+  // Init
+  Bool_t HasRandomStreams() const { return fRandomStreams; }
+  Bool_t HasGaussianBuffers() const { return fGaussianBuffers; }
+
+  // reseeds the random streams of the modules for the event with the given
+  // number, ProcessTask does it with the number of events processed so far
+  void ResetRandomStreams(Long64_t event);
+
+  // number of events processed so far, set when a job resumes after a
+  // checkpoint so that the random streams go on with the same numbers
+  Long64_t GetEventCounter() const { return fEventCounter; }
+  void SetEventCounter(Long64_t counter) { fEventCounter = counter; }
+
+  // position of the next event in the input, counted from 0, which the
+  // random streams are then reseeded with instead of the event counter,
+  // so that runs skipping events or processing one shard draw the same
+  // numbers for an event as the run over the whole input
+  void SetEventNumber(Long64_t number) { fEventNumber = number; }
+
+  // null unless ModuleTiming or ModuleTraceFile is set
+  DelphesProfiler *GetProfiler() const { return fProfiler; }
+
+  // null unless MetricsFile is set
+  DelphesMetrics *GetMetrics() const { return fMetrics; }
+
+  // true when a module has dropped the current event, which must then not
+  // be written to the output tree
+  Bool_t IsEventRejected() const;
+
+  // true when one of the modules, or of the variants of a sweep, imports
+  // the array, call after InitTask
+  Bool_t IsArrayImported(const TObjArray *array) const;
+
 private:
 
+  // file name with the name of the instance appended for the workers
+  TString InstanceFileName(const TString &fileName) const;
+
   DelphesFactory *fFactory;
 
+  Bool_t fIsolated;
+
+  Int_t fModuleThreads;
+  UInt_t fRandomSeed;
+  Bool_t fRandomStreams;
+  Bool_t fGaussianBuffers;
+  Long64_t fEventCounter;
+  Long64_t fEventNumber;
+  DelphesModuleScheduler *fScheduler; //!
+
+  Bool_t fModuleTiming;
+  TString fModuleTimingFile;
+  TString fModuleTraceFile;
+  DelphesProfiler *fProfiler; //!
+
+  Double_t fMemoryBudget;
+
+  TString fMetricsFile;
+  DelphesMetrics *fMetrics; //!
+
+  DelphesSweep *fSweep; //!
+
   ClassDef(Delphes, 1)
 };
 
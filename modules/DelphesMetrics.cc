@@ -0,0 +1,246 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/** \class DelphesMetrics
+ *
+ *  Writes the progress of a job to a JSON or Prometheus file every few
+ *  seconds.
+ *
+ */
+
+#include "modules/DelphesMetrics.h"
+#include "modules/DelphesProfiler.h"
+
+#include "ExRootAnalysis/ExRootTreeWriter.h"
+
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+#include <stdio.h>
+#include <unistd.h>
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+
+static void WriteString(ostream &out, const string &text)
+{
+  string::const_iterator it;
+
+  out << '"';
+  for(it = text.begin(); it != text.end(); ++it)
+  {
+    if(*it == '"' || *it == '\\') out << '\\';
+    out << *it;
+  }
+  out << '"';
+}
+
+//------------------------------------------------------------------------------
+
+DelphesMetrics::DelphesMetrics(const char *fileName, const char *format, Double_t interval, Double_t window) :
+  fFileName(fileName), fPrometheus(kFALSE), fInterval(interval), fWindow(window),
+  fProfiler(0), fTreeWriter(0), fEvents(0)
+{
+  stringstream message;
+  string name(format);
+
+  if(name == "prometheus")
+  {
+    fPrometheus = kTRUE;
+  }
+  else if(name != "json")
+  {
+    message << "unknown MetricsFormat '" << format << "', use json or prometheus";
+    throw runtime_error(message.str());
+  }
+
+  if(fInterval <= 0.0 || fWindow <= 0.0)
+  {
+    throw runtime_error("MetricsInterval and MetricsWindow must be positive");
+  }
+
+  // the JSON lines are appended, a new job starts a new file
+  if(!fPrometheus)
+  {
+    ofstream file(fFileName.c_str());
+    if(!file)
+    {
+      message << "can't open metrics file '" << fFileName << "'";
+      throw runtime_error(message.str());
+    }
+  }
+
+  fStart = fLast = Clock::now();
+  fSamples.push_back(make_pair(fStart, Long64_t(0)));
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesMetrics::AddGauge(const char *name, Gauge gauge)
+{
+  fGauges.push_back(make_pair(string(name), gauge));
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesMetrics::Update(Long64_t events)
+{
+  Clock::time_point now = Clock::now();
+
+  fEvents = events;
+  if(chrono::duration< Double_t >(now - fLast).count() < fInterval) return;
+
+  fLast = now;
+  Write();
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesMetrics::Finish()
+{
+  fLast = Clock::now();
+  Write();
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesMetrics::Write()
+{
+  Double_t sum, time;
+  Int_t i, n;
+
+  fSamples.push_back(make_pair(fLast, fEvents));
+  while(fSamples.size() > 2 && chrono::duration< Double_t >(fLast - fSamples[1].first).count() >= fWindow)
+  {
+    fSamples.pop_front();
+  }
+
+  fModuleShares.clear();
+  if(fProfiler)
+  {
+    n = fProfiler->GetNumberOfModules();
+    fModuleTimes.resize(n, 0.0);
+
+    sum = 0.0;
+    for(i = 0; i < n; ++i)
+    {
+      time = fProfiler->GetModuleTime(i);
+      fModuleShares.push_back(make_pair(string(fProfiler->GetModuleName(i)), time - fModuleTimes[i]));
+      fModuleTimes[i] = time;
+      sum += fModuleShares.back().second;
+    }
+    for(i = 0; i < n; ++i)
+    {
+      fModuleShares[i].second = sum > 0.0 ? fModuleShares[i].second/sum : 0.0;
+    }
+  }
+
+  if(fPrometheus)
+  {
+    // the collector must never see a half written file
+    stringstream temporary;
+    temporary << fFileName << '.' << getpid();
+    WritePrometheus(temporary.str());
+    if(rename(temporary.str().c_str(), fFileName.c_str()) != 0) remove(temporary.str().c_str());
+  }
+  else
+  {
+    WriteJSON(fFileName);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesMetrics::WriteJSON(const string &fileName)
+{
+  ofstream file(fileName.c_str(), ios::app);
+  vector< pair< string, Gauge > >::const_iterator itGauges;
+  vector< pair< string, Double_t > >::const_iterator itShares;
+  Double_t window = chrono::duration< Double_t >(fLast - fSamples.front().first).count();
+  Double_t total = chrono::duration< Double_t >(fLast - fStart).count();
+
+  file << fixed << setprecision(3);
+  file << "{\"time\":" << time(0);
+  file << ",\"events\":" << fEvents;
+  file << ",\"events_per_second\":" << (window > 0.0 ? (fEvents - fSamples.front().second)/window : 0.0);
+  file << ",\"events_per_second_total\":" << (total > 0.0 ? fEvents/total : 0.0);
+  file << ",\"output_bytes\":" << (fTreeWriter ? fTreeWriter->GetBytesWritten() : 0);
+
+  file << ",\"modules\":{";
+  for(itShares = fModuleShares.begin(); itShares != fModuleShares.end(); ++itShares)
+  {
+    if(itShares != fModuleShares.begin()) file << ',';
+    WriteString(file, itShares->first);
+    file << ':' << itShares->second;
+  }
+  file << '}';
+
+  file << ",\"gauges\":{";
+  for(itGauges = fGauges.begin(); itGauges != fGauges.end(); ++itGauges)
+  {
+    if(itGauges != fGauges.begin()) file << ',';
+    WriteString(file, itGauges->first);
+    file << ':' << itGauges->second();
+  }
+  file << "}}" << endl;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesMetrics::WritePrometheus(const string &fileName)
+{
+  ofstream file(fileName.c_str());
+  vector< pair< string, Gauge > >::const_iterator itGauges;
+  vector< pair< string, Double_t > >::const_iterator itShares;
+  Double_t window = chrono::duration< Double_t >(fLast - fSamples.front().first).count();
+  Double_t total = chrono::duration< Double_t >(fLast - fStart).count();
+
+  file << fixed << setprecision(3);
+
+  file << "# TYPE delphes_events_total counter\n";
+  file << "delphes_events_total " << fEvents << '\n';
+  file << "# TYPE delphes_events_per_second gauge\n";
+  file << "delphes_events_per_second " << (window > 0.0 ? (fEvents - fSamples.front().second)/window : 0.0) << '\n';
+  file << "# TYPE delphes_events_per_second_total gauge\n";
+  file << "delphes_events_per_second_total " << (total > 0.0 ? fEvents/total : 0.0) << '\n';
+  file << "# TYPE delphes_output_bytes_total counter\n";
+  file << "delphes_output_bytes_total " << (fTreeWriter ? fTreeWriter->GetBytesWritten() : 0) << '\n';
+
+  if(!fModuleShares.empty()) file << "# TYPE delphes_module_time_share gauge\n";
+  for(itShares = fModuleShares.begin(); itShares != fModuleShares.end(); ++itShares)
+  {
+    file << "delphes_module_time_share{module=";
+    WriteString(file, itShares->first);
+    file << "} " << itShares->second << '\n';
+  }
+
+  if(!fGauges.empty()) file << "# TYPE delphes_gauge gauge\n";
+  for(itGauges = fGauges.begin(); itGauges != fGauges.end(); ++itGauges)
+  {
+    file << "delphes_gauge{name=";
+    WriteString(file, itGauges->first);
+    file << "} " << itGauges->second() << '\n';
+  }
+}
+
+//------------------------------------------------------------------------------
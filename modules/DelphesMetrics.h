@@ -0,0 +1,105 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DelphesMetrics_h
+#define DelphesMetrics_h
+
+/** \class DelphesMetrics
+ *
+ *  Writes the progress of a job to a file every few seconds, for job
+ *  monitors on batch nodes where the progress bar is lost.
+ *
+ *  In the JSON format one line is appended per interval, in the
+ *  Prometheus format the file is replaced every time with the current
+ *  values, as the node exporter textfile collector expects. Both give
+ *  the number of events processed, the events per second over a sliding
+ *  window and since the start, the bytes written to the output tree, the
+ *  share of the module time taken by every module during the last
+ *  interval, when there is a profiler, and the values of the gauges
+ *  added by the reader, such as the depth of its read-ahead queue.
+ *
+ */
+
+#if !defined(__CINT__) && !defined(__CLING__)
+
+#include "Rtypes.h"
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+class ExRootTreeWriter;
+
+class DelphesProfiler;
+
+class DelphesMetrics
+{
+public:
+
+  typedef std::function< Long64_t() > Gauge;
+
+  // format is json or prometheus, interval and window in seconds
+  DelphesMetrics(const char *fileName, const char *format, Double_t interval, Double_t window);
+
+  void SetProfiler(const DelphesProfiler *profiler) { fProfiler = profiler; }
+  void SetTreeWriter(const ExRootTreeWriter *treeWriter) { fTreeWriter = treeWriter; }
+
+  // value read every time the metrics are written, on the thread that
+  // processes the events
+  void AddGauge(const char *name, Gauge gauge);
+
+  // called after every event, writes the metrics once the interval is over
+  void Update(Long64_t events);
+
+  // writes the final values
+  void Finish();
+
+private:
+
+  typedef std::chrono::steady_clock Clock;
+
+  void Write();
+  void WriteJSON(const std::string &fileName);
+  void WritePrometheus(const std::string &fileName);
+
+  std::string fFileName;
+  Bool_t fPrometheus;
+  Double_t fInterval, fWindow;
+
+  const DelphesProfiler *fProfiler;
+  const ExRootTreeWriter *fTreeWriter;
+
+  std::vector< std::pair< std::string, Gauge > > fGauges;
+
+  Long64_t fEvents;
+  Clock::time_point fStart, fLast;
+
+  // events processed at the times the metrics were written
+  std::deque< std::pair< Clock::time_point, Long64_t > > fSamples;
+
+  // module times at the last write and their differences since
+  std::vector< Double_t > fModuleTimes;
+  std::vector< std::pair< std::string, Double_t > > fModuleShares;
+};
+
+#endif
+
+#endif /* DelphesMetrics_h */
@@ -0,0 +1,251 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/** \class DelphesModuleScheduler
+ *
+ *  Runs the independent modules of one event at the same time.
+ *
+ */
+
+#include "modules/DelphesModuleScheduler.h"
+
+#include "classes/DelphesModule.h"
+#include "classes/DelphesFactory.h"
+
+#include "modules/DelphesProfiler.h"
+
+#include "TList.h"
+#include "TObjArray.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+
+static Bool_t Intersects(const vector< const TObjArray * > &first, const vector< const TObjArray * > &second)
+{
+  vector< const TObjArray * >::const_iterator itFirst;
+  for(itFirst = first.begin(); itFirst != first.end(); ++itFirst)
+  {
+    if(find(second.begin(), second.end(), *itFirst) != second.end()) return kTRUE;
+  }
+  return kFALSE;
+}
+
+//------------------------------------------------------------------------------
+
+DelphesModuleScheduler::DelphesModuleScheduler(Int_t nThreads) :
+  fProfiler(0), fFactory(0), fNThreads(nThreads), fRemaining(0), fRunning(0), fStop(kFALSE)
+{
+  if(fNThreads < 1)
+  {
+    throw runtime_error("ModuleThreads must be positive");
+  }
+}
+
+//------------------------------------------------------------------------------
+
+DelphesModuleScheduler::~DelphesModuleScheduler()
+{
+  vector< thread >::iterator itThreads;
+
+  {
+    lock_guard< mutex > lock(fMutex);
+    fStop = kTRUE;
+  }
+  fCondition.notify_all();
+
+  for(itThreads = fThreads.begin(); itThreads != fThreads.end(); ++itThreads)
+  {
+    if(itThreads->joinable()) itThreads->join();
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesModuleScheduler::Init(TList *tasks, DelphesFactory *factory)
+{
+  stringstream message;
+  DelphesModule *module;
+  TObject *task;
+  Node node;
+  Int_t i, j;
+
+  TIter itTasks(tasks);
+  while((task = itTasks.Next()))
+  {
+    module = dynamic_cast< DelphesModule * >(task);
+    if(!module)
+    {
+      message << "task '" << task->GetName() << "' is not a Delphes module";
+      throw runtime_error(message.str());
+    }
+
+    node.module = module;
+    node.dependencies = 0;
+    node.pending = 0;
+    fNodes.push_back(node);
+  }
+
+  for(j = 0; j < Int_t(fNodes.size()); ++j)
+  {
+    for(i = 0; i < j; ++i)
+    {
+      if(!DependsOn(fNodes[j], fNodes[i])) continue;
+      fNodes[i].dependents.push_back(j);
+      ++fNodes[j].dependencies;
+    }
+  }
+
+  fFactory = factory;
+  fFactory->SetThreadSafe(kTRUE);
+
+  // the calling thread runs modules too
+  for(i = 1; i < fNThreads; ++i)
+  {
+    fThreads.push_back(thread(&DelphesModuleScheduler::Work, this));
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesModuleScheduler::Process()
+{
+  vector< Node >::iterator itNodes;
+  Int_t index;
+
+  unique_lock< mutex > lock(fMutex);
+
+  fRemaining = fNodes.size();
+  for(itNodes = fNodes.begin(); itNodes != fNodes.end(); ++itNodes)
+  {
+    itNodes->pending = itNodes->dependencies;
+    if(itNodes->pending == 0) fReady.push_back(itNodes - fNodes.begin());
+  }
+  fCondition.notify_all();
+
+  while(true)
+  {
+    fCondition.wait(lock, [this] { return fRemaining == 0 || !fReady.empty() || !fError.empty(); });
+
+    if(!fError.empty())
+    {
+      fCondition.wait(lock, [this] { return fRunning == 0; });
+      fReady.clear();
+      throw runtime_error(fError);
+    }
+
+    if(fRemaining == 0) break;
+
+    index = fReady.front();
+    fReady.pop_front();
+    ++fRunning;
+    Run(index, lock);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+Bool_t DelphesModuleScheduler::DependsOn(const Node &later, const Node &earlier) const
+{
+  if(!earlier.module->IsThreadSafe() || !later.module->IsThreadSafe()) return kTRUE;
+
+  if(earlier.module->CanRejectEvent()) return kTRUE;
+
+  // input produced by the earlier module
+  if(Intersects(later.module->GetImportedArrays(), earlier.module->GetExportedArrays())) return kTRUE;
+
+  // candidates modified by one of the two modules and read by the other one
+  if(Intersects(later.module->GetImportedArrays(), earlier.module->GetUpdatedArrays())) return kTRUE;
+  if(Intersects(later.module->GetUpdatedArrays(), earlier.module->GetImportedArrays())) return kTRUE;
+
+  return kFALSE;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesModuleScheduler::Work()
+{
+  Int_t index;
+
+  unique_lock< mutex > lock(fMutex);
+
+  while(true)
+  {
+    fCondition.wait(lock, [this] { return fStop || (!fReady.empty() && fError.empty()); });
+    if(fStop) return;
+
+    index = fReady.front();
+    fReady.pop_front();
+    ++fRunning;
+    Run(index, lock);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesModuleScheduler::Run(Int_t index, unique_lock< mutex > &lock)
+{
+  Node &node = fNodes[index];
+  vector< Int_t >::iterator itDependents;
+  vector< const TObjArray * >::const_iterator itArrays;
+  Bool_t rejected = fFactory->IsEventRejected();
+
+  // the lock is held on entry and on return, but not while the module runs,
+  // the modules of a rejected event are only marked as done
+  lock.unlock();
+  try
+  {
+    if(node.module->IsActive() && !rejected)
+    {
+      if(fProfiler) fProfiler->Process(node.module);
+      else node.module->Process();
+
+      // the kinematics of the arrays it changed in place are out of date,
+      // the modules reading them have to wait for this one
+      for(itArrays = node.module->GetUpdatedArrays().begin(); itArrays != node.module->GetUpdatedArrays().end(); ++itArrays)
+      {
+        fFactory->InvalidateKinematics(*itArrays);
+      }
+    }
+  }
+  catch(runtime_error &e)
+  {
+    lock.lock();
+    if(fError.empty()) fError = e.what();
+    --fRunning;
+    fCondition.notify_all();
+    return;
+  }
+  lock.lock();
+
+  --fRunning;
+  --fRemaining;
+  for(itDependents = node.dependents.begin(); itDependents != node.dependents.end(); ++itDependents)
+  {
+    if(--fNodes[*itDependents].pending == 0) fReady.push_back(*itDependents);
+  }
+  fCondition.notify_all();
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,106 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DelphesModuleScheduler_h
+#define DelphesModuleScheduler_h
+
+/** \class DelphesModuleScheduler
+ *
+ *  Runs the independent modules of one event at the same time.
+ *
+ *  A module waits for the modules before it in ExecutionPath that export
+ *  one of its input arrays, and for the ones sharing an array that one of
+ *  the two modifies (see DelphesModule::UpdateArray). Modules that do not
+ *  return true from DelphesModule::IsThreadSafe wait for all the previous
+ *  modules and hold back all the following ones. The modules that can
+ *  reject the event (see DelphesModule::CanRejectEvent) hold back all the
+ *  following ones too, and once the event is rejected no module starts.
+ *
+ *  Every module draws from its own random number stream, see
+ *  DelphesModule::ResetRandomStream, so that the results do not depend on
+ *  the order in which the modules happen to run.
+ *
+ */
+
+#if !defined(__CINT__) && !defined(__CLING__)
+
+#include "Rtypes.h"
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+class TList;
+
+class DelphesModule;
+class DelphesFactory;
+class DelphesProfiler;
+
+class DelphesModuleScheduler
+{
+public:
+
+  DelphesModuleScheduler(Int_t nThreads);
+  ~DelphesModuleScheduler();
+
+  // modules in ExecutionPath order, called after their Init
+  void Init(TList *tasks, DelphesFactory *factory);
+
+  // runs all the modules once, throws if one of them has failed
+  void Process();
+
+  // measure the modules, can be null
+  void SetProfiler(DelphesProfiler *profiler) { fProfiler = profiler; }
+
+private:
+
+  struct Node
+  {
+    DelphesModule *module;
+    std::vector< Int_t > dependents;
+    Int_t dependencies;
+    Int_t pending;
+  };
+
+  Bool_t DependsOn(const Node &later, const Node &earlier) const;
+
+  void Work();
+  void Run(Int_t index, std::unique_lock< std::mutex > &lock);
+
+  DelphesProfiler *fProfiler;
+  DelphesFactory *fFactory;
+
+  std::vector< Node > fNodes;
+  std::vector< std::thread > fThreads;
+  Int_t fNThreads;
+
+  std::mutex fMutex;
+  std::condition_variable fCondition;
+
+  std::deque< Int_t > fReady;
+  Int_t fRemaining, fRunning;
+  Bool_t fStop;
+  std::string fError;
+};
+
+#endif
+
+#endif /* DelphesModuleScheduler_h */
@@ -0,0 +1,539 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/** \class DelphesProfiler
+ *
+ *  Measures the wall time, the CPU time, the number of objects taken
+ *  from DelphesFactory and the memory for every module and event, and
+ *  writes the trace of every event.
+ *
+ */
+
+#include "modules/DelphesProfiler.h"
+
+#include "classes/DelphesModule.h"
+#include "classes/DelphesFactory.h"
+
+#include "TList.h"
+#include "TMath.h"
+#include "TObjArray.h"
+
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <stdexcept>
+#include <iostream>
+#include <sstream>
+
+#include <new>
+#include <cstdlib>
+
+#include <time.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+using namespace std;
+
+static const Int_t kBinsPerOctave = 8;
+static const Int_t kNumberOfBins = 64*kBinsPerOctave;
+
+// lower edge of the first bin, the times are measured in seconds
+static const Double_t kFirstEdge = 1.0E-9;
+
+static const Double_t kMegaByte = 1048576.0;
+
+//------------------------------------------------------------------------------
+
+#ifdef DELPHES_COUNT_ALLOCATIONS
+
+static thread_local ULong64_t gHeapAllocations = 0;
+
+void *operator new(size_t size)
+{
+  void *pointer;
+
+  ++gHeapAllocations;
+  pointer = malloc(size ? size : 1);
+  if(!pointer) throw bad_alloc();
+  return pointer;
+}
+
+void *operator new[](size_t size)
+{
+  return operator new(size);
+}
+
+void operator delete(void *pointer) noexcept
+{
+  free(pointer);
+}
+
+void operator delete[](void *pointer) noexcept
+{
+  free(pointer);
+}
+
+static const Bool_t kCountHeap = kTRUE;
+
+static ULong64_t HeapAllocations()
+{
+  return gHeapAllocations;
+}
+
+#else
+
+static const Bool_t kCountHeap = kFALSE;
+
+static ULong64_t HeapAllocations()
+{
+  return 0;
+}
+
+#endif
+
+//------------------------------------------------------------------------------
+
+static Double_t ThreadTime()
+{
+  timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec + 1.0E-9*ts.tv_nsec;
+}
+
+//------------------------------------------------------------------------------
+
+Long64_t DelphesProfiler::GetResidentMemory()
+{
+#if defined(__linux__)
+  // the file is kept open, reading it again gives the current values
+  static const int file = open("/proc/self/statm", O_RDONLY);
+  static const long pageSize = sysconf(_SC_PAGESIZE);
+  char buffer[128];
+  long long size = 0, resident = 0;
+  ssize_t length;
+
+  if(file < 0) return 0;
+  length = pread(file, buffer, sizeof(buffer) - 1, 0);
+  if(length <= 0) return 0;
+  buffer[length] = '\0';
+  if(sscanf(buffer, "%lld %lld", &size, &resident) != 2) return 0;
+  return resident*pageSize;
+#else
+  return 0;
+#endif
+}
+
+//------------------------------------------------------------------------------
+
+Long64_t DelphesProfiler::GetHeapMemory()
+{
+#if defined(__GLIBC__)
+#if __GLIBC_PREREQ(2, 33)
+  struct mallinfo2 info = mallinfo2();
+  return Long64_t(info.uordblks) + Long64_t(info.hblkhd);
+#else
+  // the int fields wrap above 4 GB
+  struct mallinfo info = mallinfo();
+  return Long64_t(UInt_t(info.uordblks)) + Long64_t(UInt_t(info.hblkhd));
+#endif
+#else
+  return 0;
+#endif
+}
+
+//------------------------------------------------------------------------------
+
+// small numbers for the threads in the trace, 0 is kept for the events
+
+static atomic< Int_t > gNextThread(1);
+static thread_local Int_t gThread = 0;
+
+static Int_t ThreadNumber()
+{
+  if(gThread == 0) gThread = gNextThread++;
+  return gThread;
+}
+
+//------------------------------------------------------------------------------
+
+static void WriteString(ostream &out, const char *text)
+{
+  out << '"';
+  for(; *text; ++text)
+  {
+    if(*text == '"' || *text == '\\') out << '\\';
+    out << *text;
+  }
+  out << '"';
+}
+
+//------------------------------------------------------------------------------
+
+DelphesProfiler::Distribution::Distribution() :
+  sum(0.0), max(0.0), bins(kNumberOfBins, 0)
+{
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesProfiler::Distribution::Fill(Double_t value)
+{
+  Int_t bin = 0;
+
+  sum += value;
+  if(value > max) max = value;
+
+  if(value > kFirstEdge) bin = Int_t(kBinsPerOctave*TMath::Log2(value/kFirstEdge));
+  if(bin >= kNumberOfBins) bin = kNumberOfBins - 1;
+
+  ++bins[bin];
+}
+
+//------------------------------------------------------------------------------
+
+Double_t DelphesProfiler::Distribution::Mean(ULong64_t count) const
+{
+  return count > 0 ? sum/count : 0.0;
+}
+
+//------------------------------------------------------------------------------
+
+Double_t DelphesProfiler::Distribution::Quantile(ULong64_t count, Double_t fraction) const
+{
+  ULong64_t total = 0;
+  Int_t bin;
+
+  if(count == 0) return 0.0;
+
+  for(bin = 0; bin < kNumberOfBins; ++bin)
+  {
+    total += bins[bin];
+    if(total >= fraction*count) break;
+  }
+
+  // centre of the bin, but never above the largest value seen
+  return TMath::Min(max, kFirstEdge*TMath::Power(2.0, (bin + 0.5)/kBinsPerOctave));
+}
+
+//------------------------------------------------------------------------------
+
+DelphesProfiler::DelphesProfiler() :
+  fNumberOfEvents(0), fTraceEmpty(kTRUE)
+{
+}
+
+//------------------------------------------------------------------------------
+
+DelphesProfiler::~DelphesProfiler()
+{
+  if(fTraceFile.is_open()) fTraceFile << "\n]\n";
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesProfiler::Init(TList *tasks, const char *fileName, const char *traceFileName)
+{
+  stringstream message;
+  DelphesModule *module;
+  TObject *task;
+  Entry entry;
+
+  entry.count = 0;
+  entry.done = kFALSE;
+  entry.wall = 0.0;
+  entry.cpu = 0.0;
+  entry.allocations = 0;
+  entry.heap = 0;
+  entry.start = 0.0;
+  entry.thread = 0;
+  entry.resident = 0;
+  entry.heapGrowth = 0;
+  entry.residentMax = 0;
+  entry.heapGrowthMax = 0;
+
+  TIter itTasks(tasks);
+  while((task = itTasks.Next()))
+  {
+    module = dynamic_cast< DelphesModule * >(task);
+    if(!module) continue;
+
+    entry.module = module;
+    entry.init = module->GetInitTime();
+    fIndices[module] = fEntries.size();
+    fEntries.push_back(entry);
+  }
+
+  if(fileName && fileName[0] != '\0')
+  {
+    fFile.open(fileName);
+    if(!fFile)
+    {
+      message << "can't open timing file '" << fileName << "'";
+      throw runtime_error(message.str());
+    }
+    fFile << "event,module,wall,cpu,allocations";
+    if(kCountHeap) fFile << ",heap";
+    fFile << ",resident,heapgrowth" << endl;
+  }
+
+  if(traceFileName && traceFileName[0] != '\0')
+  {
+    fTraceFile.open(traceFileName);
+    if(!fTraceFile)
+    {
+      message << "can't open trace file '" << traceFileName << "'";
+      throw runtime_error(message.str());
+    }
+    fTraceFile << fixed << setprecision(3) << "[";
+
+    for(vector< Entry >::iterator itEntries = fEntries.begin(); itEntries != fEntries.end(); ++itEntries)
+    {
+      itEntries->module->SetAnnotations(kTRUE);
+    }
+  }
+
+  fOrigin = chrono::steady_clock::now();
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesProfiler::Process(DelphesModule *module)
+{
+  map< const DelphesModule *, Int_t >::const_iterator itIndices;
+  chrono::steady_clock::time_point start;
+  Double_t cpu;
+  ULong64_t allocations, heap;
+  Long64_t heapMemory;
+
+  itIndices = fIndices.find(module);
+  if(itIndices == fIndices.end())
+  {
+    module->Process();
+    return;
+  }
+
+  // each entry is only touched by the thread running its module
+  Entry &entry = fEntries[itIndices->second];
+
+  if(fTraceFile.is_open())
+  {
+    const vector< const TObjArray * > &imported = module->GetImportedArrays();
+    vector< const TObjArray * >::const_iterator itImported;
+
+    entry.inputs.clear();
+    for(itImported = imported.begin(); itImported != imported.end(); ++itImported)
+    {
+      entry.inputs.push_back((*itImported)->GetEntriesFast());
+    }
+    entry.thread = ThreadNumber();
+    module->ClearAnnotations();
+  }
+
+  heapMemory = GetHeapMemory();
+  allocations = DelphesFactory::GetThreadAllocations();
+  heap = HeapAllocations();
+  cpu = ThreadTime();
+  start = chrono::steady_clock::now();
+
+  module->Process();
+
+  entry.wall = chrono::duration< Double_t >(chrono::steady_clock::now() - start).count();
+  entry.cpu = ThreadTime() - cpu;
+  entry.allocations = DelphesFactory::GetThreadAllocations() - allocations;
+  entry.heap = HeapAllocations() - heap;
+  entry.done = kTRUE;
+
+  // the memory is that of the whole process, with ModuleThreads the
+  // modules running at the same time see each other's allocations
+  entry.resident = GetResidentMemory();
+  entry.heapGrowth = GetHeapMemory() - heapMemory;
+  if(entry.resident > entry.residentMax) entry.residentMax = entry.resident;
+  if(entry.heapGrowth > entry.heapGrowthMax) entry.heapGrowthMax = entry.heapGrowth;
+
+  if(fTraceFile.is_open())
+  {
+    entry.start = chrono::duration< Double_t >(start - fOrigin).count();
+    entry.annotations = module->GetAnnotations();
+  }
+
+  ++entry.count;
+  entry.wallTime.Fill(entry.wall);
+  entry.cpuTime.Fill(entry.cpu);
+  entry.allocationCount.Fill(entry.allocations);
+  entry.heapCount.Fill(entry.heap);
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesProfiler::EndEvent(Long64_t event)
+{
+  vector< Entry >::iterator itEntries;
+
+  if(fTraceFile.is_open()) WriteTrace(event);
+
+  for(itEntries = fEntries.begin(); itEntries != fEntries.end(); ++itEntries)
+  {
+    if(!itEntries->done) continue;
+    itEntries->done = kFALSE;
+
+    if(!fFile.is_open()) continue;
+    fFile << event << ',' << itEntries->module->GetName() << ',';
+    fFile << itEntries->wall << ',' << itEntries->cpu << ',' << itEntries->allocations;
+    if(kCountHeap) fFile << ',' << itEntries->heap;
+    fFile << ',' << itEntries->resident << ',' << itEntries->heapGrowth;
+    fFile << '\n';
+  }
+
+  ++fNumberOfEvents;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesProfiler::WriteTrace(Long64_t event)
+{
+  vector< Entry >::const_iterator itEntries;
+  vector< pair< const char *, Long64_t > >::const_iterator itAnnotations;
+  Double_t first = -1.0, last = 0.0;
+  size_t i;
+
+  // times in microseconds
+  for(itEntries = fEntries.begin(); itEntries != fEntries.end(); ++itEntries)
+  {
+    const Entry &entry = *itEntries;
+    if(!entry.done) continue;
+
+    if(first < 0.0 || entry.start < first) first = entry.start;
+    if(entry.start + entry.wall > last) last = entry.start + entry.wall;
+
+    fTraceFile << (fTraceEmpty ? "\n" : ",\n");
+    fTraceEmpty = kFALSE;
+
+    fTraceFile << "{\"name\":";
+    WriteString(fTraceFile, entry.module->GetName());
+    fTraceFile << ",\"cat\":\"module\",\"ph\":\"X\",\"pid\":0,\"tid\":" << entry.thread;
+    fTraceFile << ",\"ts\":" << 1.0E6*entry.start << ",\"dur\":" << 1.0E6*entry.wall;
+    fTraceFile << ",\"args\":{\"event\":" << event;
+
+    const vector< const TObjArray * > &imported = entry.module->GetImportedArrays();
+    for(i = 0; i < entry.inputs.size() && i < imported.size(); ++i)
+    {
+      fTraceFile << ',';
+      WriteString(fTraceFile, imported[i]->GetName());
+      fTraceFile << ':' << entry.inputs[i];
+    }
+    for(itAnnotations = entry.annotations.begin(); itAnnotations != entry.annotations.end(); ++itAnnotations)
+    {
+      fTraceFile << ',';
+      WriteString(fTraceFile, itAnnotations->first);
+      fTraceFile << ':' << itAnnotations->second;
+    }
+    fTraceFile << "}}";
+  }
+
+  if(first < 0.0) return;
+
+  fTraceFile << ",\n{\"name\":\"event\",\"cat\":\"event\",\"ph\":\"X\",\"pid\":0,\"tid\":0";
+  fTraceFile << ",\"ts\":" << 1.0E6*first << ",\"dur\":" << 1.0E6*(last - first);
+  fTraceFile << ",\"args\":{\"event\":" << event << "}}";
+}
+
+//------------------------------------------------------------------------------
+
+const char *DelphesProfiler::GetModuleName(Int_t i) const
+{
+  return fEntries[i].module->GetName();
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesProfiler::Print(ostream &out) const
+{
+  vector< Entry >::const_iterator itEntries;
+  ios::fmtflags flags = out.flags();
+  streamsize precision = out.precision();
+
+  out << "** Module timing over " << fNumberOfEvents << " events, times in ms, memory in MB" << endl;
+  out << "** " << left << setw(28) << "module" << right;
+  out << setw(10) << "mean" << setw(10) << "p50" << setw(10) << "p99" << setw(10) << "max";
+  out << setw(10) << "cpu" << setw(12) << "objects" << setw(10) << "init";
+  if(kCountHeap) out << setw(12) << "heap";
+  out << setw(10) << "rss max" << setw(10) << "heap max";
+  out << endl;
+
+  out << fixed << setprecision(3);
+  for(itEntries = fEntries.begin(); itEntries != fEntries.end(); ++itEntries)
+  {
+    const Entry &entry = *itEntries;
+    out << "** " << left << setw(28) << entry.module->GetName() << right;
+    out << setw(10) << 1.0E3*entry.wallTime.Mean(entry.count);
+    out << setw(10) << 1.0E3*entry.wallTime.Quantile(entry.count, 0.50);
+    out << setw(10) << 1.0E3*entry.wallTime.Quantile(entry.count, 0.99);
+    out << setw(10) << 1.0E3*entry.wallTime.max;
+    out << setw(10) << 1.0E3*entry.cpuTime.Mean(entry.count);
+    out << setw(12) << setprecision(1) << entry.allocationCount.Mean(entry.count) << setprecision(3);
+    out << setw(10) << 1.0E3*entry.init;
+    if(kCountHeap) out << setw(12) << setprecision(1) << entry.heapCount.Mean(entry.count) << setprecision(3);
+    out << setprecision(1);
+    out << setw(10) << entry.residentMax/kMegaByte;
+    out << setw(10) << entry.heapGrowthMax/kMegaByte;
+    out << setprecision(3) << endl;
+  }
+
+  out.flags(flags);
+  out.precision(precision);
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesProfiler::PrintJSON(ostream &out) const
+{
+  vector< Entry >::const_iterator itEntries;
+  ios::fmtflags flags = out.flags();
+  streamsize precision = out.precision();
+
+  out << fixed << setprecision(4) << '[';
+  for(itEntries = fEntries.begin(); itEntries != fEntries.end(); ++itEntries)
+  {
+    const Entry &entry = *itEntries;
+    if(itEntries != fEntries.begin()) out << ',';
+    out << "{\"module\":";
+    WriteString(out, entry.module->GetName());
+    out << ",\"mean\":" << 1.0E3*entry.wallTime.Mean(entry.count);
+    out << ",\"p50\":" << 1.0E3*entry.wallTime.Quantile(entry.count, 0.50);
+    out << ",\"p99\":" << 1.0E3*entry.wallTime.Quantile(entry.count, 0.99);
+    out << ",\"max\":" << 1.0E3*entry.wallTime.max;
+    out << ",\"cpu\":" << 1.0E3*entry.cpuTime.Mean(entry.count);
+    out << ",\"objects\":" << entry.allocationCount.Mean(entry.count);
+    out << ",\"init\":" << 1.0E3*entry.init;
+    out << ",\"rss\":" << entry.residentMax/kMegaByte;
+    out << ",\"heap\":" << entry.heapGrowthMax/kMegaByte;
+    out << '}';
+  }
+  out << ']';
+
+  out.flags(flags);
+  out.precision(precision);
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,150 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DelphesProfiler_h
+#define DelphesProfiler_h
+
+/** \class DelphesProfiler
+ *
+ *  Measures the wall time, the CPU time of the calling thread and the
+ *  number of objects taken from DelphesFactory for every module and event.
+ *
+ *  The distributions are kept in logarithmic bins with eight bins per
+ *  factor of two, so the medians and the 99th percentiles printed in
+ *  the summary are accurate to about 5%. The values of every event can
+ *  also be written to a CSV file. The summary also shows the time
+ *  spent in the Init of every module.
+ *
+ *  With a trace file the start and the duration of every module in every
+ *  event are written in the Chrome trace event format, which Perfetto and
+ *  chrome://tracing open, together with the sizes of the arrays imported
+ *  by the module and the values given to DelphesModule::Annotate. Every
+ *  event also gets a span from the start of its first module to the end
+ *  of its last one.
+ *
+ *  When built with DELPHES_COUNT_ALLOCATIONS the global operator new is
+ *  replaced and the heap allocations made by every module are counted
+ *  as well.
+ *
+ *  The resident memory of the process is sampled after every module and
+ *  the heap in use, from mallinfo, before and after it. The summary shows
+ *  the largest resident memory seen at the end of every module and the
+ *  largest growth of the heap during it, so the module where the memory
+ *  peaks can be told apart from the one that only holds on to it.
+ *
+ */
+
+#if !defined(__CINT__) && !defined(__CLING__)
+
+#include "Rtypes.h"
+
+#include <map>
+#include <chrono>
+#include <vector>
+#include <utility>
+#include <string>
+#include <fstream>
+#include <ostream>
+
+class TList;
+
+class DelphesModule;
+
+class DelphesProfiler
+{
+public:
+
+  DelphesProfiler();
+  ~DelphesProfiler();
+
+  // modules in ExecutionPath order, the file names can be empty
+  void Init(TList *tasks, const char *fileName, const char *traceFileName = 0);
+
+  // calls DelphesModule::Process and records the measurements, can be
+  // called from several threads for different modules
+  void Process(DelphesModule *module);
+
+  // writes the measurements of the event to the CSV and trace files
+  void EndEvent(Long64_t event);
+
+  void Print(std::ostream &out) const;
+
+  // same values as Print as a JSON array with one object per module
+  void PrintJSON(std::ostream &out) const;
+
+  // resident memory and heap in use of the process in bytes, 0 where
+  // they can't be measured
+  static Long64_t GetResidentMemory();
+  static Long64_t GetHeapMemory();
+
+  // modules in ExecutionPath order and their wall time summed over the
+  // events so far, in seconds
+  Int_t GetNumberOfModules() const { return fEntries.size(); }
+  const char *GetModuleName(Int_t i) const;
+  Double_t GetModuleTime(Int_t i) const { return fEntries[i].wallTime.sum; }
+
+private:
+
+  struct Distribution
+  {
+    Double_t sum, max;
+    std::vector< ULong64_t > bins;
+
+    Distribution();
+    void Fill(Double_t value);
+    Double_t Mean(ULong64_t count) const;
+    Double_t Quantile(ULong64_t count, Double_t fraction) const;
+  };
+
+  struct Entry
+  {
+    DelphesModule *module;
+    ULong64_t count;
+    Bool_t done;
+    Double_t init, wall, cpu;
+    ULong64_t allocations, heap;
+    Distribution wallTime, cpuTime, allocationCount, heapCount;
+
+    // memory of the last event and the largest values seen
+    Long64_t resident, heapGrowth;
+    Long64_t residentMax, heapGrowthMax;
+
+    // trace of the last event, start in seconds since Init
+    Double_t start;
+    Int_t thread;
+    std::vector< Long64_t > inputs;
+    std::vector< std::pair< const char *, Long64_t > > annotations;
+  };
+
+  void WriteTrace(Long64_t event);
+
+  std::vector< Entry > fEntries;
+  std::map< const DelphesModule *, Int_t > fIndices;
+
+  Long64_t fNumberOfEvents;
+
+  std::ofstream fFile;
+
+  std::ofstream fTraceFile;
+  Bool_t fTraceEmpty;
+  std::chrono::steady_clock::time_point fOrigin;
+};
+
+#endif
+
+#endif /* DelphesProfiler_h */
@@ -0,0 +1,294 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/** \class DelphesReaderThread
+ *
+ *  Reads the input events ahead on a second thread.
+ *
+ */
+
+#include "modules/DelphesReaderThread.h"
+
+#include "classes/DelphesClasses.h"
+#include "classes/DelphesFactory.h"
+
+#include "TROOT.h"
+#include "TString.h"
+#include "TObjArray.h"
+#include "RVersion.h"
+
+#include <stdexcept>
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+
+DelphesReaderThread::DelphesReaderThread(Int_t nSlots, Int_t nThreads) :
+  fNext(0), fStop(kFALSE)
+{
+  DelphesReaderSlot *slot;
+  Worker *worker;
+  Int_t i;
+
+  if(nSlots < 1)
+  {
+    throw runtime_error("ReadAheadEvents must be positive");
+  }
+
+  if(nThreads < 1 || nThreads > nSlots)
+  {
+    throw runtime_error("the number of reader threads must be between one and the number of slots");
+  }
+
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,6,0)
+  ROOT::EnableThreadSafety();
+#endif
+
+  for(i = 0; i < nThreads; ++i)
+  {
+    worker = new Worker;
+    worker->finished = kTRUE;
+    fWorkers.push_back(worker);
+  }
+
+  for(i = 0; i < nSlots; ++i)
+  {
+    slot = new DelphesReaderSlot;
+    slot->index = i;
+    slot->worker = i % nThreads;
+    slot->eventNumber = 0;
+
+    // numbered from one in every event, without touching TProcessID
+    slot->factory = new DelphesFactory(Form("ReaderFactory_%d", i));
+    slot->factory->SetLocalObjectCount(kTRUE);
+
+    slot->allParticleOutputArray = slot->factory->NewPermanentArray();
+    slot->stableParticleOutputArray = slot->factory->NewPermanentArray();
+    slot->partonOutputArray = slot->factory->NewPermanentArray();
+
+    fSlots.push_back(slot);
+    fWorkers[slot->worker]->freeSlots.push_back(slot);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+DelphesReaderThread::~DelphesReaderThread()
+{
+  vector< DelphesReaderSlot * >::iterator itSlots;
+  vector< Worker * >::iterator itWorkers;
+
+  Stop();
+
+  for(itSlots = fSlots.begin(); itSlots != fSlots.end(); ++itSlots)
+  {
+    delete (*itSlots)->factory;
+    delete *itSlots;
+  }
+
+  for(itWorkers = fWorkers.begin(); itWorkers != fWorkers.end(); ++itWorkers)
+  {
+    delete *itWorkers;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesReaderThread::Start(ReadFunction read)
+{
+  vector< Worker * >::iterator itWorkers;
+
+  Stop();
+
+  fRead = read;
+  fNext = 0;
+  fStop = kFALSE;
+  fError.clear();
+
+  for(itWorkers = fWorkers.begin(); itWorkers != fWorkers.end(); ++itWorkers)
+  {
+    (*itWorkers)->finished = kFALSE;
+  }
+
+  for(itWorkers = fWorkers.begin(); itWorkers != fWorkers.end(); ++itWorkers)
+  {
+    (*itWorkers)->thread = thread(&DelphesReaderThread::Work, this, *itWorkers);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+DelphesReaderSlot *DelphesReaderThread::NextSlot()
+{
+  DelphesReaderSlot *slot;
+  unique_lock< mutex > lock(fMutex);
+  Worker *worker = fWorkers[fNext];
+
+  fCondition.wait(lock, [worker] { return !worker->readySlots.empty() || worker->finished; });
+
+  if(worker->readySlots.empty())
+  {
+    if(!fError.empty()) throw runtime_error(fError);
+    return 0;
+  }
+
+  slot = worker->readySlots.front();
+  worker->readySlots.pop_front();
+  fNext = (fNext + 1) % fWorkers.size();
+  return slot;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesReaderThread::ReleaseSlot(DelphesReaderSlot *slot)
+{
+  {
+    lock_guard< mutex > lock(fMutex);
+    fWorkers[slot->worker]->freeSlots.push_back(slot);
+  }
+  fCondition.notify_all();
+}
+
+//------------------------------------------------------------------------------
+
+Int_t DelphesReaderThread::GetNumberOfReadySlots()
+{
+  vector< Worker * >::const_iterator itWorkers;
+  Int_t result = 0;
+
+  lock_guard< mutex > lock(fMutex);
+  for(itWorkers = fWorkers.begin(); itWorkers != fWorkers.end(); ++itWorkers)
+  {
+    result += (*itWorkers)->readySlots.size();
+  }
+  return result;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesReaderThread::Stop()
+{
+  vector< Worker * >::iterator itWorkers;
+  Worker *worker;
+
+  {
+    lock_guard< mutex > lock(fMutex);
+    fStop = kTRUE;
+  }
+  fCondition.notify_all();
+
+  for(itWorkers = fWorkers.begin(); itWorkers != fWorkers.end(); ++itWorkers)
+  {
+    worker = *itWorkers;
+    if(worker->thread.joinable()) worker->thread.join();
+
+    worker->finished = kTRUE;
+    while(!worker->readySlots.empty())
+    {
+      worker->freeSlots.push_back(worker->readySlots.front());
+      worker->readySlots.pop_front();
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesReaderThread::CopyParticles(const DelphesReaderSlot &slot, DelphesFactory *factory,
+  TObjArray *allParticleOutputArray,
+  TObjArray *stableParticleOutputArray,
+  TObjArray *partonOutputArray)
+{
+  Candidate *candidate, *copy;
+  UInt_t id;
+  Int_t i;
+
+  fCopies.assign(slot.allParticleOutputArray->GetEntriesFast() + 1, 0);
+
+  for(i = 0; i < slot.allParticleOutputArray->GetEntriesFast(); ++i)
+  {
+    candidate = static_cast< Candidate * >(slot.allParticleOutputArray->At(i));
+    copy = factory->NewCandidate();
+    candidate->Copy(*copy);
+    allParticleOutputArray->Add(copy);
+
+    id = candidate->GetUniqueID();
+    if(id >= fCopies.size()) fCopies.resize(id + 1, 0);
+    fCopies[id] = copy;
+  }
+
+  for(i = 0; i < slot.stableParticleOutputArray->GetEntriesFast(); ++i)
+  {
+    candidate = static_cast< Candidate * >(slot.stableParticleOutputArray->At(i));
+    stableParticleOutputArray->Add(fCopies[candidate->GetUniqueID()]);
+  }
+
+  for(i = 0; i < slot.partonOutputArray->GetEntriesFast(); ++i)
+  {
+    candidate = static_cast< Candidate * >(slot.partonOutputArray->At(i));
+    partonOutputArray->Add(fCopies[candidate->GetUniqueID()]);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesReaderThread::Work(Worker *worker)
+{
+  DelphesReaderSlot *slot;
+  Bool_t ready;
+
+  while(true)
+  {
+    {
+      unique_lock< mutex > lock(fMutex);
+      fCondition.wait(lock, [this, worker] { return !worker->freeSlots.empty() || fStop; });
+      if(fStop) return;
+      slot = worker->freeSlots.front();
+      worker->freeSlots.pop_front();
+    }
+
+    slot->factory->Clear();
+
+    try
+    {
+      slot->readStopWatch.Start();
+      ready = fRead(*slot);
+      slot->readStopWatch.Stop();
+    }
+    catch(runtime_error &e)
+    {
+      lock_guard< mutex > lock(fMutex);
+      if(fError.empty()) fError = e.what();
+      ready = kFALSE;
+    }
+
+    {
+      lock_guard< mutex > lock(fMutex);
+      if(ready) worker->readySlots.push_back(slot);
+      else worker->freeSlots.push_front(slot);
+      worker->finished = !ready;
+    }
+    fCondition.notify_all();
+
+    if(!ready) return;
+  }
+}
+
+//------------------------------------------------------------------------------
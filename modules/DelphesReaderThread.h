@@ -0,0 +1,145 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DelphesReaderThread_h
+#define DelphesReaderThread_h
+
+/** \class DelphesReaderThread
+ *
+ *  Reads the input events ahead on a second thread, or on several threads
+ *  for inputs that can be produced independently, such as the events of
+ *  generators with different seeds.
+ *
+ *  Every slot has a factory and particle arrays of its own. The reader
+ *  thread fills the free slots in input order, and the processing thread
+ *  takes them one by one, copies the particles into the arrays of its
+ *  Delphes instance with CopyParticles and releases the slot. The copies
+ *  are created in the same order as a reader would create them, so the
+ *  candidates are numbered as if they had been read on the processing
+ *  thread and the output does not change.
+ *
+ *  With several threads the slots are shared out among them, and the
+ *  events are taken from the threads in turn, so that their order does
+ *  not depend on the speed of the threads. The input ends with the first
+ *  thread that has no more events.
+ *
+ */
+
+#if !defined(__CINT__) && !defined(__CLING__)
+
+#include "TStopwatch.h"
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+class TObjArray;
+
+class Candidate;
+class DelphesFactory;
+
+struct DelphesReaderSlot
+{
+  Int_t index;
+
+  // reader thread filling the slot
+  Int_t worker;
+
+  DelphesFactory *factory;
+  TObjArray *allParticleOutputArray;
+  TObjArray *stableParticleOutputArray;
+  TObjArray *partonOutputArray;
+
+  // set by the read function
+  Long64_t eventNumber;
+
+  TStopwatch readStopWatch;
+};
+
+class DelphesReaderThread
+{
+public:
+
+  // reads the next event into the slot, false at the end of the input
+  typedef std::function< Bool_t(DelphesReaderSlot &) > ReadFunction;
+
+  // the slots are shared out among the threads, nSlots is at least nThreads
+  DelphesReaderThread(Int_t nSlots, Int_t nThreads = 1);
+  ~DelphesReaderThread();
+
+  Int_t GetNumberOfSlots() const { return fSlots.size(); }
+  Int_t GetNumberOfThreads() const { return fWorkers.size(); }
+
+  // starts reading an input, all the slots have to be released, the read
+  // function is called from all the threads at the same time
+  void Start(ReadFunction read);
+
+  // next event in input order, null at the end of the input, throws if
+  // the read function has failed
+  DelphesReaderSlot *NextSlot();
+
+  void ReleaseSlot(DelphesReaderSlot *slot);
+
+  // events read ahead and not taken yet
+  Int_t GetNumberOfReadySlots();
+
+  // stops reading ahead, the events not taken yet are dropped
+  void Stop();
+
+  void CopyParticles(const DelphesReaderSlot &slot, DelphesFactory *factory,
+    TObjArray *allParticleOutputArray,
+    TObjArray *stableParticleOutputArray,
+    TObjArray *partonOutputArray);
+
+private:
+
+  struct Worker
+  {
+    std::thread thread;
+    std::deque< DelphesReaderSlot * > freeSlots;
+    std::deque< DelphesReaderSlot * > readySlots;
+    Bool_t finished;
+  };
+
+  void Work(Worker *worker);
+
+  std::vector< DelphesReaderSlot * > fSlots;
+  std::vector< Worker * > fWorkers;
+
+  // copies indexed by the number of the candidates in the slot factory
+  std::vector< Candidate * > fCopies;
+
+  ReadFunction fRead;
+
+  std::mutex fMutex;
+  std::condition_variable fCondition;
+
+  // thread of the next event
+  Int_t fNext;
+
+  Bool_t fStop;
+  std::string fError;
+};
+
+#endif
+
+#endif /* DelphesReaderThread_h */
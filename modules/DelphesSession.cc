@@ -0,0 +1,200 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/** \class DelphesSession
+ *
+ *  Runs Delphes inside another program, one event at a time.
+ *
+ */
+
+#include "modules/DelphesSession.h"
+
+#include "modules/Delphes.h"
+#include "classes/DelphesClasses.h"
+#include "classes/DelphesFactory.h"
+#include "classes/DelphesPDGTable.h"
+
+#include "ExRootAnalysis/ExRootConfReader.h"
+
+#include "TROOT.h"
+#include "TMath.h"
+#include "TObjArray.h"
+#include "RVersion.h"
+
+#include <atomic>
+#include <stdexcept>
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+
+DelphesSession::DelphesSession(const char *cardFile) :
+  fConfReader(0), fDelphes(0), fFactory(0),
+  fAllParticleOutputArray(0), fStableParticleOutputArray(0), fPartonOutputArray(0),
+  fFinished(kFALSE)
+{
+  // the metrics and timing files of every session get its number
+  static atomic< Int_t > sessions(0);
+
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,6,0)
+  ROOT::EnableThreadSafety();
+#endif
+
+  try
+  {
+    fConfReader = new ExRootConfReader;
+    fConfReader->ReadFile(cardFile);
+
+    if(fConfReader->GetInt("::NumberOfThreads", 1) > 1)
+    {
+      throw runtime_error("NumberOfThreads can't be used in a DelphesSession, run one session per thread");
+    }
+
+    fDelphes = new Delphes(Form("DelphesSession_%d", sessions++), kTRUE);
+    fDelphes->SetConfReader(fConfReader);
+
+    fFactory = fDelphes->GetFactory();
+
+    fAllParticleOutputArray = fDelphes->ExportArray("allParticles");
+    fStableParticleOutputArray = fDelphes->ExportArray("stableParticles");
+    fPartonOutputArray = fDelphes->ExportArray("partons");
+
+    fDelphes->InitTask();
+  }
+  catch(...)
+  {
+    if(fDelphes) delete fDelphes;
+    if(fConfReader) delete fConfReader;
+    throw;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+DelphesSession::~DelphesSession()
+{
+  if(!fFinished)
+  {
+    try
+    {
+      Finish();
+    }
+    catch(runtime_error &e)
+    {
+      cerr << "** ERROR: " << e.what() << endl;
+    }
+  }
+
+  delete fDelphes;
+  delete fConfReader;
+}
+
+//------------------------------------------------------------------------------
+
+const TObjArray *DelphesSession::GetArray(const char *name)
+{
+  return fDelphes->ImportArray(name);
+}
+
+//------------------------------------------------------------------------------
+
+Bool_t DelphesSession::ProcessEvent(const DelphesParticle *particles, size_t size, Long64_t number)
+{
+  if(fFinished)
+  {
+    throw runtime_error("DelphesSession::ProcessEvent called after Finish");
+  }
+
+  fDelphes->Clear();
+
+  ConvertInput(particles, size);
+
+  if(number >= 0) fDelphes->SetEventNumber(number);
+  fDelphes->ProcessTask();
+
+  return !fDelphes->IsEventRejected();
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesSession::Finish()
+{
+  if(fFinished) return;
+  fFinished = kTRUE;
+  fDelphes->FinishTask();
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesSession::ConvertInput(const DelphesParticle *particles, size_t size)
+{
+  const DelphesParticle *particle;
+  Candidate *candidate;
+  const DelphesPDGTable *pdg;
+  const DelphesPDGTable::Entry *pdgParticle;
+  Int_t pdgCode;
+  size_t i;
+
+  pdg = DelphesPDGTable::Instance();
+
+  if(size_t(fAllParticleOutputArray->GetSize()) < size) fAllParticleOutputArray->Expand(size);
+
+  for(i = 0; i < size; ++i)
+  {
+    particle = &particles[i];
+
+    candidate = fFactory->NewCandidate();
+
+    candidate->PID = particle->pid;
+    pdgCode = TMath::Abs(candidate->PID);
+
+    candidate->Status = particle->status;
+
+    candidate->M1 = particle->m1;
+    candidate->M2 = particle->m2;
+
+    candidate->D1 = particle->d1;
+    candidate->D2 = particle->d2;
+
+    pdgParticle = pdg->Find(particle->pid);
+    candidate->Charge = pdgParticle ? pdgParticle->charge : -999;
+    candidate->Mass = particle->mass;
+
+    candidate->Momentum.SetPxPyPzE(particle->px, particle->py, particle->pz, particle->e);
+
+    candidate->Position.SetXYZT(particle->x, particle->y, particle->z, particle->t);
+
+    fAllParticleOutputArray->Add(candidate);
+
+    if(!pdgParticle) continue;
+
+    if(particle->status == 1)
+    {
+      fStableParticleOutputArray->Add(candidate);
+    }
+    else if(pdgCode <= 5 || pdgCode == 21 || pdgCode == 15)
+    {
+      fPartonOutputArray->Add(candidate);
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,117 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DelphesSession_h
+#define DelphesSession_h
+
+/** \class DelphesSession
+ *
+ *  Runs Delphes inside another program, one event at a time.
+ *
+ *  A session owns its configuration, an isolated Delphes instance with
+ *  its factory and module chain, and the random streams of the modules,
+ *  so that independent sessions can run in the same process, one per
+ *  thread. The caller passes the generator particles of an event and
+ *  reads the arrays of the modules afterwards:
+ *
+ *    DelphesSession session("cards/delphes_card_CMS.tcl");
+ *    const TObjArray *jets = session.GetArray("UniqueObjectFinder/jets");
+ *
+ *    session.ProcessEvent(particles.data(), particles.size(), number);
+ *    for(Candidate *jet : CandidateSpan(jets)) { ... }
+ *
+ *  Each module draws from a stream seeded with RandomSeed, its name and
+ *  the event number, so that an event gets the same result in any
+ *  session. A session is created and used on one thread at a time, the
+ *  Tcl interpreter of its configuration is not shared. Modules writing
+ *  to an output tree can't run in a session.
+ *
+ */
+
+#if !defined(__CINT__) && !defined(__CLING__)
+
+#include "Rtypes.h"
+
+#include <cstddef>
+#include <vector>
+
+class TObjArray;
+
+class ExRootConfReader;
+
+class Delphes;
+class DelphesFactory;
+
+struct DelphesParticle
+{
+  Int_t pid, status;
+
+  // positions of the mothers and daughters in the event, -1 for none
+  Int_t m1, m2, d1, d2;
+
+  Double_t px, py, pz, e, mass;
+  Double_t x, y, z, t;
+};
+
+class DelphesSession
+{
+public:
+
+  DelphesSession(const char *cardFile);
+  ~DelphesSession();
+
+  // array exported by a module, such as "UniqueObjectFinder/jets", filled
+  // by every ProcessEvent until the next one, throws if it does not exist
+  const TObjArray *GetArray(const char *name);
+
+  // clears the previous event and runs the modules on the particles,
+  // returns false when a module has rejected the event, the number seeds
+  // the random streams and defaults to the number of events processed
+  Bool_t ProcessEvent(const DelphesParticle *particles, size_t size, Long64_t number = -1);
+  Bool_t ProcessEvent(const std::vector< DelphesParticle > &particles, Long64_t number = -1)
+  {
+    return ProcessEvent(particles.data(), particles.size(), number);
+  }
+
+  // calls Finish of the modules, done by the destructor if not called
+  void Finish();
+
+  Delphes *GetDelphes() const { return fDelphes; }
+  DelphesFactory *GetFactory() const { return fFactory; }
+
+private:
+
+  DelphesSession(const DelphesSession &);
+  DelphesSession &operator=(const DelphesSession &);
+
+  void ConvertInput(const DelphesParticle *particles, size_t size);
+
+  ExRootConfReader *fConfReader;
+  Delphes *fDelphes;
+  DelphesFactory *fFactory;
+
+  TObjArray *fAllParticleOutputArray;
+  TObjArray *fStableParticleOutputArray;
+  TObjArray *fPartonOutputArray;
+
+  Bool_t fFinished;
+};
+
+#endif
+
+#endif /* DelphesSession_h */
@@ -0,0 +1,277 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/** \class DelphesSweep
+ *
+ *  Runs the modules of ExecutionPath from SweepStart on once for every
+ *  variant of SweepVariants.
+ *
+ */
+
+#include "modules/DelphesSweep.h"
+
+#include "modules/Delphes.h"
+#include "classes/DelphesModule.h"
+
+#include "ExRootAnalysis/ExRootConfReader.h"
+#include "ExRootAnalysis/ExRootTreeWriter.h"
+
+#include "TFile.h"
+#include "TList.h"
+#include "TFolder.h"
+#include "TString.h"
+#include "TObjArray.h"
+#include "TDirectory.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <sstream>
+#include <set>
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+
+// out.root becomes out_loose.root for the variant loose
+
+static TString VariantFileName(const char *fileName, const TString &variant)
+{
+  TString result = fileName;
+  Ssiz_t dot = result.Last('.');
+
+  if(dot < 0) dot = result.Length();
+  result.Insert(dot, TString("_") + variant);
+
+  return result;
+}
+
+//------------------------------------------------------------------------------
+
+DelphesSweep::DelphesSweep(ExRootConfReader *confReader, Int_t first)
+{
+  stringstream message, path;
+  ExRootConfParam executionPath = confReader->GetParam("::ExecutionPath");
+  ExRootConfParam variants = confReader->GetParam("::SweepVariants");
+  ExRootConfParam variant;
+  set< TString > modules, names;
+  set< TString >::const_iterator itModules;
+  TString name, parameter, fileName;
+  Ssiz_t separator;
+  Variant entry;
+  Int_t i, j, size;
+
+  for(i = first; i < executionPath.GetSize(); ++i)
+  {
+    name = executionPath[i].GetString();
+    modules.insert(name);
+    path << name << ' ';
+  }
+
+  if(variants.GetSize() == 0)
+  {
+    throw runtime_error("SweepStart is set but SweepVariants is empty");
+  }
+
+  for(i = 0; i < variants.GetSize(); ++i)
+  {
+    // {name parameter value parameter value ...}
+    variant = variants[i];
+    size = variant.GetSize();
+    entry.name = variant[0].GetString();
+    if(entry.name.Length() == 0 || size % 2 == 0 || !names.insert(entry.name).second)
+    {
+      message << "variant " << i << " of SweepVariants must be a new name followed by parameters and values";
+      throw runtime_error(message.str());
+    }
+
+    entry.confReader = new ExRootConfReader(confReader->GetOutStreamBuffer());
+    entry.modularDelphes = 0;
+    entry.outputFile = 0;
+    entry.treeWriter = 0;
+    fVariants.push_back(entry);
+
+    entry.confReader->CopyFrom(confReader);
+    entry.confReader->SetParam("::ExecutionPath", path.str().c_str());
+    entry.confReader->SetParam("::SweepStart", "");
+    entry.confReader->SetParam("::SweepVariants", "");
+
+    for(itModules = modules.begin(); itModules != modules.end(); ++itModules)
+    {
+      fileName = confReader->GetString(*itModules + "::OutputFile", "");
+      if(fileName.Length() > 0)
+      {
+        entry.confReader->SetParam(*itModules + "::OutputFile", VariantFileName(fileName, entry.name));
+      }
+    }
+
+    for(j = 1; j < size; j += 2)
+    {
+      parameter = variant[j].GetString();
+      separator = parameter.Index("::");
+      if(separator <= 0 || !modules.count(TString(parameter(0, separator))))
+      {
+        message << "parameter '" << parameter << "' of variant '" << entry.name;
+        message << "' does not belong to a module from SweepStart on";
+        throw runtime_error(message.str());
+      }
+      entry.confReader->SetParam(parameter, variant[j + 1].GetString());
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+DelphesSweep::~DelphesSweep()
+{
+  vector< Variant >::iterator itVariants;
+
+  for(itVariants = fVariants.begin(); itVariants != fVariants.end(); ++itVariants)
+  {
+    if(itVariants->modularDelphes) delete itVariants->modularDelphes;
+    if(itVariants->treeWriter) delete itVariants->treeWriter;
+    if(itVariants->outputFile) delete itVariants->outputFile;
+    delete itVariants->confReader;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesSweep::Init(TFolder *folder, ExRootTreeWriter *treeWriter)
+{
+  stringstream message;
+  TFolder *exports = static_cast< TFolder * >(folder->FindObject("Export"));
+  TFolder *variantExports;
+  TDirectory *dir;
+  TObject *object;
+  DelphesModule *module;
+  vector< Variant >::iterator itVariants;
+  vector< const TObjArray * > exported;
+  vector< const TObjArray * >::const_iterator itArrays;
+  TString fileName;
+
+  for(itVariants = fVariants.begin(); itVariants != fVariants.end(); ++itVariants)
+  {
+    itVariants->modularDelphes = new Delphes(itVariants->name);
+    itVariants->modularDelphes->SetConfReader(itVariants->confReader);
+
+    if(treeWriter && treeWriter->GetOutputFileName())
+    {
+      fileName = VariantFileName(treeWriter->GetOutputFileName(), itVariants->name);
+
+      dir = gDirectory;
+      itVariants->outputFile = TFile::Open(fileName, "RECREATE");
+      dir->cd();
+
+      if(!itVariants->outputFile || itVariants->outputFile->IsZombie())
+      {
+        message << "can't create output file " << fileName;
+        throw runtime_error(message.str());
+      }
+
+      itVariants->treeWriter = new ExRootTreeWriter(itVariants->outputFile, "Delphes");
+      itVariants->modularDelphes->SetTreeWriter(itVariants->treeWriter);
+    }
+
+    // the arrays of the reader and of the modules before SweepStart
+    variantExports = itVariants->modularDelphes->GetFolder()->AddFolder("Export", "");
+    if(exports)
+    {
+      TIter itExports(exports->GetListOfFolders());
+      while((object = itExports.Next())) variantExports->Add(object);
+    }
+
+    itVariants->modularDelphes->InitTask();
+
+    // the candidates of the shared arrays belong to all the variants
+    exported.clear();
+    TIter itTasks(itVariants->modularDelphes->GetListOfTasks());
+    while((object = itTasks.Next()))
+    {
+      module = dynamic_cast< DelphesModule * >(object);
+      if(module) exported.insert(exported.end(), module->GetExportedArrays().begin(), module->GetExportedArrays().end());
+    }
+
+    itTasks.Reset();
+    while((object = itTasks.Next()))
+    {
+      module = dynamic_cast< DelphesModule * >(object);
+      if(!module) continue;
+
+      const vector< const TObjArray * > &updated = module->GetUpdatedArrays();
+      for(itArrays = updated.begin(); itArrays != updated.end(); ++itArrays)
+      {
+        if(find(exported.begin(), exported.end(), *itArrays) != exported.end()) continue;
+
+        message << "module '" << module->GetName() << "' changes the array '" << (*itArrays)->GetName();
+        message << "' of the modules before SweepStart, start the sweep before the module exporting it";
+        throw runtime_error(message.str());
+      }
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesSweep::Process(Long64_t event)
+{
+  vector< Variant >::iterator itVariants;
+
+  for(itVariants = fVariants.begin(); itVariants != fVariants.end(); ++itVariants)
+  {
+    itVariants->modularDelphes->SetEventCounter(event);
+    itVariants->modularDelphes->ProcessTask();
+
+    if(itVariants->treeWriter)
+    {
+      if(!itVariants->modularDelphes->IsEventRejected()) itVariants->treeWriter->Fill();
+      itVariants->treeWriter->Clear();
+    }
+
+    itVariants->modularDelphes->Clear();
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesSweep::Finish()
+{
+  vector< Variant >::iterator itVariants;
+
+  for(itVariants = fVariants.begin(); itVariants != fVariants.end(); ++itVariants)
+  {
+    itVariants->modularDelphes->FinishTask();
+    if(itVariants->treeWriter) itVariants->treeWriter->Write();
+  }
+}
+
+//------------------------------------------------------------------------------
+
+Bool_t DelphesSweep::IsArrayImported(const TObjArray *array) const
+{
+  vector< Variant >::const_iterator itVariants;
+
+  for(itVariants = fVariants.begin(); itVariants != fVariants.end(); ++itVariants)
+  {
+    if(itVariants->modularDelphes && itVariants->modularDelphes->IsArrayImported(array)) return kTRUE;
+  }
+
+  return kFALSE;
+}
+
+//------------------------------------------------------------------------------
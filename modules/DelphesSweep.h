@@ -0,0 +1,92 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DelphesSweep_h
+#define DelphesSweep_h
+
+/** \class DelphesSweep
+ *
+ *  Runs the modules of ExecutionPath from SweepStart on once for every
+ *  variant of SweepVariants, after the modules before SweepStart have
+ *  run once for the event.
+ *
+ *  Every variant is a Delphes instance named after it, with its own copy
+ *  of the configuration where the parameters of the variant are
+ *  overridden, its own factory and its own output file, out_loose.root
+ *  next to out.root. The OutputFile parameters of its modules are renamed
+ *  the same way. Its modules import the arrays of the modules before
+ *  SweepStart directly, which is safe as long as they copy the candidates
+ *  they change, so modules that change these arrays in place (see
+ *  DelphesModule::UpdateArray) can't be part of a sweep.
+ *
+ *  The event branch of the reader is only written to the main output.
+ *
+ */
+
+#if !defined(__CINT__) && !defined(__CLING__)
+
+#include "Rtypes.h"
+#include "TString.h"
+
+#include <vector>
+
+class TFile;
+class TFolder;
+class TObjArray;
+
+class ExRootConfReader;
+class ExRootTreeWriter;
+
+class Delphes;
+
+class DelphesSweep
+{
+public:
+
+  // reads the variants and the modules of ExecutionPath from first on
+  DelphesSweep(ExRootConfReader *confReader, Int_t first);
+  ~DelphesSweep();
+
+  // called once the modules before SweepStart are initialized, folder is
+  // the one of the main Delphes instance
+  void Init(TFolder *folder, ExRootTreeWriter *treeWriter);
+
+  // runs every variant on the current event and fills its output tree
+  void Process(Long64_t event);
+
+  void Finish();
+
+  Bool_t IsArrayImported(const TObjArray *array) const;
+
+private:
+
+  struct Variant
+  {
+    TString name;
+    ExRootConfReader *confReader;
+    Delphes *modularDelphes;
+    TFile *outputFile;
+    ExRootTreeWriter *treeWriter;
+  };
+
+  std::vector< Variant > fVariants;
+};
+
+#endif
+
+#endif /* DelphesSweep_h */
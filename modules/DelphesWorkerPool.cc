@@ -0,0 +1,457 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/** \class DelphesWorkerPool
+ *
+ *  Runs the module chain of a configuration on several threads.
+ *
+ */
+
+#include "modules/DelphesWorkerPool.h"
+
+#include "modules/Delphes.h"
+#include "modules/DelphesProfiler.h"
+#include "classes/DelphesModule.h"
+#include "classes/DelphesFactory.h"
+#include "classes/DelphesTopology.h"
+
+#include "ExRootAnalysis/ExRootConfReader.h"
+#include "ExRootAnalysis/ExRootTreeWriter.h"
+
+#include "fastjet/Error.hh"
+
+#include "TROOT.h"
+#include "TList.h"
+#include "TClass.h"
+#include "TString.h"
+#include "TObjArray.h"
+#include "RVersion.h"
+
+#include <stdexcept>
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+
+DelphesWorkerPool::DelphesWorkerPool(ExRootConfReader *confReader, ExRootTreeWriter *treeWriter, Int_t nThreads) :
+  fTreeWriter(treeWriter), fNThreads(nThreads), fNextSequence(0), fNextOutput(0),
+  fCostScheduling(kTRUE), fThreadAffinity(kFALSE), fWriting(kFALSE), fStop(kFALSE)
+{
+  DelphesWorkerSlot *slot;
+  Int_t i;
+
+  if(fNThreads < 1)
+  {
+    throw runtime_error("NumberOfThreads must be positive");
+  }
+
+  if(confReader->GetInt("::ModuleThreads", 1) > 1)
+  {
+    throw runtime_error("ModuleThreads can't be combined with NumberOfThreads, set one of them to 1");
+  }
+
+  if(TString(confReader->GetString("::SweepStart", "")).Length() > 0)
+  {
+    throw runtime_error("SweepStart can't be combined with NumberOfThreads, set NumberOfThreads to 1");
+  }
+
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,6,0)
+  ROOT::EnableThreadSafety();
+#endif
+
+  fCostScheduling = confReader->GetBool("::CostScheduling", true);
+  fThreadAffinity = confReader->GetBool("::ThreadAffinity", false);
+
+  // every branch is created by the first instance and filled by all of them
+  if(fTreeWriter) fTreeWriter->SetSharedBranches(true);
+
+  // twice as many events as threads, so that the reader can keep ahead
+  for(i = 0; i < 2*fNThreads; ++i)
+  {
+    slot = new DelphesWorkerSlot;
+    slot->index = i;
+    slot->eventNumber = 0;
+    slot->sequence = 0;
+    slot->cost = 0;
+    slot->node = -1;
+    slot->inputFile = 0;
+
+    slot->modularDelphes = new Delphes(Form("Delphes_%d", i));
+    slot->modularDelphes->SetConfReader(confReader);
+    if(fTreeWriter) slot->modularDelphes->SetTreeWriter(fTreeWriter);
+
+    slot->factory = slot->modularDelphes->GetFactory();
+    slot->factory->SetLocalObjectCount(kTRUE);
+
+    slot->allParticleOutputArray = slot->modularDelphes->ExportArray("allParticles");
+    slot->stableParticleOutputArray = slot->modularDelphes->ExportArray("stableParticles");
+    slot->partonOutputArray = slot->modularDelphes->ExportArray("partons");
+
+    fSlots.push_back(slot);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+DelphesWorkerPool::~DelphesWorkerPool()
+{
+  vector< DelphesWorkerSlot * >::iterator itSlots;
+  vector< thread >::iterator itThreads;
+
+  {
+    lock_guard< mutex > lock(fMutex);
+    fStop = kTRUE;
+  }
+  fCondition.notify_all();
+
+  for(itThreads = fThreads.begin(); itThreads != fThreads.end(); ++itThreads)
+  {
+    if(itThreads->joinable()) itThreads->join();
+  }
+
+  for(itSlots = fSlots.begin(); itSlots != fSlots.end(); ++itSlots)
+  {
+    delete (*itSlots)->modularDelphes;
+    delete *itSlots;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesWorkerPool::Init(OutputFunction output, OutputFunction filled)
+{
+  stringstream message;
+  vector< DelphesWorkerSlot * >::iterator itSlots;
+  vector< DelphesModule * >::iterator itModules;
+  DelphesWorkerSlot *slot;
+  DelphesModule *module;
+  TObject *task;
+  Bool_t outputStage;
+  Int_t i;
+
+  fOutput = output;
+  fFilled = filled;
+
+  for(itSlots = fSlots.begin(); itSlots != fSlots.end(); ++itSlots)
+  {
+    slot = *itSlots;
+    slot->modularDelphes->InitTask();
+
+    // everything from the first module writing to the tree runs in event order
+    outputStage = kFALSE;
+    TIter itTasks(slot->modularDelphes->GetListOfTasks());
+    while((task = itTasks.Next()))
+    {
+      module = dynamic_cast< DelphesModule * >(task);
+      if(!module)
+      {
+        message << "task '" << task->GetName() << "' is not a Delphes module";
+        throw runtime_error(message.str());
+      }
+      if(module->WritesTree()) outputStage = kTRUE;
+      if(outputStage) slot->outputModules.push_back(module);
+      else slot->processModules.push_back(module);
+    }
+
+    for(itModules = slot->processModules.begin(); itModules != slot->processModules.end(); ++itModules)
+    {
+      module = *itModules;
+      if(module->IsThreadSafe()) continue;
+      message << "module '" << module->GetName() << "' of class " << module->IsA()->GetName();
+      message << " is not thread-safe, set NumberOfThreads to 1 or remove it from ExecutionPath";
+      throw runtime_error(message.str());
+    }
+
+    fFreeSlots.push_back(slot);
+  }
+
+  for(i = 0; i < fNThreads; ++i)
+  {
+    fThreads.push_back(thread(&DelphesWorkerPool::Work, this, i));
+  }
+}
+
+//------------------------------------------------------------------------------
+
+DelphesWorkerSlot *DelphesWorkerPool::AcquireSlot()
+{
+  DelphesWorkerSlot *slot;
+  unique_lock< mutex > lock(fMutex);
+
+  fCondition.wait(lock, [this] { return !fFreeSlots.empty() || !fError.empty(); });
+  CheckError();
+
+  slot = fFreeSlots.front();
+  fFreeSlots.pop_front();
+  return slot;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesWorkerPool::SubmitSlot(DelphesWorkerSlot *slot)
+{
+  {
+    lock_guard< mutex > lock(fMutex);
+    slot->sequence = fNextSequence++;
+    slot->cost = slot->allParticleOutputArray->GetEntriesFast();
+    fQueue.push_back(slot);
+  }
+  fCondition.notify_all();
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesWorkerPool::ReleaseSlot(DelphesWorkerSlot *slot)
+{
+  slot->modularDelphes->Clear();
+  {
+    lock_guard< mutex > lock(fMutex);
+    fFreeSlots.push_back(slot);
+  }
+  fCondition.notify_all();
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesWorkerPool::Finish()
+{
+  vector< DelphesWorkerSlot * >::iterator itSlots;
+  vector< thread >::iterator itThreads;
+
+  {
+    unique_lock< mutex > lock(fMutex);
+    fCondition.wait(lock, [this] { return fNextOutput == fNextSequence || !fError.empty(); });
+    fStop = kTRUE;
+  }
+  fCondition.notify_all();
+
+  for(itThreads = fThreads.begin(); itThreads != fThreads.end(); ++itThreads)
+  {
+    if(itThreads->joinable()) itThreads->join();
+  }
+  fThreads.clear();
+
+  {
+    lock_guard< mutex > lock(fMutex);
+    CheckError();
+  }
+
+  for(itSlots = fSlots.begin(); itSlots != fSlots.end(); ++itSlots)
+  {
+    (*itSlots)->modularDelphes->FinishTask();
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesWorkerPool::Work(Int_t index)
+{
+  DelphesWorkerSlot *slot;
+  const vector< Int_t > &cpus = DelphesTopology::GetCPUs();
+  Int_t node = -1;
+
+  if(fThreadAffinity && DelphesTopology::PinThread(cpus[index % cpus.size()]))
+  {
+    node = DelphesTopology::GetThreadNode();
+  }
+
+  while(true)
+  {
+    {
+      unique_lock< mutex > lock(fMutex);
+      fCondition.wait(lock, [this] { return !fQueue.empty() || fStop; });
+      if(fStop) return;
+      slot = NextSlot(node);
+      if(slot->node < 0) slot->node = node;
+    }
+
+    // an exception must not leave the thread, the main thread throws it
+    // again as a runtime_error
+    try
+    {
+      Process(slot);
+    }
+    catch(exception &e)
+    {
+      SetError(e.what());
+      return;
+    }
+    catch(fastjet::Error &e)
+    {
+      SetError(e.message());
+      return;
+    }
+    catch(...)
+    {
+      SetError("unknown exception in a worker thread");
+      return;
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesWorkerPool::SetError(const string &message)
+{
+  {
+    lock_guard< mutex > lock(fMutex);
+    if(fError.empty()) fError = message;
+  }
+  fCondition.notify_all();
+}
+
+//------------------------------------------------------------------------------
+
+DelphesWorkerSlot *DelphesWorkerPool::NextSlot(Int_t node)
+{
+  deque< DelphesWorkerSlot * >::iterator itQueue, itNext;
+  DelphesWorkerSlot *slot;
+  Bool_t local, nextLocal;
+
+  // the event to write next, then those of the slots of the node of the
+  // worker, then the heaviest, the queue is never longer than the number
+  // of slots
+  itNext = fQueue.begin();
+  if(fCostScheduling || node >= 0)
+  {
+    nextLocal = kFALSE;
+    for(itQueue = fQueue.begin(); itQueue != fQueue.end(); ++itQueue)
+    {
+      if((*itQueue)->sequence == fNextOutput)
+      {
+        itNext = itQueue;
+        break;
+      }
+      local = node >= 0 && ((*itQueue)->node == node || (*itQueue)->node < 0);
+      if(local && !nextLocal)
+      {
+        itNext = itQueue;
+        nextLocal = kTRUE;
+      }
+      else if(local == nextLocal && fCostScheduling && (*itQueue)->cost > (*itNext)->cost)
+      {
+        itNext = itQueue;
+      }
+    }
+  }
+
+  slot = *itNext;
+  fQueue.erase(itNext);
+  return slot;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesWorkerPool::Process(DelphesWorkerSlot *slot)
+{
+  vector< DelphesModule * >::iterator itModules;
+  map< Long64_t, DelphesWorkerSlot * >::iterator itProcessed;
+  DelphesProfiler *profiler = slot->modularDelphes->GetProfiler();
+
+  // ExRootTask::ProcessTask goes through TTask::ExecuteTask, which only
+  // allows one running task per process, so the modules are called directly
+
+  // same numbers as in a single-threaded run, whichever slot gets the event,
+  // the readers number the events in the input from 1
+  slot->modularDelphes->ResetRandomStreams(slot->eventNumber > 0 ? slot->eventNumber - 1 : slot->sequence);
+
+  slot->procStopWatch.Start();
+  for(itModules = slot->processModules.begin(); itModules != slot->processModules.end(); ++itModules)
+  {
+    if(slot->modularDelphes->IsEventRejected()) break;
+    if(!(*itModules)->IsActive()) continue;
+    if(profiler) profiler->Process(*itModules);
+    else (*itModules)->Process();
+  }
+
+  // the worker that finds the next event to write writes it and the
+  // processed events following it, the others go back to the queue
+  {
+    lock_guard< mutex > lock(fMutex);
+    fProcessed.insert(make_pair(slot->sequence, slot));
+    if(fWriting) return;
+    fWriting = kTRUE;
+  }
+
+  while(true)
+  {
+    {
+      lock_guard< mutex > lock(fMutex);
+      itProcessed = fProcessed.begin();
+      if(itProcessed == fProcessed.end() || itProcessed->first != fNextOutput || !fError.empty() || fStop)
+      {
+        fWriting = kFALSE;
+        return;
+      }
+      slot = itProcessed->second;
+      fProcessed.erase(itProcessed);
+    }
+
+    Output(slot);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesWorkerPool::Output(DelphesWorkerSlot *slot)
+{
+  vector< DelphesModule * >::iterator itModules;
+  DelphesProfiler *profiler = slot->modularDelphes->GetProfiler();
+
+  // only one worker writes at a time, in event order
+  for(itModules = slot->outputModules.begin(); itModules != slot->outputModules.end(); ++itModules)
+  {
+    if(slot->modularDelphes->IsEventRejected()) break;
+    if(!(*itModules)->IsActive()) continue;
+    if(profiler) profiler->Process(*itModules);
+    else (*itModules)->Process();
+  }
+  slot->procStopWatch.Stop();
+
+  if(profiler) profiler->EndEvent(slot->sequence);
+
+  if(!slot->modularDelphes->IsEventRejected())
+  {
+    if(fOutput) fOutput(*slot);
+    if(fTreeWriter) fTreeWriter->Fill();
+    if(fFilled) fFilled(*slot);
+  }
+
+  if(fTreeWriter) fTreeWriter->Clear();
+
+  slot->modularDelphes->Clear();
+
+  {
+    lock_guard< mutex > lock(fMutex);
+    ++fNextOutput;
+    fFreeSlots.push_back(slot);
+  }
+  fCondition.notify_all();
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesWorkerPool::CheckError()
+{
+  if(!fError.empty()) throw runtime_error(fError);
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,171 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DelphesWorkerPool_h
+#define DelphesWorkerPool_h
+
+/** \class DelphesWorkerPool
+ *
+ *  Runs the module chain of a configuration on several threads.
+ *
+ *  Every slot owns a Delphes instance with its own factory and modules.
+ *  The reader thread fills a free slot with one event and submits it, a
+ *  worker thread runs the module chain up to the first module writing to
+ *  the output tree, and then the remaining modules, the event branch and
+ *  ExRootTreeWriter::Fill run one slot at a time in event order, on the
+ *  worker that has finished the next event to write while the others go
+ *  on with new events.
+ *
+ *  With CostScheduling, the default, a free worker takes the next event
+ *  to write if it is waiting, and otherwise the one with the most
+ *  generator particles, so that the slowest events start first and do
+ *  not keep the other workers idle at the end of the window. The output
+ *  does not depend on the order.
+ *
+ *  With ThreadAffinity every worker is pinned to one CPU, filling one
+ *  NUMA node after the other, see DelphesTopology. A slot then belongs
+ *  to the node of the worker that processes it first, which allocates
+ *  the memory of its factory, and the workers take the events of the
+ *  slots of their own node unless there are none to take.
+ *
+ *  All the modules before the output ones must return true from
+ *  DelphesModule::IsThreadSafe.
+ *
+ */
+
+#if !defined(__CINT__) && !defined(__CLING__)
+
+#include "TStopwatch.h"
+
+#include <vector>
+#include <deque>
+#include <map>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+class TObjArray;
+
+class ExRootConfReader;
+class ExRootTreeWriter;
+
+class Delphes;
+class DelphesModule;
+class DelphesFactory;
+
+struct DelphesWorkerSlot
+{
+  Int_t index;
+
+  Delphes *modularDelphes;
+  DelphesFactory *factory;
+  TObjArray *allParticleOutputArray;
+  TObjArray *stableParticleOutputArray;
+  TObjArray *partonOutputArray;
+
+  Long64_t eventNumber;
+  Long64_t sequence;
+
+  // estimate of the time the event takes, the number of generator
+  // particles, set by SubmitSlot
+  Long64_t cost;
+
+  // NUMA node of the slot with ThreadAffinity, -1 until it is processed
+  Int_t node;
+
+  // position of the input file of the event, set by the reader
+  Int_t inputFile;
+
+  TStopwatch readStopWatch;
+  TStopwatch procStopWatch;
+
+  std::vector< DelphesModule * > processModules;
+  std::vector< DelphesModule * > outputModules;
+};
+
+class DelphesWorkerPool
+{
+public:
+
+  // called in event order before the tree is filled, typically to write
+  // the event branch with the reader of the slot
+  typedef std::function< void(DelphesWorkerSlot &) > OutputFunction;
+
+  DelphesWorkerPool(ExRootConfReader *confReader, ExRootTreeWriter *treeWriter, Int_t nThreads);
+  ~DelphesWorkerPool();
+
+  Int_t GetNumberOfSlots() const { return fSlots.size(); }
+  DelphesWorkerSlot *GetSlot(Int_t index) { return fSlots[index]; }
+
+  // filled, if given, is called in event order after the tree is filled
+  void Init(OutputFunction output, OutputFunction filled = OutputFunction());
+
+  // sequence number of the first event submitted, which numbers the random
+  // streams of the slots without an eventNumber, when a job resumes after a
+  // checkpoint, call before SubmitSlot
+  void SetNextSequence(Long64_t sequence) { fNextSequence = fNextOutput = sequence; }
+
+  // blocks until a slot is free, throws if a worker has failed
+  DelphesWorkerSlot *AcquireSlot();
+
+  void SubmitSlot(DelphesWorkerSlot *slot);
+  void ReleaseSlot(DelphesWorkerSlot *slot);
+
+  // waits for the submitted events and calls FinishTask of every instance
+  void Finish();
+
+private:
+
+  void Work(Int_t index);
+
+  // keeps the first error of a worker for the main thread and wakes it
+  void SetError(const std::string &message);
+  DelphesWorkerSlot *NextSlot(Int_t node);
+  void Process(DelphesWorkerSlot *slot);
+  void Output(DelphesWorkerSlot *slot);
+  void CheckError();
+
+  ExRootTreeWriter *fTreeWriter;
+  OutputFunction fOutput, fFilled;
+
+  std::vector< DelphesWorkerSlot * > fSlots;
+  std::vector< std::thread > fThreads;
+  Int_t fNThreads;
+
+  std::mutex fMutex;
+  std::condition_variable fCondition;
+
+  std::deque< DelphesWorkerSlot * > fFreeSlots;
+  std::deque< DelphesWorkerSlot * > fQueue;
+
+  // processed events waiting for the ones before them to be written
+  std::map< Long64_t, DelphesWorkerSlot * > fProcessed;
+
+  Long64_t fNextSequence, fNextOutput;
+  Bool_t fCostScheduling;
+  Bool_t fThreadAffinity;
+  Bool_t fWriting;
+  Bool_t fStop;
+  std::string fError;
+};
+
+#endif
+
+#endif /* DelphesWorkerPool_h */
@@ -28,6 +28,7 @@
 #include "modules/Efficiency.h"
 
 #include "classes/DelphesClasses.h"
+#include "classes/CandidateSpan.h"
 #include "classes/DelphesFactory.h"
 #include "classes/DelphesFormula.h"
 
@@ -53,9 +54,10 @@ using namespace std;
 //------------------------------------------------------------------------------
 
 Efficiency::Efficiency() :
-  fFormula(0), fItInputArray(0)
+  fFormula(0), fBatch(0)
 {
   fFormula = new DelphesFormula;
+  fBatch = new DelphesFormulaBatch;
 }
 
 //------------------------------------------------------------------------------
@@ -63,20 +65,27 @@ Efficiency::Efficiency() :
 Efficiency::~Efficiency()
 {
   if(fFormula) delete fFormula;
+  if(fBatch) delete fBatch;
 }
 
 //------------------------------------------------------------------------------
 
 void Efficiency::Init()
 {
+  ExRootConfParam param;
+
   // read efficiency formula
 
   fFormula->Compile(GetString("EfficiencyFormula", "1.0"));
 
+  // a binned table replaces the formula when it is given
+
+  param = GetParam("EfficiencyTable");
+  if(param.GetSize() > 0) fFormula->SetTable(param);
+
   // import input array
 
   fInputArray = ImportArray(GetString("InputArray", "ParticlePropagator/stableParticles"));
-  fItInputArray = fInputArray->MakeIterator();
 
   // create output array
 
@@ -87,30 +96,34 @@ void Efficiency::Init()
 
 void Efficiency::Finish()
 {
-  if(fItInputArray) delete fItInputArray;
 }
 
 //------------------------------------------------------------------------------
 
 void Efficiency::Process()
-{ 
+{
+  CandidateSpan candidates(fInputArray);
   Candidate *candidate;
-  Double_t pt, eta, phi, e;
+  Int_t i, n = candidates.size();
 
-  fItInputArray->Reset();
-  while((candidate = static_cast<Candidate*>(fItInputArray->Next())))
+  // collect the variables of all the candidates and evaluate the
+  // efficiency formula for all of them at once
+  fBatch->Resize(n);
+  for(i = 0; i < n; ++i)
   {
-    const TLorentzVector &candidatePosition = candidate->Position;
-    const TLorentzVector &candidateMomentum = candidate->Momentum;
-    eta = candidatePosition.Eta();
-    phi = candidatePosition.Phi();
-    pt = candidateMomentum.Pt();
-    e = candidateMomentum.E();
-
-    // apply an efficency formula
-    if(gRandom->Uniform() > fFormula->Eval(pt, eta, phi, e)) continue;
-    
-    fOutputArray->Add(candidate);
+    candidate = candidates[i];
+    fBatch->eta[i] = candidate->Position.Eta();
+    fBatch->phi[i] = candidate->Position.Phi();
+    fBatch->pt[i] = candidate->Momentum.Pt();
+    fBatch->energy[i] = candidate->Momentum.E();
+  }
+  fFormula->Eval(*fBatch);
+
+  for(i = 0; i < n; ++i)
+  {
+    if(GetRandom()->Uniform() > fBatch->result[i]) continue;
+
+    fOutputArray->Add(candidates[i]);
   }
 }
 
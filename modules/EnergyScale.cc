@@ -28,6 +28,7 @@
 #include "modules/EnergyScale.h"
 
 #include "classes/DelphesClasses.h"
+#include "classes/CandidateSpan.h"
 #include "classes/DelphesFactory.h"
 #include "classes/DelphesFormula.h"
 
@@ -53,9 +54,10 @@ using namespace std;
 //------------------------------------------------------------------------------
 
 EnergyScale::EnergyScale() :
-  fFormula(0), fItInputArray(0)
+  fFormula(0), fBatch(0)
 {
   fFormula = new DelphesFormula;
+  fBatch = new DelphesFormulaBatch;
 }
 
 //------------------------------------------------------------------------------
@@ -63,6 +65,7 @@ EnergyScale::EnergyScale() :
 EnergyScale::~EnergyScale()
 {
   if(fFormula) delete fFormula;
+  if(fBatch) delete fBatch;
 }
 
 //------------------------------------------------------------------------------
@@ -76,7 +79,6 @@ void EnergyScale::Init()
   // import input array
 
   fInputArray = ImportArray(GetString("InputArray", "FastJetFinder/jets"));
-  fItInputArray = fInputArray->MakeIterator();
 
   // create output array
 
@@ -87,27 +89,40 @@ void EnergyScale::Init()
 
 void EnergyScale::Finish()
 {
-  if(fItInputArray) delete fItInputArray;
 }
 
 //------------------------------------------------------------------------------
 
 void EnergyScale::Process()
 {
+  CandidateSpan candidates(fInputArray);
   Candidate *candidate;
   TLorentzVector momentum;
   Double_t scale;
-  
-  fItInputArray->Reset();
-  while((candidate = static_cast<Candidate*>(fItInputArray->Next())))
+  Int_t i, n = candidates.size();
+
+  // collect the variables of all the candidates and evaluate the
+  // scale formula for all of them at once
+  fBatch->Resize(n);
+  for(i = 0; i < n; ++i)
+  {
+    const TLorentzVector &candidateMomentum = candidates[i]->Momentum;
+    fBatch->pt[i] = candidateMomentum.Pt();
+    fBatch->eta[i] = candidateMomentum.Eta();
+    fBatch->phi[i] = candidateMomentum.Phi();
+    fBatch->energy[i] = candidateMomentum.E();
+  }
+  fFormula->Eval(*fBatch);
+
+  for(i = 0; i < n; ++i)
   {
-    momentum = candidate->Momentum;
+    momentum = candidates[i]->Momentum;
 
-    scale = fFormula->Eval(momentum.Pt(), momentum.Eta(), momentum.Phi(), momentum.E());
+    scale = fBatch->result[i];
 
     if(scale > 0.0) momentum *= scale;
 
-    candidate = static_cast<Candidate*>(candidate->Clone());
+    candidate = static_cast<Candidate*>(candidates[i]->Clone());
     candidate->Momentum = momentum;
 
     fOutputArray->Add(candidate);
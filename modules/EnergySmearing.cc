@@ -69,10 +69,17 @@ EnergySmearing::~EnergySmearing()
 
 void EnergySmearing::Init()
 {
+  ExRootConfParam param;
+
   // read resolution formula
 
   fFormula->Compile(GetString("ResolutionFormula", "0.0"));
 
+  // a binned table replaces the formula when it is given
+
+  param = GetParam("ResolutionTable");
+  if(param.GetSize() > 0) fFormula->SetTable(param);
+
   // import input array
 
   fInputArray = ImportArray(GetString("InputArray", "ParticlePropagator/stableParticles"));
@@ -109,7 +116,7 @@ void EnergySmearing::Process()
     energy = candidateMomentum.E();
  
     // apply smearing formula
-    energy = gRandom->Gaus(energy, fFormula->Eval(pt, eta, phi, energy));
+    energy = Gaus(energy, fFormula->Eval(pt, eta, phi, energy));
      
     if(energy <= 0.0) continue;
  
@@ -0,0 +1,102 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/** \class EventFilter
+ *
+ *  Rejects the events with fewer than MinNumber candidates of the
+ *  InputArray above PTMin and within EtaMax.
+ *
+ */
+
+#include "modules/EventFilter.h"
+
+#include "classes/DelphesClasses.h"
+#include "classes/CandidateSpan.h"
+#include "classes/DelphesFactory.h"
+
+#include "TMath.h"
+#include "TObjArray.h"
+#include "TLorentzVector.h"
+
+#include <iostream>
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+
+EventFilter::EventFilter() :
+  fNumberOfEvents(0), fNumberOfRejected(0), fInputArray(0)
+{
+}
+
+//------------------------------------------------------------------------------
+
+EventFilter::~EventFilter()
+{
+}
+
+//------------------------------------------------------------------------------
+
+void EventFilter::Init()
+{
+  fPTMin = GetDouble("PTMin", 0.0);
+  fEtaMax = GetDouble("EtaMax", 1.0E10);
+  fMinNumber = GetInt("MinNumber", 1);
+
+  // import input array
+
+  fInputArray = ImportArray(GetString("InputArray", "FastJetFinder/jets"));
+}
+
+//------------------------------------------------------------------------------
+
+void EventFilter::Finish()
+{
+  ostream sout(GetConfReader()->GetOutStreamBuffer());
+
+  sout << "** INFO: " << GetName() << " rejected " << fNumberOfRejected;
+  sout << " of " << fNumberOfEvents << " events" << endl;
+}
+
+//------------------------------------------------------------------------------
+
+void EventFilter::Process()
+{
+  Int_t number = 0;
+
+  for(Candidate *candidate : CandidateSpan(fInputArray))
+  {
+    const TLorentzVector &candidateMomentum = candidate->Momentum;
+
+    if(candidateMomentum.Pt() < fPTMin) continue;
+    if(TMath::Abs(candidateMomentum.Eta()) > fEtaMax) continue;
+
+    if(++number >= fMinNumber) break;
+  }
+
+  ++fNumberOfEvents;
+
+  if(number < fMinNumber)
+  {
+    ++fNumberOfRejected;
+    GetFactory()->RejectEvent();
+  }
+}
+
+//------------------------------------------------------------------------------
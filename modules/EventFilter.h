@@ -0,0 +1,62 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EventFilter_h
+#define EventFilter_h
+
+/** \class EventFilter
+ *
+ *  Rejects the events with fewer than MinNumber candidates of the
+ *  InputArray above PTMin and within EtaMax. The modules after it in
+ *  ExecutionPath are skipped for the rejected events, which are not
+ *  written to the output tree.
+ *
+ */
+
+#include "classes/DelphesModule.h"
+
+class TObjArray;
+
+class EventFilter: public DelphesModule
+{
+public:
+
+  EventFilter();
+  ~EventFilter();
+
+  void Init();
+  void Process();
+  void Finish();
+
+  Bool_t IsThreadSafe() const { return kTRUE; }
+  Bool_t CanRejectEvent() const { return kTRUE; }
+
+private:
+
+  Double_t fPTMin;
+  Double_t fEtaMax;
+  Int_t fMinNumber;
+
+  Long64_t fNumberOfEvents, fNumberOfRejected;
+
+  const TObjArray *fInputArray; //!
+
+  ClassDef(EventFilter, 1)
+};
+
+#endif
@@ -48,13 +48,18 @@
 #include <iostream>
 #include <sstream>
 #include <vector>
+#include <limits>
 #include <cassert>
+#include <thread>
+#include <chrono>
 
 #include "fastjet/PseudoJet.hh"
 #include "fastjet/JetDefinition.hh"
 #include "fastjet/ClusterSequence.hh"
 #include "fastjet/Selector.hh"
 #include "fastjet/ClusterSequenceArea.hh"
+#include "fastjet/RectangularGrid.hh"
+#include "fastjet/internal/MinHeap.hh"
 #include "fastjet/tools/JetMedianBackgroundEstimator.hh"
 
 #include "fastjet/plugins/SISCone/fastjet/SISConePlugin.hh"
@@ -70,16 +75,389 @@
 #include "fastjet/tools/Filter.hh"
 #include "fastjet/tools/Pruner.hh"
 #include "fastjet/contribs/RecursiveTools/SoftDrop.hh"
+#include "fastjet/contribs/RecursiveTools/Recluster.hh"
 
 using namespace std;
 using namespace fastjet;
 using namespace fastjet::contrib;
 
 
+//------------------------------------------------------------------------------
+
+// native algorithms with an explicit strategy, the WTA recombiner is shared
+// with the module and deleted in Finish
+
+static JetDefinition *NewStrategyDefinition(JetAlgorithm algorithm, Double_t parameterR, const JetDefinition::Recombiner *recomb, Int_t strategy)
+{
+  if(recomb) return new JetDefinition(algorithm, parameterR, recomb, static_cast<Strategy>(strategy));
+  return new JetDefinition(algorithm, parameterR, E_scheme, static_cast<Strategy>(strategy));
+}
+
+//------------------------------------------------------------------------------
+
+// Post-clustering ghost association for anti-kt. A ghost g and a proto-jet j
+// are at d = min(1/kt2_g, 1/kt2_j)*DeltaR^2/R^2, and an infinitesimally soft
+// ghost does not change the rest of the clustering. Replaying the history of
+// the real inputs, a ghost therefore joins its nearest proto-jet as soon as
+// that distance is below the next recorded dij, exactly as if the ghosts had
+// been clustered together with the inputs. A proto-jet further than R from a
+// ghost goes to the beam first, so both are binned in cells at least R wide
+// and proto-jets further than R in rapidity from all the ghosts are left out.
+
+class GhostAssociator
+{
+public:
+
+  GhostAssociator(const ClusterSequence &sequence, const vector< PseudoJet > &ghosts);
+
+  // ghost indices for each jet, the jets must come from the same sequence
+  void Associate(const vector< PseudoJet > &jets, vector< vector< Int_t > > &jetGhosts);
+
+private:
+
+  struct TProtoJetStruct
+  {
+    Double_t rap, phi, scale;
+    Int_t index;
+  };
+
+  Int_t Cell(Double_t rap, Double_t phi) const;
+  void FindNeighbours(Int_t cell);
+  Double_t Distance(Int_t ghost, const TProtoJetStruct &proto) const;
+  void AddProtoJet(Int_t index, TProtoJetStruct &proto);
+  void RemoveProtoJet(Int_t index);
+  void RemoveGhost(Int_t ghost);
+  void FindNearest(Int_t ghost);
+  void SetNearest(Int_t ghost, Int_t index, Double_t distance);
+
+  const ClusterSequence &fSequence;
+  const vector< ClusterSequence::history_element > &fHistory;
+
+  Double_t fR, fInvR2, fRapMin, fRapMax, fCellRap, fCellPhi;
+  Int_t fNRap, fNPhi;
+
+  // ghosts, indexed as the input vector
+  vector< Double_t > fGhostRap, fGhostPhi, fGhostScale, fGhostDistance;
+  vector< Int_t > fGhostNearest, fGhostProtoJet, fGhostCell, fGhostSlot;
+
+  // proto-jets, indexed by their position in the history
+  vector< Int_t > fProtoCell, fProtoSlot;
+  vector< vector< Int_t > > fOwned; // ghosts that had this proto-jet as nearest
+
+  // the cells only hold the ghosts still unattached and the proto-jets still alive
+  vector< vector< Int_t > > fGhostCells;
+  vector< vector< TProtoJetStruct > > fProtoCells;
+  vector< Int_t > fNeighbours;
+
+  MinHeap fHeap;
+};
+
+//------------------------------------------------------------------------------
+
+GhostAssociator::GhostAssociator(const ClusterSequence &sequence, const vector< PseudoJet > &ghosts) :
+  fSequence(sequence), fHistory(sequence.history()),
+  fHeap(vector< Double_t >(ghosts.size(), numeric_limits< Double_t >::max()), max(Int_t(ghosts.size()), 1))
+{
+  Int_t i, nGhosts = ghosts.size();
+
+  fR = sequence.jet_def().R();
+  fInvR2 = 1.0/(fR*fR);
+
+  // cells cover the ghosts, proto-jets up to R beyond them go to the edge cells
+
+  fRapMin = nGhosts > 0 ? ghosts[0].rap() : 0.0;
+  fRapMax = fRapMin;
+  for(i = 0; i < nGhosts; ++i)
+  {
+    fRapMin = min(fRapMin, ghosts[i].rap());
+    fRapMax = max(fRapMax, ghosts[i].rap());
+  }
+  fNRap = max(Int_t((fRapMax - fRapMin)/fR), 1);
+  fCellRap = max((fRapMax - fRapMin)/fNRap, fR);
+  fNPhi = max(Int_t(twopi/fR), 1);
+  fCellPhi = twopi/fNPhi;
+
+  fGhostCells.resize(fNRap*fNPhi);
+  fProtoCells.resize(fNRap*fNPhi);
+
+  fGhostRap.resize(nGhosts);
+  fGhostPhi.resize(nGhosts);
+  fGhostScale.resize(nGhosts);
+  fGhostDistance.assign(nGhosts, numeric_limits< Double_t >::max());
+  fGhostNearest.assign(nGhosts, -1);
+  fGhostProtoJet.assign(nGhosts, -1);
+  fGhostCell.resize(nGhosts);
+  fGhostSlot.resize(nGhosts);
+  for(i = 0; i < nGhosts; ++i)
+  {
+    fGhostRap[i] = ghosts[i].rap();
+    fGhostPhi[i] = ghosts[i].phi_02pi();
+    fGhostScale[i] = sequence.jet_scale_for_algorithm(ghosts[i]);
+    fGhostCell[i] = Cell(fGhostRap[i], fGhostPhi[i]);
+    fGhostSlot[i] = fGhostCells[fGhostCell[i]].size();
+    fGhostCells[fGhostCell[i]].push_back(i);
+  }
+
+  fProtoCell.resize(fHistory.size());
+  fProtoSlot.resize(fHistory.size());
+  fOwned.resize(fHistory.size());
+}
+
+//------------------------------------------------------------------------------
+
+Int_t GhostAssociator::Cell(Double_t rap, Double_t phi) const
+{
+  Int_t iRap, iPhi;
+
+  iRap = Int_t((rap - fRapMin)/fCellRap);
+  if(rap < fRapMin) iRap = 0;
+  if(iRap >= fNRap) iRap = fNRap - 1;
+  iPhi = Int_t(phi/fCellPhi);
+  if(iPhi >= fNPhi) iPhi = fNPhi - 1;
+
+  return iRap*fNPhi + iPhi;
+}
+
+//------------------------------------------------------------------------------
+
+void GhostAssociator::FindNeighbours(Int_t cell)
+{
+  Int_t iRap, iPhi, jRap, jPhi, dPhi;
+
+  iRap = cell / fNPhi;
+  iPhi = cell % fNPhi;
+
+  fNeighbours.clear();
+  for(jRap = max(iRap - 1, 0); jRap <= min(iRap + 1, fNRap - 1); ++jRap)
+  {
+    if(fNPhi < 3)
+    {
+      for(jPhi = 0; jPhi < fNPhi; ++jPhi) fNeighbours.push_back(jRap*fNPhi + jPhi);
+    }
+    else
+    {
+      for(dPhi = -1; dPhi <= 1; ++dPhi)
+      {
+        jPhi = (iPhi + dPhi + fNPhi) % fNPhi;
+        fNeighbours.push_back(jRap*fNPhi + jPhi);
+      }
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+Double_t GhostAssociator::Distance(Int_t ghost, const TProtoJetStruct &proto) const
+{
+  Double_t drap, dphi;
+
+  drap = fGhostRap[ghost] - proto.rap;
+  dphi = TMath::Abs(fGhostPhi[ghost] - proto.phi);
+  if(dphi > pi) dphi = twopi - dphi;
+
+  return (dphi*dphi + drap*drap) * min(fGhostScale[ghost], proto.scale) * fInvR2;
+}
+
+//------------------------------------------------------------------------------
+
+void GhostAssociator::AddProtoJet(Int_t index, TProtoJetStruct &proto)
+{
+  const PseudoJet &jet = fSequence.jets()[fHistory[index].jetp_index];
+
+  proto.rap = jet.rap();
+  proto.phi = jet.phi_02pi();
+  proto.scale = fSequence.jet_scale_for_algorithm(jet);
+  proto.index = index;
+
+  fProtoCell[index] = -1;
+  if(proto.rap < fRapMin - fR || proto.rap > fRapMax + fR) return;
+
+  fProtoCell[index] = Cell(proto.rap, proto.phi);
+  fProtoSlot[index] = fProtoCells[fProtoCell[index]].size();
+  fProtoCells[fProtoCell[index]].push_back(proto);
+}
+
+//------------------------------------------------------------------------------
+
+void GhostAssociator::RemoveProtoJet(Int_t index)
+{
+  if(fProtoCell[index] < 0) return;
+
+  vector< TProtoJetStruct > &cell = fProtoCells[fProtoCell[index]];
+
+  cell[fProtoSlot[index]] = cell.back();
+  fProtoSlot[cell.back().index] = fProtoSlot[index];
+  cell.pop_back();
+}
+
+//------------------------------------------------------------------------------
+
+void GhostAssociator::RemoveGhost(Int_t ghost)
+{
+  vector< Int_t > &cell = fGhostCells[fGhostCell[ghost]];
+
+  cell[fGhostSlot[ghost]] = cell.back();
+  fGhostSlot[cell.back()] = fGhostSlot[ghost];
+  cell.pop_back();
+}
+
+//------------------------------------------------------------------------------
+
+void GhostAssociator::SetNearest(Int_t ghost, Int_t index, Double_t distance)
+{
+  fGhostNearest[ghost] = index;
+  fGhostDistance[ghost] = distance;
+  if(index >= 0) fOwned[index].push_back(ghost);
+  fHeap.update(ghost, distance);
+}
+
+//------------------------------------------------------------------------------
+
+void GhostAssociator::FindNearest(Int_t ghost)
+{
+  vector< Int_t >::const_iterator itCells;
+  vector< TProtoJetStruct >::const_iterator itProtoJets;
+  Double_t distance, minDistance = numeric_limits< Double_t >::max();
+  Int_t nearest = -1;
+
+  FindNeighbours(fGhostCell[ghost]);
+  for(itCells = fNeighbours.begin(); itCells != fNeighbours.end(); ++itCells)
+  {
+    const vector< TProtoJetStruct > &cell = fProtoCells[*itCells];
+    for(itProtoJets = cell.begin(); itProtoJets != cell.end(); ++itProtoJets)
+    {
+      distance = Distance(ghost, *itProtoJets);
+      if(distance < minDistance && distance < itProtoJets->scale)
+      {
+        minDistance = distance;
+        nearest = itProtoJets->index;
+      }
+    }
+  }
+
+  SetNearest(ghost, nearest, minDistance);
+}
+
+//------------------------------------------------------------------------------
+
+void GhostAssociator::Associate(const vector< PseudoJet > &jets, vector< vector< Int_t > > &jetGhosts)
+{
+  vector< Int_t > position;
+  vector< Int_t >::const_iterator itCells, itGhosts;
+  vector< PseudoJet >::const_iterator itJets;
+  Int_t i, k, ghost, index, parent, parent1, parent2, child;
+  Int_t nGhosts = fGhostRap.size(), nParticles = fSequence.n_particles();
+  Double_t distance;
+  Bool_t merged;
+  TProtoJetStruct proto;
+
+  // the inner vectors are kept from one event to the next
+  jetGhosts.resize(jets.size());
+  for(i = 0; i < Int_t(jets.size()); ++i) jetGhosts[i].clear();
+  if(nGhosts == 0) return;
+
+  for(k = 0; k < nParticles; ++k) AddProtoJet(k, proto);
+  for(i = 0; i < nGhosts; ++i) FindNearest(i);
+
+  for(k = nParticles; k < Int_t(fHistory.size()); ++k)
+  {
+    // ghosts closer to their proto-jet than the next recombination join it now
+
+    while(fHeap.minval() < fHistory[k].dij)
+    {
+      ghost = fHeap.minloc();
+      fGhostProtoJet[ghost] = fGhostNearest[ghost];
+      fHeap.remove(ghost);
+      RemoveGhost(ghost);
+    }
+
+    parent1 = fHistory[k].parent1;
+    parent2 = fHistory[k].parent2;
+    merged = (parent2 != ClusterSequence::BeamJet);
+
+    RemoveProtoJet(parent1);
+    if(merged)
+    {
+      RemoveProtoJet(parent2);
+      AddProtoJet(k, proto);
+    }
+
+    // ghosts whose nearest proto-jet is gone look again, unless the merged
+    // one is at least as close since all the others were already further
+
+    for(i = 0; i < 2; ++i)
+    {
+      parent = (i == 0) ? parent1 : parent2;
+      if(parent < 0) continue;
+      for(itGhosts = fOwned[parent].begin(); itGhosts != fOwned[parent].end(); ++itGhosts)
+      {
+        ghost = *itGhosts;
+        if(fGhostProtoJet[ghost] >= 0 || fGhostNearest[ghost] != parent) continue;
+        distance = merged ? Distance(ghost, proto) : numeric_limits< Double_t >::max();
+        if(merged && distance <= fGhostDistance[ghost] && distance < proto.scale)
+        {
+          SetNearest(ghost, k, distance);
+        }
+        else
+        {
+          FindNearest(ghost);
+        }
+      }
+      fOwned[parent].clear();
+    }
+
+    // and the others may find the merged one closer
+
+    if(!merged || fProtoCell[k] < 0) continue;
+
+    FindNeighbours(fProtoCell[k]);
+    for(itCells = fNeighbours.begin(); itCells != fNeighbours.end(); ++itCells)
+    {
+      const vector< Int_t > &cell = fGhostCells[*itCells];
+      for(itGhosts = cell.begin(); itGhosts != cell.end(); ++itGhosts)
+      {
+        ghost = *itGhosts;
+        if(fGhostNearest[ghost] == k) continue;
+        distance = Distance(ghost, proto);
+        if(distance < fGhostDistance[ghost] && distance < proto.scale) SetNearest(ghost, k, distance);
+      }
+    }
+  }
+
+  // follow each proto-jet to the output jet it ends up in
+
+  position.assign(fHistory.size(), -1);
+  for(itJets = jets.begin(); itJets != jets.end(); ++itJets)
+  {
+    position[itJets->cluster_hist_index()] = itJets - jets.begin();
+  }
+
+  for(ghost = 0; ghost < nGhosts; ++ghost)
+  {
+    index = fGhostProtoJet[ghost];
+    if(index < 0) continue;
+    while(position[index] < 0)
+    {
+      child = fHistory[index].child;
+      if(child < 0 || fHistory[child].parent2 == ClusterSequence::BeamJet) break;
+      index = child;
+    }
+    if(position[index] >= 0) jetGhosts[position[index]].push_back(ghost);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+struct FastJetFinder::TSubstructureJob
+{
+  Candidate *candidate;
+  vector< PseudoJet > constituents;
+};
+
 //------------------------------------------------------------------------------
 
 FastJetFinder::FastJetFinder() :
-  fPlugin(0), fRecomb(0), fNjettinessPlugin(0), fDefinition(0), fAreaDefinition(0), fItInputArray(0), fItGhostAssociatedInputArray(0)
+  fPlugin(0), fRecomb(0), fNjettinessPlugin(0), fDefinition(0), fCambridgeDefinition(0), fSequence(0), fCambridgeSequence(0), fInputList(0), fGhostList(0), fInputDumpFile(0), fSoftGrid(0), fSoftCellMomenta(0), fReclusterDefinition(0), fAreaDefinition(0), fItInputArray(0), fItGhostAssociatedInputArray(0)
 {
 
 }
@@ -97,10 +475,22 @@ void FastJetFinder::Init()
 {
   JetDefinition::Plugin *plugin = 0;
   JetDefinition::Recombiner *recomb = 0;
+  SISConePlugin *siscone = 0;
   ExRootConfParam param;
   Long_t i, size;
   Double_t etaMin, etaMax;
   TEstimatorStruct estimatorStruct;
+  TSubstructureTools toolsStruct;
+  Njettiness::AxesMode axisMode;
+  TDefinitionStruct definitionStruct;
+  vector< TDefinitionStruct >::iterator itDefinitions;
+  SoftDrop *softDrop;
+  vector< Int_t > candidateStrategies;
+  vector< Int_t >::iterator itStrategies;
+  size_t j;
+  Double_t cambridgeR;
+  string dumpFileName;
+  stringstream message;
 
   // define algorithm
 
@@ -116,8 +506,41 @@ void FastJetFinder::Init()
   fAdjacencyCut = GetInt("AdjacencyCut", 2);
   fOverlapThreshold = GetDouble("OverlapThreshold", 0.75);
 
+  // SISCone only: the inputs can be pre-clustered into cells of this size
+  // in eta and phi, and the stable-cone search shared between threads
+  fSISConeCellSize = GetDouble("SISConeCellSize", 0.0);
+  fSISConeThreads = GetInt("SISConeThreads", 1);
+  if(fSISConeThreads < 1)
+  {
+    throw runtime_error("SISConeThreads must be positive");
+  }
+
   fJetPTMin = GetDouble("JetPTMin", 10.0);
 
+  fStrategy = GetInt("Strategy", Best);
+  fCalibrationEvents = GetInt("StrategyCalibrationEvents", 0);
+  if((fStrategy != Best || fCalibrationEvents > 0) && (fJetAlgorithm <= 3 || fJetAlgorithm == 8 || fJetAlgorithm == 14))
+  {
+    throw runtime_error("Strategy and StrategyCalibrationEvents do not apply to the plugin algorithms");
+  }
+
+  fConstituentPTMin = GetDouble("ConstituentPTMin", 0.0);
+  fConstituentEtaMax = GetDouble("ConstituentEtaMax", 0.0);
+  fSoftGridSize = GetDouble("SoftGridSize", 0.0);
+
+  if(fSoftGridSize > 0.0)
+  {
+    if(fConstituentPTMin <= 0.0)
+    {
+      throw runtime_error("SoftGridSize requires a positive ConstituentPTMin");
+    }
+    // the cells cover the eta window, or the calorimeter acceptance without one
+    fSoftGrid = new RectangularGrid(fConstituentEtaMax > 0.0 ? fConstituentEtaMax : 5.0, fSoftGridSize);
+    fSoftCellMembers.assign(fSoftGrid->n_tiles(), vector< Int_t >());
+    fSoftCellMomenta = new vector< PseudoJet >(fSoftGrid->n_tiles());
+    fSoftCellsUsed.clear();
+  }
+
   //-- N(sub)jettiness parameters --
 
   fComputeNsubjettiness = GetBool("ComputeNsubjettiness", false);
@@ -143,9 +566,31 @@ void FastJetFinder::Init()
   //-- SoftDrop parameters --
   
   fComputeSoftDrop     = GetBool("ComputeSoftDrop", false);
-  fBetaSoftDrop        = GetDouble("BetaSoftDrop", 0.0);
-  fSymmetryCutSoftDrop = GetDouble("SymmetryCutSoftDrop", 0.1);
   fR0SoftDrop= GetDouble("R0SoftDrop=", 0.8);
+
+  // BetaSoftDrop and SymmetryCutSoftDrop can be lists of working points,
+  // a single value is used for every entry of the other list
+
+  fBetaSoftDrop.clear();
+  fSymmetryCutSoftDrop.clear();
+
+  param = GetParam("BetaSoftDrop");
+  size = param.GetSize();
+  for(i = 0; i < size; ++i) fBetaSoftDrop.push_back(param[i].GetDouble());
+  if(fBetaSoftDrop.empty()) fBetaSoftDrop.push_back(0.0);
+
+  param = GetParam("SymmetryCutSoftDrop");
+  size = param.GetSize();
+  for(i = 0; i < size; ++i) fSymmetryCutSoftDrop.push_back(param[i].GetDouble());
+  if(fSymmetryCutSoftDrop.empty()) fSymmetryCutSoftDrop.push_back(0.1);
+
+  if(fBetaSoftDrop.size() == 1) fBetaSoftDrop.resize(fSymmetryCutSoftDrop.size(), fBetaSoftDrop[0]);
+  if(fSymmetryCutSoftDrop.size() == 1) fSymmetryCutSoftDrop.resize(fBetaSoftDrop.size(), fSymmetryCutSoftDrop[0]);
+
+  if(fBetaSoftDrop.size() != fSymmetryCutSoftDrop.size())
+  {
+    throw runtime_error("BetaSoftDrop and SymmetryCutSoftDrop must have the same number of working points");
+  }
   
 
   // ---  Jet Area Parameters ---
@@ -159,26 +604,31 @@ void FastJetFinder::Init()
   fGridScatter = GetDouble("GridScatter", 1.0);
   fPtScatter = GetDouble("PtScatter", 0.1);
   fMeanGhostPt = GetDouble("MeanGhostPt", 1.0E-100);
+  // generate the ghosts once and only shift them from event to event
+  fCacheGhosts = GetBool("CacheGhosts", false);
 
   // - voronoi based areas -
   fEffectiveRfact = GetDouble("EffectiveRfact", 1.0);
 
+  GhostedAreaSpec ghostSpec(fGhostEtaMax, fRepeat, fGhostArea, fGridScatter, fPtScatter, fMeanGhostPt);
+  ghostSpec.set_cached_lattice(fCacheGhosts);
+
   switch(fAreaAlgorithm)
   {
     case 1:
-      fAreaDefinition = new AreaDefinition(active_area_explicit_ghosts, GhostedAreaSpec(fGhostEtaMax, fRepeat, fGhostArea, fGridScatter, fPtScatter, fMeanGhostPt));
+      fAreaDefinition = new AreaDefinition(active_area_explicit_ghosts, ghostSpec);
       break;
     case 2:
-      fAreaDefinition = new AreaDefinition(one_ghost_passive_area, GhostedAreaSpec(fGhostEtaMax, fRepeat, fGhostArea, fGridScatter, fPtScatter, fMeanGhostPt));
+      fAreaDefinition = new AreaDefinition(one_ghost_passive_area, ghostSpec);
       break;
     case 3:
-      fAreaDefinition = new AreaDefinition(passive_area, GhostedAreaSpec(fGhostEtaMax, fRepeat, fGhostArea, fGridScatter, fPtScatter, fMeanGhostPt));
+      fAreaDefinition = new AreaDefinition(passive_area, ghostSpec);
       break;
     case 4:
       fAreaDefinition = new AreaDefinition(VoronoiAreaSpec(fEffectiveRfact));
       break;
     case 5:
-      fAreaDefinition = new AreaDefinition(active_area, GhostedAreaSpec(fGhostEtaMax, fRepeat, fGhostArea, fGridScatter, fPtScatter, fMeanGhostPt));
+      fAreaDefinition = new AreaDefinition(active_area, ghostSpec);
       break;
     default:
     case 0:
@@ -197,22 +647,28 @@ void FastJetFinder::Init()
       fDefinition = new JetDefinition(plugin);
       break;
     case 3:
-      plugin = new SISConePlugin(fConeRadius, fOverlapThreshold, fMaxIterations, fJetPTMin);
+      siscone = new SISConePlugin(fConeRadius, fOverlapThreshold, fMaxIterations, fJetPTMin);
+      // events are clustered one at a time, so SISCone can keep its
+      // internal storage from one event to the next
+      siscone->set_reuse_workspace(true);
+      siscone->set_precluster_cell_size(fSISConeCellSize);
+      siscone->set_n_threads(fSISConeThreads);
+      plugin = siscone;
       fDefinition = new JetDefinition(plugin);
       break;
     case 4:
-      fDefinition = new JetDefinition(kt_algorithm, fParameterR);
+      fDefinition = NewStrategyDefinition(kt_algorithm, fParameterR, 0, fStrategy);
       break;
     case 5:
-      fDefinition = new JetDefinition(cambridge_algorithm, fParameterR);
+      fDefinition = NewStrategyDefinition(cambridge_algorithm, fParameterR, 0, fStrategy);
       break;
     default:
     case 6:
-      fDefinition = new JetDefinition(antikt_algorithm, fParameterR);
+      fDefinition = NewStrategyDefinition(antikt_algorithm, fParameterR, 0, fStrategy);
       break;
     case 7:
       recomb = new WinnerTakeAllRecombiner();
-      fDefinition = new JetDefinition(antikt_algorithm, fParameterR, recomb, Best);
+      fDefinition = NewStrategyDefinition(antikt_algorithm, fParameterR, recomb, fStrategy);
       break;
     case 8:
       fNjettinessPlugin = new NjettinessPlugin(fN, Njettiness::wta_kt_axes, Njettiness::unnormalized_cutoff_measure, fBeta, fRcutOff);
@@ -227,8 +683,95 @@ void FastJetFinder::Init()
   fPlugin = plugin;
   fRecomb = recomb;
 
+  // candidate strategies for the calibration, Best only picks among the
+  // first five with thresholds that need not suit this machine
+
+  fCalibrationDefinitions.clear();
+  fCalibrationTimes.clear();
+  fCalibrationEvent = 0;
+  if(fCalibrationEvents > 0)
+  {
+    candidateStrategies.push_back(N2Plain);
+    candidateStrategies.push_back(N2Tiled);
+    candidateStrategies.push_back(N2MinHeapTiled);
+    candidateStrategies.push_back(N2MHTLazy9);
+    candidateStrategies.push_back(N2MHTLazy25);
+    candidateStrategies.push_back(N2MHTLazy9SoA);
+    if(fDefinition->jet_algorithm() == cambridge_algorithm) candidateStrategies.push_back(NlnNCam);
+    if(fDefinition->jet_algorithm() == antikt_algorithm && fAreaDefinition) candidateStrategies.push_back(N2MHTLazy9AntiKtSeparateGhosts);
+
+    for(itStrategies = candidateStrategies.begin(); itStrategies != candidateStrategies.end(); ++itStrategies)
+    {
+      fCalibrationDefinitions.push_back(NewStrategyDefinition(fDefinition->jet_algorithm(), fParameterR, recomb, *itStrategies));
+      fCalibrationTimes.push_back(0.0);
+    }
+  }
+
   ClusterSequence::print_banner();
 
+  // substructure tools, one set per thread
+
+  fNThreads = GetInt("NThreads", 1);
+  if(fNThreads < 1)
+  {
+    throw runtime_error("NThreads must be positive");
+  }
+
+  switch(fAxisMode)
+  {
+    default:
+    case 1:
+      axisMode = Njettiness::wta_kt_axes;
+      break;
+    case 2:
+      axisMode = Njettiness::onepass_wta_kt_axes;
+      break;
+    case 3:
+      axisMode = Njettiness::kt_axes;
+      break;
+    case 4:
+      axisMode = Njettiness::onepass_kt_axes;
+      break;
+  }
+
+  fSubstructureTools.clear();
+  for(i = 0; i < fNThreads; ++i)
+  {
+    toolsStruct.trimmer = new Filter(JetDefinition(kt_algorithm, fRTrim), SelectorPtFractionMin(fPtFracTrim));
+    toolsStruct.pruner = new Pruner(JetDefinition(cambridge_algorithm, fRPrun), fZcutPrun, fRcutPrun);
+    toolsStruct.softDropRecluster = new contrib::Recluster(cambridge_algorithm, JetDefinition::max_allowable_R);
+    toolsStruct.softDrops.clear();
+    for(j = 0; j < fBetaSoftDrop.size(); ++j)
+    {
+      softDrop = new SoftDrop(fBetaSoftDrop[j], fSymmetryCutSoftDrop[j], fR0SoftDrop);
+      // the jets are reclustered once in ComputeSubstructure
+      softDrop->set_reclustering(false);
+      toolsStruct.softDrops.push_back(softDrop);
+    }
+    toolsStruct.nSubjettiness = new NsubjettinessSet(5, axisMode, Njettiness::unnormalized_measure, fBeta);
+    fSubstructureTools.push_back(toolsStruct);
+  }
+
+  if(fNThreads > 1) fReclusterDefinition = new JetDefinition(cambridge_algorithm, JetDefinition::max_allowable_R);
+
+  // without areas one sequence is reclustered every event
+  if(!fAreaDefinition) fSequence = new ClusterSequence();
+
+  fInputList = new vector< PseudoJet >;
+  fGhostList = new vector< PseudoJet >;
+
+  dumpFileName = GetString("InputDumpFile", "");
+  if(!dumpFileName.empty())
+  {
+    fInputDumpFile = fopen(dumpFileName.c_str(), "wb");
+    if(fInputDumpFile == NULL)
+    {
+      message.str("");
+      message << "can't open input dump file " << dumpFileName;
+      throw runtime_error(message.str());
+    }
+  }
+
   if(fComputeRho && fAreaDefinition)
   {
     // read eta ranges
@@ -236,12 +779,15 @@ void FastJetFinder::Init()
     param = GetParam("RhoEtaRange");
     size = param.GetSize();
 
+    // the estimators take their jets from the clustering of the event,
+    // which is done with the same jet and area definitions
+
     fEstimators.clear();
     for(i = 0; i < size/2; ++i)
     {
       etaMin = param[i*2].GetDouble();
       etaMax = param[i*2 + 1].GetDouble();
-      estimatorStruct.estimator = new JetMedianBackgroundEstimator(SelectorEtaRange(etaMin, etaMax), *fDefinition, *fAreaDefinition);
+      estimatorStruct.estimator = new JetMedianBackgroundEstimator(SelectorEtaRange(etaMin, etaMax));
       estimatorStruct.etaMin = etaMin;
       estimatorStruct.etaMax = etaMax;
       fEstimators.push_back(estimatorStruct);
@@ -258,11 +804,109 @@ void FastJetFinder::Init()
     fGhostAssociatedInputArray = ImportArray(ghost_array_name.c_str());
     fItGhostAssociatedInputArray = fGhostAssociatedInputArray->MakeIterator();
   }
+  fGhostAssociationGrid = GetBool("GhostAssociationGrid", false);
 
   // create output arrays
 
   fOutputArray = ExportArray(GetString("OutputArray", "jets"));
   fRhoOutputArray = ExportArray(GetString("RhoOutputArray", "rho"));
+
+  // read extra jet definitions: {algorithm R output array} triples
+
+  param = GetParam("ExtraJetDefinitions");
+  size = param.GetSize();
+
+  fExtraDefinitions.clear();
+  cambridgeR = 0.0;
+  for(i = 0; i < size/3; ++i)
+  {
+    definitionStruct.algorithm = param[i*3].GetInt();
+    definitionStruct.parameterR = param[i*3 + 1].GetDouble();
+    definitionStruct.definition = 0;
+    definitionStruct.sequence = 0;
+    definitionStruct.dcut = 0.0;
+    definitionStruct.useMainSequence = kFALSE;
+    definitionStruct.outputArray = ExportArray(param[i*3 + 2].GetString());
+
+    if(definitionStruct.algorithm < 4 || definitionStruct.algorithm > 6)
+    {
+      message.str("");
+      message << "can't use jet algorithm " << definitionStruct.algorithm << " in ExtraJetDefinitions, only 4 (kt), 5 (C/A) and 6 (antikt) are supported";
+      throw runtime_error(message.str());
+    }
+
+    if(definitionStruct.algorithm == fJetAlgorithm && definitionStruct.parameterR == fParameterR)
+    {
+      // same as the main definition, take the same jets again
+      definitionStruct.useMainSequence = kTRUE;
+    }
+    else if(definitionStruct.algorithm == 5 && !fAreaDefinition)
+    {
+      // C/A merges in order of angle only, so one history serves every R
+      definitionStruct.dcut = definitionStruct.parameterR*definitionStruct.parameterR;
+      if(fJetAlgorithm == 5 && definitionStruct.parameterR <= fParameterR)
+      {
+        definitionStruct.useMainSequence = kTRUE;
+      }
+      else if(definitionStruct.parameterR > cambridgeR)
+      {
+        cambridgeR = definitionStruct.parameterR;
+      }
+    }
+    else
+    {
+      // kt distances scale differently for each R, cluster separately
+      switch(definitionStruct.algorithm)
+      {
+        case 4:
+          definitionStruct.definition = new JetDefinition(kt_algorithm, definitionStruct.parameterR);
+          break;
+        case 5:
+          definitionStruct.definition = new JetDefinition(cambridge_algorithm, definitionStruct.parameterR);
+          break;
+        case 6:
+          definitionStruct.definition = new JetDefinition(antikt_algorithm, definitionStruct.parameterR);
+          break;
+      }
+      if(!fAreaDefinition) definitionStruct.sequence = new ClusterSequence();
+    }
+
+    fExtraDefinitions.push_back(definitionStruct);
+  }
+
+  // dcut is relative to the R of the history it is read from
+
+  if(cambridgeR > 0.0)
+  {
+    fCambridgeDefinition = new JetDefinition(cambridge_algorithm, cambridgeR);
+    fCambridgeSequence = new ClusterSequence();
+  }
+  for(itDefinitions = fExtraDefinitions.begin(); itDefinitions != fExtraDefinitions.end(); ++itDefinitions)
+  {
+    if(itDefinitions->dcut <= 0.0) continue;
+    itDefinitions->dcut /= itDefinitions->useMainSequence ? fParameterR*fParameterR : cambridgeR*cambridgeR;
+  }
+
+  // the ghosts are attached by replaying the anti-kt histories
+
+  if(fGhostAssociationGrid)
+  {
+    if(!fGhostAssociatedInputArray)
+    {
+      throw runtime_error("GhostAssociationGrid needs a GhostAssociatedInputArray");
+    }
+    if((fJetAlgorithm != 6 && fJetAlgorithm != 7) || fAreaDefinition)
+    {
+      throw runtime_error("GhostAssociationGrid only works with JetAlgorithm 6 or 7 and without jet areas");
+    }
+    for(itDefinitions = fExtraDefinitions.begin(); itDefinitions != fExtraDefinitions.end(); ++itDefinitions)
+    {
+      if(itDefinitions->algorithm != 6)
+      {
+        throw runtime_error("GhostAssociationGrid only works with jet algorithm 6 in ExtraJetDefinitions");
+      }
+    }
+  }
 }
 
 //------------------------------------------------------------------------------
@@ -270,12 +914,42 @@ void FastJetFinder::Init()
 void FastJetFinder::Finish()
 {
   vector< TEstimatorStruct >::iterator itEstimators;
+  vector< TDefinitionStruct >::iterator itDefinitions;
+  vector< TSubstructureTools >::iterator itTools;
+  vector< SoftDrop * >::iterator itSoftDrop;
+  vector< JetDefinition * >::iterator itCalibration;
+
+  for(itTools = fSubstructureTools.begin(); itTools != fSubstructureTools.end(); ++itTools)
+  {
+    delete itTools->trimmer;
+    delete itTools->pruner;
+    delete itTools->softDropRecluster;
+    for(itSoftDrop = itTools->softDrops.begin(); itSoftDrop != itTools->softDrops.end(); ++itSoftDrop) delete *itSoftDrop;
+    delete itTools->nSubjettiness;
+  }
+  if(fReclusterDefinition) delete fReclusterDefinition;
 
   for(itEstimators = fEstimators.begin(); itEstimators != fEstimators.end(); ++itEstimators)
   {
     if(itEstimators->estimator) delete itEstimators->estimator;
   }
 
+  for(itDefinitions = fExtraDefinitions.begin(); itDefinitions != fExtraDefinitions.end(); ++itDefinitions)
+  {
+    if(itDefinitions->definition) delete itDefinitions->definition;
+    if(itDefinitions->sequence) delete itDefinitions->sequence;
+  }
+  for(itCalibration = fCalibrationDefinitions.begin(); itCalibration != fCalibrationDefinitions.end(); ++itCalibration) delete *itCalibration;
+  fCalibrationDefinitions.clear();
+  if(fCambridgeDefinition) delete fCambridgeDefinition;
+  if(fCambridgeSequence) delete fCambridgeSequence;
+  if(fSequence) delete fSequence;
+  if(fInputList) delete fInputList;
+  if(fGhostList) delete fGhostList;
+  if(fSoftGrid) delete fSoftGrid;
+  if(fSoftCellMomenta) delete fSoftCellMomenta;
+  if(fInputDumpFile) fclose(fInputDumpFile);
+
   // shouldn't delete do nothing if these pointers are zero anyway??
   if(fItInputArray) delete fItInputArray;
   delete fItGhostAssociatedInputArray;
@@ -288,36 +962,95 @@ void FastJetFinder::Finish()
 
 //------------------------------------------------------------------------------
 
+Bool_t FastJetFinder::IsThreadSafe() const
+{
+  // ghosts are placed with the static random generator of GhostedAreaSpec
+  if(fAreaDefinition && fAreaAlgorithm != 4) return kFALSE;
+
+  return fInputDumpFile == 0;
+}
+
+//------------------------------------------------------------------------------
+
 void FastJetFinder::Process()
 {
-  Candidate *candidate, *constituent;
+  Candidate *candidate;
   TLorentzVector momentum;
 
-  Double_t deta, dphi, detaMax, dphiMax;
-  Double_t time, timeWeight;
-  Int_t number;
-  Double_t rho = 0.0;
-  PseudoJet jet, area;
-  ClusterSequence *sequence;
-  vector< PseudoJet > inputList, outputList, subjets;
-  vector< PseudoJet >::iterator itInputList, itOutputList;
+  Int_t number, nInputs, cell;
+  Double_t rho = 0.0, ptMin2;
+  PseudoJet pseudoJet;
+  vector< Int_t >::const_iterator itCells;
+  ClusterSequence *sequence, *extraSequence;
+  Bool_t clusteredCambridge;
+  vector< PseudoJet > &inputList = *fInputList;
+  vector< PseudoJet > &ghostList = *fGhostList;
+  vector< PseudoJet > outputList, areaJets;
+  vector< PseudoJet >::const_iterator itInputList;
+  Double_t record[4];
+  vector< vector< Int_t > > &jetGhosts = fJetGhosts, *exportGhosts;
   vector< TEstimatorStruct >::iterator itEstimators;
+  vector< TDefinitionStruct >::iterator itDefinitions;
 
   DelphesFactory *factory = GetFactory();
 
   inputList.clear();
+  ghostList.clear();
+  nInputs = fInputArray->GetEntriesFast();
+  number = nInputs;
+  if(fItGhostAssociatedInputArray && !fGhostAssociationGrid) number += fGhostAssociatedInputArray->GetEntriesFast();
+  inputList.reserve(number);
 
-  // loop over input objects
+  for(itCells = fSoftCellsUsed.begin(); itCells != fSoftCellsUsed.end(); ++itCells) fSoftCellMembers[*itCells].clear();
+  fSoftCellsUsed.clear();
+
+  ptMin2 = fConstituentPTMin*fConstituentPTMin;
+
+  // loop over input objects, the four-momenta are read in place and
+  // rapidity and phi are only computed when the clustering asks for them
   fItInputArray->Reset();
-  number = 0;
+  number = -1;
   while((candidate = static_cast<Candidate*>(fItInputArray->Next())))
   {
-    momentum = candidate->Momentum;
-    jet = PseudoJet(momentum.Px(), momentum.Py(), momentum.Pz(), momentum.E());
-    jet.set_user_index(number);
-    inputList.push_back(jet);
     ++number;
+    const TLorentzVector &candidateMomentum = candidate->Momentum;
+    if(fConstituentEtaMax > 0.0 && TMath::Abs(candidateMomentum.Eta()) > fConstituentEtaMax) continue;
+
+    pseudoJet.reset(candidateMomentum.Px(), candidateMomentum.Py(), candidateMomentum.Pz(), candidateMomentum.E());
+
+    if(candidateMomentum.Perp2() < ptMin2)
+    {
+      if(!fSoftGrid) continue;
+
+      // soft inputs inside the grid are summed per cell
+      cell = fSoftGrid->tile_index(pseudoJet);
+      if(cell >= 0)
+      {
+        if(fSoftCellMembers[cell].empty())
+        {
+          fSoftCellsUsed.push_back(cell);
+          (*fSoftCellMomenta)[cell] = pseudoJet;
+        }
+        else
+        {
+          (*fSoftCellMomenta)[cell] += pseudoJet;
+        }
+        fSoftCellMembers[cell].push_back(number);
+        continue;
+      }
+    }
+
+    inputList.push_back(pseudoJet);
+    inputList.back().set_user_index(number);
   }
+
+  // one input per occupied cell
+  for(itCells = fSoftCellsUsed.begin(); itCells != fSoftCellsUsed.end(); ++itCells)
+  {
+    inputList.push_back((*fSoftCellMomenta)[*itCells]);
+    inputList.back().set_user_index(nInputs + *itCells);
+  }
+
   // add ghost associated objects
   if (fItGhostAssociatedInputArray) {
     fItGhostAssociatedInputArray->Reset();
@@ -329,13 +1062,29 @@ void FastJetFinder::Process()
       // set momentum total and mass to 10 eV
       momentum *= 10e-6 / momentum.Vect().Mag();
       double energy = std::hypot(10e-6, momentum.Vect().Mag());
-      jet = PseudoJet(momentum.Px(), momentum.Py(), momentum.Pz(), energy);
-      jet.set_user_index(number);
-      inputList.push_back(jet);
+      vector< PseudoJet > &targetList = fGhostAssociationGrid ? ghostList : inputList;
+      targetList.push_back(PseudoJet(momentum.Px(), momentum.Py(), momentum.Pz(), energy));
+      targetList.back().set_user_index(number);
       --number;
     }
   }
 
+  if(fInputDumpFile)
+  {
+    number = inputList.size();
+    fwrite(&number, sizeof(Int_t), 1, fInputDumpFile);
+    for(itInputList = inputList.begin(); itInputList != inputList.end(); ++itInputList)
+    {
+      record[0] = itInputList->px();
+      record[1] = itInputList->py();
+      record[2] = itInputList->pz();
+      record[3] = itInputList->E();
+      fwrite(record, sizeof(Double_t), 4, fInputDumpFile);
+    }
+  }
+
+  if(fCalibrationEvent < fCalibrationEvents) CalibrateStrategy(inputList);
+
   // construct jets
   if(fAreaDefinition)
   {
@@ -343,16 +1092,24 @@ void FastJetFinder::Process()
   }
   else
   {
-    sequence = new ClusterSequence(inputList, *fDefinition);
+    // reuse the storage of the previous event
+    fSequence->reset(inputList, *fDefinition);
+    sequence = fSequence;
   }
 
-  // compute rho and store it
+  // compute rho and store it, every eta range takes the medians over
+  // the jets of the event rather than clustering it once more
   if(fComputeRho && fAreaDefinition)
   {
+    areaJets = sequence->inclusive_jets_sorted_by_pt(0.0);
     for(itEstimators = fEstimators.begin(); itEstimators != fEstimators.end(); ++itEstimators)
     {
-      itEstimators->estimator->set_particles(inputList);
-      rho = itEstimators->estimator->rho();
+      rho = 0.0;
+      if(!areaJets.empty())
+      {
+        itEstimators->estimator->set_jets(areaJets);
+        rho = itEstimators->estimator->rho();
+      }
 
       candidate = factory->NewCandidate();
       candidate->Momentum.SetPtEtaPhiE(rho, 0.0, 0.0, rho);
@@ -363,8 +1120,128 @@ void FastJetFinder::Process()
   }
 
   outputList.clear();
-  outputList = sorted_by_pt(sequence->inclusive_jets(fJetPTMin));
+  outputList = sequence->inclusive_jets_sorted_by_pt(fJetPTMin);
+
+  exportGhosts = fGhostAssociationGrid ? &jetGhosts : 0;
+  if(exportGhosts) GhostAssociator(*sequence, ghostList).Associate(outputList, jetGhosts);
+
+  ExportJets(*sequence, outputList, fJetAlgorithm, fOutputArray, exportGhosts);
+
+  // extra definitions over the same inputs
+  clusteredCambridge = kFALSE;
+  for(itDefinitions = fExtraDefinitions.begin(); itDefinitions != fExtraDefinitions.end(); ++itDefinitions)
+  {
+    extraSequence = 0;
+    if(itDefinitions->useMainSequence)
+    {
+      extraSequence = sequence;
+    }
+    else if(itDefinitions->dcut > 0.0)
+    {
+      if(!clusteredCambridge) fCambridgeSequence->reset(inputList, *fCambridgeDefinition);
+      clusteredCambridge = kTRUE;
+      extraSequence = fCambridgeSequence;
+    }
+    else if(fAreaDefinition)
+    {
+      extraSequence = new ClusterSequenceArea(inputList, *itDefinitions->definition, *fAreaDefinition);
+    }
+    else
+    {
+      itDefinitions->sequence->reset(inputList, *itDefinitions->definition);
+      extraSequence = itDefinitions->sequence;
+    }
+
+    if(itDefinitions->dcut > 0.0)
+    {
+      // C/A inclusive jets with a smaller R are the exclusive jets of a
+      // larger R history cut at dcut = (R/R0)^2
+      outputList = sorted_by_pt(SelectorPtMin(fJetPTMin)(extraSequence->exclusive_jets(itDefinitions->dcut)));
+    }
+    else
+    {
+      outputList = extraSequence->inclusive_jets_sorted_by_pt(fJetPTMin);
+    }
+
+    if(exportGhosts) GhostAssociator(*extraSequence, ghostList).Associate(outputList, jetGhosts);
+
+    ExportJets(*extraSequence, outputList, itDefinitions->algorithm, itDefinitions->outputArray, exportGhosts);
 
+    if(fAreaDefinition && extraSequence != sequence) delete extraSequence;
+  }
+
+  if(fAreaDefinition) delete sequence;
+}
+
+//------------------------------------------------------------------------------
+
+void FastJetFinder::CalibrateStrategy(const vector< PseudoJet > &inputList)
+{
+  ClusterSequence *sequence;
+  chrono::steady_clock::time_point start;
+  size_t i, best;
+  Strategy strategy;
+
+  // all candidates give the same jets, only the time is kept
+  for(i = 0; i < fCalibrationDefinitions.size(); ++i)
+  {
+    start = chrono::steady_clock::now();
+    if(fAreaDefinition)
+    {
+      sequence = new ClusterSequenceArea(inputList, *fCalibrationDefinitions[i], *fAreaDefinition);
+      delete sequence;
+    }
+    else
+    {
+      fSequence->reset(inputList, *fCalibrationDefinitions[i]);
+    }
+    fCalibrationTimes[i] += chrono::duration< Double_t >(chrono::steady_clock::now() - start).count();
+  }
+
+  ++fCalibrationEvent;
+  if(fCalibrationEvent < fCalibrationEvents) return;
+
+  // lock in the fastest strategy for the rest of the run
+  best = min_element(fCalibrationTimes.begin(), fCalibrationTimes.end()) - fCalibrationTimes.begin();
+  strategy = fCalibrationDefinitions[best]->strategy();
+
+  delete fDefinition;
+  fDefinition = NewStrategyDefinition(fCalibrationDefinitions[best]->jet_algorithm(), fParameterR, static_cast<JetDefinition::Recombiner*>(fRecomb), strategy);
+  fStrategy = strategy;
+
+  cout << "** INFO: " << GetName() << " uses the " << ClusterSequence().strategy_string(strategy);
+  cout << " clustering strategy after " << fCalibrationEvents << " calibration events" << endl;
+}
+
+//------------------------------------------------------------------------------
+
+void FastJetFinder::ExportJets(const ClusterSequence &sequence, const vector< PseudoJet > &outputList, Int_t algorithm, TObjArray *outputArray,
+  const vector< vector< Int_t > > *jetGhosts)
+{
+  Candidate *candidate, *constituent;
+  TLorentzVector momentum;
+
+  Double_t deta, dphi, detaMax, dphiMax;
+  Double_t time, timeWeight;
+  PseudoJet jet, area, constituentJet;
+  vector< PseudoJet > inputList;
+  vector< PseudoJet >::iterator itInputList;
+  vector< PseudoJet >::const_iterator itOutputList;
+  vector< Int_t >::const_iterator itGhosts, itMembers;
+  vector< Int_t > single(1), constituents;
+  const vector< Int_t > *members;
+  Int_t index, nInputs;
+  TSubstructureJob job;
+  vector< TSubstructureJob > jobs;
+  size_t worker, nWorkers;
+  vector< thread > workers;
+  vector< thread >::iterator itWorkers;
+
+  Bool_t computeSubstructure = fComputeTrimming || fComputePruning || fComputeSoftDrop || fComputeNsubjettiness;
+
+  DelphesFactory *factory = GetFactory();
+
+  nInputs = fInputArray->GetEntriesFast();
 
   // loop over all jets and export them
   detaMax = 0.0;
@@ -372,7 +1249,7 @@ void FastJetFinder::Process()
   for(itOutputList = outputList.begin(); itOutputList != outputList.end(); ++itOutputList)
   {
     jet = *itOutputList;
-    if(fJetAlgorithm == 7) jet = join(jet.constituents());
+    if(algorithm == 7) jet = join(jet.constituents());
 
     momentum.SetPxPyPzE(jet.px(), jet.py(), jet.pz(), jet.E());
 
@@ -385,29 +1262,49 @@ void FastJetFinder::Process()
     timeWeight = 0.0;
 
     inputList.clear();
-    inputList = sequence->constituents(*itOutputList);
+    inputList = sequence.constituents(*itOutputList);
 
+    constituents.clear();
     for(itInputList = inputList.begin(); itInputList != inputList.end(); ++itInputList)
     {
-      if(itInputList->user_index() >= 0) {;
-	constituent = static_cast<Candidate*>(fInputArray->At(itInputList->user_index()));
-	deta = TMath::Abs(momentum.Eta() - constituent->Momentum.Eta());
-	dphi = TMath::Abs(momentum.DeltaPhi(constituent->Momentum));
-	if(deta > detaMax) detaMax = deta;
-	if(dphi > dphiMax) dphiMax = dphi;
-
-	time += TMath::Sqrt(constituent->Momentum.E()) *
-	  (constituent->Position.T());
-	timeWeight += TMath::Sqrt(constituent->Momentum.E());
-	candidate->AddCandidate(constituent);
+      if(itInputList->user_index() >= 0) {
+	// a soft grid cell stands for all the candidates summed into it
+	index = itInputList->user_index();
+	single[0] = index;
+	members = index < nInputs ? &single : &fSoftCellMembers[index - nInputs];
+
+	for(itMembers = members->begin(); itMembers != members->end(); ++itMembers)
+	{
+	  constituent = static_cast<Candidate*>(fInputArray->At(*itMembers));
+	  deta = TMath::Abs(momentum.Eta() - constituent->Momentum.Eta());
+	  dphi = TMath::Abs(momentum.DeltaPhi(constituent->Momentum));
+	  if(deta > detaMax) detaMax = deta;
+	  if(dphi > dphiMax) dphiMax = dphi;
+
+	  time += TMath::Sqrt(constituent->Momentum.E()) *
+	    (constituent->Position.T());
+	  timeWeight += TMath::Sqrt(constituent->Momentum.E());
+	  constituents.push_back(*itMembers);
+	}
       } else {
 	int ghost_index = -itInputList->user_index() - 1;
 	constituent = static_cast<Candidate*>(
 	  fGhostAssociatedInputArray->At(ghost_index));
 	candidate->AddSubjet(constituent);
       }
+    }
 
+    // the constituents are kept as indices into the input array
+    if(!constituents.empty()) candidate->SetCandidates(fInputArray, &constituents[0], constituents.size());
 
+    // ghosts attached to this jet after the clustering
+    if(jetGhosts)
+    {
+      const vector< Int_t > &ghosts = (*jetGhosts)[itOutputList - outputList.begin()];
+      for(itGhosts = ghosts.begin(); itGhosts != ghosts.end(); ++itGhosts)
+      {
+        candidate->AddSubjet(static_cast<Candidate*>(fGhostAssociatedInputArray->At(*itGhosts)));
+      }
     }
 
     candidate->Momentum = momentum;
@@ -417,125 +1314,171 @@ void FastJetFinder::Process()
     candidate->DeltaEta = detaMax;
     candidate->DeltaPhi = dphiMax;
 
-    //------------------------------------
-    // Trimming
-    //------------------------------------
+    outputArray->Add(candidate);
+
+    if(!computeSubstructure) continue;
+
+    if(fNThreads <= 1)
+    {
+      ComputeSubstructure(candidate, *itOutputList, fSubstructureTools[0]);
+    }
+    else
+    {
+      // the workers must not touch the shared cluster sequence, so they
+      // get a copy of the constituents with no structure attached
+      job.candidate = candidate;
+      job.constituents.clear();
+      for(itInputList = inputList.begin(); itInputList != inputList.end(); ++itInputList)
+      {
+        constituentJet = PseudoJet(itInputList->px(), itInputList->py(), itInputList->pz(), itInputList->E());
+        constituentJet.set_user_index(itInputList->user_index());
+        job.constituents.push_back(constituentJet);
+      }
+      jobs.push_back(job);
+    }
+  }
 
-     if(fComputeTrimming)
+  // each worker takes every Nth jet with its own tools, the results go
+  // straight to the candidates so the output order is unchanged
+  nWorkers = min(fSubstructureTools.size(), jobs.size());
+  if(nWorkers == 1)
+  {
+    ComputeSubstructureJobs(&jobs, 0, 1, &fSubstructureTools[0]);
+  }
+  else if(nWorkers > 1)
+  {
+    for(worker = 0; worker < nWorkers; ++worker)
     {
+      workers.push_back(thread(&FastJetFinder::ComputeSubstructureJobs, this, &jobs, worker, nWorkers, &fSubstructureTools[worker]));
+    }
+    for(itWorkers = workers.begin(); itWorkers != workers.end(); ++itWorkers) itWorkers->join();
+  }
+}
 
-      fastjet::Filter    trimmer(fastjet::JetDefinition(fastjet::kt_algorithm,fRTrim),fastjet::SelectorPtFractionMin(fPtFracTrim));
-      fastjet::PseudoJet trimmed_jet = trimmer(*itOutputList);
-      
-      trimmed_jet = join(trimmed_jet.constituents());
-     
-      candidate->TrimmedP4[0].SetPtEtaPhiM(trimmed_jet.pt(), trimmed_jet.eta(), trimmed_jet.phi(), trimmed_jet.m());
-        
-      // four hardest subjets 
-      subjets.clear();
-      subjets = trimmed_jet.pieces();
-      subjets = sorted_by_pt(subjets);
+//------------------------------------------------------------------------------
+
+void FastJetFinder::ComputeSubstructureJobs(vector< TSubstructureJob > *jobs, size_t first, size_t step, const TSubstructureTools *tools) const
+{
+  size_t i;
+  vector< PseudoJet > jets;
+
+  for(i = first; i < jobs->size(); i += step)
+  {
+    // C/A with the largest R gives back a single jet with a clustering
+    // history of its own
+    ClusterSequence sequence(jobs->at(i).constituents, *fReclusterDefinition);
+    jets = sequence.inclusive_jets();
+    if(jets.empty()) continue;
+    ComputeSubstructure(jobs->at(i).candidate, jets.front(), *tools);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void FastJetFinder::ComputeSubstructure(Candidate *candidate, const PseudoJet &jet, const TSubstructureTools &tools) const
+{
+  vector< PseudoJet > subjets;
+  vector< double > taus;
+  PseudoJet softDropTree, softdrop_jet;
+  CandidateSubstructure *substructure = 0;
+  size_t n;
+
+  if(fComputeTrimming || fComputePruning || fComputeSoftDrop || fComputeNsubjettiness) substructure = candidate->NewSubstructure();
+
+  //------------------------------------
+  // Trimming
+  //------------------------------------
+
+  if(fComputeTrimming)
+  {
+
+    fastjet::PseudoJet trimmed_jet = (*tools.trimmer)(jet);
+    
+    trimmed_jet = join(trimmed_jet.constituents());
+   
+    substructure->TrimmedP4[0].SetPtEtaPhiM(trimmed_jet.pt(), trimmed_jet.eta(), trimmed_jet.phi(), trimmed_jet.m());
       
-      candidate->NSubJetsTrimmed = subjets.size();
+    // four hardest subjets 
+    subjets.clear();
+    subjets = trimmed_jet.pieces();
+    subjets = sorted_by_pt(subjets);
+    
+    substructure->NSubJetsTrimmed = subjets.size();
 
-      for (size_t i = 0; i < subjets.size() and i < 4; i++){
+    for (size_t i = 0; i < subjets.size() and i < 4; i++){
 	if(subjets.at(i).pt() < 0) continue ; 
- 	candidate->TrimmedP4[i+1].SetPtEtaPhiM(subjets.at(i).pt(), subjets.at(i).eta(), subjets.at(i).phi(), subjets.at(i).m());
-      }
+ 	substructure->TrimmedP4[i+1].SetPtEtaPhiM(subjets.at(i).pt(), subjets.at(i).eta(), subjets.at(i).phi(), subjets.at(i).m());
     }
-    
-    
-    //------------------------------------
-    // Pruning
-    //------------------------------------
-    
-    
-    if(fComputePruning)
-    {
+  }
+  
+  
+  //------------------------------------
+  // Pruning
+  //------------------------------------
+  
+  
+  if(fComputePruning)
+  {
 
-      fastjet::Pruner    pruner(fastjet::JetDefinition(fastjet::cambridge_algorithm,fRPrun),fZcutPrun,fRcutPrun);
-      fastjet::PseudoJet pruned_jet = pruner(*itOutputList);
+    fastjet::PseudoJet pruned_jet = (*tools.pruner)(jet);
 
-      candidate->PrunedP4[0].SetPtEtaPhiM(pruned_jet.pt(), pruned_jet.eta(), pruned_jet.phi(), pruned_jet.m());
-         
-      // four hardest subjet 
-      subjets.clear();
-      subjets = pruned_jet.pieces();
-      subjets = sorted_by_pt(subjets);
-      
-      candidate->NSubJetsPruned = subjets.size();
+    substructure->PrunedP4[0].SetPtEtaPhiM(pruned_jet.pt(), pruned_jet.eta(), pruned_jet.phi(), pruned_jet.m());
+       
+    // four hardest subjet 
+    subjets.clear();
+    subjets = pruned_jet.pieces();
+    subjets = sorted_by_pt(subjets);
+    
+    substructure->NSubJetsPruned = subjets.size();
 
-      for (size_t i = 0; i < subjets.size() and i < 4; i++){
+    for (size_t i = 0; i < subjets.size() and i < 4; i++){
 	if(subjets.at(i).pt() < 0) continue ; 
-  	candidate->PrunedP4[i+1].SetPtEtaPhiM(subjets.at(i).pt(), subjets.at(i).eta(), subjets.at(i).phi(), subjets.at(i).m());
-      }
+  	substructure->PrunedP4[i+1].SetPtEtaPhiM(subjets.at(i).pt(), subjets.at(i).eta(), subjets.at(i).phi(), subjets.at(i).m());
+    }
 
-    } 
-     
-    //------------------------------------
-    // SoftDrop
-    //------------------------------------
+  } 
+   
+  //------------------------------------
+  // SoftDrop
+  //------------------------------------
    
-    if(fComputeSoftDrop)
+  if(fComputeSoftDrop)
+  {
+    // build the C/A declustering tree once and walk it for every working point
+
+    softDropTree = (*tools.softDropRecluster)(jet);
+
+    for(n = 0; n < tools.softDrops.size(); ++n)
     {
-    
-      contrib::SoftDrop  softDrop(fBetaSoftDrop,fSymmetryCutSoftDrop,fR0SoftDrop);
-      fastjet::PseudoJet softdrop_jet = softDrop(*itOutputList);
-      
-      candidate->SoftDroppedP4[0].SetPtEtaPhiM(softdrop_jet.pt(), softdrop_jet.eta(), softdrop_jet.phi(), softdrop_jet.m());
-        
-      // four hardest subjet 
-      
+      softdrop_jet = (*tools.softDrops[n])(softDropTree);
+
+      substructure->SoftDroppedPointsP4.push_back(TLorentzVector());
+      substructure->SoftDroppedPointsP4.back().SetPtEtaPhiM(softdrop_jet.pt(), softdrop_jet.eta(), softdrop_jet.phi(), softdrop_jet.m());
+      substructure->NSubJetsSoftDroppedPoints.push_back(softdrop_jet.pieces().size());
+
+      if(n > 0) continue;
+
+      substructure->SoftDroppedP4[0] = substructure->SoftDroppedPointsP4.back();
+
+      // four hardest subjet
+
       subjets.clear();
       subjets    = softdrop_jet.pieces();
       subjets    = sorted_by_pt(subjets);
-      candidate->NSubJetsSoftDropped = softdrop_jet.pieces().size();
+      substructure->NSubJetsSoftDropped = softdrop_jet.pieces().size();
 
       for (size_t i = 0; i < subjets.size()  and i < 4; i++){
 	if(subjets.at(i).pt() < 0) continue ; 
-  	candidate->SoftDroppedP4[i+1].SetPtEtaPhiM(subjets.at(i).pt(), subjets.at(i).eta(), subjets.at(i).phi(), subjets.at(i).m());
+  	substructure->SoftDroppedP4[i+1].SetPtEtaPhiM(subjets.at(i).pt(), subjets.at(i).eta(), subjets.at(i).phi(), subjets.at(i).m());
       }
     }
+  }
   
-    // --- compute N-subjettiness with N = 1,2,3,4,5 ----
-
-    if(fComputeNsubjettiness)
-    {
-      Njettiness::AxesMode axisMode;
+  // --- compute N-subjettiness with N = 1,2,3,4,5 from one axes search ----
 
-      switch(fAxisMode)
-      {
-        default:
-        case 1:
-          axisMode = Njettiness::wta_kt_axes;
-          break;
-        case 2:
-          axisMode = Njettiness::onepass_wta_kt_axes;
-          break;
-        case 3:
-          axisMode = Njettiness::kt_axes;
-          break;
-        case 4:
-          axisMode = Njettiness::onepass_kt_axes;
-          break;
-      }
-
-      Njettiness::MeasureMode measureMode = Njettiness::unnormalized_measure;
-
-      Nsubjettiness nSub1(1, axisMode, measureMode, fBeta);
-      Nsubjettiness nSub2(2, axisMode, measureMode, fBeta);
-      Nsubjettiness nSub3(3, axisMode, measureMode, fBeta);
-      Nsubjettiness nSub4(4, axisMode, measureMode, fBeta);
-      Nsubjettiness nSub5(5, axisMode, measureMode, fBeta);
-
-      candidate->Tau[0] = nSub1(*itOutputList);
-      candidate->Tau[1] = nSub2(*itOutputList);
-      candidate->Tau[2] = nSub3(*itOutputList);
-      candidate->Tau[3] = nSub4(*itOutputList);
-      candidate->Tau[4] = nSub5(*itOutputList);
-    }
-
-    fOutputArray->Add(candidate);
+  if(fComputeNsubjettiness)
+  {
+    taus = tools.nSubjettiness->result(jet);
+    for(n = 0; n < 5; ++n) substructure->Tau[n] = taus[n];
   }
-  delete sequence;
 }
@@ -30,16 +30,26 @@
 #include "classes/DelphesModule.h"
 
 #include <vector>
+#include <stdio.h>
 
 class TObjArray;
 class TIterator;
+class Candidate;
 
 namespace fastjet {
   class JetDefinition;
+  class ClusterSequence;
+  class PseudoJet;
+  class Filter;
+  class Pruner;
   class AreaDefinition;
   class JetMedianBackgroundEstimator;
+  class RectangularGrid;
   namespace contrib {
     class NjettinessPlugin;
+    class NsubjettinessSet;
+    class SoftDrop;
+    class Recluster;
   }
 }
 
@@ -54,6 +64,8 @@ public:
   void Process();
   void Finish();
 
+  Bool_t IsThreadSafe() const;
+
 private:
 
   void *fPlugin; //!
@@ -61,10 +73,44 @@ private:
   fastjet::contrib::NjettinessPlugin *fNjettinessPlugin; //!
 
   fastjet::JetDefinition *fDefinition; //!
+  fastjet::JetDefinition *fCambridgeDefinition; //! shared C/A history for ExtraJetDefinitions
+
+  // reclustered every event when there are no areas
+  fastjet::ClusterSequence *fSequence; //!
+  fastjet::ClusterSequence *fCambridgeSequence; //!
+
+  // input PseudoJets, the storage is kept between events
+  std::vector< fastjet::PseudoJet > *fInputList; //!
+
+  // ghost-associated inputs and the ghosts found in each jet, also kept
+  std::vector< fastjet::PseudoJet > *fGhostList; //!
+  std::vector< std::vector< Int_t > > fJetGhosts; //!
+
+  // if InputDumpFile is set, every event writes the number of inputs as an
+  // Int_t followed by px, py, pz, E of each input as Double_t, in native byte
+  // order, for examples/JetClusteringBenchmark
+  FILE *fInputDumpFile; //!
+
+  // C/A with the largest R, reclusters jet constituents for the substructure workers
+  fastjet::JetDefinition *fReclusterDefinition; //!
 
   Int_t fJetAlgorithm;
   Double_t fParameterR;
   Double_t fJetPTMin;
+
+  // inputs below ConstituentPTMin are dropped, or summed into SoftGridSize
+  // cells if it is positive, and inputs beyond ConstituentEtaMax are dropped
+  Double_t fConstituentPTMin;
+  Double_t fConstituentEtaMax;
+  Double_t fSoftGridSize;
+  fastjet::RectangularGrid *fSoftGrid; //!
+
+  // candidate indices and summed momenta of the soft grid cells, a cell is
+  // clustered with the user index fInputArray->GetEntriesFast() + cell
+  std::vector< std::vector< Int_t > > fSoftCellMembers; //!
+  std::vector< fastjet::PseudoJet > *fSoftCellMomenta; //!
+  std::vector< Int_t > fSoftCellsUsed; //!
+
   Double_t fConeRadius;
   Double_t fSeedThreshold;
   Double_t fConeAreaFraction;
@@ -74,6 +120,23 @@ private:
   Int_t fAdjacencyCut;
   Double_t fOverlapThreshold;
 
+  Double_t fSISConeCellSize;
+  Int_t fSISConeThreads;
+
+  Int_t fNThreads;
+
+  // fastjet::Strategy of the native algorithms; with StrategyCalibrationEvents
+  // the candidates are timed on the first events and the fastest one is kept
+  Int_t fStrategy;
+  Int_t fCalibrationEvents;
+  Int_t fCalibrationEvent;
+  std::vector< fastjet::JetDefinition * > fCalibrationDefinitions; //!
+  std::vector< Double_t > fCalibrationTimes; //!
+
+  // attach the ghost associated objects to the anti-kt jets after the
+  // clustering instead of clustering them with the inputs
+  Bool_t fGhostAssociationGrid;
+
   //-- N (sub)jettiness parameters --
 
   Bool_t fComputeNsubjettiness;
@@ -98,8 +161,8 @@ private:
   //-- SoftDrop parameters --
 
   Bool_t fComputeSoftDrop;
-  Double_t fBetaSoftDrop;
-  Double_t fSymmetryCutSoftDrop;
+  std::vector< Double_t > fBetaSoftDrop; // one entry per working point
+  std::vector< Double_t > fSymmetryCutSoftDrop;
   Double_t fR0SoftDrop;
 
   // --- FastJet Area method --------
@@ -115,6 +178,7 @@ private:
   Double_t fGridScatter;
   Double_t fPtScatter;
   Double_t fMeanGhostPt;
+  Bool_t fCacheGhosts;
 
   // -- voronoi areas --
   Double_t fEffectiveRfact;
@@ -127,6 +191,42 @@ private:
   };
 
   std::vector< TEstimatorStruct > fEstimators; //!
+
+  struct TDefinitionStruct
+  {
+    fastjet::JetDefinition *definition; // zero if the jets come from a shared sequence
+    fastjet::ClusterSequence *sequence; // reused for own clustering without areas
+    Int_t algorithm;
+    Double_t parameterR;
+    Double_t dcut; // if positive, take exclusive jets from a C/A history at this dcut
+    Bool_t useMainSequence;
+    TObjArray *outputArray;
+  };
+
+  std::vector< TDefinitionStruct > fExtraDefinitions; //!
+
+  // each thread needs its own tools, Njettiness keeps state between calls
+  struct TSubstructureTools
+  {
+    fastjet::Filter *trimmer;
+    fastjet::Pruner *pruner;
+    fastjet::contrib::Recluster *softDropRecluster; // C/A tree shared by all working points
+    std::vector< fastjet::contrib::SoftDrop * > softDrops;
+    fastjet::contrib::NsubjettinessSet *nSubjettiness;
+  };
+
+  std::vector< TSubstructureTools > fSubstructureTools; //!
+
+  // a jet for the substructure workers, defined in the source file
+  struct TSubstructureJob;
+
+  void ComputeSubstructure(Candidate *candidate, const fastjet::PseudoJet &jet, const TSubstructureTools &tools) const;
+  void ComputeSubstructureJobs(std::vector< TSubstructureJob > *jobs, size_t first, size_t step, const TSubstructureTools *tools) const;
+
+  void CalibrateStrategy(const std::vector< fastjet::PseudoJet > &inputList);
+
+  void ExportJets(const fastjet::ClusterSequence &sequence, const std::vector< fastjet::PseudoJet > &jets, Int_t algorithm, TObjArray *outputArray,
+    const std::vector< std::vector< Int_t > > *jetGhosts);
 #endif
 
   TIterator *fItInputArray; //!
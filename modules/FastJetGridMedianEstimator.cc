@@ -21,6 +21,11 @@
  *
  *  Computes median energy density per event using a fixed grid.
  *
+ *  All rapidity ranges are filled in a single pass over the input:
+ *  the tile sums of every grid live in one contiguous array and the
+ *  median is taken with a partial sort. The result is the same as
+ *  fastjet::GridMedianBackgroundEstimator::rho().
+ *
  *  \author M. Selvaggi - UCL, Louvain-la-Neuve
  *
  */
@@ -51,28 +56,33 @@
 #include <utility>
 
 #include "fastjet/PseudoJet.hh"
-#include "fastjet/JetDefinition.hh"
-#include "fastjet/ClusterSequence.hh"
-#include "fastjet/Selector.hh"
-#include "fastjet/RectangularGrid.hh"
-#include "fastjet/ClusterSequenceArea.hh"
-#include "fastjet/tools/JetMedianBackgroundEstimator.hh"
 
-#include "fastjet/tools/GridMedianBackgroundEstimator.hh"
+using namespace std;
+using namespace fastjet;
 
-#include "fastjet/plugins/SISCone/fastjet/SISConePlugin.hh"
-#include "fastjet/plugins/CDFCones/fastjet/CDFMidPointPlugin.hh"
-#include "fastjet/plugins/CDFCones/fastjet/CDFJetCluPlugin.hh"
+//------------------------------------------------------------------------------
 
-#include "fastjet/contribs/Nsubjettiness/Nsubjettiness.hh"
-#include "fastjet/contribs/Nsubjettiness/Njettiness.hh"
-#include "fastjet/contribs/Nsubjettiness/NjettinessPlugin.hh"
-#include "fastjet/contribs/Nsubjettiness/WinnerTakeAllRecombiner.hh"
+// median of [first, last) as defined by BackgroundEstimatorBase::_percentile:
+// average of the two central values for an even number of tiles
 
-using namespace std;
-using namespace fastjet;
-using namespace fastjet::contrib;
+static Double_t TileMedian(vector< Double_t >::iterator first, vector< Double_t >::iterator last)
+{
+  vector< Double_t >::iterator middle;
+  Long_t size = last - first;
+  Double_t lower, upper;
+
+  if(size == 0) return 0.0;
+  if(size == 1) return *first;
 
+  middle = first + (size - 1)/2;
+  nth_element(first, middle, last);
+  lower = *middle;
+
+  if(size % 2 == 1) return lower;
+
+  upper = *min_element(middle + 1, last);
+  return lower*0.5 + upper*0.5;
+}
 
 //------------------------------------------------------------------------------
 
@@ -95,23 +105,44 @@ void FastJetGridMedianEstimator::Init()
 {
   ExRootConfParam param;
   Long_t i, size;
-  Double_t drap, dphi, rapMin, rapMax;
+  Double_t drap, dphi;
+  TGridStruct grid;
 
-  // read rapidity ranges
+  // read rapidity ranges, same tiling as fastjet::RectangularGrid
 
   param = GetParam("GridRange");
   size = param.GetSize();
 
-  fEstimators.clear();
+  fGrids.clear();
+  grid.offset = 0;
   for(i = 0; i < size/4; ++i)
   {
-    rapMin = param[i*4].GetDouble();
-    rapMax = param[i*4 + 1].GetDouble();
+    grid.rapMin = param[i*4].GetDouble();
+    grid.rapMax = param[i*4 + 1].GetDouble();
     drap = param[i*4 + 2].GetDouble();
     dphi = param[i*4 + 3].GetDouble();
-    fEstimators.push_back(new GridMedianBackgroundEstimator(rapMin, rapMax, drap, dphi));
+
+    if(grid.rapMax <= grid.rapMin || drap <= 0.0 || dphi <= 0.0)
+    {
+      throw runtime_error("invalid GridRange, expected rapmin < rapmax and positive cell sizes");
+    }
+
+    grid.nRap = max(Int_t((grid.rapMax - grid.rapMin)/drap + 0.5), 1);
+    grid.nPhi = Int_t(twopi/dphi + 0.5);
+    if(grid.nPhi < 1)
+    {
+      throw runtime_error("invalid GridRange, dphi is larger than 4*pi");
+    }
+    grid.inverseDRap = grid.nRap/(grid.rapMax - grid.rapMin);
+    grid.inverseDPhi = grid.nPhi/twopi;
+    grid.tileArea = (grid.rapMax - grid.rapMin)/grid.nRap * (twopi/grid.nPhi);
+
+    fGrids.push_back(grid);
+    grid.offset += grid.nRap*grid.nPhi;
   }
 
+  fTilePt.assign(grid.offset, 0.0);
+
   // import input array
 
   fInputArray = ImportArray(GetString("InputArray", "Calorimeter/towers"));
@@ -124,13 +155,6 @@ void FastJetGridMedianEstimator::Init()
 
 void FastJetGridMedianEstimator::Finish()
 {
-  vector< GridMedianBackgroundEstimator * >::iterator itEstimators;
-
-  for(itEstimators = fEstimators.begin(); itEstimators != fEstimators.end(); ++itEstimators)
-  {
-    if(*itEstimators) delete *itEstimators;
-  }
-
   if(fItInputArray) delete fItInputArray;
 }
 
@@ -139,42 +163,50 @@ void FastJetGridMedianEstimator::Finish()
 void FastJetGridMedianEstimator::Process()
 {
   Candidate *candidate;
-  TLorentzVector momentum;
-  Int_t number;
-  Double_t rho = 0;
+  Double_t rho, pt, rap, phi, rapMinusMin;
+  Int_t iRap, iPhi;
   PseudoJet jet;
-  vector< PseudoJet > inputList, outputList;
 
-  vector< GridMedianBackgroundEstimator * >::iterator itEstimators;;
+  vector< TGridStruct >::const_iterator itGrids;
 
   DelphesFactory *factory = GetFactory();
 
-  inputList.clear();
+  fill(fTilePt.begin(), fTilePt.end(), 0.0);
+
+  // loop over input objects once and add their pt to every grid
 
-  // loop over input objects
   fItInputArray->Reset();
-  number = 0;
   while((candidate = static_cast<Candidate*>(fItInputArray->Next())))
   {
-    momentum = candidate->Momentum;
-    jet = PseudoJet(momentum.Px(), momentum.Py(), momentum.Pz(), momentum.E());
-    jet.set_user_index(number);
-    inputList.push_back(jet);
-    ++number;
+    const TLorentzVector &momentum = candidate->Momentum;
+    jet.reset_momentum(momentum.Px(), momentum.Py(), momentum.Pz(), momentum.E());
+    pt = jet.pt();
+    rap = jet.rap();
+    phi = jet.phi();
+
+    for(itGrids = fGrids.begin(); itGrids != fGrids.end(); ++itGrids)
+    {
+      rapMinusMin = rap - itGrids->rapMin;
+      if(rapMinusMin < 0.0) continue;
+      iRap = Int_t(rapMinusMin * itGrids->inverseDRap);
+      if(iRap >= itGrids->nRap) continue;
+      iPhi = Int_t(phi * itGrids->inverseDPhi);
+      if(iPhi == itGrids->nPhi) iPhi = 0;
+      fTilePt[itGrids->offset + iRap*itGrids->nPhi + iPhi] += pt;
+    }
   }
 
   // compute rho and store it
 
-  for(itEstimators = fEstimators.begin(); itEstimators != fEstimators.end(); ++itEstimators)
+  for(itGrids = fGrids.begin(); itGrids != fGrids.end(); ++itGrids)
   {
-    (*itEstimators)->set_particles(inputList);
-
-    rho = (*itEstimators)->rho();
+    rho = TileMedian(fTilePt.begin() + itGrids->offset,
+      fTilePt.begin() + itGrids->offset + itGrids->nRap*itGrids->nPhi) / itGrids->tileArea;
 
     candidate = factory->NewCandidate();
     candidate->Momentum.SetPtEtaPhiE(rho, 0.0, 0.0, rho);
-    candidate->Edges[0] = (*itEstimators)->rapmin();
-    candidate->Edges[1] = (*itEstimators)->rapmax();
+    candidate->Edges[0] = itGrids->rapMin;
+    candidate->Edges[1] = itGrids->rapMax;
     fRhoOutputArray->Add(candidate);
   }
 }
@@ -24,6 +24,11 @@
  *
  *  Computes median energy density per event using a fixed grid.
  *
+ *  All rapidity ranges are filled in a single pass over the input:
+ *  the tile sums of every grid live in one contiguous array and the
+ *  median is taken with a partial sort. The result is the same as
+ *  fastjet::GridMedianBackgroundEstimator::rho().
+ *
  *  \author M. Selvaggi - UCL, Louvain-la-Neuve
  *
  */
@@ -34,10 +39,6 @@
 class TObjArray;
 class TIterator;
 
-namespace fastjet {
-  class GridMedianBackgroundEstimator;
-}
-
 class FastJetGridMedianEstimator: public DelphesModule
 {
 public:
@@ -49,9 +50,24 @@ public:
   void Process();
   void Finish();
 
+  Bool_t IsThreadSafe() const { return kTRUE; }
+
 private:
 
-  std::vector< fastjet::GridMedianBackgroundEstimator * > fEstimators; //!
+#if !defined(__CINT__) && !defined(__CLING__)
+  struct TGridStruct
+  {
+    Double_t rapMin, rapMax;
+    Double_t inverseDRap, inverseDPhi;
+    Double_t tileArea;
+    Int_t nRap, nPhi;
+    Int_t offset; // first tile of this grid in fTilePt
+  };
+
+  std::vector< TGridStruct > fGrids; //!
+#endif
+
+  std::vector< Double_t > fTilePt; //!
 
   TIterator *fItInputArray; //!
 
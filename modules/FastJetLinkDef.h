@@ -28,6 +28,7 @@
 #include "modules/FastJetFinder.h"
 #include "modules/FastJetGridMedianEstimator.h"
 #include "modules/RunPUPPI.h"
+#include "modules/SoftKiller.h"
 
 #ifdef __CINT__
 
@@ -38,5 +39,6 @@
 #pragma link C++ class FastJetFinder+;
 #pragma link C++ class FastJetGridMedianEstimator+;
 #pragma link C++ class RunPUPPI+;
+#pragma link C++ class SoftKiller+;
 
 #endif
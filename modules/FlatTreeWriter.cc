@@ -0,0 +1,398 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+/** \class FlatTreeWriter
+ *
+ *  Fills ROOT tree branches of plain numbers, one vector per field named
+ *  BranchName_Field, that can be read without the Delphes classes.
+ *
+ */
+
+#include "modules/FlatTreeWriter.h"
+
+#include "classes/DelphesClasses.h"
+#include "classes/DelphesFactory.h"
+
+#include "ExRootAnalysis/ExRootResult.h"
+#include "ExRootAnalysis/ExRootTreeWriter.h"
+
+#include "TMath.h"
+#include "TString.h"
+#include "TObjArray.h"
+#include "TLorentzVector.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+
+static const Double_t c_light = 2.99792458E8;
+
+//------------------------------------------------------------------------------
+
+static Float_t Eta(const TLorentzVector &vector)
+{
+  Double_t signPz = (vector.Pz() >= 0.0) ? 1.0 : -1.0;
+  return TMath::Abs(vector.CosTheta()) == 1.0 ? signPz*999.9 : vector.Eta();
+}
+
+//------------------------------------------------------------------------------
+
+static Float_t Rapidity(const TLorentzVector &vector)
+{
+  Double_t signPz = (vector.Pz() >= 0.0) ? 1.0 : -1.0;
+  return TMath::Abs(vector.CosTheta()) == 1.0 ? signPz*999.9 : vector.Rapidity();
+}
+
+//------------------------------------------------------------------------------
+
+static Candidate *First(const Candidate *candidate)
+{
+  return candidate->GetNumberOfCandidates() > 0 ? candidate->GetCandidate(0) : 0;
+}
+
+//------------------------------------------------------------------------------
+
+FlatTreeWriter::FlatTreeWriter()
+{
+}
+
+//------------------------------------------------------------------------------
+
+FlatTreeWriter::~FlatTreeWriter()
+{
+}
+
+//------------------------------------------------------------------------------
+
+void FlatTreeWriter::Init()
+{
+  ExRootConfParam param = GetParam("Branch");
+  Long_t i, size;
+  TString branchName, branchClassName, branchInputArray;
+  Branch branch;
+
+  fTreeWriter = static_cast<ExRootTreeWriter *>(GetObject("TreeWriter", ExRootTreeWriter::Class()));
+  if(!fTreeWriter)
+  {
+    throw runtime_error("can't access access tree writer");
+  }
+
+  size = param.GetSize();
+  for(i = 0; i < size/3; ++i)
+  {
+    branchInputArray = param[i*3].GetString();
+    branchName = param[i*3 + 1].GetString();
+    branchClassName = param[i*3 + 2].GetString();
+
+    branch.name = branchName;
+    branch.particles = kFALSE;
+    branch.sort = kFALSE;
+    branch.single = kFALSE;
+    branch.link = kNoLink;
+    branch.floats.clear();
+    branch.ints.clear();
+    branch.indices = 0;
+    branch.counts = 0;
+
+    if(!AddFields(branch, branchClassName))
+    {
+      cout << "** ERROR: cannot create flat branch for class '" << branchClassName << "'" << endl;
+      continue;
+    }
+
+    switch(branch.link)
+    {
+      case kParticle:
+        branch.indices = fTreeWriter->NewIntBranch(branchName + "_Particle");
+        break;
+      case kParticles:
+        branch.indices = fTreeWriter->NewIntBranch(branchName + "_Particles");
+        branch.counts = fTreeWriter->NewIntBranch(branchName + "_NParticles");
+        break;
+      default:
+        break;
+    }
+
+    branch.array = ImportArray(branchInputArray);
+
+    fBranches.push_back(branch);
+  }
+
+  // the particles are written first, so that the other branches can link them
+  stable_partition(fBranches.begin(), fBranches.end(), [](const Branch &branch) { return branch.particles; });
+}
+
+//------------------------------------------------------------------------------
+
+void FlatTreeWriter::Finish()
+{
+}
+
+//------------------------------------------------------------------------------
+
+void FlatTreeWriter::AddFloat(Branch &branch, const char *field, TFloatField get)
+{
+  branch.floats.push_back(make_pair(get, fTreeWriter->NewFloatBranch(branch.name + "_" + field)));
+}
+
+//------------------------------------------------------------------------------
+
+void FlatTreeWriter::AddInt(Branch &branch, const char *field, TIntField get)
+{
+  branch.ints.push_back(make_pair(get, fTreeWriter->NewIntBranch(branch.name + "_" + field)));
+}
+
+//------------------------------------------------------------------------------
+
+Bool_t FlatTreeWriter::AddFields(Branch &branch, const TString &className)
+{
+  if(className == "GenParticle")
+  {
+    branch.particles = kTRUE;
+    AddInt(branch, "PID", [](Candidate *c) { return Int_t(c->PID); });
+    AddInt(branch, "Status", [](Candidate *c) { return Int_t(c->Status); });
+    AddInt(branch, "IsPU", [](Candidate *c) { return Int_t(c->IsPU); });
+    AddInt(branch, "M1", [](Candidate *c) { return Int_t(c->M1); });
+    AddInt(branch, "M2", [](Candidate *c) { return Int_t(c->M2); });
+    AddInt(branch, "D1", [](Candidate *c) { return Int_t(c->D1); });
+    AddInt(branch, "D2", [](Candidate *c) { return Int_t(c->D2); });
+    AddInt(branch, "Charge", [](Candidate *c) { return Int_t(c->Charge); });
+    AddFloat(branch, "Mass", [](Candidate *c) { return Float_t(c->Mass); });
+    AddFloat(branch, "E", [](Candidate *c) { return Float_t(c->Momentum.E()); });
+    AddFloat(branch, "Px", [](Candidate *c) { return Float_t(c->Momentum.Px()); });
+    AddFloat(branch, "Py", [](Candidate *c) { return Float_t(c->Momentum.Py()); });
+    AddFloat(branch, "Pz", [](Candidate *c) { return Float_t(c->Momentum.Pz()); });
+    AddFloat(branch, "PT", [](Candidate *c) { return Float_t(c->Momentum.Pt()); });
+    AddFloat(branch, "Eta", [](Candidate *c) { return Eta(c->Momentum); });
+    AddFloat(branch, "Phi", [](Candidate *c) { return Float_t(c->Momentum.Phi()); });
+    AddFloat(branch, "Rapidity", [](Candidate *c) { return Rapidity(c->Momentum); });
+    AddFloat(branch, "X", [](Candidate *c) { return Float_t(c->Position.X()); });
+    AddFloat(branch, "Y", [](Candidate *c) { return Float_t(c->Position.Y()); });
+    AddFloat(branch, "Z", [](Candidate *c) { return Float_t(c->Position.Z()); });
+    AddFloat(branch, "T", [](Candidate *c) { return Float_t(c->Position.T()*1.0E-3/c_light); });
+  }
+  else if(className == "Track")
+  {
+    branch.link = kParticle;
+    AddInt(branch, "PID", [](Candidate *c) { return Int_t(c->PID); });
+    AddInt(branch, "Charge", [](Candidate *c) { return Int_t(c->Charge); });
+    AddFloat(branch, "PT", [](Candidate *c) { return Float_t(c->Momentum.Pt()); });
+    AddFloat(branch, "Eta", [](Candidate *c) { return Eta(c->Momentum); });
+    AddFloat(branch, "Phi", [](Candidate *c) { return Float_t(c->Momentum.Phi()); });
+    AddFloat(branch, "EtaOuter", [](Candidate *c) { return Eta(c->Position); });
+    AddFloat(branch, "PhiOuter", [](Candidate *c) { return Float_t(c->Position.Phi()); });
+    AddFloat(branch, "Dxy", [](Candidate *c) { return Float_t(c->Dxy); });
+    AddFloat(branch, "SDxy", [](Candidate *c) { return Float_t(c->SDxy); });
+    AddFloat(branch, "Xd", [](Candidate *c) { return Float_t(c->Xd); });
+    AddFloat(branch, "Yd", [](Candidate *c) { return Float_t(c->Yd); });
+    AddFloat(branch, "Zd", [](Candidate *c) { return Float_t(c->Zd); });
+    AddFloat(branch, "X", [](Candidate *c) { return Float_t(First(c)->Position.X()); });
+    AddFloat(branch, "Y", [](Candidate *c) { return Float_t(First(c)->Position.Y()); });
+    AddFloat(branch, "Z", [](Candidate *c) { return Float_t(First(c)->Position.Z()); });
+    AddFloat(branch, "T", [](Candidate *c) { return Float_t(First(c)->Position.T()*1.0E-3/c_light); });
+  }
+  else if(className == "Tower")
+  {
+    branch.link = kParticles;
+    AddFloat(branch, "ET", [](Candidate *c) { return Float_t(c->Momentum.Pt()); });
+    AddFloat(branch, "Eta", [](Candidate *c) { return Eta(c->Momentum); });
+    AddFloat(branch, "Phi", [](Candidate *c) { return Float_t(c->Momentum.Phi()); });
+    AddFloat(branch, "E", [](Candidate *c) { return Float_t(c->Momentum.E()); });
+    AddFloat(branch, "Eem", [](Candidate *c) { return Float_t(c->Eem); });
+    AddFloat(branch, "Ehad", [](Candidate *c) { return Float_t(c->Ehad); });
+    AddFloat(branch, "T", [](Candidate *c) { return Float_t(c->Position.T()*1.0E-3/c_light); });
+    AddInt(branch, "NTimeHits", [](Candidate *c) { return Int_t(c->NTimeHits); });
+  }
+  else if(className == "Photon" || className == "Electron" || className == "Muon")
+  {
+    branch.sort = kTRUE;
+    AddFloat(branch, "PT", [](Candidate *c) { return Float_t(c->Momentum.Pt()); });
+    AddFloat(branch, "Eta", [](Candidate *c) { return Eta(c->Momentum); });
+    AddFloat(branch, "Phi", [](Candidate *c) { return Float_t(c->Momentum.Phi()); });
+    AddFloat(branch, "T", [](Candidate *c) { return Float_t(c->Position.T()*1.0E-3/c_light); });
+    AddFloat(branch, "IsolationVar", [](Candidate *c) { return Float_t(c->IsolationVar); });
+    AddFloat(branch, "IsolationVarRhoCorr", [](Candidate *c) { return Float_t(c->IsolationVarRhoCorr); });
+    AddFloat(branch, "SumPtCharged", [](Candidate *c) { return Float_t(c->SumPtCharged); });
+    AddFloat(branch, "SumPtNeutral", [](Candidate *c) { return Float_t(c->SumPtNeutral); });
+    AddFloat(branch, "SumPtChargedPU", [](Candidate *c) { return Float_t(c->SumPtChargedPU); });
+    AddFloat(branch, "SumPt", [](Candidate *c) { return Float_t(c->SumPt); });
+    if(className == "Photon")
+    {
+      branch.link = kParticles;
+      AddFloat(branch, "E", [](Candidate *c) { return Float_t(c->Momentum.E()); });
+      AddFloat(branch, "EhadOverEem", [](Candidate *c) { return Float_t(c->Eem > 0.0 ? c->Ehad/c->Eem : 999.9); });
+    }
+    else
+    {
+      branch.link = kParticle;
+      AddInt(branch, "Charge", [](Candidate *c) { return Int_t(c->Charge); });
+    }
+  }
+  else if(className == "Jet")
+  {
+    branch.sort = kTRUE;
+    branch.link = kParticles;
+    AddFloat(branch, "PT", [](Candidate *c) { return Float_t(c->Momentum.Pt()); });
+    AddFloat(branch, "Eta", [](Candidate *c) { return Eta(c->Momentum); });
+    AddFloat(branch, "Phi", [](Candidate *c) { return Float_t(c->Momentum.Phi()); });
+    AddFloat(branch, "Mass", [](Candidate *c) { return Float_t(c->Momentum.M()); });
+    AddFloat(branch, "T", [](Candidate *c) { return Float_t(c->Position.T()*1.0E-3/c_light); });
+    AddFloat(branch, "DeltaEta", [](Candidate *c) { return Float_t(c->DeltaEta); });
+    AddFloat(branch, "DeltaPhi", [](Candidate *c) { return Float_t(c->DeltaPhi); });
+    AddInt(branch, "Flavor", [](Candidate *c) { return Int_t(c->Flavor); });
+    AddInt(branch, "BTag", [](Candidate *c) { return Int_t(c->BTag); });
+    AddInt(branch, "TauTag", [](Candidate *c) { return Int_t(c->TauTag); });
+    AddInt(branch, "Charge", [](Candidate *c) { return Int_t(c->Charge); });
+    AddInt(branch, "NCharged", [](Candidate *c) { return Int_t(c->GetPileUpJetID() ? c->GetPileUpJetID()->NCharged : 0); });
+    AddInt(branch, "NNeutrals", [](Candidate *c) { return Int_t(c->GetPileUpJetID() ? c->GetPileUpJetID()->NNeutrals : 0); });
+  }
+  else if(className == "MissingET")
+  {
+    branch.single = kTRUE;
+    AddFloat(branch, "MET", [](Candidate *c) { return Float_t(c->Momentum.Pt()); });
+    AddFloat(branch, "Eta", [](Candidate *c) { return Float_t((-c->Momentum).Eta()); });
+    AddFloat(branch, "Phi", [](Candidate *c) { return Float_t((-c->Momentum).Phi()); });
+  }
+  else if(className == "ScalarHT")
+  {
+    branch.single = kTRUE;
+    AddFloat(branch, "HT", [](Candidate *c) { return Float_t(c->Momentum.Pt()); });
+  }
+  else
+  {
+    return kFALSE;
+  }
+
+  return kTRUE;
+}
+
+//------------------------------------------------------------------------------
+
+Int_t FlatTreeWriter::ParticleIndex(const Candidate *candidate) const
+{
+  map< UInt_t, Int_t >::const_iterator itParticleIndices = fParticleIndices.find(candidate->GetUniqueID());
+  return itParticleIndices != fParticleIndices.end() ? itParticleIndices->second : -1;
+}
+
+//------------------------------------------------------------------------------
+
+void FlatTreeWriter::FillParticles(Candidate *candidate, Branch &branch)
+{
+  Candidate *constituent;
+  Int_t i, j, size, sizeConstituent;
+  Int_t count = 0;
+
+  // same walk as TreeWriter::FillParticles
+  size = candidate->GetNumberOfCandidates();
+  for(i = 0; i < size; ++i)
+  {
+    constituent = candidate->GetCandidate(i);
+    sizeConstituent = constituent->GetNumberOfCandidates();
+
+    // particle
+    if(sizeConstituent == 0)
+    {
+      branch.indices->push_back(ParticleIndex(constituent));
+      ++count;
+      continue;
+    }
+
+    // track
+    if(First(constituent)->GetNumberOfCandidates() == 0)
+    {
+      branch.indices->push_back(ParticleIndex(First(constituent)));
+      ++count;
+      continue;
+    }
+
+    // tower
+    for(j = 0; j < sizeConstituent; ++j)
+    {
+      branch.indices->push_back(ParticleIndex(First(constituent->GetCandidate(j))));
+      ++count;
+    }
+  }
+
+  branch.counts->push_back(count);
+}
+
+//------------------------------------------------------------------------------
+
+void FlatTreeWriter::ProcessBranch(Branch &branch)
+{
+  vector< pair< TFloatField, vector< Float_t > * > >::iterator itFloats;
+  vector< pair< TIntField, vector< Int_t > * > >::iterator itInts;
+  const vector< Candidate * > *sorted = 0;
+  Candidate *candidate;
+  Int_t i, size;
+
+  if(branch.sort) sorted = &fSortedArrays.Get(branch.array);
+
+  size = sorted ? sorted->size() : branch.array->GetEntriesFast();
+  for(i = 0; i < size; ++i)
+  {
+    candidate = sorted ? (*sorted)[i] : static_cast<Candidate*>(branch.array->At(i));
+
+    for(itFloats = branch.floats.begin(); itFloats != branch.floats.end(); ++itFloats)
+    {
+      itFloats->second->push_back(itFloats->first(candidate));
+    }
+    for(itInts = branch.ints.begin(); itInts != branch.ints.end(); ++itInts)
+    {
+      itInts->second->push_back(itInts->first(candidate));
+    }
+
+    // the first branch wins for particles written twice
+    if(branch.particles) fParticleIndices.insert(make_pair(candidate->GetUniqueID(), i));
+
+    switch(branch.link)
+    {
+      case kParticle:
+        branch.indices->push_back(ParticleIndex(First(candidate)));
+        break;
+      case kParticles:
+        FillParticles(candidate, branch);
+        break;
+      default:
+        break;
+    }
+
+    if(branch.single) break;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void FlatTreeWriter::Process()
+{
+  vector< Branch >::iterator itBranches;
+
+  fParticleIndices.clear();
+  fSortedArrays.Reset();
+  for(itBranches = fBranches.begin(); itBranches != fBranches.end(); ++itBranches)
+  {
+    ProcessBranch(*itBranches);
+  }
+}
+
+//------------------------------------------------------------------------------
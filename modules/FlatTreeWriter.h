@@ -0,0 +1,105 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FlatTreeWriter_h
+#define FlatTreeWriter_h
+
+/** \class FlatTreeWriter
+ *
+ *  Fills ROOT tree branches of plain numbers, one vector per field named
+ *  BranchName_Field, that can be read without the Delphes classes.
+ *
+ *  The generator particles are linked by their index in the first GenParticle
+ *  branch of the module, -1 when the particle is not written: BranchName_Particle
+ *  for the tracks, electrons and muons, and for the towers, photons and jets
+ *  the BranchName_Particles indices of all the objects one after the other,
+ *  with BranchName_NParticles indices per object.
+ *
+ */
+
+#include "classes/DelphesModule.h"
+
+#if !defined(__CINT__) && !defined(__CLING__)
+#include "classes/DelphesSortedArrays.h"
+#endif
+
+#include <map>
+#include <vector>
+
+class TObjArray;
+
+class Candidate;
+
+class FlatTreeWriter: public DelphesModule
+{
+public:
+
+  FlatTreeWriter();
+  ~FlatTreeWriter();
+
+  void Init();
+  void Process();
+  void Finish();
+
+private:
+
+#if !defined(__CINT__) && !defined(__CLING__)
+  typedef Float_t (*TFloatField)(Candidate *); //!
+  typedef Int_t (*TIntField)(Candidate *); //!
+
+  enum ELink
+  {
+    kNoLink,
+    kParticle,
+    kParticles
+  };
+
+  struct Branch
+  {
+    TObjArray *array;
+    TString name;
+    Bool_t particles, sort, single;
+    ELink link;
+    std::vector< std::pair< TFloatField, std::vector< Float_t > * > > floats;
+    std::vector< std::pair< TIntField, std::vector< Int_t > * > > ints;
+    std::vector< Int_t > *indices, *counts;
+  };
+
+  void AddFloat(Branch &branch, const char *field, TFloatField get);
+  void AddInt(Branch &branch, const char *field, TIntField get);
+
+  Bool_t AddFields(Branch &branch, const TString &className);
+
+  void ProcessBranch(Branch &branch);
+
+  void FillParticles(Candidate *candidate, Branch &branch);
+
+  Int_t ParticleIndex(const Candidate *candidate) const;
+
+  std::vector< Branch > fBranches; //!
+
+  // index of the written particles by their unique ID
+  std::map< UInt_t, Int_t > fParticleIndices; //!
+
+  DelphesSortedArrays fSortedArrays; //!
+#endif
+
+  ClassDef(FlatTreeWriter, 1)
+};
+
+#endif
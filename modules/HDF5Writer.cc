@@ -30,6 +30,7 @@
 #include "classes/flavortag/SecondaryVertex.hh"
 
 #include "classes/DelphesClasses.h"
+#include "classes/DelphesFactory.h"
 #include "ExRootAnalysis/ExRootConfReader.h"
 // as a hack we get the output file name from ExRootTreeWriter
 #include "ExRootAnalysis/ExRootTreeWriter.h"
@@ -37,9 +38,11 @@
 #include "TObjArray.h"
 #include "TFolder.h"
 
+#include <algorithm>
 #include <iostream>
 #include <string>
 #include <limits>
+#include <stdexcept>
 
 namespace {
   // double inf = std::numeric_limits<double>::infinity();
@@ -49,19 +52,49 @@ namespace {
     return filename.substr(0, lastdot);
   }
 
-  // util functions
+  // first candidate in an optional array (null if there isn't one)
+  Candidate* first_candidate(const TObjArray* array) {
+    if (!array || array->GetEntriesFast() == 0) return 0;
+    return static_cast<Candidate*>(array->At(0));
+  }
+
+  // flavour-tagging block of a jet, empty if no tagging module filled it
+  const CandidateFlavorTagging& tagging(const Candidate& jet) {
+    static const CandidateFlavorTagging empty;
+    const CandidateFlavorTagging* block = jet.GetFlavorTagging();
+    return block ? *block : empty;
+  }
+
+  // util functions, with `max_tracks` > 0 only the leading tracks
+  // are kept (and sorted), `n_total` is set to the count before that
   std::vector<out::VertexTrack>
-  get_sorted_primary_tracks(Candidate& jet);
+  get_sorted_primary_tracks(Candidate& jet, size_t max_tracks = 0,
+                            int* n_total = 0);
 
   std::vector<out::CombinedSecondaryTrack>
-  get_sorted_secondary_tracks(Candidate& jet);
+  get_sorted_secondary_tracks(Candidate& jet, size_t max_tracks = 0,
+                              int* n_total = 0);
+
+  // padding for fixed-size track arrays
+  out::VertexTrack nan_track();
+  out::CombinedSecondaryTrack nan_secondary_track();
 }
 
 //------------------------------------------------------------------------------
 
 HDF5Writer::HDF5Writer() :
-  fItInputArray(0), m_out_file(0), m_hl_jet_buffer(0),
-  m_ml_jet_buffer(0), m_superjet_buffer(0)
+  fItInputArray(0), fMissingETInputArray(0), fRhoInputArray(0),
+  fVertexInputArray(0), fWeights(0), m_n_weights(0), m_out_file(0),
+  m_hl_jet_buffer(0), m_ml_jet_buffer(0), m_superjet_buffer(0),
+  m_hl_column_buffer(0), m_primary_track_buffer(0),
+  m_secondary_track_buffer(0), m_n_primary_buffer(0),
+  m_n_secondary_buffer(0), m_event_buffer(0), m_jet_event_index_buffer(0),
+  m_weight_buffer(0), m_layout("compound"), m_max_tracks(0),
+  m_async(false), m_swmr(false), m_swmr_flush_events(0), m_tree_writer(0),
+  m_max_events(0), m_max_bytes(0), m_file_number(0), m_file_events(0),
+  m_event_number(0), m_n_jets_written(0), m_text_sampling(1),
+  m_parallel(false), m_mpi_owner(false), m_pending_jets(0), m_jets_base(0),
+  m_events_base(0)
 {
 }
 
@@ -73,6 +106,14 @@ HDF5Writer::~HDF5Writer()
   delete m_hl_jet_buffer;
   delete m_ml_jet_buffer;
   delete m_superjet_buffer;
+  delete m_hl_column_buffer;
+  delete m_primary_track_buffer;
+  delete m_secondary_track_buffer;
+  delete m_n_primary_buffer;
+  delete m_n_secondary_buffer;
+  delete m_event_buffer;
+  delete m_jet_event_index_buffer;
+  delete m_weight_buffer;
   delete fItInputArray;
 }
 
@@ -92,16 +133,186 @@ void HDF5Writer::Init()
   fPTMin = GetDouble("PTMin", 20);
   fAbsEtaMax = GetDouble("AbsEtaMax", 2.5);
 
-  // get the name of the root output file
+  // event-level inputs are skipped if the name is empty
+  std::string met_name = GetString("MissingETInputArray", "");
+  if (met_name.size() > 0) fMissingETInputArray = ImportArray(met_name.c_str());
+  std::string rho_name = GetString("RhoInputArray", "");
+  if (rho_name.size() > 0) fRhoInputArray = ImportArray(rho_name.c_str());
+  std::string vx_name = GetString("VertexInputArray", "");
+  if (vx_name.size() > 0) fVertexInputArray = ImportArray(vx_name.c_str());
+
+  // the weights of all the sets of a Weighter go to `event_weights`,
+  // one row per event, read from its block rather than its candidates
+  std::string weight_name = GetString("WeightInputArray", "");
+  if (weight_name.size() > 0) {
+    const TObjArray* weights = ImportArray(weight_name.c_str());
+    fWeights = GetFactory()->GetWeightBlock(weights, m_n_weights);
+    if (!fWeights) {
+      throw std::invalid_argument(
+        "HDF5Writer: WeightInputArray " + weight_name +
+        " isn't the output of a Weighter");
+    }
+  }
+
+  // Use OutputFile if it's given, otherwise as a hack we take the name
+  // of the root output file and swap the extension.
+  std::string hdf_out = GetString("OutputFile", "");
+  std::string output_file = remove_extension(hdf_out);
   auto* treeWriter = static_cast<ExRootTreeWriter*>(
     GetFolder()->FindObject("TreeWriter"));
-  const std::string output_file = remove_extension(
-    treeWriter->GetOutputFileName());
+  if (hdf_out.empty()) {
+    if (!treeWriter) {
+      throw std::runtime_error(
+        "HDF5Writer needs OutputFile when there's no TreeWriter");
+    }
+    output_file = remove_extension(treeWriter->GetFirstFileName());
+    hdf_out = output_file + GetString("OutputExtension", ".ntuple.h5");
+  }
+
+  // chunking and compression, the defaults match the old hardcoded
+  // settings (chunk = buffer size of 1000 rows, deflate level 7)
+  int chunk_size = GetInt("ChunkSize", 1000);
+  if (chunk_size < 1) {
+    throw std::invalid_argument("ChunkSize must be positive");
+  }
+  m_ds_opts.chunk_size = chunk_size;
+  m_ds_opts.compression = GetString("Compression", "deflate-7");
+  m_ds_opts.shuffle = GetBool("Shuffle", false);
+
+  // `compound` writes everything to the `jets` dataset, `columnar`
+  // writes one dataset per high-level variable in the
+  // `high_level_jets` group, `both` does both.
+  m_layout = GetString("OutputLayout", "compound");
+  if (m_layout != "compound" && m_layout != "columnar" && m_layout != "both") {
+    throw std::invalid_argument("unknown OutputLayout: " + m_layout);
+  }
+
+  // If MaxTracks is set the tracks are written as NaN-padded 2-D
+  // arrays with a separate count dataset, and `jets` only holds the
+  // high-level variables. Otherwise they are variable-length members
+  // of `jets`. The counts are the number of tracks in the jet, which
+  // can be more than MaxTracks: only the leading ones are selected
+  // and sorted.
+  m_max_tracks = GetInt("MaxTracks", 0);
+  if (m_max_tracks > 0 && m_layout == "columnar") {
+    throw std::invalid_argument(
+      "HDF5Writer: MaxTracks needs OutputLayout compound or both, the "
+      "columnar layout has no tracks");
+  }
+  m_async = GetBool("AsyncWrite", false);
+
+  // With SWMR the file is written in single-writer/multiple-reader
+  // mode, so the jets can be read while the job runs. The buffers are
+  // flushed every SWMRFlushEvents events and when they are full, the
+  // events last, so a reader never sees an event before its jets. SWMR
+  // can't write variable-length data either.
+  m_swmr = GetBool("SWMR", false);
+  m_swmr_flush_events = GetInt("SWMRFlushEvents", 100);
+  if (m_swmr) {
+#if H5_VERSION_GE(1,10,0)
+    if (m_layout != "columnar" && m_max_tracks == 0) {
+      throw std::invalid_argument(
+        "HDF5Writer: SWMR needs MaxTracks or OutputLayout columnar");
+    }
+    if (m_async) {
+      throw std::invalid_argument(
+        "HDF5Writer: SWMR and AsyncWrite can't be combined");
+    }
+    if (m_swmr_flush_events < 1) {
+      throw std::invalid_argument("SWMRFlushEvents must be positive");
+    }
+    m_ds_opts.swmr = true;
+#else
+    throw std::runtime_error("HDF5Writer: SWMR needs HDF5 1.10 or later");
+#endif
+  }
+
+  // With Parallel every MPI rank of the job writes its jets into the
+  // same OutputFile, after those of the ranks before it in each
+  // flush. The flushes are collective, so the ranks agree after every
+  // event on whether to flush. Parallel HDF5 can't write the
+  // variable-length members of the compound jets, which need MaxTracks
+  // or the columnar layout. event_number counts the events of a rank.
+  m_parallel = GetBool("Parallel", false);
+  if (m_parallel) {
+#ifdef H5_HAVE_PARALLEL
+    if (m_layout != "columnar" && m_max_tracks == 0) {
+      throw std::invalid_argument(
+        "HDF5Writer: Parallel needs MaxTracks or OutputLayout columnar");
+    }
+    if (m_async || m_swmr) {
+      throw std::invalid_argument(
+        "HDF5Writer: Parallel can't be combined with AsyncWrite or SWMR");
+    }
+    if (fWeights) {
+      throw std::invalid_argument(
+        "HDF5Writer: Parallel can't be combined with WeightInputArray");
+    }
+    int initialized = 0;
+    MPI_Initialized(&initialized);
+    if (!initialized) {
+      MPI_Init(0, 0);
+      m_mpi_owner = true;
+    }
+    m_ds_opts.comm = MPI_COMM_WORLD;
+#else
+    throw std::runtime_error(
+      "HDF5Writer: Parallel needs an HDF5 library built with MPI");
+#endif
+  }
+
+  // Files after the first one are numbered like those of the ROOT
+  // output, out.ntuple.h5 is followed by out_1.ntuple.h5. The HDF5
+  // output rolls over with the ROOT output, the limits here only count
+  // for the events of the HDF5 file.
+  m_tree_writer = treeWriter;
+  m_max_events = GetLong("MaxEventsPerFile", 0);
+  m_max_bytes = GetLong("MaxBytesPerFile", 0);
+  if (m_parallel && (m_max_events > 0 || m_max_bytes > 0)) {
+    throw std::invalid_argument(
+      "HDF5Writer: the parallel output doesn't roll over");
+  }
+  m_file_base = remove_extension(hdf_out);
+  m_file_extension = hdf_out.substr(m_file_base.size());
+
+  // a job resuming after a checkpoint starts with a later file
+  m_file_number = treeWriter ? treeWriter->GetFileNumber() : 0;
+  open_file(file_name(m_file_number));
+
+  // create the output text file
+  std::string text_file_ext = GetString("TextFileExtension", "");
+  if (text_file_ext.size() > 0) {
+#ifdef H5_HAVE_PARALLEL
+    // one text file per rank
+    if (m_parallel) {
+      int rank = 0;
+      MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+      output_file += "_rank" + std::to_string(rank);
+    }
+#endif
+    m_output_stream.open(output_file + text_file_ext);
+  }
+  // only dump every Nth jet, formatting is slow
+  m_text_sampling = GetInt("TextFileSampling", 1);
+  if (m_text_sampling < 1) {
+    throw std::invalid_argument("TextFileSampling must be positive");
+  }
+}
+
+//------------------------------------------------------------------------------
 
-  // create the hdf5 output file
-  std::string output_ext = GetString("OutputExtension", ".ntuple.h5");
-  std::string hdf_out = output_file + output_ext;
-  m_out_file = new H5::H5File(hdf_out, H5F_ACC_TRUNC);
+void HDF5Writer::open_file(const std::string& name)
+{
+  H5::FileAccPropList access;
+  // SWMR needs the latest file format
+  if (m_swmr) access.setLibverBounds(H5F_LIBVER_LATEST, H5F_LIBVER_LATEST);
+#ifdef H5_HAVE_PARALLEL
+  if (m_parallel) {
+    H5Pset_fapl_mpio(access.getId(), MPI_COMM_WORLD, MPI_INFO_NULL);
+  }
+#endif
+  m_out_file = new H5::H5File(name, H5F_ACC_TRUNC,
+                              H5::FileCreatPropList::DEFAULT, access);
 
   auto hl_jtype = out::type(out::HighLevelJet());
   auto ml_jtype = out::type(out::MediumLevelJet());
@@ -111,16 +322,140 @@ void HDF5Writer::Init()
   //   *m_out_file, "high_level_jets", hl_jtype, 1000);
   // m_ml_jet_buffer = new OneDimBuffer<out::MediumLevelJet>(
   //   *m_out_file, "medium_level_jets", ml_jtype, 1000);
-  m_superjet_buffer = new OneDimBuffer<out::VLSuperJet>(
-    *m_out_file, "jets", superjet_type, 1000);
+  if (m_layout != "columnar" && m_max_tracks > 0) {
+    m_hl_jet_buffer = new OneDimBuffer<out::HighLevelJet>(
+      *m_out_file, "jets", hl_jtype, 1000, m_ds_opts);
+    if (m_async) m_hl_jet_buffer->set_async();
+
+    m_primary_track_buffer = new TwoDimBuffer<out::VertexTrack>(
+      *m_out_file, "primary_vertex_tracks", out::type(out::VertexTrack()),
+      m_max_tracks, nan_track(), 1000, m_ds_opts);
+    m_secondary_track_buffer = new TwoDimBuffer<out::CombinedSecondaryTrack>(
+      *m_out_file, "secondary_vertex_tracks",
+      out::type(out::CombinedSecondaryTrack()),
+      m_max_tracks, nan_secondary_track(), 1000, m_ds_opts);
+    m_n_primary_buffer = new OneDimBuffer<int>(
+      *m_out_file, "n_primary_vertex_tracks", h5::type(int()),
+      1000, m_ds_opts);
+    m_n_secondary_buffer = new OneDimBuffer<int>(
+      *m_out_file, "n_secondary_vertex_tracks", h5::type(int()),
+      1000, m_ds_opts);
+  } else if (m_layout != "columnar") {
+    m_superjet_buffer = new OneDimBuffer<out::VLSuperJet>(
+      *m_out_file, "jets", superjet_type, 1000, m_ds_opts);
+
+    // compress and write full buffers in a background thread
+    if (m_async) m_superjet_buffer->set_async();
+  }
+  if (m_layout != "compound") {
+    H5::Group columns = m_out_file->createGroup("high_level_jets");
+    m_hl_column_buffer = new ColumnBuffer<out::HighLevelJet>(
+      columns, hl_jtype, 1000, m_ds_opts);
+  }
+
+  // one entry per event, and the index of the event for each jet
+  m_event_buffer = new OneDimBuffer<out::Event>(
+    *m_out_file, "events", out::type(out::Event()), 1000, m_ds_opts);
+  m_jet_event_index_buffer = new OneDimBuffer<int>(
+    *m_out_file, "jet_event_index", h5::type(int()), 1000, m_ds_opts);
+  if (fWeights) {
+    m_weight_buffer = new ArrayBuffer<float>(
+      *m_out_file, "event_weights", h5::type(float()),
+      {hsize_t(m_n_weights)}, 1000, m_ds_opts);
+  }
+
+  // the readers can open the file once all the datasets exist
+#if H5_VERSION_GE(1,10,0)
+  if (m_swmr) H5Fstart_swmr_write(m_out_file->getId());
+#endif
+
+  m_file_events = 0;
+  m_n_jets_written = 0;
+  m_jets_base = 0;
+  m_events_base = 0;
+}
 
-  // create the output text file
-  std::string text_file_ext = GetString("TextFileExtension", "");
-  if (text_file_ext.size() > 0) {
-    m_output_stream.open(output_file + text_file_ext);
+//------------------------------------------------------------------------------
+
+void HDF5Writer::close_file()
+{
+  if (m_hl_jet_buffer) {
+    m_hl_jet_buffer->flush();
+    m_hl_jet_buffer->close();
+  }
+  if (m_ml_jet_buffer) {
+    m_ml_jet_buffer->flush();
+    m_ml_jet_buffer->close();
+  }
+  if (m_superjet_buffer) {
+    m_superjet_buffer->flush();
+    m_superjet_buffer->close();
+  }
+  if (m_hl_column_buffer) {
+    m_hl_column_buffer->flush();
+    m_hl_column_buffer->close();
+  }
+  if (m_primary_track_buffer) {
+    m_primary_track_buffer->close();
+    m_secondary_track_buffer->close();
+    m_n_primary_buffer->close();
+    m_n_secondary_buffer->close();
   }
+  if (m_event_buffer) {
+    m_event_buffer->close();
+    m_jet_event_index_buffer->close();
+  }
+  if (m_weight_buffer) m_weight_buffer->close();
+
+  delete m_hl_jet_buffer;
+  delete m_ml_jet_buffer;
+  delete m_superjet_buffer;
+  delete m_hl_column_buffer;
+  delete m_primary_track_buffer;
+  delete m_secondary_track_buffer;
+  delete m_n_primary_buffer;
+  delete m_n_secondary_buffer;
+  delete m_event_buffer;
+  delete m_jet_event_index_buffer;
+  delete m_weight_buffer;
+  m_hl_jet_buffer = 0;
+  m_ml_jet_buffer = 0;
+  m_superjet_buffer = 0;
+  m_hl_column_buffer = 0;
+  m_primary_track_buffer = 0;
+  m_secondary_track_buffer = 0;
+  m_n_primary_buffer = 0;
+  m_n_secondary_buffer = 0;
+  m_event_buffer = 0;
+  m_jet_event_index_buffer = 0;
+  m_weight_buffer = 0;
+
+  delete m_out_file;
+  m_out_file = 0;
+}
+
+//------------------------------------------------------------------------------
+
+void HDF5Writer::roll_over()
+{
+  // same numbers as the ROOT output when it rolls over
+  m_file_number = m_tree_writer && m_tree_writer->GetFileNumber() > m_file_number ?
+    m_tree_writer->GetFileNumber() : m_file_number + 1;
+
+  close_file();
+  open_file(file_name(m_file_number));
 }
 
+//------------------------------------------------------------------------------
+
+std::string HDF5Writer::file_name(int number) const
+{
+  if (number == 0) return m_file_base + m_file_extension;
+  return m_file_base + "_" + std::to_string(number) + m_file_extension;
+}
+
+//------------------------------------------------------------------------------
+
 namespace out {
   int simple_flavor(int flav) {
     switch (flav) {
@@ -161,8 +496,8 @@ namespace out {
 
   HighLevelJet::HighLevelJet(Candidate& jet):
     jet_parameters(jet),
-    tracking(jet.hlTrk),
-    vertex(jet.hlSvx)
+    tracking(tagging(jet).hlTrk),
+    vertex(tagging(jet).hlSvx)
   {
   }
 
@@ -187,35 +522,39 @@ namespace out {
   }
   // TODO: unify SecondaryVertexWithTracks with SecondaryVertex
   SecondaryVertexWithTracks::SecondaryVertexWithTracks(
-    const ::SecondaryVertex& vx):
+    const ::SecondaryVertex& vx,
+    const std::vector<SecondaryVertexTrack>& tracks):
     mass(vx.mass),
     displacement(vx.Mag()),
     delta_eta_jet(vx.deta),
     delta_phi_jet(vx.dphi),
     displacement_significance(vx.Lsig)
   {
-    for (const auto& track: vx.tracks_along_jet) {
+    for (const auto& track: vx.tracks_along_jet(tracks)) {
       associated_tracks.push_back(track);
     }
   }
   MediumLevelJet::MediumLevelJet(Candidate& jet):
     jet_parameters(jet)
   {
-    for (const auto& trk: jet.primaryVertexTracks) {
+    primary_vertex_tracks.reserve(tagging(jet).primaryVertexTracks.size());
+    for (const auto& trk: tagging(jet).primaryVertexTracks) {
       primary_vertex_tracks.push_back(trk);
     }
-    for (const auto& vx: jet.secondaryVertices) {
-      secondary_vertices.push_back(SecondaryVertexWithTracks(vx));
+    for (const auto& vx: tagging(jet).secondaryVertices) {
+      secondary_vertices.push_back(SecondaryVertexWithTracks(
+        vx, tagging(jet).secondaryVertexTracks));
     }
   }
   SuperJet::SuperJet(Candidate& jet):
-    jet_parameters(jet), tracking(jet.hlTrk), vertex(jet.hlSvx)
+    jet_parameters(jet), tracking(tagging(jet).hlTrk), vertex(tagging(jet).hlSvx)
   {
-    for (const auto& trk: jet.primaryVertexTracks) {
+    for (const auto& trk: tagging(jet).primaryVertexTracks) {
       primary_vertex_tracks.push_back(trk);
     }
-    for (const auto& vx: jet.secondaryVertices) {
-      secondary_vertices.push_back(SecondaryVertexWithTracks(vx));
+    for (const auto& vx: tagging(jet).secondaryVertices) {
+      secondary_vertices.push_back(SecondaryVertexWithTracks(
+        vx, tagging(jet).secondaryVertexTracks));
     }
   }
 
@@ -241,27 +580,28 @@ namespace out {
 
   VLSuperJet::VLSuperJet(Candidate& jet):
     jet_parameters(jet),
-    tracking(jet.hlTrk),
-    vertex(jet.hlSvx)
+    tracking(tagging(jet).hlTrk),
+    vertex(tagging(jet).hlSvx),
+    // sorted primary tracks and filtered secondary tracks, the
+    // temporaries are moved in rather than copied
+    primary_vertex_tracks(get_sorted_primary_tracks(jet)),
+    secondary_vertex_tracks(get_sorted_secondary_tracks(jet))
   {
-    // sort primary tracks
-    primary_vertex_tracks = get_sorted_primary_tracks(jet);
-
-    // Filter secondary tracks
-    secondary_vertex_tracks = get_sorted_secondary_tracks(jet);
   }
 
   JetTracks::JetTracks(Candidate& jet):
     jet_parameters(jet),
-    tracking(jet.hlTrk),
-    vertex(jet.hlSvx)
+    tracking(tagging(jet).hlTrk),
+    vertex(tagging(jet).hlSvx)
   {
-    for (const auto& track: get_sorted_primary_tracks(jet)) {
-      auto combined = CombinedSecondaryTrack(track, jet.primaryVertex);
-      all_tracks.push_back(combined);
+    auto primary = get_sorted_primary_tracks(jet);
+    auto secondary = get_sorted_secondary_tracks(jet);
+    all_tracks.reserve(primary.size() + secondary.size());
+    for (const auto& track: primary) {
+      all_tracks.push_back(CombinedSecondaryTrack(track, tagging(jet).primaryVertex));
     }
-    for (const auto& track: get_sorted_secondary_tracks(jet)) {
-      all_tracks.push_back(track);
+    for (auto& track: secondary) {
+      all_tracks.push_back(std::move(track));
     }
   }
 
@@ -270,137 +610,178 @@ namespace out {
 
   // insering a compound type requires that `type(Class)` is defined
   // high level variables
-  H5::CompType type(JetParameters) {
-    H5::CompType out(sizeof(JetParameters));
-    H5_INSERT(out, JetParameters, pt);
-    H5_INSERT(out, JetParameters, eta);
-    H5_INSERT(out, JetParameters, flavor);
-    return out;
-  }
-
-  H5::CompType type(HighLevelTracking) {
-    H5::CompType out(sizeof(HighLevelTracking));
-    H5_INSERT(out, HighLevelTracking, track_2_d0_significance);
-    H5_INSERT(out, HighLevelTracking, track_3_d0_significance);
-    H5_INSERT(out, HighLevelTracking, track_2_z0_significance);
-    H5_INSERT(out, HighLevelTracking, track_3_z0_significance);
-    H5_INSERT(out, HighLevelTracking, n_tracks_over_d0_threshold);
-    H5_INSERT(out, HighLevelTracking, jet_prob);
-    H5_INSERT(out, HighLevelTracking, jet_width_eta);
-    H5_INSERT(out, HighLevelTracking, jet_width_phi);
-    return out;
-  }
-
-  H5::CompType type(HighLevelSecondaryVertex) {
-    H5::CompType out(sizeof(HighLevelSecondaryVertex));
-    H5_INSERT(out, HighLevelSecondaryVertex, vertex_significance);
-    H5_INSERT(out, HighLevelSecondaryVertex, n_secondary_vertices);
-    H5_INSERT(out, HighLevelSecondaryVertex, n_secondary_vertex_tracks);
-    H5_INSERT(out, HighLevelSecondaryVertex, delta_r_vertex);
-    H5_INSERT(out, HighLevelSecondaryVertex, vertex_mass);
-    H5_INSERT(out, HighLevelSecondaryVertex, vertex_energy_fraction);
-    return out;
-  }
-  H5::CompType type(HighLevelJet) {
-    H5::CompType out(sizeof(HighLevelJet));
-    H5_INSERT(out, HighLevelJet, jet_parameters);
-    H5_INSERT(out, HighLevelJet, tracking);
-    H5_INSERT(out, HighLevelJet, vertex);
-    return out;
-  }
+  H5_DEFINE_TYPE(JetParameters, OUT_JET_PARAMETERS_FIELDS)
+  H5_DEFINE_TYPE(HighLevelTracking, OUT_HIGH_LEVEL_TRACKING_FIELDS)
+  H5_DEFINE_TYPE(HighLevelSecondaryVertex,
+                 OUT_HIGH_LEVEL_SECONDARY_VERTEX_FIELDS)
+  H5_DEFINE_TYPE(HighLevelJet, OUT_HIGH_LEVEL_JET_FIELDS)
+  H5_DEFINE_TYPE(Event, OUT_EVENT_FIELDS)
 
   // medium-level variables
-  H5::CompType type(VertexTrack) {
-    H5::CompType out(sizeof(VertexTrack));
-    H5_INSERT(out, VertexTrack, d0);
-    H5_INSERT(out, VertexTrack, z0);
-    H5_INSERT(out, VertexTrack, d0_uncertainty);
-    H5_INSERT(out, VertexTrack, z0_uncertainty);
-    H5_INSERT(out, VertexTrack, pt);
-    H5_INSERT(out, VertexTrack, delta_eta_jet);
-    H5_INSERT(out, VertexTrack, delta_phi_jet);
-    H5_INSERT(out, VertexTrack, weight);
-    return out;
-  }
-  H5::CompType type(CombinedSecondaryTrack) {
-    H5::CompType out(sizeof(CombinedSecondaryTrack));
-    H5_INSERT(out, CombinedSecondaryTrack, track);
-    H5_INSERT(out, CombinedSecondaryTrack, vertex);
-    return out;
-  }
-  H5::CompType type(SecondaryVertex) {
-    H5::CompType out(sizeof(SecondaryVertex));
-    H5_INSERT(out, SecondaryVertex, mass);
-    H5_INSERT(out, SecondaryVertex, displacement);
-    H5_INSERT(out, SecondaryVertex, delta_eta_jet);
-    H5_INSERT(out, SecondaryVertex, delta_phi_jet);
-    H5_INSERT(out, SecondaryVertex, displacement_significance);
-    return out;
-  }
-  H5::CompType type(SecondaryVertexWithTracks) {
-    H5::CompType out(sizeof(SecondaryVertexWithTracks));
-    H5_INSERT(out, SecondaryVertexWithTracks, mass);
-    H5_INSERT(out, SecondaryVertexWithTracks, displacement);
-    H5_INSERT(out, SecondaryVertexWithTracks, delta_eta_jet);
-    H5_INSERT(out, SecondaryVertexWithTracks, delta_phi_jet);
-    H5_INSERT(out, SecondaryVertexWithTracks, displacement_significance);
-    H5_INSERT(out, SecondaryVertexWithTracks, associated_tracks);
-    return out;
-  }
-  H5::CompType type(MediumLevelJet) {
-    H5::CompType out(sizeof(MediumLevelJet));
-    H5_INSERT(out, MediumLevelJet, jet_parameters);
-    H5_INSERT(out, MediumLevelJet, primary_vertex_tracks);
-    H5_INSERT(out, MediumLevelJet, secondary_vertices);
-    return out;
-  }
-  H5::CompType type(VLSuperJet) {
-    H5::CompType out(sizeof(VLSuperJet));
-    H5_INSERT(out, VLSuperJet, jet_parameters);
-    H5_INSERT(out, VLSuperJet, tracking);
-    H5_INSERT(out, VLSuperJet, vertex);
-    H5_INSERT(out, VLSuperJet, primary_vertex_tracks);
-    H5_INSERT(out, VLSuperJet, secondary_vertex_tracks);
-    return out;
-  }
+  H5_DEFINE_TYPE(VertexTrack, OUT_VERTEX_TRACK_FIELDS)
+  H5_DEFINE_TYPE(CombinedSecondaryTrack, OUT_COMBINED_SECONDARY_TRACK_FIELDS)
+  H5_DEFINE_TYPE(SecondaryVertex, OUT_SECONDARY_VERTEX_FIELDS)
+  H5_DEFINE_TYPE(SecondaryVertexWithTracks,
+                 OUT_SECONDARY_VERTEX_WITH_TRACKS_FIELDS)
+  H5_DEFINE_TYPE(MediumLevelJet, OUT_MEDIUM_LEVEL_JET_FIELDS)
+  H5_DEFINE_TYPE(VLSuperJet, OUT_VL_SUPER_JET_FIELDS)
 }
 
 //------------------------------------------------------------------------------
 
 void HDF5Writer::Finish()
 {
-  if (m_hl_jet_buffer) {
-    m_hl_jet_buffer->flush();
-    m_hl_jet_buffer->close();
-  }
-  if (m_ml_jet_buffer) {
-    m_ml_jet_buffer->flush();
-    m_ml_jet_buffer->close();
-  }
-  if (m_superjet_buffer) {
-    m_superjet_buffer->flush();
-    m_superjet_buffer->close();
+  // a rank that is done takes part in the flushes of the others
+  if (m_parallel) {
+    while (!sync_ranks(true)) {}
   }
+  close_file();
   if (m_output_stream.is_open()) {
     m_output_stream.close();
   }
+#ifdef H5_HAVE_PARALLEL
+  if (m_mpi_owner) {
+    MPI_Finalize();
+    m_mpi_owner = false;
+  }
+#endif
+}
+
+//------------------------------------------------------------------------------
+
+bool HDF5Writer::sync_ranks(bool finishing)
+{
+#ifdef H5_HAVE_PARALLEL
+  // the largest number of rows waiting on any rank, and whether any
+  // rank still runs
+  int local[2] = {std::max(m_pending_jets, int(m_pending_events.size())),
+                  finishing ? 0 : 1};
+  int global[2] = {0, 0};
+  MPI_Allreduce(local, global, 2, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+  bool done = global[1] == 0;
+  if (global[0] < 1000 && !done) return false;
+
+  // the events and jets of this rank go after those of the ranks
+  // before it, once the rows already in the file
+  h5::Slab jets = h5::collective_slab(MPI_COMM_WORLD, m_pending_jets);
+  h5::Slab events = h5::collective_slab(MPI_COMM_WORLD,
+                                        m_pending_events.size());
+  for (auto& event: m_pending_events) {
+    event.first_jet += m_jets_base + jets.offset;
+    m_event_buffer->push_back(event);
+  }
+  for (int index: m_pending_jet_events) {
+    m_jet_event_index_buffer->push_back(m_events_base + events.offset + index);
+  }
+  flush_buffers();
+
+  m_jets_base += jets.total;
+  m_events_base += events.total;
+  m_pending_events.clear();
+  m_pending_jet_events.clear();
+  m_pending_jets = 0;
+  return done;
+#else
+  return true;
+#endif
+}
+
+//------------------------------------------------------------------------------
+
+void HDF5Writer::flush_buffers()
+{
+  // the same order on all the ranks
+  if (m_hl_jet_buffer) m_hl_jet_buffer->flush();
+  if (m_ml_jet_buffer) m_ml_jet_buffer->flush();
+  if (m_superjet_buffer) m_superjet_buffer->flush();
+  if (m_hl_column_buffer) m_hl_column_buffer->flush();
+  if (m_primary_track_buffer) {
+    m_primary_track_buffer->flush();
+    m_secondary_track_buffer->flush();
+    m_n_primary_buffer->flush();
+    m_n_secondary_buffer->flush();
+  }
+  if (m_weight_buffer) m_weight_buffer->flush();
+  m_event_buffer->flush();
+  m_jet_event_index_buffer->flush();
 }
 
 //------------------------------------------------------------------------------
 
 void HDF5Writer::Process()
 {
+  if (!m_parallel &&
+      ((m_tree_writer && m_tree_writer->GetFileNumber() > m_file_number) ||
+       (m_max_events > 0 && m_file_events >= m_max_events) ||
+       (m_max_bytes > 0 && m_out_file->getFileSize() >= hsize_t(m_max_bytes)))) {
+    roll_over();
+  }
+
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  out::Event event;
+  event.event_number = m_event_number;
+  // in parallel the jets and events count from the last flush
+  event.first_jet = m_parallel ? m_pending_jets : m_n_jets_written;
+  int first_jet = m_n_jets_written;
+  event.n_vertices = fVertexInputArray ?
+    fVertexInputArray->GetEntriesFast() : -1;
+  Candidate* rho = first_candidate(fRhoInputArray);
+  event.rho = rho ? rho->Momentum.E() : nan;
+  Candidate* met = first_candidate(fMissingETInputArray);
+  event.met = met ? met->Momentum.Pt() : nan;
+  event.met_phi = met ? (-met->Momentum).Phi() : nan;
+
   fItInputArray->Reset();
   Candidate* jet;
   while ((jet = static_cast<Candidate*>(fItInputArray->Next()))) {
     const auto& mom = jet->Momentum;
     if (mom.Pt() < fPTMin || std::abs(mom.Eta()) > fAbsEtaMax) continue;
-    if (m_output_stream.is_open()) {
+    if (m_parallel) {
+      m_pending_jet_events.push_back(m_pending_events.size());
+      m_pending_jets++;
+    } else {
+      m_jet_event_index_buffer->push_back(m_file_events);
+    }
+    m_n_jets_written++;
+    if (m_output_stream.is_open() &&
+        (m_n_jets_written - 1) % m_text_sampling == 0) {
       m_output_stream << out::JetTracks(*jet) << "\n";
     }
-    if (m_hl_jet_buffer) m_hl_jet_buffer->push_back(*jet);
-    if (m_ml_jet_buffer) m_ml_jet_buffer->push_back(*jet);
-    if (m_superjet_buffer) m_superjet_buffer->push_back(*jet);
+    // the records are built in the buffers, which keep their storage
+    // between flushes
+    if (m_hl_jet_buffer) m_hl_jet_buffer->emplace_back(*jet);
+    if (m_ml_jet_buffer) m_ml_jet_buffer->emplace_back(*jet);
+    if (m_superjet_buffer) m_superjet_buffer->emplace_back(*jet);
+    if (m_hl_column_buffer) {
+      m_hl_column_buffer->push_back(out::HighLevelJet(*jet));
+    }
+    if (m_primary_track_buffer) {
+      // the counts are the totals, the arrays only hold the leading
+      // MaxTracks of them
+      int n_primary = 0;
+      int n_secondary = 0;
+      m_primary_track_buffer->push_back(
+        get_sorted_primary_tracks(*jet, m_max_tracks, &n_primary));
+      m_secondary_track_buffer->push_back(
+        get_sorted_secondary_tracks(*jet, m_max_tracks, &n_secondary));
+      m_n_primary_buffer->push_back(n_primary);
+      m_n_secondary_buffer->push_back(n_secondary);
+    }
+  }
+  event.n_jets = m_n_jets_written - first_jet;
+  m_event_number++;
+  m_file_events++;
+  if (m_parallel) {
+    m_pending_events.push_back(event);
+    sync_ranks(false);
+  } else {
+    if (m_weight_buffer) {
+      std::copy(fWeights, fWeights + m_n_weights, m_weight_buffer->append());
+    }
+    m_event_buffer->push_back(event);
+  }
+  if (m_swmr && m_file_events % m_swmr_flush_events == 0) {
+    flush_buffers();
   }
 }
 
@@ -408,49 +789,12 @@ void HDF5Writer::Process()
 //
 namespace out {
 // ostream operators
-  std::ostream& operator<<(std::ostream& out, const JetParameters& pars) {
-    out << pars.pt << ", ";
-    out << pars.eta << ", ";
-    out << pars.flavor;
-    return out;
-  }
-  std::ostream& operator<<(std::ostream& out, const HighLevelTracking& pars) {
-    out << pars.track_2_d0_significance << ", ";
-    out << pars.track_3_d0_significance << ", ";
-    out << pars.track_2_z0_significance << ", ";
-    out << pars.track_3_z0_significance << ", ";
-    out << pars.n_tracks_over_d0_threshold << ", ";
-    out << pars.jet_prob << ", ";
-    out << pars.jet_width_eta << ", ";
-    out << pars.jet_width_phi;
-    return out;
-  }
-  std::ostream& operator<<(std::ostream& out,
-			   const HighLevelSecondaryVertex& pars) {
-    out << pars.vertex_significance << ", ";
-    out << pars.n_secondary_vertices << ", ";
-    out << pars.n_secondary_vertex_tracks << ", ";
-    out << pars.delta_r_vertex << ", ";
-    out << pars.vertex_mass << ", ";
-    out << pars.vertex_energy_fraction;
-    return out;
-  }
-  std::ostream& operator<<(std::ostream& out, const HighLevelJet& pars) {
-    out << pars.jet_parameters << ", " << pars.tracking << ", "
-	<< pars.vertex;
-    return out;
-  }
-  std::ostream& operator<<(std::ostream& out, const VertexTrack& pars) {
-    out << pars.d0 << ", ";
-    out << pars.z0 << ", ";
-    out << pars.d0_uncertainty << ", ";
-    out << pars.z0_uncertainty << ", ";
-    out << pars.pt << ", ";
-    out << pars.delta_phi_jet << ", ";
-    out << pars.delta_eta_jet << ", ";
-    out << pars.weight;
-    return out;
-  }
+  H5_DEFINE_OSTREAM(JetParameters, OUT_JET_PARAMETERS_FIELDS)
+  H5_DEFINE_OSTREAM(HighLevelTracking, OUT_HIGH_LEVEL_TRACKING_FIELDS)
+  H5_DEFINE_OSTREAM(HighLevelSecondaryVertex,
+                    OUT_HIGH_LEVEL_SECONDARY_VERTEX_FIELDS)
+  H5_DEFINE_OSTREAM(HighLevelJet, OUT_HIGH_LEVEL_JET_FIELDS)
+  H5_DEFINE_OSTREAM(VertexTrack, OUT_VERTEX_TRACK_FIELDS)
   std::ostream& operator<<(std::ostream& out,
 			   const h5::vector<VertexTrack>& tracks) {
     size_t n_trk = tracks.size();
@@ -462,22 +806,14 @@ namespace out {
     return out;
   }
 
-  std::ostream& operator<<(std::ostream& out, const SecondaryVertex& pars) {
-    out << pars.mass << ", ";
-    out << pars.displacement << ", ";
-    out << pars.delta_eta_jet << ", ";
-    out << pars.delta_phi_jet << ", ";
-    out << pars.displacement_significance;
-    return out;
-  }
+  H5_DEFINE_OSTREAM(SecondaryVertex, OUT_SECONDARY_VERTEX_FIELDS)
 
   std::ostream& operator<<(std::ostream& out,
 			   const SecondaryVertexWithTracks& pars) {
-    out << pars.mass << ", ";
-    out << pars.displacement << ", ";
-    out << pars.delta_eta_jet << ", ";
-    out << pars.delta_phi_jet << ", ";
-    out << pars.displacement_significance << ", [";
+    const char* h5_sep = "";
+    const SecondaryVertexWithTracks& obj = pars;
+    OUT_SECONDARY_VERTEX_FIELDS(H5_STREAM_FIELD)
+    out << ", [";
     out << pars.associated_tracks;
     out << "]";
     return out;
@@ -544,19 +880,38 @@ namespace out {
 
 // utility functions
 namespace {
+  // Sort the tracks, or if there are more than `max_tracks` select the
+  // leading ones first and only sort those. The rest are dropped.
+  template<typename T>
+  void sort_leading(std::vector<T>& tracks, size_t max_tracks,
+                    int* n_total) {
+    if (n_total) *n_total = tracks.size();
+    if (max_tracks == 0 || tracks.size() <= max_tracks) {
+      std::sort(tracks.begin(), tracks.end());
+      return;
+    }
+    auto last = tracks.begin() + max_tracks;
+    std::nth_element(tracks.begin(), last, tracks.end());
+    std::sort(tracks.begin(), last);
+    tracks.erase(last, tracks.end());
+  }
+
   std::vector<out::VertexTrack>
-  get_sorted_primary_tracks(Candidate& jet) {
+  get_sorted_primary_tracks(Candidate& jet, size_t max_tracks,
+                            int* n_total) {
     using namespace out;
     std::vector<VertexTrack> sorted_tracks;
-    for (const auto& trk: jet.primaryVertexTracks) {
+    sorted_tracks.reserve(tagging(jet).primaryVertexTracks.size());
+    for (const auto& trk: tagging(jet).primaryVertexTracks) {
       sorted_tracks.push_back(trk);
     }
-    std::sort(sorted_tracks.begin(), sorted_tracks.end());
+    sort_leading(sorted_tracks, max_tracks, n_total);
     return sorted_tracks;
   }
 
   std::vector<out::CombinedSecondaryTrack>
-  get_sorted_secondary_tracks(Candidate& jet) {
+  get_sorted_secondary_tracks(Candidate& jet, size_t max_tracks,
+                              int* n_total) {
     // When vertices are formed with the AVR method, low weight tracks
     // from the first vertex are reassigned to the following vertex,
     // but not removed from the first vertex. We have to go through
@@ -566,9 +921,10 @@ namespace {
     std::map<Candidate*, double> used;
     int n_overlap = 0;
     std::vector<CombinedSecondaryTrack> sorted_secondary_tracks;
-    for (auto vx = jet.secondaryVertices.crbegin();
-    	 vx != jet.secondaryVertices.crend(); vx++) {
-      for (const auto& trk: vx->tracks_along_jet) {
+    for (auto vx = tagging(jet).secondaryVertices.crbegin();
+    	 vx != tagging(jet).secondaryVertices.crend(); vx++) {
+      for (const auto& trk: vx->tracks_along_jet(
+             tagging(jet).secondaryVertexTracks)) {
         if (!used.count(trk.delphes_track)) {
           sorted_secondary_tracks.emplace_back(trk, *vx);
           used.emplace(trk.delphes_track, trk.weight);
@@ -581,8 +937,32 @@ namespace {
     }
     // std::cout << "used: " << used.size() << " removed: " << n_overlap
     // 	      << std::endl;
-    std::sort(sorted_secondary_tracks.begin(),
-	      sorted_secondary_tracks.end());
+    sort_leading(sorted_secondary_tracks, max_tracks, n_total);
     return sorted_secondary_tracks;
   }
+
+  out::VertexTrack nan_track() {
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    out::VertexTrack track;
+    track.d0 = nan;
+    track.z0 = nan;
+    track.d0_uncertainty = nan;
+    track.z0_uncertainty = nan;
+    track.pt = nan;
+    track.delta_phi_jet = nan;
+    track.delta_eta_jet = nan;
+    track.weight = nan;
+    return track;
+  }
+  out::CombinedSecondaryTrack nan_secondary_track() {
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    out::CombinedSecondaryTrack track;
+    track.track = nan_track();
+    track.vertex.mass = nan;
+    track.vertex.displacement = nan;
+    track.vertex.delta_eta_jet = nan;
+    track.vertex.delta_phi_jet = nan;
+    track.vertex.displacement_significance = nan;
+    return track;
+  }
 }
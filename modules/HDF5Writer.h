@@ -36,13 +36,20 @@ class SecondaryVertexTrack;
 class SecondaryVertex;
 class HighLevelTracking;
 class HighLevelSvx;
+class ExRootTreeWriter;
 
 #include <fstream>
+#include <string>
+#include <vector>
 
 #ifndef __CINT__
 
+#include "external/h5/ArrayBuffer.hh"
 #include "external/h5/OneDimBuffer.hh"
+#include "external/h5/ColumnBuffer.hh"
+#include "external/h5/TwoDimBuffer.hh"
 #include "external/h5/h5container.hh"
+#include "external/h5/h5types.hh"
 
 #include "classes/DelphesModule.h"
 #include "h5/bork.hh"
@@ -53,56 +60,68 @@ namespace out {
 
   typedef float outfloat_t;
 
+  // 4, 5 or 15 for charm, bottom and tau jets, 0 otherwise
+  int simple_flavor(int flav);
+
+  // Each structure that goes into an HDF5 file is described by one
+  // field list (see h5types.hh). The member declarations, `type()`,
+  // and (where the format is a flat list) `operator<<` are generated
+  // from it, in that order.
+
   // ******************** high-level ********************
+#define OUT_JET_PARAMETERS_FIELDS(FIELD)	\
+  FIELD(outfloat_t, pt)				\
+  FIELD(outfloat_t, eta)			\
+  FIELD(int, flavor)
   struct JetParameters {
     JetParameters(Candidate& jet);
     JetParameters() = default;
-    outfloat_t pt;
-    outfloat_t eta;
-    int flavor;
+    OUT_JET_PARAMETERS_FIELDS(H5_DECLARE_FIELD)
   };
   H5::CompType type(JetParameters);
   std::ostream& operator<<(std::ostream&, const JetParameters&);
 
+#define OUT_HIGH_LEVEL_TRACKING_FIELDS(FIELD)		\
+  FIELD(outfloat_t, track_2_d0_significance)		\
+  FIELD(outfloat_t, track_3_d0_significance)		\
+  FIELD(outfloat_t, track_2_z0_significance)		\
+  FIELD(outfloat_t, track_3_z0_significance)		\
+  FIELD(int, n_tracks_over_d0_threshold)		\
+  FIELD(outfloat_t, jet_prob)				\
+  FIELD(outfloat_t, jet_width_eta)			\
+  FIELD(outfloat_t, jet_width_phi)
   struct HighLevelTracking {
     HighLevelTracking(const ::HighLevelTracking&);
     HighLevelTracking() = default;
-    outfloat_t track_2_d0_significance;
-    outfloat_t track_3_d0_significance;
-    outfloat_t track_2_z0_significance;
-    outfloat_t track_3_z0_significance;
-    int    n_tracks_over_d0_threshold;
-    outfloat_t jet_prob;
-    outfloat_t jet_width_eta;
-    outfloat_t jet_width_phi;
+    OUT_HIGH_LEVEL_TRACKING_FIELDS(H5_DECLARE_FIELD)
   };
   H5::CompType type(HighLevelTracking);
   std::ostream& operator<<(std::ostream&, const HighLevelTracking&);
 
+#define OUT_HIGH_LEVEL_SECONDARY_VERTEX_FIELDS(FIELD)	\
+  FIELD(outfloat_t, vertex_significance)		\
+  FIELD(int, n_secondary_vertices)			\
+  FIELD(int, n_secondary_vertex_tracks)			\
+  FIELD(outfloat_t, delta_r_vertex)			\
+  FIELD(outfloat_t, vertex_mass)			\
+  FIELD(outfloat_t, vertex_energy_fraction)
   struct HighLevelSecondaryVertex {
     HighLevelSecondaryVertex(const ::HighLevelSvx&);
     HighLevelSecondaryVertex() = default;
-    outfloat_t vertex_significance;
-    int    n_secondary_vertices;
-    int    n_secondary_vertex_tracks;
-    outfloat_t delta_r_vertex;
-    outfloat_t vertex_mass;
-    outfloat_t vertex_energy_fraction;
+    OUT_HIGH_LEVEL_SECONDARY_VERTEX_FIELDS(H5_DECLARE_FIELD)
   };
   H5::CompType type(HighLevelSecondaryVertex);
   std::ostream& operator<<(std::ostream&, const HighLevelSecondaryVertex&);
 
+  // basic parameters, track-based, and secondary vertex
+#define OUT_HIGH_LEVEL_JET_FIELDS(FIELD)		\
+  FIELD(JetParameters, jet_parameters)			\
+  FIELD(HighLevelTracking, tracking)			\
+  FIELD(HighLevelSecondaryVertex, vertex)
   struct HighLevelJet {
     HighLevelJet(Candidate& jet);
     HighLevelJet() = default;
-    // basic parameters
-    JetParameters jet_parameters;
-
-    // track-based
-    HighLevelTracking tracking;
-
-    // secondary vertex
-    HighLevelSecondaryVertex vertex;
+    OUT_HIGH_LEVEL_JET_FIELDS(H5_DECLARE_FIELD)
   };
   H5::CompType type(HighLevelJet);
   std::ostream& operator<<(std::ostream&, const HighLevelJet&);
@@ -110,58 +129,62 @@ namespace out {
 
   // ******************** medium level ********************
 
+#define OUT_VERTEX_TRACK_FIELDS(FIELD)		\
+  FIELD(outfloat_t, d0)				\
+  FIELD(outfloat_t, z0)				\
+  FIELD(outfloat_t, d0_uncertainty)		\
+  FIELD(outfloat_t, z0_uncertainty)		\
+  FIELD(outfloat_t, pt)				\
+  FIELD(outfloat_t, delta_phi_jet)		\
+  FIELD(outfloat_t, delta_eta_jet)		\
+  FIELD(outfloat_t, weight)
   struct VertexTrack {
     VertexTrack(const SecondaryVertexTrack&);
     VertexTrack() = default;
-    outfloat_t d0;
-    outfloat_t z0;
-    outfloat_t d0_uncertainty;
-    outfloat_t z0_uncertainty;
-    outfloat_t pt;
-    outfloat_t delta_phi_jet;
-    outfloat_t delta_eta_jet;
-    outfloat_t weight;
+    OUT_VERTEX_TRACK_FIELDS(H5_DECLARE_FIELD)
   };
   H5::CompType type(VertexTrack);
   std::ostream& operator<<(std::ostream&, const VertexTrack&);
   std::ostream& operator<<(std::ostream&, const h5::vector<VertexTrack>&);
   bool operator<(const VertexTrack& v1, const VertexTrack& v2);
 
+#define OUT_SECONDARY_VERTEX_FIELDS(FIELD)	\
+  FIELD(outfloat_t, mass)			\
+  FIELD(outfloat_t, displacement)		\
+  FIELD(outfloat_t, delta_eta_jet)		\
+  FIELD(outfloat_t, delta_phi_jet)		\
+  FIELD(outfloat_t, displacement_significance)
   struct SecondaryVertex {
     SecondaryVertex(const ::SecondaryVertex&);
     SecondaryVertex() = default;
-    outfloat_t mass;
-    outfloat_t displacement;
-    outfloat_t delta_eta_jet;
-    outfloat_t delta_phi_jet;
-    outfloat_t displacement_significance;
+    OUT_SECONDARY_VERTEX_FIELDS(H5_DECLARE_FIELD)
   };
   H5::CompType type(SecondaryVertex);
   std::ostream& operator<<(std::ostream&, const SecondaryVertex&);
   std::ostream& operator<<(std::ostream&, const h5::vector<SecondaryVertex>&);
 
-  // TODO: modify the above struct to represent the vertex variables here
+  // same vertex variables as above, plus the tracks
+#define OUT_SECONDARY_VERTEX_WITH_TRACKS_FIELDS(FIELD)	\
+  OUT_SECONDARY_VERTEX_FIELDS(FIELD)			\
+  FIELD(h5::vector<VertexTrack>, associated_tracks)
   struct SecondaryVertexWithTracks {
-    SecondaryVertexWithTracks(const ::SecondaryVertex&);
+    SecondaryVertexWithTracks(const ::SecondaryVertex&,
+                              const std::vector<SecondaryVertexTrack>&);
     SecondaryVertexWithTracks() = default;
-    outfloat_t mass;
-    outfloat_t displacement;
-    outfloat_t delta_eta_jet;
-    outfloat_t delta_phi_jet;
-    outfloat_t displacement_significance;
-    h5::vector<VertexTrack> associated_tracks;
+    OUT_SECONDARY_VERTEX_WITH_TRACKS_FIELDS(H5_DECLARE_FIELD)
   };
   H5::CompType type(SecondaryVertexWithTracks);
   std::ostream& operator<<(std::ostream&, const SecondaryVertexWithTracks&);
   std::ostream& operator<<(std::ostream&, const h5::vector<SecondaryVertexWithTracks>&);
 
+#define OUT_MEDIUM_LEVEL_JET_FIELDS(FIELD)			\
+  FIELD(JetParameters, jet_parameters)				\
+  FIELD(h5::vector<VertexTrack>, primary_vertex_tracks)		\
+  FIELD(h5::vector<SecondaryVertexWithTracks>, secondary_vertices)
   struct MediumLevelJet {
     MediumLevelJet(Candidate& jet);
     MediumLevelJet() = default;
-    JetParameters jet_parameters;
-
-    h5::vector<VertexTrack> primary_vertex_tracks;
-    h5::vector<SecondaryVertexWithTracks> secondary_vertices;
+    OUT_MEDIUM_LEVEL_JET_FIELDS(H5_DECLARE_FIELD)
   };
   H5::CompType type(MediumLevelJet);
   std::ostream& operator<<(std::ostream&, const MediumLevelJet&);
@@ -184,14 +207,16 @@ namespace out {
   // ******************** medium 2.0 objects ********************
   // Secondary vertex info is added to the tracks in these collections
 
+#define OUT_COMBINED_SECONDARY_TRACK_FIELDS(FIELD)	\
+  FIELD(VertexTrack, track)				\
+  FIELD(SecondaryVertex, vertex)
   struct CombinedSecondaryTrack {
     CombinedSecondaryTrack(const SecondaryVertexTrack&,
                            const ::SecondaryVertex&);
     CombinedSecondaryTrack(const VertexTrack&,
                            const ::SecondaryVertex&);
     CombinedSecondaryTrack() = default;
-    VertexTrack track;
-    SecondaryVertex vertex;
+    OUT_COMBINED_SECONDARY_TRACK_FIELDS(H5_DECLARE_FIELD)
   };
   H5::CompType type(CombinedSecondaryTrack);
   std::ostream& operator<<(std::ostream&, const CombinedSecondaryTrack&);
@@ -199,18 +224,16 @@ namespace out {
                            const h5::vector<CombinedSecondaryTrack>&);
   bool operator<(const CombinedSecondaryTrack&,
                  const CombinedSecondaryTrack&);
-  H5::CompType type(CombinedSecondaryTrack);
 
+  // high level, then medium level
+#define OUT_VL_SUPER_JET_FIELDS(FIELD)				\
+  OUT_HIGH_LEVEL_JET_FIELDS(FIELD)				\
+  FIELD(h5::vector<VertexTrack>, primary_vertex_tracks)		\
+  FIELD(h5::vector<CombinedSecondaryTrack>, secondary_vertex_tracks)
   struct VLSuperJet {
     VLSuperJet(Candidate& jet);
     VLSuperJet() = default;
-    JetParameters jet_parameters;
-    HighLevelTracking tracking;
-    HighLevelSecondaryVertex vertex;
-
-    // medium level
-    h5::vector<VertexTrack> primary_vertex_tracks;
-    h5::vector<CombinedSecondaryTrack> secondary_vertex_tracks;
+    OUT_VL_SUPER_JET_FIELDS(H5_DECLARE_FIELD)
   };
   std::ostream& operator<<(std::ostream&, const VLSuperJet&);
   H5::CompType type(VLSuperJet);
@@ -227,6 +250,22 @@ namespace out {
     h5::vector<CombinedSecondaryTrack> all_tracks;
   };
   std::ostream& operator<<(std::ostream&, const JetTracks&);
+
+  // ******************** event level ********************
+  // Jets that pass the selection are written to `jets` in order, so
+  // `first_jet` and `n_jets` index into that dataset.
+#define OUT_EVENT_FIELDS(FIELD)			\
+  FIELD(int, event_number)			\
+  FIELD(int, first_jet)				\
+  FIELD(int, n_jets)				\
+  FIELD(int, n_vertices)			\
+  FIELD(outfloat_t, rho)			\
+  FIELD(outfloat_t, met)			\
+  FIELD(outfloat_t, met_phi)
+  struct Event {
+    OUT_EVENT_FIELDS(H5_DECLARE_FIELD)
+  };
+  H5::CompType type(Event);
 }
 
 #else  // CINT include dummy
@@ -250,10 +289,29 @@ public:
 
 private:
 
+  void open_file(const std::string& name);
+  void close_file();
+  void roll_over();
+  std::string file_name(int number) const;
+
+  // collective flush of the MPI ranks, see Parallel, returns true
+  // once all the ranks are finishing
+  bool sync_ranks(bool finishing);
+  void flush_buffers();
+
   TIterator *fItInputArray; //!
 
   const TObjArray *fInputArray; //!
 
+  // optional event-level inputs
+  const TObjArray *fMissingETInputArray; //!
+  const TObjArray *fRhoInputArray; //!
+  const TObjArray *fVertexInputArray; //!
+
+  // weights of all the sets of a Weighter, see WeightInputArray
+  const Double_t *fWeights; //!
+  int m_n_weights;
+
   H5::H5File* m_out_file;
 
   double fPTMin;
@@ -263,9 +321,51 @@ private:
   OneDimBuffer<out::HighLevelJet>* m_hl_jet_buffer;
   OneDimBuffer<out::MediumLevelJet>* m_ml_jet_buffer;
   OneDimBuffer<out::VLSuperJet>* m_superjet_buffer;
+  ColumnBuffer<out::HighLevelJet>* m_hl_column_buffer;
+  TwoDimBuffer<out::VertexTrack>* m_primary_track_buffer;
+  TwoDimBuffer<out::CombinedSecondaryTrack>* m_secondary_track_buffer;
+  OneDimBuffer<int>* m_n_primary_buffer;
+  OneDimBuffer<int>* m_n_secondary_buffer;
+  OneDimBuffer<out::Event>* m_event_buffer;
+  OneDimBuffer<int>* m_jet_event_index_buffer;
+  ArrayBuffer<float>* m_weight_buffer;
+  h5::DatasetOptions m_ds_opts;
 #endif
+  std::string m_layout;
+  int m_max_tracks;
+  bool m_async;
+
+  // single-writer/multiple-reader output, flushed every few events
+  bool m_swmr;
+  int m_swmr_flush_events;
+
+  // rollover to numbered files, see ExRootTreeWriter::SetMaxEventsPerFile
+  ExRootTreeWriter* m_tree_writer; //!
+  long m_max_events;
+  long m_max_bytes;
+  std::string m_file_base;
+  std::string m_file_extension;
+  int m_file_number;
+  int m_file_events;
+
+  int m_event_number;
+  int m_n_jets_written;
+  int m_text_sampling;
   std::ofstream m_output_stream;
 
+  // With Parallel the MPI ranks write into one file. The events and
+  // the jet event indices wait here until the ranks flush together,
+  // when their positions in the shared datasets are known.
+  bool m_parallel;
+  bool m_mpi_owner;
+#ifndef __CINT__
+  std::vector<out::Event> m_pending_events;
+#endif
+  std::vector<int> m_pending_jet_events;
+  int m_pending_jets;
+  int m_jets_base;
+  int m_events_base;
+
   ClassDef(HDF5Writer, 1)
 };
 
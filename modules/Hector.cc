@@ -21,6 +21,9 @@
  *
  *  Propagates candidates using Hector library.
  *
+ *  With UseTransportMap the transport of a particle species is tabulated
+ *  the first time the species is seen, see Hector.h.
+ *
  *  \author P. Demin - UCL, Louvain-la-Neuve
  *
  */
@@ -42,20 +45,287 @@
 #include "TObjArray.h"
 #include "TDatabasePDG.h"
 #include "TLorentzVector.h"
+#include "TMD5.h"
+#include "TSystem.h"
 
 #include <algorithm>
 #include <stdexcept>
 #include <iostream>
+#include <iterator>
+#include <fstream>
 #include <sstream>
+#include <vector>
+
+#include <stdio.h>
 
 #include "Hector/H_BeamLine.h"
 #include "Hector/H_RecRPObject.h"
 #include "Hector/H_BeamParticle.h"
+#include "Hector/H_Drift.h"
+#include "Hector/H_Marker.h"
+#include "Hector/H_SectorDipole.h"
+#include "Hector/H_RectangularDipole.h"
+#include "Hector/H_HorizontalQuadrupole.h"
+#include "Hector/H_VerticalQuadrupole.h"
+#include "Hector/H_HorizontalKicker.h"
+#include "Hector/H_VerticalKicker.h"
+#include "Hector/H_RectangularCollimator.h"
+#include "Hector/H_RectangularAperture.h"
+#include "Hector/H_EllipticAperture.h"
+#include "Hector/H_CircularAperture.h"
+#include "Hector/H_RectEllipticAperture.h"
 
 using namespace std;
 
 //------------------------------------------------------------------------------
 
+// Transport of one particle species through the beam line, tabulated on a
+// grid of the relative energy loss. At each node the position after every
+// element is stored as an affine function of (x, tan(tx), y, tan(ty)) at the
+// interaction point; in between nodes the coefficients are interpolated.
+
+class HectorTransportMap
+{
+public:
+
+  HectorTransportMap(const H_AbstractBeamLine *beamLine, Float_t mass, Float_t charge,
+    Double_t xiMin, Double_t xiMax, Int_t nodes, Double_t distance);
+
+  // returns false if the particle is not covered by the table
+
+  Bool_t Transport(Double_t x, Double_t y, Double_t tx, Double_t ty, Double_t s, Double_t energy,
+    Bool_t &stopped, Double_t &xOut, Double_t &yOut, Double_t &txOut, Double_t &tyOut) const;
+
+private:
+
+  void Position(Int_t node, Double_t f, Int_t i, const Double_t *u, Double_t *result) const;
+
+  const H_AbstractBeamLine *fBeamLine;
+
+  Double_t fXiMin, fXiStep;
+  Int_t fNodes;
+
+  Double_t fDistance;
+
+  // number of positions after the interaction point, one for each element
+  Int_t fPositions;
+
+  // index of the first position at or after the detector, 0 if none
+  Int_t fDetector;
+  Double_t fDetectorS, fPreviousS;
+
+  // elements with an aperture
+  vector< Int_t > fApertures;
+
+  // x and y coefficients for each node and position
+  vector< Double_t > fCoefficients;
+
+  // tan(tx) and tan(ty) coefficients before the detector for each node
+  vector< Double_t > fAngleCoefficients;
+};
+
+//------------------------------------------------------------------------------
+
+HectorTransportMap::HectorTransportMap(const H_AbstractBeamLine *beamLine, Float_t mass, Float_t charge,
+  Double_t xiMin, Double_t xiMax, Int_t nodes, Double_t distance) :
+  fBeamLine(beamLine), fXiMin(xiMin), fXiStep((xiMax - xiMin)/(nodes - 1)), fNodes(nodes),
+  fDistance(distance), fPositions(beamLine->getNumberOfElements()), fDetector(0),
+  fDetectorS(0.0), fPreviousS(0.0)
+{
+  extern bool relative_energy;
+
+  const H_OpticalElement *element;
+  Int_t node, i, j, row;
+  Double_t energyLoss, energy, s;
+  Double_t *coefficients, *angles;
+
+  for(i = 0; i < fPositions; ++i)
+  {
+    element = fBeamLine->getElement(i);
+    if(element->getAperture()->getType() != NONE) fApertures.push_back(i);
+
+    s = element->getS() + element->getLength();
+    if(!fDetector && s >= fDistance)
+    {
+      fDetector = i + 1;
+      fDetectorS = s;
+    }
+    else if(!fDetector)
+    {
+      fPreviousS = s;
+    }
+  }
+
+  fCoefficients.resize(fNodes*fPositions*10);
+  fAngleCoefficients.resize(fNodes*10);
+
+  for(node = 0; node < fNodes; ++node)
+  {
+    energyLoss = (fXiMin + node*fXiStep)*BE;
+    energy = BE - energyLoss;
+
+    // first row transports the origin, the others a unit step in one
+    // of the coordinates, as in H_BeamParticle::computePath
+
+    TMatrixD mat(5, MDIM);
+    for(row = 0; row < 5; ++row)
+    {
+      if(row > 0) mat[row][row - 1] = 1.0;
+      mat[row][4] = relative_energy ? energy - BE : energy;
+      mat[row][5] = 1.0;
+    }
+
+    coefficients = &fCoefficients[node*fPositions*10];
+    angles = &fAngleCoefficients[node*10];
+
+    for(i = 0; i < fPositions; ++i)
+    {
+      element = fBeamLine->getElement(i);
+      for(row = 0; row < 5; ++row)
+      {
+        mat[row][0] -= element->getX();
+        mat[row][1] -= TMath::Tan(element->getTX()/URAD)*URAD;
+        mat[row][2] -= element->getY();
+        mat[row][3] -= TMath::Tan(element->getTY()/URAD)*URAD;
+      }
+      mat *= element->getMatrix(energyLoss, mass, charge);
+      for(row = 0; row < 5; ++row)
+      {
+        mat[row][0] += element->getX();
+        mat[row][1] += TMath::Tan(element->getTX()/URAD)*URAD;
+        mat[row][2] += element->getY();
+        mat[row][3] += TMath::Tan(element->getTY()/URAD)*URAD;
+      }
+
+      for(j = 0; j < 2; ++j)
+      {
+        coefficients[i*10 + j*5] = mat[0][2*j];
+        for(row = 1; row < 5; ++row)
+        {
+          coefficients[i*10 + j*5 + row] = mat[row][2*j] - mat[0][2*j];
+        }
+      }
+
+      if(i + 2 == fDetector)
+      {
+        for(j = 0; j < 2; ++j)
+        {
+          angles[j*5] = mat[0][2*j + 1];
+          for(row = 1; row < 5; ++row)
+          {
+            angles[j*5 + row] = mat[row][2*j + 1] - mat[0][2*j + 1];
+          }
+        }
+      }
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+Bool_t HectorTransportMap::Transport(Double_t x, Double_t y, Double_t tx, Double_t ty, Double_t s, Double_t energy,
+  Bool_t &stopped, Double_t &xOut, Double_t &yOut, Double_t &txOut, Double_t &tyOut) const
+{
+  Int_t node, i, j, k;
+  Double_t xi, t, f, previousS;
+  Double_t u[5], value[2], previous[2], current[2];
+  const Double_t *low, *high;
+  vector< Int_t >::const_iterator itApertures;
+
+  if(fDetector == 0 || s >= fDistance) return kFALSE;
+
+  previousS = fDetector == 1 ? s : fPreviousS;
+  if(fDetectorS == previousS) return kFALSE;
+
+  xi = (BE - energy)/BE;
+  t = (xi - fXiMin)/fXiStep;
+  if(t < 0.0 || t > fNodes - 1) return kFALSE;
+
+  node = TMath::Min(Int_t(t), fNodes - 2);
+  f = t - node;
+
+  u[0] = 1.0;
+  u[1] = x/URAD;
+  u[2] = TMath::Tan(tx/URAD);
+  u[3] = y/URAD;
+  u[4] = TMath::Tan(ty/URAD);
+
+  // same as H_BeamParticle::stopped
+
+  stopped = kFALSE;
+  for(itApertures = fApertures.begin(); itApertures != fApertures.end(); ++itApertures)
+  {
+    i = *itApertures;
+    if(i == 0)
+    {
+      previous[0] = x;
+      previous[1] = y;
+    }
+    else
+    {
+      Position(node, f, i - 1, u, previous);
+    }
+    Position(node, f, i, u, current);
+
+    const H_OpticalElement *element = fBeamLine->getElement(i);
+    if(!element->isInside(previous[0], previous[1]) || !element->isInside(current[0], current[1]))
+    {
+      stopped = kTRUE;
+      return kTRUE;
+    }
+  }
+
+  // same as H_BeamParticle::propagate
+
+  if(fDetector == 1)
+  {
+    previous[0] = x;
+    previous[1] = y;
+    txOut = tx;
+    tyOut = ty;
+  }
+  else
+  {
+    Position(node, f, fDetector - 2, u, previous);
+
+    low = &fAngleCoefficients[node*10];
+    high = low + 10;
+    for(j = 0; j < 2; ++j)
+    {
+      value[j] = 0.0;
+      for(k = 0; k < 5; ++k) value[j] += ((1.0 - f)*low[j*5 + k] + f*high[j*5 + k])*u[k];
+    }
+    txOut = TMath::ATan(value[0])*URAD;
+    tyOut = TMath::ATan(value[1])*URAD;
+  }
+  Position(node, f, fDetector - 1, u, current);
+
+  xOut = previous[0] + (fDistance - previousS)*(current[0] - previous[0])/(fDetectorS - previousS);
+  yOut = previous[1] + (fDistance - previousS)*(current[1] - previous[1])/(fDetectorS - previousS);
+
+  return kTRUE;
+}
+
+//------------------------------------------------------------------------------
+
+void HectorTransportMap::Position(Int_t node, Double_t f, Int_t i, const Double_t *u, Double_t *result) const
+{
+  // x and y in um after the i-th element
+
+  const Double_t *low = &fCoefficients[(node*fPositions + i)*10];
+  const Double_t *high = low + fPositions*10;
+  Int_t j, k;
+
+  for(j = 0; j < 2; ++j)
+  {
+    result[j] = 0.0;
+    for(k = 0; k < 5; ++k) result[j] += ((1.0 - f)*low[j*5 + k] + f*high[j*5 + k])*u[k];
+    result[j] *= URAD;
+  }
+}
+
+//------------------------------------------------------------------------------
+
 Hector::Hector() :
   fBeamLine(0), fItInputArray(0)
 {
@@ -71,6 +341,8 @@ Hector::~Hector()
 
 void Hector::Init()
 {
+  stringstream message;
+
   // read Hector parameters
 
   fDirection = GetInt("Direction", 1);
@@ -84,8 +356,50 @@ void Hector::Init()
   fSigmaT = GetDouble("SigmaT", 0.0);
   fEtaMin = GetDouble("EtaMin", 5.0);
 
+  fUseTransportMap = GetBool("UseTransportMap", false);
+  fTransportMapXiMin = GetDouble("TransportMapXiMin", 0.0);
+  fTransportMapXiMax = GetDouble("TransportMapXiMax", 0.2);
+  fTransportMapNodes = GetInt("TransportMapNodes", 201);
+
+  if(fUseTransportMap && (fTransportMapNodes < 2 || fTransportMapXiMax <= fTransportMapXiMin))
+  {
+    throw runtime_error("TransportMapNodes should be at least 2 and TransportMapXiMax larger than TransportMapXiMin");
+  }
+
+  const char *beamLineFile = GetString("BeamLineFile", "cards/LHCB1IR5_5TeV.tfs");
+  const char *ipName = GetString("IPName", "IP5");
+  TString cacheDir = GetString("BeamLineCacheDir", "");
+  TString cacheFile;
+
   fBeamLine = new H_BeamLine(fDirection, fBeamLineLength + 0.1);
-  fBeamLine->fill(GetString("BeamLineFile", "cards/LHCB1IR5_5TeV.tfs"), fDirection, GetString("IPName", "IP5"));
+
+  if(cacheDir.Length() > 0)
+  {
+    // key on the content of the file and on the parsing parameters
+
+    ifstream file(beamLineFile, ios::binary);
+    if(!file.is_open())
+    {
+      message << "can't open beam line file " << beamLineFile;
+      throw runtime_error(message.str());
+    }
+    string content((istreambuf_iterator< char >(file)), istreambuf_iterator< char >());
+    stringstream key;
+    key << content << '\n' << fDirection << ' ' << fBeamLineLength + 0.1 << ' ' << ipName;
+    content = key.str();
+
+    TMD5 md5;
+    md5.Update(reinterpret_cast< const UChar_t * >(content.data()), content.size());
+    md5.Final();
+    cacheFile = cacheDir + "/Hector_" + md5.AsString() + ".bin";
+  }
+
+  if(cacheFile.Length() == 0 || !ReadBeamLineCache(cacheFile))
+  {
+    fBeamLine->fill(beamLineFile, fDirection, ipName);
+    if(cacheFile.Length() > 0) WriteBeamLineCache(cacheFile);
+  }
+
   fBeamLine->offsetElements(fOffsetS, fOffsetX);
   fBeamLine->calcMatrix();
 
@@ -103,6 +417,14 @@ void Hector::Init()
 
 void Hector::Finish()
 {
+  map< pair< Float_t, Float_t >, HectorTransportMap * >::iterator itTransportMaps;
+
+  for(itTransportMaps = fTransportMaps.begin(); itTransportMaps != fTransportMaps.end(); ++itTransportMaps)
+  {
+    delete itTransportMaps->second;
+  }
+  fTransportMaps.clear();
+
   if(fItInputArray) delete fItInputArray;
   if(fBeamLine) delete fBeamLine;
 }
@@ -115,6 +437,11 @@ void Hector::Process()
   Double_t pz;
   Double_t x, y, z, tx, ty, theta;
   Double_t distance, time;
+  Double_t energy, xOut, yOut, txOut, tyOut;
+  Bool_t stopped;
+  pair< Float_t, Float_t > key;
+  map< pair< Float_t, Float_t >, HectorTransportMap * >::iterator itTransportMaps;
+  HectorTransportMap *transportMap;
 
   const Double_t c_light = 2.99792458E8;
 
@@ -139,7 +466,39 @@ void Hector::Process()
 
     theta = TMath::Hypot(TMath::ATan(candidateMomentum.Px()/pz), TMath::ATan(candidateMomentum.Py()/pz));
     distance = (fDistance - 1.0E-3 * candidatePosition.Z())/TMath::Cos(theta);
-    time = gRandom->Gaus((distance + 1.0E-3 * candidatePosition.T())/c_light, fSigmaT);
+    time = GetRandom()->Gaus((distance + 1.0E-3 * candidatePosition.T())/c_light, fSigmaT);
+
+    if(fUseTransportMap)
+    {
+      // same random numbers as H_BeamParticle::smearAng and smearE
+      tx = GetRandom()->Gaus(tx, fSigmaX);
+      ty = GetRandom()->Gaus(ty, fSigmaY);
+      energy = GetRandom()->Gaus(candidateMomentum.E(), fSigmaE);
+
+      key = make_pair(candidate->Mass, Float_t(candidate->Charge));
+      itTransportMaps = fTransportMaps.find(key);
+      if(itTransportMaps == fTransportMaps.end())
+      {
+        transportMap = new HectorTransportMap(fBeamLine, key.first, key.second,
+          fTransportMapXiMin, fTransportMapXiMax, fTransportMapNodes, fDistance);
+        itTransportMaps = fTransportMaps.insert(make_pair(key, transportMap)).first;
+      }
+      transportMap = itTransportMaps->second;
+
+      if(transportMap->Transport(x, y, tx, ty, z, energy, stopped, xOut, yOut, txOut, tyOut))
+      {
+        if(stopped) continue;
+
+        mother = candidate;
+        candidate = static_cast<Candidate*>(candidate->Clone());
+        candidate->Position.SetXYZT(xOut, yOut, fDistance, time);
+        candidate->Momentum.SetPxPyPzE(txOut, tyOut, 0.0, energy);
+        candidate->AddCandidate(mother);
+
+        fOutputArray->Add(candidate);
+        continue;
+      }
+    }
 
     H_BeamParticle particle(candidate->Mass, candidate->Charge);
 //    particle.set4Momentum(candidateMomentum);
@@ -147,8 +506,16 @@ void Hector::Process()
                           candidateMomentum.Pz(), candidateMomentum.E());
     particle.setPosition(x, y, tx, ty, z);
 
-    particle.smearAng(fSigmaX, fSigmaY, gRandom);
-    particle.smearE(fSigmaE, gRandom);
+    if(fUseTransportMap)
+    {
+      // out of the table, already smeared
+      particle.setE(energy);
+    }
+    else
+    {
+      particle.smearAng(fSigmaX, fSigmaY, GetRandom());
+      particle.smearE(fSigmaE, GetRandom());
+    }
 
     particle.computePath(fBeamLine);
 
@@ -167,3 +534,184 @@ void Hector::Process()
 }
 
 //------------------------------------------------------------------------------
+
+namespace
+{
+  const char kBeamLineCacheMagic[] = "DelphesHectorBeamLine1";
+
+  template< typename T >
+  void WriteValue(ostream &out, const T &value)
+  {
+    out.write(reinterpret_cast< const char * >(&value), sizeof(T));
+  }
+
+  template< typename T >
+  void ReadValue(istream &in, T &value)
+  {
+    in.read(reinterpret_cast< char * >(&value), sizeof(T));
+  }
+}
+
+//------------------------------------------------------------------------------
+
+Bool_t Hector::ReadBeamLineCache(const char *fileName)
+{
+  ifstream in(fileName, ios::binary);
+  if(!in.is_open()) return kFALSE;
+
+  char magic[sizeof(kBeamLineCacheMagic)];
+  in.read(magic, sizeof(magic));
+  if(!in || string(magic, sizeof(magic)) != string(kBeamLineCacheMagic, sizeof(kBeamLineCacheMagic))) return kFALSE;
+
+  vector< H_OpticalElement * > elements;
+  vector< H_OpticalElement * >::iterator itElements;
+  H_OpticalElement *element;
+  H_Aperture *aperture;
+  Int_t type, apertureType, length;
+  UInt_t i, size;
+  Double_t s, k, l, betaX, betaY, dX, dY, relX, relY;
+  Float_t x1, x2, x3, x4;
+  string name;
+  Bool_t valid = kTRUE;
+
+  ReadValue(in, size);
+  for(i = 0; in && valid && i < size; ++i)
+  {
+    ReadValue(in, type);
+    ReadValue(in, length);
+    if(!in || length < 0) break;
+    name.resize(length);
+    if(length > 0) in.read(&name[0], length);
+    ReadValue(in, s);
+    ReadValue(in, k);
+    ReadValue(in, l);
+    ReadValue(in, betaX);
+    ReadValue(in, betaY);
+    ReadValue(in, dX);
+    ReadValue(in, dY);
+    ReadValue(in, relX);
+    ReadValue(in, relY);
+    ReadValue(in, apertureType);
+    ReadValue(in, x1);
+    ReadValue(in, x2);
+    ReadValue(in, x3);
+    ReadValue(in, x4);
+    if(!in) break;
+
+    // same classes as H_BeamLine::fill and H_AbstractBeamLine::calcSequence
+
+    switch(type)
+    {
+      case DRIFT: element = new H_Drift(name, s, l); break;
+      case RDIPOLE: element = new H_RectangularDipole(name, s, k, l); break;
+      case SDIPOLE: element = new H_SectorDipole(name, s, k, l); break;
+      case VQUADRUPOLE: element = new H_VerticalQuadrupole(name, s, k, l); break;
+      case HQUADRUPOLE: element = new H_HorizontalQuadrupole(name, s, k, l); break;
+      case VKICKER: element = new H_VerticalKicker(name, s, k, l); break;
+      case HKICKER: element = new H_HorizontalKicker(name, s, k, l); break;
+      case RCOLLIMATOR: element = new H_RectangularCollimator(name, s, l); break;
+      case MARKER: element = new H_Marker(name, s); break;
+      default: element = 0; valid = kFALSE; break;
+    }
+    if(!element) break;
+
+    element->setBetaX(betaX);
+    element->setBetaY(betaY);
+    element->setDX(dX);
+    element->setDY(dY);
+    element->setRelX(relX);
+    element->setRelY(relY);
+    elements.push_back(element);
+
+    switch(apertureType)
+    {
+      case NONE: aperture = 0; break;
+      case RECTANGULAR: aperture = new H_RectangularAperture(x1, x2, 0, 0); break;
+      case ELLIPTIC: aperture = new H_EllipticAperture(x1, x2, 0, 0); break;
+      case CIRCULAR: aperture = new H_CircularAperture(x1, 0, 0); break;
+      case RECTELLIPSE: aperture = new H_RectEllipticAperture(x1, x2, x3, x4, 0, 0); break;
+      default: aperture = 0; valid = kFALSE; break;
+    }
+    if(aperture) element->setAperture(aperture);
+  }
+
+  if(!valid || i < size || !in)
+  {
+    for(itElements = elements.begin(); itElements != elements.end(); ++itElements)
+    {
+      delete *itElements;
+    }
+    return kFALSE;
+  }
+
+  fBeamLine->setElements(elements);
+
+  return kTRUE;
+}
+
+//------------------------------------------------------------------------------
+
+void Hector::WriteBeamLineCache(const char *fileName)
+{
+  const H_OpticalElement *element;
+  const H_Aperture *aperture;
+  Int_t i, type, apertureType, length;
+  UInt_t size;
+  string name;
+
+  // write to a temporary file first, other jobs may read the cache meanwhile
+
+  TString dir = gSystem->DirName(fileName);
+  gSystem->mkdir(dir, kTRUE);
+
+  TString temporaryFile = TString::Format("%s.%d", fileName, gSystem->GetPid());
+  ofstream out(temporaryFile.Data(), ios::binary);
+  if(!out.is_open())
+  {
+    cerr << "** WARNING: can't write beam line cache " << fileName << endl;
+    return;
+  }
+
+  out.write(kBeamLineCacheMagic, sizeof(kBeamLineCacheMagic));
+
+  size = fBeamLine->getNumberOfElements();
+  WriteValue(out, size);
+  for(i = 0; i < fBeamLine->getNumberOfElements(); ++i)
+  {
+    element = fBeamLine->getElement(i);
+    aperture = element->getAperture();
+
+    type = element->getType();
+    name = element->getName();
+    length = name.size();
+    WriteValue(out, type);
+    WriteValue(out, length);
+    out.write(name.data(), length);
+
+    WriteValue< Double_t >(out, element->getS());
+    WriteValue< Double_t >(out, element->getK());
+    WriteValue< Double_t >(out, element->getLength());
+    WriteValue< Double_t >(out, element->getBetaX());
+    WriteValue< Double_t >(out, element->getBetaY());
+    WriteValue< Double_t >(out, element->getDX());
+    WriteValue< Double_t >(out, element->getDY());
+    WriteValue< Double_t >(out, element->getRelX());
+    WriteValue< Double_t >(out, element->getRelY());
+
+    apertureType = aperture ? aperture->getType() : NONE;
+    WriteValue(out, apertureType);
+    WriteValue< Float_t >(out, aperture ? aperture->getX1() : 0.0);
+    WriteValue< Float_t >(out, aperture ? aperture->getX2() : 0.0);
+    WriteValue< Float_t >(out, aperture ? aperture->getX3() : 0.0);
+    WriteValue< Float_t >(out, aperture ? aperture->getX4() : 0.0);
+  }
+
+  out.close();
+  if(!out || rename(temporaryFile.Data(), fileName) != 0)
+  {
+    cerr << "** WARNING: can't write beam line cache " << fileName << endl;
+    gSystem->Unlink(temporaryFile);
+  }
+}
+
+//------------------------------------------------------------------------------
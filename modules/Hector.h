@@ -23,15 +23,28 @@
  *
  *  Propagates candidates using Hector library.
  *
+ *  With UseTransportMap the transport through the beam line is tabulated
+ *  for every particle species on TransportMapNodes values of the relative
+ *  energy loss between TransportMapXiMin and TransportMapXiMax. For a
+ *  given energy loss the path is affine in the position and angles at
+ *  the interaction point, so a particle costs an interpolation of the
+ *  tabulated positions at the apertures and at the detector instead of
+ *  the product of the element matrices. Particles out of the table go
+ *  through Hector as before.
+ *
  *  \author P. Demin - UCL, Louvain-la-Neuve
  *
  */
 
 #include "classes/DelphesModule.h"
 
+#include <map>
+#include <utility>
+
 class TIterator;
 class TObjArray;
 class H_BeamLine;
+class HectorTransportMap;
 
 class Hector: public DelphesModule
 {
@@ -53,8 +66,20 @@ private:
   Double_t fSigmaE, fSigmaX, fSigmaY, fSigmaT;
   Double_t fEtaMin;
 
+  Bool_t fUseTransportMap;
+  Double_t fTransportMapXiMin, fTransportMapXiMax;
+  Int_t fTransportMapNodes;
+
   H_BeamLine *fBeamLine;
 
+  Bool_t ReadBeamLineCache(const char *fileName);
+  void WriteBeamLineCache(const char *fileName);
+
+#if !defined(__CINT__) && !defined(__CLING__)
+  // one map for each mass and charge
+  std::map< std::pair< Float_t, Float_t >, HectorTransportMap * > fTransportMaps; //!
+#endif
+
   TIterator *fItInputArray; //!
 
   const TObjArray *fInputArray; //!
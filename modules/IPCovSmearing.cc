@@ -43,6 +43,7 @@
 #include "TObjArray.h"
 #include "TLorentzVector.h"
 #include "TMatrixDSym.h"
+#include "TRandom3.h"
 
 // Eigen
 #include <Eigen/Cholesky>
@@ -51,6 +52,8 @@
 #include <stdexcept>
 #include <ostream>
 #include <memory>
+#include <mutex>
+#include <map>
 
 namespace {
   const double pi = std::atan2(0, -1);
@@ -67,6 +70,18 @@ namespace {
 
   // Function to copy to the Candidate
   void set_covariance(float*, const CovMatrix& matrix);
+
+  // Matrices read from one file. Every slot of DelphesWorkerPool has
+  // its own instance of the module, they share one read of the file.
+  typedef std::unordered_map<
+    int, std::unordered_map<int, CovMatrix> > MatrixMap;
+  struct Parametrisation {
+    MatrixMap covariance;
+    MatrixMap smearing;
+  };
+  std::shared_ptr<const Parametrisation> get_parametrisation(
+    const std::string& filename, double smear_mult,
+    int pt_bin_max, int eta_bins_max, std::ostream& sout);
 }
 
 //------------------------------------------------------------------------------
@@ -92,12 +107,6 @@ void IPCovSmearing::Init()
 
   const char* filename = GetString("SmearParamFile", "Parametrisation/IDParametrisierung.root");
 
-  TFile file_para(filename,"READ");
-  if (!file_para.IsOpen() || file_para.IsZombie()) {
-    throw std::runtime_error("bad file: " + std::string(filename));
-  }
-
-
   ptbins.push_back(10);
   ptbins.push_back(20);
   ptbins.push_back(50);
@@ -117,25 +126,28 @@ void IPCovSmearing::Init()
   etabins.push_back(2.25);
   etabins.push_back(2.7);
 
-
   std::ostream sout(GetConfReader()->GetOutStreamBuffer());
-
-  const int pt_bin_max = ptbins.size();
-  const int eta_bins_max = etabins.size();
-  for (int ipt = -1 ; ipt < pt_bin_max; ipt++) {
-    for (int ieta = 0; ieta < eta_bins_max; ieta++) {
-      try {
-	CovMatrix cov = get_cov_matrix(file_para, ipt, ieta) * smear_mult;
-	fCovarianceMatrices[ipt][ieta] = cov;
-
-	// get the lower part of the Cholesky decomposition. The smearing
-	// will be s = L*r, where r is a random gaussian 5-vector
-	fSmearingMatrices[ipt][ieta] = cov.llt().matrixL();
-
-      } catch (std::invalid_argument&) {
-	sout << "** INFO: no smearing defined for pt-eta "
-	     << ipt << " " << ieta << std::endl;
+  std::shared_ptr<const Parametrisation> para = get_parametrisation(
+    filename, smear_mult, ptbins.size(), etabins.size(), sout);
+
+  // resolve every pt-eta bin once, the tracks then index a flat table
+  fBins.assign((ptbins.size() + 1)*etabins.size(), SmearingBin());
+  for (int ipt = -1; ipt < int(ptbins.size()); ipt++) {
+    for (int ieta = 0; ieta < int(etabins.size()); ieta++) {
+      SmearingBin& bin = fBins[(ipt + 1)*etabins.size() + ieta];
+      bin.misses = 0;
+      bin.valid = false;
+      auto pt_mats = para->smearing.find(ipt);
+      if (pt_mats == para->smearing.end()) continue;
+      int etabin = ieta;
+      while (etabin >= 0 && !pt_mats->second.count(etabin)) {
+        bin.misses++;
+        etabin--;
       }
+      if (etabin < 0) continue;
+      bin.smearing = pt_mats->second.at(etabin);
+      set_covariance(bin.covariance, para->covariance.at(ipt).at(etabin));
+      bin.valid = true;
     }
   }
 
@@ -228,20 +240,10 @@ void IPCovSmearing::Process()
     double d0 = (xd*py - yd*px)/pt;
     double z0 = zd;
 
-    // get pt and eta bins (TODO: replace with something less confusing)
-    int ptbin = -1;
-    for(unsigned int i=0;i< ptbins.size();i++){
-      if(pt > ptbins.at(i)) ptbin=i;
-    }
-    int etabin = -1;
-    for(unsigned int i=0;i< etabins.size();i++){
-      if(fabs(eta) > etabins.at(i)) etabin=i;
-    }
-
     // Now do the smearing
-    const auto& bins = getValidBins(ptbin, etabin);
-    const CovMatrix& smearing_matrix =
-      fSmearingMatrices.at(bins.first).at(bins.second);
+    const SmearingBin& bin = getBin(pt, eta);
+    fNBinMisses += bin.misses;
+    const CovMatrix& smearing_matrix = bin.smearing;
     TrackVector track_parameters;
     track_parameters << d0, z0, phi, theta, qoverp;
     TrackVector rand = getRandomVector();
@@ -259,8 +261,7 @@ void IPCovSmearing::Process()
     float* cov_array = smeared_track->trkCov;
 
     // copy covariance matrix to the track
-    const CovMatrix& cov = fCovarianceMatrices.at(bins.first).at(bins.second);
-    set_covariance(cov_array, cov);
+    std::copy(bin.covariance, bin.covariance + 15, cov_array);
 
     // fill the track parameters
     {
@@ -295,31 +296,68 @@ void IPCovSmearing::Process()
   }
 }
 
-std::pair<int,int> IPCovSmearing::getValidBins(int ptbin, int etabin) {
-  const auto& pt_mats = fSmearingMatrices[ptbin];
-  // use the lower pt bin if this one isn't defined
-  if (!pt_mats.count(etabin)) {
-    if (etabin == 0) {
-      throw std::logic_error(
-	"no eta bins for pt bin: " + std::to_string(etabin));
-    } else {
-      fNBinMisses++;
-      return getValidBins(ptbin, etabin-1);
-    }
+const IPCovSmearing::SmearingBin& IPCovSmearing::getBin(
+  double pt, double eta) const {
+  // last edge below pt and |eta|, -1 if there is none
+  int ptbin = std::lower_bound(ptbins.begin(), ptbins.end(), pt)
+    - ptbins.begin() - 1;
+  int etabin = std::lower_bound(etabins.begin(), etabins.end(), fabs(eta))
+    - etabins.begin() - 1;
+  // a track at eta = 0 belongs to the first eta bin
+  if (etabin < 0) etabin = 0;
+  const SmearingBin& bin = fBins[(ptbin + 1)*etabins.size() + etabin];
+  if (!bin.valid) {
+    throw std::logic_error(
+      "no eta bins for pt bin: " + std::to_string(ptbin));
   }
-  return {ptbin, etabin};
+  return bin;
 }
 
 TrackVector IPCovSmearing::getRandomVector() {
-  std::normal_distribution<double> norm(0,1);
   TrackVector pars;
   for (int iii = 0; iii < 5; iii++) {
-    pars(iii) = norm(fRandomGenerator);
+    pars(iii) = GetRandom()->Gaus(0, 1);
   }
   return pars;
 }
 
 namespace {
+  std::shared_ptr<const Parametrisation> get_parametrisation(
+    const std::string& filename, double smear_mult,
+    int pt_bin_max, int eta_bins_max, std::ostream& sout) {
+    static std::mutex cache_mutex;
+    static std::map<std::pair<std::string, double>,
+                    std::shared_ptr<const Parametrisation> > cache;
+
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    auto key = std::make_pair(filename, smear_mult);
+    auto cached = cache.find(key);
+    if (cached != cache.end()) return cached->second;
+
+    TFile file_para(filename.c_str(),"READ");
+    if (!file_para.IsOpen() || file_para.IsZombie()) {
+      throw std::runtime_error("bad file: " + filename);
+    }
+
+    std::shared_ptr<Parametrisation> para(new Parametrisation);
+    for (int ipt = -1 ; ipt < pt_bin_max; ipt++) {
+      for (int ieta = 0; ieta < eta_bins_max; ieta++) {
+        try {
+          CovMatrix cov = get_cov_matrix(file_para, ipt, ieta) * smear_mult;
+          para->covariance[ipt][ieta] = cov;
+          // get the lower part of the Cholesky decomposition. The smearing
+          // will be s = L*r, where r is a random gaussian 5-vector
+          para->smearing[ipt][ieta] = cov.llt().matrixL();
+        } catch (std::invalid_argument&) {
+          sout << "** INFO: no smearing defined for pt-eta "
+               << ipt << " " << ieta << std::endl;
+        }
+      }
+    }
+    cache[key] = para;
+    return para;
+  }
+
   CovMatrix get_cov_matrix(TFile& file, int ptbin, int etabin) {
     bool lowpt_hack = false;
     if (ptbin == -1) {
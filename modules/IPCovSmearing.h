@@ -32,7 +32,6 @@
 
 #ifndef __CINT__
 #include <unordered_map>
-#include <random>
 #include <Eigen/Cholesky>
 typedef Eigen::Matrix<double, 5, 5> CovMatrix;
 typedef Eigen::Matrix<double, 5, 1> TrackVector;
@@ -61,16 +60,18 @@ private:
   unsigned long long fNBinMisses;
 
 #ifndef __CINT__
-  std::default_random_engine fRandomGenerator;
-
-  // unility for bins that aren't covered for our smearing
-  // this is to grab one that is
-  std::pair<int,int> getValidBins(int ptbin, int etabin);
+  // matrices of one pt-eta bin, bins that aren't covered by the
+  // smearing use the closest lower eta bin that is
+  struct SmearingBin {
+    CovMatrix smearing;
+    float covariance[15];
+    int misses;
+    bool valid;
+  };
+  const SmearingBin& getBin(double pt, double eta) const;
   TrackVector getRandomVector();
-  std::unordered_map<
-    int, std::unordered_map<int, CovMatrix> > fSmearingMatrices;
-  std::unordered_map<
-    int, std::unordered_map<int, CovMatrix> > fCovarianceMatrices;
+  // pt bins from -1 (below the first edge), then eta bins
+  std::vector<SmearingBin> fBins;
 #endif
 
   TIterator *fItInputArray; //!
@@ -54,7 +54,7 @@ using namespace std;
 //------------------------------------------------------------------------------
 
 IdentificationMap::IdentificationMap() :
-  fItInputArray(0)
+  fDefaultRules(0), fItInputArray(0)
 {
 }
 
@@ -68,7 +68,8 @@ IdentificationMap::~IdentificationMap()
 
 void IdentificationMap::Init()
 {
-  TMisIDMap::iterator itEfficiencyMap;
+  unordered_map< Int_t, Int_t >::iterator itRulesIndex;
+  vector< pair< Int_t, Int_t > > antiparticles;
   ExRootConfParam param;
   DelphesFormula *formula;
   Int_t i, size, pdg;
@@ -77,28 +78,47 @@ void IdentificationMap::Init()
   param = GetParam("EfficiencyFormula");
   size = param.GetSize();
 
-  fEfficiencyMap.clear();
+  fRules.clear();
+  fRulesIndex.clear();
   for(i = 0; i < size/3; ++i)
   {
     formula = new DelphesFormula;
     formula->Compile(param[i*3 + 2].GetString());
     pdg = param[i*3].GetInt();
-    fEfficiencyMap.insert(make_pair(pdg, make_pair(param[i*3 + 1].GetInt(), formula)));
+
+    itRulesIndex = fRulesIndex.find(pdg);
+    if(itRulesIndex == fRulesIndex.end())
+    {
+      itRulesIndex = fRulesIndex.insert(make_pair(pdg, Int_t(fRules.size()))).first;
+      fRules.push_back(TRules());
+    }
+    fRules[itRulesIndex->second].push_back(make_pair(param[i*3 + 1].GetInt(), formula));
   }
 
   // set default efficiency formula
-  itEfficiencyMap = fEfficiencyMap.find(0);
-  if(itEfficiencyMap == fEfficiencyMap.end())
+  itRulesIndex = fRulesIndex.find(0);
+  if(itRulesIndex == fRulesIndex.end())
   {
     formula = new DelphesFormula;
     formula->Compile("1.0");
 
-    fEfficiencyMap.insert(make_pair(0, make_pair(0, formula)));
+    itRulesIndex = fRulesIndex.insert(make_pair(0, Int_t(fRules.size()))).first;
+    fRules.push_back(TRules(1, make_pair(0, formula)));
+  }
+  fDefaultRules = itRulesIndex->second;
+
+  // particles without rules of their own use those of their antiparticle,
+  // insert leaves the ones that have rules unchanged
+  for(itRulesIndex = fRulesIndex.begin(); itRulesIndex != fRulesIndex.end(); ++itRulesIndex)
+  {
+    if(itRulesIndex->first == 0) continue;
+    antiparticles.push_back(make_pair(-itRulesIndex->first, itRulesIndex->second));
   }
+  fRulesIndex.insert(antiparticles.begin(), antiparticles.end());
 
   // import input array
 
-  fInputArray = ImportArray(GetString("InputArray", "ParticlePropagator/stableParticles"));
+  fInputArray = UpdateArray(GetString("InputArray", "ParticlePropagator/stableParticles"));
   fItInputArray = fInputArray->MakeIterator();
 
   // create output array
@@ -112,13 +132,16 @@ void IdentificationMap::Finish()
 {
   if(fItInputArray) delete fItInputArray;
 
-  TMisIDMap::iterator itEfficiencyMap;
-  DelphesFormula *formula;
-  for(itEfficiencyMap = fEfficiencyMap.begin(); itEfficiencyMap != fEfficiencyMap.end(); ++itEfficiencyMap)
+  vector< TRules >::iterator itRules;
+  TRules::iterator itRule;
+  for(itRules = fRules.begin(); itRules != fRules.end(); ++itRules)
   {
-    formula = (itEfficiencyMap->second).second;
-    if(formula) delete formula;
+    for(itRule = itRules->begin(); itRule != itRules->end(); ++itRule)
+    {
+      if(itRule->second) delete itRule->second;
+    }
   }
+  fRules.clear();
 }
 
 //------------------------------------------------------------------------------
@@ -127,10 +150,10 @@ void IdentificationMap::Process()
 {
   Candidate *candidate;
   Double_t pt, eta, phi, e;
-  TMisIDMap::iterator itEfficiencyMap;
-  pair <TMisIDMap::iterator, TMisIDMap::iterator> range;
-  DelphesFormula *formula;
-  Int_t pdgCodeIn, pdgCodeOut, charge;
+  unordered_map< Int_t, Int_t >::const_iterator itRulesIndex;
+  TRules::const_iterator itRule;
+  const TRules *rules;
+  Int_t pdgCodeOut, charge;
 
   Double_t p, r, total;
 
@@ -143,29 +166,23 @@ void IdentificationMap::Process()
     phi = candidatePosition.Phi();
     pt = candidateMomentum.Pt();
     e = candidateMomentum.E();
-   
-    pdgCodeIn = candidate->PID;
-    charge = candidate->Charge;
 
-    // first check that PID of this particle is specified in the map
-    // otherwise, look for PID = 0
+    charge = candidate->Charge;
 
-    itEfficiencyMap = fEfficiencyMap.find(pdgCodeIn);
+    // the rules of this PID, of its antiparticle or of PID = 0
 
-    range = fEfficiencyMap.equal_range(pdgCodeIn);
-    if(range.first == range.second) range = fEfficiencyMap.equal_range(-pdgCodeIn);
-    if(range.first == range.second) range = fEfficiencyMap.equal_range(0);
+    itRulesIndex = fRulesIndex.find(candidate->PID);
+    rules = &fRules[itRulesIndex != fRulesIndex.end() ? itRulesIndex->second : fDefaultRules];
 
-    r = gRandom->Uniform();
+    r = GetRandom()->Uniform();
     total = 0.0;
 
-    // loop over sub-map for this PID
-    for(TMisIDMap::iterator it = range.first; it != range.second; ++it)
+    // the formulas are only evaluated up to the rule that is drawn
+    for(itRule = rules->begin(); itRule != rules->end(); ++itRule)
     {
-      formula = (it->second).second;
-      pdgCodeOut = (it->second).first;
+      pdgCodeOut = itRule->first;
 
-      p = formula->Eval(pt, eta, phi, e);
+      p = itRule->second->Eval(pt, eta, phi, e);
 
       if(total <= r && r < total + p)
       {
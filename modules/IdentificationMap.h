@@ -31,6 +31,11 @@
 
 #include "classes/DelphesModule.h"
 
+#if !defined(__CINT__) && !defined(__CLING__)
+#include <unordered_map>
+#include <vector>
+#endif
+
 class TIterator;
 class TObjArray;
 class DelphesFormula;
@@ -46,11 +51,21 @@ public:
   void Process();
   void Finish();
 
+  Bool_t IsThreadSafe() const { return HasRandomStream(); }
+
 private:
 
-  typedef std::multimap< Int_t, std::pair< Int_t, DelphesFormula * > > TMisIDMap; //!
+#if !defined(__CINT__) && !defined(__CLING__)
+  // new PDG code and probability of every rule of one PDG code
+  typedef std::vector< std::pair< Int_t, DelphesFormula * > > TRules;
 
-  TMisIDMap fEfficiencyMap; //!
+  // rules in the order of the card, grouped by PDG code, the index gives
+  // the group a PDG code uses, its own or its antiparticle's, the others
+  // use the rules of PDG code 0
+  std::vector< TRules > fRules; //!
+  std::unordered_map< Int_t, Int_t > fRulesIndex; //!
+  Int_t fDefaultRules; //!
+#endif
 
   TIterator *fItInputArray; //!
 
@@ -44,6 +44,8 @@ public:
   void Process();
   void Finish();
 
+  Bool_t IsThreadSafe() const { return HasRandomStream(); }
+
 private:
 
   DelphesFormula *fFormula; //!
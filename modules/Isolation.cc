@@ -31,8 +31,10 @@
 #include "modules/Isolation.h"
 
 #include "classes/DelphesClasses.h"
+#include "classes/CandidateSpan.h"
 #include "classes/DelphesFactory.h"
 #include "classes/DelphesFormula.h"
+#include "classes/DelphesEtaPhiGrid.h"
 
 #include "ExRootAnalysis/ExRootResult.h"
 #include "ExRootAnalysis/ExRootFilter.h"
@@ -53,6 +55,9 @@
 
 using namespace std;
 
+// smallest grid cell, so that narrow cones do not make too many cells
+static const Double_t kMinCellSize = 0.1;
+
 //------------------------------------------------------------------------------
 
 class IsolationClassifier : public ExRootClassifier
@@ -81,9 +86,7 @@ Int_t IsolationClassifier::GetCategory(TObject *object)
 //------------------------------------------------------------------------------
 
 Isolation::Isolation() :
-  fClassifier(0), fFilter(0),
-  fItIsolationInputArray(0), fItCandidateInputArray(0),
-  fItRhoInputArray(0)
+  fClassifier(0), fFilter(0), fGrid(0)
 {
   fClassifier = new IsolationClassifier;
 }
@@ -98,64 +101,96 @@ Isolation::~Isolation()
 
 void Isolation::Init()
 {
+  ExRootConfParam param;
+  Collection collection;
+  Long_t i, size;
   const char *rhoInputArrayName;
 
   fDeltaRMax = GetDouble("DeltaRMax", 0.5);
 
-  fPTRatioMax = GetDouble("PTRatioMax", 0.1);
-
-  fPTSumMax = GetDouble("PTSumMax", 5.0);
-
   fUsePTSum = GetBool("UsePTSum", false);
 
   fClassifier->fPTMin = GetDouble("PTMin", 0.5);
 
+  fGrid = new DelphesEtaPhiGrid(TMath::Max(fDeltaRMax, kMinCellSize), GetDouble("GridEtaMax", 5.0));
+
   // import input array(s)
 
   fIsolationInputArray = ImportArray(GetString("IsolationInputArray", "Delphes/partons"));
-  fItIsolationInputArray = fIsolationInputArray->MakeIterator();
 
   fFilter = new ExRootFilter(fIsolationInputArray);
 
-  fCandidateInputArray = ImportArray(GetString("CandidateInputArray", "Calorimeter/electrons"));
-  fItCandidateInputArray = fCandidateInputArray->MakeIterator();
-
   rhoInputArrayName = GetString("RhoInputArray", "");
   if(rhoInputArrayName[0] != '\0')
   {
     fRhoInputArray = ImportArray(rhoInputArrayName);
-    fItRhoInputArray = fRhoInputArray->MakeIterator();
   }
   else
   {
     fRhoInputArray = 0;
   }
 
-  // create output array
+  // import candidate arrays and create output arrays
+
+  fCollections.clear();
+
+  param = GetParam("CandidateArrays");
+  size = param.GetSize();
+  if(size % 4 != 0)
+  {
+    throw runtime_error("CandidateArrays must contain groups of input array, output array, PTRatioMax and PTSumMax");
+  }
+
+  for(i = 0; i < size; i += 4)
+  {
+    collection.input = UpdateArray(param[i].GetString());
+    collection.output = ExportArray(param[i + 1].GetString());
+    collection.ptRatioMax = param[i + 2].GetDouble();
+    collection.ptSumMax = param[i + 3].GetDouble();
+    fCollections.push_back(collection);
+  }
 
-  fOutputArray = ExportArray(GetString("OutputArray", "electrons"));
+  if(fCollections.empty())
+  {
+    collection.input = UpdateArray(GetString("CandidateInputArray", "Calorimeter/electrons"));
+    collection.output = ExportArray(GetString("OutputArray", "electrons"));
+    collection.ptRatioMax = GetDouble("PTRatioMax", 0.1);
+    collection.ptSumMax = GetDouble("PTSumMax", 5.0);
+    fCollections.push_back(collection);
+  }
 }
 
 //------------------------------------------------------------------------------
 
 void Isolation::Finish()
 {
-  if(fItRhoInputArray) delete fItRhoInputArray;
   if(fFilter) delete fFilter;
-  if(fItCandidateInputArray) delete fItCandidateInputArray;
-  if(fItIsolationInputArray) delete fItIsolationInputArray;
+  if(fGrid) delete fGrid;
+}
+
+//------------------------------------------------------------------------------
+
+Double_t Isolation::FindRho(Double_t eta) const
+{
+  Int_t i;
+
+  // the last matching bin wins
+  for(i = Int_t(fRhoBins.size()) - 1; i >= 0; --i)
+  {
+    if(eta >= fRhoBins[i].etaMin && eta < fRhoBins[i].etaMax) return fRhoBins[i].rho;
+  }
+
+  return 0.0;
 }
 
 //------------------------------------------------------------------------------
 
 void Isolation::Process()
 {
-  Candidate *candidate, *isolation, *object;
   TObjArray *isolationArray;
-  Double_t sumCharged, sumNeutral, sumAllParticles, sumChargedPU, sumDBeta, ratioDBeta, sumRhoCorr, ratioRhoCorr;
-  Int_t counter;
-  Double_t eta = 0.0;
-  Double_t rho = 0.0;
+  vector< Collection >::const_iterator itCollections;
+  vector< const DelphesEtaPhiGrid::Entry * > objects;
+  RhoBin bin;
 
   // select isolation objects
   fFilter->Reset();
@@ -163,74 +198,69 @@ void Isolation::Process()
 
   if(isolationArray == 0) return;
 
-  TIter itIsolationArray(isolationArray);
+  fGrid->Fill(isolationArray);
+
+  fRhoBins.clear();
+  if(fRhoInputArray)
+  {
+    for(Candidate *object : CandidateSpan(fRhoInputArray))
+    {
+      bin.etaMin = object->Edges[0];
+      bin.etaMax = object->Edges[1];
+      bin.rho = object->Momentum.Pt();
+      fRhoBins.push_back(bin);
+    }
+  }
+
+  for(itCollections = fCollections.begin(); itCollections != fCollections.end(); ++itCollections)
+  {
+    Isolate(*itCollections, objects);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void Isolation::Isolate(const Collection &collection, vector< const DelphesEtaPhiGrid::Entry * > &objects)
+{
+  Double_t sumCharged, sumNeutral, sumAllParticles, sumChargedPU, sumDBeta, ratioDBeta, sumRhoCorr, ratioRhoCorr;
+  Double_t rho = 0.0;
+  vector< const DelphesEtaPhiGrid::Entry * >::const_iterator itObjects;
 
   // loop over all input jets
-  fItCandidateInputArray->Reset();
-  while((candidate = static_cast<Candidate*>(fItCandidateInputArray->Next())))
+  for(Candidate *candidate : CandidateSpan(collection.input))
   {
     const TLorentzVector &candidateMomentum = candidate->Momentum;
-    eta = TMath::Abs(candidateMomentum.Eta());
 
-    // find rho
-    rho = 0.0;
-    if(fRhoInputArray)
-    {
-      fItRhoInputArray->Reset();
-      while((object = static_cast<Candidate*>(fItRhoInputArray->Next())))
-      {
-        if(eta >= object->Edges[0] && eta < object->Edges[1])
-        {
-          rho = object->Momentum.Pt();
-        }
-      }
-    }
+    // loop over the isolation objects inside the cone
 
-    // loop over all input tracks
-    
     sumNeutral = 0.0;
     sumCharged = 0.0;
     sumChargedPU = 0.0;
     sumAllParticles = 0.0;
-   
-    counter = 0;
-    itIsolationArray.Reset();
-    
-    while((isolation = static_cast<Candidate*>(itIsolationArray.Next())))
+
+    fGrid->Find(candidateMomentum.Eta(), candidateMomentum.Phi(), fDeltaRMax, objects);
+
+    for(itObjects = objects.begin(); itObjects != objects.end(); ++itObjects)
     {
-      const TLorentzVector &isolationMomentum = isolation->Momentum;
+      const Candidate *isolation = (*itObjects)->candidate;
 
-      if(candidateMomentum.DeltaR(isolationMomentum) <= fDeltaRMax &&
-         candidate->GetUniqueID() != isolation->GetUniqueID())
+      if(candidate->GetUniqueID() == isolation->GetUniqueID()) continue;
+
+      sumAllParticles += (*itObjects)->pt;
+      if(isolation->Charge != 0)
       {
-        sumAllParticles += isolationMomentum.Pt();
-        if(isolation->Charge !=0) 
-	{ 
-	  sumCharged += isolationMomentum.Pt();
-          if(isolation->IsRecoPU != 0) sumChargedPU += isolationMomentum.Pt();
-	} 
-        else
-	{
-	  sumNeutral += isolationMomentum.Pt();
-        }
-        ++counter;
+        sumCharged += (*itObjects)->pt;
+        if(isolation->IsRecoPU != 0) sumChargedPU += (*itObjects)->pt;
       }
-    }
-
-    // find rho
-    rho = 0.0;
-    if(fRhoInputArray)
-    {
-      fItRhoInputArray->Reset();
-      while((object = static_cast<Candidate*>(fItRhoInputArray->Next())))
+      else
       {
-        if(eta >= object->Edges[0] && eta < object->Edges[1])
-        {
-          rho = object->Momentum.Pt();
-        }
+        sumNeutral += (*itObjects)->pt;
       }
     }
 
+    // find rho
+    rho = FindRho(TMath::Abs(candidateMomentum.Eta()));
+
      // correct sum for pile-up contamination
     sumDBeta = sumCharged + TMath::Max(sumNeutral-0.5*sumChargedPU,0.0);
     sumRhoCorr = sumCharged + TMath::Max(sumNeutral-TMath::Max(rho,0.0)*fDeltaRMax*fDeltaRMax*TMath::Pi(),0.0);
@@ -244,8 +274,8 @@ void Isolation::Process()
     candidate->SumPtChargedPU = sumChargedPU;
     candidate->SumPt = sumAllParticles;
 
-    if((fUsePTSum && sumDBeta > fPTSumMax) || (!fUsePTSum && ratioDBeta > fPTRatioMax)) continue;
-    fOutputArray->Add(candidate);
+    if((fUsePTSum && sumDBeta > collection.ptSumMax) || (!fUsePTSum && ratioDBeta > collection.ptRatioMax)) continue;
+    collection.output->Add(candidate);
   }
 }
 
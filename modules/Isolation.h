@@ -26,15 +26,27 @@
  *  to the candidate's transverse momentum. outputs candidates that have
  *  the transverse momenta fraction within (PTRatioMin, PTRatioMax].
  *
+ *  Several candidate collections sharing the isolation objects and the
+ *  cone size can be isolated in one pass, each one given by four entries
+ *  of CandidateArrays: input array, output array, PTRatioMax and PTSumMax.
+ *  CandidateInputArray and OutputArray are then ignored.
+ *
  *  \author P. Demin - UCL, Louvain-la-Neuve
  *
  */
 
 #include "classes/DelphesModule.h"
 
+#if !defined(__CINT__) && !defined(__CLING__)
+#include "classes/DelphesEtaPhiGrid.h"
+
+#include <vector>
+#endif
+
 class TObjArray;
 
 class ExRootFilter;
+class DelphesEtaPhiGrid;
 class IsolationClassifier;
 
 class Isolation: public DelphesModule
@@ -48,13 +60,33 @@ public:
   void Process();
   void Finish();
 
+  Bool_t IsThreadSafe() const { return kTRUE; }
+
 private:
 
-  Double_t fDeltaRMax;
+#if !defined(__CINT__) && !defined(__CLING__)
+  struct RhoBin
+  {
+    Double_t etaMin, etaMax, rho;
+  };
+
+  struct Collection
+  {
+    const TObjArray *input;
+    TObjArray *output;
+    Double_t ptRatioMax, ptSumMax;
+  };
+
+  void Isolate(const Collection &collection, std::vector< const DelphesEtaPhiGrid::Entry * > &objects);
 
-  Double_t fPTRatioMax;
+  Double_t FindRho(Double_t eta) const;
 
-  Double_t fPTSumMax;
+  std::vector< RhoBin > fRhoBins; //!
+
+  std::vector< Collection > fCollections; //!
+#endif
+
+  Double_t fDeltaRMax;
 
   Bool_t fUsePTSum;
 
@@ -62,20 +94,12 @@ private:
 
   ExRootFilter *fFilter;
 
-  TIterator *fItIsolationInputArray; //!
-
-  TIterator *fItCandidateInputArray; //!
-
-  TIterator *fItRhoInputArray; //!
+  DelphesEtaPhiGrid *fGrid; //!
 
   const TObjArray *fIsolationInputArray; //!
 
-  const TObjArray *fCandidateInputArray; //!
-
   const TObjArray *fRhoInputArray; //!
 
-  TObjArray *fOutputArray; //!
-
   ClassDef(Isolation, 1)
 };
 
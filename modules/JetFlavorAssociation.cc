@@ -30,6 +30,7 @@
 #include "classes/DelphesClasses.h"
 #include "classes/DelphesFactory.h"
 #include "classes/DelphesFormula.h"
+#include "classes/DelphesEtaPhiGrid.h"
 
 #include "ExRootAnalysis/ExRootResult.h"
 #include "ExRootAnalysis/ExRootFilter.h"
@@ -50,6 +51,16 @@
 
 using namespace std;
 
+static const Double_t kMinCellSize = 0.1;
+
+// cone of the contaminating partons in GetPhysicsFlavor
+static const Float_t kBiggerConeSize = 0.7;
+
+// GetPhysicsFlavor compares the distances as floats, which can round a
+// distance just outside a cone to its size, so its searches take slightly
+// larger cones and then apply the comparisons
+static const Double_t kFloatMargin = 1.0E-6;
+
 //------------------------------------------------------------------------------
 
 class PartonClassifier: public ExRootClassifier
@@ -117,6 +128,8 @@ Int_t ParticleLHEFClassifier::GetCategory(TObject *object)
 //------------------------------------------------------------------------------
 
 JetFlavorAssociation::JetFlavorAssociation() :
+  fPartonGrid(0), fPartonLHEFGrid(0), fContaminationGrid(0),
+  fContaminationArray(0),
   fPartonClassifier(0), fPartonFilter(0), fParticleLHEFFilter(0),
   fItPartonInputArray(0), fItParticleInputArray(0),
   fItParticleLHEFInputArray(0), fItJetInputArray(0)
@@ -138,6 +151,7 @@ JetFlavorAssociation::~JetFlavorAssociation()
 void JetFlavorAssociation::Init()
 {
   ExRootConfParam param;
+  Double_t gridEtaMax;
 
   fDeltaR = GetDouble("DeltaR", 0.5);
 
@@ -170,8 +184,17 @@ void JetFlavorAssociation::Init()
     fParticleLHEFFilter = new ExRootFilter(fParticleLHEFInputArray);
   }
 
-  fJetInputArray = ImportArray(GetString("JetInputArray", "FastJetFinder/jets"));
+  fJetInputArray = UpdateArray(GetString("JetInputArray", "FastJetFinder/jets"));
   fItJetInputArray = fJetInputArray->MakeIterator();
+
+  // eta-phi indices of the partons
+
+  gridEtaMax = GetDouble("GridEtaMax", 5.0);
+  fPartonGrid = new DelphesEtaPhiGrid(TMath::Max(fDeltaR, kMinCellSize), gridEtaMax);
+  fPartonLHEFGrid = new DelphesEtaPhiGrid(TMath::Max(fDeltaR, kMinCellSize), gridEtaMax);
+  fContaminationGrid = new DelphesEtaPhiGrid(kBiggerConeSize, gridEtaMax);
+
+  fContaminationArray = new TObjArray;
 }
 
 //------------------------------------------------------------------------------
@@ -181,6 +204,11 @@ void JetFlavorAssociation::Finish()
   if(fPartonFilter) delete fPartonFilter;
   if(fParticleLHEFFilter) delete fParticleLHEFFilter;
 
+  if(fPartonGrid) delete fPartonGrid;
+  if(fPartonLHEFGrid) delete fPartonLHEFGrid;
+  if(fContaminationGrid) delete fContaminationGrid;
+  if(fContaminationArray) delete fContaminationArray;
+
   if(fItJetInputArray) delete fItJetInputArray;
   if(fItParticleLHEFInputArray) delete fItParticleLHEFInputArray;
   if(fItParticleInputArray) delete fItParticleInputArray;
@@ -204,7 +232,16 @@ void JetFlavorAssociation::Process(){
   {
     fParticleLHEFFilter->Reset();
     partonLHEFArray = fParticleLHEFFilter->GetSubArray(fParticleLHEFClassifier, 0); // get the filtered parton array
+
+    if(partonLHEFArray) fPartonLHEFGrid->Fill(partonLHEFArray);
+    else fPartonLHEFGrid->Clear();
+
+    SelectContaminations(partonArray, partonLHEFArray);
+    fContaminationGrid->Fill(fContaminationArray);
   }
+
+  fPartonGrid->Fill(partonArray);
+
   // loop over all input jets
   fItJetInputArray->Reset();
   while((jet = static_cast<Candidate *>(fItJetInputArray->Next())))
@@ -226,20 +263,20 @@ void JetFlavorAssociation::GetAlgoFlavor(Candidate *jet, TObjArray *partonArray,
   Candidate *parton, *partonLHEF;
   Candidate *tempParton = 0, *tempPartonHighestPt = 0;
   int pdgCode, pdgCodeMax = -1;
-  
-  TIter itPartonArray(partonArray);
+  vector< const DelphesEtaPhiGrid::Entry * >::const_iterator itNearby;
+
   TIter itPartonLHEFArray(partonLHEFArray);
 
-  itPartonArray.Reset();
-  while((parton = static_cast<Candidate *>(itPartonArray.Next())))
+  // only the partons within DeltaR of the jet take part
+  fPartonGrid->Find(jet->Momentum.Eta(), jet->Momentum.Phi(), fDeltaR, fNearby);
+  for(itNearby = fNearby.begin(); itNearby != fNearby.end(); ++itNearby)
   {
+    parton = (*itNearby)->candidate;
+
     // default delphes method
     pdgCode = TMath::Abs(parton->PID);
     if(TMath::Abs(parton->PID) == 21) pdgCode = 0;
-    if(jet->Momentum.DeltaR(parton->Momentum) <= fDeltaR)
-    {
-      if(pdgCodeMax < pdgCode) pdgCodeMax = pdgCode;
-    }
+    if(pdgCodeMax < pdgCode) pdgCodeMax = pdgCode;
 
     if(!fParticleLHEFInputArray) continue;
     // NOTE: the STDHEP input doesn't seem to ever get us here
@@ -267,16 +304,14 @@ void JetFlavorAssociation::GetAlgoFlavor(Candidate *jet, TObjArray *partonArray,
         if((daughterFlavor2 == 1 || daughterFlavor2 == 2 || daughterFlavor2 == 3 || daughterFlavor2 == 4 || daughterFlavor1 == 5 || daughterFlavor2 == 21)) daughterCounter++;
       }
       if(daughterCounter > 0) continue;
-      if(jet->Momentum.DeltaR(parton->Momentum) <= fDeltaR)
+
+      // if not yet found && pdgId is a c, take as c
+      if(TMath::Abs(parton->PID) == 4) tempParton = parton;
+      if(TMath::Abs(parton->PID) == 5) tempParton = parton;
+      if(parton->Momentum.Pt() > maxPt)
       {
-        // if not yet found && pdgId is a c, take as c
-        if(TMath::Abs(parton->PID) == 4) tempParton = parton;
-        if(TMath::Abs(parton->PID) == 5) tempParton = parton;
-        if(parton->Momentum.Pt() > maxPt)
-        {
-          maxPt = parton->Momentum.Pt();
-          tempPartonHighestPt = parton;
-        }
+        maxPt = parton->Momentum.Pt();
+        tempPartonHighestPt = parton;
       }
     }
   }
@@ -295,25 +330,26 @@ void JetFlavorAssociation::GetAlgoFlavor(Candidate *jet, TObjArray *partonArray,
 void JetFlavorAssociation::GetPhysicsFlavor(Candidate *jet, TObjArray *partonArray, TObjArray *partonLHEFArray)
 {
   int partonCounter = 0;
-  float biggerConeSize = 0.7;
   float dist;
-  bool isGoodCandidate;
   int contaminatingFlavor = 0;
   int motherCounter = 0;
   Candidate *parton, *partonLHEF, *mother1, *mother2;
   Candidate *tempParton = 0;
   vector<Candidate *> contaminations;
   vector<Candidate *>::iterator itContaminations;
-
-  TIter itPartonArray(partonArray);
-  TIter itPartonLHEFArray(partonLHEFArray);
+  vector< const DelphesEtaPhiGrid::Entry * >::const_iterator itNearby;
+  Double_t eta, phi;
 
   contaminations.clear();
 
-  itPartonLHEFArray.Reset();
-  while((partonLHEF = static_cast<Candidate *>(itPartonLHEFArray.Next())))
+  eta = jet->Momentum.Eta();
+  phi = jet->Momentum.Phi();
+
+  fPartonLHEFGrid->Find(eta, phi, fDeltaR*(1.0 + kFloatMargin), fNearby);
+  for(itNearby = fNearby.begin(); itNearby != fNearby.end(); ++itNearby)
   {
-    dist = jet->Momentum.DeltaR(partonLHEF->Momentum); // take the DR
+    partonLHEF = (*itNearby)->candidate;
+    dist = DelphesEtaPhiGrid::DeltaR(eta, phi, (*itNearby)->eta, (*itNearby)->phi); // take the DR
 
     if(partonLHEF->Status == 1 && dist <= fDeltaR)
     {
@@ -322,30 +358,11 @@ void JetFlavorAssociation::GetPhysicsFlavor(Candidate *jet, TObjArray *partonArr
     }
   }
 
-  itPartonArray.Reset();
-  itPartonLHEFArray.Reset();
-  while((parton = static_cast<Candidate *>(itPartonArray.Next())))
+  fContaminationGrid->Find(eta, phi, kBiggerConeSize*(1.0 + kFloatMargin), fNearby);
+  for(itNearby = fNearby.begin(); itNearby != fNearby.end(); ++itNearby)
   {
-    dist = jet->Momentum.DeltaR(parton->Momentum); // take the DR
-    isGoodCandidate = true;
-    while((partonLHEF = static_cast<Candidate *>(itPartonLHEFArray.Next())))
-    {
-      if(parton->Momentum.DeltaR(partonLHEF->Momentum) < 0.01 &&
-         parton->PID == partonLHEF->PID &&
-         partonLHEF->Charge == parton->Charge)
-      {
-        isGoodCandidate = false;
-        break;
-      }
-    }
-
-    if(!isGoodCandidate) continue;
-
-    if(parton->D1 != -1 || parton->D2 != -1)
-    {
-      if((TMath::Abs(parton->PID) < 4 || TMath::Abs(parton->PID) == 21)) continue;
-      if(dist < biggerConeSize) contaminations.push_back(parton);
-    }
+    dist = DelphesEtaPhiGrid::DeltaR(eta, phi, (*itNearby)->eta, (*itNearby)->phi); // take the DR
+    if(dist < kBiggerConeSize) contaminations.push_back((*itNearby)->candidate);
   }
 
   if(partonCounter != 1)
@@ -389,3 +406,42 @@ void JetFlavorAssociation::GetPhysicsFlavor(Candidate *jet, TObjArray *partonArr
     }
   }
 }
+
+//------------------------------------------------------------------------------
+
+void JetFlavorAssociation::SelectContaminations(TObjArray *partonArray, TObjArray *partonLHEFArray)
+{
+  Candidate *parton, *partonLHEF;
+  bool isGoodCandidate;
+
+  TIter itPartonArray(partonArray);
+  TIter itPartonLHEFArray(partonLHEFArray);
+
+  // the partons that are not LHEF partons and have daughters, in the order
+  // of the parton array, the LHEF iterator is not reset between partons
+  fContaminationArray->Clear();
+  while((parton = static_cast<Candidate *>(itPartonArray.Next())))
+  {
+    isGoodCandidate = true;
+    while((partonLHEF = static_cast<Candidate *>(itPartonLHEFArray.Next())))
+    {
+      if(parton->Momentum.DeltaR(partonLHEF->Momentum) < 0.01 &&
+         parton->PID == partonLHEF->PID &&
+         partonLHEF->Charge == parton->Charge)
+      {
+        isGoodCandidate = false;
+        break;
+      }
+    }
+
+    if(!isGoodCandidate) continue;
+
+    if(parton->D1 != -1 || parton->D2 != -1)
+    {
+      if((TMath::Abs(parton->PID) < 4 || TMath::Abs(parton->PID) == 21)) continue;
+      fContaminationArray->Add(parton);
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
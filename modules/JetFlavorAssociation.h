@@ -31,8 +31,15 @@
 #include "classes/DelphesClasses.h"
 #include <map>
 
+#if !defined(__CINT__) && !defined(__CLING__)
+#include "classes/DelphesEtaPhiGrid.h"
+
+#include <vector>
+#endif
+
 class TObjArray;
 class DelphesFormula;
+class DelphesEtaPhiGrid;
 
 class ExRootFilter;
 class PartonClassifier;
@@ -49,13 +56,29 @@ public:
   void Process();
   void Finish();
 
+  Bool_t IsThreadSafe() const { return kTRUE; }
+
   void GetAlgoFlavor(Candidate *jet, TObjArray *partonArray, TObjArray *partonLHEFArray);
   void GetPhysicsFlavor(Candidate *jet, TObjArray *partonArray, TObjArray *partonLHEFArray);
 
 private:
 
+  void SelectContaminations(TObjArray *partonArray, TObjArray *partonLHEFArray);
+
   Double_t fDeltaR;
 
+  // partons and LHEF partons of the event, and the partons that can
+  // contaminate the physics flavour of a jet
+  DelphesEtaPhiGrid *fPartonGrid; //!
+  DelphesEtaPhiGrid *fPartonLHEFGrid; //!
+  DelphesEtaPhiGrid *fContaminationGrid; //!
+
+  TObjArray *fContaminationArray; //!
+
+#if !defined(__CINT__) && !defined(__CLING__)
+  std::vector< const DelphesEtaPhiGrid::Entry * > fNearby; //!
+#endif
+
   PartonClassifier *fPartonClassifier; //!
   ParticleLHEFClassifier *fParticleLHEFClassifier; //!
 
@@ -0,0 +1,340 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/** \class JetImageWriter
+ *
+ *  writes jet images and constituent arrays to HDF5
+ *
+ */
+
+#include "modules/JetImageWriter.h"
+
+#include "classes/DelphesClasses.h"
+#include "ExRootAnalysis/ExRootConfReader.h"
+// the output file name can come from ExRootTreeWriter, as in HDF5Writer
+#include "ExRootAnalysis/ExRootTreeWriter.h"
+
+#include "TObjArray.h"
+#include "TFolder.h"
+#include "TVector2.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+namespace {
+  std::string remove_extension(const std::string& filename) {
+    size_t lastdot = filename.find_last_of(".");
+    if (lastdot == std::string::npos) return filename;
+    return filename.substr(0, lastdot);
+  }
+
+  // padding for the constituent arrays
+  jetimage::Constituent nan_constituent() {
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    jetimage::Constituent constituent;
+    constituent.pt = nan;
+    constituent.energy = nan;
+    constituent.delta_eta = nan;
+    constituent.delta_phi = nan;
+    constituent.charge = 0;
+    return constituent;
+  }
+}
+
+namespace jetimage {
+  H5_DEFINE_TYPE(Jet, JET_IMAGE_JET_FIELDS)
+  H5_DEFINE_TYPE(Constituent, JET_IMAGE_CONSTITUENT_FIELDS)
+}
+
+//------------------------------------------------------------------------------
+
+JetImageWriter::JetImageWriter() :
+  fItInputArray(0), m_eta_bins(0), m_phi_bins(0), m_eta_width(0),
+  m_phi_width(0), m_rotate(false), m_normalize(false),
+  m_max_constituents(0), m_out_file(0),
+  m_jet_buffer(0), m_image_buffer(0), m_constituent_buffer(0),
+  m_event_number(0)
+{
+}
+
+//------------------------------------------------------------------------------
+
+JetImageWriter::~JetImageWriter()
+{
+  delete m_jet_buffer;
+  delete m_image_buffer;
+  delete m_constituent_buffer;
+  delete m_out_file;
+  delete fItInputArray;
+}
+
+//------------------------------------------------------------------------------
+
+void JetImageWriter::Init()
+{
+  fInputArray = ImportArray(
+    GetString("JetInputArray", "FastJetFinder/jets"));
+  fItInputArray = fInputArray->MakeIterator();
+
+  fPTMin = GetDouble("PTMin", 20);
+  fAbsEtaMax = GetDouble("AbsEtaMax", 2.5);
+
+  // the image covers EtaWidth x PhiWidth around the jet axis
+  m_eta_bins = GetInt("EtaBins", 33);
+  m_phi_bins = GetInt("PhiBins", 33);
+  m_eta_width = GetDouble("EtaWidth", 1.6);
+  m_phi_width = GetDouble("PhiWidth", 1.6);
+  if (m_eta_bins < 1 || m_phi_bins < 1) {
+    throw std::invalid_argument("JetImageWriter: EtaBins and PhiBins must be positive");
+  }
+  if (m_eta_width <= 0 || m_phi_width <= 0) {
+    throw std::invalid_argument("JetImageWriter: EtaWidth and PhiWidth must be positive");
+  }
+  m_rotate = GetBool("Rotate", false);
+  m_normalize = GetBool("Normalize", false);
+
+  // zero skips the `constituents` dataset
+  m_max_constituents = GetInt("MaxConstituents", 50);
+
+  // Use OutputFile if it's given, otherwise the name of the root
+  // output file with OutputExtension.
+  std::string out_name = GetString("OutputFile", "");
+  if (out_name.empty()) {
+    auto* treeWriter = static_cast<ExRootTreeWriter*>(
+      GetFolder()->FindObject("TreeWriter"));
+    if (!treeWriter) {
+      throw std::runtime_error(
+        "JetImageWriter needs OutputFile when there's no TreeWriter");
+    }
+    out_name = remove_extension(treeWriter->GetFirstFileName()) +
+      GetString("OutputExtension", ".images.h5");
+  }
+
+  h5::DatasetOptions opts;
+  int chunk_size = GetInt("ChunkSize", 1000);
+  if (chunk_size < 1) {
+    throw std::invalid_argument("JetImageWriter: ChunkSize must be positive");
+  }
+  opts.chunk_size = chunk_size;
+  opts.compression = GetString("Compression", "deflate-7");
+  opts.shuffle = GetBool("Shuffle", false);
+  int buffer_size = GetInt("BufferSize", 1000);
+  if (buffer_size < 1) {
+    throw std::invalid_argument("JetImageWriter: BufferSize must be positive");
+  }
+  bool async = GetBool("AsyncWrite", false);
+
+  m_out_file = new H5::H5File(out_name, H5F_ACC_TRUNC);
+
+  m_jet_buffer = new OneDimBuffer<jetimage::Jet>(
+    *m_out_file, "jets", jetimage::type(jetimage::Jet()), buffer_size, opts);
+  m_image_buffer = new ArrayBuffer<float>(
+    *m_out_file, "images", h5::type(float()),
+    {hsize_t(m_eta_bins), hsize_t(m_phi_bins)}, buffer_size, opts);
+  if (m_max_constituents > 0) {
+    m_constituent_buffer = new ArrayBuffer<jetimage::Constituent>(
+      *m_out_file, "constituents",
+      jetimage::type(jetimage::Constituent()),
+      {hsize_t(m_max_constituents)}, buffer_size, opts);
+  }
+
+  // compress and write full buffers in background threads
+  if (async) {
+    m_jet_buffer->set_async();
+    m_image_buffer->set_async();
+    if (m_constituent_buffer) m_constituent_buffer->set_async();
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void JetImageWriter::Finish()
+{
+  close_file();
+}
+
+//------------------------------------------------------------------------------
+
+void JetImageWriter::close_file()
+{
+  if (m_jet_buffer) m_jet_buffer->close();
+  if (m_image_buffer) m_image_buffer->close();
+  if (m_constituent_buffer) m_constituent_buffer->close();
+
+  delete m_jet_buffer;
+  delete m_image_buffer;
+  delete m_constituent_buffer;
+  m_jet_buffer = 0;
+  m_image_buffer = 0;
+  m_constituent_buffer = 0;
+
+  if (m_out_file) m_out_file->close();
+  delete m_out_file;
+  m_out_file = 0;
+}
+
+//------------------------------------------------------------------------------
+
+void JetImageWriter::Process()
+{
+  fItInputArray->Reset();
+  Candidate* jet;
+  while ((jet = static_cast<Candidate*>(fItInputArray->Next()))) {
+    const auto& mom = jet->Momentum;
+    if (mom.Pt() < fPTMin || std::abs(mom.Eta()) > fAbsEtaMax) continue;
+
+    float rotation = place_constituents(*jet);
+
+    // the image is binned straight into the buffer
+    fill_image(m_image_buffer->append(0.0f));
+
+    jetimage::Jet out;
+    out.event_number = m_event_number;
+    out.pt = mom.Pt();
+    out.eta = mom.Eta();
+    out.phi = mom.Phi();
+    out.mass = mom.M();
+    out.n_constituents = m_constituents.size();
+    out.rotation = rotation;
+    m_jet_buffer->push_back(out);
+
+    if (m_constituent_buffer) {
+      // the leading constituents, ordered by pt
+      m_order.resize(m_pt.size());
+      for (size_t i = 0; i < m_order.size(); ++i) m_order[i] = i;
+      size_t n = std::min(m_order.size(), size_t(m_max_constituents));
+      std::partial_sort(
+        m_order.begin(), m_order.begin() + n, m_order.end(),
+        [this](int a, int b) {
+          return m_pt[a] > m_pt[b] || (m_pt[a] == m_pt[b] && a < b);
+        });
+
+      jetimage::Constituent* row =
+        m_constituent_buffer->append(nan_constituent());
+      for (size_t i = 0; i < n; ++i) {
+        const int index = m_order[i];
+        const Candidate* constituent = m_constituents[index];
+        row[i].pt = m_pt[index];
+        row[i].energy = constituent->Momentum.E();
+        row[i].delta_eta = m_eta[index];
+        row[i].delta_phi = m_phi[index];
+        row[i].charge = constituent->Charge;
+      }
+    }
+  }
+  ++m_event_number;
+}
+
+//------------------------------------------------------------------------------
+
+float JetImageWriter::place_constituents(const Candidate& jet)
+{
+  const double jet_eta = jet.Momentum.Eta();
+  const double jet_phi = jet.Momentum.Phi();
+
+  m_constituents.clear();
+  m_pt.clear();
+  m_eta.clear();
+  m_phi.clear();
+
+  const int n_constituents = jet.GetNumberOfCandidates();
+  for (int i = 0; i < n_constituents; ++i) {
+    const Candidate* constituent = jet.GetCandidate(i);
+    const TLorentzVector& mom = constituent->Momentum;
+    m_constituents.push_back(constituent);
+    m_pt.push_back(mom.Pt());
+    m_eta.push_back(mom.Eta() - jet_eta);
+    m_phi.push_back(TVector2::Phi_mpi_pi(mom.Phi() - jet_phi));
+  }
+
+  if (!m_rotate) return 0;
+
+  // principal axis of the pt weighted constituents
+  double see = 0, spp = 0, sep = 0;
+  for (size_t i = 0; i < m_pt.size(); ++i) {
+    see += m_pt[i] * m_eta[i] * m_eta[i];
+    spp += m_pt[i] * m_phi[i] * m_phi[i];
+    sep += m_pt[i] * m_eta[i] * m_phi[i];
+  }
+  double angle = 0.5 * std::atan2(2 * sep, see - spp);
+  float c = std::cos(angle);
+  float s = std::sin(angle);
+
+  // turned by -angle, then by pi if most of the pt ends up at negative eta
+  double moment = 0;
+  for (size_t i = 0; i < m_pt.size(); ++i) {
+    float eta = c * m_eta[i] + s * m_phi[i];
+    float phi = -s * m_eta[i] + c * m_phi[i];
+    m_eta[i] = eta;
+    m_phi[i] = phi;
+    moment += m_pt[i] * eta;
+  }
+  if (moment < 0) {
+    for (size_t i = 0; i < m_pt.size(); ++i) {
+      m_eta[i] = -m_eta[i];
+      m_phi[i] = -m_phi[i];
+    }
+    angle += M_PI;
+  }
+  return TVector2::Phi_mpi_pi(angle);
+}
+
+//------------------------------------------------------------------------------
+
+void JetImageWriter::fill_image(float* image)
+{
+  const int n = m_pt.size();
+  const int eta_bins = m_eta_bins;
+  const int phi_bins = m_phi_bins;
+  const float eta_scale = eta_bins / m_eta_width;
+  const float phi_scale = phi_bins / m_phi_width;
+  const float eta_half = 0.5 * m_eta_width;
+  const float phi_half = 0.5 * m_phi_width;
+  const float* eta = m_eta.data();
+  const float* phi = m_phi.data();
+
+  // The pixel of every constituent is found in a loop without
+  // branches over plain float arrays, which the compiler vectorizes,
+  // -1 for those outside the image. Only the sums go one by one.
+  m_bins.resize(n);
+  int* bins = m_bins.data();
+  for (int i = 0; i < n; ++i) {
+    float x = (eta[i] + eta_half) * eta_scale;
+    float y = (phi[i] + phi_half) * phi_scale;
+    bool inside = x >= 0 && x < eta_bins && y >= 0 && y < phi_bins;
+    bins[i] = inside ? int(x) * phi_bins + int(y) : -1;
+  }
+
+  float sum = 0;
+  for (int i = 0; i < n; ++i) {
+    if (bins[i] < 0) continue;
+    image[bins[i]] += m_pt[i];
+    sum += m_pt[i];
+  }
+
+  if (m_normalize && sum > 0) {
+    const float scale = 1 / sum;
+    for (int i = 0; i < eta_bins * phi_bins; ++i) image[i] *= scale;
+  }
+}
+
+//------------------------------------------------------------------------------
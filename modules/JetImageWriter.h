@@ -0,0 +1,146 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef JetImageWriter_h
+#define JetImageWriter_h
+
+/** \class JetImageWriter
+ *
+ *  Writes the jets of the input array to HDF5 as inputs for taggers:
+ *  an EtaBins x PhiBins image of the constituent pt around the jet
+ *  axis in `images`, the leading constituents as a NaN-padded
+ *  [n_jets, MaxConstituents] array in `constituents`, and the jet
+ *  kinematics in `jets`.
+ *
+ *  With Rotate the constituents are turned around the jet axis so
+ *  that the principal axis of their pt distribution lies along eta,
+ *  with most of the pt at positive eta. With Normalize the pixels of
+ *  an image sum to one. The constituents use the same coordinates as
+ *  the images.
+ *
+ */
+
+#include "classes/DelphesModule.h"
+
+#include <string>
+#include <vector>
+
+class TObjArray;
+class Candidate;
+
+#ifndef __CINT__
+
+#include "external/h5/OneDimBuffer.hh"
+#include "external/h5/ArrayBuffer.hh"
+#include "external/h5/h5types.hh"
+
+#include "H5Cpp.h"
+
+namespace jetimage {
+
+#define JET_IMAGE_JET_FIELDS(FIELD)		\
+  FIELD(int, event_number)			\
+  FIELD(float, pt)				\
+  FIELD(float, eta)				\
+  FIELD(float, phi)				\
+  FIELD(float, mass)				\
+  FIELD(int, n_constituents)			\
+  FIELD(float, rotation)
+  struct Jet {
+    JET_IMAGE_JET_FIELDS(H5_DECLARE_FIELD)
+  };
+  H5::CompType type(Jet);
+
+  // delta_eta and delta_phi are the image coordinates
+#define JET_IMAGE_CONSTITUENT_FIELDS(FIELD)	\
+  FIELD(float, pt)				\
+  FIELD(float, energy)				\
+  FIELD(float, delta_eta)			\
+  FIELD(float, delta_phi)			\
+  FIELD(int, charge)
+  struct Constituent {
+    JET_IMAGE_CONSTITUENT_FIELDS(H5_DECLARE_FIELD)
+  };
+  H5::CompType type(Constituent);
+}
+
+#else  // CINT include dummy
+
+namespace H5 {
+  class H5File;
+}
+
+#endif
+
+class JetImageWriter: public DelphesModule
+{
+public:
+
+  JetImageWriter();
+  ~JetImageWriter();
+
+  void Init();
+  void Process();
+  void Finish();
+
+private:
+
+  void close_file();
+
+  // coordinates of the constituents of a jet in the image, returns
+  // the rotation angle
+  float place_constituents(const Candidate& jet);
+  void fill_image(float* image);
+
+  TIterator *fItInputArray; //!
+
+  const TObjArray *fInputArray; //!
+
+  double fPTMin;
+  double fAbsEtaMax;
+
+  int m_eta_bins;
+  int m_phi_bins;
+  double m_eta_width;
+  double m_phi_width;
+  bool m_rotate;
+  bool m_normalize;
+  int m_max_constituents;
+
+  H5::H5File* m_out_file;
+
+#ifndef __CINT__
+  OneDimBuffer<jetimage::Jet>* m_jet_buffer;
+  ArrayBuffer<float>* m_image_buffer;
+  ArrayBuffer<jetimage::Constituent>* m_constituent_buffer;
+#endif
+
+  int m_event_number;
+
+  // the constituents of the current jet, kept between jets
+  std::vector<const Candidate*> m_constituents;
+  std::vector<float> m_pt;
+  std::vector<float> m_eta;
+  std::vector<float> m_phi;
+  std::vector<int> m_bins;
+  std::vector<int> m_order;
+
+  ClassDef(JetImageWriter, 1)
+};
+
+#endif
@@ -53,7 +53,7 @@ using namespace std;
 //------------------------------------------------------------------------------
 
 JetPileUpSubtractor::JetPileUpSubtractor() :
-  fItJetInputArray(0), fItRhoInputArray(0)
+  fRhoBinsDisjoint(kTRUE), fItJetInputArray(0), fItRhoInputArray(0)
 {
 
 }
@@ -71,6 +71,8 @@ void JetPileUpSubtractor::Init()
 {
   fJetPTMin = GetDouble("JetPTMin", 20.0);
 
+  fSubtractInPlace = GetBool("SubtractInPlace", false);
+
   // import input array(s)
 
   fJetInputArray = ImportArray(GetString("JetInputArray", "FastJetFinder/jets"));
@@ -95,12 +97,69 @@ void JetPileUpSubtractor::Finish()
 
 //------------------------------------------------------------------------------
 
+Double_t JetPileUpSubtractor::FindRho(Double_t eta) const
+{
+  vector< RhoBin >::const_iterator itRhoBins;
+  RhoBin bin;
+  Int_t i;
+
+  if(fRhoBinsDisjoint)
+  {
+    // last bin starting at or below eta
+    bin.etaMin = eta;
+    itRhoBins = upper_bound(fRhoBins.begin(), fRhoBins.end(), bin);
+    if(itRhoBins == fRhoBins.begin()) return 0.0;
+    --itRhoBins;
+    return eta < itRhoBins->etaMax ? itRhoBins->rho : 0.0;
+  }
+
+  // the last matching bin wins
+  for(i = Int_t(fRhoBins.size()) - 1; i >= 0; --i)
+  {
+    if(eta >= fRhoBins[i].etaMin && eta < fRhoBins[i].etaMax) return fRhoBins[i].rho;
+  }
+
+  return 0.0;
+}
+
+//------------------------------------------------------------------------------
+
 void JetPileUpSubtractor::Process()
 {
   Candidate *candidate, *object;
   TLorentzVector momentum, area;
   Double_t eta = 0.0;
   Double_t rho = 0.0;
+  RhoBin bin;
+  vector< RhoBin >::const_iterator itRhoBins;
+
+  // load rho, sorted in eta when the ranges do not overlap
+  fRhoBins.clear();
+  if(fRhoInputArray)
+  {
+    fItRhoInputArray->Reset();
+    while((object = static_cast<Candidate*>(fItRhoInputArray->Next())))
+    {
+      bin.etaMin = object->Edges[0];
+      bin.etaMax = object->Edges[1];
+      bin.rho = object->Momentum.Pt();
+      fRhoBins.push_back(bin);
+    }
+  }
+
+  vector< RhoBin > sorted(fRhoBins);
+  stable_sort(sorted.begin(), sorted.end());
+  fRhoBinsDisjoint = kTRUE;
+  for(itRhoBins = sorted.begin(); itRhoBins != sorted.end(); ++itRhoBins)
+  {
+    if(itRhoBins + 1 != sorted.end()
+      && (itRhoBins->etaMax > (itRhoBins + 1)->etaMin || itRhoBins->etaMin == (itRhoBins + 1)->etaMin))
+    {
+      fRhoBinsDisjoint = kFALSE;
+      break;
+    }
+  }
+  if(fRhoBinsDisjoint) fRhoBins.swap(sorted);
 
   // loop over all input candidates
   fItJetInputArray->Reset();
@@ -111,18 +170,7 @@ void JetPileUpSubtractor::Process()
     eta = momentum.Eta();
 
     // find rho
-    rho = 0.0;
-    if(fRhoInputArray)
-    {
-      fItRhoInputArray->Reset();
-      while((object = static_cast<Candidate*>(fItRhoInputArray->Next())))
-      {
-        if(eta >= object->Edges[0] && eta < object->Edges[1])
-        {
-          rho = object->Momentum.Pt();
-        }
-      }
-    }
+    rho = FindRho(eta);
 
     // apply pile-up correction
     if(momentum.Pt() <= rho * area.Pt()) continue;
@@ -131,7 +179,7 @@ void JetPileUpSubtractor::Process()
 
     if(momentum.Pt() <= fJetPTMin) continue;
 
-    candidate = static_cast<Candidate*>(candidate->Clone());
+    if(!fSubtractInPlace) candidate = static_cast<Candidate*>(candidate->Clone());
     candidate->Momentum = momentum;
 
     fOutputArray->Add(candidate);
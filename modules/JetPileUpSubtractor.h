@@ -23,6 +23,13 @@
  *
  *  Subtract pile-up contribution from jets using the fastjet area method
  *
+ *  The rho of each event is loaded into a table sorted in eta and looked
+ *  up by binary search when its ranges do not overlap.
+ *
+ *  With SubtractInPlace the input jets are corrected and forwarded
+ *  instead of cloned, so the input collection holds the subtracted jets
+ *  too. Jets that do not pass the selection are left untouched.
+ *
  *  \author M. Selvaggi - UCL, Louvain-la-Neuve
  *
  */
@@ -30,6 +37,7 @@
 #include "classes/DelphesModule.h"
 
 #include <deque>
+#include <vector>
 
 class TObjArray;
 
@@ -44,10 +52,28 @@ public:
   void Process();
   void Finish();
 
+  Bool_t IsThreadSafe() const { return kTRUE; }
+
 private:
 
+#if !defined(__CINT__) && !defined(__CLING__)
+  struct RhoBin
+  {
+    Double_t etaMin, etaMax, rho;
+    bool operator<(const RhoBin &bin) const { return etaMin < bin.etaMin; }
+  };
+
+  Double_t FindRho(Double_t eta) const;
+
+  std::vector< RhoBin > fRhoBins; //!
+#endif
+
+  Bool_t fRhoBinsDisjoint; //!
+
   Double_t fJetPTMin;
 
+  Bool_t fSubtractInPlace;
+
   TIterator *fItJetInputArray; //!
   TIterator *fItRhoInputArray; //!
 
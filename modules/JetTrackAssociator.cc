@@ -0,0 +1,105 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/** \class JetTrackAssociator
+ *
+ *  Adds the tracks within DeltaR of each jet to the jet's track list.
+ *
+ */
+
+#include "modules/JetTrackAssociator.h"
+
+#include "classes/DelphesClasses.h"
+#include "classes/DelphesEtaPhiGrid.h"
+
+#include "TObjArray.h"
+#include "TLorentzVector.h"
+
+#include <vector>
+#include <stdexcept>
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+
+JetTrackAssociator::JetTrackAssociator() :
+  fGrid(0), fItJetInputArray(0)
+{
+}
+
+//------------------------------------------------------------------------------
+
+JetTrackAssociator::~JetTrackAssociator()
+{
+}
+
+//------------------------------------------------------------------------------
+
+void JetTrackAssociator::Init()
+{
+  // should be at least as large as the cone used by any tagger
+  fDeltaR = GetDouble("DeltaR", 0.4);
+
+  // the grid cells are one cone wide
+  fGrid = new DelphesEtaPhiGrid(fDeltaR, GetDouble("GridEtaMax", 5.0));
+
+  // import input array(s)
+
+  fTrackInputArray = ImportArray(GetString("TrackInputArray", "Calorimeter/eflowTracks"));
+
+  fJetInputArray = ImportArray(GetString("JetInputArray", "FastJetFinder/jets"));
+  fItJetInputArray = fJetInputArray->MakeIterator();
+}
+
+//------------------------------------------------------------------------------
+
+void JetTrackAssociator::Finish()
+{
+  if(fItJetInputArray) delete fItJetInputArray;
+  if(fGrid) delete fGrid;
+}
+
+//------------------------------------------------------------------------------
+
+void JetTrackAssociator::Process()
+{
+  Candidate *jet;
+  vector<const DelphesEtaPhiGrid::Entry *> tracks;
+  vector<const DelphesEtaPhiGrid::Entry *>::const_iterator itTrack;
+
+  fGrid->Fill(fTrackInputArray);
+
+  // loop over all input jets
+  fItJetInputArray->Reset();
+  while((jet = static_cast<Candidate *>(fItJetInputArray->Next())))
+  {
+    if(jet->GetTracks()->GetEntriesFast() > 0)
+    {
+      throw logic_error("tried to add tracks to a jet twice");
+    }
+    const TLorentzVector &jetMomentum = jet->Momentum;
+    fGrid->Find(jetMomentum.Eta(), jetMomentum.Phi(), fDeltaR, tracks);
+    for(itTrack = tracks.begin(); itTrack != tracks.end(); ++itTrack)
+    {
+      jet->AddTrack((*itTrack)->candidate);
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,68 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef JetTrackAssociator_h
+#define JetTrackAssociator_h
+
+/** \class JetTrackAssociator
+ *
+ *  Adds the tracks within DeltaR of each jet to the jet's track list
+ *  (Candidate::GetTracks()), so the taggers don't each have to loop
+ *  over all tracks for every jet. Uses an eta-phi grid to find the
+ *  neighbours.
+ *
+ *  The taggers (TrackBasedBTagging, TrackCountingBTagging,
+ *  SecondaryVertexTagging, JetTrackDumper) take these tracks when their
+ *  UseJetTracks parameter is true, instead of searching their
+ *  TrackInputArray. This module must then run before them, and its
+ *  DeltaR should be at least as large as theirs: they still apply
+ *  their own cuts to the attached tracks.
+ *
+ */
+
+#include "classes/DelphesModule.h"
+
+class TObjArray;
+class DelphesEtaPhiGrid;
+
+class JetTrackAssociator: public DelphesModule
+{
+public:
+
+  JetTrackAssociator();
+  ~JetTrackAssociator();
+
+  void Init();
+  void Process();
+  void Finish();
+
+private:
+
+  Double_t fDeltaR;
+
+  DelphesEtaPhiGrid *fGrid; //!
+
+  TIterator *fItJetInputArray; //!
+
+  const TObjArray *fTrackInputArray; //!
+  const TObjArray *fJetInputArray; //!
+
+  ClassDef(JetTrackAssociator, 1)
+};
+
+#endif
@@ -30,11 +30,17 @@
 #include "classes/DelphesClasses.h"
 #include "classes/DelphesFactory.h"
 #include "classes/DelphesFormula.h"
+#include "classes/DelphesKinematics.h"
+#include "classes/DelphesCovariance.h"
+
+#include "ExRootAnalysis/ExRootTreeWriter.h"
 
 #include "TString.h"
 #include "TFormula.h"
 #include "TRandom3.h"
 #include "TObjArray.h"
+#include "TFolder.h"
+#include "TVector2.h"
 #include "TLorentzVector.h"
 
 #include <algorithm>
@@ -45,10 +51,17 @@
 
 using namespace std;
 
+namespace jettracks {
+  H5_DEFINE_TYPE(Jet, JET_TRACKS_JET_FIELDS)
+  H5_DEFINE_TYPE(Track, JET_TRACKS_TRACK_FIELDS)
+}
+
 //------------------------------------------------------------------------------
 
 JetTrackDumper::JetTrackDumper() :
-  fItTrackInputArray(0), fItJetInputArray(0)
+  fItTrackInputArray(0), fItJetInputArray(0),
+  fCovarianceForm(0), fCovarianceMantissaBits(23),
+  fOutFile(0), fJetBuffer(0), fTrackBuffer(0), fEventNumber(0)
 {
 }
 
@@ -56,17 +69,30 @@ JetTrackDumper::JetTrackDumper() :
 
 JetTrackDumper::~JetTrackDumper()
 {
+  delete fJetBuffer;
+  delete fTrackBuffer;
+  delete fOutFile;
 }
 
 //------------------------------------------------------------------------------
 
 void JetTrackDumper::Init()
 {
+  ExRootTreeWriter *treeWriter;
+  string fileName, extension, fileBase;
+  h5::DatasetOptions options;
+  Int_t bufferSize;
+  size_t dot;
 
   fPtMin = GetDouble("TrackPtMin", 1.0);
   fDeltaR = GetDouble("DeltaR", 0.3);
   fIPmax = GetDouble("TrackIPMax", 2.0);
 
+  // see JetTrackAssociator.h
+  fUseJetTracks = GetBool("UseJetTracks", false);
+
+  fAddCandidates = GetBool("AddCandidates", true);
+
   // import input array(s)
 
   fTrackInputArray = ImportArray(GetString("TrackInputArray", "Calorimeter/eflowTracks"));
@@ -74,20 +100,95 @@ void JetTrackDumper::Init()
 
   fJetInputArray = ImportArray(GetString("JetInputArray", "FastJetFinder/jets"));
   fItJetInputArray = fJetInputArray->MakeIterator();
+
+  // HDF5 output, named after the root output file with OutputExtension
+  // when OutputFile is not given
+
+  fileName = GetString("OutputFile", "");
+  extension = GetString("OutputExtension", "");
+  if(fileName.empty() && !extension.empty())
+  {
+    treeWriter = static_cast<ExRootTreeWriter *>(GetFolder()->FindObject("TreeWriter"));
+    if(!treeWriter)
+    {
+      throw runtime_error("JetTrackDumper needs OutputFile when there's no TreeWriter");
+    }
+    fileBase = treeWriter->GetFirstFileName();
+    dot = fileBase.find_last_of(".");
+    if(dot != string::npos) fileBase = fileBase.substr(0, dot);
+    fileName = fileBase + extension;
+  }
+
+  if(fileName.empty()) return;
+
+  // trk_cov as in TreeWriter
+  fCovarianceForm = DelphesCovariance::GetForm(GetString("CovarianceForm", "Plain"));
+  fCovarianceMantissaBits = GetInt("CovarianceMantissaBits", 23);
+
+  options.chunk_size = GetInt("ChunkSize", 0);
+  options.compression = GetString("Compression", "deflate-7");
+  options.shuffle = GetBool("Shuffle", false);
+  bufferSize = GetInt("BufferSize", 1000);
+  if(bufferSize < 1)
+  {
+    throw runtime_error("JetTrackDumper: BufferSize must be positive");
+  }
+
+  fOutFile = new H5::H5File(fileName, H5F_ACC_TRUNC);
+
+  fJetBuffer = new OneDimBuffer<jettracks::Jet>(
+    *fOutFile, "jets", jettracks::type(jettracks::Jet()), bufferSize, options);
+  fTrackBuffer = new OneDimBuffer<jettracks::Track>(
+    *fOutFile, "tracks", jettracks::type(jettracks::Track()), bufferSize, options);
+
+  // compress and write full buffers in background threads
+  if(GetBool("AsyncWrite", false))
+  {
+    fJetBuffer->set_async();
+    fTrackBuffer->set_async();
+  }
 }
 
 //------------------------------------------------------------------------------
 
 void JetTrackDumper::Finish()
 {
+  CloseFile();
+
   if(fItTrackInputArray) delete fItTrackInputArray;
   if(fItJetInputArray) delete fItJetInputArray;
 }
 
 //------------------------------------------------------------------------------
 
+void JetTrackDumper::CloseFile()
+{
+  if(fJetBuffer) fJetBuffer->close();
+  if(fTrackBuffer) fTrackBuffer->close();
+
+  delete fJetBuffer;
+  delete fTrackBuffer;
+  fJetBuffer = 0;
+  fTrackBuffer = 0;
+
+  if(fOutFile) fOutFile->close();
+  delete fOutFile;
+  fOutFile = 0;
+}
+
+//------------------------------------------------------------------------------
+
 void JetTrackDumper::Process()
 {
+  // without the jet tracks every jet visits all the tracks, whose pt, eta
+  // and phi are read from the float arrays shared by the modules
+  const DelphesKinematics::View *tracks = 0;
+  if(!fUseJetTracks) tracks = &GetFactory()->GetKinematics(fTrackInputArray);
+  const float deltaR2 = fDeltaR*fDeltaR;
+  const float pi = M_PI;
+
+  vector< Candidate * >::const_iterator itTracks;
+  Int_t jetIndex = 0;
 
   // loop over all input jets
   fItJetInputArray->Reset();
@@ -95,30 +196,106 @@ void JetTrackDumper::Process()
   while((jet = static_cast<Candidate*>(fItJetInputArray->Next())))
   {
     const TLorentzVector &jetMomentum = jet->Momentum;
-    double jpx = jetMomentum.Px();
-    double jpy = jetMomentum.Py();
 
-    // loop over all input tracks
-    fItTrackInputArray->Reset();
-    Candidate* track;
-    while((track = static_cast<Candidate*>(fItTrackInputArray->Next())))
+    // the tracks of the jet are selected once, then added to the jet and
+    // written
+    fTracks.clear();
+
+    if(tracks)
+    {
+      const float jeta = jetMomentum.Eta();
+      const float jphi = jetMomentum.Phi();
+
+      for(int i = 0; i < tracks->size; ++i)
+      {
+        if(tracks->pt[i] < fPtMin) continue;
+
+        float deta = tracks->eta[i] - jeta;
+        float dphi = std::abs(tracks->phi[i] - jphi);
+        if(dphi > pi) dphi = 2.0f*pi - dphi;
+        if(deta*deta + dphi*dphi > deltaR2) continue;
+
+        Candidate* track = tracks->candidates[i];
+        if(std::abs(track->Dxy) > fIPmax) continue;
+
+        fTracks.push_back(track);
+      }
+    }
+    else
     {
-      const TLorentzVector &trkMomentum = track->Momentum;
+      // loop over the tracks already in the jet
+      TIter itJetTracks(jet->GetTracks());
+      Candidate* track;
+      while((track = static_cast<Candidate*>(itJetTracks.Next())))
+      {
+        const TLorentzVector &trkMomentum = track->Momentum;
 
-      double dr = jetMomentum.DeltaR(trkMomentum);
+        double dr = jetMomentum.DeltaR(trkMomentum);
 
-      double tpt = trkMomentum.Pt();
-      double dxy = std::abs(track->Dxy);
-      double ddxy = track->SDxy;
+        double tpt = trkMomentum.Pt();
+        double dxy = std::abs(track->Dxy);
 
-      if(tpt < fPtMin) continue;
-      if(dr > fDeltaR) continue;
-      if(dxy > fIPmax) continue;
+        if(tpt < fPtMin) continue;
+        if(dr > fDeltaR) continue;
+        if(dxy > fIPmax) continue;
 
+        fTracks.push_back(track);
+      }
+    }
+
+    if(fAddCandidates)
+    {
       // add tracks as jet candidates
       // TODO: make sure this doesn't mess with the downstream variables
-      jet->AddCandidate(track);
+      for(itTracks = fTracks.begin(); itTracks != fTracks.end(); ++itTracks)
+      {
+        jet->AddCandidate(*itTracks);
+      }
     }
+
+    if(fTrackBuffer) WriteTracks(jet, jetIndex);
+
+    ++jetIndex;
+  }
+
+  ++fEventNumber;
+}
+
+//------------------------------------------------------------------------------
+
+void JetTrackDumper::WriteTracks(const Candidate *jet, int jetIndex)
+{
+  const TLorentzVector &jetMomentum = jet->Momentum;
+  const float jetEta = jetMomentum.Eta();
+  const float jetPhi = jetMomentum.Phi();
+  vector< Candidate * >::const_iterator itTracks;
+  jettracks::Jet jetRecord;
+  jettracks::Track trackRecord;
+  const Candidate *track;
+
+  jetRecord.event_number = fEventNumber;
+  jetRecord.jet_index = jetIndex;
+  jetRecord.pt = jetMomentum.Pt();
+  jetRecord.eta = jetEta;
+  jetRecord.phi = jetPhi;
+  jetRecord.n_tracks = fTracks.size();
+  fJetBuffer->push_back(jetRecord);
+
+  trackRecord.event_number = fEventNumber;
+  trackRecord.jet_index = jetIndex;
+  for(itTracks = fTracks.begin(); itTracks != fTracks.end(); ++itTracks)
+  {
+    track = *itTracks;
+    const TLorentzVector &trkMomentum = track->Momentum;
+
+    trackRecord.pt = trkMomentum.Pt();
+    trackRecord.delta_eta = trkMomentum.Eta() - jetEta;
+    trackRecord.delta_phi = TVector2::Phi_mpi_pi(trkMomentum.Phi() - jetPhi);
+    trackRecord.charge = track->Charge;
+    copy(track->trkPar, track->trkPar + 5, trackRecord.trk_par);
+    DelphesCovariance::Encode(track->trkCov, trackRecord.trk_cov, fCovarianceForm, fCovarianceMantissaBits);
+
+    fTrackBuffer->push_back(trackRecord);
   }
 }
 
@@ -23,6 +23,14 @@
  *
  *  dump tracks for b-tagging by adding them to the list of candidates
  *
+ *  With OutputFile, or with OutputExtension the name of the root output
+ *  file with that extension, the same tracks are also written to HDF5:
+ *  one record per track in `tracks`, with the index of its jet in the
+ *  event, and one record per jet in `jets`, whose n_tracks gives the
+ *  records of the jet, which follow each other. With AddCandidates
+ *  set to false the tracks are only written. CovarianceForm and
+ *  CovarianceMantissaBits set how trk_cov is stored, as in TreeWriter.
+ *
  *  \author dguest
  *
  */
@@ -30,8 +38,57 @@
 #include "classes/DelphesModule.h"
 
 #include <map>
+#include <vector>
 
 class TObjArray;
+class Candidate;
+
+#ifndef __CINT__
+
+#include "external/h5/OneDimBuffer.hh"
+#include "external/h5/h5types.hh"
+
+#include "H5Cpp.h"
+
+namespace jettracks {
+
+#define JET_TRACKS_JET_FIELDS(FIELD)		\
+  FIELD(int, event_number)			\
+  FIELD(int, jet_index)				\
+  FIELD(float, pt)				\
+  FIELD(float, eta)				\
+  FIELD(float, phi)				\
+  FIELD(int, n_tracks)
+  struct Jet {
+    JET_TRACKS_JET_FIELDS(H5_DECLARE_FIELD)
+  };
+  H5::CompType type(Jet);
+
+  // trk_par and trk_cov as in Candidate
+  typedef float TrackParameters[5];
+  typedef float TrackCovariance[15];
+#define JET_TRACKS_TRACK_FIELDS(FIELD)		\
+  FIELD(int, event_number)			\
+  FIELD(int, jet_index)				\
+  FIELD(float, pt)				\
+  FIELD(float, delta_eta)			\
+  FIELD(float, delta_phi)			\
+  FIELD(int, charge)				\
+  FIELD(TrackParameters, trk_par)		\
+  FIELD(TrackCovariance, trk_cov)
+  struct Track {
+    JET_TRACKS_TRACK_FIELDS(H5_DECLARE_FIELD)
+  };
+  H5::CompType type(Track);
+}
+
+#else  // CINT include dummy
+
+namespace H5 {
+  class H5File;
+}
+
+#endif
 
 class JetTrackDumper: public DelphesModule
 {
@@ -46,16 +103,38 @@ public:
 
 private:
 
+  void WriteTracks(const Candidate *jet, int jetIndex);
+  void CloseFile();
+
   Double_t fPtMin;
   Double_t fDeltaR;
   Double_t fIPmax;
 
+  Bool_t fUseJetTracks;
+  Bool_t fAddCandidates;
+
   TIterator *fItTrackInputArray; //!
   TIterator *fItJetInputArray; //!
 
   const TObjArray *fTrackInputArray; //!
   const TObjArray *fJetInputArray; //!
 
+  // form and precision of trk_cov, see DelphesCovariance
+  Int_t fCovarianceForm;
+  Int_t fCovarianceMantissaBits;
+
+  // tracks selected for the current jet
+  std::vector< Candidate * > fTracks; //!
+
+  H5::H5File *fOutFile; //!
+
+#ifndef __CINT__
+  OneDimBuffer<jettracks::Jet> *fJetBuffer; //!
+  OneDimBuffer<jettracks::Track> *fTrackBuffer; //!
+#endif
+
+  Int_t fEventNumber;
+
   ClassDef(JetTrackDumper, 1)
 };
 
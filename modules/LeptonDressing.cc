@@ -30,6 +30,7 @@
 #include "classes/DelphesClasses.h"
 #include "classes/DelphesFactory.h"
 #include "classes/DelphesFormula.h"
+#include "classes/DelphesEtaPhiGrid.h"
 
 #include "ExRootAnalysis/ExRootResult.h"
 #include "ExRootAnalysis/ExRootFilter.h"
@@ -53,7 +54,7 @@ using namespace std;
 //------------------------------------------------------------------------------
 
 LeptonDressing::LeptonDressing() :
- fItDressingInputArray(0), fItCandidateInputArray(0)
+ fItCandidateInputArray(0)
 {
 }
 
@@ -72,7 +73,6 @@ void LeptonDressing::Init()
   // import input array(s)
 
   fDressingInputArray = ImportArray(GetString("DressingInputArray", "Calorimeter/photons"));
-  fItDressingInputArray = fDressingInputArray->MakeIterator();
   
   fCandidateInputArray = ImportArray(GetString("CandidateInputArray", "UniqueObjectFinder/electrons"));
   fItCandidateInputArray = fCandidateInputArray->MakeIterator();
@@ -87,34 +87,33 @@ void LeptonDressing::Init()
 void LeptonDressing::Finish()
 {
   if(fItCandidateInputArray) delete fItCandidateInputArray;
-  if(fItDressingInputArray) delete fItDressingInputArray;
 }
 
 //------------------------------------------------------------------------------
 
 void LeptonDressing::Process()
 {
-  Candidate *candidate, *dressing, *mother;
+  Candidate *candidate, *mother;
   TLorentzVector momentum;
-  
+  vector<const DelphesEtaPhiGrid::Entry *> dressings;
+  vector<const DelphesEtaPhiGrid::Entry *>::const_iterator itDressing;
+
+  const DelphesEtaPhiGrid &grid = GetFactory()->GetEtaPhiGrid(fDressingInputArray);
+
   // loop over all input candidate
   fItCandidateInputArray->Reset();
   while((candidate = static_cast<Candidate*>(fItCandidateInputArray->Next())))
   {
     const TLorentzVector &candidateMomentum = candidate->Momentum;
 
-    // loop over all input tracks
-    fItDressingInputArray->Reset();
+    // loop over the input tracks inside the cone
+    grid.Find(candidateMomentum.Eta(), candidateMomentum.Phi(), fDeltaR, dressings);
     momentum.SetPxPyPzE(0.0, 0.0, 0.0, 0.0);
-    while((dressing = static_cast<Candidate*>(fItDressingInputArray->Next())))
+    for(itDressing = dressings.begin(); itDressing != dressings.end(); ++itDressing)
     {
-      const TLorentzVector &dressingMomentum = dressing->Momentum;
-      if (dressingMomentum.Pt() > 0.1)
+      if((*itDressing)->pt > 0.1)
       {
-        if(candidateMomentum.DeltaR(dressingMomentum) <= fDeltaR)
-        {
-          momentum += dressingMomentum;
-        }
+        momentum += (*itDressing)->candidate->Momentum;
       }
     }
 
@@ -30,6 +30,7 @@
 class TIterator;
 class TObjArray;
 
+
 class LeptonDressing: public DelphesModule
 {
 public:
@@ -41,12 +42,12 @@ public:
   void Process();
   void Finish();
 
+  Bool_t IsThreadSafe() const { return kTRUE; }
+
 private:
 
   Double_t fDeltaR;
   
-  TIterator *fItDressingInputArray; //!
-  
   TIterator *fItCandidateInputArray; //!
 
   const TObjArray *fDressingInputArray; //!
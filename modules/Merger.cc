@@ -29,6 +29,7 @@
 #include "modules/Merger.h"
 
 #include "classes/DelphesClasses.h"
+#include "classes/CandidateSpan.h"
 #include "classes/DelphesFactory.h"
 #include "classes/DelphesFormula.h"
 
@@ -70,22 +71,20 @@ void Merger::Init()
   // import arrays with output from other modules
 
   ExRootConfParam param = GetParam("InputArray");
+  const char *name;
   Long_t i, size;
-  const TObjArray *array;
-  TIterator *iterator;
 
   size = param.GetSize();
   for(i = 0; i < size; ++i)
   {
-    array = ImportArray(param[i].GetString());
-    iterator = array->MakeIterator();
-
-    fInputList.push_back(iterator);
+    fInputList.push_back(ImportArray(param[i].GetString()));
   }
 
   // create output arrays
 
-  fOutputArray = ExportArray(GetString("OutputArray", "candidates"));
+  // no merged array when only the sums are used
+  name = GetString("OutputArray", "candidates");
+  fOutputArray = name[0] ? ExportArray(name) : 0;
 
   fMomentumOutputArray = ExportArray(GetString("MomentumOutputArray", "momentum"));
   
@@ -96,14 +95,6 @@ void Merger::Init()
 
 void Merger::Finish()
 {
-  vector< TIterator * >::iterator itInputList;
-  TIterator *iterator;
-
-  for(itInputList = fInputList.begin(); itInputList != fInputList.end(); ++itInputList)
-  {
-    iterator = *itInputList;
-    if(iterator) delete iterator;
-  }
 }
 
 //------------------------------------------------------------------------------
@@ -113,8 +104,7 @@ void Merger::Process()
   Candidate *candidate;
   TLorentzVector momentum;
   Double_t sumPT, sumE;  
-  vector< TIterator * >::iterator itInputList;
-  TIterator *iterator;
+  vector< const TObjArray * >::iterator itInputList;
 
   DelphesFactory *factory = GetFactory();
   
@@ -125,19 +115,16 @@ void Merger::Process()
   // loop over all input arrays
   for(itInputList = fInputList.begin(); itInputList != fInputList.end(); ++itInputList)
   {
-    iterator = *itInputList;
-
     // loop over all candidates
-    iterator->Reset();
-    while((candidate = static_cast<Candidate*>(iterator->Next())))
+    for(Candidate *input : CandidateSpan(*itInputList))
     {
-      const TLorentzVector &candidateMomentum = candidate->Momentum;
+      const TLorentzVector &candidateMomentum = input->Momentum;
 
       momentum += candidateMomentum;
       sumPT += candidateMomentum.Pt();
       sumE += candidateMomentum.E();
 
-      fOutputArray->Add(candidate);
+      if(fOutputArray) fOutputArray->Add(input);
     }
   }
 
@@ -24,6 +24,9 @@
  *  Merges multiple input arrays into one output array
  *  and sums transverse momenta of all input objects.
  *
+ *  An empty OutputArray only gives the sums, for MissingET and ScalarHT,
+ *  without filling a merged array that no module reads.
+ *
  *  \author P. Demin - UCL, Louvain-la-Neuve
  *
  */
@@ -32,7 +35,6 @@
 
 #include <vector>
 
-class TIterator;
 class TObjArray;
 
 class Merger: public DelphesModule
@@ -46,9 +48,11 @@ public:
   void Process();
   void Finish();
 
+  Bool_t IsThreadSafe() const { return kTRUE; }
+
 private:
 
-  std::vector< TIterator * > fInputList; //!
+  std::vector< const TObjArray * > fInputList; //!
 
   TObjArray *fOutputArray; //!
   TObjArray *fMomentumOutputArray; //!
@@ -46,16 +46,22 @@
 #include "modules/BTagging.h"
 #include "modules/TauTagging.h"
 #include "modules/TreeWriter.h"
+#include "modules/FlatTreeWriter.h"
 #include "modules/Merger.h"
 #include "modules/LeptonDressing.h"
 #include "modules/PileUpMerger.h"
+#include "modules/PremixedPileUpWriter.h"
+#include "modules/SnapshotReader.h"
 #include "modules/JetPileUpSubtractor.h"
 #include "modules/TrackPileUpSubtractor.h"
 #include "modules/TaggingParticlesSkimmer.h"
+#include "modules/TruthSkimmer.h"
 #include "modules/PileUpJetID.h"
 #include "modules/ConstituentFilter.h"
 #include "modules/StatusPidFilter.h"
 #include "modules/PdgCodeFilter.h"
+#include "modules/EventFilter.h"
+#include "modules/TrackingPipeline.h"
 #include "modules/Cloner.h"
 #include "modules/Weighter.h"
 #include "modules/Hector.h"
@@ -63,10 +69,13 @@
 #include "modules/ExampleModule.h"
 
 #include "modules/JetTrackDumper.h"
+#include "modules/JetTrackAssociator.h"
 #include "modules/SecondaryVertexTagging.h"
+#include "modules/PrimaryVertexFinder.h"
 #include "modules/TrackBasedBTagging.h"
 #include "modules/SecondaryVertexAssociator.h"
 #include "modules/HDF5Writer.h"
+#include "modules/JetImageWriter.h"
 
 #ifdef __CINT__
 
@@ -95,16 +104,22 @@
 #pragma link C++ class BTagging+;
 #pragma link C++ class TauTagging+;
 #pragma link C++ class TreeWriter+;
+#pragma link C++ class FlatTreeWriter+;
 #pragma link C++ class Merger+;
 #pragma link C++ class LeptonDressing+;
 #pragma link C++ class PileUpMerger+;
+#pragma link C++ class PremixedPileUpWriter+;
+#pragma link C++ class SnapshotReader+;
 #pragma link C++ class JetPileUpSubtractor+;
 #pragma link C++ class TrackPileUpSubtractor+;
 #pragma link C++ class TaggingParticlesSkimmer+;
+#pragma link C++ class TruthSkimmer+;
 #pragma link C++ class PileUpJetID+;
 #pragma link C++ class ConstituentFilter+;
 #pragma link C++ class StatusPidFilter+;
 #pragma link C++ class PdgCodeFilter+;
+#pragma link C++ class EventFilter+;
+#pragma link C++ class TrackingPipeline+;
 #pragma link C++ class Cloner+;
 #pragma link C++ class Weighter+;
 #pragma link C++ class Hector+;
@@ -112,9 +127,12 @@
 #pragma link C++ class ExampleModule+;
 
 #pragma link C++ class JetTrackDumper+;
+#pragma link C++ class JetTrackAssociator+;
 #pragma link C++ class SecondaryVertexTagging+;
+#pragma link C++ class PrimaryVertexFinder+;
 #pragma link C++ class TrackBasedBTagging+;
 #pragma link C++ class SecondaryVertexAssociator+;
 #pragma link C++ class HDF5Writer+;
+#pragma link C++ class JetImageWriter+;
 
 #endif
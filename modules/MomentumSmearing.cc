@@ -28,6 +28,7 @@
 #include "modules/MomentumSmearing.h"
 
 #include "classes/DelphesClasses.h"
+#include "classes/CandidateSpan.h"
 #include "classes/DelphesFactory.h"
 #include "classes/DelphesFormula.h"
 
@@ -53,9 +54,10 @@ using namespace std;
 //------------------------------------------------------------------------------
 
 MomentumSmearing::MomentumSmearing() :
-  fFormula(0), fItInputArray(0)
+  fFormula(0), fBatch(0)
 {
   fFormula = new DelphesFormula;
+  fBatch = new DelphesFormulaBatch;
 }
 
 //------------------------------------------------------------------------------
@@ -63,20 +65,27 @@ MomentumSmearing::MomentumSmearing() :
 MomentumSmearing::~MomentumSmearing()
 {
   if(fFormula) delete fFormula;
+  if(fBatch) delete fBatch;
 }
 
 //------------------------------------------------------------------------------
 
 void MomentumSmearing::Init()
 {
+  ExRootConfParam param;
+
   // read resolution formula
 
   fFormula->Compile(GetString("ResolutionFormula", "0.0"));
 
+  // a binned table replaces the formula when it is given
+
+  param = GetParam("ResolutionTable");
+  if(param.GetSize() > 0) fFormula->SetTable(param);
+
   // import input array
 
   fInputArray = ImportArray(GetString("InputArray", "ParticlePropagator/stableParticles"));
-  fItInputArray = fInputArray->MakeIterator();
 
   // create output array
 
@@ -87,38 +96,45 @@ void MomentumSmearing::Init()
 
 void MomentumSmearing::Finish()
 {
-  if(fItInputArray) delete fItInputArray;
 }
 
 //------------------------------------------------------------------------------
 
 void MomentumSmearing::Process()
 {
+  CandidateSpan candidates(fInputArray);
   Candidate *candidate, *mother;
-  Double_t pt, eta, phi, e;
+  Double_t pt, eta, phi;
+  Int_t i, n = candidates.size();
 
-  fItInputArray->Reset();
-  while((candidate = static_cast<Candidate*>(fItInputArray->Next())))
+  // collect the variables of all the candidates and evaluate the
+  // resolution formula for all of them at once
+  fBatch->Resize(n);
+  for(i = 0; i < n; ++i)
   {
-    const TLorentzVector &candidatePosition = candidate->Position;
-    const TLorentzVector &candidateMomentum = candidate->Momentum;
-    eta = candidatePosition.Eta();
-    phi = candidatePosition.Phi();
-    pt = candidateMomentum.Pt();
-    e = candidateMomentum.E();
+    candidate = candidates[i];
+    fBatch->eta[i] = candidate->Position.Eta();
+    fBatch->phi[i] = candidate->Position.Phi();
+    fBatch->pt[i] = candidate->Momentum.Pt();
+    fBatch->energy[i] = candidate->Momentum.E();
+  }
+  fFormula->Eval(*fBatch);
 
+  for(i = 0; i < n; ++i)
+  {
     // apply smearing formula
-    pt = gRandom->Gaus(pt, fFormula->Eval(pt, eta, phi, e) * pt);
-    
+    pt = fBatch->pt[i];
+    pt = Gaus(pt, fBatch->result[i] * pt);
+
     if(pt <= 0.0) continue;
 
-    mother = candidate;
-    candidate = static_cast<Candidate*>(candidate->Clone());
-    eta = candidateMomentum.Eta();
-    phi = candidateMomentum.Phi();
+    mother = candidates[i];
+    candidate = static_cast<Candidate*>(mother->Clone());
+    eta = mother->Momentum.Eta();
+    phi = mother->Momentum.Phi();
     candidate->Momentum.SetPtEtaPhiE(pt, eta, phi, pt*TMath::CosH(eta));
     candidate->AddCandidate(mother);
-        
+
     fOutputArray->Add(candidate);
   }
 }
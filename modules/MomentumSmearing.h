@@ -29,10 +29,11 @@
 
 #include "classes/DelphesModule.h"
 
-class TIterator;
 class TObjArray;
 class DelphesFormula;
 
+struct DelphesFormulaBatch;
+
 class MomentumSmearing: public DelphesModule
 {
 public:
@@ -44,11 +45,12 @@ public:
   void Process();
   void Finish();
 
+  Bool_t IsThreadSafe() const { return HasRandomStream(); }
+
 private:
 
   DelphesFormula *fFormula; //!
-
-  TIterator *fItInputArray; //!
+  DelphesFormulaBatch *fBatch; //!
 
   const TObjArray *fInputArray; //!
   
@@ -50,14 +50,18 @@
 #include <stdexcept>
 #include <iostream>
 #include <sstream>
+#include <thread>
 
 using namespace std;
 using namespace TrackParam;
 
+// fewest particles worth a thread of their own
+static const Int_t kMinParticlesPerThread = 512;
+
 //------------------------------------------------------------------------------
 
 ParticlePropagator::ParticlePropagator() :
-  fItInputArray(0)
+  fNThreads(1), fItInputArray(0)
 {
 }
 
@@ -75,6 +79,11 @@ void ParticlePropagator::Init()
   fRadius2 = fRadius*fRadius;
   fHalfLength = GetDouble("HalfLength", 3.0);
   fBz = GetDouble("Bz", 0.0);
+  fNThreads = GetInt("NThreads", 1);
+  if(fNThreads < 1)
+  {
+    throw runtime_error("NThreads must be positive");
+  }
   if(fRadius < 1.0E-2)
   {
     cout << "ERROR: magnetic field radius is too low\n";
@@ -111,7 +120,110 @@ void ParticlePropagator::Finish()
 void ParticlePropagator::Process()
 {
   Candidate *candidate, *mother;
-  TLorentzVector candidatePosition, candidateMomentum;
+  Int_t i, n, nWorkers, chunk, worker;
+  vector< thread > workers;
+  vector< thread >::iterator itWorkers;
+
+  // gather the particles, the kernel reads them from flat arrays
+  fCandidates.clear();
+  fItInputArray->Reset();
+  while((candidate = static_cast<Candidate*>(fItInputArray->Next())))
+  {
+    fCandidates.push_back(candidate);
+  }
+
+  n = fCandidates.size();
+  fX.resize(n);
+  fY.resize(n);
+  fZ.resize(n);
+  fT.resize(n);
+  fPx.resize(n);
+  fPy.resize(n);
+  fPz.resize(n);
+  fE.resize(n);
+  fQ.resize(n);
+  fPropagated.resize(n);
+
+  for(i = 0; i < n; ++i)
+  {
+    const TLorentzVector &candidatePosition = fCandidates[i]->Position;
+    const TLorentzVector &candidateMomentum = fCandidates[i]->Momentum;
+    fX[i] = candidatePosition.X()*1.0E-3;
+    fY[i] = candidatePosition.Y()*1.0E-3;
+    fZ[i] = candidatePosition.Z()*1.0E-3;
+    fT[i] = candidatePosition.T();
+    fPx[i] = candidateMomentum.Px();
+    fPy[i] = candidateMomentum.Py();
+    fPz[i] = candidateMomentum.Pz();
+    fE[i] = candidateMomentum.E();
+    fQ[i] = fCandidates[i]->Charge;
+  }
+
+  // the particles are independent, each worker takes a contiguous chunk
+  nWorkers = TMath::Min(fNThreads, TMath::Max(n/kMinParticlesPerThread, 1));
+  if(nWorkers <= 1)
+  {
+    Propagate(0, n);
+  }
+  else
+  {
+    chunk = (n + nWorkers - 1)/nWorkers;
+    for(worker = 0; worker < nWorkers; ++worker)
+    {
+      workers.push_back(thread(&ParticlePropagator::Propagate, this, worker*chunk, TMath::Min((worker + 1)*chunk, n)));
+    }
+    for(itWorkers = workers.begin(); itWorkers != workers.end(); ++itWorkers) itWorkers->join();
+  }
+
+  // create the output candidates in input order
+  for(i = 0; i < n; ++i)
+  {
+    const Propagated &propagated = fPropagated[i];
+    if(propagated.status == kNotPropagated) continue;
+
+    mother = fCandidates[i];
+    candidate = static_cast<Candidate*>(mother->Clone());
+
+    candidate->Position.SetXYZT(propagated.x, propagated.y, propagated.z, propagated.t);
+
+    candidate->Momentum = mother->Momentum;
+
+    if(propagated.status == kHelix)
+    {
+      candidate->Dxy = propagated.dxy;
+      candidate->Xd = propagated.xd;
+      candidate->Yd = propagated.yd;
+      candidate->Zd = propagated.zd;
+
+      //ATLAS track coordinate
+      copy(propagated.trkPar, propagated.trkPar + 5, candidate->trkPar);
+    }
+
+    candidate->AddCandidate(mother);
+
+    fOutputArray->Add(candidate);
+    if(TMath::Abs(fQ[i]) > 1.0E-9)
+    {
+      switch(TMath::Abs(candidate->PID))
+      {
+        case 11:
+          fElectronOutputArray->Add(candidate);
+          break;
+        case 13:
+          fMuonOutputArray->Add(candidate);
+          break;
+        default:
+          fChargedHadronOutputArray->Add(candidate);
+      }
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void ParticlePropagator::Propagate(Int_t first, Int_t last)
+{
+  Int_t i;
   Double_t px, py, pz, pt, pt2, e, q;
   Double_t x, y, z, t, r, phi;
   Double_t x_c, y_c, r_c, phi_c, phi_0;
@@ -124,15 +236,15 @@ void ParticlePropagator::Process()
 
   const Double_t c_light = 2.99792458E8;
 
-  fItInputArray->Reset();
-  while((candidate = static_cast<Candidate*>(fItInputArray->Next())))
+  for(i = first; i < last; ++i)
   {
-    candidatePosition = candidate->Position;
-    candidateMomentum = candidate->Momentum;
-    x = candidatePosition.X()*1.0E-3;
-    y = candidatePosition.Y()*1.0E-3;
-    z = candidatePosition.Z()*1.0E-3;
-    q = candidate->Charge;
+    Propagated &propagated = fPropagated[i];
+    propagated.status = kNotPropagated;
+
+    x = fX[i];
+    y = fY[i];
+    z = fZ[i];
+    q = fQ[i];
 
     // check that particle position is inside the cylinder
     if(TMath::Hypot(x, y) > fRadius || TMath::Abs(z) > fHalfLength)
@@ -140,12 +252,12 @@ void ParticlePropagator::Process()
       continue;
     }
 
-    px = candidateMomentum.Px();
-    py = candidateMomentum.Py();
-    pz = candidateMomentum.Pz();
-    pt = candidateMomentum.Pt();
-    pt2 = candidateMomentum.Perp2();
-    e = candidateMomentum.E();
+    px = fPx[i];
+    py = fPy[i];
+    pz = fPz[i];
+    pt2 = px*px + py*py;
+    pt = TMath::Sqrt(pt2);
+    e = fE[i];
 
     if(pt2 < 1.0E-9)
     {
@@ -182,33 +294,14 @@ void ParticlePropagator::Process()
       y_t = y + py*t;
       z_t = z + pz*t;
 
-      mother = candidate;
-      candidate = static_cast<Candidate*>(candidate->Clone());
-
-      candidate->Position.SetXYZT(x_t*1.0E3, y_t*1.0E3, z_t*1.0E3, candidatePosition.T() + t*e*1.0E3);
-
-      candidate->Momentum = candidateMomentum;
-      candidate->AddCandidate(mother);
-
-      fOutputArray->Add(candidate);
-      if(TMath::Abs(q) > 1.0E-9)
-      {
-        switch(TMath::Abs(candidate->PID))
-        {
-          case 11:
-            fElectronOutputArray->Add(candidate);
-            break;
-          case 13:
-            fMuonOutputArray->Add(candidate);
-            break;
-          default:
-            fChargedHadronOutputArray->Add(candidate);
-        }
-      }
+      propagated.status = kStraight;
+      propagated.x = x_t*1.0E3;
+      propagated.y = y_t*1.0E3;
+      propagated.z = z_t*1.0E3;
+      propagated.t = fT[i] + t*e*1.0E3;
     }
     else
     {
-
       // 1.  initial transverse momentum p_{T0}: Part->pt
       //     initial transverse momentum direction phi_0 = -atan(p_X0/p_Y0)
       //     relativistic gamma: gamma = E/mc^2; gammam = gamma * m
@@ -289,49 +382,33 @@ void ParticlePropagator::Process()
 
       if(r_t > 0.0)
       {
-        mother = candidate;
-        candidate = static_cast<Candidate*>(candidate->Clone());
-
-        candidate->Position.SetXYZT(x_t*1.0E3, y_t*1.0E3, z_t*1.0E3, candidatePosition.T() + t*c_light*1.0E3);
-
-        candidate->Momentum = candidateMomentum;
-        candidate->Dxy = dxy*1.0E3;
-        candidate->Xd = xd*1.0E3;
-        candidate->Yd = yd*1.0E3;
-        candidate->Zd = zd*1.0E3;
+        propagated.status = kHelix;
+        propagated.x = x_t*1.0E3;
+        propagated.y = y_t*1.0E3;
+        propagated.z = z_t*1.0E3;
+        propagated.t = fT[i] + t*c_light*1.0E3;
 
+        propagated.dxy = dxy*1.0E3;
+        propagated.xd = xd*1.0E3;
+        propagated.yd = yd*1.0E3;
+        propagated.zd = zd*1.0E3;
 
         //ATLAS track coordinate
+        const TLorentzVector &candidateMomentum = fCandidates[i]->Momentum;
         float eta = candidateMomentum.Eta();
         float qoverp = 1./(pt*cosh(eta));
         float theta = 2.*TMath::ATan(TMath::Exp(-eta));
         if(q<1E-9) qoverp *= -1;
- 
-        float* trkPar = candidate->trkPar;
+
+        float* trkPar = propagated.trkPar;
         trkPar[D0]    = (xd*py - yd*px)/pt * 1e3;
         trkPar[Z0]    = zd * 1e3;
         trkPar[PHI]   = candidateMomentum.Phi();
         trkPar[THETA] = theta;
         trkPar[QOVERP]= qoverp;
-
-        candidate->AddCandidate(mother);
-
-        fOutputArray->Add(candidate);
-        switch(TMath::Abs(candidate->PID))
-        {
-          case 11:
-            fElectronOutputArray->Add(candidate);
-            break;
-          case 13:
-            fMuonOutputArray->Add(candidate);
-            break;
-          default:
-            fChargedHadronOutputArray->Add(candidate);
-        }
       }
     }
   }
 }
 
 //------------------------------------------------------------------------------
-
@@ -26,14 +26,21 @@
  *  its half-length, centered at (0,0,0) and with its axis
  *  oriented along the z-axis.
  *
+ *  The particles are copied to flat arrays and propagated independently,
+ *  in NThreads contiguous chunks for large events. The output arrays are
+ *  filled afterwards in input order.
+ *
  *  \author P. Demin - UCL, Louvain-la-Neuve
  *
  */
 
 #include "classes/DelphesModule.h"
 
+#include <vector>
+
 class TClonesArray;
 class TIterator;
+class Candidate;
 
 class ParticlePropagator: public DelphesModule
 {
@@ -46,11 +53,37 @@ public:
   void Process();
   void Finish();
 
+  Bool_t IsThreadSafe() const { return kTRUE; }
+
 private:
 
+#if !defined(__CINT__) && !defined(__CLING__)
+  enum Status { kNotPropagated, kStraight, kHelix };
+
+  // final position and, along a helix, the track parameters
+  struct Propagated
+  {
+    Status status;
+    Double_t x, y, z, t;
+    Double_t dxy, xd, yd, zd;
+    Float_t trkPar[5];
+  };
+
+  void Propagate(Int_t first, Int_t last);
+
+  std::vector< Propagated > fPropagated; //!
+#endif
+
   Double_t fRadius, fRadius2, fHalfLength;
   Double_t fBz;
 
+  Int_t fNThreads;
+
+  // particles of the event, positions in [m]
+  std::vector< Candidate * > fCandidates; //!
+  std::vector< Double_t > fX, fY, fZ, fT; //!
+  std::vector< Double_t > fPx, fPy, fPz, fE, fQ; //!
+
   TIterator *fItInputArray; //!
 
   const TObjArray *fInputArray; //!
@@ -44,6 +44,7 @@
 #include "TObjArray.h"
 #include "TDatabasePDG.h"
 #include "TLorentzVector.h"
+#include "TVector2.h"
 #include "TVector3.h"
 
 #include <algorithm>
@@ -56,7 +57,8 @@ using namespace std;
 //------------------------------------------------------------------------------
 
 PhotonConversions::PhotonConversions() :
-  fItInputArray(0), fConversionMap(0), fDecayXsec(0)
+  fItInputArray(0), fConversionMap(0), fDecayXsec(0),
+  fTableEtaBins(0), fTablePhiBins(1)
 {
   fDecayXsec = new TF1;
   fConversionMap = new DelphesCylindricalFormula;
@@ -91,6 +93,17 @@ void PhotonConversions::Init()
 #endif
   fDecayXsec->SetRange(0.0, 1.0);
 
+  // conversion probabilities tabulated for the photons from the origin
+
+  fTableEtaBins = GetInt("TableEtaBins", 0);
+  fTablePhiBins = GetInt("TablePhiBins", 1);
+  fTableVertexMax = GetDouble("TableVertexMax", fStep);
+  if(fTableEtaBins > 0)
+  {
+    if(fTablePhiBins < 1) throw runtime_error("TablePhiBins must be positive");
+    FillTable();
+  }
+
   // import array with output from filter/classifier module
 
   fInputArray = ImportArray(GetString("InputArray", "Delphes/stableParticles"));
@@ -112,19 +125,176 @@ void PhotonConversions::Finish()
 
 //------------------------------------------------------------------------------
 
+Bool_t PhotonConversions::GetExitTime(Double_t x, Double_t y, Double_t z,
+  Double_t px, Double_t py, Double_t pz, Double_t &t) const
+{
+  Double_t pt2 = px*px + py*py;
+  Double_t z_t, t1, t2, t3, t4;
+  Double_t tmp, discr, discr2;
+
+  // solve pt2*t^2 + 2*(px*x + py*y)*t - (fRadius2 - x*x - y*y) = 0
+  tmp = px*y - py*x;
+  discr2 = pt2*fRadius2 - tmp*tmp;
+
+  if(discr2 < 0.0)
+  {
+    // no solutions
+    return kFALSE;
+  }
+
+  tmp = px*x + py*y;
+  discr = TMath::Sqrt(discr2);
+  t1 = (-tmp + discr)/pt2;
+  t2 = (-tmp - discr)/pt2;
+  t = (t1 < 0.0) ? t2 : t1;
+
+  z_t = z + pz*t;
+  if(TMath::Abs(z_t) > fHalfLength)
+  {
+    t3 = (+fHalfLength - z) / pz;
+    t4 = (-fHalfLength - z) / pz;
+    t = (t3 < 0.0) ? t4 : t3;
+  }
+
+  return kTRUE;
+}
+
+//------------------------------------------------------------------------------
+
+void PhotonConversions::FillTable()
+{
+  TVector3 pos_i;
+  Double_t eta, phi, px, py, pz, t;
+  Double_t x_i, y_i, z_i, r_i, r_t, phi_i, dt;
+  Double_t rate, survival;
+  Int_t etaBin, phiBin, nsteps, i;
+
+  fTableEtaWidth = (fEtaMax - fEtaMin)/fTableEtaBins;
+  fTablePhiWidth = TMath::TwoPi()/fTablePhiBins;
+
+  fTable.clear();
+  fTableRows.assign(1, 0);
+
+  // same steps as in Process for a photon of unit pt from the origin in
+  // the direction of the centre of every bin
+  for(etaBin = 0; etaBin < fTableEtaBins; ++etaBin)
+  {
+    for(phiBin = 0; phiBin < fTablePhiBins; ++phiBin)
+    {
+      eta = fEtaMin + (etaBin + 0.5)*fTableEtaWidth;
+      phi = -TMath::Pi() + (phiBin + 0.5)*fTablePhiWidth;
+
+      px = TMath::Cos(phi);
+      py = TMath::Sin(phi);
+      pz = TMath::SinH(eta);
+
+      if(GetExitTime(0.0, 0.0, 0.0, px, py, pz, t))
+      {
+        r_t = t*TMath::Sqrt(1.0 + pz*pz);
+        nsteps = Int_t(r_t/fStep);
+        dt = t/nsteps;
+
+        x_i = 0.0;
+        y_i = 0.0;
+        z_i = 0.0;
+
+        survival = 1.0;
+        for(i = 0; i < nsteps; ++i)
+        {
+          x_i += px*dt;
+          y_i += py*dt;
+          z_i += pz*dt;
+          pos_i.SetXYZ(x_i, y_i, z_i);
+
+          r_i = TMath::Sqrt(x_i*x_i + y_i*y_i);
+          phi_i = pos_i.Phi();
+
+          rate = fConversionMap->Eval(r_i, phi_i, z_i);
+          survival *= TMath::Exp(-7.0/9.0*fStep*rate);
+
+          // probability to convert at or before this step
+          fTable.push_back(1.0 - survival);
+        }
+      }
+
+      fTableRows.push_back(fTable.size());
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+Int_t PhotonConversions::GetTableStep(Double_t eta, Double_t phi)
+{
+  vector< Double_t >::const_iterator first, last;
+  Int_t etaBin, phiBin, bin;
+
+  etaBin = TMath::Min(fTableEtaBins - 1, Int_t((eta - fEtaMin)/fTableEtaWidth));
+  phiBin = TMath::Min(fTablePhiBins - 1, Int_t((TVector2::Phi_mpi_pi(phi) + TMath::Pi())/fTablePhiWidth));
+  bin = TMath::Max(0, etaBin)*fTablePhiBins + TMath::Max(0, phiBin);
+
+  // the first step whose probability to convert at or before it is above
+  // a single uniform number, -1 if the photon does not convert
+  first = fTable.begin() + fTableRows[bin];
+  last = fTable.begin() + fTableRows[bin + 1];
+  first = upper_bound(first, last, GetRandom()->Uniform());
+
+  return first == last ? -1 : first - (fTable.begin() + fTableRows[bin]);
+}
+
+//------------------------------------------------------------------------------
+
+void PhotonConversions::Convert(Candidate *candidate, Double_t x, Double_t y, Double_t z, Double_t t)
+{
+  Candidate *ep, *em;
+  Double_t x1, x2;
+
+  const TLorentzVector &candidateMomentum = candidate->Momentum;
+  Double_t pt = candidateMomentum.Pt();
+  Double_t eta = candidateMomentum.Eta();
+  Double_t phi = candidateMomentum.Phi();
+  Double_t e = candidateMomentum.E();
+
+  // generate x1 and x2, the fraction of the photon energy taken resp. by e+ and e-
+  x1 = fDecayXsec->GetRandom();
+  x2 = 1 - x1;
+
+  ep = static_cast<Candidate*>(candidate->Clone());
+  em = static_cast<Candidate*>(candidate->Clone());
+
+  ep->Position.SetXYZT(x*1.0E3, y*1.0E3, z*1.0E3, t);
+  em->Position.SetXYZT(x*1.0E3, y*1.0E3, z*1.0E3, t);
+
+  ep->Momentum.SetPtEtaPhiE(x1*pt, eta, phi, x1*e);
+  em->Momentum.SetPtEtaPhiE(x2*pt, eta, phi, x2*e);
+
+  ep->PID = -11;
+  em->PID = 11;
+
+  ep->Charge = 1.0;
+  em->Charge = -1.0;
+
+  ep->IsFromConversion = 1;
+  em->IsFromConversion = 1;
+
+  fOutputArray->Add(em);
+  fOutputArray->Add(ep);
+}
+
+//------------------------------------------------------------------------------
+
 void PhotonConversions::Process()
 {
-  Candidate *candidate, *ep, *em;
+  Candidate *candidate;
   TLorentzVector candidatePosition, candidateMomentum;
   TVector3 pos_i;
-  Double_t px, py, pz, pt, pt2, e, eta, phi;
+  Double_t px, py, pz, e, eta, phi;
   Double_t x, y, z, t;
   Double_t x_t, y_t, z_t, r_t;
   Double_t x_i, y_i, z_i, r_i, phi_i;
-  Double_t dt, t1, t2, t3, t4;
-  Double_t tmp, discr, discr2;
+  Double_t dt;
   Int_t nsteps, i;
-  Double_t rate, p_conv, x1, x2;
+  Double_t rate, p_conv;
   Bool_t converted;
 
   fItInputArray->Reset();
@@ -149,37 +319,13 @@ void PhotonConversions::Process()
       px = candidateMomentum.Px();
       py = candidateMomentum.Py();
       pz = candidateMomentum.Pz();
-      pt = candidateMomentum.Pt();
-      pt2 = candidateMomentum.Perp2();
       eta = candidateMomentum.Eta();
       phi = candidateMomentum.Phi();
       e = candidateMomentum.E();
 
       if(eta < fEtaMin || eta > fEtaMax) continue;
 
-      // solve pt2*t^2 + 2*(px*x + py*y)*t - (fRadius2 - x*x - y*y) = 0
-      tmp = px*y - py*x;
-      discr2 = pt2*fRadius2 - tmp*tmp;
-
-      if(discr2 < 0.0)
-      {
-        // no solutions
-        continue;
-      }
-
-      tmp = px*x + py*y;
-      discr = TMath::Sqrt(discr2);
-      t1 = (-tmp + discr)/pt2;
-      t2 = (-tmp - discr)/pt2;
-      t = (t1 < 0.0) ? t2 : t1;
-
-      z_t = z + pz*t;
-      if(TMath::Abs(z_t) > fHalfLength)
-      {
-        t3 = (+fHalfLength - z) / pz;
-        t4 = (-fHalfLength - z) / pz;
-        t = (t3 < 0.0) ? t4 : t3;
-      }
+      if(!GetExitTime(x, y, z, px, py, pz, t)) continue;
 
       // final position
       x_t = x + px*t;
@@ -192,12 +338,28 @@ void PhotonConversions::Process()
       // here starts conversion code
       nsteps = Int_t(r_t/fStep);
 
+      dt = t/nsteps;
+
+      if(fTableEtaBins > 0 && TMath::Hypot(x, y) <= fTableVertexMax && TMath::Abs(z) <= fTableVertexMax)
+      {
+        // one draw against the steps tabulated for the photon direction
+        i = GetTableStep(eta, phi);
+        if(i >= 0 && i < nsteps)
+        {
+          Convert(candidate, x + px*dt*(i + 1), y + py*dt*(i + 1), z + pz*dt*(i + 1),
+            candidatePosition.T() + nsteps*dt*e*1.0E3);
+        }
+        else
+        {
+          fOutputArray->Add(candidate);
+        }
+        continue;
+      }
+
       x_i = x;
       y_i = y;
       z_i = z;
 
-      dt = t/nsteps;
-
       converted = false;
 
       for(i = 0; i < nsteps; ++i)
@@ -219,34 +381,11 @@ void PhotonConversions::Process()
         p_conv = 1 - TMath::Exp(-7.0/9.0*fStep*rate);
 
         // case conversion occurs
-        if(gRandom->Uniform() < p_conv)
+        if(GetRandom()->Uniform() < p_conv)
         {
           converted = true;
 
-          // generate x1 and x2, the fraction of the photon energy taken resp. by e+ and e-
-          x1 = fDecayXsec->GetRandom();
-          x2 = 1 - x1;
-
-          ep = static_cast<Candidate*>(candidate->Clone());
-          em = static_cast<Candidate*>(candidate->Clone());
-
-          ep->Position.SetXYZT(x_i*1.0E3, y_i*1.0E3, z_i*1.0E3, candidatePosition.T() + nsteps*dt*e*1.0E3);
-          em->Position.SetXYZT(x_i*1.0E3, y_i*1.0E3, z_i*1.0E3, candidatePosition.T() + nsteps*dt*e*1.0E3);
-
-          ep->Momentum.SetPtEtaPhiE(x1*pt, eta, phi, x1*e);
-          em->Momentum.SetPtEtaPhiE(x2*pt, eta, phi, x2*e);
-
-          ep->PID = -11;
-          em->PID = 11;
-
-          ep->Charge = 1.0;
-          em->Charge = -1.0;
-
-          ep->IsFromConversion = 1;
-          em->IsFromConversion = 1;
-
-          fOutputArray->Add(em);
-          fOutputArray->Add(ep);
+          Convert(candidate, x_i, y_i, z_i, candidatePosition.T() + nsteps*dt*e*1.0E3);
 
           break;
         }
@@ -257,4 +396,3 @@ void PhotonConversions::Process()
 }
 
 //------------------------------------------------------------------------------
-
@@ -23,13 +23,23 @@
  *
  *  Converts photons into e+ e- pairs according to material ditribution in the detector.
  *
+ *  With TableEtaBins > 0, the probabilities to convert at every step are
+ *  tabulated at Init for photons from the origin, in TableEtaBins bins of
+ *  eta between EtaMin and EtaMax and TablePhiBins bins of phi (1 for maps
+ *  that do not depend on phi). The photons produced within TableVertexMax
+ *  of the origin, in m, then take a single random number instead of one
+ *  per step, the others are still stepped through the map.
+ *
  *  \author M. Selvaggi - UCL, Louvain-la-Neuve
  *
  */
 
 #include "classes/DelphesModule.h"
 
+#include <vector>
+
 class TClonesArray;
+class Candidate;
 class TIterator;
 class DelphesCylindricalFormula;
 class TF1;
@@ -47,6 +57,14 @@ public:
 
 private:
 
+  Bool_t GetExitTime(Double_t x, Double_t y, Double_t z,
+    Double_t px, Double_t py, Double_t pz, Double_t &t) const;
+
+  void FillTable();
+  Int_t GetTableStep(Double_t eta, Double_t phi);
+
+  void Convert(Candidate *candidate, Double_t x, Double_t y, Double_t z, Double_t t);
+
   Double_t fRadius, fRadius2, fHalfLength;
   Double_t fEtaMin, fEtaMax;
 
@@ -62,6 +80,16 @@ private:
 
   Double_t fStep;
 
+  Int_t fTableEtaBins, fTablePhiBins;
+  Double_t fTableEtaWidth, fTablePhiWidth, fTableVertexMax;
+
+#if !defined(__CINT__) && !defined(__CLING__)
+  // probabilities to convert at or before every step, the steps of bin
+  // etaBin*fTablePhiBins + phiBin start at fTableRows of that bin
+  std::vector< Double_t > fTable; //!
+  std::vector< Int_t > fTableRows; //!
+#endif
+
   ClassDef(PhotonConversions, 1)
 };
 
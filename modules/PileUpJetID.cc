@@ -12,6 +12,7 @@
 #include "classes/DelphesClasses.h"
 #include "classes/DelphesFactory.h"
 #include "classes/DelphesFormula.h"
+#include "classes/DelphesEtaPhiGrid.h"
 
 #include "ExRootAnalysis/ExRootResult.h"
 #include "ExRootAnalysis/ExRootFilter.h"
@@ -35,7 +36,8 @@ using namespace std;
 //------------------------------------------------------------------------------
 
 PileUpJetID::PileUpJetID() :
-  fItJetInputArray(0),fTrackInputArray(0),fNeutralInputArray(0)
+  fItJetInputArray(0),fTrackInputArray(0),fNeutralInputArray(0),
+  fTrackGrid(0), fNeutralGrid(0)
 {
 
 }
@@ -56,6 +58,9 @@ void PileUpJetID::Init()
   fParameterR = GetDouble("ParameterR", 0.5);
   fUseConstituents = GetInt("UseConstituents", 0);
 
+  // the timing of the jets needs the ECAL hits of the towers
+  if(fUseConstituents) GetFactory()->SetKeepECalEnergyTimes(kTRUE);
+
   fMeanSqDeltaRMaxBarrel = GetDouble("MeanSqDeltaRMaxBarrel",0.1);
   fBetaMinBarrel = GetDouble("BetaMinBarrel",0.1);
   fMeanSqDeltaRMaxEndcap = GetDouble("MeanSqDeltaRMaxEndcap",0.1);
@@ -82,7 +87,6 @@ void PileUpJetID::Init()
   fOutputArray = ExportArray(GetString("OutputArray", "jets"));
 
   fNeutralsInPassingJets = ExportArray(GetString("NeutralsInPassingJets","eflowtowers"));
-
 }
 
 //------------------------------------------------------------------------------
@@ -103,8 +107,19 @@ void PileUpJetID::Process()
 {
   Candidate *candidate, *constituent;
   TLorentzVector momentum, area;
+  Int_t iConstituent, nConstituents;
 
   Candidate *trk;
+  vector< const DelphesEtaPhiGrid::Entry * >::const_iterator itNearby;
+  Double_t eta, phi, distance;
+
+  // with the grids a jet only visits the tracks and neutrals next to it,
+  // which are in the order of the input arrays, the grids are shared with
+  // the other modules of the event
+  if (!fUseConstituents) {
+    fTrackGrid = &GetFactory()->GetEtaPhiGrid(fTrackInputArray);
+    fNeutralGrid = &GetFactory()->GetEtaPhiGrid(fNeutralInputArray);
+  }
 
   // loop over all input candidates
   fItJetInputArray->Reset();
@@ -137,8 +152,9 @@ void PileUpJetID::Process()
     }
 
     if (fUseConstituents) {
-      TIter itConstituents(candidate->GetCandidates());
-      while((constituent = static_cast<Candidate*>(itConstituents.Next()))) {
+      nConstituents = candidate->GetNumberOfCandidates();
+      for(iConstituent = 0; iConstituent < nConstituents; ++iConstituent) {
+        constituent = candidate->GetCandidate(iConstituent);
         float pt = constituent->Momentum.Pt();
         float dr = candidate->Momentum.DeltaR(constituent->Momentum);
 	//	cout << " There exists a constituent with dr=" << dr << endl;
@@ -163,39 +179,44 @@ void PileUpJetID::Process()
 	}
 	float tow_sumT = 0;
 	float tow_sumW = 0;
-	for (int i = 0 ; i < constituent->ECalEnergyTimePairs.size() ; i++) {
-	  float w = TMath::Sqrt(constituent->ECalEnergyTimePairs[i].first);
+	for (int i = 0 ; i < constituent->GetNumberOfECalEnergyTimePairs() ; i++) {
+	  const pair<Float_t, Float_t> &hit = constituent->GetECalEnergyTimePair(i);
+	  float w = TMath::Sqrt(hit.first);
 	  if (fAverageEachTower) {
-            tow_sumT += w*constituent->ECalEnergyTimePairs[i].second;
+            tow_sumT += w*hit.second;
             tow_sumW += w;
 	  } else {
-	    sumT0 += w*constituent->ECalEnergyTimePairs[i].second;
-	    sumT1 += w*gRandom->Gaus(constituent->ECalEnergyTimePairs[i].second,0.001);
-	    sumT10 += w*gRandom->Gaus(constituent->ECalEnergyTimePairs[i].second,0.010);
-	    sumT20 += w*gRandom->Gaus(constituent->ECalEnergyTimePairs[i].second,0.020);
-	    sumT30 += w*gRandom->Gaus(constituent->ECalEnergyTimePairs[i].second,0.030);
-	    sumT40 += w*gRandom->Gaus(constituent->ECalEnergyTimePairs[i].second,0.040);
+	    sumT0 += w*hit.second;
+	    sumT1 += w*GetRandom()->Gaus(hit.second,0.001);
+	    sumT10 += w*GetRandom()->Gaus(hit.second,0.010);
+	    sumT20 += w*GetRandom()->Gaus(hit.second,0.020);
+	    sumT30 += w*GetRandom()->Gaus(hit.second,0.030);
+	    sumT40 += w*GetRandom()->Gaus(hit.second,0.040);
 	    sumWeightsForT += w;
 	    candidate->NTimeHits++;
 	  }
 	}
 	if (fAverageEachTower && tow_sumW > 0.) {
 	  sumT0 += tow_sumT;
-	  sumT1 += tow_sumW*gRandom->Gaus(tow_sumT/tow_sumW,0.001);
-          sumT10 += tow_sumW*gRandom->Gaus(tow_sumT/tow_sumW,0.0010);
-          sumT20 += tow_sumW*gRandom->Gaus(tow_sumT/tow_sumW,0.0020);
-          sumT30 += tow_sumW*gRandom->Gaus(tow_sumT/tow_sumW,0.0030);
-          sumT40 += tow_sumW*gRandom->Gaus(tow_sumT/tow_sumW,0.0040);
+	  sumT1 += tow_sumW*GetRandom()->Gaus(tow_sumT/tow_sumW,0.001);
+          sumT10 += tow_sumW*GetRandom()->Gaus(tow_sumT/tow_sumW,0.0010);
+          sumT20 += tow_sumW*GetRandom()->Gaus(tow_sumT/tow_sumW,0.0020);
+          sumT30 += tow_sumW*GetRandom()->Gaus(tow_sumT/tow_sumW,0.0030);
+          sumT40 += tow_sumW*GetRandom()->Gaus(tow_sumT/tow_sumW,0.0040);
 	  sumWeightsForT += tow_sumW;
 	  candidate->NTimeHits++;
 	}
       }
     } else {
       // Not using constituents, using dr
-      fItTrackInputArray->Reset();
-      while ((trk = static_cast<Candidate*>(fItTrackInputArray->Next()))) {
-	if (trk->Momentum.DeltaR(candidate->Momentum) < fParameterR) {
-	  float pt = trk->Momentum.Pt();
+      eta = candidate->Momentum.Eta();
+      phi = candidate->Momentum.Phi();
+      fTrackGrid->Find(eta, phi, fParameterR, fNearbyTracks);
+      for (itNearby = fNearbyTracks.begin(); itNearby != fNearbyTracks.end(); ++itNearby) {
+	distance = DelphesEtaPhiGrid::DeltaR(eta, phi, (*itNearby)->eta, (*itNearby)->phi);
+	if (distance < fParameterR) {
+	  trk = (*itNearby)->candidate;
+	  float pt = (*itNearby)->pt;
 	  sumpt += pt;
 	  sumptch += pt;
 	  if (trk->IsRecoPU) {
@@ -203,7 +224,7 @@ void PileUpJetID::Process()
 	  } else {
 	    sumptchpv += pt;
 	  }
-	  float dr = candidate->Momentum.DeltaR(trk->Momentum);
+	  float dr = distance;
 	  sumdrsqptsq += dr*dr*pt*pt;
 	  sumptsq += pt*pt;
 	  nc++;
@@ -214,12 +235,13 @@ void PileUpJetID::Process()
 	  }
 	}
       }
-      fItNeutralInputArray->Reset();
-      while ((constituent = static_cast<Candidate*>(fItNeutralInputArray->Next()))) {
-	if (constituent->Momentum.DeltaR(candidate->Momentum) < fParameterR) {
-	  float pt = constituent->Momentum.Pt();
+      fNeutralGrid->Find(eta, phi, fParameterR, fNearbyNeutrals);
+      for (itNearby = fNearbyNeutrals.begin(); itNearby != fNearbyNeutrals.end(); ++itNearby) {
+	distance = DelphesEtaPhiGrid::DeltaR(eta, phi, (*itNearby)->eta, (*itNearby)->phi);
+	if (distance < fParameterR) {
+	  float pt = (*itNearby)->pt;
 	  sumpt += pt;
-	  float dr = candidate->Momentum.DeltaR(constituent->Momentum);
+	  float dr = distance;
 	  sumdrsqptsq += dr*dr*pt*pt;
 	  sumptsq += pt*pt;
 	  nn++;
@@ -232,29 +254,31 @@ void PileUpJetID::Process()
       }
     }
 
+    CandidatePileUpJetID *pileUpJetID = candidate->NewPileUpJetID();
+
     if (sumptch > 0.) {
-      candidate->Beta = sumptchpv/sumptch;
-      candidate->BetaStar = sumptchpu/sumptch;
+      pileUpJetID->Beta = sumptchpv/sumptch;
+      pileUpJetID->BetaStar = sumptchpu/sumptch;
     } else {
-      candidate->Beta = -999.;
-      candidate->BetaStar = -999.;
+      pileUpJetID->Beta = -999.;
+      pileUpJetID->BetaStar = -999.;
     }
     if (sumptsq > 0.) {
-      candidate->MeanSqDeltaR = sumdrsqptsq/sumptsq;
+      pileUpJetID->MeanSqDeltaR = sumdrsqptsq/sumptsq;
     } else {
-      candidate->MeanSqDeltaR = -999.;
+      pileUpJetID->MeanSqDeltaR = -999.;
     }
-    candidate->NCharged = nc;
-    candidate->NNeutrals = nn;
+    pileUpJetID->NCharged = nc;
+    pileUpJetID->NNeutrals = nn;
     if (sumpt > 0.) {
-      candidate->PTD = TMath::Sqrt(sumptsq) / sumpt;
+      pileUpJetID->PTD = TMath::Sqrt(sumptsq) / sumpt;
       for (int i = 0 ; i < 5 ; i++) {
-        candidate->FracPt[i] = pt_ann[i]/sumpt;
+        pileUpJetID->FracPt[i] = pt_ann[i]/sumpt;
       }
     } else {
-      candidate->PTD = -999.;
+      pileUpJetID->PTD = -999.;
       for (int i = 0 ; i < 5 ; i++) {
-        candidate->FracPt[i] = -999.;
+        pileUpJetID->FracPt[i] = -999.;
       }
     }
 
@@ -270,32 +294,33 @@ void PileUpJetID::Process()
     */
 
     bool passId = false;
-    if (candidate->Momentum.Pt() > fJetPTMinForNeutrals && candidate->MeanSqDeltaR > -0.1) {
+    if (candidate->Momentum.Pt() > fJetPTMinForNeutrals && pileUpJetID->MeanSqDeltaR > -0.1) {
       if (fabs(candidate->Momentum.Eta())<1.5) {
-	passId = ((candidate->Beta > fBetaMinBarrel) && (candidate->MeanSqDeltaR < fMeanSqDeltaRMaxBarrel));
+	passId = ((pileUpJetID->Beta > fBetaMinBarrel) && (pileUpJetID->MeanSqDeltaR < fMeanSqDeltaRMaxBarrel));
       } else if (fabs(candidate->Momentum.Eta())<4.0) {
-	passId = ((candidate->Beta > fBetaMinEndcap) && (candidate->MeanSqDeltaR < fMeanSqDeltaRMaxEndcap));
+	passId = ((pileUpJetID->Beta > fBetaMinEndcap) && (pileUpJetID->MeanSqDeltaR < fMeanSqDeltaRMaxEndcap));
       } else {
-	passId = (candidate->MeanSqDeltaR < fMeanSqDeltaRMaxForward);
+	passId = (pileUpJetID->MeanSqDeltaR < fMeanSqDeltaRMaxForward);
       }
     }
 
     //    cout << " Pt Eta MeanSqDeltaR Beta PassId " << candidate->Momentum.Pt() 
-    //	 << " " << candidate->Momentum.Eta() << " " << candidate->MeanSqDeltaR << " " << candidate->Beta << " " << passId << endl;
+    //	 << " " << candidate->Momentum.Eta() << " " << pileUpJetID->MeanSqDeltaR << " " << pileUpJetID->Beta << " " << passId << endl;
 
     if (passId) {
       if (fUseConstituents) {
-	TIter itConstituents(candidate->GetCandidates());
-	while((constituent = static_cast<Candidate*>(itConstituents.Next()))) {
+	nConstituents = candidate->GetNumberOfCandidates();
+	for(iConstituent = 0; iConstituent < nConstituents; ++iConstituent) {
+	  constituent = candidate->GetCandidate(iConstituent);
 	  if (constituent->Charge == 0 && constituent->Momentum.Pt() > fNeutralPTMin) {
 	    fNeutralsInPassingJets->Add(constituent);
 	    //	    cout << "    Constitutent added Pt Eta Charge " << constituent->Momentum.Pt() << " " << constituent->Momentum.Eta() << " " << constituent->Charge << endl;
 	  }
 	}
-      } else { // use DeltaR
-	fItNeutralInputArray->Reset();
-	while ((constituent = static_cast<Candidate*>(fItNeutralInputArray->Next()))) {
-	  if (constituent->Momentum.DeltaR(candidate->Momentum) < fParameterR && constituent->Momentum.Pt() > fNeutralPTMin) {
+      } else { // use DeltaR, the neutrals found above
+	for (itNearby = fNearbyNeutrals.begin(); itNearby != fNearbyNeutrals.end(); ++itNearby) {
+	  constituent = (*itNearby)->candidate;
+	  if (DelphesEtaPhiGrid::DeltaR(eta, phi, (*itNearby)->eta, (*itNearby)->phi) < fParameterR && (*itNearby)->pt > fNeutralPTMin) {
 	    fNeutralsInPassingJets->Add(constituent);
 	    //            cout << "    Constitutent added Pt Eta Charge " << constituent->Momentum.Pt() << " " << constituent->Momentum.Eta() << " " << constituent->Charge << endl;
 	  }
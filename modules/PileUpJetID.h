@@ -12,11 +12,19 @@
 
 #include "classes/DelphesModule.h"
 
+#if !defined(__CINT__) && !defined(__CLING__)
+#include "classes/DelphesEtaPhiGrid.h"
+
+#include <vector>
+#endif
+
 #include <deque>
 
 class TObjArray;
 class DelphesFormula;
 
+class DelphesEtaPhiGrid;
+
 class PileUpJetID: public DelphesModule
 {
 public:
@@ -104,6 +112,16 @@ MeanSqDeltaR
   TObjArray *fOutputArray; //!
   TObjArray *fNeutralsInPassingJets; // SCZ
 
+  // tracks and neutrals of the event, for the jets that do not use their
+  // constituents
+  const DelphesEtaPhiGrid *fTrackGrid; //!
+  const DelphesEtaPhiGrid *fNeutralGrid; //!
+
+#if !defined(__CINT__) && !defined(__CLING__)
+  std::vector< const DelphesEtaPhiGrid::Entry * > fNearbyTracks; //!
+  std::vector< const DelphesEtaPhiGrid::Entry * > fNearbyNeutrals; //!
+#endif
+
 
   ClassDef(PileUpJetID, 2)
 };
@@ -30,6 +30,9 @@
 #include "classes/DelphesFactory.h"
 #include "classes/DelphesTF2.h"
 #include "classes/DelphesPileUpReader.h"
+#include "classes/DelphesPileUpWriter.h"
+#include "classes/DelphesPDGTable.h"
+#include "classes/DelphesTopology.h"
 
 #include "ExRootAnalysis/ExRootResult.h"
 #include "ExRootAnalysis/ExRootFilter.h"
@@ -40,20 +43,116 @@
 #include "TFormula.h"
 #include "TRandom3.h"
 #include "TObjArray.h"
-#include "TDatabasePDG.h"
 #include "TLorentzVector.h"
+#include "TVector2.h"
+#include "TFile.h"
+#include "TTree.h"
+#include "TClonesArray.h"
 
 #include <algorithm>
+#include <mutex>
 #include <stdexcept>
 #include <iostream>
 #include <sstream>
 
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+
 using namespace std;
 
 //------------------------------------------------------------------------------
 
+// writes the node-local copy of the pile-up file unless it exists, the
+// processes that find the lock taken wait for the copy to be renamed
+// into place
+
+static void ShareFile(const char *fileName, const char *sharedName)
+{
+  stringstream message, temporary;
+  struct stat status;
+  DelphesPileUpReader *reader = 0;
+  DelphesPileUpWriter *writer = 0;
+  const DelphesPDGTable *pdg = DelphesPDGTable::Instance();
+  const DelphesPDGTable::Entry *pdgParticle;
+  string lockName = string(sharedName) + ".lock";
+  Long64_t entry;
+  Int_t pid, charge;
+  Float_t x, y, z, t, px, py, pz, e, mass;
+  int descriptor;
+
+  if(stat(sharedName, &status) == 0) return;
+
+  descriptor = open(lockName.c_str(), O_RDWR | O_CREAT, 0666);
+  if(descriptor < 0 || flock(descriptor, LOCK_EX) != 0)
+  {
+    if(descriptor >= 0) close(descriptor);
+    message << "can't lock shared pile-up file " << lockName;
+    throw runtime_error(message.str());
+  }
+
+  if(stat(sharedName, &status) == 0)
+  {
+    close(descriptor);
+    return;
+  }
+
+  temporary << sharedName << '.' << getpid();
+
+  try
+  {
+    reader = new DelphesPileUpReader(fileName);
+    writer = new DelphesPileUpWriter(temporary.str().c_str(), kPileUpVersionColumns, kPileUpChargeMass);
+
+    for(entry = 0; entry < reader->GetEntries(); ++entry)
+    {
+      reader->ReadEntry(entry);
+      while(reader->ReadParticle(pid, x, y, z, t, px, py, pz, e, charge, mass))
+      {
+        // same values as the ones ReadEvent takes from DelphesPDGTable
+        if(!reader->HasChargeMass())
+        {
+          pdgParticle = pdg->Find(pid);
+          charge = pdgParticle ? pdgParticle->charge : -999;
+          mass = pdgParticle ? pdgParticle->mass : -999.9;
+        }
+        writer->WriteParticle(pid, x, y, z, t, px, py, pz, e, charge, mass);
+      }
+      writer->WriteEntry();
+    }
+    writer->WriteIndex();
+
+    delete writer;
+    writer = 0;
+    delete reader;
+    reader = 0;
+
+    if(rename(temporary.str().c_str(), sharedName) != 0)
+    {
+      message << "can't create shared pile-up file " << sharedName;
+      throw runtime_error(message.str());
+    }
+  }
+  catch(...)
+  {
+    if(writer) delete writer;
+    if(reader) delete reader;
+    remove(temporary.str().c_str());
+    close(descriptor);
+    throw;
+  }
+
+  close(descriptor);
+}
+
+//------------------------------------------------------------------------------
+
 PileUpMerger::PileUpMerger() :
-  fFunction(0), fReader(0), fItInputArray(0)
+  fFunction(0), fReader(0), fCacheSize(0), fSharedCacheNode(-1),
+  fPremixedFile(0), fPremixedTree(0), fPremixedCandidates(0),
+  fPremixedOffsets(0), fPremixedReferences(0), fItInputArray(0)
 {
   fFunction = new DelphesTF2;
 }
@@ -70,7 +169,12 @@ PileUpMerger::~PileUpMerger()
 
 void PileUpMerger::Init()
 {
-  const char *fileName;
+  stringstream message;
+  const char *fileName, *sharedName;
+  ExRootConfParam param;
+  TString name;
+  Long_t i, size;
+  Int_t bins;
 
   fPileUpDistribution = GetInt("PileUpDistribution", 0);
 
@@ -84,13 +188,75 @@ void PileUpMerger::Init()
   fOutputBeamSpotX = GetDouble("OutputBeamSpotX", 0.0);
   fOutputBeamSpotY = GetDouble("OutputBeamSpotY", 0.0);
 
+  // pile-up particles that no detector module would see
+  fParticlePTMin = GetDouble("ParticlePTMin", 0.0);
+  fParticleEtaMax = GetDouble("ParticleEtaMax", 0.0);
+
   // read vertex smearing formula
 
   fFunction->Compile(GetString("VertexDistributionFormula", "0.0"));
   fFunction->SetRange(-fZVertexSpread, -fTVertexSpread, fZVertexSpread, fTVertexSpread);
 
-  fileName = GetString("PileUpFile", "MinBias.pileup");
-  fReader = new DelphesPileUpReader(fileName);
+  // cells along z and t of the table the vertices are drawn from, built
+  // here rather than at the first event
+  bins = GetInt("VertexDistributionBins", 0);
+  if(bins > 0)
+  {
+    fFunction->SetNpx(bins);
+    fFunction->SetNpy(bins);
+  }
+  fFunction->ComputeCells();
+
+  // premixed library written by PremixedPileUpWriter, used instead of
+  // the PileUpFile when it is given
+  fileName = GetString("PremixedPileUpFile", "");
+  if(fileName[0] == '\0')
+  {
+    fileName = GetString("PileUpFile", "MinBias.pileup");
+
+    // decoded copy shared by the processes of the node
+    sharedName = GetString("SharedPileUpFile", "");
+    if(sharedName[0] != '\0')
+    {
+      ShareFile(fileName, sharedName);
+      fileName = sharedName;
+    }
+
+    fReader = new DelphesPileUpReader(fileName);
+
+    // number of decoded pile-up events kept in memory, all if negative
+    fCacheSize = GetInt("CacheSize", 0);
+
+    fCache.clear();
+    fCacheIndices.clear();
+    fCacheOrder.clear();
+
+    // the whole file is decoded at the first event, on a thread of the
+    // node that uses it
+    fFileName = fileName;
+    fSharedCache.reset();
+  }
+  else
+  {
+    fPremixedFile = TFile::Open(fileName);
+    if(!fPremixedFile || fPremixedFile->IsZombie())
+    {
+      message << "can't open premixed pile-up file " << fileName;
+      throw runtime_error(message.str());
+    }
+
+    fPremixedFile->GetObject("PremixedPileUp", fPremixedTree);
+    if(!fPremixedTree)
+    {
+      message << "no premixed pile-up events in " << fileName;
+      throw runtime_error(message.str());
+    }
+
+    fPremixedCandidates = new TClonesArray("Candidate");
+    fPremixedTree->SetBranchAddress("Candidate", &fPremixedCandidates);
+    fPremixedTree->SetBranchAddress("ReferenceOffsets", &fPremixedOffsets);
+    fPremixedTree->SetBranchAddress("References", &fPremixedReferences);
+  }
 
   // import input array
   fInputArray = ImportArray(GetString("InputArray", "Delphes/stableParticles"));
@@ -99,6 +265,36 @@ void PileUpMerger::Init()
   // create output arrays
   fParticleOutputArray = ExportArray(GetString("ParticleOutputArray", "stableParticles"));
   fVertexOutputArray = ExportArray(GetString("VertexOutputArray", "vertices"));
+
+  if(!fPremixedTree) return;
+
+  // pairs of a library array and of the array its candidates are added to
+  param = GetParam("PremixedArray");
+  size = param.GetSize();
+
+  fPremixedNumbers.assign(size/2, 0);
+  fPremixedOutputArrays.clear();
+
+  for(i = 0; i < size/2; ++i)
+  {
+    name = param[i*2].GetString();
+    if(!fPremixedTree->GetBranch(name))
+    {
+      message << "no array '" << name << "' in premixed pile-up file " << fileName;
+      throw runtime_error(message.str());
+    }
+    fPremixedTree->SetBranchAddress(name, &fPremixedNumbers[i]);
+
+    name = param[i*2 + 1].GetString();
+    if(name == GetString("ParticleOutputArray", "stableParticles"))
+    {
+      fPremixedOutputArrays.push_back(fParticleOutputArray);
+    }
+    else
+    {
+      fPremixedOutputArrays.push_back(ExportArray(name));
+    }
+  }
 }
 
 //------------------------------------------------------------------------------
@@ -106,19 +302,161 @@ void PileUpMerger::Init()
 void PileUpMerger::Finish()
 {
   if(fReader) delete fReader;
+  fSharedCache.reset();
+  if(fPremixedFile) delete fPremixedFile;
+  if(fPremixedCandidates) delete fPremixedCandidates;
+}
+
+//------------------------------------------------------------------------------
+
+static void RotateZ(TLorentzVector &vector, Double_t sinPhi, Double_t cosPhi)
+{
+  Double_t x = vector.X(), y = vector.Y();
+
+  vector.SetXYZT(cosPhi*x - sinPhi*y, sinPhi*x + cosPhi*y, vector.Z(), vector.T());
+}
+
+//------------------------------------------------------------------------------
+
+void PileUpMerger::ReadEvent(Long64_t entry, Event &event)
+{
+  const DelphesPDGTable *pdg = DelphesPDGTable::Instance();
+  const DelphesPDGTable::Entry *pdgParticle;
+  Int_t pid, charge;
+  Float_t x, y, z, t;
+  Float_t px, py, pz, e, mass;
+
+  event.entry = entry;
+  event.pid.clear();
+  event.charge.clear();
+  event.x.clear();
+  event.y.clear();
+  event.z.clear();
+  event.t.clear();
+  event.px.clear();
+  event.py.clear();
+  event.pz.clear();
+  event.e.clear();
+  event.mass.clear();
+
+  fReader->ReadEntry(entry);
+
+  while(fReader->ReadParticle(pid, x, y, z, t, px, py, pz, e, charge, mass))
+  {
+    // the files of version 2 can have the charge and the mass already
+    if(!fReader->HasChargeMass())
+    {
+      pdgParticle = pdg->Find(pid);
+      charge = pdgParticle ? pdgParticle->charge : -999;
+      mass = pdgParticle ? pdgParticle->mass : -999.9;
+    }
+
+    event.pid.push_back(pid);
+    event.charge.push_back(charge);
+    event.x.push_back(x);
+    event.y.push_back(y);
+    event.z.push_back(z);
+    event.t.push_back(t);
+    event.px.push_back(px);
+    event.py.push_back(py);
+    event.pz.push_back(pz);
+    event.e.push_back(e);
+    event.mass.push_back(mass);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+shared_ptr< const vector< PileUpMerger::Event > > PileUpMerger::GetSharedCache(Int_t node)
+{
+  // the copies live as long as one of the mergers holds them
+  static mutex cacheMutex;
+  static map< pair< string, Int_t >, weak_ptr< const vector< Event > > > caches;
+
+  shared_ptr< vector< Event > > cache;
+  shared_ptr< const vector< Event > > result;
+  Long64_t entry;
+
+  lock_guard< mutex > lock(cacheMutex);
+
+  weak_ptr< const vector< Event > > &shared = caches[make_pair(fFileName, node)];
+  result = shared.lock();
+  if(result) return result;
+
+  // filled on this thread, so that the pages are on its node
+  cache = make_shared< vector< Event > >(fReader->GetEntries());
+  for(entry = 0; entry < fReader->GetEntries(); ++entry)
+  {
+    ReadEvent(entry, (*cache)[entry]);
+  }
+
+  shared = cache;
+  return cache;
+}
+
+//------------------------------------------------------------------------------
+
+const PileUpMerger::Event &PileUpMerger::GetEvent(Long64_t entry)
+{
+  map< Long64_t, Int_t >::iterator itCacheIndices;
+  Int_t index, node;
+
+  if(fCacheSize < 0)
+  {
+    node = DelphesTopology::GetThreadNode();
+    if(!fSharedCache || node != fSharedCacheNode)
+    {
+      fSharedCache = GetSharedCache(node);
+      fSharedCacheNode = node;
+    }
+    return (*fSharedCache)[entry];
+  }
+
+  if(fCacheSize == 0)
+  {
+    ReadEvent(entry, fEvent);
+    return fEvent;
+  }
+
+  itCacheIndices = fCacheIndices.find(entry);
+  if(itCacheIndices != fCacheIndices.end())
+  {
+    Event &event = fCache[itCacheIndices->second];
+    fCacheOrder.splice(fCacheOrder.begin(), fCacheOrder, event.order);
+    return event;
+  }
+
+  if(Long64_t(fCache.size()) < fCacheSize)
+  {
+    index = fCache.size();
+    fCache.push_back(Event());
+    fCacheOrder.push_front(index);
+  }
+  else
+  {
+    // reuse the least recently used event
+    index = fCacheOrder.back();
+    fCacheIndices.erase(fCache[index].entry);
+    fCacheOrder.splice(fCacheOrder.begin(), fCacheOrder, fCache[index].order);
+  }
+
+  Event &event = fCache[index];
+  ReadEvent(entry, event);
+  event.order = fCacheOrder.begin();
+  fCacheIndices[entry] = index;
+
+  return event;
 }
 
 //------------------------------------------------------------------------------
 
 void PileUpMerger::Process()
 {
-  TDatabasePDG *pdg = TDatabasePDG::Instance();
-  TParticlePDG *pdgParticle;
-  Int_t pid;
   Float_t x, y, z, t, vx, vy;
-  Float_t px, py, pz, e;
-  Double_t dz, dphi, dt;
-  Int_t numberOfEvents, event, numberOfParticles;
+  Float_t px, py;
+  Double_t dz, dphi, dt, sinPhi, cosPhi;
+  TLorentzVector momentum, position;
+  Int_t numberOfEvents, event, numberOfParticles, i;
   Long64_t allEntries, entry;
   Candidate *candidate, *vertex;
   DelphesFactory *factory;
@@ -129,7 +467,7 @@ void PileUpMerger::Process()
 
   // --- Deal with primary vertex first  ------
 
-  fFunction->GetRandom2(dz, dt);
+  fFunction->GetRandom2(dz, dt, GetRandom());
 
   dt *= c_light*1.0E3; // necessary in order to make t in mm/c
   dz *= 1.0E3; // necessary in order to make z in mm
@@ -144,6 +482,7 @@ void PileUpMerger::Process()
     t = candidate->Position.T();
     candidate->Position.SetZ(z + dz);
     candidate->Position.SetT(t + dt);
+    candidate->VertexIndex = 0;
     fParticleOutputArray->Add(candidate);
   }
 
@@ -157,6 +496,7 @@ void PileUpMerger::Process()
 
   vertex = factory->NewCandidate();
   vertex->Position.SetXYZT(vx, vy, dz, dt);
+  vertex->VertexIndex = 0;
   fVertexOutputArray->Add(vertex);
 
   // --- Then with pile-up vertices  ------
@@ -164,66 +504,102 @@ void PileUpMerger::Process()
   switch(fPileUpDistribution)
   {
     case 0:
-      numberOfEvents = gRandom->Poisson(fMeanPileUp);
+      numberOfEvents = GetRandom()->Poisson(fMeanPileUp);
       break;
     case 1:
-      numberOfEvents = gRandom->Integer(2*fMeanPileUp + 1);
+      numberOfEvents = GetRandom()->Integer(2*fMeanPileUp + 1);
       break;
     default:
-      numberOfEvents = gRandom->Poisson(fMeanPileUp);
+      numberOfEvents = GetRandom()->Poisson(fMeanPileUp);
       break;
   }
 
+  Annotate("pileup", numberOfEvents);
+
+  if(fPremixedTree)
+  {
+    ProcessPremixed(numberOfEvents);
+    return;
+  }
+
   allEntries = fReader->GetEntries();
 
   for(event = 0; event < numberOfEvents; ++event)
   {
     do
     {
-      entry = TMath::Nint(gRandom->Rndm()*allEntries);
+      entry = TMath::Nint(GetRandom()->Rndm()*allEntries);
     }
     while(entry >= allEntries);
 
-    fReader->ReadEntry(entry);
+    const Event &pileUpEvent = GetEvent(entry);
 
    // --- Pile-up vertex smearing
 
-    fFunction->GetRandom2(dz, dt);
+    fFunction->GetRandom2(dz, dt, GetRandom());
 
     dt *= c_light*1.0E3; // necessary in order to make t in mm/c
     dz *= 1.0E3; // necessary in order to make z in mm
 
-    dphi = gRandom->Uniform(-TMath::Pi(), TMath::Pi());
+    dphi = GetRandom()->Uniform(-TMath::Pi(), TMath::Pi());
+
+    // same arithmetic as TLorentzVector::RotateZ, with the sine and the
+    // cosine computed once for the whole event
+    sinPhi = TMath::Sin(dphi);
+    cosPhi = TMath::Cos(dphi);
+
+    numberOfParticles = pileUpEvent.pid.size();
+
+    fPx.resize(numberOfParticles);
+    fPy.resize(numberOfParticles);
+    fX.resize(numberOfParticles);
+    fY.resize(numberOfParticles);
+
+    for(i = 0; i < numberOfParticles; ++i)
+    {
+      px = pileUpEvent.px[i];
+      py = pileUpEvent.py[i];
+      fPx[i] = cosPhi*px - sinPhi*py;
+      fPy[i] = sinPhi*px + cosPhi*py;
+
+      x = pileUpEvent.x[i];
+      y = pileUpEvent.y[i];
+      x -= fInputBeamSpotX;
+      y -= fInputBeamSpotY;
+      fX[i] = cosPhi*x - sinPhi*y + fOutputBeamSpotX;
+      fY[i] = sinPhi*x + cosPhi*y + fOutputBeamSpotY;
+    }
 
     vx = 0.0;
     vy = 0.0;
-    numberOfParticles = 0;
-    while(fReader->ReadParticle(pid, x, y, z, t, px, py, pz, e))
+    for(i = 0; i < numberOfParticles; ++i)
     {
+      vx += fX[i];
+      vy += fY[i];
+
+      momentum.SetPxPyPzE(fPx[i], fPy[i], pileUpEvent.pz[i], pileUpEvent.e[i]);
+
+      if(momentum.Pt() < fParticlePTMin) continue;
+      if(fParticleEtaMax > 0.0 && TMath::Abs(momentum.Eta()) > fParticleEtaMax) continue;
+
+      z = pileUpEvent.z[i];
+      t = pileUpEvent.t[i];
+      position.SetXYZT(fX[i], fY[i], z + dz, t + dt);
+
       candidate = factory->NewCandidate();
 
-      candidate->PID = pid;
+      candidate->PID = pileUpEvent.pid[i];
 
       candidate->Status = 1;
 
-      pdgParticle = pdg->GetParticle(pid);
-      candidate->Charge = pdgParticle ? Int_t(pdgParticle->Charge()/3.0) : -999;
-      candidate->Mass = pdgParticle ? pdgParticle->Mass() : -999.9;
+      candidate->Charge = pileUpEvent.charge[i];
+      candidate->Mass = pileUpEvent.mass[i];
 
       candidate->IsPU = 1;
+      candidate->VertexIndex = event + 1;
 
-      candidate->Momentum.SetPxPyPzE(px, py, pz, e);
-      candidate->Momentum.RotateZ(dphi);
-
-      x -= fInputBeamSpotX;
-      y -= fInputBeamSpotY;
-      candidate->Position.SetXYZT(x, y, z + dz, t + dt);
-      candidate->Position.RotateZ(dphi);
-      candidate->Position += TLorentzVector(fOutputBeamSpotX, fOutputBeamSpotY, 0.0, 0.0);
-
-      vx += candidate->Position.X();
-      vy += candidate->Position.Y();
-      ++numberOfParticles;
+      candidate->Momentum = momentum;
+      candidate->Position = position;
 
       fParticleOutputArray->Add(candidate);
     }
@@ -237,6 +613,101 @@ void PileUpMerger::Process()
     vertex = factory->NewCandidate();
     vertex->Position.SetXYZT(vx, vy, dz, dt);
     vertex->IsPU = 1;
+    vertex->VertexIndex = event + 1;
+
+    fVertexOutputArray->Add(vertex);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void PileUpMerger::ProcessPremixed(Int_t numberOfEvents)
+{
+  Candidate *candidate, *vertex;
+  DelphesFactory *factory;
+  Double_t dphi, sinPhi, cosPhi, x, y;
+  Long64_t allEntries, entry;
+  Int_t event, i, j, k, n, numberOfParticles;
+  TLorentzVector position;
+
+  factory = GetFactory();
+
+  allEntries = fPremixedTree->GetEntries();
+
+  for(event = 0; event < numberOfEvents; ++event)
+  {
+    do
+    {
+      entry = TMath::Nint(GetRandom()->Rndm()*allEntries);
+    }
+    while(entry >= allEntries);
+
+    fPremixedTree->GetEntry(entry);
+
+    // the library events already have their vertices spread, they are
+    // only rotated around the beam axis, which preserves the propagation
+    // in the solenoid field
+    dphi = GetRandom()->Uniform(-TMath::Pi(), TMath::Pi());
+    sinPhi = TMath::Sin(dphi);
+    cosPhi = TMath::Cos(dphi);
+
+    n = fPremixedCandidates->GetEntriesFast();
+    fPremixed.resize(n);
+
+    for(i = 0; i < n; ++i)
+    {
+      candidate = factory->NewCandidate();
+      static_cast<Candidate *>(fPremixedCandidates->UncheckedAt(i))->Copy(*candidate);
+
+      candidate->IsPU = 1;
+      candidate->VertexIndex = event + 1;
+
+      RotateZ(candidate->Momentum, sinPhi, cosPhi);
+      RotateZ(candidate->Position, sinPhi, cosPhi);
+
+      x = candidate->Xd;
+      y = candidate->Yd;
+      candidate->Xd = cosPhi*x - sinPhi*y;
+      candidate->Yd = sinPhi*x + cosPhi*y;
+
+      candidate->trkPar[TrackParam::PHI] = TVector2::Phi_mpi_pi(candidate->trkPar[TrackParam::PHI] + dphi);
+
+      fPremixed[i] = candidate;
+    }
+
+    for(i = 0; i < n; ++i)
+    {
+      for(j = (*fPremixedOffsets)[i]; j < (*fPremixedOffsets)[i + 1]; ++j)
+      {
+        fPremixed[i]->AddCandidate(fPremixed[(*fPremixedReferences)[j]]);
+      }
+    }
+
+    for(k = 0; k < Int_t(fPremixedNumbers.size()); ++k)
+    {
+      for(i = 0; i < Int_t(fPremixedNumbers[k]->size()); ++i)
+      {
+        fPremixedOutputArrays[k]->Add(fPremixed[(*fPremixedNumbers[k])[i]]);
+      }
+    }
+
+    // the vertex is at the average position of the generated particles,
+    // the candidates that refer to no other one
+    position.SetXYZT(0.0, 0.0, 0.0, 0.0);
+    numberOfParticles = 0;
+    for(i = 0; i < n; ++i)
+    {
+      if((*fPremixedOffsets)[i] != (*fPremixedOffsets)[i + 1]) continue;
+      position += fPremixed[i]->Position;
+      ++numberOfParticles;
+    }
+
+    if(numberOfParticles > 0) position *= 1.0/numberOfParticles;
+
+    vertex = factory->NewCandidate();
+    vertex->Position = position;
+    vertex->IsPU = 1;
+    vertex->VertexIndex = event + 1;
 
     fVertexOutputArray->Add(vertex);
   }
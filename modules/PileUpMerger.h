@@ -23,13 +23,67 @@
  *
  *  Merges particles from pile-up sample into event
  *
+ *  Pile-up particles below ParticlePTMin or beyond ParticleEtaMax are
+ *  dropped before they enter the output array, they still count for the
+ *  position of their vertex. A zero ParticleEtaMax applies no eta cut.
+ *
+ *  The VertexOutputArray has the vertex of the hard scattering first and
+ *  then one vertex per pile-up event, and every particle has the index
+ *  of its vertex in this array as VertexIndex.
+ *
+ *  The vertices are drawn from a table of the VertexDistributionFormula
+ *  with VertexDistributionBins cells along z and t, made at the start,
+ *  those of TF2 when it is not given.
+ *
+ *  With RandomStreams the number of pile-up events, their entries, their
+ *  vertices and their rotations are drawn from the stream of the module,
+ *  which is reseeded with the position of the event in the input, so a
+ *  sharded or multi-threaded run overlays the same pile-up as the serial
+ *  run.
+ *
+ *  With SharedPileUpFile, for example /dev/shm/MinBias.pileup, the
+ *  PileUpFile is decoded once per node into an uncompressed copy with
+ *  the charge and the mass of the particles. The first process creates
+ *  the copy, the others wait for it, and all of them map it read-only
+ *  and read the particles in place, so the node holds the library only
+ *  once. The copy is left for the next jobs, it is not updated when
+ *  the PileUpFile changes.
+ *
+ *  The decoded pile-up events can be kept in memory: CacheSize events
+ *  are kept, the least recently used ones are replaced, and a negative
+ *  CacheSize reads the whole file at the first event. The cached events
+ *  also have the charge and the mass of their particles, so merging them
+ *  only rotates and moves the particles into new candidates. The whole
+ *  file is decoded once per process and shared by the mergers of all the
+ *  threads, or once per NUMA node for the threads pinned to one node,
+ *  see DelphesWorkerPool, by the first thread of the node to need it.
+ *
+ *  With PremixedPileUpFile the pile-up events are taken from a library
+ *  written by PremixedPileUpWriter instead. The candidates of every
+ *  array of the library given in PremixedArray are added, rotated by a
+ *  random angle around the beam axis, to the array named after it,
+ *  which is the ParticleOutputArray or a new output array. The library
+ *  events keep the vertices they were generated with.
+ *
  *  \author M. Selvaggi - UCL, Louvain-la-Neuve
  *
  */
 
 #include "classes/DelphesModule.h"
 
+#if !defined(__CINT__) && !defined(__CLING__)
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#endif
+
 class TObjArray;
+class TClonesArray;
+class TFile;
+class TTree;
+class Candidate;
 class DelphesPileUpReader;
 class DelphesTF2;
 
@@ -44,8 +98,28 @@ public:
   void Process();
   void Finish();
 
+  Bool_t IsThreadSafe() const { return HasRandomStream(); }
+
 private:
 
+#if !defined(__CINT__) && !defined(__CLING__)
+  struct Event
+  {
+    Long64_t entry;
+    std::vector< Int_t > pid, charge;
+    std::vector< Float_t > x, y, z, t, px, py, pz, e, mass;
+    std::list< Int_t >::iterator order;
+  };
+
+  const Event &GetEvent(Long64_t entry);
+  void ReadEvent(Long64_t entry, Event &event);
+
+  // whole decoded file for the NUMA node, or -1 for the whole process
+  std::shared_ptr< const std::vector< Event > > GetSharedCache(Int_t node);
+#endif
+
+  void ProcessPremixed(Int_t numberOfEvents);
+
   Int_t fPileUpDistribution;
   Double_t fMeanPileUp;
 
@@ -57,10 +131,47 @@ private:
   Double_t fOutputBeamSpotX;
   Double_t fOutputBeamSpotY;
 
+  Double_t fParticlePTMin;
+  Double_t fParticleEtaMax;
+
   DelphesTF2 *fFunction; //!
 
   DelphesPileUpReader *fReader; //!
 
+  Long64_t fCacheSize;
+
+#if !defined(__CINT__) && !defined(__CLING__)
+  Event fEvent; //!
+
+  // cached events, their indices by entry and from the most to the
+  // least recently used
+  std::vector< Event > fCache; //!
+  std::map< Long64_t, Int_t > fCacheIndices; //!
+  std::list< Int_t > fCacheOrder; //!
+
+  // whole file with a negative CacheSize, and the node it was taken for
+  std::string fFileName; //!
+  std::shared_ptr< const std::vector< Event > > fSharedCache; //!
+  Int_t fSharedCacheNode; //!
+
+  // rotated momenta and positions of the particles of a pile-up event
+  std::vector< Double_t > fPx, fPy, fX, fY; //!
+#endif
+
+  TFile *fPremixedFile; //!
+  TTree *fPremixedTree; //!
+
+  TClonesArray *fPremixedCandidates; //!
+
+#if !defined(__CINT__) && !defined(__CLING__)
+  std::vector< Int_t > *fPremixedOffsets; //!
+  std::vector< Int_t > *fPremixedReferences; //!
+  std::vector< std::vector< Int_t > * > fPremixedNumbers; //!
+
+  std::vector< TObjArray * > fPremixedOutputArrays; //!
+  std::vector< Candidate * > fPremixed; //!
+#endif
+
   TIterator *fItInputArray; //!
 
   const TObjArray *fInputArray; //!
@@ -30,6 +30,7 @@
 #include "classes/DelphesFactory.h"
 #include "classes/DelphesTF2.h"
 #include "classes/DelphesPileUpReader.h"
+#include "classes/DelphesPDGTable.h"
 
 #include "ExRootAnalysis/ExRootResult.h"
 #include "ExRootAnalysis/ExRootFilter.h"
@@ -42,7 +43,6 @@
 #include "TFormula.h"
 #include "TRandom3.h"
 #include "TObjArray.h"
-#include "TDatabasePDG.h"
 #include "TLorentzVector.h"
 
 #include <algorithm>
@@ -89,6 +89,7 @@ void PileUpMergerPythia8::Init()
 
   fFunction->Compile(GetString("VertexDistributionFormula", "0.0"));
   fFunction->SetRange(-fZVertexSpread, -fTVertexSpread, fZVertexSpread, fTVertexSpread);
+  fFunction->ComputeCells();
 
   fileName = GetString("ConfigFile", "MinBias.cmnd");
   fPythia = new Pythia8::Pythia();
@@ -114,8 +115,8 @@ void PileUpMergerPythia8::Finish()
 
 void PileUpMergerPythia8::Process()
 {
-  TDatabasePDG *pdg = TDatabasePDG::Instance();
-  TParticlePDG *pdgParticle;
+  const DelphesPDGTable *pdg = DelphesPDGTable::Instance();
+  const DelphesPDGTable::Entry *pdgParticle;
   Int_t pid, status;
   Float_t x, y, z, t, vx, vy;
   Float_t px, py, pz, e;
@@ -130,7 +131,7 @@ void PileUpMergerPythia8::Process()
 
   // --- Deal with primary vertex first  ------
 
-  fFunction->GetRandom2(dz, dt);
+  fFunction->GetRandom2(dz, dt, GetRandom());
 
   dt *= c_light*1.0E3; // necessary in order to make t in mm/c
   dz *= 1.0E3; // necessary in order to make z in mm
@@ -165,13 +166,13 @@ void PileUpMergerPythia8::Process()
   switch(fPileUpDistribution)
   {
     case 0:
-      numberOfEvents = gRandom->Poisson(fMeanPileUp);
+      numberOfEvents = GetRandom()->Poisson(fMeanPileUp);
       break;
     case 1:
-      numberOfEvents = gRandom->Integer(2*fMeanPileUp + 1);
+      numberOfEvents = GetRandom()->Integer(2*fMeanPileUp + 1);
       break;
     default:
-      numberOfEvents = gRandom->Poisson(fMeanPileUp);
+      numberOfEvents = GetRandom()->Poisson(fMeanPileUp);
       break;
   }
 
@@ -181,12 +182,12 @@ void PileUpMergerPythia8::Process()
 
    // --- Pile-up vertex smearing
 
-    fFunction->GetRandom2(dz, dt);
+    fFunction->GetRandom2(dz, dt, GetRandom());
 
     dt *= c_light*1.0E3; // necessary in order to make t in mm/c
     dz *= 1.0E3; // necessary in order to make z in mm
 
-    dphi = gRandom->Uniform(-TMath::Pi(), TMath::Pi());
+    dphi = GetRandom()->Uniform(-TMath::Pi(), TMath::Pi());
 
     vx = 0.0;
     vy = 0.0;
@@ -209,9 +210,9 @@ void PileUpMergerPythia8::Process()
 
       candidate->Status = 1;
 
-      pdgParticle = pdg->GetParticle(pid);
-      candidate->Charge = pdgParticle ? Int_t(pdgParticle->Charge()/3.0) : -999;
-      candidate->Mass = pdgParticle ? pdgParticle->Mass() : -999.9;
+      pdgParticle = pdg->Find(pid);
+      candidate->Charge = pdgParticle ? pdgParticle->charge : -999;
+      candidate->Mass = pdgParticle ? pdgParticle->mass : -999.9;
 
       candidate->IsPU = 1;
 
@@ -0,0 +1,176 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/** \class PremixedPileUpWriter
+ *
+ *  Writes the candidates of the events into a premixed pile-up library
+ *  for PileUpMerger.
+ *
+ */
+
+#include "modules/PremixedPileUpWriter.h"
+
+#include "classes/DelphesClasses.h"
+#include "classes/DelphesFactory.h"
+
+#include "ExRootAnalysis/ExRootConfReader.h"
+
+#include "TFile.h"
+#include "TTree.h"
+#include "TString.h"
+#include "TObjArray.h"
+#include "TClonesArray.h"
+
+#include <stdexcept>
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+
+PremixedPileUpWriter::PremixedPileUpWriter() :
+  fFile(0), fTree(0), fCandidates(0)
+{
+}
+
+//------------------------------------------------------------------------------
+
+PremixedPileUpWriter::~PremixedPileUpWriter()
+{
+}
+
+//------------------------------------------------------------------------------
+
+void PremixedPileUpWriter::Init()
+{
+  stringstream message;
+  const char *fileName;
+  ExRootConfParam param;
+  Long_t i, size;
+
+  fileName = GetString("OutputFile", "MinBias.premixed.root");
+
+  fFile = TFile::Open(fileName, "RECREATE");
+  if(!fFile || fFile->IsZombie())
+  {
+    message << "can't open premixed pile-up file " << fileName;
+    throw runtime_error(message.str());
+  }
+
+  fTree = new TTree("PremixedPileUp", "Premixed pile-up events");
+  fCandidates = new TClonesArray("Candidate");
+
+  fTree->Branch("Candidate", &fCandidates, 64000);
+  fTree->Branch("ReferenceOffsets", &fReferenceOffsets);
+  fTree->Branch("References", &fReferences);
+
+  param = GetParam("InputArray");
+  size = param.GetSize();
+
+  // the branches keep the addresses of the vectors
+  fArrayNumbers.resize(size/2);
+  for(i = 0; i < size/2; ++i)
+  {
+    fInputArrays.push_back(ImportArray(param[i*2].GetString()));
+    fTree->Branch(param[i*2 + 1].GetString(), &fArrayNumbers[i]);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void PremixedPileUpWriter::Finish()
+{
+  if(fFile)
+  {
+    fFile->cd();
+    if(fTree) fTree->Write();
+    fFile->Close();
+    delete fFile;
+  }
+  if(fCandidates) delete fCandidates;
+}
+
+//------------------------------------------------------------------------------
+
+Int_t PremixedPileUpWriter::GetNumber(Candidate *candidate)
+{
+  map< const Candidate *, Int_t >::iterator itNumbers;
+  Int_t number;
+
+  itNumbers = fNumbers.find(candidate);
+  if(itNumbers != fNumbers.end()) return itNumbers->second;
+
+  number = fStored.size();
+  fNumbers[candidate] = number;
+  fStored.push_back(candidate);
+
+  return number;
+}
+
+//------------------------------------------------------------------------------
+
+void PremixedPileUpWriter::Process()
+{
+  Candidate *candidate;
+  TObjArray *array;
+  Int_t i, j, k, n;
+
+  fStored.clear();
+  fNumbers.clear();
+  fReferenceOffsets.clear();
+  fReferences.clear();
+
+  for(k = 0; k < Int_t(fInputArrays.size()); ++k)
+  {
+    fArrayNumbers[k].clear();
+
+    n = fInputArrays[k]->GetEntriesFast();
+    for(i = 0; i < n; ++i)
+    {
+      candidate = static_cast<Candidate *>(fInputArrays[k]->UncheckedAt(i));
+      fArrayNumbers[k].push_back(GetNumber(candidate));
+    }
+  }
+
+  // the candidates found through the references are appended to fStored
+  // as they are numbered, so the loop also goes through them
+  for(i = 0; i < Int_t(fStored.size()); ++i)
+  {
+    fReferenceOffsets.push_back(fReferences.size());
+
+    array = fStored[i]->GetCandidates();
+    n = array->GetEntriesFast();
+    for(j = 0; j < n; ++j)
+    {
+      fReferences.push_back(GetNumber(static_cast<Candidate *>(array->UncheckedAt(j))));
+    }
+  }
+  fReferenceOffsets.push_back(fReferences.size());
+
+  fCandidates->Clear("C");
+  for(i = 0; i < Int_t(fStored.size()); ++i)
+  {
+    fStored[i]->Copy(*fCandidates->ConstructedAt(i));
+  }
+
+  fTree->Fill();
+}
+
+//------------------------------------------------------------------------------
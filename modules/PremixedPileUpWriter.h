@@ -0,0 +1,91 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PremixedPileUpWriter_h
+#define PremixedPileUpWriter_h
+
+/** \class PremixedPileUpWriter
+ *
+ *  Writes the candidates of the events into a premixed pile-up library
+ *  for PileUpMerger. Every event of the OutputFile holds the candidates
+ *  of the arrays given in InputArray, as pairs of an array and the name
+ *  it gets in the library, and all the candidates that they refer to
+ *  through GetCandidates, with the references between them.
+ *
+ *  Run over minimum bias events with ParticlePropagator and the tracking
+ *  efficiency and smearing modules, the library holds the particles and
+ *  the tracks that the calorimeter takes as input, so that only the
+ *  calorimeter and the modules after it have to run per merged event.
+ *
+ *  The same file is a snapshot of the arrays for SnapshotReader, which
+ *  runs the modules after the writer again from it.
+ *
+ */
+
+#include "classes/DelphesModule.h"
+
+#if !defined(__CINT__) && !defined(__CLING__)
+#include <map>
+#include <vector>
+#endif
+
+class TObjArray;
+class TClonesArray;
+class TFile;
+class TTree;
+
+class Candidate;
+
+class PremixedPileUpWriter: public DelphesModule
+{
+public:
+
+  PremixedPileUpWriter();
+  ~PremixedPileUpWriter();
+
+  void Init();
+  void Process();
+  void Finish();
+
+private:
+
+  Int_t GetNumber(Candidate *candidate);
+
+  TFile *fFile; //!
+  TTree *fTree; //!
+
+  TClonesArray *fCandidates; //!
+
+#if !defined(__CINT__) && !defined(__CLING__)
+  std::vector< const TObjArray * > fInputArrays; //!
+
+  // candidates of the event in the order they are stored, their numbers
+  // and, for every candidate, the first of its references
+  std::vector< Candidate * > fStored; //!
+  std::map< const Candidate *, Int_t > fNumbers; //!
+  std::vector< Int_t > fReferenceOffsets; //!
+  std::vector< Int_t > fReferences; //!
+
+  // numbers of the candidates of every input array
+  std::vector< std::vector< Int_t > > fArrayNumbers; //!
+#endif
+
+  ClassDef(PremixedPileUpWriter, 1)
+};
+
+#endif
@@ -0,0 +1,234 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/** \class PrimaryVertexFinder
+ *
+ *  Fits the primary vertex once per event. Uses Rave.
+ *
+ *  \author Dan Guest
+ *
+ */
+
+#include "modules/PrimaryVertexFinder.h"
+
+#include "classes/flavortag/SecondaryVertex.hh"
+#include "classes/flavortag/enums_track.hh"
+#include "classes/DelphesClasses.h"
+#include "classes/DelphesFactory.h"
+#include "ExRootAnalysis/ExRootConfReader.h"
+
+#include "TObjArray.h"
+
+#ifndef NO_RAVE 		// check for NO_RAVE flag
+
+#include "rave/Track.h"
+#include "rave/Vertex.h"
+#include "FWCore/Utilities/interface/Exception.h"
+#include "rave/VertexFactory.h"
+
+#include "classes/flavortag/RaveConverter.hh"
+#include "classes/flavortag/RaveContext.hh"
+
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+#include <iostream>
+#include <mutex>
+
+namespace {
+  const double NaN = NAN;
+  // rave works in cm, Delphes in mm
+  const double CM = 10.0;
+
+  // you own this pointer, be careful with it
+  rave::Ellipsoid3D* new_beamspot(ExRootConfParam beamspot_params,
+                                  std::vector<double> default_beamspot);
+  SecondaryVertexTrack vertex_track(double weight, const Candidate* track);
+  std::string oneline(std::string);
+}
+
+//------------------------------------------------------------------------------
+
+PrimaryVertexFinder::PrimaryVertexFinder() :
+  fItTrackInputArray(0), fRaveContext(0), fRaveConverter(0), fBeamspot(0)
+{
+}
+
+//------------------------------------------------------------------------------
+
+PrimaryVertexFinder::~PrimaryVertexFinder()
+{
+  delete fRaveContext;
+  delete fRaveConverter;
+  delete fBeamspot;
+}
+
+//------------------------------------------------------------------------------
+
+void PrimaryVertexFinder::Init()
+{
+  // track selection, same defaults as SecondaryVertexTagging
+  fPtMin = GetDouble("TrackPtMin", 1);
+  fD0Max = GetDouble("TrackD0Max", 0.1);
+
+  // magnetic field
+  fBz = GetDouble("Bz", 2.0);
+
+  // beamspot (should be specified in mm, converted to cm internally)
+  const double bs_xy = 15e-3;   // 15 microns
+  fBeamspot = new_beamspot(GetParam("Beamspot"), {bs_xy, bs_xy, 46.0});
+
+  // import input array(s)
+  fTrackInputArray = ImportArray(
+    GetString("TrackInputArray", "Calorimeter/eflowTracks"));
+  fItTrackInputArray = fTrackInputArray->MakeIterator();
+
+  // create output array(s)
+  fOutputArray = ExportArray(GetString("OutputArray", "vertices"));
+
+  // initalize Rave
+  fRaveContext = new RaveContext(fBz, *fBeamspot);
+  double cov_scaling = GetDouble("CovarianceScaling", 1.0);
+  fRaveConverter = new RaveConverter(fBz, cov_scaling);
+}
+
+//------------------------------------------------------------------------------
+
+void PrimaryVertexFinder::Finish()
+{
+  if(fItTrackInputArray) delete fItTrackInputArray;
+  std::ostream sout(GetConfReader()->GetOutStreamBuffer());
+  for (const auto& prob: fDebugCounts) {
+    sout << "PrimaryVertexFinder: " << prob.first << ": " << prob.second
+         << std::endl;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void PrimaryVertexFinder::Process()
+{
+  // track unique IDs are only valid within one event
+  fRaveConverter->clearCache();
+  fItTrackInputArray->Reset();
+  Candidate* track;
+  std::vector<Candidate*> vxp_tracks;
+  while((track = static_cast<Candidate*>(fItTrackInputArray->Next())))
+  {
+    const TLorentzVector &trkMomentum = track->Momentum;
+
+    if (trkMomentum.Pt() < fPtMin) continue;
+    if (std::abs(track->Dxy) > fD0Max) continue;
+    vxp_tracks.push_back(track);
+  }
+
+  auto rave_tracks = fRaveConverter->getRaveTracks(vxp_tracks);
+
+  std::vector<rave::Vertex> vertices;
+  try {
+    std::lock_guard<std::mutex> lock(rave_mutex());
+    vertices = fRaveContext->vertexFactory().create(
+      rave_tracks, "avf", true);
+  } catch (cms::Exception& e) {
+    fDebugCounts[oneline(e.what())]++;
+  }
+  if (vertices.size() == 0) {
+    fDebugCounts["no primary vertex"]++;
+    return;
+  }
+
+  // only take the first vertex, the AVF should only return one
+  const auto& vx = vertices.at(0);
+  const auto& pos = vx.position();
+  Candidate* vertex = GetFactory()->NewCandidate();
+  vertex->Position.SetXYZT(pos.x() * CM, pos.y() * CM, pos.z() * CM, 0);
+  CandidateFlavorTagging* tagging = vertex->NewFlavorTagging();
+  for (const auto& wt_track: vx.weightedTracks()) {
+    const auto* cand = static_cast<const Candidate*>(
+      wt_track.second.originalObject());
+    tagging->primaryVertexTracks.push_back(
+      vertex_track(wt_track.first, cand));
+  }
+  fOutputArray->Add(vertex);
+}
+
+//------------------------------------------------------------------------------
+
+namespace {
+  rave::Ellipsoid3D* new_beamspot(ExRootConfParam beamspot_params,
+                                  std::vector<double> default_beamspot) {
+    std::vector<double> beamspot;
+    int npars = beamspot_params.GetSize();
+    for (int iii = 0; iii < npars; iii++){
+      beamspot.push_back(beamspot_params[iii].GetDouble());
+    }
+    if (beamspot.size() == 0) {
+      beamspot = default_beamspot;
+    } else if (beamspot.size() != 3) {
+      throw std::runtime_error(
+        "Beamspot should be specified by sig_x, sig_y, sig_z");
+    }
+    // convert beamspot width to cm, and square for variance
+    double xx = std::pow(beamspot.at(0) / CM, 2);
+    double yy = std::pow(beamspot.at(1) / CM, 2);
+    double zz = std::pow(beamspot.at(2) / CM, 2);
+    rave::Covariance3D cov(xx, 0, 0,
+                           yy, 0,
+                           zz);
+    return new rave::Ellipsoid3D(rave::Point3D(0,0,0), cov);
+  }
+
+  // There's no jet, so the jet-relative angles are left as NaN
+  SecondaryVertexTrack vertex_track(double weight, const Candidate* track) {
+    SecondaryVertexTrack out;
+    out.weight = weight;
+    out.d0 = track->trkPar[trk::D0];
+    out.z0 = track->trkPar[trk::Z0];
+    out.d0err = std::sqrt(track->trkCov[trk::D0D0]);
+    out.z0err = std::sqrt(track->trkCov[trk::Z0Z0]);
+    out.pt = track->Momentum.Pt();
+    out.dphi = NaN;
+    out.deta = NaN;
+    out.delphes_track = const_cast<Candidate*>(track);
+    return out;
+  }
+
+  std::string oneline(std::string prob) {
+    std::replace(prob.begin(), prob.end(), '\n','%');
+    return prob;
+  }
+}
+
+#else // if NO_RAVE is set
+
+#include <iostream>
+
+// dummy stand-in class, never exports a vertex
+PrimaryVertexFinder::PrimaryVertexFinder() {}
+PrimaryVertexFinder::~PrimaryVertexFinder(){}
+
+void PrimaryVertexFinder::Init() {
+  std::cerr << "** WARNING: Rave was not found! This is a dummy class that "
+	    << "will find no primary vertex!" << std::endl;
+  fOutputArray = ExportArray(GetString("OutputArray", "vertices"));
+}
+void PrimaryVertexFinder::Process() {}
+void PrimaryVertexFinder::Finish() {}
+
+#endif // check for NO_RAVE flag
@@ -0,0 +1,75 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PrimaryVertexFinder_h
+#define PrimaryVertexFinder_h
+
+/** \class PrimaryVertexFinder
+ *
+ *  Fits the primary vertex once per event (AVF, uses Rave) and exports
+ *  it as a candidate. The fitted tracks and their weights are stored
+ *  in the candidate's primaryVertexTracks.
+ *
+ *  \author Dan Guest
+ *
+ */
+
+#include "classes/DelphesModule.h"
+
+#include <map>
+#include <string>
+
+class TObjArray;
+class Candidate;
+namespace rave {
+  class Ellipsoid3D;
+}
+class RaveConverter;
+class RaveContext;
+
+class PrimaryVertexFinder: public DelphesModule
+{
+public:
+
+  PrimaryVertexFinder();
+  ~PrimaryVertexFinder();
+
+  void Init();
+  void Process();
+  void Finish();
+
+private:
+  double fPtMin;
+  double fD0Max;
+  double fBz;			// magnetic field along z
+
+  TIterator *fItTrackInputArray; //!
+
+  const TObjArray *fTrackInputArray; //!
+
+  TObjArray *fOutputArray; //!
+
+  RaveContext* fRaveContext;
+  RaveConverter* fRaveConverter;
+  rave::Ellipsoid3D* fBeamspot;
+  std::map<std::string, int> fDebugCounts;
+
+  ClassDef(PrimaryVertexFinder, 1)
+};
+
+#endif // PrimaryVertexFinder_h
@@ -20,7 +20,8 @@ using namespace std;
 //------------------------------------------------------------------------------
 RunPUPPI::RunPUPPI() :
   fItTrackInputArray(0), 
-  fItNeutralInputArray(0)
+  fItNeutralInputArray(0),
+  fNThreads(1)
 {}
 
 //------------------------------------------------------------------------------
@@ -42,6 +43,11 @@ void RunPUPPI::Init(){
   // puppi parameters                                     
   fMinPuppiWeight = GetDouble("MinPuppiWeight", 0.01);
   fUseExp         = GetBool("UseExp", false);
+  fNThreads       = GetInt("NThreads", 1);
+  if(fNThreads < 1)
+  {
+    throw runtime_error("NThreads must be positive");
+  }
 
   // read eta min ranges                                                                                                                                                           
   ExRootConfParam param = GetParam("EtaMinBin");
@@ -241,7 +247,7 @@ void RunPUPPI::Process(){
   }  
 
   // Create PUPPI container
-  puppiCleanContainer curEvent(puppiInputVector,puppiAlgo,fMinPuppiWeight,fUseExp);
+  puppiCleanContainer curEvent(puppiInputVector,puppiAlgo,fMinPuppiWeight,fUseExp,fNThreads);
   std::vector<fastjet::PseudoJet> puppiParticles = curEvent.puppiEvent();
 
   // Loop on final particles
@@ -32,6 +32,7 @@ class RunPUPPI: public DelphesModule {
   // puppi parameters
   float fMinPuppiWeight;
   bool fUseExp;
+  int fNThreads;
   
   std::vector<float> fEtaMinBin ;
   std::vector<float> fEtaMaxBin ;
@@ -33,6 +33,7 @@
 
 #include <iostream>
 #include <cassert>
+#include <algorithm>
 
 
 //------------------------------------------------------------------------------
@@ -88,6 +89,10 @@ void SecondaryVertexAssociator::Process(){
 
   Candidate *jet;
 
+  // particle indices are only valid within one event
+  fWalkCache.clear();
+  fNChargedCache.clear();
+
   // loop over all input jets
   fItJetInputArray->Reset();
   while((jet = static_cast<Candidate *>(fItJetInputArray->Next())))
@@ -95,16 +100,24 @@ void SecondaryVertexAssociator::Process(){
     // loop over tracks
     Candidate* track;
     TIter itTracks(jet->GetTracks());
-    std::map<TruthVertex, int> track_count;
+    HFVs& vertices = fVertices;
+    vertices.clear();
     while ((track = static_cast<Candidate*>(itTracks.Next()))) {
-      auto vertices = getHeavyFlavorVertices(track);
-      for (const auto& vx: vertices) {
-	track_count[vx]++;
+      for (const auto& vx: getHeavyFlavorVertices(track)) {
+	vertices.push_back(vx);
       }
     }
-    for (const auto& vx: track_count) {
-      jet->truthVertices.push_back(vx.first);
-    }
+    // sort by index and keep the first of each, the stable sort makes
+    // sure the first one found is the one we keep
+    std::stable_sort(vertices.begin(), vertices.end());
+    auto last = std::unique(
+      vertices.begin(), vertices.end(),
+      [](const TruthVertex& v1, const TruthVertex& v2) {
+	return v1.idx == v2.idx;
+      });
+    CandidateFlavorTagging* tagging = jet->NewFlavorTagging();
+    tagging->truthVertices.insert(tagging->truthVertices.end(),
+				  vertices.begin(), last);
   }
 }
 
@@ -136,23 +149,22 @@ SecondaryVertexAssociator::walkTruthRecord(Candidate* genPart,
     if (targets.count(heaviest) && is_metastable(mother->PID)) {
       auto newtarg = targets;
       const auto& pos = genPart->Position;
-      auto children = getStableChildren(getGenPart(mid));
       TruthVertex vx;
       vx.x = pos.X();
       vx.y = pos.Y();
       vx.z = pos.Z();
       vx.pdgid = mother->PID;
       vx.idx = mid;
-      vx.n_charged_tracks = getNCharged(children);
+      vx.n_charged_tracks = getNChargedChildren(mid);
       found.push_back(vx);
       // then remove from targets and call this function on the mother
       newtarg.erase(heaviest);
-      for (auto& new_vx: walkTruthRecord(mother, newtarg)) {
+      for (auto& new_vx: walkFromMother(mid, newtarg)) {
 	found.push_back(new_vx);
       }
     } else {
       // if this isn't a target, just call function on the mother
-      for (auto& new_vx: walkTruthRecord(mother, targets)) {
+      for (auto& new_vx: walkFromMother(mid, targets)) {
 	found.push_back(new_vx);
       }
     }
@@ -160,6 +172,30 @@ SecondaryVertexAssociator::walkTruthRecord(Candidate* genPart,
   return found;
 }
 
+// cached version of walkTruthRecord, starting from a particle index
+const SecondaryVertexAssociator::HFVs&
+SecondaryVertexAssociator::walkFromMother(int idx,
+					  const std::set<int>& targets) {
+  long long key = idx;
+  for (int target: targets) {
+    assert(target >= 0 && target < 16);
+    key = key | (1LL << (target + 32));
+  }
+  auto cached = fWalkCache.find(key);
+  if (cached != fWalkCache.end()) return cached->second;
+  // references to elements stay valid when the map grows
+  auto found = walkTruthRecord(getGenPart(idx), targets);
+  return fWalkCache.emplace(key, found).first->second;
+}
+
+int SecondaryVertexAssociator::getNChargedChildren(int idx) {
+  auto cached = fNChargedCache.find(idx);
+  if (cached != fNChargedCache.end()) return cached->second;
+  int n_charged = getNCharged(getStableChildren(getGenPart(idx)));
+  fNChargedCache.emplace(idx, n_charged);
+  return n_charged;
+}
+
 std::vector<Candidate*> SecondaryVertexAssociator::getStableChildren(Candidate* mother)
 {
   if (mother->Status == 1) {
@@ -33,6 +33,9 @@
 
 #include <map>
 #include <set>
+#ifndef __CINT__
+#include <unordered_map>
+#endif
 
 class TObjArray;
 
@@ -58,9 +61,22 @@ private:
   typedef std::vector<TruthVertex> HFVs;
   HFVs getHeavyFlavorVertices(Candidate* track);
   HFVs walkTruthRecord(Candidate* genPart, const std::set<int>& targets);
+  const HFVs& walkFromMother(int idx, const std::set<int>& targets);
+  int getNChargedChildren(int idx);
   std::vector<Candidate*> getStableChildren(Candidate* idx);
   Candidate* getGenPart(int idx);
 
+#ifndef __CINT__
+  // Tracks in a jet share most of their ancestry, so the walk from
+  // each mother is only done once per event. The key combines the
+  // particle index with the remaining targets.
+  std::unordered_map<long long, HFVs> fWalkCache; //!
+  std::unordered_map<int, int> fNChargedCache; //!
+#endif
+
+  // vertices of the current jet, the storage is kept between jets
+  HFVs fVertices; //!
+
   ClassDef(SecondaryVertexAssociator, 1)
 };
 
@@ -30,7 +30,10 @@
 // only define use what's below if we have Rave
 #include "classes/flavortag/math.hh"
 #include "classes/flavortag/SecondaryVertex.hh"
+#include "classes/flavortag/hl_vars.hh"
 #include "classes/DelphesClasses.h"
+#include "classes/DelphesFactory.h"
+#include "classes/DelphesEtaPhiGrid.h"
 #include "ExRootAnalysis/ExRootConfReader.h"
 
 #include "TObjArray.h"
@@ -46,15 +49,32 @@
 #include "rave/Vector6D.h"
 #include "rave/VertexFactory.h"
 #include "rave/FlavorTagFactory.h"
-#include "rave/ConstantMagneticField.h"
-#include "rave/VacuumPropagator.h"
 
 #include "classes/flavortag/RaveConverter.hh"
+#include "classes/flavortag/RaveContext.hh"
 
 #include <iostream>
 #include <map>
 #include <set>
 #include <iomanip>
+#include <mutex>
+#include <chrono>
+#include <algorithm>
+
+// inputs and results of the fits for one jet, the fits run once the
+// tracks of every jet are selected
+struct JetFit {
+  Candidate* jet;
+  SortedTracks tracks;
+  std::vector<rave::Track> rave_tracks;
+  // empty unless we seed with the jet axis
+  std::vector<rave::Track> ghost;
+  std::vector<rave::Vertex> hl_vertices;
+  std::vector<rave::Vertex> ml_vertices;
+  std::vector<std::string> errors;
+  // set if we ran out of time and used the fallback method
+  std::string fallback;
+};
 
 // forward declare some utility functions that are used below
 namespace {
@@ -68,6 +88,11 @@ namespace {
 
   typedef std::vector<std::pair<double, Candidate*> > WeightedTracks;
 
+  typedef std::chrono::steady_clock Clock;
+  double seconds_since(const Clock::time_point& start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+  }
+
   // - walk up the candidate tree to find the generated particle
   Candidate* get_part(Candidate* cand);
   // - dump info about a track
@@ -75,7 +100,7 @@ namespace {
   void print_more_info(const Candidate* cand);
   void print_rave_track_info(const rave::Track& track);
   // - vertex significance
-  double vertex_significance(const rave::Vertex&);
+  double vertex_significance(const rave::Vertex&, double variance);
   double decay_length_variance(const rave::Vertex&);
 
   // Several functions to get discriminating tagging info notes:
@@ -85,16 +110,22 @@ namespace {
   //    while in others we only consider tracks above some threshold.
   //  - TODO: rationalize this a bit. Why use thresholds at all?
   double vertex_energy(const rave::Vertex&);
-  double cut_vertex_energy(const rave::Vertex&, double threshold);
   double weighted_vertex_energy(const rave::Vertex&);
   double track_energy(const std::vector<rave::Track>&);
   double track_energy(const std::vector<Candidate*>&);
-  int n_tracks(const rave::Vertex&, double threshold);
-  double mass(const rave::Vertex&, double threshold);
-  WeightedTracks delphes_tracks(const rave::Vertex&);
-  std::vector<SecondaryVertexTrack> get_tracks_along_jet(
+  // - the sums over the tracks above threshold and the delphes tracks
+  //   of a vertex, from one pass over its weighted tracks
+  struct VertexSums {
+    int n_tracks;
+    double energy;
+    double mass;
+    WeightedTracks tracks;
+  };
+  void sum_vertex(const rave::Vertex&, double threshold, VertexSums&);
+  void add_tracks_along_jet(std::vector<SecondaryVertexTrack>& table,
     const WeightedTracks& tracks, const TVector3& jet, double threshold);
-  int get_n_shared(const std::vector<SecondaryVertex>& vertices);
+  int get_n_shared(const std::vector<SecondaryVertex>& vertices,
+                   const std::vector<SecondaryVertexTrack>& table);
 
   std::ostream& operator<<(std::ostream& os, const SecondaryVertex&);
   std::ostream& operator<<(std::ostream&, const rave::PerigeeParameters5D&);
@@ -105,8 +136,9 @@ namespace {
 //------------------------------------------------------------------------------
 
 SecondaryVertexTagging::SecondaryVertexTagging() :
-  fItTrackInputArray(0), fItJetInputArray(0), fMagneticField(0),
-  fVertexFactory(0), fRaveConverter(0), fFlavorTagFactory(0), fBeamspot(0)
+  fItTrackInputArray(0), fItJetInputArray(0), fPrimaryVertexInputArray(0),
+  fTrackGrid(0), fRaveContext(0), fJetFits(new std::vector<JetFit>),
+  fRaveConverter(0), fFlavorTagFactory(0), fBeamspot(0)
 {
 }
 
@@ -114,8 +146,8 @@ SecondaryVertexTagging::SecondaryVertexTagging() :
 
 SecondaryVertexTagging::~SecondaryVertexTagging()
 {
-  delete fMagneticField;
-  delete fVertexFactory;
+  delete fRaveContext;
+  delete fJetFits;
   delete fRaveConverter;
   delete fFlavorTagFactory;
   delete fBeamspot;
@@ -164,12 +196,17 @@ namespace {
     return outs;
   }
   rave::Track get_ghost(const TVector3& jet);
-  int n_over(const std::vector<std::pair<float, rave::Track> >& trks,
-						 float threshold = 0.5);
+  // drop tracks under the IP significance cut, if there are more than
+  // `max_tracks` (and it's nonzero) keep the most significant ones
+  std::vector<Candidate*> preselect(const std::vector<Candidate*>&,
+                                    double ip_sig_min, size_t max_tracks);
   std::string avr_config(double vx_compat);
   std::string avf_config(double vx_compat);
+  // the tracks of the vertex are appended to track_table
   SecondaryVertex sv_from_rave_sv(const rave::Vertex&, double jet_track_e,
-																	const TVector3& jet, double threshold = 0);
+                                  const TVector3& jet,
+                                  std::vector<SecondaryVertexTrack>& track_table,
+                                  double threshold = 0);
   SecondaryVertex sv_from_rave_pv(const std::vector<Candidate*>,
                                   double jet_track_e);
 
@@ -205,6 +242,22 @@ void SecondaryVertexTagging::Init()
   // rave method
   fHLSecVxCompatibility = GetDouble("HLSecVxCompatibility", 3.0);
   fMidLevelSecVxCompatibility = GetDouble("MidLevelSecVxCompatibility", 1.0);
+  // cheap cuts on the tracks that go into the fits
+  fFitTrackIPSigMin = GetDouble("FitTrackIPSigMin", 0);
+  int max_fit_tracks = GetInt("MaxFitTracks", 0);
+  if (max_fit_tracks < 0) {
+    throw std::runtime_error("MaxFitTracks can't be negative");
+  }
+  fMaxFitTracks = max_fit_tracks;
+  // time budgets (in seconds, zero for none) for the vertex fits
+  fJetTimeBudget = GetDouble("JetTimeBudget", 0);
+  fEventTimeBudget = GetDouble("EventTimeBudget", 0);
+  fFallbackMethod = GetString("FallbackMethod", "kalman");
+  // seed the fits with a ghost track along the jet axis
+  fJetAxisSeed = GetBool("JetAxisSeed", false);
+  // skip the jets no writer keeps, zero for no cut
+  fJetPtMin = GetDouble("JetPTMin", 0);
+  fJetAbsEtaMax = GetDouble("JetAbsEtaMax", 0);
 
   // import input array(s)
   fTrackInputArray = ImportArray(
@@ -213,6 +266,13 @@ void SecondaryVertexTagging::Init()
   fJetInputArray = ImportArray(
     GetString("JetInputArray", "FastJetFinder/jets"));
   fItJetInputArray = fJetInputArray->MakeIterator();
+  // see JetTrackAssociator.h
+  fUseJetTracks = GetBool("UseJetTracks", false);
+  // run PrimaryVertexFinder first to share its fit with other modules
+  std::string pv_array = GetString("PrimaryVertexInputArray", "");
+  if (pv_array.size() > 0) {
+    fPrimaryVertexInputArray = ImportArray(pv_array.c_str());
+  }
 
   // create output array(s)
 
@@ -223,9 +283,7 @@ void SecondaryVertexTagging::Init()
   std::ostream sout(GetConfReader()->GetOutStreamBuffer());
   sout << "** INFO:     This is Rave Version " << rave::Version()
        << std::endl;
-  fMagneticField = new rave::ConstantMagneticField(0, 0, fBz);
-  fVertexFactory = new rave::VertexFactory(
-    *fMagneticField, rave::VacuumPropagator(), *fBeamspot, "default", 0);
+  fRaveContext = new RaveContext(fBz, *fBeamspot);
 
   double cov_scaling = GetDouble("CovarianceScaling", 1.0);
   fRaveConverter = new RaveConverter(fBz, cov_scaling);
@@ -266,10 +324,10 @@ std::vector<Candidate*> SecondaryVertexTagging::GetTracks(Candidate* jet) {
 
   const TLorentzVector &jetMomentum = jet->Momentum;
 
-  // loop over all input tracks
-  fItTrackInputArray->Reset();
+  // loop over all input tracks (or the ones already in the jet)
+  TIter itTracks(fUseJetTracks ? jet->GetTracks() : fTrackInputArray);
   Candidate* track;
-  while((track = static_cast<Candidate*>(fItTrackInputArray->Next())))
+  while((track = static_cast<Candidate*>(itTracks.Next())))
   {
     const TLorentzVector &trkMomentum = track->Momentum;
 
@@ -288,18 +346,33 @@ std::vector<Candidate*> SecondaryVertexTagging::GetTracks(Candidate* jet) {
   return jet_tracks;
 }
 
-SortedTracks SecondaryVertexTagging::SelectTracksInJet(
-  Candidate* jet, const std::unordered_map<unsigned, double>& primary_wts) {
-  // loop over all input jets
-  SortedTracks tracks;
+void SecondaryVertexTagging::SelectTracksInJet(
+  Candidate* jet, const std::unordered_map<unsigned, double>& primary_wts,
+  SortedTracks& tracks) {
+  tracks.first.clear();
+  tracks.second.clear();
+  tracks.all.clear();
 
   const TLorentzVector &jetMomentum = jet->Momentum;
 
-  // loop over all input tracks
-  fItTrackInputArray->Reset();
+  // tracks outside the cone were never kept, so with the input array
+  // only the ones the event's eta-phi index finds in the cone are
+  // visited, in input order
+  TIter itTracks(fUseJetTracks ? jet->GetTracks() : 0);
+  size_t n_nearby = 0;
+  if (!fUseJetTracks) {
+    fTrackGrid->Find(jetMomentum.Eta(), jetMomentum.Phi(), fDeltaR, fNearbyTracks);
+  }
   Candidate* track;
-  while((track = static_cast<Candidate*>(fItTrackInputArray->Next())))
+  while (true)
   {
+    if (fUseJetTracks) {
+      track = static_cast<Candidate*>(itTracks.Next());
+    } else {
+      track = n_nearby < fNearbyTracks.size() ? fNearbyTracks[n_nearby++]->candidate : 0;
+    }
+    if (!track) break;
+
     const TLorentzVector &trkMomentum = track->Momentum;
 
     double dr = jetMomentum.DeltaR(trkMomentum);
@@ -312,13 +385,12 @@ SortedTracks SecondaryVertexTagging::SelectTracksInJet(
     bool over_pt_threshold = (tpt >= fPtMin);
     bool track_in_jet = (dr <= fDeltaR);
 
-    unsigned tid = track->GetUniqueID();
-    double primary_wt = primary_wts.count(tid) ? primary_wts.at(tid) : -1.0;
-    bool track_in_primary = (primary_wt > fPrimaryVertexCompatibility);
-
     if (track_in_jet) {
       tracks.all.push_back(track);
       if (over_pt_threshold) {
+        const auto prim = primary_wts.find(track->GetUniqueID());
+        double primary_wt = prim != primary_wts.end() ? prim->second : -1.0;
+        bool track_in_primary = (primary_wt > fPrimaryVertexCompatibility);
         if(track_in_primary) {
           tracks.first.emplace_back(primary_wt, track);
         } else {
@@ -328,86 +400,184 @@ SortedTracks SecondaryVertexTagging::SelectTracksInJet(
     }
   }
   assert(tracks.all.size() >= (tracks.first.size() + tracks.second.size()));
-  return tracks;
 }
 
 void SecondaryVertexTagging::Process()
 {
+  // track unique IDs are only valid within one event
+  fRaveConverter->clearCache();
   fItJetInputArray->Reset();
   Candidate* jet;
-  const auto& primary = GetPrimaryVertex();
-  const auto& primary_tracks = primary.weightedTracks();
-  if (n_over(primary_tracks, fPrimaryVertexCompatibility) == 0) {
-    fDebugCounts["no primary tracks over threshold"]++;
+  const auto primary_weight = GetPrimaryWeights();
+  int n_primary = 0;
+  for (const auto& prim: primary_weight) {
+    if (prim.second > fPrimaryVertexCompatibility) n_primary++;
   }
-  std::unordered_map<unsigned, double> primary_weight;
-  for (const auto& prim: primary_tracks) {
-    const auto* cand = static_cast<Candidate*>(
-      prim.second.originalObject());
-    primary_weight.emplace(cand->GetUniqueID(), prim.first);
+  if (n_primary == 0) {
+    fDebugCounts["no primary tracks over threshold"]++;
   }
 
+  // filled once per event and shared with the other modules
+  if (!fUseJetTracks) fTrackGrid = &GetFactory()->GetEtaPhiGrid(fTrackInputArray);
+
+  // The entries of fJetFits are reused, so only the first n_fits are
+  // this event's.
+  std::vector<JetFit>& fits = *fJetFits;
+  size_t n_fits = 0;
   while((jet = static_cast<Candidate*>(fItJetInputArray->Next())))
   {
     const TLorentzVector& jvec = jet->Momentum;
-
-    auto all_tracks = SelectTracksInJet(jet, primary_weight);
-    jet->primaryVertexTracks = get_tracks_along_jet(
+    if (jvec.Pt() < fJetPtMin) continue;
+    if (fJetAbsEtaMax > 0 && std::abs(jvec.Eta()) > fJetAbsEtaMax) continue;
+    if (n_fits == fits.size()) fits.emplace_back();
+    JetFit& fit = fits[n_fits++];
+    fit.jet = jet;
+    SelectTracksInJet(jet, primary_weight, fit.tracks);
+    fit.rave_tracks = fRaveConverter->getRaveTracks(
+      preselect(fit.tracks.second, fFitTrackIPSigMin, fMaxFitTracks));
+    fit.ghost.clear();
+    if (fJetAxisSeed) fit.ghost.push_back(get_ghost(jet->Momentum.Vect()));
+    fit.hl_vertices.clear();
+    fit.ml_vertices.clear();
+    fit.errors.clear();
+    fit.fallback.clear();
+  }
+
+  double fit_seconds = 0;
+  for (size_t iii = 0; iii < n_fits; iii++) {
+    FitJet(fits[iii], fRaveContext->vertexFactory(), fit_seconds);
+  }
+
+  // write everything back in jet order
+  for (size_t iii = 0; iii < n_fits; iii++) {
+    const JetFit& fit = fits[iii];
+    jet = fit.jet;
+    CandidateFlavorTagging* tagging = jet->NewFlavorTagging();
+    const TLorentzVector& jvec = jet->Momentum;
+    const auto& all_tracks = fit.tracks;
+    for (const auto& error: fit.errors) {
+      fDebugCounts[error]++;
+    }
+    if (!fit.fallback.empty()) {
+      fDebugCounts["used " + fFallbackMethod + " fit, over " +
+                   fit.fallback]++;
+      tagging->svFitFallback = 1;
+    }
+    tagging->primaryVertexTracks.clear();
+    add_tracks_along_jet(tagging->primaryVertexTracks,
       all_tracks.first, jvec.Vect(), fPrimaryVertexCompatibility);
-    auto jet_tracks = fRaveConverter->getRaveTracks(all_tracks.second);
     double jet_track_energy = track_energy(all_tracks.all);
     assert(jet_track_energy >= track_energy(all_tracks.second));
-    // try out methods:
-    // - "kalman" only ever makes one vertex
-    // - "mvf" crashes...
-    // - "avf": Gives each track a `weight', but forms only one vertex.
-    // - "avr": Same as AVF except that it forms new vertices when track
-    //          weight drops below 50%.
-    // - "tkvf": trimmed Kalman fitter
-    // rave::Point3D seed = fRaveConverter->getSeed(all_tracks.first);
-    // doesn't make sense to get vertices with < 2 tracks...
+
+    // the high level vertex puts its tracks straight into hlSecVxTracks,
+    // the others into the track table of the jet
     std::vector<SecondaryVertex> hl_svx;
-    if (jet_tracks.size() >= 2) {
-      auto hl_config = avf_config(fHLSecVxCompatibility);
-      auto ml_config = avr_config(fMidLevelSecVxCompatibility);
-      try {
-
-        // start with high level variables
-        auto hl_vert = fVertexFactory->create(jet_tracks, hl_config);
-        for (const auto& vert: hl_vert) {
-          auto out_vert = sv_from_rave_sv(
-            vert, jet_track_energy, jvec.Vect(), VPROB_THRESHOLD);
-          out_vert.config = "high-level";
-          hl_svx.push_back(out_vert);
-        } // end vertex filling
-
-        // now fill med level
-        auto ml_vert = fVertexFactory->create(jet_tracks, ml_config);
-        for (const auto& vert: ml_vert) {
-          auto out_vert = sv_from_rave_sv(
-            vert, jet_track_energy, jvec.Vect());
-          out_vert.config = "med-level";
-          jet->secondaryVertices.push_back(out_vert);
-        }
-      } catch (cms::Exception& e) {
-        fDebugCounts[oneline(e.what())]++;
-      }
-    }   // end check for two tracks
+    tagging->hlSecVxTracks.clear();
+    for (const auto& vert: fit.hl_vertices) {
+      auto out_vert = sv_from_rave_sv(
+        vert, jet_track_energy, jvec.Vect(), tagging->hlSecVxTracks,
+        VPROB_THRESHOLD);
+      out_vert.config = SecondaryVertexConfig::high_level;
+      hl_svx.push_back(out_vert);
+    }
+    for (const auto& vert: fit.ml_vertices) {
+      auto out_vert = sv_from_rave_sv(
+        vert, jet_track_energy, jvec.Vect(), tagging->secondaryVertexTracks);
+      out_vert.config = SecondaryVertexConfig::med_level;
+      tagging->secondaryVertices.push_back(out_vert);
+    }
     // high level (one fitted vertex)
     assert(hl_svx.size() <= 1);
-    jet->hlSecVxTracks.clear();
-    if (hl_svx.size() > 0) {
-      jet->hlSecVxTracks = hl_svx.at(0).tracks_along_jet;
-    }
-    jet->hlSvx.fill(jvec.Vect(), hl_svx, 0);
-    jet->primaryVertex = sv_from_rave_pv(
+    tagging->hlSvx.fill(jvec.Vect(), hl_svx, 0);
+    tagging->primaryVertex = sv_from_rave_pv(
       second(all_tracks.first),
       jet_track_energy);
     // medium level (multiple vertices)
-    jet->mlSvx.fill(jvec.Vect(), jet->secondaryVertices, 0);
+    tagging->mlSvx.fill(jvec.Vect(), tagging->secondaryVertices, 0);
   }   // end jet loop
 }
 
+// try out methods:
+// - "kalman" only ever makes one vertex
+// - "mvf" crashes...
+// - "avf": Gives each track a `weight', but forms only one vertex.
+// - "avr": Same as AVF except that it forms new vertices when track
+//          weight drops below 50%.
+// - "tkvf": trimmed Kalman fitter
+void SecondaryVertexTagging::FitJet(JetFit& fit,
+                                    rave::VertexFactory& factory,
+                                    double& event_seconds) const {
+  // doesn't make sense to get vertices with < 2 tracks...
+  if (fit.rave_tracks.size() < 2) return;
+  auto hl_config = avf_config(fHLSecVxCompatibility);
+  auto ml_config = avr_config(fMidLevelSecVxCompatibility);
+  // Only the fits count against the budgets. The clock starts once
+  // rave_mutex is held, so waiting for another event worker doesn't.
+  double jet_seconds = 0;
+  auto create = [&fit, &factory, &jet_seconds](const std::string& config)
+    -> std::vector<rave::Vertex> {
+    std::lock_guard<std::mutex> lock(rave_mutex());
+    const auto start = Clock::now();
+    std::vector<rave::Vertex> vertices;
+    if (fit.ghost.size() > 0) {
+      // seeded with the jet axis
+      vertices = factory.create(fit.rave_tracks, fit.ghost.front(), config);
+    } else {
+      vertices = factory.create(fit.rave_tracks, config);
+    }
+    jet_seconds += seconds_since(start);
+    return vertices;
+  };
+  // once we're over budget everything left uses the fallback method
+  if (fEventTimeBudget > 0 && event_seconds > fEventTimeBudget) {
+    fit.fallback = "event time budget";
+    hl_config = fFallbackMethod;
+    ml_config = fFallbackMethod;
+  }
+  try {
+    // start with high level variables
+    fit.hl_vertices = create(hl_config);
+    if (fit.fallback.empty() && fJetTimeBudget > 0 &&
+        jet_seconds > fJetTimeBudget) {
+      fit.fallback = "jet time budget";
+      ml_config = fFallbackMethod;
+    }
+    // now fill med level
+    fit.ml_vertices = create(ml_config);
+  } catch (cms::Exception& e) {
+    fit.errors.push_back(oneline(e.what()));
+  }
+  event_seconds += jet_seconds;
+}
+
+// map from track unique ID to primary vertex weight
+std::unordered_map<unsigned, double>
+SecondaryVertexTagging::GetPrimaryWeights() {
+  std::unordered_map<unsigned, double> primary_weight;
+  if (fPrimaryVertexInputArray) {
+    // an empty array means the fit failed, PrimaryVertexFinder counts that
+    if (fPrimaryVertexInputArray->GetEntriesFast() > 0) {
+      const auto* vertex = static_cast<Candidate*>(
+        fPrimaryVertexInputArray->At(0));
+      const auto* tagging = vertex->GetFlavorTagging();
+      if (tagging) {
+        for (const auto& prim: tagging->primaryVertexTracks) {
+          primary_weight.emplace(
+            prim.delphes_track->GetUniqueID(), prim.weight);
+        }
+      }
+    }
+    return primary_weight;
+  }
+  const auto& primary = GetPrimaryVertex();
+  for (const auto& prim: primary.weightedTracks()) {
+    const auto* cand = static_cast<Candidate*>(
+      prim.second.originalObject());
+    primary_weight.emplace(cand->GetUniqueID(), prim.first);
+  }
+  return primary_weight;
+}
+
 rave::Vertex SecondaryVertexTagging::GetPrimaryVertex() {
   // loop over all input tracks
   fItTrackInputArray->Reset();
@@ -434,7 +604,11 @@ rave::Vertex SecondaryVertexTagging::GetPrimaryVertex() {
 rave::Vertex SecondaryVertexTagging::getPrimaryVertex(
   const std::vector<rave::Track>& rave_tracks)
 {
-  auto vertices = fVertexFactory->create(rave_tracks, "avf", true);
+  std::vector<rave::Vertex> vertices;
+  {
+    std::lock_guard<std::mutex> lock(rave_mutex());
+    vertices = fRaveContext->vertexFactory().create(rave_tracks, "avf", true);
+  }
   if (vertices.size() == 0) {
     fDebugCounts["no primary vertex"]++;
     return rave::Vertex();
@@ -478,29 +652,34 @@ namespace {
   SecondaryVertex sv_from_rave_sv(const rave::Vertex& vert,
                                   double jet_track_energy,
                                   const TVector3& jet,
+                                  std::vector<SecondaryVertexTrack>& track_table,
                                   double threshold) {
     auto pos_mm = vert.position() * 10; // convert to mm
     SecondaryVertex out_vert(pos_mm.x(), pos_mm.y(), pos_mm.z());
-    out_vert.Lsig = vertex_significance(vert);
+    VertexSums sums;
+    sum_vertex(vert, threshold, sums);
+    double variance = decay_length_variance(vert);
+    out_vert.Lsig = vertex_significance(vert, variance);
     out_vert.Lxy = pos_mm.perp();
-    out_vert.decayLengthVariance = decay_length_variance(vert);
-    out_vert.nTracks = n_tracks(vert, threshold);
-    out_vert.eFrac = cut_vertex_energy(vert, threshold) /
-      jet_track_energy;
-    out_vert.mass = mass(vert, threshold);
+    out_vert.decayLengthVariance = variance;
+    out_vert.nTracks = sums.n_tracks;
+    out_vert.eFrac = sums.energy / jet_track_energy;
+    out_vert.mass = sums.mass;
     double vertex_phi = std::atan2(pos_mm.y(), pos_mm.x());
     out_vert.dphi = phi_mpi_pi(vertex_phi, jet.Phi());
     out_vert.deta = out_vert.Eta() - jet.Eta();
 
-    out_vert.tracks_along_jet = get_tracks_along_jet(
-      delphes_tracks(vert), jet, threshold);
+    out_vert.first_track = track_table.size();
+    add_tracks_along_jet(track_table, sums.tracks, jet, threshold);
+    out_vert.n_tracks_along_jet = track_table.size() - out_vert.first_track;
     return out_vert;
   }
-  int get_n_shared(const std::vector<SecondaryVertex>& vertices) {
+  int get_n_shared(const std::vector<SecondaryVertex>& vertices,
+                   const std::vector<SecondaryVertexTrack>& table) {
     std::set<Candidate*> tracks;
     std::set<Candidate*> shared;
     for (const auto& vx: vertices) {
-      for (const auto& trk: vx.tracks_along_jet) {
+      for (const auto& trk: vx.tracks_along_jet(table)) {
 	if (tracks.count(trk.delphes_track) ) {
 	  shared.insert(trk.delphes_track);
 	}
@@ -510,14 +689,26 @@ namespace {
     return shared.size();
   }
 
-  int n_over(const std::vector<std::pair<float, rave::Track> >& trks,
-	     float threshold)
-  {
-    int n_trk = 0;
-    for (const auto& tk: trks) {
-      if (tk.first > threshold) n_trk++;
+  std::vector<Candidate*> preselect(const std::vector<Candidate*>& tracks,
+                                    double ip_sig_min, size_t max_tracks) {
+    std::vector<std::pair<double, Candidate*> > by_sig;
+    for (const auto& track: tracks) {
+      TrackParameters pars(track->trkPar, track->trkCov);
+      double sig = std::hypot(pars.d0 / pars.d0err, pars.z0 / pars.z0err);
+      if (sig < ip_sig_min) continue;
+      by_sig.emplace_back(sig, track);
     }
-    return n_trk;
+    // only reorder if we have to cut some, otherwise keep the input order
+    if (max_tracks > 0 && by_sig.size() > max_tracks) {
+      std::stable_sort(
+        by_sig.begin(), by_sig.end(),
+        [](const std::pair<double, Candidate*>& a,
+           const std::pair<double, Candidate*>& b) {
+          return a.first > b.first;
+        });
+      by_sig.resize(max_tracks);
+    }
+    return second(by_sig);
   }
   rave::Track get_ghost(const TVector3& jvec) {
     rave::Vector3D rave_jet_momentum(jvec.Px(), jvec.Py(), jvec.Pz());
@@ -529,14 +720,14 @@ namespace {
     return rave::Track(rave_jet, dummy_cov, 0, 0, 0);
   }
   // various functions to work with rave (forward declared above)
-  double vertex_significance(const rave::Vertex& vx) {
+  double vertex_significance(const rave::Vertex& vx, double variance) {
     double Lx = vx.position().x();
     double Ly = vx.position().y();
     double Lz = vx.position().z();
     double decaylength = std::sqrt(Lx*Lx + Ly*Ly + Lz*Lz);
     if (decaylength == 0) return 0;
 
-    double err = sqrt(decay_length_variance(vx));
+    double err = sqrt(variance);
     return decaylength / err;
   }
   double decay_length_variance(const rave::Vertex& vx) {
@@ -569,16 +760,6 @@ namespace {
     }
     return energy;
   }
-  double cut_vertex_energy(const rave::Vertex& vx, double threshold) {
-    using namespace std;
-    double energy = 0;
-    for (const auto& wt_trk: vx.weightedTracks()) {
-      if (wt_trk.first > threshold) {
-				energy += sqrt(wt_trk.second.momentum().mag2() + M_PION2);
-      }
-    }
-    return energy;
-  }
   double weighted_vertex_energy(const rave::Vertex& vx) {
     // return the weightd track energy: multiply the energy by the
     // track weight in the vertex fit
@@ -606,38 +787,31 @@ namespace {
     }
     return energy;
   }
-  int n_tracks(const rave::Vertex& vx, double threshold) {
-    int n_tracks = 0;
-    for (const auto& wt_trk: vx.weightedTracks()) {
-      if (wt_trk.first > threshold) n_tracks++;
-    }
-    return n_tracks;
-  }
-  double mass(const rave::Vertex& vx, double threshold) {
+  void sum_vertex(const rave::Vertex& vx, double threshold,
+                  VertexSums& sums) {
     using namespace std;
     rave::Point3D sum_momentum(0,0,0);
-    double sum_energy = 0;
-    for (const auto& wt_trk: vx.weightedTracks()) {
+    sums.n_tracks = 0;
+    sums.energy = 0;
+    sums.tracks.clear();
+    // the weighted tracks are asked for once, not once per sum
+    const auto weighted_tracks = vx.weightedTracks();
+    sums.tracks.reserve(weighted_tracks.size());
+    for (const auto& wt_trk: weighted_tracks) {
+      auto* cand = static_cast<Candidate*>(wt_trk.second.originalObject());
+      sums.tracks.emplace_back(wt_trk.first, cand);
       if (wt_trk.first > threshold) {
         const rave::Vector3D& mom = wt_trk.second.momentum();
+        sums.n_tracks++;
         sum_momentum += mom;
-        sum_energy += sqrt(mom.mag2() + pow(M_PION,2));
+        sums.energy += sqrt(mom.mag2() + M_PION2);
       }
     }
-    return sqrt(pow(sum_energy,2) - sum_momentum.mag2() );
-  }
-  WeightedTracks delphes_tracks(const rave::Vertex& vx) {
-    WeightedTracks out;
-    for (const auto& tkpair: vx.weightedTracks()) {
-      auto* cand = static_cast<Candidate*>(tkpair.second.originalObject());
-      out.emplace_back(tkpair.first, cand);
-    }
-    return out;
+    sums.mass = sqrt(pow(sums.energy,2) - sum_momentum.mag2() );
   }
-  std::vector<SecondaryVertexTrack> get_tracks_along_jet(
+  void add_tracks_along_jet(std::vector<SecondaryVertexTrack>& sv_trk,
     const WeightedTracks& delphes_tracks,
     const TVector3& jet, double threshold){
-    std::vector<SecondaryVertexTrack> sv_trk;
     for (const auto& wt_trk: delphes_tracks) {
       if (wt_trk.first < threshold) continue;
       const auto& trk = wt_trk.second;
@@ -654,7 +828,6 @@ namespace {
       track.delphes_track = trk;
       sv_trk.push_back(track);
     }
-    return sv_trk;
   }
 
   std::ostream& operator<<(std::ostream& os, const SecondaryVertex& vx){
@@ -786,8 +959,8 @@ void SecondaryVertexTagging::Process() {
   {
     SecondaryVertex test;
     test.Lxy = -1;
-    test.config = "zork";
-    jet->secondaryVertices.push_back(test);
+    test.config = SecondaryVertexConfig::zork;
+    jet->NewFlavorTagging()->secondaryVertices.push_back(test);
   }
 }
 void SecondaryVertexTagging::Finish() {}
@@ -28,8 +28,10 @@
  */
 
 #include "classes/DelphesModule.h"
+#include "classes/DelphesEtaPhiGrid.h"
 
 #include <vector>
+#include <string>
 #include <utility>
 #ifndef __CINT__
 #include <unordered_map>
@@ -38,7 +40,6 @@
 class TObjArray;
 class Candidate;
 namespace rave {
-  class ConstantMagneticField;
   class VertexFactory;
   class Vertex;
   class FlavorTagFactory;
@@ -46,6 +47,7 @@ namespace rave {
   class Track;
 }
 class RaveConverter;
+class RaveContext;
 
 struct SortedTracks {
   std::vector<std::pair<double, Candidate*> > first;
@@ -53,6 +55,9 @@ struct SortedTracks {
   std::vector<Candidate*> all; // both vertices, include low pt
 };
 
+// inputs and results of the fits for one jet
+struct JetFit;
+
 class SecondaryVertexTagging: public DelphesModule
 {
 public:
@@ -74,25 +79,49 @@ private:
   double fPrimaryVertexCompatibility;
   double fHLSecVxCompatibility;
   double fMidLevelSecVxCompatibility;
+  double fFitTrackIPSigMin;
+  size_t fMaxFitTracks;
+  bool fJetAxisSeed;
+  // only jets passing these are fitted, the others get no tagging block
+  double fJetPtMin;
+  double fJetAbsEtaMax;
+  bool fUseJetTracks;
+  double fJetTimeBudget;
+  double fEventTimeBudget;
+  std::string fFallbackMethod;
 
   TIterator *fItTrackInputArray; //!
   TIterator *fItJetInputArray; //!
 
   const TObjArray *fTrackInputArray; //!
   const TObjArray *fJetInputArray; //!
+  // from PrimaryVertexFinder, if null we fit our own primary vertex
+  const TObjArray *fPrimaryVertexInputArray; //!
 
   TObjArray *fOutputArray; //!
 
+  const DelphesEtaPhiGrid *fTrackGrid; //!
+  std::vector<const DelphesEtaPhiGrid::Entry*> fNearbyTracks; //!
+
   std::vector<Candidate*> GetTracks(Candidate*);
-  // return a pair: first is selected tracks in the jet, second is selected
+  // fill a pair: first is selected tracks in the jet, second is selected
   // tracks not in the jet
-  SortedTracks SelectTracksInJet(
-    Candidate*, const std::unordered_map<unsigned, double>& primary_weight);
+  void SelectTracksInJet(
+    Candidate*, const std::unordered_map<unsigned, double>& primary_weight,
+    SortedTracks&);
   rave::Vertex GetPrimaryVertex();
+#ifndef __CINT__
+  std::unordered_map<unsigned, double> GetPrimaryWeights();
+#endif
   rave::Vertex getPrimaryVertex(const std::vector<rave::Track>& tracks);
+#ifndef __CINT__
+  // adds the time spent fitting to the last argument
+  void FitJet(JetFit&, rave::VertexFactory&, double&) const;
+#endif
 
-  rave::ConstantMagneticField* fMagneticField;
-  rave::VertexFactory* fVertexFactory;
+  RaveContext* fRaveContext; //!
+  // one entry per jet, kept between events to reuse the vectors
+  std::vector<JetFit>* fJetFits; //!
   RaveConverter* fRaveConverter;
   rave::FlavorTagFactory* fFlavorTagFactory;
   rave::Ellipsoid3D* fBeamspot;
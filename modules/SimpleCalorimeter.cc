@@ -31,6 +31,7 @@
 #include "classes/DelphesClasses.h"
 #include "classes/DelphesFactory.h"
 #include "classes/DelphesFormula.h"
+#include "classes/DelphesTowerHits.h"
 
 #include "ExRootAnalysis/ExRootResult.h"
 #include "ExRootAnalysis/ExRootFilter.h"
@@ -121,6 +122,8 @@ void SimpleCalorimeter::Init()
     }
   }
 
+  fTowerHits.Init(fEtaBins, fPhiBins);
+
   // read energy fractions for different particles
   param = GetParam("EnergyFraction");
   size = param.GetSize();
@@ -198,14 +201,12 @@ void SimpleCalorimeter::Process()
 
   TFractionMap::iterator itFractionMap;
 
-  vector< Double_t >::iterator itEtaBin;
-  vector< Double_t >::iterator itPhiBin;
   vector< Double_t > *phiBins;
 
-  vector< Long64_t >::iterator itTowerHits;
+  vector< Long64_t >::const_iterator itTowerHits;
 
   DelphesFactory *factory = GetFactory();
-  fTowerHits.clear();
+  fTowerHits.Clear();
   fTowerFractions.clear();
   fTrackFractions.clear();
 
@@ -230,26 +231,11 @@ void SimpleCalorimeter::Process()
 
     if(fraction < 1.0E-9) continue;
 
-    // find eta bin [1, fEtaBins.size - 1]
-    itEtaBin = lower_bound(fEtaBins.begin(), fEtaBins.end(), particlePosition.Eta());
-    if(itEtaBin == fEtaBins.begin() || itEtaBin == fEtaBins.end()) continue;
-    etaBin = distance(fEtaBins.begin(), itEtaBin);
-
-    // phi bins for given eta bin
-    phiBins = fPhiBins[etaBin];
-
-    // find phi bin [1, phiBins.size - 1]
-    itPhiBin = lower_bound(phiBins->begin(), phiBins->end(), particlePosition.Phi());
-    if(itPhiBin == phiBins->begin() || itPhiBin == phiBins->end()) continue;
-    phiBin = distance(phiBins->begin(), itPhiBin);
-
     flags = 0;
     flags |= (pdgCode == 11 || pdgCode == 22) << 1;
 
-    // make tower hit {16-bits for eta bin number, 16-bits for phi bin number, 8-bits for flags, 24-bits for particle number}
-    towerHit = (Long64_t(etaBin) << 48) | (Long64_t(phiBin) << 32) | (Long64_t(flags) << 24) | Long64_t(number);
-
-    fTowerHits.push_back(towerHit);
+    // add tower hit, if the particle is inside the calorimeter
+    fTowerHits.Add(particlePosition.Eta(), particlePosition.Phi(), flags, number);
   }
 
   // loop over all tracks
@@ -272,35 +258,20 @@ void SimpleCalorimeter::Process()
 
     fTrackFractions.push_back(fraction);
 
-    // find eta bin [1, fEtaBins.size - 1]
-    itEtaBin = lower_bound(fEtaBins.begin(), fEtaBins.end(), trackPosition.Eta());
-    if(itEtaBin == fEtaBins.begin() || itEtaBin == fEtaBins.end()) continue;
-    etaBin = distance(fEtaBins.begin(), itEtaBin);
-
-    // phi bins for given eta bin
-    phiBins = fPhiBins[etaBin];
-
-    // find phi bin [1, phiBins.size - 1]
-    itPhiBin = lower_bound(phiBins->begin(), phiBins->end(), trackPosition.Phi());
-    if(itPhiBin == phiBins->begin() || itPhiBin == phiBins->end()) continue;
-    phiBin = distance(phiBins->begin(), itPhiBin);
-
     flags = 1;
 
-    // make tower hit {16-bits for eta bin number, 16-bits for phi bin number, 8-bits for flags, 24-bits for track number}
-    towerHit = (Long64_t(etaBin) << 48) | (Long64_t(phiBin) << 32) | (Long64_t(flags) << 24) | Long64_t(number);
-
-    fTowerHits.push_back(towerHit);
+    // add tower hit, if the track is inside the calorimeter
+    fTowerHits.Add(trackPosition.Eta(), trackPosition.Phi(), flags, number);
   }
 
-  // all hits are sorted first by eta bin number, then by phi bin number,
+  // all hits are ordered first by eta bin number, then by phi bin number,
   // then by flags and then by particle or track number
-  sort(fTowerHits.begin(), fTowerHits.end());
+  const vector< Long64_t > &towerHits = fTowerHits.GetHits();
 
   // loop over all hits
   towerEtaPhi = 0;
   fTower = 0;
-  for(itTowerHits = fTowerHits.begin(); itTowerHits != fTowerHits.end(); ++itTowerHits)
+  for(itTowerHits = towerHits.begin(); itTowerHits != towerHits.end(); ++itTowerHits)
   {
     towerHit = (*itTowerHits);
     flags = (towerHit >> 24) & 0x00000000000000FFLL;
@@ -413,8 +384,8 @@ void SimpleCalorimeter::FinalizeTower()
 
   if(fSmearTowerCenter)
   {
-    eta = gRandom->Uniform(fTowerEdges[0], fTowerEdges[1]);
-    phi = gRandom->Uniform(fTowerEdges[2], fTowerEdges[3]);
+    eta = GetRandom()->Uniform(fTowerEdges[0], fTowerEdges[1]);
+    phi = GetRandom()->Uniform(fTowerEdges[2], fTowerEdges[3]);
   }
   else
   {
@@ -471,7 +442,7 @@ Double_t SimpleCalorimeter::LogNormal(Double_t mean, Double_t sigma)
     b = TMath::Sqrt(TMath::Log((1.0 + (sigma*sigma)/(mean*mean))));
     a = TMath::Log(mean) - 0.5*b*b;
 
-    return TMath::Exp(a + b*gRandom->Gaus(0.0, 1.0));
+    return TMath::Exp(a + b*GetRandom()->Gaus(0.0, 1.0));
   }
   else
   {
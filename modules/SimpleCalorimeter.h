@@ -31,6 +31,10 @@
 
 #include "classes/DelphesModule.h"
 
+#if !defined(__CINT__) && !defined(__CLING__)
+#include "classes/DelphesTowerHits.h"
+#endif
+
 #include <map>
 #include <set>
 #include <vector>
@@ -50,6 +54,8 @@ public:
   void Process();
   void Finish();
 
+  Bool_t IsThreadSafe() const { return HasRandomStream(); }
+
 private:
 
   typedef std::map< Long64_t, Double_t > TFractionMap; //!
@@ -82,7 +88,9 @@ private:
   std::vector < Double_t > fEtaBins;
   std::vector < std::vector < Double_t >* > fPhiBins;
 
-  std::vector < Long64_t > fTowerHits;
+#if !defined(__CINT__) && !defined(__CLING__)
+  DelphesTowerHits fTowerHits; //!
+#endif
 
   std::vector < Double_t > fTowerFractions;
 
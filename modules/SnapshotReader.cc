@@ -0,0 +1,182 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/** \class SnapshotReader
+ *
+ *  Reads back the arrays saved by PremixedPileUpWriter for a truncated
+ *  ExecutionPath.
+ *
+ */
+
+#include "modules/SnapshotReader.h"
+
+#include "classes/DelphesClasses.h"
+#include "classes/DelphesFactory.h"
+
+#include "ExRootAnalysis/ExRootConfReader.h"
+
+#include "TFile.h"
+#include "TTree.h"
+#include "TString.h"
+#include "TObjArray.h"
+#include "TClonesArray.h"
+
+#include <stdexcept>
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+
+SnapshotReader::SnapshotReader() :
+  fFile(0), fTree(0), fCandidates(0), fEntry(0), fAllEntries(0),
+  fReferenceOffsets(0), fReferences(0)
+{
+}
+
+//------------------------------------------------------------------------------
+
+SnapshotReader::~SnapshotReader()
+{
+}
+
+//------------------------------------------------------------------------------
+
+void SnapshotReader::Init()
+{
+  stringstream message;
+  const char *fileName;
+  TString name, path, module;
+  ExRootConfParam param;
+  Long_t i, size;
+  Ssiz_t slash;
+
+  fileName = GetString("InputFile", "snapshot.root");
+
+  fFile = TFile::Open(fileName);
+  if(!fFile || fFile->IsZombie())
+  {
+    message << "can't open snapshot file " << fileName;
+    throw runtime_error(message.str());
+  }
+
+  fFile->GetObject("PremixedPileUp", fTree);
+  if(!fTree)
+  {
+    message << "no saved events in snapshot file " << fileName;
+    throw runtime_error(message.str());
+  }
+
+  fAllEntries = fTree->GetEntries();
+  fEntry = 0;
+
+  fCandidates = new TClonesArray("Candidate");
+  fTree->SetBranchAddress("Candidate", &fCandidates);
+  fTree->SetBranchAddress("ReferenceOffsets", &fReferenceOffsets);
+  fTree->SetBranchAddress("References", &fReferences);
+
+  // pairs of an array of the snapshot and of the module/array it replaces
+  param = GetParam("OutputArray");
+  size = param.GetSize();
+
+  fArrayNumbers.assign(size/2, 0);
+  fOutputArrays.clear();
+
+  for(i = 0; i < size/2; ++i)
+  {
+    name = param[i*2].GetString();
+    if(!fTree->GetBranch(name))
+    {
+      message << "no array '" << name << "' in snapshot file " << fileName;
+      throw runtime_error(message.str());
+    }
+    fTree->SetBranchAddress(name, &fArrayNumbers[i]);
+
+    path = param[i*2 + 1].GetString();
+    slash = path.Last('/');
+    if(slash <= 0 || slash == path.Length() - 1)
+    {
+      message << "output array '" << path << "' of module '" << GetName();
+      message << "' must be given as module/array";
+      throw runtime_error(message.str());
+    }
+    name = path(slash + 1, path.Length() - slash - 1);
+    module = path(0, slash);
+    fOutputArrays.push_back(ExportArray(name, module));
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void SnapshotReader::Finish()
+{
+  if(fFile) delete fFile;
+  if(fCandidates) delete fCandidates;
+}
+
+//------------------------------------------------------------------------------
+
+void SnapshotReader::Process()
+{
+  stringstream message;
+  Candidate *candidate;
+  DelphesFactory *factory;
+  Int_t i, j, k, n;
+
+  if(fEntry >= fAllEntries)
+  {
+    message << "snapshot file of module '" << GetName() << "' has only ";
+    message << fAllEntries << " events";
+    throw runtime_error(message.str());
+  }
+
+  fTree->GetEntry(fEntry);
+  ++fEntry;
+
+  factory = GetFactory();
+
+  n = fCandidates->GetEntriesFast();
+  fRead.resize(n);
+
+  for(i = 0; i < n; ++i)
+  {
+    candidate = factory->NewCandidate();
+    static_cast<Candidate *>(fCandidates->UncheckedAt(i))->Copy(*candidate);
+    fRead[i] = candidate;
+  }
+
+  for(i = 0; i < n; ++i)
+  {
+    for(j = (*fReferenceOffsets)[i]; j < (*fReferenceOffsets)[i + 1]; ++j)
+    {
+      fRead[i]->AddCandidate(fRead[(*fReferences)[j]]);
+    }
+  }
+
+  for(k = 0; k < Int_t(fArrayNumbers.size()); ++k)
+  {
+    for(i = 0; i < Int_t(fArrayNumbers[k]->size()); ++i)
+    {
+      fOutputArrays[k]->Add(fRead[(*fArrayNumbers[k])[i]]);
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
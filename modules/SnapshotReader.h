@@ -0,0 +1,99 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SnapshotReader_h
+#define SnapshotReader_h
+
+/** \class SnapshotReader
+ *
+ *  Reads back the arrays saved by PremixedPileUpWriter at some point of
+ *  the ExecutionPath, so that a card truncated before that point can run
+ *  only the modules after it, to try other settings of the jets or of the
+ *  tagging without running the propagation and the calorimeters again.
+ *
+ *  The entries of the InputFile are read in order, one per event, and the
+ *  input of the job must be the one the snapshot was made from, for the
+ *  generated particles and the event header. OutputArray gives pairs of
+ *  a name in the snapshot and of the array it is exported as, with the
+ *  name of the module that made it, such as Calorimeter/towers, so that
+ *  the modules after it import it unchanged. Candidates found in several
+ *  arrays, or referenced by other candidates, are read only once and stay
+ *  shared as they were. The modules of the original card whose arrays are
+ *  read must not be in the truncated card.
+ *
+ *  With the CMS card, a PremixedPileUpWriter placed after EFlowMerger with
+ *
+ *    add InputArray Calorimeter/eflowTracks eflowTracks
+ *    add InputArray Calorimeter/towers towers
+ *    add InputArray EFlowMerger/eflow eflow
+ *
+ *  is read back at the start of the truncated ExecutionPath with
+ *
+ *    add OutputArray eflowTracks Calorimeter/eflowTracks
+ *    add OutputArray towers Calorimeter/towers
+ *    add OutputArray eflow EFlowMerger/eflow
+ *
+ */
+
+#include "classes/DelphesModule.h"
+
+#if !defined(__CINT__) && !defined(__CLING__)
+#include <vector>
+#endif
+
+class TObjArray;
+class TClonesArray;
+class TFile;
+class TTree;
+
+class Candidate;
+
+class SnapshotReader: public DelphesModule
+{
+public:
+
+  SnapshotReader();
+  ~SnapshotReader();
+
+  void Init();
+  void Process();
+  void Finish();
+
+private:
+
+  TFile *fFile; //!
+  TTree *fTree; //!
+
+  TClonesArray *fCandidates; //!
+
+  Long64_t fEntry, fAllEntries; //!
+
+#if !defined(__CINT__) && !defined(__CLING__)
+  std::vector< Int_t > *fReferenceOffsets; //!
+  std::vector< Int_t > *fReferences; //!
+
+  std::vector< std::vector< Int_t > * > fArrayNumbers; //!
+  std::vector< TObjArray * > fOutputArrays; //!
+
+  std::vector< Candidate * > fRead; //!
+#endif
+
+  ClassDef(SnapshotReader, 1)
+};
+
+#endif
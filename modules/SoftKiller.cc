@@ -0,0 +1,142 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/** \class SoftKiller
+ *
+ *  Removes the soft pile-up particles with the SoftKiller method
+ *  (M. Cacciari, G. P. Salam, G. Soyez, arXiv:1407.0408): the pt cut is
+ *  the median over a rapidity-phi grid of the hardest particle per cell.
+ *  The surviving candidates are passed on unchanged, so the output array
+ *  can be used as the FastJetFinder input.
+ *
+ *  \author M. Selvaggi - UCL, Louvain-la-Neuve
+ *
+ */
+
+#include "modules/SoftKiller.h"
+
+#include "classes/DelphesClasses.h"
+#include "classes/DelphesFactory.h"
+
+#include "TObjArray.h"
+#include "TLorentzVector.h"
+
+#include <stdexcept>
+#include <vector>
+
+#include "fastjet/PseudoJet.hh"
+#include "fastjet/contribs/SoftKiller/SoftKiller.hh"
+
+using namespace std;
+using namespace fastjet;
+
+//------------------------------------------------------------------------------
+
+SoftKiller::SoftKiller() :
+  fSoftKiller(0), fInputList(0), fOutputList(0), fItInputArray(0)
+{
+
+}
+
+//------------------------------------------------------------------------------
+
+SoftKiller::~SoftKiller()
+{
+
+}
+
+//------------------------------------------------------------------------------
+
+void SoftKiller::Init()
+{
+  fRapMax = GetDouble("RapMax", 4.0);
+  fGridSize = GetDouble("GridSize", 0.4);
+
+  if(fRapMax <= 0.0 || fGridSize <= 0.0)
+  {
+    throw runtime_error("RapMax and GridSize must be positive");
+  }
+
+  fSoftKiller = new contrib::SoftKiller(fRapMax, fGridSize);
+
+  fInputList = new vector< PseudoJet >;
+  fOutputList = new vector< PseudoJet >;
+
+  // import input array
+
+  fInputArray = ImportArray(GetString("InputArray", "EFlowMerger/eflow"));
+  fItInputArray = fInputArray->MakeIterator();
+
+  // create output arrays
+
+  fOutputArray = ExportArray(GetString("OutputArray", "eflow"));
+  fThresholdOutputArray = ExportArray(GetString("ThresholdOutputArray", "threshold"));
+}
+
+//------------------------------------------------------------------------------
+
+void SoftKiller::Finish()
+{
+  if(fItInputArray) delete fItInputArray;
+  if(fOutputList) delete fOutputList;
+  if(fInputList) delete fInputList;
+  if(fSoftKiller) delete fSoftKiller;
+}
+
+//------------------------------------------------------------------------------
+
+void SoftKiller::Process()
+{
+  Candidate *candidate;
+  Int_t number;
+  Double_t threshold;
+  vector< PseudoJet > &inputList = *fInputList;
+  vector< PseudoJet > &outputList = *fOutputList;
+  vector< PseudoJet >::const_iterator itOutputList;
+
+  DelphesFactory *factory = GetFactory();
+
+  inputList.clear();
+  inputList.reserve(fInputArray->GetEntriesFast());
+
+  fItInputArray->Reset();
+  number = 0;
+  while((candidate = static_cast<Candidate*>(fItInputArray->Next())))
+  {
+    const TLorentzVector &candidateMomentum = candidate->Momentum;
+    inputList.push_back(PseudoJet(candidateMomentum.Px(), candidateMomentum.Py(), candidateMomentum.Pz(), candidateMomentum.E()));
+    inputList.back().set_user_index(number);
+    ++number;
+  }
+
+  // the cut is the median over the cells of the hardest pt in each cell
+
+  outputList.clear();
+  fSoftKiller->apply(inputList, outputList, threshold);
+
+  // the survivors keep the input order
+  for(itOutputList = outputList.begin(); itOutputList != outputList.end(); ++itOutputList)
+  {
+    fOutputArray->Add(fInputArray->At(itOutputList->user_index()));
+  }
+
+  candidate = factory->NewCandidate();
+  candidate->Momentum.SetPtEtaPhiE(threshold, 0.0, 0.0, threshold);
+  fThresholdOutputArray->Add(candidate);
+}
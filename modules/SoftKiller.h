@@ -0,0 +1,82 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SoftKiller_h
+#define SoftKiller_h
+
+/** \class SoftKiller
+ *
+ *  Removes the soft pile-up particles with the SoftKiller method
+ *  (M. Cacciari, G. P. Salam, G. Soyez, arXiv:1407.0408): the pt cut is
+ *  the median over a rapidity-phi grid of the hardest particle per cell.
+ *  The surviving candidates are passed on unchanged, so the output array
+ *  can be used as the FastJetFinder input.
+ *
+ *  \author M. Selvaggi - UCL, Louvain-la-Neuve
+ *
+ */
+
+#include "classes/DelphesModule.h"
+
+#include <vector>
+
+class TObjArray;
+class TIterator;
+
+namespace fastjet {
+  class PseudoJet;
+  namespace contrib {
+    class SoftKiller;
+  }
+}
+
+class SoftKiller: public DelphesModule
+{
+public:
+
+  SoftKiller();
+  ~SoftKiller();
+
+  void Init();
+  void Process();
+  void Finish();
+
+  Bool_t IsThreadSafe() const { return kTRUE; }
+
+private:
+
+  Double_t fRapMax;
+  Double_t fGridSize;
+
+  fastjet::contrib::SoftKiller *fSoftKiller; //!
+
+  // the storage is kept between events
+  std::vector< fastjet::PseudoJet > *fInputList; //!
+  std::vector< fastjet::PseudoJet > *fOutputList; //!
+
+  TIterator *fItInputArray; //!
+
+  const TObjArray *fInputArray; //!
+
+  TObjArray *fOutputArray; //!
+  TObjArray *fThresholdOutputArray; //!
+
+  ClassDef(SoftKiller, 1)
+};
+
+#endif
@@ -49,6 +49,8 @@ public:
   void Process();
   void Finish();
 
+  Bool_t IsThreadSafe() const { return kTRUE; }
+
 private:
 
   Double_t fPTMin; //!
@@ -32,6 +32,7 @@
 #include "classes/DelphesClasses.h"
 #include "classes/DelphesFactory.h"
 #include "classes/DelphesFormula.h"
+#include "classes/DelphesEtaPhiGrid.h"
 
 #include "TMath.h"
 #include "TString.h"
@@ -50,62 +51,69 @@ using namespace std;
 
 
 //------------------------------------------------------------------------------
-TauTaggingPartonClassifier::TauTaggingPartonClassifier(const TObjArray *array) :
-  fParticleInputArray(array)
-{
-}
 
-//------------------------------------------------------------------------------
-
-Int_t TauTaggingPartonClassifier::GetCategory(TObject *object)
+Bool_t TauTagging::IsHadronicTau(const Candidate *tau, const TObjArray *particles, TLorentzVector *visible)
 {
-  Candidate *tau = static_cast<Candidate *>(object);
   Candidate *daughter1 = 0;
   Candidate *daughter2 = 0;
-  
-  const TLorentzVector &momentum = tau->Momentum;
   Int_t pdgCode, i, j;
 
-  pdgCode = TMath::Abs(tau->PID);
-  if(pdgCode != 15) return -1;
-
-  if(momentum.Pt() <= fPTMin || TMath::Abs(momentum.Eta()) > fEtaMax) return -1;
-
-  if(tau->D1 < 0) return -1;
+  if(tau->D1 < 0) return kFALSE;
 
-  if(tau->D2 < tau->D1) return -1;
+  if(tau->D2 < tau->D1) return kFALSE;
 
-  if(tau->D1 >= fParticleInputArray->GetEntriesFast() ||
-     tau->D2 >= fParticleInputArray->GetEntriesFast())
+  if(tau->D1 >= particles->GetEntriesFast() ||
+     tau->D2 >= particles->GetEntriesFast())
   {
     throw runtime_error("tau's daughter index is greater than the ParticleInputArray size");
   }
 
   for(i = tau->D1; i <= tau->D2; ++i)
   {
-    daughter1 = static_cast<Candidate *>(fParticleInputArray->At(i));
+    daughter1 = static_cast<Candidate *>(particles->At(i));
     pdgCode = TMath::Abs(daughter1->PID);
-    if(pdgCode == 11 || pdgCode == 13 || pdgCode == 15) return -1;
+    if(pdgCode == 11 || pdgCode == 13 || pdgCode == 15) return kFALSE;
     else if(pdgCode == 24)
     {
-     if(daughter1->D1 < 0) return -1;
+     if(daughter1->D1 < 0) return kFALSE;
      for(j = daughter1->D1; j <= daughter1->D2; ++j)
      {
-       daughter2 = static_cast<Candidate*>(fParticleInputArray->At(j));
+       daughter2 = static_cast<Candidate*>(particles->At(j));
        pdgCode = TMath::Abs(daughter2->PID);
-       if(pdgCode == 11 || pdgCode == 13) return -1;
+       if(pdgCode == 11 || pdgCode == 13) return kFALSE;
      }
-	
     }
+    if(visible && TMath::Abs(daughter1->PID) != 16) *visible += daughter1->Momentum;
   }
 
-  return 0;
+  return kTRUE;
+}
+
+//------------------------------------------------------------------------------
+
+TauTaggingPartonClassifier::TauTaggingPartonClassifier(const TObjArray *array) :
+  fParticleInputArray(array)
+{
+}
+
+//------------------------------------------------------------------------------
+
+Int_t TauTaggingPartonClassifier::GetCategory(TObject *object)
+{
+  Candidate *tau = static_cast<Candidate *>(object);
+
+  const TLorentzVector &momentum = tau->Momentum;
+
+  if(TMath::Abs(tau->PID) != 15) return -1;
+
+  if(momentum.Pt() <= fPTMin || TMath::Abs(momentum.Eta()) > fEtaMax) return -1;
+
+  return TauTagging::IsHadronicTau(tau, fParticleInputArray) ? 0 : -1;
 }
 
 //------------------------------------------------------------------------------
 
 TauTagging::TauTagging() :
-  fClassifier(0), fFilter(0),
   fItPartonInputArray(0), fItJetInputArray(0)
 {
 }
@@ -154,16 +162,13 @@ void TauTagging::Init()
 
   fParticleInputArray = ImportArray(GetString("ParticleInputArray", "Delphes/allParticles"));
 
-  fClassifier = new TauTaggingPartonClassifier(fParticleInputArray);
-  fClassifier->fPTMin = GetDouble("TauPTMin", 1.0);
-  fClassifier->fEtaMax = GetDouble("TauEtaMax", 2.5);
+  fTauPTMin = GetDouble("TauPTMin", 1.0);
+  fTauEtaMax = GetDouble("TauEtaMax", 2.5);
 
   fPartonInputArray = ImportArray(GetString("PartonInputArray", "Delphes/partons"));
   fItPartonInputArray = fPartonInputArray->MakeIterator();
 
-  fFilter = new ExRootFilter(fPartonInputArray);
-
-  fJetInputArray = ImportArray(GetString("JetInputArray", "FastJetFinder/jets"));
+  fJetInputArray = UpdateArray(GetString("JetInputArray", "FastJetFinder/jets"));
   fItJetInputArray = fJetInputArray->MakeIterator();
 }
 
@@ -174,8 +179,6 @@ void TauTagging::Finish()
   map< Int_t, DelphesFormula * >::iterator itEfficiencyMap;
   DelphesFormula *formula;
 
-  if(fFilter) delete fFilter;
-  if(fClassifier) delete fClassifier;
   if(fItJetInputArray) delete fItJetInputArray;
   if(fItPartonInputArray) delete fItPartonInputArray;
 
@@ -190,58 +193,69 @@ void TauTagging::Finish()
 
 void TauTagging::Process()
 {
-  Candidate *jet, *tau, *daughter;
+  Candidate *jet, *tau;
   TLorentzVector tauMomentum;
   Double_t pt, eta, phi;
-  TObjArray *tauArray;
   map< Int_t, DelphesFormula * >::iterator itEfficiencyMap;
+  vector< const DelphesEtaPhiGrid::Entry * >::const_iterator itJets;
+  VisibleTau visibleTau;
   DelphesFormula *formula;
   Int_t pdgCode, charge, i;
 
-  // select taus
-  fFilter->Reset();
-  tauArray = fFilter->GetSubArray(fClassifier, 0);
+  // classify every tau and sum its visible decay products in one walk
+  fTaus.clear();
+  fItPartonInputArray->Reset();
+  while((tau = static_cast<Candidate *>(fItPartonInputArray->Next())))
+  {
+    if(TMath::Abs(tau->PID) != 15) continue;
+
+    const TLorentzVector &momentum = tau->Momentum;
+    if(momentum.Pt() <= fTauPTMin || TMath::Abs(momentum.Eta()) > fTauEtaMax) continue;
+
+    tauMomentum.SetPxPyPzE(0.0, 0.0, 0.0, 0.0);
+    if(!IsHadronicTau(tau, fParticleInputArray, &tauMomentum)) continue;
+
+    visibleTau.eta = tauMomentum.Eta();
+    visibleTau.phi = tauMomentum.Phi();
+    visibleTau.charge = tau->Charge;
+    fTaus.push_back(visibleTau);
+  }
+
+  // tau matched to every jet, the jets near a tau come from the eta-phi
+  // index of the jets shared with the other modules, a later tau wins
+  fJetTaus.assign(fJetInputArray->GetEntriesFast(), -1);
+  if(!fTaus.empty())
+  {
+    const DelphesEtaPhiGrid &grid = GetFactory()->GetEtaPhiGrid(fJetInputArray);
+    for(i = 0; i < Int_t(fTaus.size()); ++i)
+    {
+      grid.Find(fTaus[i].eta, fTaus[i].phi, fDeltaR, fNearbyJets);
+      for(itJets = fNearbyJets.begin(); itJets != fNearbyJets.end(); ++itJets)
+      {
+        fJetTaus[(*itJets)->index] = i;
+      }
+    }
+  }
 
   // loop over all input jets
+  i = 0;
   fItJetInputArray->Reset();
   while((jet = static_cast<Candidate *>(fItJetInputArray->Next())))
   {
     const TLorentzVector &jetMomentum = jet->Momentum;
     pdgCode = 0;
-    charge = gRandom->Uniform() > 0.5 ? 1 : -1;
+    charge = GetRandom()->Uniform() > 0.5 ? 1 : -1;
     eta = jetMomentum.Eta();
     phi = jetMomentum.Phi();
     pt = jetMomentum.Pt();
 
-    // loop over all input taus
-    if(tauArray){
-      TIter itTauArray(tauArray);
-      while((tau = static_cast<Candidate *>(itTauArray.Next())))
-      {
-        if(tau->D1 < 0) continue;
-
-        if(tau->D1 >= fParticleInputArray->GetEntriesFast() ||
-           tau->D2 >= fParticleInputArray->GetEntriesFast())
-        {
-          throw runtime_error("tau's daughter index is greater than the ParticleInputArray size");
-        }
-
-        tauMomentum.SetPxPyPzE(0.0, 0.0, 0.0, 0.0);
-
-        for(i = tau->D1; i <= tau->D2; ++i)
-        {
-          daughter = static_cast<Candidate *>(fParticleInputArray->At(i));
-          if(TMath::Abs(daughter->PID) == 16) continue;
-          tauMomentum += daughter->Momentum;
-        }
-
-        if(jetMomentum.DeltaR(tauMomentum) <= fDeltaR)
-        {
-          pdgCode = 15;
-          charge = tau->Charge;
-        }
-      }
+    if(fJetTaus[i] >= 0)
+    {
+      pdgCode = 15;
+      charge = fTaus[fJetTaus[i]].charge;
     }
+    ++i;
+
     // find an efficency formula
     itEfficiencyMap = fEfficiencyMap.find(pdgCode);
     if(itEfficiencyMap == fEfficiencyMap.end())
@@ -251,7 +265,7 @@ void TauTagging::Process()
     formula = itEfficiencyMap->second;
 
     // apply an efficency formula
-    jet->TauTag = gRandom->Uniform() <= formula->Eval(pt, eta);
+    jet->TauTag = GetRandom()->Uniform() <= formula->Eval(pt, eta);
     // set tau charge
     jet->Charge = charge;
   }
@@ -30,13 +30,17 @@
  */
 
 #include "classes/DelphesModule.h"
+#include "classes/DelphesEtaPhiGrid.h"
 #include "ExRootAnalysis/ExRootResult.h"
 #include "ExRootAnalysis/ExRootFilter.h"
 #include "ExRootAnalysis/ExRootClassifier.h"
 
 #include <map>
+#include <vector>
 
 class TObjArray;
+class TLorentzVector;
+class Candidate;
 class DelphesFormula;
 
 class ExRootFilter;
@@ -53,17 +57,34 @@ public:
   void Process();
   void Finish();
 
+  Bool_t IsThreadSafe() const { return HasRandomStream(); }
+
+  // walks the daughters of a tau once, returns false for the leptonic
+  // decays and otherwise adds the visible daughters to the momentum
+  static Bool_t IsHadronicTau(const Candidate *tau, const TObjArray *particles, TLorentzVector *visible = 0);
+
 private:
 
   Double_t fDeltaR;
 
+  Double_t fTauPTMin, fTauEtaMax;
+
 #if !defined(__CINT__) && !defined(__CLING__)
+  struct VisibleTau
+  {
+    Double_t eta, phi;
+    Int_t charge;
+  };
+
   std::map< Int_t, DelphesFormula * > fEfficiencyMap; //!
+
+  // visible decay products of the hadronic taus of the event
+  std::vector< VisibleTau > fTaus; //!
+
+  // tau matched to every jet, -1 for none, and the jets near a tau
+  std::vector< Int_t > fJetTaus; //!
+  std::vector< const DelphesEtaPhiGrid::Entry * > fNearbyJets; //!
 #endif
-  
-  TauTaggingPartonClassifier *fClassifier; //!
-  
-  ExRootFilter *fFilter;
 
   TIterator *fItPartonInputArray; //!
   
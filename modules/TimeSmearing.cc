@@ -102,7 +102,7 @@ void TimeSmearing::Process()
     t = candidatePosition.T()*1.0E-3/c_light;
 
     // apply smearing formula
-    t = gRandom->Gaus(t, fTimeResolution);
+    t = Gaus(t, fTimeResolution);
 
     mother = candidate;
     candidate = static_cast<Candidate*>(candidate->Clone());
@@ -67,6 +67,9 @@ void TrackBasedBTagging::Init()
   fDeltaR = GetDouble("DeltaR", 0.3);
   fIPmax = GetDouble("TrackIPMax", 2.0);
 
+  // see JetTrackAssociator.h
+  fUseJetTracks = GetBool("UseJetTracks", false);
+
   // import input array(s)
 
   fTrackInputArray = ImportArray(GetString("TrackInputArray", "Calorimeter/eflowTracks"));
@@ -88,38 +91,38 @@ void TrackBasedBTagging::Finish()
 
 void TrackBasedBTagging::Process()
 {
+  // significances of the tracks near the jets (or of the ones already in
+  // the jets), shared with the other taggers of the event
+  const DelphesImpactParameters::Table &table = GetFactory()->GetImpactParameters(
+    fJetInputArray, fUseJetTracks ? 0 : fTrackInputArray, fDeltaR);
 
   // loop over all input jets
-  fItJetInputArray->Reset();
-  Candidate* jet;
-  while((jet = static_cast<Candidate*>(fItJetInputArray->Next())))
+  TrackParameterBlock trk_pars;
+  std::vector<float> ip, ip_sig;
+  for(Int_t i = 0; i < fJetInputArray->GetEntriesFast(); ++i)
   {
+    Candidate* jet = static_cast<Candidate*>(fJetInputArray->UncheckedAt(i));
     const TLorentzVector &jetMomentum = jet->Momentum;
 
-    std::vector<TrackParameters> trk_pars;
-    if (jet->GetTracks()->GetEntriesFast() > 0) {
+    if (!fUseJetTracks && jet->GetTracks()->GetEntriesFast() > 0) {
       throw std::logic_error("tried to add traks to a jet twice");
     }
-    // loop over all input tracks
-    fItTrackInputArray->Reset();
-    Candidate* track;
-    while((track = static_cast<Candidate*>(fItTrackInputArray->Next())))
+    trk_pars.clear();
+    ip.clear();
+    ip_sig.clear();
+    for(Int_t k = table.first[i]; k < table.first[i + 1]; ++k)
     {
-      const TLorentzVector &trkMomentum = track->Momentum;
-
-      double dr = jetMomentum.DeltaR(trkMomentum);
-      double tpt = trkMomentum.Pt();
-      double dxy = std::abs(track->Dxy);
+      if(table.pt[k] < fPtMin) continue;
+      if(table.dxy[k] > fIPmax) continue;
 
-      if(tpt < fPtMin) continue;
-      if(dr > fDeltaR) continue;
-      if(dxy > fIPmax) continue;
-      trk_pars.emplace_back(track->trkPar, track->trkCov);
+      Candidate* track = table.tracks[k];
+      trk_pars.push_back(track->trkPar, track->trkCov);
+      ip.push_back(table.d0[k]);
+      ip_sig.push_back(table.d0Sig[k]);
       // std::cout << trk_pars.back() << std::endl;
-      jet->AddTrack(track);
+      if (!fUseJetTracks) jet->AddTrack(track);
     }
-    jet->hlTrk.fill(jetMomentum.Vect(), trk_pars);
-    // std::cout << jet->hlTrk << std::endl;
+    jet->NewFlavorTagging()->hlTrk.fill(jetMomentum.Vect(), trk_pars, ip, ip_sig);
 
   }
 }
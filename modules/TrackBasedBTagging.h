@@ -50,6 +50,8 @@ private:
   Double_t fDeltaR;
   Double_t fIPmax;
 
+  Bool_t fUseJetTracks;
+
   TIterator *fItTrackInputArray; //!
   TIterator *fItJetInputArray; //!
 
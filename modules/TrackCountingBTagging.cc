@@ -71,6 +71,9 @@ void TrackCountingBTagging::Init()
   fSigMin = GetDouble("SigMin", 6.5);
   fNtracks = GetInt("Ntracks", 3);
 
+  // see JetTrackAssociator.h
+  fUseJetTracks = GetBool("UseJetTracks", false);
+
   // import input array(s)
 
   fTrackInputArray = ImportArray(GetString("TrackInputArray", "Calorimeter/eflowTracks"));
@@ -92,52 +95,26 @@ void TrackCountingBTagging::Finish()
 
 void TrackCountingBTagging::Process()
 {
-  Candidate *jet, *track;
-
-  Double_t jpx, jpy;
-  Double_t dr, tpx, tpy, tpt;
-  Double_t xd, yd, dxy, ddxy, ip, sip;
-
-  Int_t sign;
+  Candidate *jet;
+  Int_t i, k, count;
 
-  Int_t count;
+  // significances of the tracks near the jets (or of the ones already in
+  // the jets), shared with the other taggers of the event
+  const DelphesImpactParameters::Table &table = GetFactory()->GetImpactParameters(
+    fJetInputArray, fUseJetTracks ? 0 : fTrackInputArray, fDeltaR);
 
   // loop over all input jets
-  fItJetInputArray->Reset();
-  while((jet = static_cast<Candidate*>(fItJetInputArray->Next())))
+  for(i = 0; i < fJetInputArray->GetEntriesFast(); ++i)
   {
-    const TLorentzVector &jetMomentum = jet->Momentum;
-    jpx = jetMomentum.Px();
-    jpy = jetMomentum.Py();
+    jet = static_cast<Candidate*>(fJetInputArray->UncheckedAt(i));
 
-    // loop over all input tracks
-    fItTrackInputArray->Reset();
     count = 0;
-    while((track = static_cast<Candidate*>(fItTrackInputArray->Next())))
+    for(k = table.first[i]; k < table.first[i + 1]; ++k)
     {
-      const TLorentzVector &trkMomentum = track->Momentum;
-
-      dr = jetMomentum.DeltaR(trkMomentum);
-
-      tpt = trkMomentum.Pt();
-      tpx = trkMomentum.Px();
-      tpy = trkMomentum.Py();
-
-      xd = track->Xd;
-      yd = track->Yd;
-      dxy = TMath::Abs(track->Dxy);
-      ddxy = track->SDxy;
-
-      if(tpt < fPtMin) continue;
-      if(dr > fDeltaR) continue;
-      if(dxy > fIPmax) continue;
-
-      sign = (jpx*xd + jpy*yd > 0.0) ? 1 : -1;
-
-      ip = sign*dxy;
-      sip = ip / TMath::Abs(ddxy);
+      if(table.pt[k] < fPtMin) continue;
+      if(table.dxy[k] > fIPmax) continue;
 
-      if(sip > fSigMin) count++;
+      if(table.dxySig[k] > fSigMin) ++count;
     }
 
     // set BTag flag to true if count >= Ntracks
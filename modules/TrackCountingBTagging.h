@@ -54,6 +54,8 @@ private:
   Double_t fSigMin;
   Int_t    fNtracks;
 
+  Bool_t fUseJetTracks;
+
   TIterator *fItTrackInputArray; //!
   TIterator *fItJetInputArray; //!
 
@@ -74,6 +74,9 @@ void TrackPileUpSubtractor::Init()
   fZVertexResolution  = GetDouble("ZVertexResolution", 0.005)*1.0E3;
 
   fPTMin = GetDouble("PTMin", 0.);
+
+  // decide once per vertex of PileUpMerger instead of with the z of every track
+  fUseVertexIndex = GetBool("UseVertexIndex", false);
   // import arrays with output from other modules
    
   ExRootConfParam param = GetParam("InputArray");
@@ -84,7 +87,7 @@ void TrackPileUpSubtractor::Init()
   size = param.GetSize();
   for(i = 0; i < size/2; ++i)
   {
-    array = ImportArray(param[i*2].GetString());
+    array = UpdateArray(param[i*2].GetString());
     iterator = array->MakeIterator();
 
     fInputMap[iterator] = ExportArray(param[i*2 + 1].GetString());
@@ -117,6 +120,8 @@ void TrackPileUpSubtractor::Process()
   TIterator *iterator;
   TObjArray *array;
   Double_t z, zvtx=0;
+  Int_t index;
+  Bool_t removed;
 
   
   // find z position of primary vertex
@@ -131,6 +136,19 @@ void TrackPileUpSubtractor::Process()
     }
   }
 
+  if(fUseVertexIndex)
+  {
+    fRemoved.clear();
+    fItVertexInputArray->Reset();
+    while((candidate = static_cast<Candidate*>(fItVertexInputArray->Next())))
+    {
+      index = candidate->VertexIndex;
+      if(index < 0) continue;
+      if(index >= Int_t(fRemoved.size())) fRemoved.resize(index + 1, kFALSE);
+      fRemoved[index] = candidate->IsPU && TMath::Abs(candidate->Position.Z()-zvtx) > fZVertexResolution;
+    }
+  }
+
   // loop over all input arrays
   for(itInputMap = fInputMap.begin(); itInputMap != fInputMap.end(); ++itInputMap)
   {
@@ -141,13 +159,27 @@ void TrackPileUpSubtractor::Process()
     iterator->Reset();
     while((candidate = static_cast<Candidate*>(iterator->Next())))
     {
-      particle = static_cast<Candidate*>(candidate->GetCandidates()->At(0));
-      z = particle->Position.Z();
-      
+      if(fUseVertexIndex)
+      {
+        index = candidate->VertexIndex;
+        removed = index >= 0 && index < Int_t(fRemoved.size()) && fRemoved[index];
+      }
+      else
+      {
+        // the hard scattering tracks are always kept, only the pile-up ones need the z of their particle
+        removed = kFALSE;
+        if(candidate->IsPU)
+        {
+          particle = static_cast<Candidate*>(candidate->GetCandidates()->At(0));
+          z = particle->Position.Z();
+          removed = TMath::Abs(z-zvtx) > fZVertexResolution;
+        }
+      }
+
       // apply pile-up subtraction
       // assume perfect pile-up subtraction for tracks outside fZVertexResolution
       
-      if(candidate->IsPU && TMath::Abs(z-zvtx) > fZVertexResolution) candidate->IsRecoPU = 1;
+      if(removed) candidate->IsRecoPU = 1;
       else 
       {
          candidate->IsRecoPU = 0;
@@ -23,6 +23,12 @@
  *
  *  Subtract pile-up contribution from tracks.
  *
+ *  With UseVertexIndex the tracks are removed together with their vertex,
+ *  found from the VertexIndex set by PileUpMerger, when the z of this
+ *  vertex is further than ZVertexResolution from the hard scattering.
+ *  The table of removed vertices is built once per event and shared by
+ *  all the input arrays.
+ *
  *  \author P. Demin - UCL, Louvain-la-Neuve
  *
  */
@@ -30,6 +36,7 @@
 #include "classes/DelphesModule.h"
 
 #include <map>
+#include <vector>
 
 class TIterator;
 class TObjArray;
@@ -45,12 +52,18 @@ public:
   void Process();
   void Finish();
 
+  Bool_t IsThreadSafe() const { return kTRUE; }
+
 private:
 
   Double_t fZVertexResolution;
 
   Double_t fPTMin; 
 
+  Bool_t fUseVertexIndex;
+
+  std::vector< Bool_t > fRemoved; //!
+
   std::map< TIterator *, TObjArray * > fInputMap; //!
 
   ClassDef(TrackPileUpSubtractor, 1)
@@ -0,0 +1,279 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/** \class TrackingPipeline
+ *
+ *  Applies the tracking efficiency, the transverse momentum smearing and
+ *  the impact parameter smearing in one pass.
+ *
+ */
+
+#include "modules/TrackingPipeline.h"
+
+#include "classes/DelphesClasses.h"
+#include "classes/CandidateSpan.h"
+#include "classes/DelphesFactory.h"
+#include "classes/DelphesFormula.h"
+
+#include "TMath.h"
+#include "TString.h"
+#include "TRandom3.h"
+#include "TObjArray.h"
+#include "TLorentzVector.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+
+TrackingPipeline::TrackingPipeline() :
+  fEfficiencyFormula(0), fResolutionFormula(0), fImpactParameterFormula(0),
+  fBatch(0), fMomentumBatch(0)
+{
+  Int_t i;
+
+  fEfficiencyFormula = new DelphesFormula;
+  fResolutionFormula = new DelphesFormula;
+  fImpactParameterFormula = new DelphesFormula;
+
+  fBatch = new DelphesFormulaBatch;
+  fMomentumBatch = new DelphesFormulaBatch;
+
+  for(i = 0; i < kNumberOfSteps; ++i)
+  {
+    fSteps[i].random = 0;
+    fSteps[i].key = 0;
+    fSteps[i].gaussians = 0;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+TrackingPipeline::~TrackingPipeline()
+{
+  Int_t i;
+
+  if(fEfficiencyFormula) delete fEfficiencyFormula;
+  if(fResolutionFormula) delete fResolutionFormula;
+  if(fImpactParameterFormula) delete fImpactParameterFormula;
+
+  if(fBatch) delete fBatch;
+  if(fMomentumBatch) delete fMomentumBatch;
+
+  for(i = 0; i < kNumberOfSteps; ++i)
+  {
+    if(fSteps[i].random) delete fSteps[i].random;
+    if(fSteps[i].gaussians) delete fSteps[i].gaussians;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void TrackingPipeline::Init()
+{
+  ExRootConfParam param;
+
+  // read efficiency and resolution formulas, binned tables replace the
+  // first two when they are given
+
+  fEfficiencyFormula->Compile(GetString("EfficiencyFormula", "1.0"));
+
+  param = GetParam("EfficiencyTable");
+  if(param.GetSize() > 0) fEfficiencyFormula->SetTable(param);
+
+  fResolutionFormula->Compile(GetString("ResolutionFormula", "0.0"));
+
+  param = GetParam("ResolutionTable");
+  if(param.GetSize() > 0) fResolutionFormula->SetTable(param);
+
+  fImpactParameterFormula->Compile(GetString("ImpactParameterFormula", "0.0"));
+
+  // names of the streams of the replaced modules, empty for the stream of
+  // this module
+
+  fSteps[kEfficiency].stream = GetString("EfficiencyStream", "");
+  fSteps[kMomentumSmearing].stream = GetString("MomentumSmearingStream", "");
+  fSteps[kImpactParameterSmearing].stream = GetString("ImpactParameterSmearingStream", "");
+
+  // import input array
+
+  fInputArray = ImportArray(GetString("InputArray", "ParticlePropagator/chargedHadrons"));
+
+  // create output array
+
+  fOutputArray = ExportArray(GetString("OutputArray", "tracks"));
+}
+
+//------------------------------------------------------------------------------
+
+void TrackingPipeline::Finish()
+{
+}
+
+//------------------------------------------------------------------------------
+
+void TrackingPipeline::SetRandomStream(UInt_t seed)
+{
+  Int_t i;
+
+  DelphesModule::SetRandomStream(seed);
+
+  for(i = 0; i < kNumberOfSteps; ++i)
+  {
+    Step &step = fSteps[i];
+    if(step.stream.Length() == 0) continue;
+
+    step.key = RandomStreamKey(seed, step.stream);
+    if(!step.random) step.random = new TRandom3;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void TrackingPipeline::ResetRandomStream(Long64_t event)
+{
+  Int_t i;
+
+  DelphesModule::ResetRandomStream(event);
+
+  for(i = 0; i < kNumberOfSteps; ++i)
+  {
+    Step &step = fSteps[i];
+    if(!step.random) continue;
+
+    step.random->SetSeed(RandomStreamSeed(step.key, event));
+    if(step.gaussians) step.gaussians->Clear();
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void TrackingPipeline::UseGaussianBuffer()
+{
+  Int_t i;
+
+  DelphesModule::UseGaussianBuffer();
+
+  for(i = 0; i < kNumberOfSteps; ++i)
+  {
+    Step &step = fSteps[i];
+    if(!step.gaussians) step.gaussians = new DelphesGaussianBuffer;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+TRandom *TrackingPipeline::GetRandom(Int_t step)
+{
+  return fSteps[step].random ? fSteps[step].random : DelphesModule::GetRandom();
+}
+
+//------------------------------------------------------------------------------
+
+Double_t TrackingPipeline::Gaus(Int_t step, Double_t mean, Double_t sigma)
+{
+  const Step &current = fSteps[step];
+
+  if(!current.random) return DelphesModule::Gaus(mean, sigma);
+  if(!current.gaussians) return current.random->Gaus(mean, sigma);
+  return mean + sigma*current.gaussians->Next(current.random);
+}
+
+//------------------------------------------------------------------------------
+
+void TrackingPipeline::Process()
+{
+  CandidateSpan candidates(fInputArray);
+  Candidate *candidate, *mother;
+  Double_t pt, eta, phi, px, py, sigma;
+  Double_t xd, yd, zd, ddxy;
+  Int_t i, n = candidates.size();
+
+  // collect the variables of all the candidates and evaluate the
+  // three formulas for all of them at once
+  fBatch->Resize(n);
+  fMomentumBatch->Resize(n);
+  for(i = 0; i < n; ++i)
+  {
+    candidate = candidates[i];
+    fBatch->eta[i] = candidate->Position.Eta();
+    fBatch->phi[i] = candidate->Position.Phi();
+    fBatch->pt[i] = candidate->Momentum.Pt();
+    fBatch->energy[i] = candidate->Momentum.E();
+
+    fMomentumBatch->eta[i] = candidate->Momentum.Eta();
+    fMomentumBatch->phi[i] = candidate->Momentum.Phi();
+    fMomentumBatch->pt[i] = fBatch->pt[i];
+    fMomentumBatch->energy[i] = fBatch->energy[i];
+  }
+
+  fEfficiencyFormula->Eval(*fBatch);
+  fEfficiencies.swap(fBatch->result);
+
+  fResolutionFormula->Eval(*fBatch);
+  fResolutions.swap(fBatch->result);
+
+  fImpactParameterFormula->Eval(*fMomentumBatch);
+
+  // every step draws in the same order as the module it replaces, only
+  // for the candidates that have passed the previous steps
+  for(i = 0; i < n; ++i)
+  {
+    if(GetRandom(kEfficiency)->Uniform() > fEfficiencies[i]) continue;
+
+    pt = fBatch->pt[i];
+    pt = Gaus(kMomentumSmearing, pt, fResolutions[i] * pt);
+
+    if(pt <= 0.0) continue;
+
+    mother = candidates[i];
+    candidate = static_cast<Candidate*>(mother->Clone());
+    eta = fMomentumBatch->eta[i];
+    phi = fMomentumBatch->phi[i];
+    candidate->Momentum.SetPtEtaPhiE(pt, eta, phi, pt*TMath::CosH(eta));
+
+    // smear the coordinates of closest approach, the impact parameter is
+    // computed with the momentum before smearing
+    sigma = fMomentumBatch->result[i];
+    xd = mother->Xd + Gaus(kImpactParameterSmearing, 0.0, sigma);
+    yd = mother->Yd + Gaus(kImpactParameterSmearing, 0.0, sigma);
+    zd = mother->Zd + Gaus(kImpactParameterSmearing, 0.0, sigma);
+
+    px = mother->Momentum.Px();
+    py = mother->Momentum.Py();
+
+    ddxy = Gaus(kImpactParameterSmearing, 0.0, sigma);
+
+    candidate->Xd = xd;
+    candidate->Yd = yd;
+    candidate->Zd = zd;
+
+    candidate->Dxy = (xd*py - yd*px)/fBatch->pt[i];
+    candidate->SDxy = ddxy;
+
+    candidate->AddCandidate(mother);
+    fOutputArray->Add(candidate);
+  }
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,111 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TrackingPipeline_h
+#define TrackingPipeline_h
+
+/** \class TrackingPipeline
+ *
+ *  Applies the tracking efficiency, the transverse momentum smearing and
+ *  the impact parameter smearing to the candidates of the InputArray in
+ *  one pass, with one clone per track. It replaces the chain
+ *
+ *    Efficiency -> MomentumSmearing -> ImpactParameterSmearing
+ *
+ *  with EfficiencyFormula, ResolutionFormula and ImpactParameterFormula
+ *  taking the places of the formulas of the three modules (and
+ *  EfficiencyTable and ResolutionTable of their tables). The tracks
+ *  refer to the candidates of the InputArray directly.
+ *
+ *  With RandomStreams every step draws from the stream of the module it
+ *  replaces when EfficiencyStream, MomentumSmearingStream and
+ *  ImpactParameterSmearingStream are set to the names of those modules,
+ *  and the tracks are then the same as the ones of the chain. Otherwise
+ *  the steps draw from the stream of the module.
+ *
+ */
+
+#include "classes/DelphesModule.h"
+
+#include "TString.h"
+
+#include <vector>
+
+class TObjArray;
+class TRandom;
+class TRandom3;
+class DelphesFormula;
+
+struct DelphesFormulaBatch;
+
+class TrackingPipeline: public DelphesModule
+{
+public:
+
+  TrackingPipeline();
+  ~TrackingPipeline();
+
+  void Init();
+  void Process();
+  void Finish();
+
+  Bool_t IsThreadSafe() const { return HasRandomStream(); }
+
+  void SetRandomStream(UInt_t seed);
+  void ResetRandomStream(Long64_t event);
+  void UseGaussianBuffer();
+
+private:
+
+  enum { kEfficiency, kMomentumSmearing, kImpactParameterSmearing, kNumberOfSteps };
+
+  struct Step
+  {
+    TString stream;
+    TRandom3 *random;
+    ULong64_t key;
+    DelphesGaussianBuffer *gaussians;
+  };
+
+  TRandom *GetRandom(Int_t step);
+  Double_t Gaus(Int_t step, Double_t mean, Double_t sigma);
+
+  DelphesFormula *fEfficiencyFormula; //!
+  DelphesFormula *fResolutionFormula; //!
+  DelphesFormula *fImpactParameterFormula; //!
+
+  // the variables of the impact parameter formula come from the momentum
+  // and not from the position of the candidates
+  DelphesFormulaBatch *fBatch; //!
+  DelphesFormulaBatch *fMomentumBatch; //!
+
+  Step fSteps[kNumberOfSteps]; //!
+
+#if !defined(__CINT__) && !defined(__CLING__)
+  std::vector< Double_t > fEfficiencies; //!
+  std::vector< Double_t > fResolutions; //!
+#endif
+
+  const TObjArray *fInputArray; //!
+
+  TObjArray *fOutputArray; //!
+
+  ClassDef(TrackingPipeline, 1)
+};
+
+#endif
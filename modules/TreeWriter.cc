@@ -30,11 +30,13 @@
 #include "classes/DelphesClasses.h"
 #include "classes/DelphesFactory.h"
 #include "classes/DelphesFormula.h"
+#include "classes/DelphesCovariance.h"
 
 #include "ExRootAnalysis/ExRootResult.h"
 #include "ExRootAnalysis/ExRootFilter.h"
 #include "ExRootAnalysis/ExRootClassifier.h"
 #include "ExRootAnalysis/ExRootTreeBranch.h"
+#include "ExRootAnalysis/ExRootTreeWriter.h"
 
 #include "TROOT.h"
 #include "TMath.h"
@@ -55,7 +57,8 @@ using namespace std;
 
 //------------------------------------------------------------------------------
 
-TreeWriter::TreeWriter()
+TreeWriter::TreeWriter() :
+  fCovarianceForm(0), fCovarianceMantissaBits(23), fSkipFields(0)
 {
 }
 
@@ -95,6 +98,43 @@ void TreeWriter::Init()
   TClass *branchClass;
   TObjArray *array;
   ExRootTreeBranch *branch;
+  ExRootTreeWriter *treeWriter;
+  map< TString, ExRootTreeBranch * > branchNames;
+  map< TString, ExRootTreeBranch * >::iterator itBranchNames;
+  map< TString, UInt_t > fieldMasks;
+  map< TString, UInt_t >::iterator itFieldMasks;
+  TString compression, fieldName;
+  Int_t algorithm;
+
+  // output tree settings, the tree writer is shared by all the modules and
+  // the instances of a DelphesWorkerPool
+  treeWriter = static_cast<ExRootTreeWriter *>(GetObject("TreeWriter", ExRootTreeWriter::Class()));
+  if(!treeWriter)
+  {
+    throw runtime_error("can't access access tree writer");
+  }
+
+  treeWriter->SetSplitLevel(GetInt("SplitLevel", 99));
+  treeWriter->SetAutoFlush(GetInt("AutoFlush", -30000000));
+  treeWriter->SetAutoSave(GetInt("AutoSave", 10000000));
+
+  // zero writes all the events to one file
+  treeWriter->SetMaxEventsPerFile(GetLong("MaxEventsPerFile", 0));
+  treeWriter->SetMaxBytesPerFile(GetLong("MaxBytesPerFile", 0));
+
+  // empty to keep the compression of the output file
+  compression = GetString("Compression", "");
+  compression.ToUpper();
+  if(compression.Length() > 0)
+  {
+    if(compression == "ZLIB") algorithm = 1;
+    else if(compression == "LZMA") algorithm = 2;
+    else if(compression == "LZ4") algorithm = 4;
+    else if(compression == "ZSTD") algorithm = 5;
+    else throw runtime_error("Compression must be ZLIB, LZMA, LZ4 or ZSTD");
+
+    treeWriter->SetCompressionSettings(100*algorithm + GetInt("CompressionLevel", 4));
+  }
 
   size = param.GetSize();
   for(i = 0; i < size/3; ++i)
@@ -122,8 +162,57 @@ void TreeWriter::Init()
     branch = NewBranch(branchName, branchClass);
 
     fBranchMap.insert(make_pair(branch, make_pair(itClassMap->second, array)));
+    branchNames[branchName] = branch;
   }
 
+  // trkCov of the tracks as the covariance, its Cholesky factor or the
+  // sigmas and the correlations, with the float mantissas cut to
+  // CovarianceMantissaBits to compress better
+  fCovarianceForm = DelphesCovariance::GetForm(GetString("CovarianceForm", "Plain"));
+  fCovarianceMantissaBits = GetInt("CovarianceMantissaBits", 23);
+
+  // fields left empty, and not computed, in the listed branches
+  fieldMasks["Constituents"] = kSkipConstituents;
+  fieldMasks["Particles"] = kSkipParticles;
+  fieldMasks["Subjets"] = kSkipSubjets;
+  fieldMasks["Tracks"] = kSkipTracks;
+  fieldMasks["FlavorTagging"] = kSkipFlavorTagging;
+  fieldMasks["Substructure"] = kSkipSubstructure;
+  fieldMasks["Covariance"] = kSkipCovariance;
+
+  param = GetParam("SkipFields");
+  size = param.GetSize();
+  for(i = 0; i < size/2; ++i)
+  {
+    branchName = param[i*2].GetString();
+    fieldName = param[i*2 + 1].GetString();
+
+    itBranchNames = branchNames.find(branchName);
+    if(itBranchNames == branchNames.end())
+    {
+      cout << "** ERROR: cannot find branch '" << branchName << "'" << endl;
+      continue;
+    }
+
+    itFieldMasks = fieldMasks.find(fieldName);
+    if(itFieldMasks == fieldMasks.end())
+    {
+      cout << "** ERROR: cannot skip field '" << fieldName << "'" << endl;
+      continue;
+    }
+
+    fSkipMap[itBranchNames->second] |= itFieldMasks->second;
+  }
+
+  // for all the branches, then for the ones listed in BasketSizes
+  if(GetInt("BasketSize", 64000) != 64000) treeWriter->SetBasketSize("*", GetInt("BasketSize", 64000));
+
+  param = GetParam("BasketSizes");
+  size = param.GetSize();
+  for(i = 0; i < size/2; ++i)
+  {
+    treeWriter->SetBasketSize(param[i*2].GetString(), param[i*2 + 1].GetInt());
+  }
 }
 
 //------------------------------------------------------------------------------
@@ -136,33 +225,39 @@ void TreeWriter::Finish()
 
 void TreeWriter::FillParticles(Candidate *candidate, TRefArray *array)
 {
-  TIter it1(candidate->GetCandidates());
-  it1.Reset();
+  Candidate *constituent, *particle;
+  Int_t i, j, size, sizeConstituent;
+
   array->Clear();
-  while((candidate = static_cast<Candidate*>(it1.Next())))
+  if(fSkipFields & kSkipParticles) return;
+
+  // through the index accessors, which leave a jet holding indices as it is
+  size = candidate->GetNumberOfCandidates();
+  for(i = 0; i < size; ++i)
   {
-    TIter it2(candidate->GetCandidates());
+    constituent = candidate->GetCandidate(i);
+    sizeConstituent = constituent->GetNumberOfCandidates();
 
     // particle
-    if(candidate->GetCandidates()->GetEntriesFast() == 0)
+    if(sizeConstituent == 0)
     {
-      array->Add(candidate);
+      array->Add(constituent);
       continue;
     }
 
     // track
-    candidate = static_cast<Candidate*>(candidate->GetCandidates()->At(0));
-    if(candidate->GetCandidates()->GetEntriesFast() == 0)
+    particle = constituent->GetCandidate(0);
+    if(particle->GetNumberOfCandidates() == 0)
     {
-      array->Add(candidate);
+      array->Add(particle);
       continue;
     }
 
     // tower
-    it2.Reset();
-    while((candidate = static_cast<Candidate*>(it2.Next())))
+    for(j = 0; j < sizeConstituent; ++j)
     {
-      array->Add(candidate->GetCandidates()->At(0));
+      particle = constituent->GetCandidate(j);
+      array->Add(particle->GetNumberOfCandidates() > 0 ? particle->GetCandidate(0) : 0);
     }
   }
 }
@@ -278,7 +373,7 @@ void TreeWriter::ProcessTracks(ExRootTreeBranch *branch, TObjArray *array)
   Candidate *candidate = 0;
   Candidate *particle = 0;
   Track *entry = 0;
-  Double_t pt, signz, cosTheta, eta, rapidity;
+  Double_t pt, signz, cosTheta, eta;
   const Double_t c_light = 2.99792458E8;
 
   // loop over all tracks
@@ -290,7 +385,6 @@ void TreeWriter::ProcessTracks(ExRootTreeBranch *branch, TObjArray *array)
     cosTheta = TMath::Abs(position.CosTheta());
     signz = (position.Pz() >= 0.0) ? 1.0 : -1.0;
     eta = (cosTheta == 1.0 ? signz*999.9 : position.Eta());
-    rapidity = (cosTheta == 1.0 ? signz*999.9 : position.Rapidity());
 
     entry = static_cast<Track*>(branch->NewEntry());
 
@@ -316,11 +410,18 @@ void TreeWriter::ProcessTracks(ExRootTreeBranch *branch, TObjArray *array)
     entry->Zd = candidate->Zd;
 
     //track parameters
-    for(int i=0;i<5;i++)
-     entry->trkPar[i] = candidate->trkPar[i];
-    for(int i=0;i<15;i++)
-     entry->trkCov[i] = candidate->trkCov[i];
-    assert(check_d0_z0(entry));
+    if(fSkipFields & kSkipCovariance)
+    {
+      fill(entry->trkPar, entry->trkPar + 5, 0.0);
+      fill(entry->trkCov, entry->trkCov + 15, 0.0);
+    }
+    else
+    {
+      for(int i=0;i<5;i++)
+       entry->trkPar[i] = candidate->trkPar[i];
+      DelphesCovariance::Encode(candidate->trkCov, entry->trkCov, fCovarianceForm, fCovarianceMantissaBits);
+      assert(check_d0_z0(entry));
+    }
 
     const TLorentzVector &momentum = candidate->Momentum;
 
@@ -328,7 +429,6 @@ void TreeWriter::ProcessTracks(ExRootTreeBranch *branch, TObjArray *array)
     cosTheta = TMath::Abs(momentum.CosTheta());
     signz = (momentum.Pz() >= 0.0) ? 1.0 : -1.0;
     eta = (cosTheta == 1.0 ? signz*999.9 : momentum.Eta());
-    rapidity = (cosTheta == 1.0 ? signz*999.9 : momentum.Rapidity());
 
     entry->Eta = eta;
     entry->Phi = momentum.Phi();
@@ -353,7 +453,7 @@ void TreeWriter::ProcessTowers(ExRootTreeBranch *branch, TObjArray *array)
   TIter iterator(array);
   Candidate *candidate = 0;
   Tower *entry = 0;
-  Double_t pt, signPz, cosTheta, eta, rapidity;
+  Double_t pt, signPz, cosTheta, eta;
   const Double_t c_light = 2.99792458E8;
 
   // loop over all towers
@@ -367,7 +467,6 @@ void TreeWriter::ProcessTowers(ExRootTreeBranch *branch, TObjArray *array)
     cosTheta = TMath::Abs(momentum.CosTheta());
     signPz = (momentum.Pz() >= 0.0) ? 1.0 : -1.0;
     eta = (cosTheta == 1.0 ? signPz*999.9 : momentum.Eta());
-    rapidity = (cosTheta == 1.0 ? signPz*999.9 : momentum.Rapidity());
 
     entry = static_cast<Tower*>(branch->NewEntry());
 
@@ -396,18 +495,18 @@ void TreeWriter::ProcessTowers(ExRootTreeBranch *branch, TObjArray *array)
 
 void TreeWriter::ProcessPhotons(ExRootTreeBranch *branch, TObjArray *array)
 {
-  TIter iterator(array);
+  vector< Candidate * >::const_iterator itCandidates;
   Candidate *candidate = 0;
   Photon *entry = 0;
-  Double_t pt, signPz, cosTheta, eta, rapidity;
+  Double_t pt, signPz, cosTheta, eta;
   const Double_t c_light = 2.99792458E8;
 
-  array->Sort();
+  const vector< Candidate * > &candidates = fSortedArrays.Get(array);
 
   // loop over all photons
-  iterator.Reset();
-  while((candidate = static_cast<Candidate*>(iterator.Next())))
+  for(itCandidates = candidates.begin(); itCandidates != candidates.end(); ++itCandidates)
   {
+    candidate = *itCandidates;
     TIter it1(candidate->GetCandidates());
     const TLorentzVector &momentum = candidate->Momentum;
     const TLorentzVector &position = candidate->Position;
@@ -417,7 +516,6 @@ void TreeWriter::ProcessPhotons(ExRootTreeBranch *branch, TObjArray *array)
     cosTheta = TMath::Abs(momentum.CosTheta());
     signPz = (momentum.Pz() >= 0.0) ? 1.0 : -1.0;
     eta = (cosTheta == 1.0 ? signPz*999.9 : momentum.Eta());
-    rapidity = (cosTheta == 1.0 ? signPz*999.9 : momentum.Rapidity());
 
     entry = static_cast<Photon*>(branch->NewEntry());
 
@@ -447,18 +545,18 @@ void TreeWriter::ProcessPhotons(ExRootTreeBranch *branch, TObjArray *array)
 
 void TreeWriter::ProcessElectrons(ExRootTreeBranch *branch, TObjArray *array)
 {
-  TIter iterator(array);
+  vector< Candidate * >::const_iterator itCandidates;
   Candidate *candidate = 0;
   Electron *entry = 0;
-  Double_t pt, signPz, cosTheta, eta, rapidity;
+  Double_t pt, signPz, cosTheta, eta;
   const Double_t c_light = 2.99792458E8;
 
-  array->Sort();
+  const vector< Candidate * > &candidates = fSortedArrays.Get(array);
 
   // loop over all electrons
-  iterator.Reset();
-  while((candidate = static_cast<Candidate*>(iterator.Next())))
+  for(itCandidates = candidates.begin(); itCandidates != candidates.end(); ++itCandidates)
   {
+    candidate = *itCandidates;
     const TLorentzVector &momentum = candidate->Momentum;
     const TLorentzVector &position = candidate->Position;
 
@@ -466,7 +564,6 @@ void TreeWriter::ProcessElectrons(ExRootTreeBranch *branch, TObjArray *array)
     cosTheta = TMath::Abs(momentum.CosTheta());
     signPz = (momentum.Pz() >= 0.0) ? 1.0 : -1.0;
     eta = (cosTheta == 1.0 ? signPz*999.9 : momentum.Eta());
-    rapidity = (cosTheta == 1.0 ? signPz*999.9 : momentum.Rapidity());
 
     entry = static_cast<Electron*>(branch->NewEntry());
 
@@ -498,19 +595,19 @@ void TreeWriter::ProcessElectrons(ExRootTreeBranch *branch, TObjArray *array)
 
 void TreeWriter::ProcessMuons(ExRootTreeBranch *branch, TObjArray *array)
 {
-  TIter iterator(array);
+  vector< Candidate * >::const_iterator itCandidates;
   Candidate *candidate = 0;
   Muon *entry = 0;
-  Double_t pt, signPz, cosTheta, eta, rapidity;
+  Double_t pt, signPz, cosTheta, eta;
 
   const Double_t c_light = 2.99792458E8;
 
-  array->Sort();
+  const vector< Candidate * > &candidates = fSortedArrays.Get(array);
 
   // loop over all muons
-  iterator.Reset();
-  while((candidate = static_cast<Candidate*>(iterator.Next())))
+  for(itCandidates = candidates.begin(); itCandidates != candidates.end(); ++itCandidates)
   {
+    candidate = *itCandidates;
     const TLorentzVector &momentum = candidate->Momentum;
     const TLorentzVector &position = candidate->Position;
 
@@ -518,7 +615,6 @@ void TreeWriter::ProcessMuons(ExRootTreeBranch *branch, TObjArray *array)
     cosTheta = TMath::Abs(momentum.CosTheta());
     signPz = (momentum.Pz() >= 0.0) ? 1.0 : -1.0;
     eta = (cosTheta == 1.0 ? signPz*999.9 : momentum.Eta());
-    rapidity = (cosTheta == 1.0 ? signPz*999.9 : momentum.Rapidity());
 
     entry = static_cast<Muon*>(branch->NewEntry());
 
@@ -562,21 +658,27 @@ void copy(const SecondaryVertexTrack& vxtrk, TSecondaryVertexTrack& track) {
 
 void TreeWriter::ProcessJets(ExRootTreeBranch *branch, TObjArray *array)
 {
-  TIter iterator(array);
+  vector< Candidate * >::const_iterator itCandidates;
   Candidate *candidate = 0, *constituent = 0;
   Jet *entry = 0;
-  Double_t pt, signPz, cosTheta, eta, rapidity;
+  Double_t pt, signPz, cosTheta, eta;
   Double_t ecalEnergy, hcalEnergy;
   const Double_t c_light = 2.99792458E8;
-  Int_t i;
+  Int_t i, iConstituent, nConstituents;
+  // jets without substructure are written with the default values
+  static const CandidateSubstructure noSubstructure;
+  static const CandidatePileUpJetID noPileUpJetID;
+  static const CandidateFlavorTagging noFlavorTagging;
+  const CandidateSubstructure *substructure;
+  const CandidatePileUpJetID *pileUpJetID;
+  const CandidateFlavorTagging *tagging;
 
-  array->Sort();
+  const vector< Candidate * > &candidates = fSortedArrays.Get(array);
 
   // loop over all jets
-  iterator.Reset();
-  while((candidate = static_cast<Candidate*>(iterator.Next())))
+  for(itCandidates = candidates.begin(); itCandidates != candidates.end(); ++itCandidates)
   {
-    TIter itConstituents(candidate->GetCandidates());
+    candidate = *itCandidates;
 
     const TLorentzVector &momentum = candidate->Momentum;
     const TLorentzVector &position = candidate->Position;
@@ -585,7 +687,6 @@ void TreeWriter::ProcessJets(ExRootTreeBranch *branch, TObjArray *array)
     cosTheta = TMath::Abs(momentum.CosTheta());
     signPz = (momentum.Pz() >= 0.0) ? 1.0 : -1.0;
     eta = (cosTheta == 1.0 ? signPz*999.9 : momentum.Eta());
-    rapidity = (cosTheta == 1.0 ? signPz*999.9 : momentum.Rapidity());
 
     entry = static_cast<Jet*>(branch->NewEntry());
 
@@ -611,15 +712,18 @@ void TreeWriter::ProcessJets(ExRootTreeBranch *branch, TObjArray *array)
     entry->BTagAlgo = candidate->BTagAlgo;
     entry->BTagPhys = candidate->BTagPhys;
 
+    tagging = candidate->GetFlavorTagging();
+    if(!tagging || (fSkipFields & kSkipFlavorTagging)) tagging = &noFlavorTagging;
+
     entry->PrimaryVertexTracks.clear();
-    for (const auto& vxtrk: candidate->primaryVertexTracks) {
+    for (const auto& vxtrk: tagging->primaryVertexTracks) {
       TSecondaryVertexTrack track;
       copy(vxtrk, track);
       entry->PrimaryVertexTracks.push_back(track);
     }
 
     entry->SecondaryVertices.clear();
-    for (const auto& vx: candidate->secondaryVertices) {
+    for (const auto& vx: tagging->secondaryVertices) {
       TSecondaryVertex tvx;
       tvx.x = vx.X();
       tvx.y = vx.Y();
@@ -631,9 +735,9 @@ void TreeWriter::ProcessJets(ExRootTreeBranch *branch, TObjArray *array)
       CP(nTracks);
       CP(eFrac);
       CP(mass);
-      CP(config);
 #undef CP
-      for (const auto& vxtrk: vx.tracks_along_jet) {
+      tvx.config = config_name(vx.config);
+      for (const auto& vxtrk: vx.tracks_along_jet(tagging->secondaryVertexTracks)) {
 	TSecondaryVertexTrack track;
 	copy(vxtrk, track);
 	tvx.tracks.push_back(track);
@@ -642,16 +746,16 @@ void TreeWriter::ProcessJets(ExRootTreeBranch *branch, TObjArray *array)
       entry->SecondaryVertices.push_back(tvx);
     }
     entry->HLSecondaryVertexTracks.clear();
-    for (const auto& vxtrk: candidate->hlSecVxTracks) {
+    for (const auto& vxtrk: tagging->hlSecVxTracks) {
       TSecondaryVertexTrack track;
       copy(vxtrk, track);
       entry->HLSecondaryVertexTracks.push_back(track);
     }
-    copy(candidate->hlSvx, entry->HLSecondaryVertex);
-    copy(candidate->mlSvx, entry->MLSecondaryVertex);
-    copy(candidate->hlTrk, *entry);
+    copy(tagging->hlSvx, entry->HLSecondaryVertex);
+    copy(tagging->mlSvx, entry->MLSecondaryVertex);
+    copy(tagging->hlTrk, *entry);
     entry->TruthVertices.clear();
-    for (const auto& vx: candidate->truthVertices) {
+    for (const auto& vx: tagging->truthVertices) {
       entry->TruthVertices.push_back(vx);
     }
 
@@ -659,13 +763,14 @@ void TreeWriter::ProcessJets(ExRootTreeBranch *branch, TObjArray *array)
 
     entry->Charge = candidate->Charge;
 
-    itConstituents.Reset();
     entry->Constituents.Clear();
     ecalEnergy = 0.0;
     hcalEnergy = 0.0;
-    while((constituent = static_cast<Candidate*>(itConstituents.Next())))
+    nConstituents = candidate->GetNumberOfCandidates();
+    for(iConstituent = 0; iConstituent < nConstituents; ++iConstituent)
     {
-      entry->Constituents.Add(constituent);
+      constituent = candidate->GetCandidate(iConstituent);
+      if(!(fSkipFields & kSkipConstituents)) entry->Constituents.Add(constituent);
       ecalEnergy += constituent->Eem;
       hcalEnergy += constituent->Ehad;
     }
@@ -676,7 +781,7 @@ void TreeWriter::ProcessJets(ExRootTreeBranch *branch, TObjArray *array)
     TIter itSubjets(candidate->GetSubjets());
     itSubjets.Reset();
     entry->Subjets.Clear();
-    while ((constituent = static_cast<Candidate*>(itSubjets.Next())))
+    while (!(fSkipFields & kSkipSubjets) && (constituent = static_cast<Candidate*>(itSubjets.Next())))
     {
       entry->Subjets.Add(constituent);
     }
@@ -684,33 +789,41 @@ void TreeWriter::ProcessJets(ExRootTreeBranch *branch, TObjArray *array)
     TIter itTracks(candidate->GetTracks());
     itTracks.Reset();
     entry->Tracks.Clear();
-    while ((constituent = static_cast<Candidate*>(itTracks.Next())))
+    while (!(fSkipFields & kSkipTracks) && (constituent = static_cast<Candidate*>(itTracks.Next())))
     {
       entry->Tracks.Add(constituent);
     }
 
     //---   Pile-Up Jet ID variables ----
 
-    entry->NCharged = candidate->NCharged;
-    entry->NNeutrals = candidate->NNeutrals;
-    entry->Beta = candidate->Beta;
-    entry->BetaStar = candidate->BetaStar;
-    entry->MeanSqDeltaR = candidate->MeanSqDeltaR;
-    entry->PTD = candidate->PTD;
+    pileUpJetID = candidate->GetPileUpJetID();
+    if(!pileUpJetID) pileUpJetID = &noPileUpJetID;
+
+    entry->NCharged = pileUpJetID->NCharged;
+    entry->NNeutrals = pileUpJetID->NNeutrals;
+    entry->Beta = pileUpJetID->Beta;
+    entry->BetaStar = pileUpJetID->BetaStar;
+    entry->MeanSqDeltaR = pileUpJetID->MeanSqDeltaR;
+    entry->PTD = pileUpJetID->PTD;
 
     //--- Sub-structure variables ----
 
-    entry->NSubJetsTrimmed = candidate->NSubJetsTrimmed;
-    entry->NSubJetsPruned = candidate->NSubJetsPruned;
-    entry->NSubJetsSoftDropped = candidate->NSubJetsSoftDropped;
+    substructure = candidate->GetSubstructure();
+    if(!substructure || (fSkipFields & kSkipSubstructure)) substructure = &noSubstructure;
+
+    entry->NSubJetsTrimmed = substructure->NSubJetsTrimmed;
+    entry->NSubJetsPruned = substructure->NSubJetsPruned;
+    entry->NSubJetsSoftDropped = substructure->NSubJetsSoftDropped;
+    entry->SoftDroppedPointsP4 = substructure->SoftDroppedPointsP4;
+    entry->NSubJetsSoftDroppedPoints = substructure->NSubJetsSoftDroppedPoints;
 
     for(i = 0; i < 5; i++)
     {
-      entry->FracPt[i] = candidate -> FracPt[i];
-      entry->Tau[i] = candidate -> Tau[i];
-      entry->TrimmedP4[i] = candidate -> TrimmedP4[i];
-      entry->PrunedP4[i] = candidate -> PrunedP4[i];
-      entry->SoftDroppedP4[i] = candidate -> SoftDroppedP4[i];
+      entry->FracPt[i] = pileUpJetID->FracPt[i];
+      entry->Tau[i] = substructure->Tau[i];
+      entry->TrimmedP4[i] = substructure -> TrimmedP4[i];
+      entry->PrunedP4[i] = substructure -> PrunedP4[i];
+      entry->SoftDroppedP4[i] = substructure -> SoftDroppedP4[i];
     }
 
     FillParticles(candidate, &entry->Particles);
@@ -783,6 +896,20 @@ void TreeWriter::ProcessWeight(ExRootTreeBranch *branch, TObjArray *array)
 {
   Candidate *candidate = 0;
   Weight *entry = 0;
+  const Double_t *weights;
+  Int_t i, size;
+
+  // one entry per weight set from the block of the Weighter
+  weights = GetFactory()->GetWeightBlock(array, size);
+  if(weights && array->GetEntriesFast() > 0)
+  {
+    for(i = 0; i < size; ++i)
+    {
+      entry = static_cast<Weight*>(branch->NewEntry());
+      entry->Weight = weights[i];
+    }
+    return;
+  }
 
   // get the first entry
   if((candidate = static_cast<Candidate*>(array->At(0))))
@@ -832,16 +959,21 @@ void TreeWriter::ProcessHectorHit(ExRootTreeBranch *branch, TObjArray *array)
 void TreeWriter::Process()
 {
   TBranchMap::iterator itBranchMap;
+  map< ExRootTreeBranch *, UInt_t >::iterator itSkipMap;
   ExRootTreeBranch *branch;
   TProcessMethod method;
   TObjArray *array;
 
+  fSortedArrays.Reset();
   for(itBranchMap = fBranchMap.begin(); itBranchMap != fBranchMap.end(); ++itBranchMap)
   {
     branch = itBranchMap->first;
     method = itBranchMap->second.first;
     array = itBranchMap->second.second;
 
+    itSkipMap = fSkipMap.find(branch);
+    fSkipFields = itSkipMap != fSkipMap.end() ? itSkipMap->second : 0;
+
     (this->*method)(branch, array);
   }
 }
@@ -29,6 +29,10 @@
 
 #include "classes/DelphesModule.h"
 
+#if !defined(__CINT__) && !defined(__CLING__)
+#include "classes/DelphesSortedArrays.h"
+#endif
+
 #include <map>
 
 class TClass;
@@ -76,6 +80,28 @@ private:
   TBranchMap fBranchMap; //!
 
   std::map< TClass *, TProcessMethod > fClassMap; //!
+
+  enum
+  {
+    kSkipConstituents = 1 << 0,
+    kSkipParticles = 1 << 1,
+    kSkipSubjets = 1 << 2,
+    kSkipTracks = 1 << 3,
+    kSkipFlavorTagging = 1 << 4,
+    kSkipSubstructure = 1 << 5,
+    kSkipCovariance = 1 << 6
+  };
+
+  // form and precision of the track covariances, see DelphesCovariance
+  Int_t fCovarianceForm; //!
+  Int_t fCovarianceMantissaBits; //!
+
+  // SkipFields of the branches, and of the one being filled
+  std::map< ExRootTreeBranch *, UInt_t > fSkipMap; //!
+  UInt_t fSkipFields; //!
+
+  // photons, leptons and jets by decreasing pT, the input arrays keep their order
+  DelphesSortedArrays fSortedArrays; //!
 #endif
 
   ClassDef(TreeWriter, 1)
@@ -0,0 +1,158 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+/** \class TruthSkimmer
+ *
+ *  Walks the generator particles once and fills the arrays of
+ *  StatusPidFilter, TaggingParticlesSkimmer and the parton selection of
+ *  JetFlavorAssociation.
+ *
+ */
+
+#include "modules/TruthSkimmer.h"
+#include "modules/TauTagging.h"
+
+#include "classes/DelphesClasses.h"
+#include "classes/DelphesFactory.h"
+
+#include "TMath.h"
+#include "TObjArray.h"
+#include "TLorentzVector.h"
+
+#include <stdexcept>
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+
+TruthSkimmer::TruthSkimmer() :
+  fItParticleInputArray(0)
+{
+}
+
+//------------------------------------------------------------------------------
+
+TruthSkimmer::~TruthSkimmer()
+{
+}
+
+//------------------------------------------------------------------------------
+
+void TruthSkimmer::Init()
+{
+  // same defaults as the modules it replaces
+
+  fFilteredPTMin = GetDouble("FilteredPTMin", 0.5);
+
+  fTaggingPTMin = GetDouble("TaggingPTMin", 15.0);
+  fTaggingEtaMax = GetDouble("TaggingEtaMax", 2.5);
+
+  fPartonPTMin = GetDouble("PartonPTMin", 0.0);
+  fPartonEtaMax = GetDouble("PartonEtaMax", 2.5);
+
+  // import input array
+
+  fParticleInputArray = ImportArray(GetString("ParticleInputArray", "Delphes/allParticles"));
+  fItParticleInputArray = fParticleInputArray->MakeIterator();
+
+  // create output arrays
+
+  fFilteredOutputArray = ExportArray(GetString("FilteredOutputArray", "filteredParticles"));
+  fTaggingOutputArray = ExportArray(GetString("TaggingOutputArray", "taggingParticles"));
+  fPartonOutputArray = ExportArray(GetString("PartonOutputArray", "partons"));
+  fTauOutputArray = ExportArray(GetString("TauOutputArray", "taus"));
+}
+
+//------------------------------------------------------------------------------
+
+void TruthSkimmer::Finish()
+{
+  if(fItParticleInputArray) delete fItParticleInputArray;
+}
+
+//------------------------------------------------------------------------------
+
+void TruthSkimmer::Process()
+{
+  Candidate *candidate, *tau;
+  vector< Candidate * >::const_iterator itTaggingPartons;
+  TLorentzVector tauMomentum;
+  Int_t status, pdgCode;
+  Double_t pt;
+
+  fTaggingPartons.clear();
+
+  fItParticleInputArray->Reset();
+  while((candidate = static_cast<Candidate*>(fItParticleInputArray->Next())))
+  {
+    const TLorentzVector &momentum = candidate->Momentum;
+
+    status = candidate->Status;
+    pdgCode = TMath::Abs(candidate->PID);
+    pt = momentum.Pt();
+
+    // status == 3, electrons, muons, taus and neutrinos, heavy quarks,
+    // gauge bosons and other fundamental bosons
+    if((status == 3 || (pdgCode > 10 && pdgCode < 17) || pdgCode == 5 || pdgCode == 6 ||
+        (pdgCode > 22 && pdgCode < 43)) && pt > fFilteredPTMin)
+    {
+      fFilteredOutputArray->Add(candidate);
+    }
+
+    // the rest only looks at partons
+    if(status == 1 || pdgCode == 0 || (pdgCode > 5 && pdgCode != 21 && pdgCode != 15)) continue;
+
+    if(pdgCode == 15)
+    {
+      // hadronic taus are replaced by their visible decay
+      if(pt <= fTaggingPTMin || TMath::Abs(momentum.Eta()) > fTaggingEtaMax) continue;
+
+      tauMomentum.SetPxPyPzE(0.0, 0.0, 0.0, 0.0);
+      if(!TauTagging::IsHadronicTau(candidate, fParticleInputArray, &tauMomentum)) continue;
+
+      tau = static_cast<Candidate*>(candidate->Clone());
+      tau->Momentum = tauMomentum;
+
+      fTaggingOutputArray->Add(tau);
+      fTauOutputArray->Add(tau);
+      continue;
+    }
+
+    if(status != -1 && pt > fPartonPTMin && TMath::Abs(momentum.Eta()) <= fPartonEtaMax)
+    {
+      fPartonOutputArray->Add(candidate);
+    }
+
+    if(pt >= fTaggingPTMin && TMath::Abs(momentum.Eta()) <= fTaggingEtaMax)
+    {
+      fTaggingPartons.push_back(candidate);
+    }
+  }
+
+  // the other partons follow the taus, as in TaggingParticlesSkimmer
+  for(itTaggingPartons = fTaggingPartons.begin(); itTaggingPartons != fTaggingPartons.end(); ++itTaggingPartons)
+  {
+    fTaggingOutputArray->Add(*itTaggingPartons);
+  }
+}
+
+//------------------------------------------------------------------------------
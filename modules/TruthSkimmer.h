@@ -0,0 +1,90 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef TruthSkimmer_h
+#define TruthSkimmer_h
+
+/** \class TruthSkimmer
+ *
+ *  Walks the generator particles once and fills the arrays that
+ *  StatusPidFilter, TaggingParticlesSkimmer and the parton selection of
+ *  JetFlavorAssociation each get from their own pass:
+ *
+ *    filteredParticles - status 3 particles, leptons, neutrinos, b and t
+ *                        quarks and bosons above FilteredPTMin
+ *    taggingParticles  - hadronic taus replaced by their visible decay,
+ *                        then the other partons, within TaggingPTMin and
+ *                        TaggingEtaMax
+ *    partons           - quarks and gluons within PartonPTMin and
+ *                        PartonEtaMax
+ *    taus              - the visible hadronic taus of taggingParticles
+ *
+ *  The partons are found as the readers fill Delphes/partons.
+ *
+ */
+
+#include "classes/DelphesModule.h"
+
+#include <vector>
+
+class TIterator;
+class TObjArray;
+class Candidate;
+
+class TruthSkimmer: public DelphesModule
+{
+public:
+
+  TruthSkimmer();
+  ~TruthSkimmer();
+
+  void Init();
+  void Process();
+  void Finish();
+
+  Bool_t IsThreadSafe() const { return kTRUE; }
+
+private:
+
+  Double_t fFilteredPTMin; //!
+
+  Double_t fTaggingPTMin; //!
+  Double_t fTaggingEtaMax; //!
+
+  Double_t fPartonPTMin; //!
+  Double_t fPartonEtaMax; //!
+
+#if !defined(__CINT__) && !defined(__CLING__)
+  // partons that go to the tagging particles after the taus
+  std::vector< Candidate * > fTaggingPartons; //!
+#endif
+
+  TIterator *fItParticleInputArray; //!
+
+  const TObjArray *fParticleInputArray; //!
+
+  TObjArray *fFilteredOutputArray; //!
+  TObjArray *fTaggingOutputArray; //!
+  TObjArray *fPartonOutputArray; //!
+  TObjArray *fTauOutputArray; //!
+
+  ClassDef(TruthSkimmer, 1)
+};
+
+#endif
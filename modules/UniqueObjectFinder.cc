@@ -106,6 +106,11 @@ void UniqueObjectFinder::Process()
   map< TIterator *, TObjArray * >::iterator itInputMap;
   TIterator *iterator;
   TObjArray *array;
+  IDSet set;
+  Int_t numberOfPrevious;
+
+  fSets.clear();
+  fIDs.clear();
 
   // loop over all input arrays
   for(itInputMap = fInputMap.begin(); itInputMap != fInputMap.end(); ++itInputMap)
@@ -113,13 +118,22 @@ void UniqueObjectFinder::Process()
     iterator = itInputMap->first;
     array = itInputMap->second;
 
+    // only compare with the candidates of the previous arrays
+    numberOfPrevious = fSets.size();
+
     // loop over all candidates
     iterator->Reset();
     while((candidate = static_cast<Candidate*>(iterator->Next())))
     {
-      if(Unique(candidate, itInputMap))
+      BuildIDSet(candidate, set);
+      if(Unique(set, numberOfPrevious))
       {
         array->Add(candidate);
+        fSets.push_back(set);
+      }
+      else
+      {
+        fIDs.resize(set.begin);
       }
     }
   }
@@ -127,27 +141,53 @@ void UniqueObjectFinder::Process()
 
 //------------------------------------------------------------------------------
 
-Bool_t UniqueObjectFinder::Unique(Candidate *candidate, map< TIterator *, TObjArray * >::iterator itInputMap)
+void UniqueObjectFinder::BuildIDSet(const Candidate *candidate, IDSet &set)
 {
-  Candidate *previousCandidate;
-  map< TIterator *, TObjArray * >::iterator previousItInputMap;
-  TObjArray *array;
+  vector< UInt_t >::iterator itBegin, itIDs;
+
+  set.begin = fIDs.size();
+  candidate->CollectUniqueIDs(fIDs);
 
-  // loop over previous arrays
-  for(previousItInputMap = fInputMap.begin(); previousItInputMap != itInputMap; ++previousItInputMap)
+  itBegin = fIDs.begin() + set.begin;
+  sort(itBegin, fIDs.end());
+  fIDs.erase(unique(itBegin, fIDs.end()), fIDs.end());
+  set.end = fIDs.size();
+
+  set.signature = 0;
+  for(itIDs = fIDs.begin() + set.begin; itIDs != fIDs.end(); ++itIDs)
   {
-    array = previousItInputMap->second;
-    TIter iterator(array);
+    set.signature |= 1ULL << ((*itIDs * 0x9E3779B97F4A7C15ULL) >> 58);
+  }
+}
 
-    // loop over all candidates
-    iterator.Reset();
-    while((previousCandidate = static_cast<Candidate*>(iterator.Next())))
-    {
-      if(candidate->Overlaps(previousCandidate))
-      {
-        return kFALSE;
-      }
-    }
+//------------------------------------------------------------------------------
+
+Bool_t UniqueObjectFinder::Overlap(const IDSet &first, const IDSet &second) const
+{
+  Int_t i = first.begin, j = second.begin;
+
+  if((first.signature & second.signature) == 0) return kFALSE;
+
+  while(i < first.end && j < second.end)
+  {
+    if(fIDs[i] < fIDs[j]) ++i;
+    else if(fIDs[j] < fIDs[i]) ++j;
+    else return kTRUE;
+  }
+
+  return kFALSE;
+}
+
+//------------------------------------------------------------------------------
+
+Bool_t UniqueObjectFinder::Unique(const IDSet &set, Int_t numberOfPrevious) const
+{
+  Int_t i;
+
+  // same result as Candidate::Overlaps with all the previous candidates
+  for(i = 0; i < numberOfPrevious; ++i)
+  {
+    if(Overlap(set, fSets[i])) return kFALSE;
   }
 
   return kTRUE;
@@ -30,6 +30,7 @@
 #include "classes/DelphesModule.h"
 
 #include <map>
+#include <vector>
 
 class TIterator;
 class TObjArray;
@@ -46,12 +47,30 @@ public:
   void Process();
   void Finish();
 
+  Bool_t IsThreadSafe() const { return kTRUE; }
+
 private:
 
-  Bool_t Unique(Candidate *candidate, std::map< TIterator *, TObjArray * >::iterator itInputMap);
+  // sorted unique IDs of a candidate and of its constituents in fIDs, with
+  // one bit per ID hash in the signature to reject most pairs at once
+  struct IDSet
+  {
+    Int_t begin, end;
+    ULong64_t signature;
+  };
+
+  void BuildIDSet(const Candidate *candidate, IDSet &set);
+  Bool_t Overlap(const IDSet &first, const IDSet &second) const;
+  Bool_t Unique(const IDSet &set, Int_t numberOfPrevious) const;
 
   std::map< TIterator *, TObjArray * > fInputMap; //!
 
+#if !defined(__CINT__) && !defined(__CLING__)
+  // accepted candidates of the previous input arrays
+  std::vector< IDSet > fSets; //!
+  std::vector< UInt_t > fIDs; //!
+#endif
+
   ClassDef(UniqueObjectFinder, 1)
 };
 
@@ -50,24 +50,27 @@
 
 using namespace std;
 
-//------------------------------------------------------------------------------
+namespace
+{
 
-bool Weighter::TIndexStruct::operator< (const Weighter::TIndexStruct &value) const
+// sorted indices of up to four codes, 16 bits each, the zeros in front
+// leave the key unchanged, like the zeros padding the codes
+ULong64_t PackIndices(const Int_t *indices, Int_t n)
 {
+  ULong64_t key = 0;
   Int_t i;
 
-  for(i = 0; i < 4; ++i)
-  {
-    if(codes[i] != value.codes[i]) return codes[i] < value.codes[i];
-  }
+  for(i = 0; i < n; ++i) key = (key << 16) | ULong64_t(indices[i]);
 
-  return false;
+  return key;
 }
 
+} // namespace
+
 //------------------------------------------------------------------------------
 
 Weighter::Weighter() :
-  fItInputArray(0)
+  fNumberOfSets(1), fBlock(0), fItInputArray(0)
 {
 }
 
@@ -81,48 +84,88 @@ Weighter::~Weighter()
 
 void Weighter::Init()
 {
-  ExRootConfParam param, paramCodes;
-  Int_t i, j, size, sizeCodes;
-  Int_t code;
-  TIndexStruct index;
-  Double_t weight;
+  ExRootConfParam param, paramCodes, paramWeights;
+  Int_t i, j, size, sizeCodes, sizeWeights, row;
+  Int_t code, index;
+  Int_t indices[4];
+  ULong64_t key;
+  unordered_map< ULong64_t, Int_t >::iterator itRows;
+
+  fCodeIndices.clear();
+  fRows.clear();
 
-  fWeightSet.clear();
+  param = GetParam("Weight");
+  size = param.GetSize();
 
+  // the first Weight gives the number of weight sets
+  fNumberOfSets = size >= 2 ? param[1].GetSize() : 1;
+  if(fNumberOfSets < 1)
+  {
+    throw runtime_error("at least one weight must be specified per Weight");
+  }
 
-  // set default weight value
-  fWeightMap.clear();
-  memset(index.codes, 0, 4*sizeof(Int_t));
-  fWeightMap[index] = 1.0;
+  // set default weight values
+  fWeights.assign(fNumberOfSets, 1.0);
+  fRows[0] = 0;
 
   // read weights
-  param = GetParam("Weight");
-  size = param.GetSize();
   for(i = 0; i < size/2; ++i)
   {
     paramCodes = param[i*2];
     sizeCodes = paramCodes.GetSize();
-    weight = param[i*2 + 1].GetDouble();
+    paramWeights = param[i*2 + 1];
+    sizeWeights = paramWeights.GetSize();
 
     if(sizeCodes < 1 || sizeCodes > 4)
     {
       throw runtime_error("only 1, 2, 3 or 4 PDG codes can be specified per weight");
     }
 
-    memset(index.codes, 0, 4*sizeof(Int_t));
+    if(sizeWeights != fNumberOfSets)
+    {
+      throw runtime_error("all the Weight entries need the same number of weights, one per weight set");
+    }
 
     for(j = 0; j < sizeCodes; ++j)
     {
       code = paramCodes[j].GetInt();
-      index.codes[j] = code;
-      fWeightSet.insert(code);
+      if(fCodeIndices.find(code) == fCodeIndices.end())
+      {
+        index = code == 0 ? 0 : fCodeIndices.size() + 1;
+        if(index > 0xFFFF)
+        {
+          throw runtime_error("too many PDG codes in Weight");
+        }
+        fCodeIndices[code] = index;
+      }
+      indices[j] = fCodeIndices[code];
     }
 
-    sort(index.codes, index.codes + 4);
+    sort(indices, indices + sizeCodes);
+    key = PackIndices(indices, sizeCodes);
 
-    fWeightMap[index] = weight;
+    // a Weight given again replaces the previous one
+    itRows = fRows.find(key);
+    if(itRows == fRows.end())
+    {
+      row = fRows.size();
+      fRows[key] = row;
+      fWeights.resize((row + 1)*fNumberOfSets);
+    }
+    else
+    {
+      row = itRows->second;
+    }
+
+    for(j = 0; j < fNumberOfSets; ++j)
+    {
+      fWeights[row*fNumberOfSets + j] = paramWeights[j].GetDouble();
+    }
   }
 
+  fFound.assign(fCodeIndices.size() + 1, kFALSE);
+  fFoundIndices.reserve(fCodeIndices.size() + 1);
+
   // import input array(s)
 
   fInputArray = ImportArray(GetString("InputArray", "Delphes/allParticles"));
@@ -131,6 +174,8 @@ void Weighter::Init()
   // create output array(s)
 
   fOutputArray = ExportArray(GetString("OutputArray", "weight"));
+
+  fBlock = GetFactory()->NewWeightBlock(fOutputArray, fNumberOfSets);
 }
 
 //------------------------------------------------------------------------------
@@ -145,51 +190,52 @@ void Weighter::Finish()
 void Weighter::Process()
 {
   Candidate *candidate;
-  Int_t i;
-  TIndexStruct index;
-  Double_t weight;
-  set<Int_t>::iterator itCodeSet;
-  map<TIndexStruct, Double_t>::iterator itWeightMap;
+  Int_t index, row;
+  unordered_map< Int_t, Int_t >::const_iterator itCodeIndices;
+  unordered_map< ULong64_t, Int_t >::const_iterator itRows;
+  vector< Int_t >::const_iterator itFoundIndices;
 
   DelphesFactory *factory = GetFactory();
 
   // loop over all particles
-  fCodeSet.clear();
+  fFoundIndices.clear();
   fItInputArray->Reset();
   while((candidate = static_cast<Candidate*>(fItInputArray->Next())))
   {
     if(candidate->Status != 3) continue;
 
-    if(fWeightSet.find(candidate->PID) == fWeightSet.end()) continue;
+    itCodeIndices = fCodeIndices.find(candidate->PID);
+    if(itCodeIndices == fCodeIndices.end()) continue;
 
-    fCodeSet.insert(candidate->PID);
-  }
+    index = itCodeIndices->second;
+    if(fFound[index]) continue;
 
-  // find default weight value
-  memset(index.codes, 0, 4*sizeof(Int_t));
-  itWeightMap = fWeightMap.find(index);
-  weight = itWeightMap->second;
+    fFound[index] = kTRUE;
+    fFoundIndices.push_back(index);
+  }
 
-  if(fCodeSet.size() <= 4)
+  for(itFoundIndices = fFoundIndices.begin(); itFoundIndices != fFoundIndices.end(); ++itFoundIndices)
   {
-    i = 0;
-    for(itCodeSet = fCodeSet.begin(); itCodeSet != fCodeSet.end(); ++itCodeSet)
-    {
-      index.codes[i] = *itCodeSet;
-      ++i;
-    }
+    fFound[*itFoundIndices] = kFALSE;
+  }
 
-    sort(index.codes, index.codes + 4);
+  // find the weights of all the sets, the default ones without a match
+  row = 0;
+  if(fFoundIndices.size() <= 4)
+  {
+    sort(fFoundIndices.begin(), fFoundIndices.end());
 
-    itWeightMap = fWeightMap.find(index);
-    if(itWeightMap != fWeightMap.end())
+    itRows = fRows.find(PackIndices(fFoundIndices.data(), fFoundIndices.size()));
+    if(itRows != fRows.end())
     {
-      weight = itWeightMap->second;
+      row = itRows->second;
     }
   }
 
+  copy(fWeights.begin() + row*fNumberOfSets, fWeights.begin() + (row + 1)*fNumberOfSets, fBlock);
+
   candidate = factory->NewCandidate();
-  candidate->Momentum.SetPtEtaPhiE(weight, 0.0, 0.0, weight);
+  candidate->Momentum.SetPtEtaPhiE(fBlock[0], 0.0, 0.0, fBlock[0]);
   fOutputArray->Add(candidate);
 }
 
@@ -23,14 +23,22 @@
  *
  *  Apply a weight depending on PDG code.
  *
+ *  Each Weight gives the codes of up to four initial-state particles and
+ *  one weight, or a list of weights, one for each weight set. The codes
+ *  get dense indices, and the sorted indices of a Weight packed into one
+ *  key find its row of weights, so that one pass over the particles gives
+ *  the weights of all the sets. They go to a block of the factory next to
+ *  the output array, see DelphesFactory::GetWeightBlock, and the candidate
+ *  of the output array holds the weight of the first set.
+ *
  *  \author P. Demin - UCL, Louvain-la-Neuve
  *
  */
 
 #include "classes/DelphesModule.h"
 
-#include <set>
-#include <map>
+#include <vector>
+#include <unordered_map>
 
 class TObjArray;
 
@@ -45,19 +53,29 @@ public:
   void Process();
   void Finish();
 
+  Bool_t IsThreadSafe() const { return kTRUE; }
+
 private:
 
+  Int_t fNumberOfSets;
+
 #if !defined(__CINT__) && !defined(__CLING__)
-  struct TIndexStruct
-  {
-    Int_t codes[4];
-    bool operator< (const TIndexStruct &value) const;
-  };
-
-  std::set<Int_t> fWeightSet, fCodeSet;
-  std::map<TIndexStruct, Double_t> fWeightMap;
+  // index of every configured code from 1, code 0 keeps 0
+  std::unordered_map< Int_t, Int_t > fCodeIndices;
+
+  // row of the packed sorted indices of each Weight, row 0 is the default
+  std::unordered_map< ULong64_t, Int_t > fRows;
+
+  // fNumberOfSets weights per row
+  std::vector< Double_t > fWeights;
+
+  // indices of the codes found in the event
+  std::vector< Bool_t > fFound;
+  std::vector< Int_t > fFoundIndices;
 #endif
 
+  Double_t *fBlock; //!
+
   TIterator *fItInputArray; //!
 
   const TObjArray *fInputArray; //!
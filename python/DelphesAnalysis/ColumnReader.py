@@ -0,0 +1,102 @@
+import numpy
+import Delphes
+from ROOT import TChain,ExRootTreeReader,std
+from collections import Iterable
+from types import StringTypes
+from os import path
+
+class Column(object):
+   """Values of one leaf for a range of events.
+      values holds the values of all the events one after the other,
+      those of the i-th event are values[offsets[i]:offsets[i+1]]."""
+
+   def __init__(self, values, offsets):
+     self.values  = values
+     self.offsets = offsets
+
+   def __len__(self):
+     """Number of events"""
+     return len(self.offsets)-1
+
+   def counts(self):
+     """Number of values of every event, e.g. the number of jets"""
+     return numpy.diff(self.offsets)
+
+   def event(self, index):
+     """Values of one event"""
+     return self.values[self.offsets[index]:self.offsets[index+1]]
+
+   def first(self, default=0.):
+     """Value of the first object of every event (the leading one for sorted
+        collections), default for the events without any."""
+     result = numpy.full(len(self), default, dtype=self.values.dtype)
+     filled = self.offsets[1:] > self.offsets[:-1]
+     result[filled] = self.values[self.offsets[:-1][filled]]
+     return result
+
+   def sum(self):
+     """Sum of the values of every event"""
+     total = numpy.concatenate(([0.],numpy.cumsum(self.values)))
+     return total[self.offsets[1:]] - total[self.offsets[:-1]]
+
+class ColumnReader(object):
+   """Reads leaves of the Delphes tree, e.g. "Jet.PT", into numpy arrays for
+      many events at once, through ExRootTreeReader::ReadLeaf, instead of
+      looping over the events and the objects in python.
+      collections maps the labels of the analysis to branch names, so that
+      "jets.PT" reads "Jet.PT" with {"jets":"Jet"}."""
+
+   def __init__(self, inputFiles = '', collections = {}, maxEvents=0, cacheSize=0):
+     self._chain = TChain("Delphes","Delphes")
+     if isinstance(inputFiles,Iterable) and not isinstance(inputFiles,StringTypes):
+       files = inputFiles
+     else:
+       files = [ inputFiles ]
+     for thefile in files:
+       if path.isfile(thefile):
+         self._chain.AddFile(thefile)
+       else:
+         print "Warning: ",thefile," do not exist."
+     self._reader = ExRootTreeReader(self._chain)
+     if cacheSize > 0:
+       self._reader.SetCacheSize(cacheSize)
+     self._collections = dict(collections)
+     self._maxEvents = maxEvents
+     self._values  = std.vector('double')()
+     self._offsets = std.vector('Long64_t')()
+
+   def entries(self):
+     """Number of events to read"""
+     entries = self._chain.GetEntries()
+     if self._maxEvents > 0:
+       return min(entries, self._maxEvents)
+     return entries
+
+   def leafName(self, column):
+     """Leaf read for a column, with the collection label replaced by the branch name"""
+     label, dot, member = column.partition('.')
+     return self._collections.get(label,label) + dot + member
+
+   def read(self, columns, first=0, last=None):
+     """Read the columns for the events from first to last excluded.
+        Returns a dictionary of Column objects."""
+     if last is None or last > self.entries():
+       last = self.entries()
+     result = {}
+     for column in columns:
+       leaf = self.leafName(column)
+       if self._reader.ReadLeaf(leaf, first, last, self._values, self._offsets) != last-first:
+         raise KeyError("cannot read leaf %r" % leaf)
+       values  = numpy.empty(self._values.size(), dtype=numpy.float64)
+       offsets = numpy.empty(self._offsets.size(), dtype=numpy.int_)
+       if len(values):
+         ExRootTreeReader.CopyValues(self._values, values)
+       ExRootTreeReader.CopyOffsets(self._offsets, offsets)
+       result[column] = Column(values, offsets)
+     return result
+
+   def iterate(self, columns, step=10000):
+     """Iterator over blocks of step events, yields the first event of the
+        block and the dictionary of its columns."""
+     for first in xrange(0, self.entries(), step):
+       yield first, self.read(columns, first, first+step)
@@ -17,10 +17,18 @@ def DumpEventList(category, path="./", output="eventlist.txt"):
     files=[path]
   else:
     files=[]
-  # events
-  events = AnalysisEvent(files)
   # output
   event_list = open(output,"w")
+  # select all the events of a block at once when possible
+  if EventSelection.isVectorized():
+    reader = EventSelection.newColumnReader(files)
+    for first, columns in reader.iterate(EventSelection.columns + ["Event.Number"]):
+      selected = EventSelection.isInCategoryArrays(category, EventSelection.eventCategoryArrays(columns))
+      for number in columns["Event.Number"].first()[selected]:
+        print >> event_list , "Event", int(number)
+    return
+  # events
+  events = AnalysisEvent(files)
   # collections and producers used in the analysis
   EventSelection.prepareAnalysisEvent(events)
   for event in events:
@@ -22,11 +22,20 @@ def isInCategory(category, categoryData):
   raise NotImplementedError
   return True
 
+# It may also define the following, to select the events with numpy arrays
+# read for many events at once by a ColumnReader:
+# - columns (list of "collection.Member" leaves used)
+# - eventCategoryArrays (same as eventCategory, with one array per item)
+# - isInCategoryArrays (same as isInCategory, returns an array of booleans)
+
 # specific implementation of the "virtual methods" above
 EventSelectionImplementation = __import__(configuration.eventSelection)
 categoryNames  = EventSelectionImplementation.categoryNames
 eventCategory  = EventSelectionImplementation.eventCategory
 isInCategory   = EventSelectionImplementation.isInCategory
+columns             = getattr(EventSelectionImplementation, "columns", [])
+eventCategoryArrays = getattr(EventSelectionImplementation, "eventCategoryArrays", None)
+isInCategoryArrays  = getattr(EventSelectionImplementation, "isInCategoryArrays", None)
 
 # Functions below should not be touched in any implementation.
 
@@ -50,6 +59,15 @@ def categoriesHierarchy():
     p[splitted[-1]] = i
   return dct
 
+def isVectorized():
+  """Check if the implementation can select events from ColumnReader arrays"""
+  return eventCategoryArrays is not None and isInCategoryArrays is not None
+
+def newColumnReader(inputFiles, maxEvents=0):
+  """Return a ColumnReader knowing the collection labels of the configuration"""
+  from ColumnReader import ColumnReader
+  return ColumnReader(inputFiles, dict((coll.label,coll.collection) for coll in configuration.eventCollections), maxEvents)
+
 def prepareAnalysisEvent(event):
   """Define collections and producers"""
   for coll in configuration.eventCollections:
@@ -1,5 +1,5 @@
 __all__ = [ "Delphes", 
-            "AnalysisEvent", 
+            "AnalysisEvent", "ColumnReader", 
             "BaseControlPlots", "BaseWeightClass", 
             "EventSelection", 
             "EventSelectionControlPlots", 
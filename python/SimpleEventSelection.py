@@ -1,3 +1,5 @@
+import numpy
+
 #very simple EventSelection class aimed at demonstrating the 
 #typical implementation of an EventSelection class
 
@@ -51,3 +53,29 @@ def isInCategory(category, categoryData):
   else:
     return False
 
+# the same, for all the events read by a ColumnReader at once
+
+columns = [ "muons.PT", "electrons.PT", "jets.PT" ]
+
+def eventCategoryArrays(columns):
+  """Same as eventCategory, with one array per item"""
+  muons = columns["muons.PT"]
+  electrons = columns["electrons.PT"]
+  jets = columns["jets.PT"]
+  return [ muons.counts(), electrons.counts(), jets.counts(), muons.first(0.)>1., electrons.first(0.)>1. ]
+
+def isInCategoryArrays(category, categoryData):
+  """Same as isInCategory, returns an array of booleans"""
+  if category==0:
+    return categoryData[0]>0
+  elif category==1:
+    return categoryData[1]>0
+  elif category==2:
+    return categoryData[2]>0
+  elif category==3:
+    return isInCategoryArrays(0,categoryData) & categoryData[3]
+  elif category==4:
+    return isInCategoryArrays(1,categoryData) & categoryData[4]
+  else:
+    return numpy.zeros(len(categoryData[0]), dtype=bool)
+
@@ -23,6 +23,7 @@
 #include <memory>
 
 #include <map>
+#include <unordered_map>
 #include <vector>
 
 #include <stdlib.h>
@@ -33,16 +34,18 @@
 #include "TApplication.h"
 
 #include "TFile.h"
+#include "TTree.h"
 #include "TObjArray.h"
 #include "TStopwatch.h"
-#include "TDatabasePDG.h"
-#include "TParticlePDG.h"
 #include "TLorentzVector.h"
 
 #include "modules/Delphes.h"
+#include "modules/DelphesMetrics.h"
+#include "modules/DelphesReaderThread.h"
 #include "classes/DelphesStream.h"
 #include "classes/DelphesClasses.h"
 #include "classes/DelphesFactory.h"
+#include "classes/DelphesPDGTable.h"
 
 #include "ExRootAnalysis/ExRootTreeWriter.h"
 #include "ExRootAnalysis/ExRootTreeBranch.h"
@@ -62,75 +65,86 @@ using namespace std;
 
 //---------------------------------------------------------------------------
 
-void ConvertInput(fwlite::Event &event, Long64_t eventCounter,
-  ExRootTreeBranch *branchEvent, ExRootTreeBranch *branchRwgt,
-  DelphesFactory *factory, TObjArray *allParticleOutputArray,
-  TObjArray *stableParticleOutputArray, TObjArray *partonOutputArray)
+// Reads the generator products of the events. The handles and the index of
+// the particles are kept from one event to the next, and the event
+// information is copied, so that with ReadAheadEvents the event is read on
+// the reader thread and written to the Event branch on the main thread.
+
+class FWLiteEventReader
 {
-  fwlite::Handle< GenEventInfoProduct > handleGenEventInfo;
+public:
 
-  fwlite::Handle< LHEEventProduct > handleLHEEvent;
+  void ReadEvent(fwlite::Event &event, DelphesFactory *factory,
+    TObjArray *allParticleOutputArray, TObjArray *stableParticleOutputArray,
+    TObjArray *partonOutputArray);
 
-  fwlite::Handle< vector< reco::GenParticle > > handleParticle;
-  vector< reco::GenParticle >::const_iterator itParticle;
+  void AnalyzeEvent(Long64_t eventCounter, ExRootTreeBranch *branchEvent,
+    ExRootTreeBranch *branchRwgt);
 
-  vector< const reco::Candidate * > vectorCandidate;
-  vector< const reco::Candidate * >::iterator itCandidate;
+private:
 
-  handleGenEventInfo.getByLabel(event, "generator");
-  handleLHEEvent.getByLabel(event, "source");
-  handleParticle.getByLabel(event, "genParticles");
+  fwlite::Handle< GenEventInfoProduct > fHandleGenEventInfo;
+  fwlite::Handle< LHEEventProduct > fHandleLHEEvent;
+  fwlite::Handle< vector< reco::GenParticle > > fHandleParticle;
+
+  // position of every particle in the collection
+  unordered_map< const reco::Candidate *, Int_t > fIndices;
+
+  Int_t fProcessID;
+  Double_t fWeight, fScale, fAlphaQED, fAlphaQCD;
+  vector< Double_t > fWeights;
+};
+
+//---------------------------------------------------------------------------
+
+void FWLiteEventReader::ReadEvent(fwlite::Event &event, DelphesFactory *factory,
+  TObjArray *allParticleOutputArray, TObjArray *stableParticleOutputArray,
+  TObjArray *partonOutputArray)
+{
+  vector< reco::GenParticle >::const_iterator itParticle;
+  unordered_map< const reco::Candidate *, Int_t >::const_iterator itIndex;
 
-  HepMCEvent *element;
-  Weight *weight;
   Candidate *candidate;
-  TDatabasePDG *pdg;
-  TParticlePDG *pdgParticle;
+  const DelphesPDGTable *pdg;
+  const DelphesPDGTable::Entry *pdgParticle;
   Int_t pdgCode;
 
   Int_t pid, status;
   Double_t px, py, pz, e, mass;
   Double_t x, y, z;
 
-  const vector< gen::WeightsInfo > &vectorWeightsInfo = handleLHEEvent->weights();
   vector< gen::WeightsInfo >::const_iterator itWeightsInfo;
 
-  element = static_cast<HepMCEvent *>(branchEvent->NewEntry());
+  fHandleGenEventInfo.getByLabel(event, "generator");
+  fHandleLHEEvent.getByLabel(event, "source");
+  fHandleParticle.getByLabel(event, "genParticles");
 
-  element->Number = eventCounter;
+  fProcessID = fHandleGenEventInfo->signalProcessID();
+  fWeight = fHandleGenEventInfo->weight();
+  fScale = fHandleGenEventInfo->qScale();
+  fAlphaQED = fHandleGenEventInfo->alphaQED();
+  fAlphaQCD = fHandleGenEventInfo->alphaQCD();
 
-  element->ProcessID = handleGenEventInfo->signalProcessID();
-  element->MPI = 1;
-  element->Weight = handleGenEventInfo->weight();
-  element->Scale = handleGenEventInfo->qScale();
-  element->AlphaQED = handleGenEventInfo->alphaQED();
-  element->AlphaQCD = handleGenEventInfo->alphaQCD();
-
-  element->ID1 = 0;
-  element->ID2 = 0;
-  element->X1 = 0.0;
-  element->X2 = 0.0;
-  element->ScalePDF = 0.0;
-  element->PDF1 = 0.0;
-  element->PDF2 = 0.0;
-
-  element->ReadTime = 0.0;
-  element->ProcTime = 0.0;
+  const vector< gen::WeightsInfo > &vectorWeightsInfo = fHandleLHEEvent->weights();
 
+  fWeights.clear();
   for(itWeightsInfo = vectorWeightsInfo.begin(); itWeightsInfo != vectorWeightsInfo.end(); ++itWeightsInfo)
   {
-    weight = static_cast<Weight *>(branchRwgt->NewEntry());
-    weight->Weight = itWeightsInfo->wgt;
+    fWeights.push_back(itWeightsInfo->wgt);
   }
 
-  pdg = TDatabasePDG::Instance();
+  pdg = DelphesPDGTable::Instance();
 
-  for(itParticle = handleParticle->begin(); itParticle != handleParticle->end(); ++itParticle)
+  // the mothers and daughters are found in the index instead of by a
+  // search through the whole collection for every particle
+  fIndices.clear();
+  fIndices.reserve(fHandleParticle->size());
+  for(itParticle = fHandleParticle->begin(); itParticle != fHandleParticle->end(); ++itParticle)
   {
-    vectorCandidate.push_back(&*itParticle);
+    fIndices.insert(make_pair(static_cast< const reco::Candidate * >(&*itParticle), Int_t(fIndices.size())));
   }
 
-  for(itParticle = handleParticle->begin(); itParticle != handleParticle->end(); ++itParticle)
+  for(itParticle = fHandleParticle->begin(); itParticle != fHandleParticle->end(); ++itParticle)
   {
     const reco::GenParticle &particle = *itParticle;
 
@@ -148,18 +162,18 @@ void ConvertInput(fwlite::Event &event, Long64_t eventCounter,
 
     if(particle.mother())
     {
-      itCandidate = find(vectorCandidate.begin(), vectorCandidate.end(), particle.mother());
-      if(itCandidate != vectorCandidate.end()) candidate->M1 = distance(vectorCandidate.begin(), itCandidate);
+      itIndex = fIndices.find(particle.mother());
+      if(itIndex != fIndices.end()) candidate->M1 = itIndex->second;
     }
 
-    itCandidate = find(vectorCandidate.begin(), vectorCandidate.end(), particle.daughter(0));
-    if(itCandidate != vectorCandidate.end()) candidate->D1 = distance(vectorCandidate.begin(), itCandidate);
+    itIndex = fIndices.find(particle.daughter(0));
+    if(itIndex != fIndices.end()) candidate->D1 = itIndex->second;
 
-    itCandidate = find(vectorCandidate.begin(), vectorCandidate.end(), particle.daughter(particle.numberOfDaughters() - 1));
-    if(itCandidate != vectorCandidate.end()) candidate->D2 = distance(vectorCandidate.begin(), itCandidate);
+    itIndex = fIndices.find(particle.daughter(particle.numberOfDaughters() - 1));
+    if(itIndex != fIndices.end()) candidate->D2 = itIndex->second;
 
-    pdgParticle = pdg->GetParticle(pid);
-    candidate->Charge = pdgParticle ? Int_t(pdgParticle->Charge()/3.0) : -999;
+    pdgParticle = pdg->Find(pid);
+    candidate->Charge = pdgParticle ? pdgParticle->charge : -999;
     candidate->Mass = mass;
 
     candidate->Momentum.SetPxPyPzE(px, py, pz, e);
@@ -183,6 +197,44 @@ void ConvertInput(fwlite::Event &event, Long64_t eventCounter,
 
 //---------------------------------------------------------------------------
 
+void FWLiteEventReader::AnalyzeEvent(Long64_t eventCounter, ExRootTreeBranch *branchEvent,
+  ExRootTreeBranch *branchRwgt)
+{
+  HepMCEvent *element;
+  Weight *weight;
+  vector< Double_t >::const_iterator itWeights;
+
+  element = static_cast<HepMCEvent *>(branchEvent->NewEntry());
+
+  element->Number = eventCounter;
+
+  element->ProcessID = fProcessID;
+  element->MPI = 1;
+  element->Weight = fWeight;
+  element->Scale = fScale;
+  element->AlphaQED = fAlphaQED;
+  element->AlphaQCD = fAlphaQCD;
+
+  element->ID1 = 0;
+  element->ID2 = 0;
+  element->X1 = 0.0;
+  element->X2 = 0.0;
+  element->ScalePDF = 0.0;
+  element->PDF1 = 0.0;
+  element->PDF2 = 0.0;
+
+  element->ReadTime = 0.0;
+  element->ProcTime = 0.0;
+
+  for(itWeights = fWeights.begin(); itWeights != fWeights.end(); ++itWeights)
+  {
+    weight = static_cast<Weight *>(branchRwgt->NewEntry());
+    weight->Weight = *itWeights;
+  }
+}
+
+//---------------------------------------------------------------------------
+
 static bool interrupted = false;
 
 void SignalHandler(int sig)
@@ -205,7 +257,13 @@ int main(int argc, char *argv[])
   Delphes *modularDelphes = 0;
   DelphesFactory *factory = 0;
   TObjArray *allParticleOutputArray = 0, *stableParticleOutputArray = 0, *partonOutputArray = 0;
-  Int_t i;
+  FWLiteEventReader *reader = 0;
+  vector< FWLiteEventReader * > readers;
+  vector< FWLiteEventReader * >::iterator itReaders;
+  DelphesReaderThread *readerThread = 0;
+  DelphesReaderSlot *readerSlot = 0;
+  TTree *inputTree;
+  Int_t i, readAheadEvents, cacheSize;
   Long64_t eventCounter, numberOfEvents;
 
   if(argc < 4)
@@ -254,8 +312,38 @@ int main(int argc, char *argv[])
     stableParticleOutputArray = modularDelphes->ExportArray("stableParticles");
     partonOutputArray = modularDelphes->ExportArray("partons");
 
+    // decode the products of the next events on a second thread while this
+    // one simulates
+    readAheadEvents = confReader->GetInt("::ReadAheadEvents", 0);
+    if(readAheadEvents > 0)
+    {
+      readerThread = new DelphesReaderThread(readAheadEvents);
+      for(i = 0; i < readerThread->GetNumberOfSlots(); ++i)
+      {
+        readers.push_back(new FWLiteEventReader);
+      }
+    }
+    else
+    {
+      reader = new FWLiteEventReader;
+    }
+
+    // size in MB of the TTreeCache of the Events tree, zero leaves it alone
+    cacheSize = confReader->GetInt("::InputCacheSize", 30);
+
+    if(cacheSize < 0)
+    {
+      throw runtime_error("InputCacheSize must be zero or positive");
+    }
+
     modularDelphes->InitTask();
 
+    if(readerThread && modularDelphes->GetMetrics())
+    {
+      modularDelphes->GetMetrics()->AddGauge("read_ahead_events",
+        [readerThread] { return Long64_t(readerThread->GetNumberOfReadySlots()); });
+    }
+
     for(i = 3; i < argc && !interrupted; ++i)
     {
       cout << "** Reading " << argv[i] << endl;
@@ -270,6 +358,11 @@ int main(int argc, char *argv[])
 
       fwlite::Event event(inputFile);
 
+      // the cache reads the baskets of the branches in use, which it learns
+      // from the first entries, in a few large requests
+      inputTree = static_cast<TTree *>(inputFile->Get("Events"));
+      if(inputTree && cacheSize > 0) inputTree->SetCacheSize(Long64_t(cacheSize)*1024*1024);
+
       numberOfEvents = event.size();
 
       if(numberOfEvents <= 0) continue;
@@ -281,19 +374,55 @@ int main(int argc, char *argv[])
       eventCounter = 0;
       modularDelphes->Clear();
       treeWriter->Clear();
-      for(event.toBegin(); !event.atEnd() && !interrupted; ++event)
+      if(readerThread)
       {
-        ConvertInput(event, eventCounter, branchEvent, branchRwgt, factory,
-          allParticleOutputArray, stableParticleOutputArray, partonOutputArray);
-        modularDelphes->ProcessTask();
+        // only the reader thread touches the event until it stops
+        event.toBegin();
+        readerThread->Start([&event, &readers](DelphesReaderSlot &slot) -> Bool_t
+        {
+          if(event.atEnd()) return kFALSE;
+          readers[slot.index]->ReadEvent(event, slot.factory, slot.allParticleOutputArray,
+            slot.stableParticleOutputArray, slot.partonOutputArray);
+          ++event;
+          return kTRUE;
+        });
+
+        while(!interrupted && (readerSlot = readerThread->NextSlot()))
+        {
+          readerThread->CopyParticles(*readerSlot, factory, allParticleOutputArray,
+            stableParticleOutputArray, partonOutputArray);
+          readers[readerSlot->index]->AnalyzeEvent(eventCounter, branchEvent, branchRwgt);
+          readerThread->ReleaseSlot(readerSlot);
+
+          modularDelphes->ProcessTask();
+
+          if(!modularDelphes->IsEventRejected()) treeWriter->Fill();
+
+          modularDelphes->Clear();
+          treeWriter->Clear();
+
+          progressBar.Update(eventCounter, eventCounter);
+          ++eventCounter;
+        }
+        readerThread->Stop();
+      }
+      else
+      {
+        for(event.toBegin(); !event.atEnd() && !interrupted; ++event)
+        {
+          reader->ReadEvent(event, factory, allParticleOutputArray,
+            stableParticleOutputArray, partonOutputArray);
+          reader->AnalyzeEvent(eventCounter, branchEvent, branchRwgt);
+          modularDelphes->ProcessTask();
 
-        treeWriter->Fill();
+          if(!modularDelphes->IsEventRejected()) treeWriter->Fill();
 
-        modularDelphes->Clear();
-        treeWriter->Clear();
+          modularDelphes->Clear();
+          treeWriter->Clear();
 
-        progressBar.Update(eventCounter, eventCounter);
-        ++eventCounter;
+          progressBar.Update(eventCounter, eventCounter);
+          ++eventCounter;
+        }
       }
 
       progressBar.Update(eventCounter, eventCounter, kTRUE);
@@ -307,6 +436,12 @@ int main(int argc, char *argv[])
 
     cout << "** Exiting..." << endl;
 
+    delete reader;
+    for(itReaders = readers.begin(); itReaders != readers.end(); ++itReaders)
+    {
+      delete *itReaders;
+    }
+    delete readerThread;
     delete modularDelphes;
     delete confReader;
     delete treeWriter;
@@ -316,6 +451,7 @@ int main(int argc, char *argv[])
   }
   catch(runtime_error &e)
   {
+    if(readerThread) delete readerThread;
     if(treeWriter) delete treeWriter;
     if(outputFile) delete outputFile;
     cerr << "** ERROR: " << e.what() << endl;
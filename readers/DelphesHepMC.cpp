@@ -19,6 +19,7 @@
 #include <stdexcept>
 #include <iostream>
 #include <sstream>
+#include <vector>
 
 #include <signal.h>
 
@@ -33,9 +34,15 @@
 #include "TLorentzVector.h"
 
 #include "modules/Delphes.h"
+#include "modules/DelphesWorkerPool.h"
+#include "modules/DelphesReaderThread.h"
+#include "modules/DelphesMetrics.h"
 #include "classes/DelphesClasses.h"
 #include "classes/DelphesFactory.h"
+#include "classes/DelphesEventIndex.h"
+#include "classes/DelphesInputFile.h"
 #include "classes/DelphesHepMCReader.h"
+#include "classes/DelphesLineReader.h"
 
 #include "ExRootAnalysis/ExRootTreeWriter.h"
 #include "ExRootAnalysis/ExRootTreeBranch.h"
@@ -54,10 +61,44 @@ void SignalHandler(int sig)
 
 //---------------------------------------------------------------------------
 
+// removes --shard i/N from the arguments, false if it is malformed
+static bool ParseShard(int &argc, char *argv[], Int_t &shard, Int_t &shards)
+{
+  int i, j;
+  char end;
+
+  for(i = 1, j = 1; i < argc; ++i)
+  {
+    if(strcmp(argv[i], "--shard") == 0)
+    {
+      if(i + 1 == argc) return false;
+      ++i;
+      if(sscanf(argv[i], "%d/%d%c", &shard, &shards, &end) != 2) return false;
+      if(shards < 1 || shard < 0 || shard >= shards) return false;
+      continue;
+    }
+    argv[j++] = argv[i];
+  }
+  argc = j;
+  return true;
+}
+
+//---------------------------------------------------------------------------
+
+// the events before SkipEvents and the ones of the other shards are passed
+// over without reading their particles
+static bool ScanOnly(Long64_t eventCounter, Long64_t skipEvents, Int_t shard, Int_t shards)
+{
+  return eventCounter < skipEvents || (eventCounter - skipEvents) % shards != shard;
+}
+
+//---------------------------------------------------------------------------
+
 int main(int argc, char *argv[])
 {
   char appName[] = "DelphesHepMC";
   stringstream message;
+  DelphesInputFile *input = 0;
   FILE *inputFile = 0;
   TFile *outputFile = 0;
   TStopwatch readStopWatch, procStopWatch;
@@ -68,15 +109,26 @@ int main(int argc, char *argv[])
   DelphesFactory *factory = 0;
   TObjArray *stableParticleOutputArray = 0, *allParticleOutputArray = 0, *partonOutputArray = 0;
   DelphesHepMCReader *reader = 0;
-  Int_t i, maxEvents, skipEvents;
-  Long64_t length, eventCounter;
-
-  if(argc < 3)
+  vector< DelphesHepMCReader * > readers;
+  vector< DelphesHepMCReader * >::iterator itReaders;
+  DelphesLineReader *lineReader = 0;
+  DelphesWorkerPool *workerPool = 0;
+  DelphesWorkerSlot *slot = 0;
+  DelphesReaderThread *readerThread = 0;
+  DelphesReaderSlot *readerSlot = 0;
+  Bool_t eventReady, useAllParticles, useStableParticles, usePartons;
+  Int_t i, maxEvents, skipEvents, numberOfThreads, shard = 0, shards = 1, readAheadEvents;
+  Long64_t length, eventCounter, firstEvent, offset, scannedEvents;
+
+  if(!ParseShard(argc, argv, shard, shards) || argc < 3)
   {
-    cout << " Usage: " << appName << " config_file" << " output_file" << " [input_file(s)]" << endl;
+    cout << " Usage: " << appName << " [--shard i/N]" << " config_file" << " output_file" << " [input_file(s)]" << endl;
+    cout << " --shard i/N - process only the events i, i+N, i+2N... counted from 0 after SkipEvents," << endl;
     cout << " config_file - configuration file in Tcl format," << endl;
     cout << " output_file - output file in ROOT format," << endl;
+    cout << " or - to skip the ROOT output (remove TreeWriter from the ExecutionPath)," << endl;
     cout << " input_file(s) - input file(s) in HepMC format," << endl;
+    cout << " which can be compressed with gzip, zstd or xz," << endl;
     cout << " with no input_file, or when input_file is -, read standard input." << endl;
     return 1;
   }
@@ -91,17 +143,20 @@ int main(int argc, char *argv[])
 
   try
   {
-    outputFile = TFile::Open(argv[2], "CREATE");
-
-    if(outputFile == NULL)
+    if(strncmp(argv[2], "-", 2) != 0)
     {
-      message << "can't create output file " << argv[2];
-      throw runtime_error(message.str());
-    }
+      outputFile = TFile::Open(argv[2], "CREATE");
+
+      if(outputFile == NULL)
+      {
+        message << "can't create output file " << argv[2];
+        throw runtime_error(message.str());
+      }
 
-    treeWriter = new ExRootTreeWriter(outputFile, "Delphes");
+      treeWriter = new ExRootTreeWriter(outputFile, "Delphes");
 
-    branchEvent = treeWriter->NewBranch("Event", HepMCEvent::Class());
+      branchEvent = treeWriter->NewBranch("Event", HepMCEvent::Class());
+    }
 
     confReader = new ExRootConfReader;
     confReader->ReadFile(argv[1]);
@@ -119,18 +174,93 @@ int main(int argc, char *argv[])
       throw runtime_error("SkipEvents must be zero or positive");
     }
 
-    modularDelphes = new Delphes("Delphes");
-    modularDelphes->SetConfReader(confReader);
-    modularDelphes->SetTreeWriter(treeWriter);
+    numberOfThreads = confReader->GetInt("::NumberOfThreads", 1);
+
+    if(numberOfThreads < 1)
+    {
+      throw runtime_error("NumberOfThreads must be positive");
+    }
+
+    if(numberOfThreads == 1)
+    {
+      modularDelphes = new Delphes("Delphes");
+      modularDelphes->SetConfReader(confReader);
+      if(treeWriter) modularDelphes->SetTreeWriter(treeWriter);
+
+      factory = modularDelphes->GetFactory();
+      allParticleOutputArray = modularDelphes->ExportArray("allParticles");
+      stableParticleOutputArray = modularDelphes->ExportArray("stableParticles");
+      partonOutputArray = modularDelphes->ExportArray("partons");
+
+      // parse the next events on a second thread while this one simulates
+      readAheadEvents = confReader->GetInt("::ReadAheadEvents", 0);
+      if(readAheadEvents > 0)
+      {
+        readerThread = new DelphesReaderThread(readAheadEvents);
+        for(i = 0; i < readerThread->GetNumberOfSlots(); ++i)
+        {
+          readers.push_back(new DelphesHepMCReader);
+        }
+      }
+      else
+      {
+        reader = new DelphesHepMCReader;
+      }
+
+      modularDelphes->InitTask();
+
+      if(readerThread && modularDelphes->GetMetrics())
+      {
+        modularDelphes->GetMetrics()->AddGauge("read_ahead_events",
+          [readerThread] { return Long64_t(readerThread->GetNumberOfReadySlots()); });
+      }
+
+      // the readers only fill the arrays that the modules read
+      useAllParticles = modularDelphes->IsArrayImported(allParticleOutputArray);
+      useStableParticles = modularDelphes->IsArrayImported(stableParticleOutputArray);
+      usePartons = modularDelphes->IsArrayImported(partonOutputArray);
+      if(reader) reader->SetUsedArrays(useAllParticles, useStableParticles, usePartons);
+      for(itReaders = readers.begin(); itReaders != readers.end(); ++itReaders)
+      {
+        (*itReaders)->SetUsedArrays(useAllParticles, useStableParticles, usePartons);
+      }
+    }
+    else
+    {
+      // one reader per slot, the event branch is filled in event order
+      workerPool = new DelphesWorkerPool(confReader, treeWriter, numberOfThreads);
+
+      for(i = 0; i < workerPool->GetNumberOfSlots(); ++i)
+      {
+        readers.push_back(new DelphesHepMCReader);
+      }
 
-    factory = modularDelphes->GetFactory();
-    allParticleOutputArray = modularDelphes->ExportArray("allParticles");
-    stableParticleOutputArray = modularDelphes->ExportArray("stableParticles");
-    partonOutputArray = modularDelphes->ExportArray("partons");
+      workerPool->Init([&readers, branchEvent](DelphesWorkerSlot &slot)
+      {
+        if(branchEvent)
+        {
+          readers[slot.index]->AnalyzeEvent(branchEvent, slot.eventNumber, &slot.readStopWatch, &slot.procStopWatch);
+        }
+      });
 
-    reader = new DelphesHepMCReader;
+      for(i = 0; i < workerPool->GetNumberOfSlots(); ++i)
+      {
+        slot = workerPool->GetSlot(i);
+        readers[i]->SetUsedArrays(slot->modularDelphes->IsArrayImported(slot->allParticleOutputArray),
+          slot->modularDelphes->IsArrayImported(slot->stableParticleOutputArray),
+          slot->modularDelphes->IsArrayImported(slot->partonOutputArray));
+      }
+      slot = 0;
+    }
 
-    modularDelphes->InitTask();
+    auto scanEvents = [&](DelphesHepMCReader *eventReader)
+    {
+      while((maxEvents <= 0 || eventCounter - skipEvents < maxEvents) && !interrupted &&
+        ScanOnly(eventCounter, skipEvents, shard, shards) && eventReader->SkipEvent())
+      {
+        ++eventCounter;
+      }
+    };
 
     i = 3;
     do
@@ -140,89 +270,238 @@ int main(int argc, char *argv[])
       if(i == argc || strncmp(argv[i], "-", 2) == 0)
       {
         cout << "** Reading standard input" << endl;
-        inputFile = stdin;
-        length = -1;
+        input = new DelphesInputFile(0);
       }
       else
       {
         cout << "** Reading " << argv[i] << endl;
-        inputFile = fopen(argv[i], "r");
-
-        if(inputFile == NULL)
-        {
-          message << "can't open " << argv[i];
-          throw runtime_error(message.str());
-        }
-
-        fseek(inputFile, 0L, SEEK_END);
-        length = ftello(inputFile);
-        fseek(inputFile, 0L, SEEK_SET);
+        input = new DelphesInputFile(argv[i]);
 
-        if(length <= 0)
+        if(input->GetLength() <= 0)
         {
-          fclose(inputFile);
+          delete input;
+          input = 0;
           ++i;
           continue;
         }
       }
 
-      reader->SetInputFile(inputFile);
+      // the progress of the compressed files is counted in compressed bytes
+      inputFile = input->GetFile();
+      length = input->GetLength();
+
+      // go straight to the first event kept when the file has an index
+      firstEvent = 0;
+      if(skipEvents > 0 && length > 0 && !input->IsCompressed() &&
+        DelphesEventIndex::FindOffset(argv[i], length, skipEvents, offset) &&
+        fseeko(inputFile, offset, SEEK_SET) == 0)
+      {
+        cout << "** Skipping " << skipEvents << " events with the index" << endl;
+        firstEvent = skipEvents;
+      }
 
       ExRootProgressBar progressBar(length);
 
-      // Loop over all objects
-      eventCounter = 0;
-      treeWriter->Clear();
-      modularDelphes->Clear();
-      reader->Clear();
-      readStopWatch.Start();
-      while((maxEvents <= 0 || eventCounter - skipEvents < maxEvents) &&
-        reader->ReadBlock(factory, allParticleOutputArray,
-        stableParticleOutputArray, partonOutputArray) && !interrupted)
+      if(readerThread)
       {
-        if(reader->EventReady())
+        if(!lineReader) lineReader = new DelphesLineReader;
+        lineReader->SetInputFile(inputFile);
+        for(itReaders = readers.begin(); itReaders != readers.end(); ++itReaders)
         {
-          ++eventCounter;
+          (*itReaders)->SetLineReader(lineReader);
+        }
 
-          readStopWatch.Stop();
+        // only the reader thread counts the events until it stops
+        scannedEvents = firstEvent;
+        readerThread->Start([&readers, &scannedEvents, maxEvents, skipEvents, shard, shards](DelphesReaderSlot &slot) -> Bool_t
+        {
+          DelphesHepMCReader *slotReader = readers[slot.index];
+          while(ScanOnly(scannedEvents, skipEvents, shard, shards))
+          {
+            if(maxEvents > 0 && scannedEvents - skipEvents >= maxEvents) return kFALSE;
+            if(!slotReader->SkipEvent()) return kFALSE;
+            ++scannedEvents;
+          }
 
-          if(eventCounter > skipEvents)
+          slotReader->Clear();
+          while(slotReader->ReadBlock(slot.factory, slot.allParticleOutputArray,
+            slot.stableParticleOutputArray, slot.partonOutputArray))
           {
-            procStopWatch.Start();
-            modularDelphes->ProcessTask();
-            procStopWatch.Stop();
+            if(slotReader->EventReady())
+            {
+              slot.eventNumber = ++scannedEvents;
+              return kTRUE;
+            }
+          }
+          return kFALSE;
+        });
+
+        // Loop over all objects
+        eventCounter = firstEvent;
+        if(treeWriter) treeWriter->Clear();
+        modularDelphes->Clear();
+        while((maxEvents <= 0 || eventCounter - skipEvents < maxEvents) && !interrupted &&
+          (readerSlot = readerThread->NextSlot()))
+        {
+          eventCounter = readerSlot->eventNumber;
+
+          readerThread->CopyParticles(*readerSlot, factory, allParticleOutputArray,
+            stableParticleOutputArray, partonOutputArray);
 
-            reader->AnalyzeEvent(branchEvent, eventCounter, &readStopWatch, &procStopWatch);
+          procStopWatch.Start();
+          modularDelphes->SetEventNumber(eventCounter - 1);
+          modularDelphes->ProcessTask();
+          procStopWatch.Stop();
 
-            treeWriter->Fill();
+          if(treeWriter)
+          {
+            readers[readerSlot->index]->AnalyzeEvent(branchEvent, eventCounter, &readerSlot->readStopWatch, &procStopWatch);
+
+            if(!modularDelphes->IsEventRejected()) treeWriter->Fill();
 
             treeWriter->Clear();
           }
 
+          readerThread->ReleaseSlot(readerSlot);
           modularDelphes->Clear();
+
+          progressBar.Update(input->GetPosition(), eventCounter);
+        }
+        readerThread->Stop();
+      }
+      else if(!workerPool)
+      {
+        reader->SetInputFile(inputFile);
+
+        // Loop over all objects
+        eventCounter = firstEvent;
+        if(treeWriter) treeWriter->Clear();
+        modularDelphes->Clear();
+        reader->Clear();
+        scanEvents(reader);
+        readStopWatch.Start();
+        while((maxEvents <= 0 || eventCounter - skipEvents < maxEvents) &&
+          reader->ReadBlock(factory, allParticleOutputArray,
+          stableParticleOutputArray, partonOutputArray) && !interrupted)
+        {
+          if(reader->EventReady())
+          {
+            ++eventCounter;
+
+            readStopWatch.Stop();
+
+            if(eventCounter > skipEvents)
+            {
+              procStopWatch.Start();
+              modularDelphes->SetEventNumber(eventCounter - 1);
+              modularDelphes->ProcessTask();
+              procStopWatch.Stop();
+
+              if(treeWriter)
+              {
+                reader->AnalyzeEvent(branchEvent, eventCounter, &readStopWatch, &procStopWatch);
+
+                if(!modularDelphes->IsEventRejected()) treeWriter->Fill();
+
+                treeWriter->Clear();
+              }
+            }
+
+            modularDelphes->Clear();
+            reader->Clear();
+            scanEvents(reader);
+
+            readStopWatch.Start();
+          }
+          progressBar.Update(input->GetPosition(), eventCounter);
+        }
+      }
+      else
+      {
+        // the readers of the slots take turns on the same buffered lines
+        if(!lineReader) lineReader = new DelphesLineReader;
+        lineReader->SetInputFile(inputFile);
+        for(itReaders = readers.begin(); itReaders != readers.end(); ++itReaders)
+        {
+          (*itReaders)->SetLineReader(lineReader);
+        }
+
+        // Loop over all objects
+        eventCounter = firstEvent;
+        while((maxEvents <= 0 || eventCounter - skipEvents < maxEvents) && !interrupted)
+        {
+          slot = workerPool->AcquireSlot();
+          reader = readers[slot->index];
+
+          scanEvents(reader);
+          if(interrupted || (maxEvents > 0 && eventCounter - skipEvents >= maxEvents))
+          {
+            workerPool->ReleaseSlot(slot);
+            break;
+          }
+
           reader->Clear();
 
-          readStopWatch.Start();
+          eventReady = kFALSE;
+          slot->readStopWatch.Start();
+          while(reader->ReadBlock(slot->factory, slot->allParticleOutputArray,
+            slot->stableParticleOutputArray, slot->partonOutputArray))
+          {
+            if(reader->EventReady())
+            {
+              eventReady = kTRUE;
+              break;
+            }
+          }
+          slot->readStopWatch.Stop();
+
+          if(!eventReady)
+          {
+            workerPool->ReleaseSlot(slot);
+            break;
+          }
+
+          ++eventCounter;
+
+          if(eventCounter > skipEvents)
+          {
+            slot->eventNumber = eventCounter;
+            workerPool->SubmitSlot(slot);
+          }
+          else
+          {
+            workerPool->ReleaseSlot(slot);
+          }
+
+          progressBar.Update(input->GetPosition(), eventCounter);
         }
-        progressBar.Update(ftello(inputFile), eventCounter);
+        reader = 0;
       }
 
-      fseek(inputFile, 0L, SEEK_END);
-      progressBar.Update(ftello(inputFile), eventCounter, kTRUE);
+      progressBar.Update(length, eventCounter, kTRUE);
       progressBar.Finish();
 
-      if(inputFile != stdin) fclose(inputFile);
+      delete input;
+      input = 0;
 
       ++i;
     }
     while(i < argc);
 
-    modularDelphes->FinishTask();
-    treeWriter->Write();
+    if(workerPool) workerPool->Finish();
+    else modularDelphes->FinishTask();
+    if(treeWriter) treeWriter->Write();
 
     cout << "** Exiting..." << endl;
 
     delete reader;
+    for(itReaders = readers.begin(); itReaders != readers.end(); ++itReaders)
+    {
+      delete *itReaders;
+    }
+    delete readerThread;
+    delete lineReader;
+    delete workerPool;
     delete modularDelphes;
     delete confReader;
     delete treeWriter;
@@ -232,6 +511,9 @@ int main(int argc, char *argv[])
   }
   catch(runtime_error &e)
   {
+    if(readerThread) delete readerThread;
+    if(input) delete input;
+    if(workerPool) delete workerPool;
     if(treeWriter) delete treeWriter;
     if(outputFile) delete outputFile;
     cerr << "** ERROR: " << e.what() << endl;
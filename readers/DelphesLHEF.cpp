@@ -35,6 +35,7 @@
 #include "modules/Delphes.h"
 #include "classes/DelphesClasses.h"
 #include "classes/DelphesFactory.h"
+#include "classes/DelphesInputFile.h"
 #include "classes/DelphesLHEFReader.h"
 
 #include "ExRootAnalysis/ExRootTreeWriter.h"
@@ -58,6 +59,7 @@ int main(int argc, char *argv[])
 {
   char appName[] = "DelphesLHEF";
   stringstream message;
+  DelphesInputFile *input = 0;
   FILE *inputFile = 0;
   TFile *outputFile = 0;
   TStopwatch readStopWatch, procStopWatch;
@@ -77,6 +79,7 @@ int main(int argc, char *argv[])
     cout << " config_file - configuration file in Tcl format," << endl;
     cout << " output_file - output file in ROOT format," << endl;
     cout << " input_file(s) - input file(s) in LHEF format," << endl;
+    cout << " which can be compressed with gzip, zstd or xz," << endl;
     cout << " with no input_file, or when input_file is -, read standard input." << endl;
     return 1;
   }
@@ -141,32 +144,26 @@ int main(int argc, char *argv[])
       if(i == argc || strncmp(argv[i], "-", 2) == 0)
       {
         cout << "** Reading standard input" << endl;
-        inputFile = stdin;
-        length = -1;
+        input = new DelphesInputFile(0);
       }
       else
       {
         cout << "** Reading " << argv[i] << endl;
-        inputFile = fopen(argv[i], "r");
+        input = new DelphesInputFile(argv[i]);
 
-        if(inputFile == NULL)
+        if(input->GetLength() <= 0)
         {
-          message << "can't open " << argv[i];
-          throw runtime_error(message.str());
-        }
-
-        fseek(inputFile, 0L, SEEK_END);
-        length = ftello(inputFile);
-        fseek(inputFile, 0L, SEEK_SET);
-
-        if(length <= 0)
-        {
-          fclose(inputFile);
+          delete input;
+          input = 0;
           ++i;
           continue;
         }
       }
 
+      // the progress of the compressed files is counted in compressed bytes
+      inputFile = input->GetFile();
+      length = input->GetLength();
+
       reader->SetInputFile(inputFile);
 
       ExRootProgressBar progressBar(length);
@@ -195,9 +192,13 @@ int main(int argc, char *argv[])
             procStopWatch.Stop();
 
             reader->AnalyzeEvent(branchEvent, eventCounter, &readStopWatch, &procStopWatch);
-            reader->AnalyzeWeight(branchWeight);
 
-            treeWriter->Fill();
+            // the weights are only parsed for the events written
+            if(!modularDelphes->IsEventRejected())
+            {
+              reader->AnalyzeWeight(branchWeight);
+              treeWriter->Fill();
+            }
 
             treeWriter->Clear();
           }
@@ -207,14 +208,14 @@ int main(int argc, char *argv[])
 
           readStopWatch.Start();
         }
-        progressBar.Update(ftello(inputFile), eventCounter);
+        progressBar.Update(input->GetPosition(), eventCounter);
       }
 
-      fseek(inputFile, 0L, SEEK_END);
-      progressBar.Update(ftello(inputFile), eventCounter, kTRUE);
+      progressBar.Update(length, eventCounter, kTRUE);
       progressBar.Finish();
 
-      if(inputFile != stdin) fclose(inputFile);
+      delete input;
+      input = 0;
 
       ++i;
     }
@@ -235,6 +236,7 @@ int main(int argc, char *argv[])
   }
   catch(runtime_error &e)
   {
+    if(input) delete input;
     if(treeWriter) delete treeWriter;
     if(outputFile) delete outputFile;
     cerr << "** ERROR: " << e.what() << endl;
@@ -33,14 +33,13 @@
 #include "TFile.h"
 #include "TObjArray.h"
 #include "TStopwatch.h"
-#include "TDatabasePDG.h"
-#include "TParticlePDG.h"
 #include "TLorentzVector.h"
 
 #include "modules/Delphes.h"
 #include "classes/DelphesStream.h"
 #include "classes/DelphesClasses.h"
 #include "classes/DelphesFactory.h"
+#include "classes/DelphesPDGTable.h"
 
 #include "ExRootAnalysis/ExRootTreeWriter.h"
 #include "ExRootAnalysis/ExRootTreeBranch.h"
@@ -54,68 +53,92 @@ using namespace std;
 
 //---------------------------------------------------------------------------
 
-void ConvertInput(ProMCEvent &event, double momentumUnit, double positionUnit,
+void ConvertInput(const ProMCEvent &event, double momentumUnit, double positionUnit,
   ExRootTreeBranch *branch, DelphesFactory *factory,
   TObjArray *allParticleOutputArray, TObjArray *stableParticleOutputArray,
   TObjArray *partonOutputArray, TStopwatch *readStopWatch, TStopwatch *procStopWatch)
 {
-  Int_t i;
-
-  ProMCEvent_Event *mutableEvent;
-  ProMCEvent_Particles *mutableParticles;
+  Int_t i, n;
+  Bool_t positions;
 
   HepMCEvent *element;
   Candidate *candidate;
-  TDatabasePDG *pdg;
-  TParticlePDG *pdgParticle;
+  const DelphesPDGTable *pdg;
+  const DelphesPDGTable::Entry *pdgParticle;
   Int_t pdgCode;
 
   Int_t pid, status;
   Double_t px, py, pz, mass;
   Double_t x, y, z, t;
 
-  pdg = TDatabasePDG::Instance();
+  pdg = DelphesPDGTable::Instance();
 
-  // event information
-  mutableEvent = event.mutable_event();
+  // event information, read through the const accessors, which unlike
+  // the mutable ones never create a missing message
+  const ProMCEvent_Event &info = event.event();
 
   element = static_cast<HepMCEvent *>(branch->NewEntry());
 
-  element->Number = mutableEvent->number();
+  element->Number = info.number();
 
-  element->ProcessID = mutableEvent->process_id();
-  element->MPI = mutableEvent->mpi();
-  element->Weight = mutableEvent->weight();
-  element->Scale = mutableEvent->scale();
-  element->AlphaQED = mutableEvent->alpha_qed();
-  element->AlphaQCD = mutableEvent->alpha_qcd();
+  element->ProcessID = info.process_id();
+  element->MPI = info.mpi();
+  element->Weight = info.weight();
+  element->Scale = info.scale();
+  element->AlphaQED = info.alpha_qed();
+  element->AlphaQCD = info.alpha_qcd();
 
-  element->ID1 = mutableEvent->id1();
-  element->ID2 = mutableEvent->id2();
-  element->X1 = mutableEvent->x1();
-  element->X2 = mutableEvent->x2();
-  element->ScalePDF = mutableEvent->scale_pdf();
-  element->PDF1 = mutableEvent->pdf1();
-  element->PDF2 = mutableEvent->pdf2();
+  element->ID1 = info.id1();
+  element->ID2 = info.id2();
+  element->X1 = info.x1();
+  element->X2 = info.x2();
+  element->ScalePDF = info.scale_pdf();
+  element->PDF1 = info.pdf1();
+  element->PDF2 = info.pdf2();
 
   element->ReadTime = readStopWatch->RealTime();
   element->ProcTime = procStopWatch->RealTime();
 
-  mutableParticles = event.mutable_particles();
-
-  for(i = 0; i < mutableParticles->pdg_id_size(); ++i)
+  // the packed repeated fields are read straight from their arrays
+  // instead of through the bounds-checked accessor of every element
+  const ProMCEvent_Particles &particles = event.particles();
+
+  n = particles.pdg_id_size();
+
+  const auto *pdgIDs = particles.pdg_id().data();
+  const auto *statuses = particles.status().data();
+  const auto *pxs = particles.px().data();
+  const auto *pys = particles.py().data();
+  const auto *pzs = particles.pz().data();
+  const auto *masses = particles.mass().data();
+  const auto *xs = particles.x().data();
+  const auto *ys = particles.y().data();
+  const auto *zs = particles.z().data();
+  const auto *ts = particles.t().data();
+  const auto *mothers1 = particles.mother1().data();
+  const auto *mothers2 = particles.mother2().data();
+  const auto *daughters1 = particles.daughter1().data();
+  const auto *daughters2 = particles.daughter2().data();
+
+  // the positions are optional, without them the array would be read
+  // past its end
+  positions = particles.x_size() >= n && particles.y_size() >= n && particles.z_size() >= n && particles.t_size() >= n;
+
+  if(allParticleOutputArray->GetSize() < n) allParticleOutputArray->Expand(n);
+
+  for(i = 0; i < n; ++i)
   {
-    pid = mutableParticles->pdg_id(i);
-    status = mutableParticles->status(i);
-
-    px = mutableParticles->px(i)/momentumUnit;
-    py = mutableParticles->py(i)/momentumUnit;
-    pz = mutableParticles->pz(i)/momentumUnit;
-    mass = mutableParticles->mass(i)/momentumUnit;
-    x = mutableParticles->x(i)/positionUnit;
-    y = mutableParticles->y(i)/positionUnit;
-    z = mutableParticles->z(i)/positionUnit;
-    t = mutableParticles->t(i)/positionUnit;
+    pid = pdgIDs[i];
+    status = statuses[i];
+
+    px = pxs[i]/momentumUnit;
+    py = pys[i]/momentumUnit;
+    pz = pzs[i]/momentumUnit;
+    mass = masses[i]/momentumUnit;
+    x = positions ? xs[i]/positionUnit : 0.0;
+    y = positions ? ys[i]/positionUnit : 0.0;
+    z = positions ? zs[i]/positionUnit : 0.0;
+    t = positions ? ts[i]/positionUnit : 0.0;
 
     candidate = factory->NewCandidate();
 
@@ -124,14 +147,14 @@ void ConvertInput(ProMCEvent &event, double momentumUnit, double positionUnit,
 
     candidate->Status = status;
 
-    candidate->M1 = mutableParticles->mother1(i);
-    candidate->M2 = mutableParticles->mother2(i);
+    candidate->M1 = mothers1[i];
+    candidate->M2 = mothers2[i];
 
-    candidate->D1 = mutableParticles->daughter1(i);
-    candidate->D2 = mutableParticles->daughter2(i);
+    candidate->D1 = daughters1[i];
+    candidate->D2 = daughters2[i];
 
-    pdgParticle = pdg->GetParticle(pid);
-    candidate->Charge = pdgParticle ? Int_t(pdgParticle->Charge()/3.0) : -999;
+    pdgParticle = pdg->Find(pid);
+    candidate->Charge = pdgParticle ? pdgParticle->charge : -999;
     candidate->Mass = mass;
 
     candidate->Momentum.SetXYZM(px, py, pz, mass);
@@ -270,7 +293,7 @@ int main(int argc, char *argv[])
         modularDelphes->ProcessTask();
         procStopWatch.Stop();
 
-        treeWriter->Fill();
+        if(!modularDelphes->IsEventRejected()) treeWriter->Fill();
 
         modularDelphes->Clear();
         treeWriter->Clear();
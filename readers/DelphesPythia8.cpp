@@ -20,6 +20,7 @@
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <vector>
 
 #include <signal.h>
 
@@ -31,14 +32,15 @@
 #include "TFile.h"
 #include "TObjArray.h"
 #include "TStopwatch.h"
-#include "TDatabasePDG.h"
-#include "TParticlePDG.h"
 #include "TLorentzVector.h"
 
 #include "modules/Delphes.h"
+#include "modules/DelphesReaderThread.h"
+#include "modules/DelphesMetrics.h"
 #include "classes/DelphesClasses.h"
 #include "classes/DelphesFactory.h"
 #include "classes/DelphesLHEFReader.h"
+#include "classes/DelphesPDGTable.h"
 
 #include "ExRootAnalysis/ExRootTreeWriter.h"
 #include "ExRootAnalysis/ExRootTreeBranch.h"
@@ -48,47 +50,82 @@ using namespace std;
 
 //---------------------------------------------------------------------------
 
-void ConvertInput(Long64_t eventCounter, Pythia8::Pythia *pythia,
-  ExRootTreeBranch *branch, DelphesFactory *factory,
-  TObjArray *allParticleOutputArray, TObjArray *stableParticleOutputArray, TObjArray *partonOutputArray,
-  TStopwatch *readStopWatch, TStopwatch *procStopWatch)
+// event information kept until the event is simulated, the generators of
+// the parallel mode move on to the next events in the meantime
+
+struct GeneratorInfo
 {
-  int i;
+  Int_t processID, id1, id2;
+  Double_t weight, scale, alphaQED, alphaQCD;
+  Double_t x1, x2, scalePDF, pdf1, pdf2;
+};
 
-  HepMCEvent *element;
-  Candidate *candidate;
-  TDatabasePDG *pdg;
-  TParticlePDG *pdgParticle;
-  Int_t pdgCode;
+//---------------------------------------------------------------------------
 
-  Int_t pid, status;
-  Double_t px, py, pz, e, mass;
-  Double_t x, y, z, t;
+void SaveInfo(Pythia8::Pythia *pythia, GeneratorInfo &info)
+{
+  info.processID = pythia->info.code();
+  info.weight = pythia->info.weight();
+  info.scale = pythia->info.QRen();
+  info.alphaQED = pythia->info.alphaEM();
+  info.alphaQCD = pythia->info.alphaS();
+
+  info.id1 = pythia->info.id1();
+  info.id2 = pythia->info.id2();
+  info.x1 = pythia->info.x1();
+  info.x2 = pythia->info.x2();
+  info.scalePDF = pythia->info.QFac();
+  info.pdf1 = pythia->info.pdf1();
+  info.pdf2 = pythia->info.pdf2();
+}
+
+//---------------------------------------------------------------------------
+
+void AnalyzeEvent(Long64_t eventCounter, const GeneratorInfo &info,
+  ExRootTreeBranch *branch, TStopwatch *readStopWatch, TStopwatch *procStopWatch)
+{
+  HepMCEvent *element;
 
-  // event information
   element = static_cast<HepMCEvent *>(branch->NewEntry());
 
   element->Number = eventCounter;
 
-  element->ProcessID = pythia->info.code();
+  element->ProcessID = info.processID;
   element->MPI = 1;
-  element->Weight = pythia->info.weight();
-  element->Scale = pythia->info.QRen();
-  element->AlphaQED = pythia->info.alphaEM();
-  element->AlphaQCD = pythia->info.alphaS();
-
-  element->ID1 = pythia->info.id1();
-  element->ID2 = pythia->info.id2();
-  element->X1 = pythia->info.x1();
-  element->X2 = pythia->info.x2();
-  element->ScalePDF = pythia->info.QFac();
-  element->PDF1 = pythia->info.pdf1();
-  element->PDF2 = pythia->info.pdf2();
+  element->Weight = info.weight;
+  element->Scale = info.scale;
+  element->AlphaQED = info.alphaQED;
+  element->AlphaQCD = info.alphaQCD;
+
+  element->ID1 = info.id1;
+  element->ID2 = info.id2;
+  element->X1 = info.x1;
+  element->X2 = info.x2;
+  element->ScalePDF = info.scalePDF;
+  element->PDF1 = info.pdf1;
+  element->PDF2 = info.pdf2;
 
   element->ReadTime = readStopWatch->RealTime();
   element->ProcTime = procStopWatch->RealTime();
+}
 
-  pdg = TDatabasePDG::Instance();
+//---------------------------------------------------------------------------
+
+void ConvertParticles(Pythia8::Pythia *pythia, DelphesFactory *factory,
+  TObjArray *allParticleOutputArray, TObjArray *stableParticleOutputArray, TObjArray *partonOutputArray)
+{
+  int i;
+
+  Candidate *candidate;
+  const DelphesPDGTable *pdg;
+  const DelphesPDGTable::Entry *pdgParticle;
+  Int_t pdgCode;
+
+  Int_t pid, status;
+  Double_t px, py, pz, e, mass;
+  Double_t x, y, z, t;
+
+  pdg = DelphesPDGTable::Instance();
 
   for(i = 1; i < pythia->event.size(); ++i)
   {
@@ -112,8 +149,8 @@ void ConvertInput(Long64_t eventCounter, Pythia8::Pythia *pythia,
     candidate->D1 = particle.daughter1() - 1;
     candidate->D2 = particle.daughter2() - 1;
 
-    pdgParticle = pdg->GetParticle(pid);
-    candidate->Charge = pdgParticle ? Int_t(pdgParticle->Charge()/3.0) : -999;
+    pdgParticle = pdg->Find(pid);
+    candidate->Charge = pdgParticle ? pdgParticle->charge : -999;
     candidate->Mass = mass;
 
     candidate->Momentum.SetPxPyPzE(px, py, pz, e);
@@ -137,6 +174,21 @@ void ConvertInput(Long64_t eventCounter, Pythia8::Pythia *pythia,
 
 //---------------------------------------------------------------------------
 
+void ConvertInput(Long64_t eventCounter, Pythia8::Pythia *pythia,
+  ExRootTreeBranch *branch, DelphesFactory *factory,
+  TObjArray *allParticleOutputArray, TObjArray *stableParticleOutputArray, TObjArray *partonOutputArray,
+  TStopwatch *readStopWatch, TStopwatch *procStopWatch)
+{
+  GeneratorInfo info;
+
+  SaveInfo(pythia, info);
+  AnalyzeEvent(eventCounter, info, branch, readStopWatch, procStopWatch);
+
+  ConvertParticles(pythia, factory, allParticleOutputArray, stableParticleOutputArray, partonOutputArray);
+}
+
+//---------------------------------------------------------------------------
+
 static bool interrupted = false;
 
 void SignalHandler(int sig)
@@ -164,6 +216,13 @@ int main(int argc, char *argv[])
   DelphesLHEFReader *reader = 0;
   Long64_t eventCounter, errorCounter;
   Long64_t numberOfEvents, timesAllowErrors;
+  Int_t i, numberOfGenerators, seed;
+  DelphesReaderThread *readerThread = 0;
+  DelphesReaderSlot *readerSlot = 0;
+  vector< GeneratorInfo > generatorInfos;
+  vector< Long64_t > generatorErrors;
+  vector< Pythia8::Pythia * > generators;
+  vector< Pythia8::Pythia * >::iterator itGenerators;
 
   Pythia8::Pythia *pythia = 0;
 
@@ -239,9 +298,69 @@ int main(int argc, char *argv[])
       partonOutputArrayLHEF = modularDelphes->ExportArray("partonsLHEF");
     }
 
+    // several Pythia instances with consecutive seeds generate the events
+    // on threads of their own, the simulation takes them in turn
+    numberOfGenerators = confReader->GetInt("::NumberOfGenerators", 1);
+    if(numberOfGenerators < 1)
+    {
+      throw runtime_error("NumberOfGenerators must be positive");
+    }
+    if(numberOfGenerators > 1 && reader)
+    {
+      throw runtime_error("NumberOfGenerators can't be used with a Les Houches Event File");
+    }
+
+    generators.push_back(pythia);
+    seed = pythia->mode("Random:seed");
+    if(seed <= 0) seed = 19780503;
+    for(i = 1; i < numberOfGenerators; ++i)
+    {
+      generators.push_back(new Pythia8::Pythia);
+      generators[i]->readFile(argv[2]);
+      generators[i]->readString("Random:setSeed = on");
+      // Pythia only takes seeds below 900000000
+      generators[i]->readString(Form("Random:seed = %d", (seed + i) % 900000000));
+    }
+
     modularDelphes->InitTask();
 
-    pythia->init();
+    for(itGenerators = generators.begin(); itGenerators != generators.end(); ++itGenerators)
+    {
+      (*itGenerators)->init();
+    }
+
+    if(numberOfGenerators > 1)
+    {
+      readerThread = new DelphesReaderThread(2*numberOfGenerators, numberOfGenerators);
+      generatorInfos.resize(readerThread->GetNumberOfSlots());
+      generatorErrors.assign(numberOfGenerators, 0);
+
+      if(modularDelphes->GetMetrics())
+      {
+        modularDelphes->GetMetrics()->AddGauge("read_ahead_events",
+          [readerThread] { return Long64_t(readerThread->GetNumberOfReadySlots()); });
+      }
+
+      readerThread->Start([&generators, &generatorInfos, &generatorErrors, timesAllowErrors](DelphesReaderSlot &slot) -> Bool_t
+      {
+        Pythia8::Pythia *generator = generators[slot.worker];
+
+        while(!generator->next())
+        {
+          // First few failures write off as "acceptable" errors, then quit
+          if(++generatorErrors[slot.worker] > timesAllowErrors)
+          {
+            cerr << "Event generation aborted prematurely, owing to error!" << endl;
+            return kFALSE;
+          }
+        }
+
+        SaveInfo(generator, generatorInfos[slot.index]);
+        ConvertParticles(generator, slot.factory, slot.allParticleOutputArray,
+          slot.stableParticleOutputArray, slot.partonOutputArray);
+        return kTRUE;
+      });
+    }
 
     // ExRootProgressBar progressBar(numberOfEvents - 1);
     ExRootProgressBar progressBar(-1);
@@ -251,61 +370,92 @@ int main(int argc, char *argv[])
     treeWriter->Clear();
     modularDelphes->Clear();
     readStopWatch.Start();
-    for(eventCounter = 0; eventCounter < numberOfEvents && !interrupted; ++eventCounter)
+    if(readerThread)
     {
-      while(reader && reader->ReadBlock(factory, allParticleOutputArrayLHEF,
-        stableParticleOutputArrayLHEF, partonOutputArrayLHEF) && !reader->EventReady());
-
-      if(!pythia->next())
+      for(eventCounter = 0; eventCounter < numberOfEvents && !interrupted &&
+        (readerSlot = readerThread->NextSlot()); ++eventCounter)
       {
-        // If failure because reached end of file then exit event loop
-        if(pythia->info.atEndOfFile())
-        {
-          cerr << "Aborted since reached end of Les Houches Event File" << endl;
-          break;
-        }
+        readerThread->CopyParticles(*readerSlot, factory, allParticleOutputArray,
+          stableParticleOutputArray, partonOutputArray);
 
-        // First few failures write off as "acceptable" errors, then quit
-        if(++errorCounter > timesAllowErrors)
-        {
-          cerr << "Event generation aborted prematurely, owing to error!" << endl;
-          break;
-        }
+        procStopWatch.Start();
+        AnalyzeEvent(eventCounter, generatorInfos[readerSlot->index], branchEvent,
+          &readerSlot->readStopWatch, &procStopWatch);
+        modularDelphes->ProcessTask();
+        procStopWatch.Stop();
 
+        if(!modularDelphes->IsEventRejected()) treeWriter->Fill();
+
+        treeWriter->Clear();
         modularDelphes->Clear();
-        reader->Clear();
-        continue;
+        readerThread->ReleaseSlot(readerSlot);
+
+        progressBar.Update(eventCounter, eventCounter);
       }
+    }
+    else
+    {
+      for(eventCounter = 0; eventCounter < numberOfEvents && !interrupted; ++eventCounter)
+      {
+        while(reader && reader->ReadBlock(factory, allParticleOutputArrayLHEF,
+          stableParticleOutputArrayLHEF, partonOutputArrayLHEF) && !reader->EventReady());
 
-      readStopWatch.Stop();
+        if(!pythia->next())
+        {
+          // If failure because reached end of file then exit event loop
+          if(pythia->info.atEndOfFile())
+          {
+            cerr << "Aborted since reached end of Les Houches Event File" << endl;
+            break;
+          }
+
+          // First few failures write off as "acceptable" errors, then quit
+          if(++errorCounter > timesAllowErrors)
+          {
+            cerr << "Event generation aborted prematurely, owing to error!" << endl;
+            break;
+          }
+
+          modularDelphes->Clear();
+          reader->Clear();
+          continue;
+        }
 
-      procStopWatch.Start();
-      ConvertInput(eventCounter, pythia, branchEvent, factory,
-        allParticleOutputArray, stableParticleOutputArray, partonOutputArray,
-        &readStopWatch, &procStopWatch);
-      modularDelphes->ProcessTask();
-      procStopWatch.Stop();
+        readStopWatch.Stop();
 
-      if(reader)
-      {
-        reader->AnalyzeEvent(branchEventLHEF, eventCounter, &readStopWatch, &procStopWatch);
-        reader->AnalyzeWeight(branchWeightLHEF);
-      }
+        procStopWatch.Start();
+        ConvertInput(eventCounter, pythia, branchEvent, factory,
+          allParticleOutputArray, stableParticleOutputArray, partonOutputArray,
+          &readStopWatch, &procStopWatch);
+        modularDelphes->ProcessTask();
+        procStopWatch.Stop();
+
+        if(reader)
+        {
+          reader->AnalyzeEvent(branchEventLHEF, eventCounter, &readStopWatch, &procStopWatch);
+          reader->AnalyzeWeight(branchWeightLHEF);
+        }
 
-      treeWriter->Fill();
+        if(!modularDelphes->IsEventRejected()) treeWriter->Fill();
 
-      treeWriter->Clear();
-      modularDelphes->Clear();
-      if(reader) reader->Clear();
+        treeWriter->Clear();
+        modularDelphes->Clear();
+        if(reader) reader->Clear();
 
-      readStopWatch.Start();
-      progressBar.Update(eventCounter, eventCounter);
+        readStopWatch.Start();
+        progressBar.Update(eventCounter, eventCounter);
+      }
     }
 
     progressBar.Update(eventCounter, eventCounter, kTRUE);
     progressBar.Finish();
 
-    pythia->stat();
+    if(readerThread) readerThread->Stop();
+
+    for(itGenerators = generators.begin(); itGenerators != generators.end(); ++itGenerators)
+    {
+      (*itGenerators)->stat();
+    }
 
     modularDelphes->FinishTask();
     treeWriter->Write();
@@ -313,7 +463,11 @@ int main(int argc, char *argv[])
     cout << "** Exiting..." << endl;
 
     delete reader;
-    delete pythia;
+    delete readerThread;
+    for(itGenerators = generators.begin(); itGenerators != generators.end(); ++itGenerators)
+    {
+      delete *itGenerators;
+    }
     delete modularDelphes;
     delete confReader;
     delete treeWriter;
@@ -20,6 +20,7 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <vector>
 
 #include <signal.h>
 
@@ -29,13 +30,19 @@
 #include "TFile.h"
 #include "TObjArray.h"
 #include "TStopwatch.h"
+#include "TMath.h"
 #include "TDatabasePDG.h"
 #include "TParticlePDG.h"
 #include "TLorentzVector.h"
 
 #include "modules/Delphes.h"
+#include "modules/DelphesWorkerPool.h"
 #include "classes/DelphesClasses.h"
 #include "classes/DelphesFactory.h"
+#include "classes/DelphesCheckpoint.h"
+#include "classes/DelphesEventIndex.h"
+#include "classes/DelphesInputFile.h"
+#include "classes/DelphesReplayLog.h"
 #include "classes/DelphesSTDHEPReader.h"
 
 #include "ExRootAnalysis/ExRootTreeWriter.h"
@@ -55,10 +62,89 @@ void SignalHandler(int sig)
 
 //---------------------------------------------------------------------------
 
+// removes --shard i/N from the arguments, false if it is malformed
+static bool ParseShard(int &argc, char *argv[], Int_t &shard, Int_t &shards)
+{
+  int i, j;
+  char end;
+
+  for(i = 1, j = 1; i < argc; ++i)
+  {
+    if(strcmp(argv[i], "--shard") == 0)
+    {
+      if(i + 1 == argc) return false;
+      ++i;
+      if(sscanf(argv[i], "%d/%d%c", &shard, &shards, &end) != 2) return false;
+      if(shards < 1 || shard < 0 || shard >= shards) return false;
+      continue;
+    }
+    argv[j++] = argv[i];
+  }
+  argc = j;
+  return true;
+}
+
+//---------------------------------------------------------------------------
+
+// removes --replay-event N from the arguments, false if it is malformed
+static bool ParseReplayEvent(int &argc, char *argv[], Long64_t &event)
+{
+  int i, j;
+  char end;
+
+  for(i = 1, j = 1; i < argc; ++i)
+  {
+    if(strcmp(argv[i], "--replay-event") == 0)
+    {
+      if(i + 1 == argc) return false;
+      ++i;
+      if(sscanf(argv[i], "%lld%c", &event, &end) != 1) return false;
+      if(event < 0) return false;
+      continue;
+    }
+    argv[j++] = argv[i];
+  }
+  argc = j;
+  return true;
+}
+
+//---------------------------------------------------------------------------
+
+// removes the flag from the arguments, true if it was there
+static bool ParseFlag(int &argc, char *argv[], const char *flag)
+{
+  int i, j;
+  bool found = false;
+
+  for(i = 1, j = 1; i < argc; ++i)
+  {
+    if(strcmp(argv[i], flag) == 0)
+    {
+      found = true;
+      continue;
+    }
+    argv[j++] = argv[i];
+  }
+  argc = j;
+  return found;
+}
+
+//---------------------------------------------------------------------------
+
+// the events before SkipEvents and the ones of the other shards are passed
+// over without reading their particles
+static bool ScanOnly(Long64_t eventCounter, Long64_t skipEvents, Int_t shard, Int_t shards)
+{
+  return eventCounter < skipEvents || (eventCounter - skipEvents) % shards != shard;
+}
+
+//---------------------------------------------------------------------------
+
 int main(int argc, char *argv[])
 {
   char appName[] = "DelphesSTDHEP";
   stringstream message;
+  DelphesInputFile *input = 0;
   FILE *inputFile = 0;
   TFile *outputFile = 0;
   TStopwatch readStopWatch, procStopWatch;
@@ -69,15 +155,35 @@ int main(int argc, char *argv[])
   DelphesFactory *factory = 0;
   TObjArray *stableParticleOutputArray = 0, *allParticleOutputArray = 0, *partonOutputArray = 0;
   DelphesSTDHEPReader *reader = 0;
-  Int_t i, maxEvents, skipEvents;
-  Long64_t length, eventCounter;
-
-  if(argc < 3)
+  vector< DelphesSTDHEPReader * > readers;
+  vector< DelphesSTDHEPReader * >::iterator itReaders;
+  DelphesWorkerPool *workerPool = 0;
+  DelphesWorkerSlot *slot = 0;
+  DelphesCheckpoint *checkpoint = 0;
+  DelphesReplayLog *replayLog = 0;
+  DelphesReplayLog::Replay replay;
+  string replayLogFile;
+  Bool_t eventReady, resume, resumed = kFALSE;
+  Int_t i, maxEvents, skipEvents, numberOfThreads, shard = 0, shards = 1;
+  UInt_t randomSeed;
+  Long64_t length, eventCounter, firstEvent, offset, resumeEvents = 0;
+  Long64_t replayEvent = -1, eventStart = 0;
+
+  resume = ParseFlag(argc, argv, "--resume");
+
+  if(!ParseShard(argc, argv, shard, shards) || !ParseReplayEvent(argc, argv, replayEvent) || argc < 3)
   {
-    cout << " Usage: " << appName << " config_file" << " output_file" << " [input_file(s)]" << endl;
+    cout << " Usage: " << appName << " [--shard i/N]" << " [--resume]" << " [--replay-event N]" << " config_file" << " output_file" << " [input_file(s)]" << endl;
+    cout << " --shard i/N - process only the events i, i+N, i+2N... counted from 0 after SkipEvents," << endl;
+    cout << " --resume - go on after the checkpoint written with the last complete output file," << endl;
+    cout << " see MaxEventsPerFile and MaxBytesPerFile of TreeWriter," << endl;
+    cout << " --replay-event N - process and write only the event N, counted from 0, of the one input_file," << endl;
+    cout << " with the random numbers it had in the job that wrote ReplayLogFile," << endl;
     cout << " config_file - configuration file in Tcl format," << endl;
     cout << " output_file - output file in ROOT format," << endl;
+    cout << " or - to skip the ROOT output (remove TreeWriter from the ExecutionPath)," << endl;
     cout << " input_file(s) - input file(s) in STDHEP format," << endl;
+    cout << " which can be compressed with gzip, zstd or xz," << endl;
     cout << " with no input_file, or when input_file is -, read standard input." << endl;
     cout << " when input_file is -, also suppress all output" << endl;
     return 1;
@@ -93,17 +199,37 @@ int main(int argc, char *argv[])
 
   try
   {
-    outputFile = TFile::Open(argv[2], "CREATE");
-
-    if(outputFile == NULL)
+    if(replayEvent >= 0 && (resume || shards > 1 || argc != 4 || strncmp(argv[3], "-", 2) == 0))
     {
-      message << "can't create output file " << argv[2];
-      throw runtime_error(message.str());
+      throw runtime_error("--replay-event needs the one input file of the event and can't be used with --resume or --shard");
     }
 
-    treeWriter = new ExRootTreeWriter(outputFile, "Delphes");
+    if(strncmp(argv[2], "-", 2) != 0)
+    {
+      // the checkpoints follow the output files
+      checkpoint = new DelphesCheckpoint(argv[2]);
+      if(resume) resumed = checkpoint->Read();
+
+      // the incomplete file of the failed job is written again
+      if(resumed) outputFile = TFile::Open(ExRootTreeWriter::GetFileName(argv[2], checkpoint->GetFiles()), "RECREATE");
+      else outputFile = TFile::Open(argv[2], resume ? "RECREATE" : "CREATE");
+
+      if(outputFile == NULL)
+      {
+        message << "can't create output file " << argv[2];
+        throw runtime_error(message.str());
+      }
+
+      treeWriter = new ExRootTreeWriter(outputFile, "Delphes");
+      if(resumed) treeWriter->SetFileNumber(checkpoint->GetFiles(), argv[2]);
+      checkpoint->SetTreeWriter(treeWriter);
 
-    branchEvent = treeWriter->NewBranch("Event", LHEFEvent::Class());
+      branchEvent = treeWriter->NewBranch("Event", LHEFEvent::Class());
+    }
+    else if(resume)
+    {
+      throw runtime_error("--resume needs a ROOT output file");
+    }
 
     bool pipe_mode = argc > 3 && strncmp(argv[3], "-", 2) == 0;
 
@@ -132,20 +258,142 @@ int main(int argc, char *argv[])
       throw runtime_error("SkipEvents must be zero or positive");
     }
 
-    modularDelphes = new Delphes("Delphes");
-    modularDelphes->SetConfReader(confReader);
-    modularDelphes->SetTreeWriter(treeWriter);
+    numberOfThreads = confReader->GetInt("::NumberOfThreads", 1);
+
+    if(numberOfThreads < 1)
+    {
+      throw runtime_error("NumberOfThreads must be positive");
+    }
+
+    // log of the events, to replay one of them on its own
+    replayLogFile = confReader->GetString("::ReplayLogFile", "");
+
+    if(replayEvent >= 0 && replayLogFile.empty())
+    {
+      throw runtime_error("--replay-event needs ReplayLogFile");
+    }
+
+    if(!replayLogFile.empty() && numberOfThreads > 1)
+    {
+      throw runtime_error("ReplayLogFile can't be used with NumberOfThreads > 1");
+    }
+
+    if(numberOfThreads == 1)
+    {
+      modularDelphes = new Delphes("Delphes");
+      modularDelphes->SetConfReader(confReader);
+      if(treeWriter) modularDelphes->SetTreeWriter(treeWriter);
+
+      factory = modularDelphes->GetFactory();
+      allParticleOutputArray = modularDelphes->ExportArray("allParticles");
+      stableParticleOutputArray = modularDelphes->ExportArray("stableParticles");
+      partonOutputArray = modularDelphes->ExportArray("partons");
+
+      reader = new DelphesSTDHEPReader;
 
-    factory = modularDelphes->GetFactory();
-    allParticleOutputArray = modularDelphes->ExportArray("allParticles");
-    stableParticleOutputArray = modularDelphes->ExportArray("stableParticles");
-    partonOutputArray = modularDelphes->ExportArray("partons");
+      modularDelphes->InitTask();
 
-    reader = new DelphesSTDHEPReader;
+      // the reader only fills the arrays that the modules read
+      reader->SetUsedArrays(modularDelphes->IsArrayImported(allParticleOutputArray),
+        modularDelphes->IsArrayImported(stableParticleOutputArray),
+        modularDelphes->IsArrayImported(partonOutputArray));
 
-    modularDelphes->InitTask();
+      if(resumed) modularDelphes->SetEventCounter(checkpoint->GetProcessed());
+
+      if(!replayLogFile.empty())
+      {
+        randomSeed = confReader->GetInt("::RandomSeed", 0);
+
+        // the streams are seeded at random without RandomSeed, and the
+        // buffers of gaussian deviates carry over from one event to the next
+        if(modularDelphes->HasRandomStreams() && randomSeed == 0)
+        {
+          throw runtime_error("ReplayLogFile with RandomStreams needs a nonzero RandomSeed");
+        }
 
-    i = 3;
+        if(!modularDelphes->HasRandomStreams() && modularDelphes->HasGaussianBuffers())
+        {
+          throw runtime_error("ReplayLogFile with GaussianBuffers needs RandomStreams");
+        }
+
+        if(replayEvent >= 0)
+        {
+          if(!DelphesReplayLog::Find(replayLogFile.c_str(), argv[3], replayEvent,
+            modularDelphes->HasRandomStreams(), randomSeed, replay))
+          {
+            message << "event " << replayEvent << " of " << argv[3] << " is not in the replay log " << replayLogFile;
+            throw runtime_error(message.str());
+          }
+
+          // the events from the last state of gRandom on are processed again
+          skipEvents = replay.firstEvent;
+          maxEvents = replayEvent - replay.firstEvent + 1;
+        }
+        else
+        {
+          replayLog = new DelphesReplayLog(replayLogFile.c_str(), modularDelphes->HasRandomStreams(),
+            randomSeed, confReader->GetInt("::ReplayLogInterval", 100), resumed);
+        }
+      }
+    }
+    else
+    {
+      // one reader per slot, the event branch is filled in event order
+      workerPool = new DelphesWorkerPool(confReader, treeWriter, numberOfThreads);
+
+      for(i = 0; i < workerPool->GetNumberOfSlots(); ++i)
+      {
+        readers.push_back(new DelphesSTDHEPReader);
+      }
+
+      workerPool->Init([&readers, branchEvent](DelphesWorkerSlot &slot)
+      {
+        if(branchEvent)
+        {
+          readers[slot.index]->AnalyzeEvent(branchEvent, slot.eventNumber, &slot.readStopWatch, &slot.procStopWatch);
+        }
+      },
+      [checkpoint](DelphesWorkerSlot &slot)
+      {
+        if(checkpoint) checkpoint->Update(slot.inputFile, slot.eventNumber, slot.sequence + 1);
+      });
+
+      if(resumed) workerPool->SetNextSequence(checkpoint->GetProcessed());
+
+      for(i = 0; i < workerPool->GetNumberOfSlots(); ++i)
+      {
+        slot = workerPool->GetSlot(i);
+        readers[i]->SetUsedArrays(slot->modularDelphes->IsArrayImported(slot->allParticleOutputArray),
+          slot->modularDelphes->IsArrayImported(slot->stableParticleOutputArray),
+          slot->modularDelphes->IsArrayImported(slot->partonOutputArray));
+      }
+      slot = 0;
+    }
+
+    if(resumed)
+    {
+      sout << "** Resuming after " << checkpoint->GetFiles() << " complete output files" << endl;
+      checkpoint->RestoreRandom();
+      resumeEvents = checkpoint->GetEvents();
+    }
+
+    if(replayEvent >= 0)
+    {
+      sout << "** Replaying event " << replayEvent << " from event " << replay.firstEvent << endl;
+      DelphesReplayLog::RestoreRandom(replay);
+    }
+
+    auto scanEvents = [&](DelphesSTDHEPReader *eventReader)
+    {
+      while((maxEvents <= 0 || eventCounter - skipEvents < maxEvents) && !interrupted &&
+        (eventCounter < resumeEvents || ScanOnly(eventCounter, skipEvents, shard, shards)) &&
+        eventReader->SkipEvent())
+      {
+        ++eventCounter;
+      }
+    };
+
+    i = resumed ? checkpoint->GetInputFile() : 3;
     do
     {
       if(interrupted) break;
@@ -153,93 +401,195 @@ int main(int argc, char *argv[])
       if(i == argc || strncmp(argv[i], "-", 2) == 0)
       {
         sout << "** Reading standard input" << endl;
-        inputFile = stdin;
-        length = -1;
+        input = new DelphesInputFile(0);
       }
       else
       {
         sout << "** Reading " << argv[i] << endl;
-        inputFile = fopen(argv[i], "r");
+        input = new DelphesInputFile(argv[i]);
 
-        if(inputFile == NULL)
+        if(input->GetLength() <= 0)
         {
-          message << "can't open " << argv[i];
-          throw runtime_error(message.str());
-        }
-
-        fseek(inputFile, 0L, SEEK_END);
-        length = ftello(inputFile);
-        fseek(inputFile, 0L, SEEK_SET);
-
-        if(length <= 0)
-        {
-          fclose(inputFile);
+          delete input;
+          input = 0;
           ++i;
           continue;
         }
       }
 
-      reader->SetInputFile(inputFile);
+      // the progress of the compressed files is counted in compressed bytes
+      inputFile = input->GetFile();
+      length = input->GetLength();
+
+      if(replayLog) replayLog->SetInputFile(i == argc ? "-" : argv[i]);
+
+      // go straight to the first event kept when the file has an index,
+      // or to the first event of the replay
+      firstEvent = TMath::Max(Long64_t(skipEvents), resumeEvents);
+      if(replayEvent >= 0) offset = replay.firstOffset;
+      if(firstEvent > 0 && length > 0 && !input->IsCompressed() &&
+        (replayEvent >= 0 || DelphesEventIndex::FindOffset(argv[i], length, firstEvent, offset)) &&
+        offset >= 0 && fseeko(inputFile, offset, SEEK_SET) == 0)
+      {
+        sout << "** Skipping " << firstEvent << " events with the " << (replayEvent >= 0 ? "replay log" : "index") << endl;
+      }
+      else
+      {
+        firstEvent = 0;
+      }
 
       ExRootProgressBar progressBar(length);
 
-      // Loop over all objects
-      eventCounter = 0;
-      treeWriter->Clear();
-      modularDelphes->Clear();
-      reader->Clear();
-      readStopWatch.Start();
-      while((maxEvents <= 0 || eventCounter - skipEvents < maxEvents) &&
-        reader->ReadBlock(factory, allParticleOutputArray,
-        stableParticleOutputArray, partonOutputArray) && !interrupted)
+      if(!workerPool)
       {
-        if(reader->EventReady())
+        reader->SetInputFile(inputFile);
+
+        // Loop over all objects
+        eventCounter = firstEvent;
+        if(treeWriter) treeWriter->Clear();
+        modularDelphes->Clear();
+        reader->Clear();
+        scanEvents(reader);
+        eventStart = reader->GetPosition();
+        readStopWatch.Start();
+        while((maxEvents <= 0 || eventCounter - skipEvents < maxEvents) &&
+          reader->ReadBlock(factory, allParticleOutputArray,
+          stableParticleOutputArray, partonOutputArray) && !interrupted)
         {
-          ++eventCounter;
+          if(reader->EventReady())
+          {
+            ++eventCounter;
 
-          readStopWatch.Stop();
+            readStopWatch.Stop();
 
-          if(eventCounter > skipEvents)
-          {
-            procStopWatch.Start();
-            modularDelphes->ProcessTask();
-            procStopWatch.Stop();
+            if(eventCounter > skipEvents)
+            {
+              if(replayLog) replayLog->AddEvent(eventCounter - 1, eventStart);
 
-            reader->AnalyzeEvent(branchEvent, eventCounter, &readStopWatch, &procStopWatch);
+              procStopWatch.Start();
+              modularDelphes->SetEventNumber(eventCounter - 1);
+              modularDelphes->ProcessTask();
+              procStopWatch.Stop();
 
-            treeWriter->Fill();
+              if(treeWriter)
+              {
+                reader->AnalyzeEvent(branchEvent, eventCounter, &readStopWatch, &procStopWatch);
 
-            treeWriter->Clear();
+                // a replay only writes its last event
+                if(!modularDelphes->IsEventRejected() && (replayEvent < 0 || eventCounter - 1 == replayEvent))
+                {
+                  treeWriter->Fill();
+                  checkpoint->Update(i, eventCounter, modularDelphes->GetEventCounter());
+                }
+
+                treeWriter->Clear();
+              }
+            }
+
+            modularDelphes->Clear();
+            reader->Clear();
+            scanEvents(reader);
+            eventStart = reader->GetPosition();
+
+            readStopWatch.Start();
+          }
+          if (!pipe_mode) progressBar.Update(input->GetPosition(), eventCounter);
+        }
+      }
+      else
+      {
+        for(itReaders = readers.begin(); itReaders != readers.end(); ++itReaders)
+        {
+          (*itReaders)->SetInputFile(inputFile);
+        }
+
+        // Loop over all objects
+        eventCounter = firstEvent;
+        while((maxEvents <= 0 || eventCounter - skipEvents < maxEvents) && !interrupted)
+        {
+          slot = workerPool->AcquireSlot();
+          reader = readers[slot->index];
+
+          scanEvents(reader);
+          if(interrupted || (maxEvents > 0 && eventCounter - skipEvents >= maxEvents))
+          {
+            workerPool->ReleaseSlot(slot);
+            break;
           }
 
-          modularDelphes->Clear();
           reader->Clear();
 
-          readStopWatch.Start();
+          eventReady = kFALSE;
+          slot->readStopWatch.Start();
+          while(reader->ReadBlock(slot->factory, slot->allParticleOutputArray,
+            slot->stableParticleOutputArray, slot->partonOutputArray))
+          {
+            if(reader->EventReady())
+            {
+              eventReady = kTRUE;
+              break;
+            }
+          }
+          slot->readStopWatch.Stop();
+
+          if(!eventReady)
+          {
+            workerPool->ReleaseSlot(slot);
+            break;
+          }
+
+          ++eventCounter;
+
+          if(eventCounter > skipEvents)
+          {
+            slot->eventNumber = eventCounter;
+            slot->inputFile = i;
+            workerPool->SubmitSlot(slot);
+          }
+          else
+          {
+            workerPool->ReleaseSlot(slot);
+          }
+
+          if (!pipe_mode) progressBar.Update(input->GetPosition(), eventCounter);
         }
-        if (!pipe_mode) progressBar.Update(ftello(inputFile), eventCounter);
+        reader = 0;
       }
 
-      fseek(inputFile, 0L, SEEK_END);
       if (!pipe_mode) {
-	progressBar.Update(ftello(inputFile), eventCounter, kTRUE);
+	progressBar.Update(length, eventCounter, kTRUE);
 	progressBar.Finish();
       }
 
-      if(inputFile != stdin) fclose(inputFile);
+      delete input;
+      input = 0;
+
+      // the events read before the checkpoint are all in its input file
+      resumeEvents = 0;
 
       ++i;
     }
     while(i < argc);
 
-    modularDelphes->FinishTask();
-    treeWriter->Write();
+    if(workerPool) workerPool->Finish();
+    else modularDelphes->FinishTask();
+    if(treeWriter) treeWriter->Write();
+
+    // an interrupted job can still be resumed
+    if(checkpoint && !interrupted) checkpoint->Remove();
 
     sout << "** Exiting..." << endl;
 
     delete reader;
+    for(itReaders = readers.begin(); itReaders != readers.end(); ++itReaders)
+    {
+      delete *itReaders;
+    }
+    delete workerPool;
     delete modularDelphes;
     delete confReader;
+    delete replayLog;
+    delete checkpoint;
     delete treeWriter;
     delete outputFile;
 
@@ -247,6 +597,10 @@ int main(int argc, char *argv[])
   }
   catch(runtime_error &e)
   {
+    if(input) delete input;
+    if(workerPool) delete workerPool;
+    if(replayLog) delete replayLog;
+    if(checkpoint) delete checkpoint;
     if(treeWriter) delete treeWriter;
     if(outputFile) delete outputFile;
     cerr << "** ERROR: " << e.what() << endl;